@@ -0,0 +1,61 @@
+#ifndef AGGREGATE_WRITER_H
+#define AGGREGATE_WRITER_H
+
+/**
+ * @file AggregateWriter.h
+ * @brief Writes the merged frames of all nodes into one CSV or binary output.
+ */
+
+#include <cstdint>
+#include <cstdio>
+
+#include "aggregator/FrameMerger.h"
+
+/**
+ * @struct AggregateRecord
+ * @brief Fixed-size little-endian record of the binary output, one per sample index.
+ */
+struct AggregateRecord {
+    uint64_t time_us;   ///< Host time of the frame, see `AggregateWriter`.
+    int32_t  node;      ///< Node identifier.
+    uint32_t sequence;  ///< Position of the frame in the node's stream.
+    uint32_t ch0;       ///< Raw code of channel 0, `UINT32_MAX` if absent.
+    uint32_t ch1;       ///< Raw code of channel 1, `UINT32_MAX` if absent.
+    uint16_t index;     ///< Sample index within the frame.
+    uint16_t source;    ///< Input the frame was received on.
+    uint8_t  device;    ///< AD7124 of the node.
+    uint8_t  reserved[3]; ///< Zero, pads the record to 32 bytes.
+};
+
+/**
+ * @class AggregateWriter
+ * @brief Formats merged frames as CSV lines or binary records.
+ *
+ * The CSV columns are `time_us,node,device,sequence,source,index,ch0,ch1`;
+ * lines are formatted with `std::to_chars` like in `phyto_decode`. The time
+ * is the host time of the frame's last sample stamped by a synchronized node
+ * (`CLOCK_SYNC`), otherwise the time the frame was received.
+ */
+class AggregateWriter {
+public:
+    /**
+     * @param out Output stream, e.g. a file opened with a large buffer.
+     * @param binary Write `AggregateRecord`s instead of CSV.
+     */
+    AggregateWriter(FILE* out, bool binary);
+
+    /**
+     * @brief Writes every sample index of a frame.
+     */
+    void write(const MergedFrame& merged);
+
+    /// Samples written over both channels.
+    uint64_t samples(void) const { return m_samples; }
+
+private:
+    FILE*    m_out;
+    bool     m_binary;
+    uint64_t m_samples;
+};
+
+#endif // AGGREGATE_WRITER_H
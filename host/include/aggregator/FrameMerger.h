@@ -0,0 +1,123 @@
+#ifndef FRAME_MERGER_H
+#define FRAME_MERGER_H
+
+/**
+ * @file FrameMerger.h
+ * @brief Merges the decoded frames of many links into one ordered stream per node.
+ */
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include "stream_decoder/StreamDecoder.h"
+
+/**
+ * @struct MergedFrame
+ * @brief Frame handed to the output of a `FrameMerger`.
+ */
+struct MergedFrame {
+    const DecodedFrame& frame;  ///< Decoded frame; the spans are only valid during the callback.
+    uint32_t sequence;          ///< Position of the frame in its node's stream.
+    uint64_t time_us;           ///< Host time at which the frame was received.
+    unsigned int source;        ///< Link the frame was received on.
+};
+
+/**
+ * @struct MergerStats
+ * @brief Counters of a `FrameMerger` over all nodes.
+ */
+struct MergerStats {
+    uint64_t frames;            ///< Frames handed to the output.
+    uint64_t reordered;         ///< Frames held back until the frames before them arrived.
+    uint64_t duplicates;        ///< Frames dropped because their sequence number was already sent.
+    uint64_t lost;              ///< Sequence numbers skipped after the reorder window or hold time ran out.
+    uint32_t nodes;             ///< Nodes seen.
+};
+
+/**
+ * @class FrameMerger
+ * @brief Orders the frames of every node by sequence number and drops duplicates.
+ *
+ * Raw frames carry the node's sequence number, so a node received on several
+ * links (e.g. UART and a BLE relay) or a link that delivers late still yields
+ * every frame once and in order. A frame that arrives in order is handed to the
+ * output directly from the decoder's buffer; only frames that arrive ahead of
+ * a gap are copied and held, until the gap is filled, more than `window`
+ * frames are held for the node, or the oldest one was held for `max_hold_us`.
+ * The missing frames are then counted as lost.
+ *
+ * FlatBuffer frames carry no sequence number and are numbered per node in the
+ * order they arrive, so they are never reordered or recognized as duplicates.
+ */
+class FrameMerger {
+public:
+    /// Receiver of the merged frames.
+    using Output = std::function<void(const MergedFrame&)>;
+
+    /**
+     * @brief Constructs a merger.
+     * @param output Receiver of the merged frames.
+     * @param window Frames held per node at most while waiting for a gap to fill.
+     * @param max_hold_us Time a frame is held at most while waiting for a gap to fill.
+     */
+    FrameMerger(Output output, size_t window, uint64_t max_hold_us);
+
+    /**
+     * @brief Adds a decoded sample frame.
+     * @param frame Frame as delivered by a `StreamDecoder`.
+     * @param time_us Host time at which the frame was received.
+     * @param source Link the frame was received on.
+     */
+    void push(const DecodedFrame& frame, uint64_t time_us, unsigned int source);
+
+    /**
+     * @brief Sends the held frames whose hold time has run out.
+     * @param now_us Current host time.
+     */
+    void expire(uint64_t now_us);
+
+    /**
+     * @brief Sends all held frames, e.g. at the end of the input.
+     */
+    void flush(void);
+
+    /// Counters over all nodes.
+    const MergerStats& stats(void) const { return m_stats; }
+
+private:
+    /// Copy of a frame that arrived ahead of a gap.
+    struct HeldFrame {
+        int32_t node;
+        uint8_t device;
+        uint8_t version;
+        uint64_t time_us;
+        uint64_t frame_time_us;
+        unsigned int source;
+        std::vector<SerialMail::Value> ch0;
+        std::vector<SerialMail::Value> ch1;
+        std::vector<uint8_t> frame;
+    };
+
+    /// Ordering state of one node.
+    struct NodeStream {
+        bool     started;       ///< False until the first frame.
+        uint32_t next;          ///< Sequence number sent next.
+        std::map<uint32_t, HeldFrame> held; ///< Frames ahead of a gap, by sequence number.
+    };
+
+    Output   m_output;
+    size_t   m_window;
+    uint64_t m_max_hold_us;
+    std::unordered_map<int32_t, NodeStream> m_nodes;
+    MergerStats m_stats;
+
+    void send(const DecodedFrame& frame, uint32_t sequence, uint64_t time_us, unsigned int source);
+    void sendHeld(const HeldFrame& held, uint32_t sequence);
+    void drain(NodeStream& stream);
+    void skipGap(NodeStream& stream);
+};
+
+#endif // FRAME_MERGER_H
@@ -0,0 +1,137 @@
+#ifndef NODE_AGGREGATOR_H
+#define NODE_AGGREGATOR_H
+
+/**
+ * @file NodeAggregator.h
+ * @brief Ingests many serial ports and capture files on epoll event loops.
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "aggregator/FrameMerger.h"
+#include "aggregator/SyncMaster.h"
+#include "stream_decoder/StreamDecoder.h"
+#include "utils/MappedFile.h"
+
+/// Bytes read from a serial port per event.
+#define AGGREGATOR_READ_SIZE 4096
+
+/// Bytes of a capture file fed per turn of the event loop, so files do not starve the ports.
+#define AGGREGATOR_FILE_CHUNK_SIZE 65536
+
+/// Longest wait of an event loop, bounding how late held frames expire and a stop is noticed.
+#define AGGREGATOR_POLL_TIMEOUT_MS 100
+
+/**
+ * @struct SourceStats
+ * @brief Counters of one input of the aggregator.
+ */
+struct SourceStats {
+    std::string  path;          ///< Serial device or capture file.
+    DecoderStats decoder;       ///< Counters of its stream decoder.
+    bool         open;          ///< False once the input reached its end or failed.
+    bool         sync;          ///< Clock synchronization runs on this input.
+    SyncStats    sync_stats;    ///< Counters of its sync master if `sync`.
+};
+
+/**
+ * @class NodeAggregator
+ * @brief Decodes many node links at once and merges their frames into one output.
+ *
+ * Every input has its own `StreamDecoder` and read buffer. Serial ports (and
+ * the pseudo-terminals of the load generator) are registered with epoll and
+ * read when data is waiting; capture files are memory-mapped and fed in chunks
+ * between the epoll waits. Frames are decoded in place in the read buffer or
+ * the mapping and go through the shared `FrameMerger` to the output, so a frame
+ * is only copied if it straddles two reads or arrives ahead of a gap.
+ *
+ * With `workers` above 1 the inputs are distributed over that many event
+ * loops, each on its own thread with its own epoll instance. The loops only
+ * share the merger and the output, which are serialized by a mutex.
+ *
+ * With `setSyncInterval`, every serial port is also opened for writing and a
+ * `SyncMaster` sends it sync requests from its event loop, so nodes built with
+ * `CLOCK_SYNC` stamp their frames with the time of this host.
+ */
+class NodeAggregator {
+public:
+    /**
+     * @brief Constructs an aggregator without inputs.
+     * @param output Receiver of the merged frames, called with the merger lock held.
+     * @param window Reorder window of the merger in frames per node.
+     * @param max_hold_us Longest time the merger holds a frame ahead of a gap.
+     */
+    NodeAggregator(FrameMerger::Output output, size_t window, uint64_t max_hold_us);
+
+    /**
+     * @brief Closes all inputs.
+     */
+    ~NodeAggregator(void);
+
+    NodeAggregator(const NodeAggregator&) = delete;             ///< Deleted copy constructor.
+    NodeAggregator& operator=(const NodeAggregator&) = delete;  ///< Deleted assignment operator.
+
+    /**
+     * @brief Runs clock synchronization on the serial ports added afterwards.
+     * @param interval_us Time between two sync requests per port, 0 to disable.
+     */
+    void setSyncInterval(uint64_t interval_us) { m_sync_interval_us = interval_us; }
+
+    /**
+     * @brief Adds a serial device or capture file.
+     * @param path Path of the input; character devices are opened as serial ports.
+     * @param baudrate Baud rate for serial devices.
+     * @throws std::runtime_error if the input cannot be opened.
+     */
+    void addSource(const std::string& path, int baudrate);
+
+    /**
+     * @brief Runs the event loops until every input ended or `stop` is set.
+     * @param workers Number of event loops, each on its own thread if above 1.
+     * @param stop Flag polled at least every `AGGREGATOR_POLL_TIMEOUT_MS`.
+     * @throws std::runtime_error if an epoll instance cannot be created.
+     */
+    void run(unsigned int workers, const std::atomic<bool>& stop);
+
+    /// Counters of the merger.
+    MergerStats mergerStats(void);
+
+    /// Counters of every input in the order they were added.
+    std::vector<SourceStats> sourceStats(void);
+
+    /// Current host time in microseconds, as stamped onto the frames.
+    static uint64_t nowUs(void);
+
+private:
+    /// One serial port or capture file.
+    struct Source {
+        unsigned int index;                     ///< Position in `m_sources`, reported as the frame source.
+        std::string path;                       ///< Serial device or capture file.
+        int fd;                                 ///< Descriptor of a serial port, -1 for files.
+        std::unique_ptr<MappedFile> file;       ///< Mapping of a capture file.
+        size_t file_offset;                     ///< Bytes of the mapping fed so far.
+        std::unique_ptr<StreamDecoder> decoder; ///< Decoder of this input's stream.
+        uint64_t time_us;                       ///< Receive time of the chunk being decoded.
+        std::unique_ptr<SyncMaster> sync;       ///< Clock synchronization of a port, null if off.
+        bool open;                              ///< False once the input ended.
+        uint8_t buffer[AGGREGATOR_READ_SIZE];   ///< Read buffer the frames are decoded in.
+    };
+
+    std::vector<std::unique_ptr<Source>> m_sources;
+    std::mutex  m_merger_mutex;     ///< Serializes the merger and the output between event loops.
+    FrameMerger m_merger;
+    uint64_t    m_sync_interval_us; ///< Sync request interval for new ports, 0 if off.
+
+    void loop(int epoll_fd, const std::vector<Source*>& sources, const std::atomic<bool>& stop);
+    bool readSerial(Source& source);
+    bool feedFile(Source& source);
+    void sendSyncRequest(Source& source);
+    void close(Source& source);
+};
+
+#endif // NODE_AGGREGATOR_H
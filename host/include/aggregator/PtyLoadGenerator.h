@@ -0,0 +1,87 @@
+#ifndef PTY_LOAD_GENERATOR_H
+#define PTY_LOAD_GENERATOR_H
+
+/**
+ * @file PtyLoadGenerator.h
+ * @brief Synthetic nodes sending frames over pseudo-terminals.
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @struct LoadOptions
+ * @brief Traffic of the synthetic nodes.
+ */
+struct LoadOptions {
+    double       rate_sps;      ///< Samples per second and channel of every node, 0 to send as fast as possible.
+    unsigned int vector_size;   ///< Samples per channel and frame.
+    bool         raw;           ///< Raw frames (`RAW_FRAMES`) instead of FlatBuffer frames.
+    int          first_node;    ///< Node id of the first node, the others follow.
+    unsigned int seed;          ///< Seed of the sample noise and the send phases.
+};
+
+/**
+ * @struct LoadStats
+ * @brief What the generator sent.
+ */
+struct LoadStats {
+    uint64_t frames;            ///< Frames written over all nodes.
+    uint64_t bytes;             ///< Bytes written over all nodes.
+    uint64_t late_frames;       ///< Frames written more than one frame period after they were due.
+};
+
+/**
+ * @class PtyLoadGenerator
+ * @brief Plays a number of nodes, each on its own pseudo-terminal.
+ *
+ * Every node gets a pseudo-terminal in raw mode; its slave (`paths`) is opened
+ * like the UART of a real node. The nodes send frames built by the firmware's
+ * `FrameBuilder` or `RawFrameBuilder` with their own node id, sine-plus-noise
+ * samples and, at a fixed rate, evenly spread send phases, as free-running
+ * nodes would. The writes block while a reader falls behind, so a slow reader
+ * shows up as late frames instead of lost ones.
+ */
+class PtyLoadGenerator {
+public:
+    /**
+     * @brief Creates the pseudo-terminals.
+     * @param nodes Number of synthetic nodes.
+     * @param options Traffic of every node.
+     * @throws std::runtime_error if a pseudo-terminal cannot be created.
+     */
+    PtyLoadGenerator(unsigned int nodes, const LoadOptions& options);
+
+    /**
+     * @brief Closes the pseudo-terminals, which readers see as a hang-up.
+     */
+    ~PtyLoadGenerator(void);
+
+    PtyLoadGenerator(const PtyLoadGenerator&) = delete;             ///< Deleted copy constructor.
+    PtyLoadGenerator& operator=(const PtyLoadGenerator&) = delete;  ///< Deleted assignment operator.
+
+    /// Slave devices of the nodes, by node.
+    const std::vector<std::string>& paths(void) const { return m_paths; }
+
+    /**
+     * @brief Sends frames of all nodes until the time is up or `stop` is set.
+     * @param duration_s Time to send for.
+     * @param stop Flag checked between frames.
+     * @return What was sent.
+     */
+    LoadStats run(double duration_s, const std::atomic<bool>& stop);
+
+    /**
+     * @brief Closes the pseudo-terminals in this process, e.g. in a reader that forked off the generator.
+     */
+    void close(void);
+
+private:
+    LoadOptions              m_options;
+    std::vector<int>         m_masters;     ///< Master side of every node.
+    std::vector<std::string> m_paths;       ///< Slave side of every node.
+};
+
+#endif // PTY_LOAD_GENERATOR_H
@@ -0,0 +1,85 @@
+#ifndef SYNC_MASTER_H
+#define SYNC_MASTER_H
+
+/**
+ * @file SyncMaster.h
+ * @brief Host side of the clock synchronization exchange with one node (`CLOCK_SYNC`).
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+#include "timing/ClockSync.h"
+
+/// Exchanges sent one second apart after startup; they fill the node's history, so its skew settles quickly.
+#define SYNC_MASTER_STARTUP_EXCHANGES 32
+
+/// Interval of the startup exchanges in us.
+#define SYNC_MASTER_STARTUP_INTERVAL_US 1000000
+
+/**
+ * @struct SyncStats
+ * @brief Counters and the latest measurement of a `SyncMaster`.
+ */
+struct SyncStats {
+    uint64_t requests;          ///< Requests sent.
+    uint64_t responses;         ///< Responses to the outstanding request.
+    uint64_t stale_responses;   ///< Responses to an older request, e.g. after a timeout.
+    int64_t  offset_us;         ///< Host minus node time of the latest exchange.
+    int64_t  delay_us;          ///< Round trip delay of the latest exchange.
+    int32_t  skew_ppb;          ///< Skew of the node clock as estimated by the node.
+    bool     synced;            ///< The node stamps its frames with host time.
+};
+
+/**
+ * @class SyncMaster
+ * @brief Sends sync requests to a node and returns the arrival of each response with the next one.
+ *
+ * The node estimates offset and skew itself (see `ClockSync`); the host only
+ * stamps T1 and T4. A request whose response does not arrive before the next
+ * request is due is abandoned, the node then counts the exchange as missed.
+ * The offset and delay of every exchange are also computed here, for the
+ * statistics only.
+ */
+class SyncMaster {
+public:
+    /**
+     * @param interval_us Time between two requests after the startup exchanges.
+     */
+    explicit SyncMaster(uint64_t interval_us);
+
+    /**
+     * @brief Tells whether the next request is due.
+     * @param now_us Host time.
+     */
+    bool due(uint64_t now_us) const { return now_us >= m_next_us; }
+
+    /**
+     * @brief Writes the next request, stamped with `now_us`, and schedules the one after.
+     * @return Number of bytes written to `out`, 0 if they do not fit.
+     */
+    size_t makeRequest(uint64_t now_us, uint8_t* out, size_t capacity);
+
+    /**
+     * @brief Takes a response of the node.
+     * @param response Response delivered by the `StreamDecoder`.
+     * @param t4_us Host time the response arrived.
+     * @return False if it does not answer the outstanding request.
+     */
+    bool onResponse(const SyncResponse& response, uint64_t t4_us);
+
+    /// Counters and the latest measurement.
+    const SyncStats& stats(void) const { return m_stats; }
+
+private:
+    uint64_t  m_interval_us;    ///< Time between two requests.
+    uint64_t  m_next_us;        ///< Host time the next request is due.
+    uint32_t  m_next_id;        ///< Identifier of the next request.
+    uint32_t  m_outstanding_id; ///< Request waiting for its response, 0 if none.
+    uint64_t  m_outstanding_t1; ///< Its T1.
+    uint32_t  m_done_id;        ///< Last exchange with a response, 0 if none.
+    uint64_t  m_done_t4;        ///< Arrival of its response.
+    SyncStats m_stats;          ///< Counters.
+};
+
+#endif // SYNC_MASTER_H
@@ -0,0 +1,139 @@
+#ifndef CAPTURE_FILE_H
+#define CAPTURE_FILE_H
+
+/**
+ * @file CaptureFile.h
+ * @brief Writing and reading of indexed capture files (see `capture/CaptureFormat.h`).
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "capture/CaptureFormat.h"
+
+/**
+ * @class CaptureWriter
+ * @brief Appends records to a capture file and writes the seek index on finalization.
+ *
+ * A file that was never finalized (e.g. the recorder was killed) has no index but
+ * can still be read sequentially.
+ */
+class CaptureWriter {
+public:
+    /**
+     * @brief Creates the capture file and writes its header.
+     * @param path Path of the capture file.
+     * @param kind Kind of the records that will be appended.
+     * @param node Node the capture is taken from, 0 if unknown.
+     * @throws std::runtime_error if the file cannot be created.
+     */
+    CaptureWriter(const std::string& path, CaptureKind kind, uint16_t node);
+
+    /**
+     * @brief Finalizes the file if this has not been done explicitly.
+     */
+    ~CaptureWriter(void);
+
+    CaptureWriter(const CaptureWriter&) = delete;             ///< Deleted copy constructor.
+    CaptureWriter& operator=(const CaptureWriter&) = delete;  ///< Deleted assignment operator.
+
+    /**
+     * @brief Appends a payload as a new record.
+     * @param payload Record payload.
+     * @param time_us Time of the record relative to the first one in microseconds.
+     */
+    void append(std::span<const uint8_t> payload, uint64_t time_us);
+
+    /**
+     * @brief Appends a record received from the node verbatim, keeping its delta timestamp.
+     * @param header Validated record header.
+     * @param payload Record payload.
+     */
+    void appendRecord(const CaptureRecordHeader& header, std::span<const uint8_t> payload);
+
+    /**
+     * @brief Writes the index and the footer and closes the file.
+     */
+    void finalize(void);
+
+    /// Number of records written so far.
+    uint32_t recordCount(void) const { return m_record_count; }
+
+private:
+    FILE*                          m_file;          ///< Open capture file, null after finalization.
+    CaptureKind                    m_kind;          ///< Kind of all records.
+    uint64_t                       m_offset;        ///< Current end of the file.
+    uint64_t                       m_time_us;       ///< Time of the last record.
+    uint32_t                       m_record_count;  ///< Records written.
+    std::vector<CaptureIndexEntry> m_index;         ///< Seek points collected so far.
+
+    void write(const void* data, size_t size);
+};
+
+/**
+ * @struct CaptureRecord
+ * @brief View of one record inside a mapped capture file.
+ */
+struct CaptureRecord {
+    uint64_t                 time_us;   ///< Time relative to the first record.
+    uint8_t                  kind;      ///< One of `CaptureKind`.
+    std::span<const uint8_t> payload;   ///< Record payload.
+};
+
+/**
+ * @class CaptureReader
+ * @brief Sequential reader with index-based seeking over a memory-mapped capture file.
+ */
+class CaptureReader {
+public:
+    /**
+     * @brief Parses the header and, if present, the index of a capture.
+     * @param bytes Complete capture file content.
+     * @throws std::runtime_error if the header is missing or has the wrong magic/version.
+     */
+    explicit CaptureReader(std::span<const uint8_t> bytes);
+
+    /// Header of the capture file.
+    const CaptureFileHeader& header(void) const { return m_header; }
+
+    /// True if the file was finalized and has a seek index.
+    bool indexed(void) const { return !m_index.empty(); }
+
+    /// Number of records according to the footer, 0 for unfinalized files.
+    uint32_t recordCount(void) const { return m_record_count; }
+
+    /**
+     * @brief Positions the reader at the last index point at or before the given time.
+     * @param time_us Time relative to the first record in microseconds.
+     *
+     * Without an index the reader rewinds to the first record.
+     */
+    void seek(uint64_t time_us);
+
+    /**
+     * @brief Reads the next record.
+     * @param record Receives the record view.
+     * @return False at the end of the record area.
+     *
+     * Corrupted records are skipped by searching for the next record marker.
+     */
+    bool next(CaptureRecord& record);
+
+    /// Number of corrupted records skipped so far.
+    uint32_t corruptRecords(void) const { return m_corrupt_records; }
+
+private:
+    std::span<const uint8_t>       m_bytes;             ///< Complete file.
+    CaptureFileHeader              m_header;            ///< Parsed file header.
+    std::vector<CaptureIndexEntry> m_index;             ///< Parsed index, empty if not finalized.
+    size_t                         m_records_end;       ///< End of the record area.
+    size_t                         m_position;          ///< Offset of the next record.
+    uint64_t                       m_time_us;           ///< Time of the last returned record.
+    uint32_t                       m_record_count;      ///< Record count from the footer.
+    uint32_t                       m_corrupt_records;   ///< Skipped records.
+};
+
+#endif // CAPTURE_FILE_H
@@ -0,0 +1,49 @@
+#ifndef CAPTURE_STREAM_PARSER_H
+#define CAPTURE_STREAM_PARSER_H
+
+/**
+ * @file CaptureStreamParser.h
+ * @brief Extracts capture records from the node's serial stream.
+ */
+
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <vector>
+
+#include "capture/CaptureFormat.h"
+
+/**
+ * @class CaptureStreamParser
+ * @brief Finds `0xCCCC` capture records between the regular frames on the link.
+ *
+ * Records are validated by length and checksum; anything else on the link
+ * (including regular serial mail frames) is skipped.
+ */
+class CaptureStreamParser {
+public:
+    /// Callback invoked for every valid record.
+    using RecordHandler = std::function<void(const CaptureRecordHeader&, std::span<const uint8_t>)>;
+
+    /**
+     * @brief Constructs a parser.
+     * @param handler Callback invoked for every valid record.
+     */
+    explicit CaptureStreamParser(RecordHandler handler);
+
+    /**
+     * @brief Feeds the next chunk of the serial stream.
+     * @param chunk Received bytes.
+     */
+    void feed(std::span<const uint8_t> chunk);
+
+    /// Number of candidate records rejected so far.
+    uint32_t rejectedRecords(void) const { return m_rejected_records; }
+
+private:
+    RecordHandler        m_handler;           ///< Receiver of valid records.
+    std::vector<uint8_t> m_buffer;            ///< Unprocessed bytes.
+    uint32_t             m_rejected_records;  ///< Candidates with a bad length or checksum.
+};
+
+#endif // CAPTURE_STREAM_PARSER_H
@@ -0,0 +1,110 @@
+#ifndef BULK_CONVERTER_H
+#define BULK_CONVERTER_H
+
+/**
+ * @file BulkConverter.h
+ * @brief Parallel conversion of raw serial captures into columnar files.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "convert/ColumnarFile.h"
+#include "stream_decoder/StreamDecoder.h"
+
+/// Default size of the pieces a capture is split into, independent of the thread count.
+#define CONVERT_DEFAULT_CHUNK_SIZE (16u << 20)
+
+/// Smallest chunk, a few frames of the largest size.
+#define CONVERT_MIN_CHUNK_SIZE (64u << 10)
+
+/// Chunks a worker may be ahead of the writer, bounding the memory held by converted chunks.
+#define CONVERT_CHUNKS_PER_WORKER 2
+
+/// Frames that must follow a sync marker back to back for it to count as a frame boundary.
+#define CONVERT_BOUNDARY_CHAIN 4
+
+/**
+ * @brief Finds the first frame boundary at or after an offset of a capture.
+ * @param bytes Complete capture, `0xAAAA` + size + payload frames.
+ * @param from Offset to search from.
+ * @return Offset of the first sync marker from which `CONVERT_BOUNDARY_CHAIN`
+ *         frames with a plausible size follow back to back (fewer if the
+ *         capture ends first), or `bytes.size()` if there is none.
+ *
+ * A sync marker inside the samples of a frame is rejected unless several
+ * frame lengths line up behind it, so chunks split at these offsets divide
+ * the capture between frames; the decoders check each frame anyway.
+ */
+size_t find_frame_boundary(std::span<const uint8_t> bytes, size_t from);
+
+/**
+ * @brief Converts the samples of a frame into rows, in millivolts.
+ * @param frame Decoded raw or FlatBuffer frame.
+ * @param frame_number Value of the frame column.
+ * @param columns Receives one row per sample index.
+ *
+ * The conversion is the one of `get_analog_inputs` with the constants of the
+ * preset the host tools are built with.
+ */
+void append_sample_rows(const DecodedFrame& frame, uint64_t frame_number, SampleColumns& columns);
+
+/**
+ * @struct ConvertStats
+ * @brief Counters of a conversion.
+ */
+struct ConvertStats {
+    uint64_t bytes;             ///< Capture bytes converted.
+    uint64_t chunks;            ///< Chunks decoded.
+    uint64_t frames;            ///< Sample frames converted.
+    uint64_t rows;              ///< Rows written.
+    uint64_t samples;           ///< Samples over both channels.
+    uint64_t skipped_bytes;     ///< Bytes the decoders skipped while searching for a sync marker.
+    uint64_t rejected_frames;   ///< Candidate frames the decoders dropped.
+};
+
+/**
+ * @class BulkConverter
+ * @brief Splits captures into chunks and converts them on a pool of threads.
+ *
+ * The capture is divided into chunks of about `chunk_size` bytes. Every
+ * worker takes the next chunk, finds the frame boundaries at its nominal
+ * start and end with `find_frame_boundary`, decodes the frames in between
+ * with its own `StreamDecoder` straight from the mapping and converts them
+ * into rows. The calling thread writes the chunks as row groups in capture
+ * order while the workers continue, at most `CONVERT_CHUNKS_PER_WORKER`
+ * chunks per worker ahead of it.
+ *
+ * The chunks depend on `chunk_size` only, so the output is byte for byte the
+ * same for any number of workers. Band power, latency, sync and message
+ * frames carry no samples and are left out; messages and latency reports
+ * spanning two chunks are not reassembled.
+ */
+class BulkConverter {
+public:
+    /**
+     * @param workers Decoding threads, at least 1.
+     * @param chunk_size Nominal chunk size in bytes, at least `CONVERT_MIN_CHUNK_SIZE`.
+     */
+    BulkConverter(unsigned int workers, size_t chunk_size = CONVERT_DEFAULT_CHUNK_SIZE);
+
+    /**
+     * @brief Converts one capture and appends its rows to the output.
+     * @param capture Complete capture, e.g. a `MappedFile`.
+     * @param writer Output; frame numbers continue from earlier captures.
+     * @throws std::runtime_error if writing fails.
+     */
+    void convert(std::span<const uint8_t> capture, ColumnarWriter& writer);
+
+    /// Counters over all captures converted.
+    const ConvertStats& stats(void) const { return m_stats; }
+
+private:
+    unsigned int m_workers;     ///< Decoding threads.
+    size_t       m_chunk_size;  ///< Nominal chunk size.
+    uint64_t     m_frames;      ///< Frames converted, the number of the next frame.
+    ConvertStats m_stats;       ///< Counters.
+};
+
+#endif // BULK_CONVERTER_H
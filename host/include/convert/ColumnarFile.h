@@ -0,0 +1,244 @@
+#ifndef COLUMNAR_FILE_H
+#define COLUMNAR_FILE_H
+
+/**
+ * @file ColumnarFile.h
+ * @brief Columnar analysis files written by `phyto_convert`, one row per sample index.
+ *
+ * The file holds the columns listed in `sample_columns` in row groups:
+ *
+ * ```
+ * ColumnarFileHeader
+ * ColumnDescriptor[column_count]
+ * row group 0 .. row group N-1    (ColumnarGroupHeader + every column in order)
+ * ColumnarGroupEntry[group_count]
+ * ColumnarFileFooter
+ * ```
+ *
+ * Within a row group each column is a plain little-endian array of `rows`
+ * values, zero-padded to a multiple of 8 bytes and starting at an offset that
+ * is a multiple of 8, so a mapped file can be read column by column without
+ * copying (e.g. `numpy.frombuffer` with the offsets from the group index).
+ * Rows are in the order of the capture, independent of how many threads
+ * converted it.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <span>
+#include <string>
+#include <vector>
+
+/// Magic bytes at the start of a columnar file.
+constexpr char COLUMNAR_FILE_MAGIC[4] = {'P', 'H', 'Y', 'A'};
+
+/// Magic bytes at the end of a finalized columnar file.
+constexpr char COLUMNAR_FOOTER_MAGIC[4] = {'P', 'H', 'Y', 'E'};
+
+/// Version of the columnar file layout.
+constexpr uint8_t COLUMNAR_FILE_VERSION = 1;
+
+/// Alignment of the columns within the file.
+constexpr size_t COLUMNAR_ALIGNMENT = 8;
+
+/**
+ * @enum ColumnType
+ * @brief Element type of a column.
+ */
+enum ColumnType : uint8_t {
+    COLUMN_UINT8   = 1,
+    COLUMN_UINT16  = 2,
+    COLUMN_INT32   = 3,
+    COLUMN_UINT64  = 4,
+    COLUMN_FLOAT32 = 5,     ///< IEEE-754 single precision.
+};
+
+/**
+ * @enum SampleColumn
+ * @brief Columns of a converted capture, in file order.
+ */
+enum SampleColumn : uint8_t {
+    SAMPLE_COLUMN_FRAME = 0,    ///< Running frame number over all inputs.
+    SAMPLE_COLUMN_TIME,         ///< Host time of the frame's last sample (`CLOCK_SYNC`), else 0.
+    SAMPLE_COLUMN_NODE,         ///< Node identifier.
+    SAMPLE_COLUMN_DEVICE,       ///< AD7124 of the node.
+    SAMPLE_COLUMN_INDEX,        ///< Sample index within the frame.
+    SAMPLE_COLUMN_CH0,          ///< Channel 0 in millivolts, NaN if absent.
+    SAMPLE_COLUMN_CH1,          ///< Channel 1 in millivolts, NaN if absent.
+    SAMPLE_COLUMN_COUNT,
+};
+
+#pragma pack(push, 1)
+
+/**
+ * @struct ColumnarFileHeader
+ * @brief Header at the start of a columnar file (8 bytes).
+ */
+struct ColumnarFileHeader {
+    char    magic[4];       ///< `COLUMNAR_FILE_MAGIC`.
+    uint8_t version;        ///< `COLUMNAR_FILE_VERSION`.
+    uint8_t column_count;   ///< Number of column descriptors that follow.
+    uint8_t reserved[2];    ///< Zero.
+};
+
+/**
+ * @struct ColumnDescriptor
+ * @brief Name and type of one column (16 bytes).
+ */
+struct ColumnDescriptor {
+    char    name[14];       ///< Zero-terminated column name.
+    uint8_t type;           ///< One of `ColumnType`.
+    uint8_t width;          ///< Bytes per value.
+};
+
+/**
+ * @struct ColumnarGroupHeader
+ * @brief Header of a row group (8 bytes).
+ */
+struct ColumnarGroupHeader {
+    uint32_t rows;          ///< Rows in the group.
+    uint32_t reserved;      ///< Zero.
+};
+
+/**
+ * @struct ColumnarGroupEntry
+ * @brief Location of one row group (16 bytes).
+ */
+struct ColumnarGroupEntry {
+    uint64_t offset;        ///< File offset of the group header.
+    uint32_t rows;          ///< Rows in the group.
+    uint32_t reserved;      ///< Zero.
+};
+
+/**
+ * @struct ColumnarFileFooter
+ * @brief Footer at the end of a finalized columnar file (28 bytes).
+ */
+struct ColumnarFileFooter {
+    uint64_t index_offset;  ///< File offset of the first group entry.
+    uint32_t group_count;   ///< Number of group entries.
+    uint64_t rows;          ///< Rows in all groups.
+    uint32_t reserved;      ///< Zero.
+    char     magic[4];      ///< `COLUMNAR_FOOTER_MAGIC`.
+};
+
+#pragma pack(pop)
+
+static_assert(sizeof(ColumnarFileHeader) == 8, "ColumnarFileHeader must be 8 bytes");
+static_assert(sizeof(ColumnDescriptor) == 16, "ColumnDescriptor must be 16 bytes");
+static_assert(sizeof(ColumnarGroupHeader) == 8, "ColumnarGroupHeader must be 8 bytes");
+static_assert(sizeof(ColumnarGroupEntry) == 16, "ColumnarGroupEntry must be 16 bytes");
+static_assert(sizeof(ColumnarFileFooter) == 28, "ColumnarFileFooter must be 28 bytes");
+
+/// Columns of a converted capture; the enumerators of `SampleColumn` index it.
+extern const ColumnDescriptor sample_columns[SAMPLE_COLUMN_COUNT];
+
+/**
+ * @struct SampleColumns
+ * @brief Rows of one row group, column by column.
+ */
+struct SampleColumns {
+    std::vector<uint64_t> frame;
+    std::vector<uint64_t> time_us;
+    std::vector<int32_t>  node;
+    std::vector<uint8_t>  device;
+    std::vector<uint16_t> index;
+    std::vector<float>    ch0_mv;
+    std::vector<float>    ch1_mv;
+
+    /// Number of rows.
+    size_t rows(void) const { return frame.size(); }
+
+    /// Removes all rows, keeping the capacity.
+    void clear(void);
+};
+
+/**
+ * @class ColumnarWriter
+ * @brief Writes row groups and, on finalization, the group index.
+ */
+class ColumnarWriter {
+public:
+    /**
+     * @brief Creates the file and writes the header and the column descriptors.
+     * @param path Path of the file.
+     * @throws std::runtime_error if the file cannot be created.
+     */
+    explicit ColumnarWriter(const std::string& path);
+
+    /**
+     * @brief Finalizes the file if this has not been done explicitly.
+     */
+    ~ColumnarWriter(void);
+
+    ColumnarWriter(const ColumnarWriter&) = delete;             ///< Deleted copy constructor.
+    ColumnarWriter& operator=(const ColumnarWriter&) = delete;  ///< Deleted assignment operator.
+
+    /**
+     * @brief Appends the rows as a new row group; empty groups are skipped.
+     * @param columns Rows to write.
+     */
+    void writeGroup(const SampleColumns& columns);
+
+    /**
+     * @brief Writes the group index and the footer and closes the file.
+     */
+    void finalize(void);
+
+    /// Rows written so far.
+    uint64_t rows(void) const { return m_rows; }
+
+    /// Bytes written so far.
+    uint64_t bytes(void) const { return m_offset; }
+
+private:
+    FILE*                           m_file;     ///< Open file, null after finalization.
+    uint64_t                        m_offset;   ///< Current end of the file.
+    uint64_t                        m_rows;     ///< Rows written.
+    std::vector<ColumnarGroupEntry> m_index;    ///< Groups written so far.
+
+    void write(const void* data, size_t size);
+    void writeColumn(const void* data, size_t size);
+};
+
+/**
+ * @class ColumnarReader
+ * @brief Column views into a memory-mapped columnar file.
+ */
+class ColumnarReader {
+public:
+    /**
+     * @brief Parses the header, the descriptors and the group index.
+     * @param bytes Complete file content; must stay mapped while columns are read.
+     * @throws std::runtime_error if the file is not a finalized file of this version and schema.
+     */
+    explicit ColumnarReader(std::span<const uint8_t> bytes);
+
+    /// Row groups of the file.
+    std::span<const ColumnarGroupEntry> groups(void) const { return m_groups; }
+
+    /// Rows in all groups.
+    uint64_t rows(void) const { return m_rows; }
+
+    /**
+     * @brief Returns one column of a row group.
+     * @tparam T Element type matching the column's descriptor.
+     * @param group Index of the row group.
+     * @param column One of `SampleColumn`.
+     * @return View of `rows` values.
+     */
+    template <typename T>
+    std::span<const T> column(size_t group, SampleColumn column) const {
+        return {reinterpret_cast<const T*>(m_bytes.data() + columnOffset(group, column)), m_groups[group].rows};
+    }
+
+private:
+    std::span<const uint8_t>        m_bytes;    ///< Complete file.
+    std::vector<ColumnarGroupEntry> m_groups;   ///< Parsed group index.
+    uint64_t                        m_rows;     ///< Row count from the footer.
+
+    size_t columnOffset(size_t group, SampleColumn column) const;
+};
+
+#endif // COLUMNAR_FILE_H
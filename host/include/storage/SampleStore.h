@@ -0,0 +1,272 @@
+#ifndef SAMPLE_STORE_H
+#define SAMPLE_STORE_H
+
+/**
+ * @file SampleStore.h
+ * @brief Compressed columnar storage of decoded samples for long recordings.
+ *
+ * Samples are kept per series, i.e. per node, AD7124 and channel, and
+ * written in blocks of up to `SAMPLE_STORE_BLOCK_SAMPLES` samples:
+ *
+ * ```
+ * SampleStoreHeader
+ * block 0 .. block N-1              (SampleBlockHeader + time column + value column)
+ * SampleBlockIndexEntry[index_count] (sorted by series, then time)
+ * SampleStoreFooter
+ * ```
+ *
+ * The time column holds the delta-of-delta of consecutive timestamps in a
+ * variable-length bit code, so the evenly spaced samples of a frame cost one
+ * bit each. The value column holds the zigzag-coded delta of consecutive
+ * samples, bit-packed in groups of `SAMPLE_STORE_GROUP_SIZE` at the width of
+ * the group's largest delta. The index holds the time and value range of
+ * every block, so a time range is found without reading any block.
+ *
+ * All multi-byte fields are little-endian.
+ */
+
+#include <compare>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "stream_decoder/StreamDecoder.h"
+
+/// Magic bytes at the start of a sample store.
+constexpr char SAMPLE_STORE_MAGIC[4] = {'P', 'H', 'Y', 'S'};
+
+/// Magic bytes at the end of a finalized sample store.
+constexpr char SAMPLE_STORE_FOOTER_MAGIC[4] = {'P', 'H', 'Y', 'X'};
+
+/// Version of the sample store layout.
+constexpr uint8_t SAMPLE_STORE_VERSION = 1;
+
+/// Largest number of samples in a block; one hour of a 2 SPS channel, 8 s at 1 kSPS.
+constexpr uint32_t SAMPLE_STORE_BLOCK_SAMPLES = 8192;
+
+/// Values sharing one bit width in the value column.
+constexpr uint32_t SAMPLE_STORE_GROUP_SIZE = 64;
+
+/**
+ * @struct SampleSeriesKey
+ * @brief Identifies the series a sample belongs to.
+ */
+struct SampleSeriesKey {
+    int32_t node;       ///< Node identifier.
+    uint8_t device;     ///< AD7124 of the node.
+    uint8_t channel;    ///< Channel of the AD7124.
+
+    auto operator<=>(const SampleSeriesKey&) const = default;
+};
+
+#pragma pack(push, 1)
+
+/**
+ * @struct SampleStoreHeader
+ * @brief Header at the start of a sample store (16 bytes).
+ */
+struct SampleStoreHeader {
+    char     magic[4];      ///< `SAMPLE_STORE_MAGIC`.
+    uint8_t  version;       ///< `SAMPLE_STORE_VERSION`.
+    uint8_t  reserved[3];   ///< Zero.
+    uint64_t created_us;    ///< Wall clock time the store was created (µs since the Unix epoch).
+};
+
+/**
+ * @struct SampleBlockHeader
+ * @brief Header preceding the columns of every block (28 bytes).
+ */
+struct SampleBlockHeader {
+    int32_t  node;          ///< Series of the block.
+    uint8_t  device;        ///< Series of the block.
+    uint8_t  channel;       ///< Series of the block.
+    uint16_t reserved;      ///< Zero.
+    uint32_t count;         ///< Samples in the block.
+    uint32_t time_size;     ///< Bytes of the time column.
+    uint32_t value_size;    ///< Bytes of the value column.
+    uint64_t first_time_us; ///< Time of the first sample; the time column starts with the second.
+};
+
+/**
+ * @struct SampleBlockIndexEntry
+ * @brief Location and ranges of one block (44 bytes).
+ */
+struct SampleBlockIndexEntry {
+    int32_t  node;          ///< Series of the block.
+    uint8_t  device;        ///< Series of the block.
+    uint8_t  channel;       ///< Series of the block.
+    uint16_t reserved;      ///< Zero.
+    uint32_t count;         ///< Samples in the block.
+    uint64_t offset;        ///< File offset of the block header.
+    uint64_t first_time_us; ///< Time of the first sample.
+    uint64_t last_time_us;  ///< Time of the last sample.
+    int32_t  min_value;     ///< Smallest sample.
+    int32_t  max_value;     ///< Largest sample.
+};
+
+/**
+ * @struct SampleStoreFooter
+ * @brief Footer at the end of a finalized sample store (24 bytes).
+ */
+struct SampleStoreFooter {
+    uint64_t index_offset;  ///< File offset of the first index entry.
+    uint32_t index_count;   ///< Number of index entries.
+    uint64_t samples;       ///< Samples in all blocks.
+    char     magic[4];      ///< `SAMPLE_STORE_FOOTER_MAGIC`.
+};
+
+#pragma pack(pop)
+
+static_assert(sizeof(SampleStoreHeader) == 16, "SampleStoreHeader must be 16 bytes");
+static_assert(sizeof(SampleBlockHeader) == 28, "SampleBlockHeader must be 28 bytes");
+static_assert(sizeof(SampleBlockIndexEntry) == 44, "SampleBlockIndexEntry must be 44 bytes");
+static_assert(sizeof(SampleStoreFooter) == 24, "SampleStoreFooter must be 24 bytes");
+
+/**
+ * @class SampleStoreWriter
+ * @brief Collects samples per series and writes a block whenever one is full.
+ *
+ * Samples of a series must arrive in time order. A sample older than its
+ * predecessor, e.g. after a clock sync stepped the node back, is stored at
+ * the predecessor's time, so the blocks of a series never overlap in time;
+ * `clampedSamples` counts them.
+ */
+class SampleStoreWriter {
+public:
+    /**
+     * @brief Creates the store and writes its header.
+     * @param path Path of the store.
+     * @throws std::runtime_error if the file cannot be created.
+     */
+    explicit SampleStoreWriter(const std::string& path);
+
+    /**
+     * @brief Finalizes the store if this has not been done explicitly.
+     */
+    ~SampleStoreWriter(void);
+
+    SampleStoreWriter(const SampleStoreWriter&) = delete;             ///< Deleted copy constructor.
+    SampleStoreWriter& operator=(const SampleStoreWriter&) = delete;  ///< Deleted assignment operator.
+
+    /**
+     * @brief Appends samples to a series.
+     * @param key Series of the samples.
+     * @param times Time of every sample in microseconds.
+     * @param values Samples, as many as `times`.
+     */
+    void append(const SampleSeriesKey& key, std::span<const uint64_t> times, std::span<const int32_t> values);
+
+    /**
+     * @brief Appends both channels of a decoded sample frame.
+     * @param frame Raw or FlatBuffer frame; band power frames are ignored.
+     * @param time_us Time of the frame's last sample in microseconds.
+     * @param period_us Time between two samples of a channel.
+     *
+     * Samples are stored sign-corrected as held on the node (`node_sample`);
+     * the earlier samples of the frame are placed `period_us` apart before
+     * the last one.
+     */
+    void appendFrame(const DecodedFrame& frame, uint64_t time_us, uint32_t period_us);
+
+    /**
+     * @brief Writes the open blocks, the index and the footer and closes the file.
+     */
+    void finalize(void);
+
+    /// Samples appended so far.
+    uint64_t samples(void) const { return m_samples; }
+
+    /// Samples stored at the time of their predecessor.
+    uint64_t clampedSamples(void) const { return m_clamped_samples; }
+
+    /// Bytes written so far.
+    uint64_t bytes(void) const { return m_offset; }
+
+private:
+    /**
+     * @struct Series
+     * @brief Samples of the open block of a series.
+     */
+    struct Series {
+        std::vector<uint64_t> times;    ///< Times of the open block.
+        std::vector<int32_t>  values;   ///< Samples of the open block.
+        uint64_t              last_time_us; ///< Time of the series' last sample, also of flushed blocks.
+    };
+
+    FILE*                                   m_file;             ///< Open store, null after finalization.
+    uint64_t                                m_offset;           ///< Current end of the file.
+    uint64_t                                m_samples;          ///< Samples appended.
+    uint64_t                                m_clamped_samples;  ///< Samples moved to their predecessor's time.
+    std::map<SampleSeriesKey, Series>       m_series;           ///< Open blocks.
+    std::vector<SampleBlockIndexEntry>      m_index;            ///< Blocks written so far.
+    std::vector<uint8_t>                    m_time_column;      ///< Encoding buffer.
+    std::vector<uint8_t>                    m_value_column;     ///< Encoding buffer.
+    std::vector<uint64_t>                   m_frame_times;      ///< Times of the frame being appended.
+    std::vector<int32_t>                    m_frame_values;     ///< Samples of the frame being appended.
+
+    void flush(const SampleSeriesKey& key, Series& series);
+    void write(const void* data, size_t size);
+};
+
+/**
+ * @class SampleStoreReader
+ * @brief Range scans over a memory-mapped sample store.
+ */
+class SampleStoreReader {
+public:
+    /**
+     * @brief Callback receiving the samples of one block that fall into the range.
+     *
+     * The spans point into the reader's decoding buffers and are only valid
+     * during the call.
+     */
+    using BlockHandler = std::function<void(std::span<const uint64_t> times, std::span<const int32_t> values)>;
+
+    /**
+     * @brief Parses the header, the index and the footer of a store.
+     * @param bytes Complete store content.
+     * @throws std::runtime_error if the store is not a finalized store of this version.
+     */
+    explicit SampleStoreReader(std::span<const uint8_t> bytes);
+
+    /// Index of all blocks, sorted by series and time.
+    std::span<const SampleBlockIndexEntry> index(void) const { return m_index; }
+
+    /// Series present in the store.
+    std::vector<SampleSeriesKey> series(void) const;
+
+    /// Samples in all blocks.
+    uint64_t samples(void) const { return m_samples; }
+
+    /**
+     * @brief Decodes the samples of a series within a time range.
+     * @param key Series to read.
+     * @param from_us First time included.
+     * @param to_us Last time included.
+     * @param handler Receives the samples block by block, in time order.
+     * @return Number of samples handed to `handler`.
+     * @throws std::runtime_error if a block is truncated or its columns are inconsistent.
+     *
+     * Only blocks whose time range overlaps the requested one are decoded.
+     */
+    uint64_t scan(const SampleSeriesKey& key, uint64_t from_us, uint64_t to_us, const BlockHandler& handler);
+
+    /// Blocks decoded by `scan` so far.
+    uint64_t decodedBlocks(void) const { return m_decoded_blocks; }
+
+private:
+    std::span<const uint8_t>            m_bytes;            ///< Complete store.
+    std::vector<SampleBlockIndexEntry>  m_index;            ///< Parsed index.
+    uint64_t                            m_samples;          ///< Sample count from the footer.
+    uint64_t                            m_decoded_blocks;   ///< Blocks decoded.
+    std::vector<uint64_t>               m_times;            ///< Decoding buffer.
+    std::vector<int32_t>                m_values;           ///< Decoding buffer.
+
+    void decode(const SampleBlockIndexEntry& entry);
+};
+
+#endif // SAMPLE_STORE_H
@@ -0,0 +1,71 @@
+#ifndef SIMULATED_FLASH_H
+#define SIMULATED_FLASH_H
+
+/**
+ * @file SimulatedFlash.h
+ * @brief NOR flash model for running the node's flash ring log on the host.
+ */
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "storage/FlashStorage.h"
+
+/// Program time of one 64-bit double word of the STM32WB55 internal flash (typical).
+#define SIMULATED_FLASH_PROGRAM_TIME_US 82
+
+/// Erase time of one 4 KB page of the STM32WB55 internal flash (typical).
+#define SIMULATED_FLASH_ERASE_TIME_US 22000
+
+/**
+ * @class SimulatedFlash
+ * @brief Heap- or file-backed flash with NOR semantics.
+ *
+ * Programming can only clear bits and fails on units that are not erased,
+ * like the internal flash of the STM32 with ECC. Erase counts per sector and
+ * the accumulated busy time of the modelled device are recorded, so wear and
+ * on-node throughput can be estimated. With a path, the content is loaded on
+ * construction and written back on destruction, which allows testing recovery
+ * across simulated reboots.
+ */
+class SimulatedFlash : public FlashStorage {
+public:
+    /**
+     * @brief Constructs an erased flash.
+     * @param size Total size in bytes, a multiple of `erase_size`.
+     * @param program_size Program unit in bytes.
+     * @param erase_size Sector size in bytes.
+     * @param path Backing file, empty for a heap-only flash.
+     */
+    SimulatedFlash(uint32_t size, uint32_t program_size, uint32_t erase_size, const std::string& path = "");
+
+    /// Writes the content back to the backing file, if any.
+    ~SimulatedFlash(void) override;
+
+    SimulatedFlash(const SimulatedFlash&) = delete;             ///< Deleted copy constructor.
+    SimulatedFlash& operator=(const SimulatedFlash&) = delete;  ///< Deleted assignment operator.
+
+    int read(void* buffer, uint32_t address, uint32_t size) override;
+    int program(const void* buffer, uint32_t address, uint32_t size) override;
+    int erase(uint32_t address, uint32_t size) override;
+    uint32_t programSize(void) const override { return m_program_size; }
+    uint32_t eraseSize(void) const override { return m_erase_size; }
+    uint32_t size(void) const override { return (uint32_t)m_data.size(); }
+
+    /// Modelled time the device spent programming and erasing, in microseconds.
+    uint64_t busyTimeUs(void) const { return m_busy_time_us; }
+
+    /// Number of erases of every sector.
+    const std::vector<uint32_t>& eraseCounts(void) const { return m_erase_counts; }
+
+private:
+    std::vector<uint8_t>  m_data;           ///< Flash content.
+    std::vector<uint32_t> m_erase_counts;   ///< Erases per sector.
+    uint32_t              m_program_size;   ///< Program unit.
+    uint32_t              m_erase_size;     ///< Sector size.
+    std::string           m_path;           ///< Backing file, empty if none.
+    uint64_t              m_busy_time_us;   ///< Modelled busy time.
+};
+
+#endif // SIMULATED_FLASH_H
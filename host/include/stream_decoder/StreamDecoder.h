@@ -0,0 +1,202 @@
+#ifndef STREAM_DECODER_H
+#define STREAM_DECODER_H
+
+/**
+ * @file StreamDecoder.h
+ * @brief Streaming decoder for the serial mail protocol sent by the PhytoNode.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "adc/SampleVector.h"
+#include "pipeline/LatencyHistogram.h"
+#include "serial_mail_sender/FrameFormat.h"
+#include "serial_mail_sender/LatencyFrameBuilder.h"
+#include "serial_mail_sender/MessageFrameBuilder.h"
+#include "serial_mail_sender/SerialMailGenerated.h"
+#include "timing/ClockSync.h"
+
+/**
+ * @struct DecodedFrame
+ * @brief View of a single verified frame, `SerialMail` FlatBuffer, raw or band power.
+ *
+ * Raw frames keep their samples in the byte order of `SerialMail::Value`, so
+ * the channel spans look the same for both payloads. Band power frames have
+ * no samples; their powers are converted into the decoder's own storage.
+ *
+ * The other spans point into the buffer handed to `StreamDecoder::feed` (or
+ * into the decoder's carry-over buffer for frames split across chunks). All
+ * spans are only valid for the duration of the frame handler call.
+ */
+struct DecodedFrame {
+    int32_t node;                               ///< Node identifier stamped by the sender.
+    std::span<const SerialMail::Value> ch0;     ///< Raw 24-bit samples of channel 0.
+    std::span<const SerialMail::Value> ch1;     ///< Raw 24-bit samples of channel 1.
+    std::span<const uint8_t> payload;           ///< Complete FlatBuffer or raw payload of the frame.
+    std::span<const uint8_t> frame;             ///< Header followed by the payload, as received.
+    uint8_t version;                            ///< Raw or band frame version, 0 for FlatBuffers.
+    uint32_t sequence;                          ///< Sequence number of a raw frame, window of a band frame.
+    std::span<const float> bands;               ///< Band powers in mV^2, channel 0 first, empty for sample frames.
+    uint16_t band_count;                        ///< Bands per channel of a band power frame.
+    uint8_t device;                             ///< AD7124 of the node the samples come from.
+    uint64_t time_us;                           ///< Host time of the last sample of a timed raw frame, else 0.
+};
+
+/**
+ * @brief Assembles the big-endian 3-byte sample into the raw 24-bit ADC code.
+ * @param value Sample as serialized by the node.
+ * @return Raw ADC code in the range [0, 2^24).
+ */
+inline uint32_t raw_code(const SerialMail::Value& value) {
+    return ((uint32_t)value.data_0() << 16) | ((uint32_t)value.data_1() << 8) | (uint32_t)value.data_2();
+}
+
+/**
+ * @brief Converts a received sample back into the node's sign-corrected representation.
+ * @param value Sample as serialized by the node.
+ * @return Sample as held in a `SampleVector`.
+ */
+inline int32_t node_sample(const SerialMail::Value& value) {
+    return (int32_t)raw_code(value) - SAMPLE_ZERO_CODE;
+}
+
+/**
+ * @struct DecoderStats
+ * @brief Counters collected by the `StreamDecoder` since construction or the last reset.
+ */
+struct DecoderStats {
+    uint64_t bytes;             ///< Bytes fed into the decoder.
+    uint64_t frames;            ///< Frames that passed verification.
+    uint64_t samples;           ///< Samples delivered over both channels.
+    uint64_t skipped_bytes;     ///< Bytes discarded while searching for a sync marker or after a loss.
+    uint64_t rejected_frames;   ///< Candidate frames dropped due to a bad length or failed verification.
+    uint64_t raw_frames;        ///< Frames of `frames` that were raw frames.
+    uint64_t missed_frames;     ///< Raw frames missing according to the sequence numbers.
+    uint64_t band_frames;       ///< Frames of `frames` that were band power frames.
+    uint64_t sync_responses;    ///< Sync responses (`CLOCK_SYNC`), not counted in `frames`.
+    uint64_t latency_frames;    ///< Latency frames (`LATENCY_STATS`), not counted in `frames`.
+    uint64_t message_frames;    ///< Message frames (`TX_SCHEDULER`), not counted in `frames`.
+    uint64_t lost_messages;     ///< Messages dropped because a chunk was missing.
+};
+
+/**
+ * @class StreamDecoder
+ * @brief Zero-copy, resynchronizing parser for `0xAAAA` + size + payload frames.
+ *
+ * Payloads are `SerialMail` FlatBuffers or raw frames (`RAW_FRAMES` firmware),
+ * told apart by their first byte, so one stream may even mix both. Sync
+ * responses (`CLOCK_SYNC` firmware) go to the sync handler instead of the
+ * frame handler. Latency frames (`LATENCY_STATS` firmware) are collected until
+ * all buckets of a report arrived, which then goes to the latency handler.
+ * Likewise the chunks of a message (`TX_SCHEDULER` firmware) are collected
+ * and the complete message goes to the message handler.
+ *
+ * The decoder accepts the byte stream in arbitrarily sized chunks. Frames that
+ * lie completely inside a chunk are verified and delivered in place; only the
+ * bytes of a frame that straddles two chunks are copied into a small carry-over
+ * buffer. After a corrupted length field or a failed FlatBuffer verification the
+ * decoder resumes the search one byte after the rejected sync marker, so a valid
+ * frame hidden behind garbage is never lost.
+ */
+class StreamDecoder {
+public:
+    /// Callback invoked for every verified frame.
+    using FrameHandler = std::function<void(const DecodedFrame&)>;
+
+    /// Callback invoked for every sync response.
+    using SyncHandler = std::function<void(const SyncResponse&)>;
+
+    /// Callback invoked for every complete latency report.
+    using LatencyHandler = std::function<void(const LatencyReport&, const LatencySnapshot&)>;
+
+    /// Callback invoked for every complete message; the bytes are valid during the call only.
+    using MessageHandler = std::function<void(const MessageHeader&, std::span<const uint8_t>)>;
+
+    /**
+     * @brief Constructs a decoder.
+     * @param handler Callback invoked for every verified frame.
+     * @param max_payload_size Largest FlatBuffer accepted before a length field is treated as corrupted.
+     */
+    explicit StreamDecoder(FrameHandler handler, uint32_t max_payload_size = SERIAL_MAIL_MAX_PAYLOAD_SIZE);
+
+    /**
+     * @brief Feeds the next chunk of the byte stream into the decoder.
+     * @param chunk Bytes received from the link or read from a capture.
+     */
+    void feed(std::span<const uint8_t> chunk);
+
+    /**
+     * @brief Sets the receiver of sync responses, which are dropped otherwise.
+     */
+    void setSyncHandler(SyncHandler handler) { m_sync_handler = std::move(handler); }
+
+    /**
+     * @brief Sets the receiver of latency reports, which are dropped otherwise.
+     */
+    void setLatencyHandler(LatencyHandler handler) { m_latency_handler = std::move(handler); }
+
+    /**
+     * @brief Sets the receiver of messages, which are dropped otherwise.
+     */
+    void setMessageHandler(MessageHandler handler) { m_message_handler = std::move(handler); }
+
+    /**
+     * @brief Drops any partially received frame and clears the statistics.
+     */
+    void reset(void);
+
+    /**
+     * @brief Drops the partially received frame but keeps the statistics.
+     *
+     * Called when the transport reports lost bytes, so the carry-over is not
+     * completed with bytes of a later frame. The dropped bytes count as skipped.
+     */
+    void discardPending(void);
+
+    /**
+     * @brief Returns the counters collected so far.
+     * @return Reference to the decoder statistics.
+     */
+    const DecoderStats& stats(void) const { return m_stats; }
+
+private:
+    /**
+     * @struct OpenMessage
+     * @brief Message whose chunks are being collected.
+     */
+    struct OpenMessage {
+        MessageHeader        header;    ///< Fields of the message.
+        std::vector<uint8_t> data;      ///< Chunks received so far.
+        bool                 open;      ///< The message is being collected.
+    };
+
+    FrameHandler         m_handler;             ///< Receiver of decoded frames.
+    SyncHandler          m_sync_handler;        ///< Receiver of sync responses.
+    LatencyHandler       m_latency_handler;     ///< Receiver of latency reports.
+    MessageHandler       m_message_handler;     ///< Receiver of messages.
+    uint32_t             m_max_payload_size;    ///< Upper bound for the length field.
+    std::vector<uint8_t> m_pending;             ///< Carry-over bytes of a frame split across chunks.
+    DecoderStats         m_stats;               ///< Decoder counters.
+    uint32_t             m_next_sequence;       ///< Expected sequence number of the next raw frame.
+    bool                 m_sequence_known;      ///< False until the first raw frame.
+    std::vector<float>   m_bands;               ///< Powers of the band frame being delivered.
+    LatencySnapshot      m_latency;             ///< Latency report being collected.
+    size_t               m_latency_next;        ///< First bucket the next latency frame must start at.
+    std::unordered_map<uint8_t, OpenMessage> m_messages; ///< Open message per message kind.
+
+    size_t scan(std::span<const uint8_t> data);
+    size_t bytesNeededForPending(void) const;
+    bool deliver(std::span<const uint8_t> frame);
+    bool deliverRaw(std::span<const uint8_t> frame);
+    bool deliverBands(std::span<const uint8_t> frame);
+    bool deliverSync(std::span<const uint8_t> frame);
+    bool deliverLatency(std::span<const uint8_t> frame);
+    bool deliverMessage(std::span<const uint8_t> frame);
+};
+
+#endif // STREAM_DECODER_H
@@ -0,0 +1,47 @@
+#ifndef BLE_REASSEMBLER_H
+#define BLE_REASSEMBLER_H
+
+/**
+ * @file BleReassembler.h
+ * @brief Restores the frame stream from the node's BLE notifications.
+ */
+
+#include <cstdint>
+#include <span>
+
+#include "stream_decoder/StreamDecoder.h"
+
+/**
+ * @class BleReassembler
+ * @brief Strips the sequence byte of each notification and feeds the stream decoder.
+ *
+ * Notifications produced by the node's `BlePacker` carry a rolling sequence
+ * byte followed by a slice of the frame stream. A gap in the sequence means
+ * bytes were lost; the reassembler then discards the decoder's partial frame,
+ * and the decoder resynchronizes on the next `0xAAAA` marker.
+ */
+class BleReassembler {
+public:
+    /**
+     * @brief Constructs a reassembler.
+     * @param decoder Decoder that receives the restored byte stream.
+     */
+    explicit BleReassembler(StreamDecoder& decoder);
+
+    /**
+     * @brief Processes one notification value.
+     * @param notification Value received from the frame characteristic.
+     */
+    void feed(std::span<const uint8_t> notification);
+
+    /// Number of notifications detected as lost.
+    uint64_t lostNotifications(void) const { return m_lost_notifications; }
+
+private:
+    StreamDecoder& m_decoder;               ///< Receiver of the frame stream.
+    uint8_t        m_next_sequence;         ///< Expected sequence number.
+    bool           m_synchronized;          ///< False until the first notification arrived.
+    uint64_t       m_lost_notifications;    ///< Notifications missing in the sequence.
+};
+
+#endif // BLE_REASSEMBLER_H
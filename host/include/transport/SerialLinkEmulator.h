@@ -0,0 +1,187 @@
+#ifndef SERIAL_LINK_EMULATOR_H
+#define SERIAL_LINK_EMULATOR_H
+
+/**
+ * @file SerialLinkEmulator.h
+ * @brief UART between a node and the Raspberry Pi, emulated over two pseudo-terminals.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <random>
+#include <string>
+
+/// Bits on the wire per byte in 8N1: start bit, 8 data bits, stop bit.
+#define LINK_BITS_PER_BYTE 10
+
+/// Bytes read from or written to a pseudo-terminal per system call at most.
+#define LINK_CHUNK_SIZE 256
+
+/**
+ * @struct LinkImpairments
+ * @brief Faults injected into one direction of the link.
+ *
+ * Bursts start at random with `burst_rate_hz` and last `burst_ms` on
+ * average, both exponentially distributed; while one lasts, bits flip with
+ * `burst_bit_error_rate` instead of `bit_error_rate`. Latency applies after
+ * a byte left the wire and never reorders bytes.
+ */
+struct LinkImpairments {
+    double bit_error_rate;          ///< Probability that a bit flips outside a burst.
+    double drop_rate;               ///< Probability that a byte is lost, e.g. to a framing error.
+    double burst_rate_hz;           ///< Mean bursts per second, 0 for none.
+    double burst_ms;                ///< Mean length of a burst.
+    double burst_bit_error_rate;    ///< Probability that a bit flips during a burst.
+    double latency_ms;              ///< Delay added to every byte.
+    double jitter_ms;               ///< Uniformly distributed extra delay, at most this much.
+};
+
+/**
+ * @struct LinkOptions
+ * @brief Rate, buffers and faults of the emulated link.
+ */
+struct LinkOptions {
+    int             baudrate;       ///< Bits per second, `LINK_BITS_PER_BYTE` per byte.
+    size_t          tx_buffer;      ///< Bytes the sending UART holds before the sender is held back.
+    size_t          rx_buffer;      ///< Bytes held for a receiver that does not read before bytes are lost.
+    LinkImpairments node_to_host;   ///< Faults of the direction the frames take.
+    LinkImpairments host_to_node;   ///< Faults of the direction of e.g. sync requests.
+    uint64_t        seed;           ///< Seed of all random faults.
+};
+
+/**
+ * @struct LinkStats
+ * @brief What happened to the bytes of one direction.
+ *
+ * Bytes taken and not yet counted otherwise were still on their way when the
+ * emulator stopped.
+ */
+struct LinkStats {
+    uint64_t bytes_in;              ///< Bytes taken from the sender.
+    uint64_t bytes_out;             ///< Bytes handed to the receiver.
+    uint64_t dropped;               ///< Bytes lost by `drop_rate`.
+    uint64_t corrupted;             ///< Bytes that left the wire with at least one flipped bit.
+    uint64_t bit_errors;            ///< Bits flipped.
+    uint64_t overruns;              ///< Bytes lost because the receiver's buffer was full.
+    uint64_t bursts;                ///< Bursts started.
+};
+
+/**
+ * @class SerialLinkEmulator
+ * @brief Forwards bytes between two pseudo-terminals like a UART would.
+ *
+ * The node side (`nodePath`) is opened by a sender such as the host build of
+ * the node's sink, the host side (`hostPath`) by any decoder, e.g.
+ * `phyto_decode`. Both slaves are in raw mode, so `open_serial_port` works on
+ * them as on `/dev/ttyAMA0`.
+ *
+ * Per direction, a byte is read from the sender only while fewer than
+ * `tx_buffer` bytes wait for the wire, which then carries one byte per
+ * `LINK_BITS_PER_BYTE / baudrate`. On the wire the impairments apply. The
+ * received bytes wait in a buffer of `rx_buffer` bytes until the receiver's
+ * pseudo-terminal takes them; a byte arriving at a full buffer is lost, as in
+ * a UART overrun. The kernel buffers of the pseudo-terminals come on top of
+ * both buffers, which makes the emulated link more forgiving than the real
+ * one towards a receiver that stops reading.
+ *
+ * The emulator keeps a slave of both pseudo-terminals open itself, so the
+ * sender and the receiver may close and reopen theirs.
+ */
+class SerialLinkEmulator {
+public:
+    /**
+     * @brief Creates the pseudo-terminals.
+     * @param options Rate, buffers and faults of the link.
+     * @throws std::runtime_error if a pseudo-terminal cannot be created or the options are invalid.
+     */
+    explicit SerialLinkEmulator(const LinkOptions& options);
+
+    /**
+     * @brief Closes the pseudo-terminals.
+     */
+    ~SerialLinkEmulator(void);
+
+    SerialLinkEmulator(const SerialLinkEmulator&) = delete;             ///< Deleted copy constructor.
+    SerialLinkEmulator& operator=(const SerialLinkEmulator&) = delete;  ///< Deleted assignment operator.
+
+    /// Slave device the node side opens.
+    const std::string& nodePath(void) const { return m_node.path; }
+
+    /// Slave device the host side opens.
+    const std::string& hostPath(void) const { return m_host.path; }
+
+    /**
+     * @brief Forwards bytes in both directions until the time is up or `stop` is set.
+     * @param duration_s Time to run for, 0 to run until `stop`.
+     * @param stop Flag checked at least once per millisecond.
+     */
+    void run(double duration_s, const std::atomic<bool>& stop);
+
+    /// Counters of the direction the frames take; read after `run` returned.
+    const LinkStats& nodeToHost(void) const { return m_downlink.stats; }
+
+    /// Counters of the opposite direction; read after `run` returned.
+    const LinkStats& hostToNode(void) const { return m_uplink.stats; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @struct Pty
+     * @brief One pseudo-terminal.
+     */
+    struct Pty {
+        int         master;         ///< Side the emulator reads and writes.
+        int         slave;          ///< Slave kept open by the emulator.
+        std::string path;           ///< Slave device for the sender or receiver.
+    };
+
+    /**
+     * @struct WireByte
+     * @brief Byte that left the sending UART.
+     */
+    struct WireByte {
+        Clock::time_point arrival;  ///< Time the byte reaches the receiver.
+        uint8_t           value;    ///< Byte after the impairments.
+    };
+
+    /**
+     * @struct Direction
+     * @brief State of one direction of the link.
+     */
+    struct Direction {
+        Pty*                 from;          ///< Pseudo-terminal of the sender.
+        Pty*                 to;            ///< Pseudo-terminal of the receiver.
+        LinkImpairments      faults;        ///< Faults of this direction.
+        Clock::time_point    line_free;     ///< Time the last byte taken has left the sending UART.
+        Clock::time_point    last_arrival;  ///< Arrival of the last byte on the wire, keeps the order.
+        Clock::time_point    burst_start;   ///< Start of the next or current burst.
+        Clock::time_point    burst_end;     ///< End of the current burst.
+        bool                 burst_counted; ///< The current burst hit a byte and was counted.
+        std::deque<WireByte> wire;          ///< Bytes taken and not yet arrived.
+        std::deque<uint8_t>  received;      ///< Arrived bytes the receiver has not taken yet.
+        LinkStats            stats;         ///< Counters.
+    };
+
+    LinkOptions        m_options;
+    Clock::duration    m_byte_time;         ///< Time a byte occupies the wire.
+    std::mt19937_64    m_random;            ///< Source of all faults.
+    Pty                m_node;              ///< Pseudo-terminal of the node side.
+    Pty                m_host;              ///< Pseudo-terminal of the host side.
+    Direction          m_downlink;          ///< Node to host.
+    Direction          m_uplink;            ///< Host to node.
+
+    void openPty(Pty& pty);
+    void closePty(Pty& pty);
+    size_t txBacklog(const Direction& direction, Clock::time_point now) const;
+    void take(Direction& direction, Clock::time_point now);
+    void transmit(Direction& direction, uint8_t value, Clock::time_point now);
+    double bitErrorRate(Direction& direction, Clock::time_point at);
+    void deliver(Direction& direction, Clock::time_point now);
+    Clock::duration randomDuration(double mean_ms);
+};
+
+#endif // SERIAL_LINK_EMULATOR_H
@@ -0,0 +1,85 @@
+#ifndef LINE_BUFFER_H
+#define LINE_BUFFER_H
+
+/**
+ * @file LineBuffer.h
+ * @brief Fixed-size buffer for text lines formatted with `std::to_chars`.
+ */
+
+#include <charconv>
+#include <cstddef>
+#include <limits>
+#include <system_error>
+#include <type_traits>
+
+/// Longest text `std::to_chars` writes for an integer of type `T`, sign included.
+template <typename T>
+constexpr size_t integer_chars_max(void) {
+    return std::numeric_limits<T>::digits10 + 1 + (std::is_signed_v<T> ? 1 : 0);
+}
+
+/// Longest text `std::to_chars` writes for a `T` in fixed notation with `decimals` digits after the point.
+template <typename T>
+constexpr size_t fixed_chars_max(size_t decimals) {
+    return 1 + (std::numeric_limits<T>::max_exponent10 + 1) + 1 + decimals;
+}
+
+/**
+ * @class LineBuffer
+ * @brief Appends numbers and separators to a line of at most `N` characters.
+ * @tparam N Capacity, e.g. the sum of the `integer_chars_max` of the fields.
+ *
+ * Every append is checked: a value or separator that does not fit is not
+ * written and marks the line as overflowed, so a line is either complete or
+ * reported as such, and nothing is written past the buffer.
+ */
+template <size_t N>
+class LineBuffer {
+public:
+    LineBuffer(void) : m_size(0), m_overflow(false) {}
+
+    /**
+     * @brief Appends a number with `std::to_chars`.
+     * @param args Value and optional format arguments of `std::to_chars`.
+     */
+    template <typename... Args>
+    LineBuffer& number(Args... args) {
+        if (!m_overflow) {
+            std::to_chars_result result = std::to_chars(m_data + m_size, m_data + N, args...);
+            if (result.ec == std::errc()) {
+                m_size = result.ptr - m_data;
+            } else {
+                m_overflow = true;
+            }
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Appends a single character, e.g. a separator.
+     */
+    LineBuffer& put(char c) {
+        if (!m_overflow && m_size < N) {
+            m_data[m_size++] = c;
+        } else {
+            m_overflow = true;
+        }
+        return *this;
+    }
+
+    /// True if an append did not fit.
+    bool overflow(void) const { return m_overflow; }
+
+    /// Characters of the line.
+    const char* data(void) const { return m_data; }
+
+    /// Number of characters written.
+    size_t size(void) const { return m_size; }
+
+private:
+    char   m_data[N];       ///< Characters of the line.
+    size_t m_size;          ///< Characters written.
+    bool   m_overflow;      ///< An append did not fit.
+};
+
+#endif // LINE_BUFFER_H
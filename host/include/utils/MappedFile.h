@@ -0,0 +1,49 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+/**
+ * @file MappedFile.h
+ * @brief Read-only memory mapping of capture files for the host tools.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+/**
+ * @class MappedFile
+ * @brief RAII wrapper around a read-only `mmap` of a whole file.
+ *
+ * Large capture files are decoded straight from the page cache without being
+ * copied into user space buffers.
+ */
+class MappedFile {
+public:
+    /**
+     * @brief Maps the given file into memory.
+     * @param path Path of the file to map.
+     * @throws std::runtime_error if the file cannot be opened or mapped.
+     */
+    explicit MappedFile(const std::string& path);
+
+    /**
+     * @brief Unmaps the file.
+     */
+    ~MappedFile(void);
+
+    MappedFile(const MappedFile&) = delete;             ///< Deleted copy constructor.
+    MappedFile& operator=(const MappedFile&) = delete;  ///< Deleted assignment operator.
+
+    /**
+     * @brief Returns the mapped bytes.
+     * @return Span over the complete file content.
+     */
+    std::span<const uint8_t> bytes(void) const { return {m_data, m_size}; }
+
+private:
+    const uint8_t* m_data;  ///< Start of the mapping, null for empty files.
+    size_t         m_size;  ///< Size of the mapping in bytes.
+};
+
+#endif // MAPPED_FILE_H
@@ -0,0 +1,28 @@
+#ifndef SERIAL_PORT_H
+#define SERIAL_PORT_H
+
+/**
+ * @file SerialPort.h
+ * @brief Helpers for opening the node's UART on the Raspberry Pi.
+ */
+
+#include <string>
+
+/**
+ * @brief Opens a serial device in raw 8N1 mode.
+ * @param device Path of the serial device (e.g. `/dev/ttyAMA0`).
+ * @param baudrate Baud rate, must match `UART_BAUDRATE` in `UartTransport.h`.
+ * @param writable Also open for writing, e.g. to send sync requests (`CLOCK_SYNC`).
+ * @return File descriptor of the opened device.
+ * @throws std::runtime_error if the device cannot be opened or configured.
+ */
+int open_serial_port(const std::string& device, int baudrate, bool writable = false);
+
+/**
+ * @brief Checks whether a path refers to a character device such as a tty.
+ * @param path Path to check.
+ * @return True for character devices, false for regular files and errors.
+ */
+bool is_character_device(const std::string& path);
+
+#endif // SERIAL_PORT_H
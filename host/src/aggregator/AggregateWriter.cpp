@@ -0,0 +1,59 @@
+/**
+ * @file AggregateWriter.cpp
+ * @brief Implementation of the AggregateWriter class.
+ */
+
+#include "aggregator/AggregateWriter.h"
+
+#include <algorithm>
+
+#include "utils/LineBuffer.h"
+
+static_assert(sizeof(AggregateRecord) == 32, "AggregateRecord must stay packed to 32 bytes");
+
+/// Longest CSV line: time, node, device, sequence, source, index, both codes, separators and newline.
+static constexpr size_t CSV_LINE_SIZE = integer_chars_max<uint64_t>() + integer_chars_max<int32_t>() +
+                                        integer_chars_max<uint8_t>() + integer_chars_max<uint32_t>() +
+                                        integer_chars_max<unsigned int>() + integer_chars_max<size_t>() +
+                                        2 * integer_chars_max<uint32_t>() + 8;
+
+AggregateWriter::AggregateWriter(FILE* out, bool binary) : m_out(out), m_binary(binary), m_samples(0) {
+    if (!m_binary) {
+        fputs("time_us,node,device,sequence,source,index,ch0,ch1\n", m_out);
+    }
+}
+
+void AggregateWriter::write(const MergedFrame& merged) {
+    const DecodedFrame& frame = merged.frame;
+    uint64_t time_us = frame.time_us != 0 ? frame.time_us : merged.time_us;
+    size_t count = std::max(frame.ch0.size(), frame.ch1.size());
+    m_samples += frame.ch0.size() + frame.ch1.size();
+
+    for (size_t i = 0; i < count; i++) {
+        bool has_ch0 = i < frame.ch0.size();
+        bool has_ch1 = i < frame.ch1.size();
+        if (m_binary) {
+            AggregateRecord record{time_us, frame.node, merged.sequence,
+                has_ch0 ? raw_code(frame.ch0[i]) : UINT32_MAX,
+                has_ch1 ? raw_code(frame.ch1[i]) : UINT32_MAX,
+                (uint16_t)i, (uint16_t)merged.source, frame.device, {0, 0, 0}};
+            fwrite(&record, sizeof(record), 1, m_out);
+            continue;
+        }
+
+        LineBuffer<CSV_LINE_SIZE> line;
+        line.number(time_us).put(',').number(frame.node).put(',').number(frame.device).put(',');
+        line.number(merged.sequence).put(',').number(merged.source).put(',').number(i).put(',');
+        if (has_ch0) {
+            line.number(raw_code(frame.ch0[i]));
+        }
+        line.put(',');
+        if (has_ch1) {
+            line.number(raw_code(frame.ch1[i]));
+        }
+        line.put('\n');
+        if (!line.overflow()) {
+            fwrite(line.data(), 1, line.size(), m_out);
+        }
+    }
+}
@@ -0,0 +1,130 @@
+/**
+ * @file FrameMerger.cpp
+ * @brief Implementation of the FrameMerger class.
+ */
+
+#include "aggregator/FrameMerger.h"
+
+#include <algorithm>
+
+#include "serial_mail_sender/FrameFormat.h"
+
+/**
+ * @brief Distance from `from` to `to` in a wrapping 32-bit sequence.
+ * @return Positive if `to` comes after `from`.
+ */
+static int32_t sequence_distance(uint32_t from, uint32_t to) {
+    return (int32_t)(to - from);
+}
+
+FrameMerger::FrameMerger(Output output, size_t window, uint64_t max_hold_us)
+    : m_output(std::move(output)), m_window(window), m_max_hold_us(max_hold_us), m_stats{0, 0, 0, 0, 0} {}
+
+/**
+ * @details
+ * The first frame of a node sets where its stream starts; a frame older than
+ * the one sent last is a duplicate or came too late and is dropped.
+ */
+void FrameMerger::push(const DecodedFrame& frame, uint64_t time_us, unsigned int source) {
+    auto [it, inserted] = m_nodes.try_emplace(frame.node, NodeStream{false, 0, {}});
+    NodeStream& stream = it->second;
+    if (inserted) {
+        m_stats.nodes++;
+    }
+
+    if (frame.version != RAW_FRAME_VERSION && frame.version != RAW_FRAME_TIMED_VERSION) {
+        send(frame, stream.next++, time_us, source);
+        return;
+    }
+    if (!stream.started) {
+        stream.started = true;
+        stream.next = frame.sequence;
+    }
+
+    int32_t distance = sequence_distance(stream.next, frame.sequence);
+    if (distance < 0 || (distance > 0 && stream.held.count(frame.sequence) != 0)) {
+        m_stats.duplicates++;
+        return;
+    }
+    if (distance == 0) {
+        send(frame, stream.next++, time_us, source);
+        drain(stream);
+        return;
+    }
+
+    m_stats.reordered++;
+    stream.held.emplace(frame.sequence,
+        HeldFrame{frame.node, frame.device, frame.version, time_us, frame.time_us, source,
+                  {frame.ch0.begin(), frame.ch0.end()}, {frame.ch1.begin(), frame.ch1.end()},
+                  {frame.frame.begin(), frame.frame.end()}});
+    while (stream.held.size() > m_window) {
+        skipGap(stream);
+    }
+}
+
+void FrameMerger::expire(uint64_t now_us) {
+    for (auto& [node, stream] : m_nodes) {
+        while (!stream.held.empty()) {
+            // The frame held longest is the first one behind the gap at the latest
+            uint64_t oldest_us = UINT64_MAX;
+            for (const auto& [sequence, held] : stream.held) {
+                oldest_us = std::min(oldest_us, held.time_us);
+            }
+            if (now_us - oldest_us < m_max_hold_us) {
+                break;
+            }
+            skipGap(stream);
+        }
+    }
+}
+
+void FrameMerger::flush(void) {
+    for (auto& [node, stream] : m_nodes) {
+        while (!stream.held.empty()) {
+            skipGap(stream);
+        }
+    }
+}
+
+void FrameMerger::send(const DecodedFrame& frame, uint32_t sequence, uint64_t time_us, unsigned int source) {
+    m_stats.frames++;
+    m_output(MergedFrame{frame, sequence, time_us, source});
+}
+
+void FrameMerger::sendHeld(const HeldFrame& held, uint32_t sequence) {
+    DecodedFrame frame{held.node, held.ch0, held.ch1, {}, held.frame, held.version, sequence, {}, 0, held.device,
+                       held.frame_time_us};
+    if (held.frame.size() > SERIAL_MAIL_HEADER_SIZE) {
+        frame.payload = std::span<const uint8_t>(held.frame).subspan(SERIAL_MAIL_HEADER_SIZE);
+    }
+    send(frame, sequence, held.time_us, held.source);
+}
+
+/**
+ * @brief Sends the held frames that directly follow the frame sent last.
+ */
+void FrameMerger::drain(NodeStream& stream) {
+    auto it = stream.held.find(stream.next);
+    while (it != stream.held.end()) {
+        sendHeld(it->second, stream.next);
+        stream.held.erase(it);
+        stream.next++;
+        it = stream.held.find(stream.next);
+    }
+}
+
+/**
+ * @brief Gives up on the gap before the first held frame and sends what follows it.
+ */
+void FrameMerger::skipGap(NodeStream& stream) {
+    // Held frames are sorted by sequence number, but the map order breaks at a wrap-around
+    auto first = stream.held.begin();
+    for (auto it = stream.held.begin(); it != stream.held.end(); ++it) {
+        if (sequence_distance(stream.next, it->first) < sequence_distance(stream.next, first->first)) {
+            first = it;
+        }
+    }
+    m_stats.lost += (uint32_t)sequence_distance(stream.next, first->first);
+    stream.next = first->first;
+    drain(stream);
+}
@@ -0,0 +1,239 @@
+/**
+ * @file NodeAggregator.cpp
+ * @brief Implementation of the NodeAggregator class.
+ */
+
+#include "aggregator/NodeAggregator.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <thread>
+#include <unistd.h>
+
+#include "utils/SerialPort.h"
+
+NodeAggregator::NodeAggregator(FrameMerger::Output output, size_t window, uint64_t max_hold_us)
+    : m_merger(std::move(output), window, max_hold_us), m_sync_interval_us(0) {}
+
+NodeAggregator::~NodeAggregator(void) {
+    for (std::unique_ptr<Source>& source : m_sources) {
+        close(*source);
+    }
+}
+
+uint64_t NodeAggregator::nowUs(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000;
+}
+
+/**
+ * @details
+ * Serial ports are switched to non-blocking mode, so a spurious wake-up of
+ * the event loop never blocks the other inputs. Band power frames carry no
+ * samples and are not passed on. Sync responses are stamped with the receive
+ * time of the chunk they were decoded from.
+ */
+void NodeAggregator::addSource(const std::string& path, int baudrate) {
+    std::unique_ptr<Source> source(new Source{(unsigned int)m_sources.size(), path, -1, nullptr, 0, nullptr, 0, nullptr, true, {}});
+    if (is_character_device(path)) {
+        source->fd = open_serial_port(path, baudrate, m_sync_interval_us > 0);
+        if (m_sync_interval_us > 0) {
+            source->sync = std::make_unique<SyncMaster>(m_sync_interval_us);
+        }
+        int flags = fcntl(source->fd, F_GETFL);
+        fcntl(source->fd, F_SETFL, flags | O_NONBLOCK);
+    } else {
+        source->file = std::make_unique<MappedFile>(path);
+    }
+
+    Source* raw = source.get();
+    source->decoder = std::make_unique<StreamDecoder>([this, raw](const DecodedFrame& frame) {
+        if (frame.version == BAND_FRAME_VERSION) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(m_merger_mutex);
+        m_merger.push(frame, raw->time_us, raw->index);
+    });
+    if (source->sync) {
+        source->decoder->setSyncHandler([raw](const SyncResponse& response) {
+            raw->sync->onResponse(response, raw->time_us);
+        });
+    }
+    m_sources.push_back(std::move(source));
+}
+
+/**
+ * @details
+ * The inputs are dealt to the loops round robin. At the end all frames still
+ * held by the merger are sent.
+ */
+void NodeAggregator::run(unsigned int workers, const std::atomic<bool>& stop) {
+    if (workers < 1) {
+        workers = 1;
+    }
+    std::vector<std::vector<Source*>> shards(workers);
+    for (size_t i = 0; i < m_sources.size(); i++) {
+        shards[i % workers].push_back(m_sources[i].get());
+    }
+    std::vector<int> epoll_fds;
+    for (unsigned int i = 0; i < workers; i++) {
+        int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd < 0) {
+            int err = errno;
+            for (int fd : epoll_fds) {
+                ::close(fd);
+            }
+            throw std::runtime_error(std::string("cannot create epoll instance: ") + strerror(err));
+        }
+        epoll_fds.push_back(epoll_fd);
+    }
+
+    if (workers == 1) {
+        loop(epoll_fds[0], shards[0], stop);
+    } else {
+        std::vector<std::thread> threads;
+        for (unsigned int i = 0; i < workers; i++) {
+            threads.emplace_back([this, &epoll_fds, &shards, &stop, i] { loop(epoll_fds[i], shards[i], stop); });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_merger_mutex);
+    m_merger.flush();
+}
+
+/**
+ * @details
+ * Level-triggered epoll with one read per ready port and wait keeps every
+ * port's share of the loop equal, however fast a single node sends. While
+ * capture files remain, the wait does not block and each file is fed one
+ * chunk per turn. Held frames are checked for expiry once per
+ * `AGGREGATOR_POLL_TIMEOUT_MS`, which is also the resolution of the sync
+ * request schedule. The loop closes `epoll_fd` when it returns.
+ */
+void NodeAggregator::loop(int epoll_fd, const std::vector<Source*>& sources, const std::atomic<bool>& stop) {
+    size_t open_ports = 0;
+    std::vector<Source*> files;
+    for (Source* source : sources) {
+        if (source->fd >= 0) {
+            struct epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.ptr = source;
+            if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, source->fd, &event) == 0) {
+                open_ports++;
+            }
+        } else if (source->open) {
+            files.push_back(source);
+        }
+    }
+
+    struct epoll_event events[64];
+    uint64_t next_expire_us = 0;
+    while (!stop.load(std::memory_order_relaxed) && (open_ports > 0 || !files.empty())) {
+        int ready = epoll_wait(epoll_fd, events, 64, files.empty() ? AGGREGATOR_POLL_TIMEOUT_MS : 0);
+        if (ready < 0 && errno != EINTR) {
+            break;
+        }
+        for (int i = 0; i < ready; i++) {
+            Source* source = static_cast<Source*>(events[i].data.ptr);
+            if (!readSerial(*source)) {
+                epoll_ctl(epoll_fd, EPOLL_CTL_DEL, source->fd, nullptr);
+                close(*source);
+                open_ports--;
+            }
+        }
+        for (size_t i = 0; i < files.size();) {
+            if (feedFile(*files[i])) {
+                i++;
+            } else {
+                close(*files[i]);
+                files.erase(files.begin() + i);
+            }
+        }
+
+        uint64_t now_us = nowUs();
+        for (Source* source : sources) {
+            if (source->sync && source->fd >= 0 && source->sync->due(now_us)) {
+                sendSyncRequest(*source);
+            }
+        }
+        if (now_us >= next_expire_us) {
+            std::lock_guard<std::mutex> lock(m_merger_mutex);
+            m_merger.expire(now_us);
+            next_expire_us = now_us + AGGREGATOR_POLL_TIMEOUT_MS * 1000;
+        }
+    }
+
+    ::close(epoll_fd);
+}
+
+/**
+ * @brief Reads what is waiting on a port and decodes it.
+ * @return False if the port was closed, e.g. by a hang-up of the other end.
+ */
+bool NodeAggregator::readSerial(Source& source) {
+    ssize_t count = read(source.fd, source.buffer, sizeof(source.buffer));
+    if (count > 0) {
+        source.time_us = nowUs();
+        source.decoder->feed({source.buffer, (size_t)count});
+        return true;
+    }
+    return count < 0 && (errno == EAGAIN || errno == EINTR);
+}
+
+/**
+ * @brief Writes the next sync request to a port.
+ *
+ * @details
+ * T1 is taken right before the write. A request that does not fit into the
+ * kernel's transmit buffer is not retried; the node counts the exchange as
+ * missed.
+ */
+void NodeAggregator::sendSyncRequest(Source& source) {
+    uint8_t request[SERIAL_MAIL_HEADER_SIZE + SYNC_REQUEST_SIZE];
+    size_t size = source.sync->makeRequest(nowUs(), request, sizeof(request));
+    [[maybe_unused]] ssize_t written = write(source.fd, request, size);
+}
+
+/**
+ * @brief Decodes the next chunk of a capture file.
+ * @return False once the whole file was decoded.
+ */
+bool NodeAggregator::feedFile(Source& source) {
+    std::span<const uint8_t> data = source.file->bytes();
+    size_t size = std::min((size_t)AGGREGATOR_FILE_CHUNK_SIZE, data.size() - source.file_offset);
+    source.time_us = nowUs();
+    source.decoder->feed(data.subspan(source.file_offset, size));
+    source.file_offset += size;
+    return source.file_offset < data.size();
+}
+
+void NodeAggregator::close(Source& source) {
+    if (source.fd >= 0) {
+        ::close(source.fd);
+        source.fd = -1;
+    }
+    source.open = false;
+}
+
+MergerStats NodeAggregator::mergerStats(void) {
+    std::lock_guard<std::mutex> lock(m_merger_mutex);
+    return m_merger.stats();
+}
+
+std::vector<SourceStats> NodeAggregator::sourceStats(void) {
+    std::vector<SourceStats> stats;
+    for (const std::unique_ptr<Source>& source : m_sources) {
+        stats.push_back(SourceStats{source->path, source->decoder->stats(), source->open, source->sync != nullptr,
+                                    source->sync ? source->sync->stats() : SyncStats{0, 0, 0, 0, 0, 0, false}});
+    }
+    return stats;
+}
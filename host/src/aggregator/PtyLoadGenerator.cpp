@@ -0,0 +1,176 @@
+/**
+ * @file PtyLoadGenerator.cpp
+ * @brief Implementation of the PtyLoadGenerator class.
+ */
+
+#include "aggregator/PtyLoadGenerator.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <random>
+#include <stdexcept>
+#include <termios.h>
+#include <thread>
+#include <unistd.h>
+
+#include "adc/SampleVector.h"
+#include "serial_mail_sender/FrameBuilder.h"
+#include "serial_mail_sender/RawFrameBuilder.h"
+#include "transport/FrameBuffer.h"
+
+/// Amplitude of the synthetic signal in ADC codes.
+#define LOAD_SIGNAL_AMPLITUDE 20000
+
+/// Frequency of the synthetic signal in cycles per sample.
+#define LOAD_SIGNAL_CYCLES_PER_SAMPLE 0.01
+
+/// Longest wait for a reader to make room in a pseudo-terminal before the stop flag is checked again.
+#define LOAD_WRITE_POLL_MS 100
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * @details
+ * The line discipline of a new pseudo-terminal would translate carriage
+ * returns and echo, so it is switched to raw mode on the master side before
+ * any reader opens the slave.
+ */
+PtyLoadGenerator::PtyLoadGenerator(unsigned int nodes, const LoadOptions& options) : m_options(options) {
+    for (unsigned int i = 0; i < nodes; i++) {
+        int fd = posix_openpt(O_RDWR | O_NOCTTY);
+        if (fd < 0 || grantpt(fd) != 0 || unlockpt(fd) != 0) {
+            int err = errno;
+            if (fd >= 0) {
+                ::close(fd);
+            }
+            close();
+            throw std::runtime_error(std::string("cannot create pseudo-terminal: ") + strerror(err));
+        }
+
+        struct termios tty;
+        if (tcgetattr(fd, &tty) == 0) {
+            cfmakeraw(&tty);
+            tcsetattr(fd, TCSANOW, &tty);
+        }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+        m_masters.push_back(fd);
+        m_paths.push_back(ptsname(fd));
+    }
+}
+
+PtyLoadGenerator::~PtyLoadGenerator(void) {
+    close();
+}
+
+void PtyLoadGenerator::close(void) {
+    for (int fd : m_masters) {
+        ::close(fd);
+    }
+    m_masters.clear();
+}
+
+/**
+ * @brief Writes a whole frame, waiting for the reader to make room.
+ * @return False if `stop` was set, `end` passed or the pseudo-terminal failed first.
+ */
+static bool write_frame(int fd, const uint8_t* data, size_t size, Clock::time_point end, const std::atomic<bool>& stop) {
+    while (size > 0) {
+        ssize_t count = write(fd, data, size);
+        if (count > 0) {
+            data += count;
+            size -= (size_t)count;
+            continue;
+        }
+        if (count < 0 && errno != EAGAIN && errno != EINTR) {
+            return false;
+        }
+        struct pollfd pfd{fd, POLLOUT, 0};
+        if (stop.load(std::memory_order_relaxed) || Clock::now() >= end) {
+            return false;
+        }
+        poll(&pfd, 1, LOAD_WRITE_POLL_MS);
+    }
+    return true;
+}
+
+/**
+ * @details
+ * At a fixed rate the frames of all nodes are sent in one sequence: node `i`
+ * sends its frame `k` at `(k + i / nodes)` frame periods, so the nodes are
+ * evenly out of phase and one thread can pace all of them.
+ */
+LoadStats PtyLoadGenerator::run(double duration_s, const std::atomic<bool>& stop) {
+    LoadStats stats{0, 0, 0};
+    const size_t nodes = m_masters.size();
+    if (nodes == 0) {
+        return stats;
+    }
+
+    std::mt19937 random(m_options.seed);
+    std::normal_distribution<double> noise(0, 50);
+    FrameBuilder builder;
+    std::vector<RawFrameBuilder> raw_builders(nodes);
+    std::vector<uint64_t> samples_sent(nodes, 0);
+    std::vector<bool> failed(nodes, false);
+    uint8_t raw_frame[FRAME_BUFFER_CAPACITY];
+    SampleVector ch0;
+    SampleVector ch1;
+
+    const bool paced = m_options.rate_sps > 0;
+    const std::chrono::duration<double> frame_period(paced ? m_options.vector_size / m_options.rate_sps : 0);
+    const Clock::time_point start = Clock::now();
+    const Clock::time_point end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(duration_s));
+
+    for (uint64_t sent = 0; !stop.load(std::memory_order_relaxed); sent++) {
+        size_t node = sent % nodes;
+        Clock::time_point now = Clock::now();
+        if (paced) {
+            Clock::time_point due = start + std::chrono::duration_cast<Clock::duration>(frame_period * ((double)sent / nodes));
+            if (due >= end) {
+                break;
+            }
+            if (due > now) {
+                std::this_thread::sleep_until(due);
+            } else if (now - due > frame_period) {
+                stats.late_frames++;
+            }
+        } else if (now >= end) {
+            break;
+        }
+        if (failed[node]) {
+            continue;
+        }
+
+        ch0.clear();
+        ch1.clear();
+        for (unsigned int i = 0; i < m_options.vector_size; i++) {
+            double phase = 2 * M_PI * LOAD_SIGNAL_CYCLES_PER_SAMPLE * (double)(samples_sent[node] + i) + node;
+            ch0.push_back((int32_t)(LOAD_SIGNAL_AMPLITUDE * std::sin(phase) + noise(random)));
+            ch1.push_back((int32_t)(LOAD_SIGNAL_AMPLITUDE * std::cos(phase) + noise(random)));
+        }
+        samples_sent[node] += m_options.vector_size;
+
+        int node_id = m_options.first_node + (int)node;
+        const uint8_t* data = raw_frame;
+        size_t size;
+        if (m_options.raw) {
+            size = raw_builders[node].build(ch0, ch1, node_id, raw_frame, sizeof(raw_frame));
+        } else {
+            size = builder.build(ch0, ch1, node_id);
+            data = builder.data();
+        }
+        if (!write_frame(m_masters[node], data, size, end, stop)) {
+            failed[node] = true;
+            continue;
+        }
+        stats.frames++;
+        stats.bytes += size;
+    }
+    return stats;
+}
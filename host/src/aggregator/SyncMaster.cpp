@@ -0,0 +1,48 @@
+/**
+ * @file SyncMaster.cpp
+ * @brief Implementation of the SyncMaster class.
+ */
+
+#include "aggregator/SyncMaster.h"
+
+SyncMaster::SyncMaster(uint64_t interval_us)
+    : m_interval_us(interval_us), m_next_us(0), m_next_id(1), m_outstanding_id(0), m_outstanding_t1(0),
+      m_done_id(0), m_done_t4(0), m_stats{0, 0, 0, 0, 0, 0, false} {}
+
+size_t SyncMaster::makeRequest(uint64_t now_us, uint8_t* out, size_t capacity) {
+    SyncRequest request{m_next_id, now_us, m_done_id, m_done_t4};
+    size_t size = write_sync_request(request, out, capacity);
+    if (size == 0) {
+        return 0;
+    }
+
+    m_outstanding_id = request.id;
+    m_outstanding_t1 = now_us;
+    m_next_id = (m_next_id == UINT32_MAX) ? 1 : m_next_id + 1;
+    m_stats.requests++;
+    m_next_us = now_us + (m_stats.requests < SYNC_MASTER_STARTUP_EXCHANGES ? SYNC_MASTER_STARTUP_INTERVAL_US
+                                                                             : m_interval_us);
+    return size;
+}
+
+bool SyncMaster::onResponse(const SyncResponse& response, uint64_t t4_us) {
+    if (m_outstanding_id == 0 || response.id != m_outstanding_id) {
+        m_stats.stale_responses++;
+        return false;
+    }
+
+    int64_t t1 = (int64_t)m_outstanding_t1;
+    int64_t t2 = (int64_t)response.t2_us;
+    int64_t t3 = (int64_t)response.t3_us;
+    int64_t t4 = (int64_t)t4_us;
+    m_stats.responses++;
+    m_stats.offset_us = ((t1 - t2) + (t4 - t3)) / 2;
+    m_stats.delay_us = (t4 - t1) - (t3 - t2);
+    m_stats.skew_ppb = response.skew_ppb;
+    m_stats.synced = (response.flags & SYNC_FLAG_SYNCED) != 0;
+
+    m_done_id = response.id;
+    m_done_t4 = t4_us;
+    m_outstanding_id = 0;
+    return true;
+}
@@ -0,0 +1,199 @@
+/**
+ * @file CaptureFile.cpp
+ * @brief Implementation of the CaptureWriter and CaptureReader classes.
+ */
+
+#include "capture/CaptureFile.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+CaptureWriter::CaptureWriter(const std::string& path, CaptureKind kind, uint16_t node)
+    : m_file(nullptr), m_kind(kind), m_offset(0), m_time_us(0), m_record_count(0) {
+    m_file = fopen(path.c_str(), "wb");
+    if (m_file == nullptr) {
+        throw std::runtime_error("cannot create " + path + ": " + strerror(errno));
+    }
+
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    CaptureFileHeader header;
+    memcpy(header.magic, CAPTURE_FILE_MAGIC, sizeof(header.magic));
+    header.version = CAPTURE_FILE_VERSION;
+    header.kind = kind;
+    header.node = node;
+    header.start_time_us = std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+    write(&header, sizeof(header));
+}
+
+CaptureWriter::~CaptureWriter(void) {
+    finalize();
+}
+
+void CaptureWriter::write(const void* data, size_t size) {
+    if (fwrite(data, 1, size, m_file) != size) {
+        throw std::runtime_error(std::string("capture write failed: ") + strerror(errno));
+    }
+    m_offset += size;
+}
+
+void CaptureWriter::append(std::span<const uint8_t> payload, uint64_t time_us) {
+    CaptureRecordHeader header;
+    header.marker = CAPTURE_RECORD_MARKER;
+    header.kind = m_kind;
+    header.checksum = capture_checksum(payload.data(), payload.size());
+    header.length = (uint16_t)payload.size();
+    header.delta_us = (uint32_t)((m_record_count == 0) ? 0 : time_us - m_time_us);
+    appendRecord(header, payload);
+}
+
+/**
+ * @brief Writes a record and adds a seek point every `CAPTURE_INDEX_INTERVAL` records.
+ *
+ * @details
+ * The delta of the very first record is not counted, so record times always
+ * start at zero regardless of when the node started its timer.
+ */
+void CaptureWriter::appendRecord(const CaptureRecordHeader& header, std::span<const uint8_t> payload) {
+    if (m_record_count > 0) {
+        m_time_us += header.delta_us;
+    }
+    if (m_record_count % CAPTURE_INDEX_INTERVAL == 0) {
+        m_index.push_back(CaptureIndexEntry{m_offset, m_time_us});
+    }
+
+    write(&header, sizeof(header));
+    write(payload.data(), payload.size());
+    m_record_count++;
+}
+
+void CaptureWriter::finalize(void) {
+    if (m_file == nullptr) {
+        return;
+    }
+
+    CaptureFileFooter footer;
+    footer.index_offset = m_offset;
+    footer.index_count = (uint32_t)m_index.size();
+    footer.record_count = m_record_count;
+    footer.reserved = 0;
+    memcpy(footer.magic, CAPTURE_FOOTER_MAGIC, sizeof(footer.magic));
+
+    if (!m_index.empty()) {
+        fwrite(m_index.data(), sizeof(CaptureIndexEntry), m_index.size(), m_file);
+    }
+    fwrite(&footer, sizeof(footer), 1, m_file);
+    fclose(m_file);
+    m_file = nullptr;
+}
+
+/**
+ * @brief Parses the file header and the optional footer/index.
+ *
+ * @details
+ * The footer is only trusted if its magic matches and the index lies between
+ * the header and the footer; otherwise the whole remainder of the file is
+ * treated as record area.
+ */
+CaptureReader::CaptureReader(std::span<const uint8_t> bytes)
+    : m_bytes(bytes), m_records_end(bytes.size()), m_position(sizeof(CaptureFileHeader)),
+      m_time_us(0), m_record_count(0), m_corrupt_records(0) {
+
+    if (bytes.size() < sizeof(CaptureFileHeader)) {
+        throw std::runtime_error("capture file too small");
+    }
+    memcpy(&m_header, bytes.data(), sizeof(m_header));
+    if (memcmp(m_header.magic, CAPTURE_FILE_MAGIC, sizeof(m_header.magic)) != 0 ||
+        m_header.version != CAPTURE_FILE_VERSION) {
+        throw std::runtime_error("not a capture file or unsupported version");
+    }
+
+    if (bytes.size() < sizeof(CaptureFileHeader) + sizeof(CaptureFileFooter)) {
+        return;
+    }
+
+    CaptureFileFooter footer;
+    memcpy(&footer, bytes.data() + bytes.size() - sizeof(footer), sizeof(footer));
+    uint64_t index_end = footer.index_offset + (uint64_t)footer.index_count * sizeof(CaptureIndexEntry);
+    if (memcmp(footer.magic, CAPTURE_FOOTER_MAGIC, sizeof(footer.magic)) != 0 ||
+        footer.index_offset < sizeof(CaptureFileHeader) ||
+        index_end != bytes.size() - sizeof(footer)) {
+        return;
+    }
+
+    m_records_end = footer.index_offset;
+    m_record_count = footer.record_count;
+    m_index.resize(footer.index_count);
+    if (footer.index_count > 0) {
+        memcpy(m_index.data(), bytes.data() + footer.index_offset, footer.index_count * sizeof(CaptureIndexEntry));
+    }
+}
+
+/**
+ * @brief Seeks with a binary search over the index.
+ *
+ * @details
+ * `next` adds the delta of the record it reads, so the running time is set to
+ * the index time minus that record's delta.
+ */
+void CaptureReader::seek(uint64_t time_us) {
+    m_position = sizeof(CaptureFileHeader);
+    m_time_us = 0;
+    if (m_index.empty()) {
+        return;
+    }
+
+    size_t low = 0;
+    size_t high = m_index.size();
+    while (high - low > 1) {
+        size_t mid = (low + high) / 2;
+        if (m_index[mid].time_us <= time_us) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+    if (low == 0) {
+        return;
+    }
+
+    CaptureRecordHeader record;
+    memcpy(&record, m_bytes.data() + m_index[low].offset, sizeof(record));
+    m_position = m_index[low].offset;
+    m_time_us = m_index[low].time_us - record.delta_us;
+}
+
+bool CaptureReader::next(CaptureRecord& record) {
+    while (m_position + sizeof(CaptureRecordHeader) <= m_records_end) {
+        CaptureRecordHeader header;
+        memcpy(&header, m_bytes.data() + m_position, sizeof(header));
+
+        size_t payload_offset = m_position + sizeof(header);
+        bool valid = header.marker == CAPTURE_RECORD_MARKER &&
+                     header.length <= CAPTURE_MAX_PAYLOAD_SIZE &&
+                     payload_offset + header.length <= m_records_end &&
+                     capture_checksum(m_bytes.data() + payload_offset, header.length) == header.checksum;
+
+        if (!valid) {
+            // Resynchronize on the next record marker
+            m_corrupt_records++;
+            m_position++;
+            while (m_position + 1 < m_records_end &&
+                   !(m_bytes[m_position] == 0xCC && m_bytes[m_position + 1] == 0xCC)) {
+                m_position++;
+            }
+            continue;
+        }
+
+        if (m_position != sizeof(CaptureFileHeader)) {
+            m_time_us += header.delta_us;
+        }
+        record.time_us = m_time_us;
+        record.kind = header.kind;
+        record.payload = m_bytes.subspan(payload_offset, header.length);
+        m_position = payload_offset + header.length;
+        return true;
+    }
+    return false;
+}
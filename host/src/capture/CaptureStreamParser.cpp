@@ -0,0 +1,56 @@
+/**
+ * @file CaptureStreamParser.cpp
+ * @brief Implementation of the CaptureStreamParser class.
+ */
+
+#include "capture/CaptureStreamParser.h"
+
+#include <cstring>
+
+CaptureStreamParser::CaptureStreamParser(RecordHandler handler)
+    : m_handler(std::move(handler)), m_rejected_records(0) {
+}
+
+/**
+ * @brief Appends the chunk and extracts all complete records.
+ *
+ * @details
+ * Capture streams are slow (a few kB/s), so unlike the frame decoder this
+ * parser simply accumulates bytes in one buffer and compacts it once per chunk.
+ */
+void CaptureStreamParser::feed(std::span<const uint8_t> chunk) {
+    m_buffer.insert(m_buffer.end(), chunk.begin(), chunk.end());
+
+    size_t pos = 0;
+    while (pos + sizeof(CaptureRecordHeader) <= m_buffer.size()) {
+        if (m_buffer[pos] != 0xCC || m_buffer[pos + 1] != 0xCC) {
+            pos++;
+            continue;
+        }
+
+        CaptureRecordHeader header;
+        memcpy(&header, m_buffer.data() + pos, sizeof(header));
+        if (header.length > CAPTURE_MAX_PAYLOAD_SIZE) {
+            m_rejected_records++;
+            pos++;
+            continue;
+        }
+
+        size_t end = pos + sizeof(header) + header.length;
+        if (end > m_buffer.size()) {
+            break; // Wait for the rest of the record
+        }
+
+        const uint8_t* payload = m_buffer.data() + pos + sizeof(header);
+        if (capture_checksum(payload, header.length) != header.checksum) {
+            m_rejected_records++;
+            pos++;
+            continue;
+        }
+
+        m_handler(header, {payload, header.length});
+        pos = end;
+    }
+
+    m_buffer.erase(m_buffer.begin(), m_buffer.begin() + pos);
+}
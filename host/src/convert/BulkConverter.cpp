@@ -0,0 +1,222 @@
+/**
+ * @file BulkConverter.cpp
+ * @brief Implementation of the BulkConverter class and the frame boundary search.
+ */
+
+#include "convert/BulkConverter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "config/PipelineConfig.h"
+#include "utils/ConversionKernel.h"
+
+/**
+ * @brief Reads the payload size of a frame header.
+ */
+static uint32_t payload_size_at(const uint8_t* header) {
+    uint32_t size;
+    memcpy(&size, header + SERIAL_MAIL_SYNC_SIZE, sizeof(size));
+    return size;
+}
+
+static bool is_sync_marker(const uint8_t* data) {
+    return data[0] == SERIAL_MAIL_SYNC_BYTE && data[1] == SERIAL_MAIL_SYNC_BYTE;
+}
+
+/**
+ * @brief Checks that frames with plausible sizes follow each other from an offset.
+ */
+static bool frames_chain(std::span<const uint8_t> bytes, size_t start) {
+    size_t position = start;
+    for (int i = 0; i < CONVERT_BOUNDARY_CHAIN; i++) {
+        if (position == bytes.size()) {
+            return true;
+        }
+        if (bytes.size() - position < SERIAL_MAIL_HEADER_SIZE) {
+            // A truncated header at the end of the capture
+            return i > 0;
+        }
+        if (!is_sync_marker(bytes.data() + position)) {
+            return false;
+        }
+        uint32_t size = payload_size_at(bytes.data() + position);
+        if (size < SERIAL_MAIL_MIN_PAYLOAD_SIZE || size > SERIAL_MAIL_MAX_PAYLOAD_SIZE) {
+            return false;
+        }
+        position += SERIAL_MAIL_HEADER_SIZE + size;
+        if (position > bytes.size()) {
+            return i > 0;
+        }
+    }
+    return true;
+}
+
+size_t find_frame_boundary(std::span<const uint8_t> bytes, size_t from) {
+    if (from == 0) {
+        return 0;
+    }
+    const uint8_t* data = bytes.data();
+    for (size_t position = from; position + 1 < bytes.size(); position++) {
+        const uint8_t* marker = static_cast<const uint8_t*>(
+            memchr(data + position, SERIAL_MAIL_SYNC_BYTE, bytes.size() - position));
+        if (marker == nullptr) {
+            break;
+        }
+        position = marker - data;
+        if (position + 1 < bytes.size() && is_sync_marker(marker) && frames_chain(bytes, position)) {
+            return position;
+        }
+    }
+    return bytes.size();
+}
+
+void append_sample_rows(const DecodedFrame& frame, uint64_t frame_number, SampleColumns& columns) {
+    const float nan = std::nanf("");
+    size_t count = std::max(frame.ch0.size(), frame.ch1.size());
+    for (size_t i = 0; i < count; i++) {
+        columns.frame.push_back(frame_number);
+        columns.time_us.push_back(frame.time_us);
+        columns.node.push_back(frame.node);
+        columns.device.push_back(frame.device);
+        columns.index.push_back((uint16_t)i);
+        columns.ch0_mv.push_back(i < frame.ch0.size()
+            ? sample_to_millivolts(node_sample(frame.ch0[i]), PhytoConfig::databits, PhytoConfig::vref,
+                                   PhytoConfig::gain)
+            : nan);
+        columns.ch1_mv.push_back(i < frame.ch1.size()
+            ? sample_to_millivolts(node_sample(frame.ch1[i]), PhytoConfig::databits, PhytoConfig::vref,
+                                   PhytoConfig::gain)
+            : nan);
+    }
+}
+
+BulkConverter::BulkConverter(unsigned int workers, size_t chunk_size)
+    : m_workers(std::max(workers, 1u)), m_chunk_size(std::max<size_t>(chunk_size, CONVERT_MIN_CHUNK_SIZE)),
+      m_frames(0), m_stats{0, 0, 0, 0, 0, 0, 0} {}
+
+/**
+ * @struct ConvertedChunk
+ * @brief Result of one chunk, handed from a worker to the writing thread.
+ */
+struct ConvertedChunk {
+    SampleColumns columns;      ///< Rows with frame numbers counted from 0 within the chunk.
+    DecoderStats  decoder;      ///< Counters of the chunk's decoder.
+    uint64_t      frames;       ///< Sample frames of the chunk.
+    bool          ready;        ///< Set by the worker, cleared by the writer.
+};
+
+/**
+ * @brief Decodes the frames between the boundaries at the nominal start and end of a chunk.
+ */
+static void convert_chunk(std::span<const uint8_t> capture, size_t chunk, size_t chunk_size,
+                          ConvertedChunk& result) {
+    size_t begin = find_frame_boundary(capture, std::min(capture.size(), chunk * chunk_size));
+    size_t end = find_frame_boundary(capture, std::min(capture.size(), (chunk + 1) * chunk_size));
+    end = std::max(begin, end);
+
+    result.columns.clear();
+    result.frames = 0;
+    StreamDecoder decoder([&result](const DecodedFrame& frame) {
+        if (frame.version == BAND_FRAME_VERSION) {
+            return;
+        }
+        append_sample_rows(frame, result.frames++, result.columns);
+    });
+    decoder.feed(capture.subspan(begin, end - begin));
+    result.decoder = decoder.stats();
+}
+
+/**
+ * @details
+ * Chunk `k` goes into slot `k % window`. A worker only takes chunk `k` once
+ * the writer has written chunk `k - window`, so a slot is never reused early.
+ * If writing fails, the workers are stopped before the error is passed on.
+ */
+void BulkConverter::convert(std::span<const uint8_t> capture, ColumnarWriter& writer) {
+    const size_t chunks = (capture.size() + m_chunk_size - 1) / m_chunk_size;
+    const size_t window = (size_t)m_workers * CONVERT_CHUNKS_PER_WORKER;
+    std::vector<ConvertedChunk> slots(window);
+    std::mutex mutex;
+    std::condition_variable changed;
+    size_t next_chunk = 0;
+    size_t written = 0;
+    bool abort = false;
+
+    auto work = [&](void) {
+        while (true) {
+            size_t chunk;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [&] { return abort || next_chunk >= chunks || next_chunk < written + window; });
+                if (abort || next_chunk >= chunks) {
+                    return;
+                }
+                chunk = next_chunk++;
+            }
+            ConvertedChunk& slot = slots[chunk % window];
+            convert_chunk(capture, chunk, m_chunk_size, slot);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                slot.ready = true;
+            }
+            changed.notify_all();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned int i = 0; i < m_workers; i++) {
+        threads.emplace_back(work);
+    }
+
+    std::exception_ptr error;
+    try {
+        for (size_t chunk = 0; chunk < chunks; chunk++) {
+            ConvertedChunk& slot = slots[chunk % window];
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [&] { return slot.ready; });
+            }
+
+            for (uint64_t& frame : slot.columns.frame) {
+                frame += m_frames;
+            }
+            writer.writeGroup(slot.columns);
+            m_frames += slot.frames;
+            m_stats.chunks++;
+            m_stats.frames += slot.frames;
+            m_stats.rows += slot.columns.rows();
+            m_stats.samples += slot.decoder.samples;
+            m_stats.skipped_bytes += slot.decoder.skipped_bytes;
+            m_stats.rejected_frames += slot.decoder.rejected_frames;
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                slot.ready = false;
+                written++;
+            }
+            changed.notify_all();
+        }
+    } catch (...) {
+        error = std::current_exception();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            abort = true;
+        }
+        changed.notify_all();
+    }
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    m_stats.bytes += capture.size();
+}
@@ -0,0 +1,161 @@
+/**
+ * @file ColumnarFile.cpp
+ * @brief Implementation of the ColumnarWriter and ColumnarReader classes.
+ */
+
+#include "convert/ColumnarFile.h"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+const ColumnDescriptor sample_columns[SAMPLE_COLUMN_COUNT] = {
+    {"frame",   COLUMN_UINT64,  8},
+    {"time_us", COLUMN_UINT64,  8},
+    {"node",    COLUMN_INT32,   4},
+    {"device",  COLUMN_UINT8,   1},
+    {"index",   COLUMN_UINT16,  2},
+    {"ch0_mv",  COLUMN_FLOAT32, 4},
+    {"ch1_mv",  COLUMN_FLOAT32, 4},
+};
+
+/**
+ * @brief Bytes a column of `rows` values occupies, including its padding.
+ */
+static size_t padded_size(size_t rows, size_t width) {
+    size_t size = rows * width;
+    return (size + COLUMNAR_ALIGNMENT - 1) / COLUMNAR_ALIGNMENT * COLUMNAR_ALIGNMENT;
+}
+
+void SampleColumns::clear(void) {
+    frame.clear();
+    time_us.clear();
+    node.clear();
+    device.clear();
+    index.clear();
+    ch0_mv.clear();
+    ch1_mv.clear();
+}
+
+ColumnarWriter::ColumnarWriter(const std::string& path) : m_file(nullptr), m_offset(0), m_rows(0) {
+    m_file = fopen(path.c_str(), "wb");
+    if (m_file == nullptr) {
+        throw std::runtime_error("cannot create " + path + ": " + strerror(errno));
+    }
+
+    ColumnarFileHeader header;
+    memcpy(header.magic, COLUMNAR_FILE_MAGIC, sizeof(header.magic));
+    header.version = COLUMNAR_FILE_VERSION;
+    header.column_count = SAMPLE_COLUMN_COUNT;
+    memset(header.reserved, 0, sizeof(header.reserved));
+    write(&header, sizeof(header));
+    write(sample_columns, sizeof(sample_columns));
+    static_assert((sizeof(ColumnarFileHeader) + sizeof(sample_columns)) % COLUMNAR_ALIGNMENT == 0,
+                  "The first row group must start aligned");
+}
+
+ColumnarWriter::~ColumnarWriter(void) {
+    finalize();
+}
+
+void ColumnarWriter::write(const void* data, size_t size) {
+    if (fwrite(data, 1, size, m_file) != size) {
+        throw std::runtime_error(std::string("columnar write failed: ") + strerror(errno));
+    }
+    m_offset += size;
+}
+
+void ColumnarWriter::writeColumn(const void* data, size_t size) {
+    static const uint8_t padding[COLUMNAR_ALIGNMENT] = {};
+    write(data, size);
+    write(padding, padded_size(size, 1) - size);
+}
+
+void ColumnarWriter::writeGroup(const SampleColumns& columns) {
+    const size_t rows = columns.rows();
+    if (rows == 0) {
+        return;
+    }
+
+    m_index.push_back(ColumnarGroupEntry{m_offset, (uint32_t)rows, 0});
+    ColumnarGroupHeader header{(uint32_t)rows, 0};
+    write(&header, sizeof(header));
+    writeColumn(columns.frame.data(), rows * sizeof(uint64_t));
+    writeColumn(columns.time_us.data(), rows * sizeof(uint64_t));
+    writeColumn(columns.node.data(), rows * sizeof(int32_t));
+    writeColumn(columns.device.data(), rows * sizeof(uint8_t));
+    writeColumn(columns.index.data(), rows * sizeof(uint16_t));
+    writeColumn(columns.ch0_mv.data(), rows * sizeof(float));
+    writeColumn(columns.ch1_mv.data(), rows * sizeof(float));
+    m_rows += rows;
+}
+
+void ColumnarWriter::finalize(void) {
+    if (m_file == nullptr) {
+        return;
+    }
+
+    ColumnarFileFooter footer;
+    footer.index_offset = m_offset;
+    footer.group_count = (uint32_t)m_index.size();
+    footer.rows = m_rows;
+    footer.reserved = 0;
+    memcpy(footer.magic, COLUMNAR_FOOTER_MAGIC, sizeof(footer.magic));
+    write(m_index.data(), m_index.size() * sizeof(ColumnarGroupEntry));
+    write(&footer, sizeof(footer));
+
+    FILE* file = m_file;
+    m_file = nullptr;
+    if (fclose(file) != 0) {
+        throw std::runtime_error(std::string("columnar close failed: ") + strerror(errno));
+    }
+}
+
+ColumnarReader::ColumnarReader(std::span<const uint8_t> bytes) : m_bytes(bytes), m_rows(0) {
+    ColumnarFileHeader header;
+    ColumnarFileFooter footer;
+    const size_t schema_size = sizeof(header) + sizeof(sample_columns);
+    if (bytes.size() < schema_size + sizeof(footer)) {
+        throw std::runtime_error("columnar file: file too short");
+    }
+    memcpy(&header, bytes.data(), sizeof(header));
+    memcpy(&footer, bytes.data() + bytes.size() - sizeof(footer), sizeof(footer));
+    if (memcmp(header.magic, COLUMNAR_FILE_MAGIC, sizeof(header.magic)) != 0) {
+        throw std::runtime_error("columnar file: bad magic");
+    }
+    if (header.version != COLUMNAR_FILE_VERSION) {
+        throw std::runtime_error("columnar file: unsupported version " + std::to_string(header.version));
+    }
+    if (header.column_count != SAMPLE_COLUMN_COUNT ||
+        memcmp(bytes.data() + sizeof(header), sample_columns, sizeof(sample_columns)) != 0) {
+        throw std::runtime_error("columnar file: unexpected columns");
+    }
+    if (memcmp(footer.magic, COLUMNAR_FOOTER_MAGIC, sizeof(footer.magic)) != 0) {
+        throw std::runtime_error("columnar file: not finalized");
+    }
+
+    uint64_t index_size = (uint64_t)footer.group_count * sizeof(ColumnarGroupEntry);
+    if (footer.index_offset < schema_size || footer.index_offset + index_size + sizeof(footer) != bytes.size()) {
+        throw std::runtime_error("columnar file: bad index location");
+    }
+    m_groups.resize(footer.group_count);
+    memcpy(m_groups.data(), bytes.data() + footer.index_offset, index_size);
+    for (const ColumnarGroupEntry& group : m_groups) {
+        size_t size = sizeof(ColumnarGroupHeader);
+        for (const ColumnDescriptor& column : sample_columns) {
+            size += padded_size(group.rows, column.width);
+        }
+        if (group.offset % COLUMNAR_ALIGNMENT != 0 || group.offset + size > footer.index_offset) {
+            throw std::runtime_error("columnar file: bad row group at offset " + std::to_string(group.offset));
+        }
+    }
+    m_rows = footer.rows;
+}
+
+size_t ColumnarReader::columnOffset(size_t group, SampleColumn column) const {
+    size_t offset = m_groups[group].offset + sizeof(ColumnarGroupHeader);
+    for (size_t i = 0; i < column; i++) {
+        offset += padded_size(m_groups[group].rows, sample_columns[i].width);
+    }
+    return offset;
+}
@@ -0,0 +1,172 @@
+/**
+ * @file phyto_aggregate.cpp
+ * @brief Ingests the serial ports of many PhytoNodes into one output.
+ *
+ * One Raspberry Pi in the greenhouse reads many nodes, each on its own serial
+ * port. Instead of a reader process per port, this daemon reads all ports (and
+ * capture files) on one epoll event loop, decodes the frames in place, merges
+ * the streams by node and sequence number and writes every sample, stamped
+ * with the host receive time, into one CSV or binary output.
+ *
+ * @details
+ * - `-w <n>` distributes the inputs over `n` event loops on their own threads.
+ * - Raw frames received twice (e.g. over UART and a BLE relay) are written
+ *   once, and raw frames that overtake each other are put back in order
+ *   within `--window` frames or `--hold` milliseconds.
+ * - `--sync <s>` sends sync requests to every serial port every `s` seconds,
+ *   so nodes built with `CLOCK_SYNC` stamp their frames with the time of this
+ *   host; their frames are then written with that time instead of the
+ *   receive time.
+ * - Runs until all inputs are closed or Ctrl-C; `--stats` then prints the
+ *   counters of every input and of the merger to stderr.
+ */
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <string>
+#include <vector>
+
+#include "aggregator/AggregateWriter.h"
+#include "aggregator/NodeAggregator.h"
+
+/// Default UART baud rate of the node.
+#define DEFAULT_BAUDRATE 115200
+
+/// Default reorder window in frames per node.
+#define DEFAULT_WINDOW 8
+
+/// Default time a frame is held ahead of a gap, in ms.
+#define DEFAULT_HOLD_MS 500
+
+/// Default interval of the sync requests in seconds.
+#define DEFAULT_SYNC_INTERVAL_S 10
+
+/// Output buffer size for stdout/file writes.
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+
+/// Set by the signal handler to stop the event loops.
+static std::atomic<bool> stop_requested(false);
+
+static void handle_signal(int) {
+    stop_requested.store(true);
+}
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+        "usage: %s [options] <serial-device|capture-file>...\n"
+        "  -o <path>     write to <path> instead of stdout\n"
+        "  -b <baud>     baud rate for serial devices (default %d)\n"
+        "  -w <loops>    event loops, each on its own thread (default 1)\n"
+        "  --window <n>  raw frames held per node to restore their order (default %d)\n"
+        "  --hold <ms>   longest time a frame is held for a missing one (default %d)\n"
+        "  --binary      write packed 32-byte records instead of CSV\n"
+        "  --sync <s>    synchronize the clocks of CLOCK_SYNC nodes every <s> seconds (e.g. %d)\n"
+        "  --stats       print input and merger counters to stderr at the end\n",
+        program, DEFAULT_BAUDRATE, DEFAULT_WINDOW, DEFAULT_HOLD_MS, DEFAULT_SYNC_INTERVAL_S);
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::string> inputs;
+    std::string output;
+    int baudrate = DEFAULT_BAUDRATE;
+    unsigned int workers = 1;
+    size_t window = DEFAULT_WINDOW;
+    uint64_t hold_ms = DEFAULT_HOLD_MS;
+    bool binary = false;
+    double sync_s = 0;
+    bool stats = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc) {
+            output = argv[++i];
+        } else if (arg == "-b" && i + 1 < argc) {
+            baudrate = std::stoi(argv[++i]);
+        } else if (arg == "-w" && i + 1 < argc) {
+            workers = (unsigned int)std::stoul(argv[++i]);
+        } else if (arg == "--window" && i + 1 < argc) {
+            window = std::stoul(argv[++i]);
+        } else if (arg == "--hold" && i + 1 < argc) {
+            hold_ms = std::stoull(argv[++i]);
+        } else if (arg == "--sync" && i + 1 < argc) {
+            sync_s = std::stod(argv[++i]);
+        } else if (arg == "--binary") {
+            binary = true;
+        } else if (arg == "--stats") {
+            stats = true;
+        } else if (!arg.empty() && arg[0] != '-') {
+            inputs.push_back(arg);
+        } else {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+    if (inputs.empty() || workers < 1 || sync_s < 0) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    FILE* out = stdout;
+    if (!output.empty()) {
+        out = fopen(output.c_str(), binary ? "wb" : "w");
+        if (out == nullptr) {
+            fprintf(stderr, "cannot open %s: %s\n", output.c_str(), strerror(errno));
+            return 1;
+        }
+    }
+    static char out_buffer[OUTPUT_BUFFER_SIZE];
+    setvbuf(out, out_buffer, _IOFBF, sizeof(out_buffer));
+
+    std::signal(SIGINT, handle_signal);
+    std::signal(SIGTERM, handle_signal);
+
+    AggregateWriter writer(out, binary);
+    auto start = std::chrono::steady_clock::now();
+    try {
+        NodeAggregator aggregator([&](const MergedFrame& merged) { writer.write(merged); }, window, hold_ms * 1000);
+        aggregator.setSyncInterval((uint64_t)(sync_s * 1e6));
+        for (const std::string& input : inputs) {
+            aggregator.addSource(input, baudrate);
+        }
+        aggregator.run(workers, stop_requested);
+
+        if (stats) {
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            for (const SourceStats& source : aggregator.sourceStats()) {
+                fprintf(stderr, "%s: %llu bytes, %llu frames, %llu rejected, %llu skipped bytes, %llu missed raw frames\n",
+                        source.path.c_str(), (unsigned long long)source.decoder.bytes,
+                        (unsigned long long)source.decoder.frames, (unsigned long long)source.decoder.rejected_frames,
+                        (unsigned long long)source.decoder.skipped_bytes,
+                        (unsigned long long)source.decoder.missed_frames);
+                if (source.sync) {
+                    fprintf(stderr, "  sync: %llu requests, %llu responses, %s, offset %lld us, delay %lld us, "
+                            "skew %.3f ppm\n", (unsigned long long)source.sync_stats.requests,
+                            (unsigned long long)source.sync_stats.responses,
+                            source.sync_stats.synced ? "synced" : "not synced",
+                            (long long)source.sync_stats.offset_us, (long long)source.sync_stats.delay_us,
+                            source.sync_stats.skew_ppb / 1000.0);
+                }
+            }
+            MergerStats merger = aggregator.mergerStats();
+            fprintf(stderr, "merged: %u nodes, %llu frames, %llu reordered, %llu duplicates, %llu lost\n",
+                    merger.nodes, (unsigned long long)merger.frames, (unsigned long long)merger.reordered,
+                    (unsigned long long)merger.duplicates, (unsigned long long)merger.lost);
+            fprintf(stderr, "samples:  %llu in %.3f s (%.0f samples/s)\n", (unsigned long long)writer.samples(),
+                    elapsed, elapsed > 0 ? writer.samples() / elapsed : 0.0);
+        }
+    } catch (const std::exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+
+    fflush(out);
+    if (out != stdout) {
+        fclose(out);
+    }
+    return 0;
+}
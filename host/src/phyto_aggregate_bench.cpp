@@ -0,0 +1,199 @@
+/**
+ * @file phyto_aggregate_bench.cpp
+ * @brief Measures how the aggregator scales with the number of nodes.
+ *
+ * For 1, 2, 4, ... nodes the tool starts the pseudo-terminal load generator
+ * in a child process and runs the `NodeAggregator` with the CSV writer (into
+ * `/dev/null` unless `-o` is given) in this process until the generator
+ * hangs up. The CPU time of this process therefore is the aggregator's alone.
+ *
+ * For every node count it reports the merged samples per second, the frames
+ * lost between generator and output, the CPU load of the aggregator in total
+ * and per node, and the CPU time per frame. At the preset's rate this is the
+ * cost of a greenhouse of real nodes; with `-r 0` every node sends as fast as
+ * the aggregator reads, which gives its peak throughput.
+ */
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+#include "aggregator/AggregateWriter.h"
+#include "aggregator/NodeAggregator.h"
+#include "aggregator/PtyLoadGenerator.h"
+#include "config/PipelineConfig.h"
+
+/// Default largest node count.
+#define DEFAULT_MAX_NODES 64
+
+/// Default sending time per node count in seconds.
+#define DEFAULT_DURATION_S 5
+
+/// Time the generator keeps the pseudo-terminals open after sending, so the aggregator can drain them.
+#define DRAIN_MS 500
+
+/// Output buffer size for the CSV writer.
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+
+/**
+ * @struct BenchResult
+ * @brief Figures of one node count.
+ */
+struct BenchResult {
+    uint64_t sent_frames;       ///< Frames written by the generator.
+    uint64_t merged_frames;     ///< Frames that reached the output.
+    uint64_t samples;           ///< Samples written over both channels.
+    uint64_t late_frames;       ///< Frames the generator sent late because the aggregator fell behind.
+    double   send_s;            ///< Time the generator sent for.
+    double   cpu_s;             ///< User and system time of the aggregator.
+};
+
+static double cpu_seconds(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1e-6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec * 1e-6;
+}
+
+/**
+ * @brief Runs the generator with `nodes` nodes against the aggregator.
+ * @throws std::runtime_error if the pseudo-terminals cannot be set up.
+ */
+static BenchResult run(unsigned int nodes, const LoadOptions& options, double duration_s, unsigned int workers,
+                       FILE* out) {
+    PtyLoadGenerator generator(nodes, options);
+    AggregateWriter writer(out, false);
+    NodeAggregator aggregator([&](const MergedFrame& merged) { writer.write(merged); }, 8, 500000);
+    for (const std::string& path : generator.paths()) {
+        aggregator.addSource(path, 115200);
+    }
+
+    int report[2];
+    if (pipe(report) != 0) {
+        throw std::runtime_error(std::string("cannot create pipe: ") + strerror(errno));
+    }
+    pid_t child = fork();
+    if (child < 0) {
+        throw std::runtime_error(std::string("cannot fork: ") + strerror(errno));
+    }
+    if (child == 0) {
+        close(report[0]);
+        std::atomic<bool> never(false);
+        auto start = std::chrono::steady_clock::now();
+        LoadStats stats = generator.run(duration_s, never);
+        double send_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::this_thread::sleep_for(std::chrono::milliseconds(DRAIN_MS));
+        BenchResult result{stats.frames, 0, 0, stats.late_frames, send_s, 0};
+        ssize_t written = write(report[1], &result, sizeof(result));
+        _exit(written == (ssize_t)sizeof(result) ? 0 : 1);
+    }
+
+    close(report[1]);
+    generator.close();
+    std::atomic<bool> never(false);
+    double cpu_start = cpu_seconds();
+    aggregator.run(workers, never);
+    double cpu_s = cpu_seconds() - cpu_start;
+
+    BenchResult result{0, 0, 0, 0, 0, 0};
+    ssize_t received = read(report[0], &result, sizeof(result));
+    close(report[0]);
+    waitpid(child, nullptr, 0);
+    if (received != (ssize_t)sizeof(result)) {
+        throw std::runtime_error("load generator failed");
+    }
+    result.merged_frames = aggregator.mergerStats().frames;
+    result.samples = writer.samples();
+    result.cpu_s = cpu_s;
+    return result;
+}
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  -n <nodes>    largest node count, doubled from 1 (default %d)\n"
+        "  -t <s>        sending time per node count (default %d)\n"
+        "  -r <sps>      samples per second and channel of every node, 0 for as fast as possible (default: preset)\n"
+        "  -w <loops>    event loops of the aggregator (default 1)\n"
+        "  -o <path>     write the CSV to <path> instead of /dev/null\n"
+        "  --raw         send raw frames (RAW_FRAMES) instead of FlatBuffer frames\n",
+        program, DEFAULT_MAX_NODES, DEFAULT_DURATION_S);
+}
+
+int main(int argc, char** argv) {
+    unsigned int max_nodes = DEFAULT_MAX_NODES;
+    double duration_s = DEFAULT_DURATION_S;
+    unsigned int workers = 1;
+    std::string output = "/dev/null";
+    LoadOptions options{
+        (double)ad7124_rate_sps(PhytoConfig::power_mode, PhytoConfig::channels, PhytoConfig::filter_fs),
+        PhytoConfig::vector_size, false, 1, 1};
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-n" && i + 1 < argc) {
+            max_nodes = (unsigned int)std::stoul(argv[++i]);
+        } else if (arg == "-t" && i + 1 < argc) {
+            duration_s = std::stod(argv[++i]);
+        } else if (arg == "-r" && i + 1 < argc) {
+            options.rate_sps = std::stod(argv[++i]);
+        } else if (arg == "-w" && i + 1 < argc) {
+            workers = (unsigned int)std::stoul(argv[++i]);
+        } else if (arg == "-o" && i + 1 < argc) {
+            output = argv[++i];
+        } else if (arg == "--raw") {
+            options.raw = true;
+        } else {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+    if (max_nodes < 1 || workers < 1 || options.rate_sps < 0 || duration_s <= 0) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    FILE* out = fopen(output.c_str(), "w");
+    if (out == nullptr) {
+        fprintf(stderr, "cannot open %s: %s\n", output.c_str(), strerror(errno));
+        return 1;
+    }
+    static char out_buffer[OUTPUT_BUFFER_SIZE];
+    setvbuf(out, out_buffer, _IOFBF, sizeof(out_buffer));
+
+    printf("%s frames of %u samples, %s per node, %u event loop(s), %.0f s per run\n\n",
+           options.raw ? "raw" : "FlatBuffer", options.vector_size,
+           options.rate_sps > 0 ? (std::to_string((int)options.rate_sps) + " SPS").c_str() : "unpaced", workers,
+           duration_s);
+    printf("%6s %12s %14s %8s %8s %9s %14s %12s\n", "nodes", "frames", "samples/s", "lost", "late", "cpu %",
+           "cpu %/node", "cpu us/frame");
+
+    bool ok = true;
+    for (unsigned int nodes = 1; nodes <= max_nodes; nodes *= 2) {
+        BenchResult result;
+        try {
+            result = run(nodes, options, duration_s, workers, out);
+        } catch (const std::exception& e) {
+            fprintf(stderr, "%s\n", e.what());
+            return 1;
+        }
+        uint64_t lost = result.sent_frames > result.merged_frames ? result.sent_frames - result.merged_frames : 0;
+        double cpu_percent = 100.0 * result.cpu_s / result.send_s;
+        printf("%6u %12llu %14.0f %8llu %8llu %8.2f%% %13.3f%% %12.2f\n", nodes,
+               (unsigned long long)result.merged_frames, result.samples / result.send_s, (unsigned long long)lost,
+               (unsigned long long)result.late_frames, cpu_percent, cpu_percent / nodes,
+               result.merged_frames > 0 ? 1e6 * result.cpu_s / result.merged_frames : 0.0);
+        fflush(stdout);
+        ok &= lost == 0;
+    }
+
+    fclose(out);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,300 @@
+/**
+ * @file phyto_backlog_bench.cpp
+ * @brief Benchmarks the store-and-forward path of the node on a simulated flash.
+ *
+ * @details
+ * - Append: fills the flash ring log with frames until it has wrapped twice and
+ *   reports the host throughput, the throughput of the modelled STM32WB55 flash
+ *   and the resulting sector wear.
+ * - Catch-up: runs the node's `FrameSink` against a link of limited capacity in
+ *   steps of the service period. The link goes down for the outage time, frames
+ *   are stored in the log meanwhile, and the time until the backlog is empty
+ *   after the link returns is reported together with live frames lost.
+ *
+ * The catch-up sends raw frames, and everything the link carries runs through
+ * a `StreamDecoder`. When the link goes down, the host takes the bytes already
+ * written and drops its partial frame. The run fails if the decoder rejects a
+ * frame, or if a frame was neither delivered, dropped by the sink nor
+ * overwritten in the log.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <string>
+#include <vector>
+
+#include "adc/SampleVector.h"
+#include "serial_mail_sender/FrameFormat.h"
+#include "serial_mail_sender/RawFrameBuilder.h"
+#include "storage/FlashRingLog.h"
+#include "storage/SimulatedFlash.h"
+#include "stream_decoder/StreamDecoder.h"
+#include "transport/LoopbackTransport.h"
+
+/// Program unit of the STM32WB55 internal flash.
+#define FLASH_PROGRAM_SIZE 8
+
+/// Page size of the STM32WB55 internal flash.
+#define FLASH_SECTOR_SIZE 4096
+
+/// Service periods the link keeps running after the last live frame to empty the backlog.
+#define FINAL_DRAIN_STEPS 10000000
+
+/**
+ * @struct BenchOptions
+ * @brief Command line options.
+ */
+struct BenchOptions {
+    size_t   frame_size;        ///< Bytes per frame.
+    double   frame_rate;        ///< Live frames per second.
+    double   outage_s;          ///< Time the link is down.
+    double   link_rate;         ///< Link capacity in bytes per second.
+    size_t   drain_budget;      ///< Backlog bytes per service call.
+    double   period_ms;         ///< Service period.
+    uint32_t flash_kb;          ///< Size of the log area.
+};
+
+/**
+ * @class BenchLink
+ * @brief Loopback sink whose link state is switched by the simulation.
+ */
+class BenchLink : public LoopbackTransport {
+public:
+    BenchLink(void) : LoopbackTransport("bench"), m_up(true) {}
+
+    bool linkUp(void) const override { return m_up; }
+
+    void setUp(bool up) { m_up = up; }
+
+private:
+    bool m_up;  ///< Simulated link state.
+};
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  -s <bytes>    frame size, rounded down to a raw frame (default 88)\n"
+        "  -r <fps>      live frames per second (default 50)\n"
+        "  -t <s>        link outage in seconds (default 30)\n"
+        "  -c <B/s>      link capacity (default 11520, 115200 baud)\n"
+        "  -b <bytes>    backlog drain budget per service call (default 32)\n"
+        "  -p <ms>       service period (default 5)\n"
+        "  -f <KB>       flash log size (default 256)\n",
+        program);
+}
+
+static void fill_frame(uint8_t* frame, size_t size, uint32_t index) {
+    memset(frame, 0, size);
+    memcpy(frame, &index, std::min(size, sizeof(index)));
+}
+
+static void bench_append(const BenchOptions& options) {
+    SimulatedFlash flash(options.flash_kb * 1024, FLASH_PROGRAM_SIZE, FLASH_SECTOR_SIZE);
+    FlashRingLog log(flash);
+    if (log.mount() != 0) {
+        throw std::runtime_error("cannot mount the flash log");
+    }
+
+    uint8_t frame[FLASH_LOG_MAX_RECORD_SIZE];
+    uint64_t busy_start = flash.busyTimeUs();
+    auto start = std::chrono::steady_clock::now();
+    uint32_t frames = 0;
+    while (log.stats().overwritten < 2 * flash.size() / FLASH_SECTOR_SIZE) {
+        fill_frame(frame, options.frame_size, frames);
+        if (!log.append(frame, options.frame_size)) {
+            throw std::runtime_error("append failed");
+        }
+        frames++;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double device_seconds = (flash.busyTimeUs() - busy_start) / 1e6;
+    auto wear = std::minmax_element(flash.eraseCounts().begin(), flash.eraseCounts().end());
+
+    printf("append:\n");
+    printf("  frames:           %u x %zu bytes\n", frames, options.frame_size);
+    printf("  host:             %.0f frames/s\n", frames / seconds);
+    printf("  modelled flash:   %.0f frames/s, %.1f kB/s\n", frames / device_seconds,
+           frames * (double)options.frame_size / device_seconds / 1000);
+    printf("  sector erases:    min %u, max %u\n", *wear.first, *wear.second);
+}
+
+/**
+ * @brief Samples per channel of the largest raw frame of at most `size` bytes.
+ */
+static size_t raw_samples(size_t size) {
+    return (size - SERIAL_MAIL_HEADER_SIZE - raw_frame_payload_size(0)) / (2 * RAW_FRAME_SAMPLE_SIZE);
+}
+
+/**
+ * @brief Hands the bytes the link carries to the decoder.
+ * @param link Sink read from.
+ * @param decoder Decoder of the host.
+ * @param capacity Bytes read at most.
+ * @return Number of bytes read.
+ */
+static size_t receive(BenchLink& link, StreamDecoder& decoder, size_t capacity) {
+    uint8_t wire[LOOPBACK_BUFFER_SIZE];
+    size_t total = 0;
+    while (total < capacity) {
+        size_t read = link.read(wire, std::min(capacity - total, sizeof(wire)));
+        if (read == 0) {
+            break;
+        }
+        decoder.feed(std::span<const uint8_t>(wire, read));
+        total += read;
+    }
+    return total;
+}
+
+static bool bench_catch_up(const BenchOptions& options) {
+    SimulatedFlash flash(options.flash_kb * 1024, FLASH_PROGRAM_SIZE, FLASH_SECTOR_SIZE);
+    FlashRingLog log(flash);
+    if (log.mount() != 0) {
+        throw std::runtime_error("cannot mount the flash log");
+    }
+
+    FramePool pool;
+    BenchLink link;
+    link.attachBacklog(log, options.drain_budget);
+
+    RawFrameBuilder builder;
+    SampleVector samples(raw_samples(options.frame_size), 0);
+    size_t frame_size = SERIAL_MAIL_HEADER_SIZE + raw_frame_payload_size(samples.size());
+    std::vector<uint8_t> delivered;
+    uint64_t duplicates = 0;
+    StreamDecoder decoder([&](const DecodedFrame& frame) {
+        if (frame.sequence >= delivered.size()) {
+            delivered.resize(frame.sequence + 1, 0);
+        }
+        duplicates += delivered[frame.sequence];
+        delivered[frame.sequence] = 1;
+    });
+
+    const double outage_start_s = 1.0;
+    const double outage_end_s = outage_start_s + options.outage_s;
+    const double step_s = options.period_ms / 1000;
+    double frames_due = 0;
+    double link_credit = 0;
+    double caught_up_s = -1;
+    uint32_t index = 0;
+
+    for (double now = 0; now < outage_end_s + 3600; now += step_s) {
+        bool up = now < outage_start_s || now >= outage_end_s;
+        if (link.linkUp() && !up) {
+            receive(link, decoder, LOOPBACK_BUFFER_SIZE);
+            decoder.discardPending();
+        }
+        link.setUp(up);
+
+        frames_due += options.frame_rate * step_s;
+        while (frames_due >= 1) {
+            FrameRef frame = pool.allocate();
+            if (!frame) {
+                throw std::runtime_error("frame pool exhausted");
+            }
+            index++;
+            frame.setSize(builder.build(samples, samples, 1, frame.mutableData(), FRAME_BUFFER_CAPACITY));
+            link.offer(frame);
+            frames_due -= 1;
+        }
+
+        link.service();
+
+        if (link.linkUp()) {
+            link_credit += options.link_rate * step_s;
+            size_t read = receive(link, decoder, (size_t)link_credit);
+            link_credit = std::min(link_credit - read, options.link_rate * step_s);
+        }
+
+        if (now >= outage_end_s && log.empty() && caught_up_s < 0) {
+            caught_up_s = now - outage_end_s;
+            break;
+        }
+    }
+
+    double live_load = options.frame_rate * frame_size / options.link_rate * 100;
+
+    // Without new live frames the remaining backlog drains, so every frame can be accounted for
+    for (int step = 0; step < FINAL_DRAIN_STEPS && (!log.empty() || link.queued() > 0 || link.available() > 0);
+         step++) {
+        link.service();
+        receive(link, decoder, LOOPBACK_BUFFER_SIZE);
+    }
+
+    const FrameSinkStats& stats = link.stats();
+    uint64_t received = 0;
+    for (uint8_t frame : delivered) {
+        received += frame;
+    }
+    uint64_t overwritten = stats.stored - stats.forwarded;
+    uint64_t missing = index - std::min<uint64_t>(index, received + stats.dropped + overwritten);
+
+    printf("catch-up:\n");
+    printf("  frame size:       %zu bytes\n", frame_size);
+    printf("  live load:        %.0f%% of the link\n", live_load);
+    printf("  stored:           %u frames\n", stats.stored);
+    printf("  forwarded:        %u frames\n", stats.forwarded);
+    printf("  live dropped:     %u frames\n", stats.dropped);
+    printf("  overwritten:      %u sectors\n", log.stats().overwritten);
+    if (caught_up_s >= 0) {
+        printf("  catch-up time:    %.1f s (%.2f x outage)\n", caught_up_s, caught_up_s / options.outage_s);
+    } else {
+        printf("  catch-up time:    not within 1 h, drain budget below the spare link capacity\n");
+    }
+
+    const DecoderStats& decoded = decoder.stats();
+    bool ok = decoded.rejected_frames == 0 && missing == 0 && duplicates == 0 && received == decoded.frames;
+    printf("  decoded:          %llu of %u frames, %llu rejected, %llu missing, %llu duplicated: %s\n",
+           (unsigned long long)received, index, (unsigned long long)decoded.rejected_frames,
+           (unsigned long long)missing, (unsigned long long)duplicates, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options{88, 50, 30, 11520, 32, 5, 256};
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            print_usage(argv[0]);
+            return 2;
+        }
+        if (arg == "-s") {
+            options.frame_size = std::stoul(argv[++i]);
+        } else if (arg == "-r") {
+            options.frame_rate = std::stod(argv[++i]);
+        } else if (arg == "-t") {
+            options.outage_s = std::stod(argv[++i]);
+        } else if (arg == "-c") {
+            options.link_rate = std::stod(argv[++i]);
+        } else if (arg == "-b") {
+            options.drain_budget = std::stoul(argv[++i]);
+        } else if (arg == "-p") {
+            options.period_ms = std::stod(argv[++i]);
+        } else if (arg == "-f") {
+            options.flash_kb = (uint32_t)std::stoul(argv[++i]);
+        } else {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+    size_t min_frame_size = SERIAL_MAIL_HEADER_SIZE + raw_frame_payload_size(1);
+    size_t max_frame_size = std::min<size_t>(FLASH_LOG_MAX_RECORD_SIZE, FRAME_BUFFER_CAPACITY);
+    if (options.frame_size < min_frame_size || options.frame_size > max_frame_size) {
+        fprintf(stderr, "frame size must be between %zu and %zu bytes\n", min_frame_size, max_frame_size);
+        return 2;
+    }
+
+    bool ok;
+    try {
+        bench_append(options);
+        ok = bench_catch_up(options);
+    } catch (const std::exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,313 @@
+/**
+ * @file phyto_band_bench.cpp
+ * @brief Checks the node's band power analyzer against a reference FFT and measures its cost.
+ *
+ * @details
+ * The `BandPowerAnalyzer` runs with the window and bands of the configured
+ * preset on ADC-quantized test signals: tones on and between DFT bins,
+ * several tones with noise, and a drifting electrode offset with a slow
+ * potential. For every window the band powers are recomputed in double
+ * precision from an FFT of the same samples, and the largest deviation
+ * relative to the total band power of the window is reported. Each window
+ * is also sent through `build_band_frame` and the `StreamDecoder`, which must
+ * return the same values.
+ *
+ * The cost is given in nanoseconds and, on x86, TSC cycles per sample, and
+ * as an estimate for the node: the Cortex-M4 cycles per sample against the
+ * cycles available per sample at the preset's output data rate. The tool
+ * fails if a deviation exceeds `MAX_RELATIVE_ERROR` or a frame does not
+ * round-trip.
+ */
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "config/PipelineConfig.h"
+#include "dsp/BandPowerAnalyzer.h"
+#include "serial_mail_sender/BandFrameBuilder.h"
+#include "stream_decoder/StreamDecoder.h"
+#include "utils/ConversionKernel.h"
+
+/// Windows analyzed per test signal.
+#define DEFAULT_WINDOWS 20
+
+/// Samples pushed for the cost measurement.
+#define DEFAULT_SAMPLES 10000000
+
+/// Largest accepted deviation from the reference, relative to the total band power of the window;
+/// single-precision resonators lose accuracy with the window length, reaching about 4e-4 at 512 samples.
+#define MAX_RELATIVE_ERROR 1e-3
+
+/// CPU clock of the node (STM32WB55).
+#define NODE_CPU_CLOCK_HZ 64000000.0
+
+/// Estimated Cortex-M4F cycles per Goertzel bin and sample: two loads, multiply-add, subtract, two stores.
+#define NODE_CYCLES_PER_BIN 6.0
+
+/// Estimated Cortex-M4F cycles per sample outside the bin loop: conversion to mV, call and bookkeeping.
+#define NODE_CYCLES_PER_SAMPLE 30.0
+
+typedef std::chrono::steady_clock Clock;
+
+/// Test signal in mV as a function of the sample index.
+typedef std::function<double(uint64_t)> Signal;
+
+static inline uint64_t read_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief Quantizes a value like the ADC and converts it back like the node.
+ */
+static float adc_millivolts(double millivolts) {
+    int32_t sample = millivolts_to_codes<PhytoConfig>((float)millivolts);
+    sample = std::clamp(sample, -SAMPLE_ZERO_CODE, SAMPLE_ZERO_CODE - 1);
+    return sample_to_millivolts<PhytoConfig>(sample);
+}
+
+/**
+ * @brief In-place radix-2 FFT, or a direct DFT if the size is not a power of two.
+ */
+static std::vector<std::complex<double>> reference_dft(const std::vector<double>& samples) {
+    const size_t n = samples.size();
+    std::vector<std::complex<double>> x(samples.begin(), samples.end());
+    if ((n & (n - 1)) != 0) {
+        std::vector<std::complex<double>> out(n);
+        for (size_t k = 0; k < n; k++) {
+            for (size_t i = 0; i < n; i++) {
+                out[k] += x[i] * std::polar(1.0, -2 * M_PI * (double)(k * i % n) / n);
+            }
+        }
+        return out;
+    }
+    for (size_t i = 1, j = 0; i < n; i++) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            std::swap(x[i], x[j]);
+        }
+    }
+    for (size_t length = 2; length <= n; length <<= 1) {
+        std::complex<double> step = std::polar(1.0, -2 * M_PI / length);
+        for (size_t start = 0; start < n; start += length) {
+            std::complex<double> w = 1;
+            for (size_t i = 0; i < length / 2; i++) {
+                std::complex<double> a = x[start + i];
+                std::complex<double> b = x[start + i + length / 2] * w;
+                x[start + i] = a + b;
+                x[start + i + length / 2] = a - b;
+                w *= step;
+            }
+        }
+    }
+    return x;
+}
+
+/**
+ * @brief Band powers of one window computed from the reference DFT.
+ */
+static std::vector<double> reference_bands(const std::vector<double>& samples, double rate_sps) {
+    const size_t n = samples.size();
+    std::vector<std::complex<double>> spectrum = reference_dft(samples);
+    std::vector<double> bands(PhytoConfig::band_count, 0.0);
+    for (size_t k = 1; k <= n / 2; k++) {
+        double f = k * rate_sps / n;
+        for (unsigned int band = 0; band < PhytoConfig::band_count; band++) {
+            double lo = PhytoConfig::band_edges_hz[band];
+            double hi = PhytoConfig::band_edges_hz[band + 1];
+            bool last = band + 1 == PhytoConfig::band_count;
+            if (f >= lo && (f < hi || (last && f == hi))) {
+                double scale = (2 * k == n ? 1.0 : 2.0) / ((double)n * n);
+                bands[band] += std::norm(spectrum[k]) * scale;
+                break;
+            }
+        }
+    }
+    return bands;
+}
+
+/**
+ * @struct AccuracyResult
+ * @brief Comparison of one test signal with the reference.
+ */
+struct AccuracyResult {
+    unsigned int windows;       ///< Windows compared.
+    double       max_error;     ///< Largest deviation relative to the window's total band power.
+    bool         round_trip;    ///< Every window decoded from its band frame unchanged.
+};
+
+static AccuracyResult check_signal(const Signal& ch0, const Signal& ch1, unsigned int windows, double rate_sps) {
+    BandPowerAnalyzer analyzer(PhytoConfig::band_window, (float)rate_sps, PhytoConfig::band_edges_hz,
+                               PhytoConfig::band_count);
+    AccuracyResult result{0, 0, true};
+    std::vector<double> window[BAND_POWER_CHANNELS];
+    uint8_t frame[BAND_FRAME_MAX_SIZE];
+
+    const BandPowers* expected = nullptr;
+    StreamDecoder decoder([&](const DecodedFrame& decoded) {
+        bool same = decoded.version == BAND_FRAME_VERSION && decoded.sequence == expected->window &&
+                    decoded.band_count == expected->bands && decoded.node == PhytoConfig::node &&
+                    decoded.bands.size() == BAND_POWER_CHANNELS * expected->bands;
+        for (size_t i = 0; same && i < decoded.bands.size(); i++) {
+            same = decoded.bands[i] == expected->power[i / expected->bands][i % expected->bands];
+        }
+        result.round_trip &= same;
+    });
+
+    for (uint64_t i = 0; result.windows < windows; i++) {
+        for (unsigned int channel = 0; channel < BAND_POWER_CHANNELS; channel++) {
+            float sample = adc_millivolts(channel == 0 ? ch0(i) : ch1(i));
+            window[channel].push_back(sample);
+            if (!analyzer.push(channel, sample)) {
+                continue;
+            }
+
+            const BandPowers& powers = analyzer.powers();
+            for (unsigned int c = 0; c < BAND_POWER_CHANNELS; c++) {
+                std::vector<double> reference = reference_bands(window[c], rate_sps);
+                double total = 0;
+                for (double value : reference) {
+                    total += value;
+                }
+                for (unsigned int band = 0; band < PhytoConfig::band_count; band++) {
+                    double error = std::fabs(powers.power[c][band] - reference[band]) / std::max(total, 1e-30);
+                    result.max_error = std::max(result.max_error, error);
+                }
+                window[c].clear();
+            }
+
+            expected = &powers;
+            size_t size = build_band_frame(powers, PhytoConfig::node, frame, sizeof(frame));
+            uint64_t before = decoder.stats().band_frames;
+            decoder.feed({frame, size});
+            result.round_trip &= decoder.stats().band_frames == before + 1;
+            result.windows++;
+        }
+    }
+    return result;
+}
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  -w <windows>  windows compared per test signal (default %d)\n"
+        "  -n <samples>  samples pushed for the cost measurement (default %d)\n",
+        program, DEFAULT_WINDOWS, DEFAULT_SAMPLES);
+}
+
+int main(int argc, char** argv) {
+    unsigned int windows = DEFAULT_WINDOWS;
+    size_t samples = DEFAULT_SAMPLES;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-w" && i + 1 < argc) {
+            windows = (unsigned int)std::stoul(argv[++i]);
+        } else if (arg == "-n" && i + 1 < argc) {
+            samples = std::stoul(argv[++i]);
+        } else {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+    if (windows == 0 || samples == 0) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    const double rate_sps = ad7124_rate_sps(PhytoConfig::power_mode, PhytoConfig::channels, PhytoConfig::filter_fs);
+    const double n = PhytoConfig::band_window;
+    const double resolution = rate_sps / n;
+    BandPowerAnalyzer analyzer(PhytoConfig::band_window, (float)rate_sps, PhytoConfig::band_edges_hz,
+                               PhytoConfig::band_count);
+
+    printf("%.0f SPS per channel, window %u samples (%.2f s, %.3f Hz per bin), %u bands, %u bins per channel\n\n",
+           rate_sps, PhytoConfig::band_window, n / rate_sps, resolution, PhytoConfig::band_count, analyzer.bins());
+
+    // Frequencies inside the bands: on a bin, between two bins, and spread over all bands
+    const double low = PhytoConfig::band_edges_hz[0];
+    const double high = PhytoConfig::band_edges_hz[PhytoConfig::band_count];
+    const double on_bin = std::ceil((low + high) / 2 / resolution) * resolution;
+    const double off_bin = on_bin + 0.37 * resolution;
+    std::mt19937 random(1);
+    std::normal_distribution<double> noise(0, 0.05);
+    auto t = [rate_sps](uint64_t i) { return i / rate_sps; };
+
+    struct TestSignal {
+        const char* name;
+        Signal ch0;
+        Signal ch1;
+    };
+    std::vector<TestSignal> signals = {
+        {"tone on bin", [&](uint64_t i) { return 10 * sin(2 * M_PI * on_bin * t(i)); },
+                        [&](uint64_t i) { return 3 * cos(2 * M_PI * on_bin * t(i)); }},
+        {"tone off bin", [&](uint64_t i) { return 10 * sin(2 * M_PI * off_bin * t(i)); },
+                         [&](uint64_t i) { return 10 * sin(2 * M_PI * (low + 0.1 * resolution) * t(i)); }},
+        {"tones and noise", [&](uint64_t i) {
+             double sum = noise(random);
+             for (unsigned int band = 0; band < PhytoConfig::band_count; band++) {
+                 double f = (PhytoConfig::band_edges_hz[band] + PhytoConfig::band_edges_hz[band + 1]) / 2;
+                 sum += (band + 1) * sin(2 * M_PI * f * t(i) + band);
+             }
+             return sum;
+         },
+         [&](uint64_t) { return noise(random); }},
+        {"offset and drift", [&](uint64_t i) { return 250 + 5 * sin(2 * M_PI * t(i) / 600) + 2 * sin(2 * M_PI * off_bin * t(i)); },
+                             [&](uint64_t i) { return -180 + 0.01 * i / rate_sps + noise(random); }},
+    };
+
+    bool ok = true;
+    printf("%-18s %8s %14s %12s\n", "signal", "windows", "max rel error", "frame");
+    for (const TestSignal& signal : signals) {
+        AccuracyResult result = check_signal(signal.ch0, signal.ch1, windows, rate_sps);
+        bool passed = result.max_error <= MAX_RELATIVE_ERROR && result.round_trip;
+        printf("%-18s %8u %14.2e %12s  %s\n", signal.name, result.windows, result.max_error,
+               result.round_trip ? "ok" : "MISMATCH", passed ? "ok" : "FAIL");
+        ok &= passed;
+    }
+
+    // Cost per sample, alternating the channels like the sequencer
+    std::vector<float> input(4096);
+    for (size_t i = 0; i < input.size(); i++) {
+        input[i] = adc_millivolts(250 + 10 * sin(2 * M_PI * on_bin * t(i / 2)));
+    }
+    uint32_t windows_done = 0;
+    Clock::time_point start = Clock::now();
+    uint64_t start_cycles = read_cycles();
+    for (size_t i = 0; i < samples; i++) {
+        windows_done += analyzer.push(i & 1, input[i % input.size()]) ? 1 : 0;
+    }
+    uint64_t end_cycles = read_cycles();
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / samples;
+    double cycles = (double)(end_cycles - start_cycles) / samples;
+
+    double odr = rate_sps * PhytoConfig::channels;
+    double budget = NODE_CPU_CLOCK_HZ / odr;
+    double node_cycles = analyzer.bins() * NODE_CYCLES_PER_BIN + NODE_CYCLES_PER_SAMPLE;
+    printf("\nhost:             %.1f ns, %.0f TSC cycles per sample (%u windows)\n", ns, cycles, windows_done);
+    printf("node estimate:    %.0f cycles per sample, budget %.0f cycles at %.0f samples/s (%.2f%% CPU)\n",
+           node_cycles, budget, odr, 100.0 * node_cycles / budget);
+    printf("band frame:       %zu bytes per window, %.1f B/s\n",
+           SERIAL_MAIL_HEADER_SIZE + band_frame_payload_size(PhytoConfig::band_count),
+           (SERIAL_MAIL_HEADER_SIZE + band_frame_payload_size(PhytoConfig::band_count)) * rate_sps / n);
+    return ok ? 0 : 1;
+}
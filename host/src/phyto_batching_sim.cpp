@@ -0,0 +1,328 @@
+/**
+ * @file phyto_batching_sim.cpp
+ * @brief Simulates fixed and adaptive frame batching against links of different rate.
+ *
+ * @details
+ * The node's `SampleCollector`, `AdaptiveBatcher`, `FrameBuilder` and
+ * `FrameSink` run against a link that takes a fixed number of bytes per
+ * simulation step, with conversions arriving at the rate of the configured
+ * preset. Fixed batching is an `AdaptiveBatcher` whose bounds are equal and
+ * whose deadline never expires, which is exactly the node without
+ * `ADAPTIVE_BATCHING`; the adaptive setting uses the bounds and deadline of
+ * the preset.
+ *
+ * For every link rate and setting the tool reports the share of samples that
+ * reached the host, the mean frame size, the wire rate and the p50/p99
+ * latency from acquisition of a sample to the last byte of its frame leaving
+ * the link. Samples of frames dropped by the sink's backpressure policy count
+ * as lost and are not part of the latency figures; the partial frame left in
+ * the collector when acquisition stops is not counted at all.
+ *
+ * The tool exits with 1 if the adaptive setting delivers a smaller share
+ * than the best fixed setting at any link rate, or has a higher p99 latency
+ * than fixed `vector_size` frames on a link that carries every fixed setting
+ * without drops.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "adc/SampleCollector.h"
+#include "config/PipelineConfig.h"
+#include "serial_mail_sender/AdaptiveBatcher.h"
+#include "serial_mail_sender/FrameBuilder.h"
+#include "transport/FrameBuffer.h"
+#include "transport/FrameSink.h"
+
+/// Simulated time per link rate and setting.
+#define DEFAULT_DURATION_S 120
+
+/// Simulation step in ms; the link takes its bytes and the sink is serviced once per step.
+#define DEFAULT_STEP_MS 1
+
+/// Deadline of the fixed settings, which only send full frames.
+#define NO_DEADLINE_MS UINT32_MAX
+
+/// Share of the samples, in percentage points, the adaptive setting may deliver less than the best fixed one.
+#define ADAPTIVE_DELIVERY_TOLERANCE 1.0
+
+/**
+ * @struct BatchSetting
+ * @brief One batching configuration compared by the simulation.
+ */
+struct BatchSetting {
+    std::string  name;          ///< Label in the report.
+    unsigned int min_samples;   ///< Smallest frame.
+    unsigned int max_samples;   ///< Largest frame.
+    unsigned int initial;       ///< Frame size until the first backlog report.
+    uint32_t     deadline_ms;   ///< Latency bound of a partial frame.
+};
+
+/**
+ * @struct SimFrame
+ * @brief Samples carried by a frame that sits in a pooled buffer.
+ */
+struct SimFrame {
+    const uint8_t* begin;       ///< Pooled buffer holding the frame.
+    const uint8_t* end;         ///< One past the last byte of the frame.
+    double         first_s;     ///< Acquisition time of the oldest sample pair.
+    unsigned int   pairs;       ///< Sample pairs in the frame.
+};
+
+/**
+ * @struct SimResult
+ * @brief Outcome of one run.
+ */
+struct SimResult {
+    uint64_t            offered_pairs;      ///< Sample pairs put into frames.
+    uint64_t            delivered_pairs;    ///< Sample pairs whose frame left the link.
+    uint64_t            frames;             ///< Frames built.
+    uint64_t            dropped_frames;     ///< Frames discarded by the sink.
+    uint64_t            wire_bytes;         ///< Bytes written to the link.
+    std::vector<float>  latencies_ms;       ///< Latency of every delivered sample pair.
+};
+
+/**
+ * @class SimLink
+ * @brief Sink that takes as many bytes as the link rate allows in the current step.
+ *
+ * Its budget covers a whole queue, so `FrameSink::service` always offers the
+ * rest of the oldest frame; a write that takes everything offered completes
+ * that frame, and the end of the written bytes identifies it.
+ */
+class SimLink : public FrameSink {
+public:
+    SimLink(void)
+        : FrameSink("sim", BACKPRESSURE_DROP_OLDEST, FRAME_SINK_QUEUE_DEPTH * FRAME_BUFFER_CAPACITY),
+          m_credit(0) {}
+
+    /// Adds the bytes the link can carry during one step; an idle link saves at most one byte.
+    void grant(double bytes) { m_credit = std::min(m_credit + bytes, std::max(bytes, 1.0)); }
+
+    /// Frames completed since the last call, identified by their end.
+    std::vector<const uint8_t*>& completed(void) { return m_completed; }
+
+protected:
+    size_t writeSome(const uint8_t* data, size_t size) override {
+        size_t written = std::min(size, (size_t)m_credit);
+        m_credit -= (double)written;
+        if (written == size) {
+            m_completed.push_back(data + size);
+        }
+        return written;
+    }
+
+private:
+    double                      m_credit;       ///< Bytes the link still takes in this step.
+    std::vector<const uint8_t*> m_completed;    ///< Ends of completed frames.
+};
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  -r <sps>      conversions per second and channel (default: preset rate)\n"
+        "  -l <B/s,...>  link rates (default: multiples of the raw sample payload)\n"
+        "  -d <ms>       deadline of the adaptive setting (default: preset)\n"
+        "  -t <s>        simulated time per run (default %d)\n"
+        "  -p <ms>       simulation step (default %d)\n",
+        program, DEFAULT_DURATION_S, DEFAULT_STEP_MS);
+}
+
+static std::vector<double> parse_list(const std::string& text) {
+    std::vector<double> values;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        values.push_back(std::stod(item));
+    }
+    return values;
+}
+
+/**
+ * @brief Runs one setting against one link rate.
+ */
+static SimResult simulate(const BatchSetting& setting, double rate_sps, double link_rate, double duration_s,
+                          double step_s) {
+    AdaptiveBatcher batcher(setting.min_samples, setting.max_samples, setting.initial, setting.deadline_ms);
+    SampleCollector collector(batcher.maxSamples());
+    FrameBuilder builder;
+    FramePool pool;
+    SimLink link;
+    std::vector<SimFrame> frames;
+    SimResult result{0, 0, 0, 0, 0, {}};
+
+    const double word_period_s = 1.0 / (2 * rate_sps);
+    uint64_t word = 0;
+    double batch_start_s = 0;
+
+    // Acquisition stops after `duration_s`; the link then drains what is queued
+    for (double now = 0; now < duration_s || link.queued() > 0; now += step_s) {
+        // Conversions of this step, channel 0 and 1 alternating like the sequencer
+        double acquire_until_s = std::min(now + step_s, duration_s);
+        for (double t = word * word_period_s; t < acquire_until_s; t = ++word * word_period_s) {
+            uint8_t data[AD7124_CONVERSION_WORD_SIZE] = {(uint8_t)(word >> 16), (uint8_t)(word >> 8),
+                                                         (uint8_t)word, (uint8_t)(word % 2)};
+            if (collector.ch0().empty() && collector.ch1().empty()) {
+                batch_start_s = t;
+            }
+            collector.push(data);
+            uint32_t age_ms = (uint32_t)((t - batch_start_s) * 1000);
+            if (!collector.paired() || !batcher.due(collector.size(), age_ms)) {
+                continue;
+            }
+
+            // What SerialMailSender::sendMail does with ADAPTIVE_BATCHING
+            batcher.onBacklog(link.queued());
+            result.offered_pairs += collector.size();
+            FrameRef frame = pool.allocate();
+            if (frame) {
+                size_t size = builder.build(collector.ch0(), collector.ch1(), PhytoConfig::node,
+                                            frame.mutableData(), FRAME_BUFFER_CAPACITY);
+                frame.setSize(size);
+                // A reused buffer means its previous frame was dropped or delivered
+                frames.erase(std::remove_if(frames.begin(), frames.end(),
+                                            [&](const SimFrame& f) { return f.begin == frame.data(); }),
+                             frames.end());
+                frames.push_back({frame.data(), frame.data() + size, batch_start_s, collector.size()});
+                link.offer(frame);
+                result.frames++;
+            }
+            link.service();
+            collector.clear();
+        }
+
+        link.grant(link_rate * step_s);
+        link.service();
+
+        double delivered_s = now + step_s;
+        for (const uint8_t* end : link.completed()) {
+            auto it = std::find_if(frames.begin(), frames.end(), [&](const SimFrame& f) { return f.end == end; });
+            if (it == frames.end()) {
+                continue;
+            }
+            for (unsigned int pair = 0; pair < it->pairs; pair++) {
+                double acquired_s = it->first_s + pair * 2 * word_period_s;
+                result.latencies_ms.push_back((float)((delivered_s - acquired_s) * 1000));
+            }
+            result.delivered_pairs += it->pairs;
+            frames.erase(it);
+        }
+        link.completed().clear();
+    }
+
+    result.dropped_frames = link.stats().dropped;
+    result.wire_bytes = link.stats().bytes;
+    return result;
+}
+
+static float percentile(std::vector<float>& values, double fraction) {
+    if (values.empty()) {
+        return 0;
+    }
+    size_t index = std::min(values.size() - 1, (size_t)(fraction * values.size()));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+int main(int argc, char** argv) {
+    double rate_sps = ad7124_rate_sps(PhytoConfig::power_mode, PhytoConfig::channels, PhytoConfig::filter_fs);
+    std::vector<double> link_rates;
+    uint32_t deadline_ms = PhytoConfig::batch_deadline_ms;
+    double duration_s = DEFAULT_DURATION_S;
+    double step_ms = DEFAULT_STEP_MS;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            print_usage(argv[0]);
+            return 2;
+        }
+        if (arg == "-r") {
+            rate_sps = std::stod(argv[++i]);
+        } else if (arg == "-l") {
+            link_rates = parse_list(argv[++i]);
+        } else if (arg == "-d") {
+            deadline_ms = (uint32_t)std::stoul(argv[++i]);
+        } else if (arg == "-t") {
+            duration_s = std::stod(argv[++i]);
+        } else if (arg == "-p") {
+            step_ms = std::stod(argv[++i]);
+        } else {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+    if (rate_sps <= 0 || duration_s <= 0 || step_ms <= 0) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    // Raw payload of both channels; framing overhead comes on top
+    double payload_rate = rate_sps * PhytoConfig::channels * 3;
+    if (link_rates.empty()) {
+        for (double factor : {1.1, 1.5, 2.0, 4.0, 16.0}) {
+            link_rates.push_back(payload_rate * factor);
+        }
+    }
+
+    const unsigned int min_samples = PhytoConfig::batch_min_samples;
+    const unsigned int max_samples = PhytoConfig::batch_max_samples;
+    const unsigned int vector_size = PhytoConfig::vector_size;
+    std::vector<BatchSetting> settings = {
+        {"fixed " + std::to_string(min_samples), min_samples, min_samples, min_samples, NO_DEADLINE_MS},
+        {"fixed " + std::to_string(vector_size), vector_size, vector_size, vector_size, NO_DEADLINE_MS},
+        {"fixed " + std::to_string(max_samples), max_samples, max_samples, max_samples, NO_DEADLINE_MS},
+        {"adaptive " + std::to_string(min_samples) + "-" + std::to_string(max_samples) + " @" +
+             std::to_string(deadline_ms) + "ms",
+         min_samples, max_samples, vector_size, deadline_ms},
+    };
+
+    printf("%.0f SPS per channel, raw payload %.0f B/s, %.0f s per run, %.1f ms steps\n\n", rate_sps, payload_rate,
+           duration_s, step_ms);
+    printf("%10s  %-24s %9s %8s %10s %10s %9s %9s\n", "link B/s", "setting", "frames/s", "samples", "delivered",
+           "wire B/s", "p50 ms", "p99 ms");
+
+    bool passed = true;
+    for (double link_rate : link_rates) {
+        double best_fixed = 0;
+        bool all_fixed_delivered = true;
+        float default_p99 = 0;
+        for (const BatchSetting& setting : settings) {
+            SimResult result = simulate(setting, rate_sps, link_rate, duration_s, step_ms / 1000);
+            double delivered = result.offered_pairs > 0 ? 100.0 * result.delivered_pairs / result.offered_pairs : 0;
+            double mean_samples = result.frames > 0 ? (double)result.offered_pairs / result.frames : 0;
+            float p50 = percentile(result.latencies_ms, 0.50);
+            float p99 = percentile(result.latencies_ms, 0.99);
+            printf("%10.0f  %-24s %9.2f %8.1f %9.1f%% %10.0f %9.1f %9.1f\n", link_rate, setting.name.c_str(),
+                   result.frames / duration_s, mean_samples, delivered, result.wire_bytes / duration_s, p50, p99);
+
+            if (setting.deadline_ms == NO_DEADLINE_MS) {
+                best_fixed = std::max(best_fixed, delivered);
+                all_fixed_delivered &= result.dropped_frames == 0;
+                if (setting.max_samples == vector_size) {
+                    default_p99 = p99;
+                }
+                continue;
+            }
+            // Growing frames on a backed-up link must deliver as much as the best fixed size,
+            // shrinking them on an idle link must not be slower than the node without batching
+            if (delivered < best_fixed - ADAPTIVE_DELIVERY_TOLERANCE) {
+                fprintf(stderr, "%.0f B/s: adaptive setting delivers %.1f%%, fixed up to %.1f%%\n", link_rate,
+                        delivered, best_fixed);
+                passed = false;
+            }
+            if (all_fixed_delivered && p99 > default_p99) {
+                fprintf(stderr, "%.0f B/s: adaptive p99 %.1f ms above %.1f ms of fixed %u\n", link_rate, p99,
+                        default_p99, vector_size);
+                passed = false;
+            }
+        }
+        printf("\n");
+    }
+    printf("%s\n", passed ? "PASS" : "FAIL");
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,147 @@
+/**
+ * @file phyto_capture.cpp
+ * @brief Records what a PhytoNode sends into an indexed capture file.
+ *
+ * @details
+ * - `--frames` (default) records every verified serial mail frame together with
+ *   the host receive time.
+ * - `--spi` records the raw AD7124 conversion words streamed by firmware built
+ *   with `CAPTURE_SPI_WORDS`, keeping the node's own microsecond timestamps.
+ *
+ * Recording stops on end of input or Ctrl-C; the seek index is written then.
+ */
+
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <string>
+#include <unistd.h>
+
+#include "capture/CaptureFile.h"
+#include "capture/CaptureStreamParser.h"
+#include "stream_decoder/StreamDecoder.h"
+#include "utils/MappedFile.h"
+#include "utils/SerialPort.h"
+
+/// Default UART baud rate of the node.
+#define DEFAULT_BAUDRATE 115200
+
+/// Read size used for serial devices.
+#define SERIAL_READ_SIZE 4096
+
+/// Set by the signal handler to stop recording.
+static volatile sig_atomic_t stop_requested = 0;
+
+static void handle_signal(int) {
+    stop_requested = 1;
+}
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+        "usage: %s [options] -o <capture> <serial-device|raw-file>\n"
+        "  --frames      record serial mail frames (default)\n"
+        "  --spi         record raw SPI conversion words (CAPTURE_SPI_WORDS firmware)\n"
+        "  -b <baud>     baud rate for serial devices (default %d)\n"
+        "  -n <node>     node id stored in the capture header\n",
+        program, DEFAULT_BAUDRATE);
+}
+
+/**
+ * @brief Feeds the input into `consume` until end of input or Ctrl-C.
+ *
+ * Raw files are mapped and fed at once, serial devices are read until the
+ * device closes or a signal interrupts `read`.
+ */
+template <typename Consumer>
+static void read_input(const std::string& input, int baudrate, Consumer consume) {
+    if (!is_character_device(input)) {
+        MappedFile file(input);
+        consume(file.bytes());
+        return;
+    }
+
+    int fd = open_serial_port(input, baudrate);
+    uint8_t buffer[SERIAL_READ_SIZE];
+    while (!stop_requested) {
+        ssize_t received = read(fd, buffer, sizeof(buffer));
+        if (received <= 0) {
+            if (received < 0 && errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        consume(std::span<const uint8_t>(buffer, (size_t)received));
+    }
+    close(fd);
+}
+
+int main(int argc, char** argv) {
+    std::string input;
+    std::string output;
+    bool spi = false;
+    int baudrate = DEFAULT_BAUDRATE;
+    uint16_t node = 0;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc) {
+            output = argv[++i];
+        } else if (arg == "-b" && i + 1 < argc) {
+            baudrate = std::stoi(argv[++i]);
+        } else if (arg == "-n" && i + 1 < argc) {
+            node = (uint16_t)std::stoi(argv[++i]);
+        } else if (arg == "--spi") {
+            spi = true;
+        } else if (arg == "--frames") {
+            spi = false;
+        } else if (!arg.empty() && arg[0] != '-' && input.empty()) {
+            input = arg;
+        } else {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+    if (input.empty() || output.empty()) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    // No SA_RESTART, so a blocking read returns EINTR and the index gets written
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handle_signal;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    try {
+        CaptureWriter writer(output, spi ? CAPTURE_KIND_SPI_WORDS : CAPTURE_KIND_FRAMES, node);
+
+        if (spi) {
+            CaptureStreamParser parser([&writer](const CaptureRecordHeader& header, std::span<const uint8_t> payload) {
+                if (header.kind == CAPTURE_KIND_SPI_WORDS) {
+                    writer.appendRecord(header, payload);
+                }
+            });
+            read_input(input, baudrate, [&parser](std::span<const uint8_t> chunk) { parser.feed(chunk); });
+            fprintf(stderr, "records: %u, rejected: %u\n", writer.recordCount(), parser.rejectedRecords());
+        } else {
+            auto start = std::chrono::steady_clock::now();
+            StreamDecoder decoder([&](const DecodedFrame& decoded) {
+                auto now = std::chrono::steady_clock::now();
+                writer.append(decoded.frame, std::chrono::duration_cast<std::chrono::microseconds>(now - start).count());
+            });
+            read_input(input, baudrate, [&decoder](std::span<const uint8_t> chunk) { decoder.feed(chunk); });
+            fprintf(stderr, "records: %u, skipped bytes: %llu\n", writer.recordCount(),
+                    (unsigned long long)decoder.stats().skipped_bytes);
+        }
+
+        writer.finalize();
+    } catch (const std::exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,385 @@
+/**
+ * @file phyto_clock_sync_sim.cpp
+ * @brief Simulates clock synchronization of several nodes over a day.
+ *
+ * @details
+ * Every node has its own crystal: a constant rate error drawn from
+ * `[-drift, drift]` ppm, a random walk of the rate (`--wander`, ppm per
+ * square root of an hour) and a daily temperature swing (`--temp`, ppm
+ * amplitude, scaled per node). The node clock is integrated second by second
+ * and interpolated in between.
+ *
+ * The exchanges run through the same code as on the link: the `SyncMaster`
+ * of the aggregator writes the request, the node finds it byte by byte with
+ * its `SyncRequestParser`, `ClockSync` answers, and the response is decoded by
+ * the `StreamDecoder`. The link adds per direction the serialization time at
+ * `-b` baud, a fixed latency, exponential jitter and, uplink, the wait behind
+ * the frame on the line (at the preset's frame rate). The node stamps the
+ * arrival in the UART interrupt; while frames are sent, a TX event may stamp
+ * it later, up to the duration of the request. Its main loop answers up to
+ * 5 ms later. Requests and responses are lost with probability `--loss`.
+ *
+ * Ten times per second each node converts its clock into host time like it
+ * stamps a frame; the difference to the true host time is its error. The
+ * tool reports per node the time until it was synchronized, the largest and
+ * RMS error, and the error at the end, next to a free-running clock that was
+ * only set at startup. The alignment error is the largest difference between
+ * the errors of any two nodes at the same instant, i.e. how far apart two
+ * samples taken at the same time are stamped; the link asymmetry shifts all
+ * nodes alike and only shows in the absolute error. The tool fails if the
+ * alignment error exceeds `--max-error-us` once all nodes are synchronized.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "aggregator/SyncMaster.h"
+#include "config/PipelineConfig.h"
+#include "serial_mail_sender/FrameFormat.h"
+#include "stream_decoder/StreamDecoder.h"
+#include "timing/ClockSync.h"
+
+/// Default number of nodes.
+#define DEFAULT_NODES 4
+
+/// Default simulated time in hours.
+#define DEFAULT_HOURS 24
+
+/// Default interval of the sync requests in seconds.
+#define DEFAULT_SYNC_INTERVAL_S 10
+
+/// Default largest constant rate error in ppm.
+#define DEFAULT_DRIFT_PPM 50
+
+/// Default random walk of the rate in ppm per square root of an hour.
+#define DEFAULT_WANDER_PPM 0.05
+
+/// Default amplitude of the daily temperature swing of the rate in ppm.
+#define DEFAULT_TEMP_PPM 5
+
+/// Default fixed one-way latency of the link in µs, without serialization.
+#define DEFAULT_LATENCY_US 200
+
+/// Default mean of the exponential one-way jitter in µs.
+#define DEFAULT_JITTER_US 300
+
+/// Default probability that a request or response is lost.
+#define DEFAULT_LOSS 0.01
+
+/// Default largest accepted alignment error in µs.
+#define DEFAULT_MAX_ERROR_US 1000
+
+/// Default UART baud rate.
+#define DEFAULT_BAUDRATE 115200
+
+/// Host time at the start of the simulation, in µs since the epoch.
+#define HOST_EPOCH_US 1700000000000000.0
+
+/// Simulation step and evaluation period in seconds, like the aggregator's event loop.
+#define TICK_S 0.1
+
+/// Longest time a request waits on the node before its main loop reads it, in seconds.
+#define NODE_POLL_S 0.005
+
+/// Interrupt latency of the arrival stamp on the node, in seconds.
+#define NODE_IRQ_LATENCY_S 2e-6
+
+/// Time from T2 to T3 on the node, in seconds.
+#define NODE_TURNAROUND_S 20e-6
+
+/// Bits per byte on the UART (8N1).
+#define UART_BITS_PER_BYTE 10
+
+/**
+ * @struct LinkModel
+ * @brief Delays of one direction of the serial link.
+ */
+struct LinkModel {
+    double baudrate;
+    double latency_s;
+    double jitter_s;
+    double loss;
+    double frame_busy;      ///< Fraction of time the node's TX line carries frames.
+    double frame_s;         ///< Transmission time of one frame.
+};
+
+/**
+ * @class NodeCrystal
+ * @brief Node clock in µs as a function of true time, integrated per second.
+ */
+class NodeCrystal {
+public:
+    NodeCrystal(double seconds, double drift_ppm, double wander_ppm, double temp_ppm, double boot_us,
+                std::mt19937_64& rng)
+        : m_drift_ppm(drift_ppm) {
+        size_t steps = (size_t)std::ceil(seconds) + 2;
+        m_local.resize(steps + 1);
+        m_rate.resize(steps);
+        std::normal_distribution<double> walk(0.0, wander_ppm / std::sqrt(3600.0));
+        double wander = 0;
+        double phase = std::uniform_real_distribution<double>(0, 2 * M_PI)(rng);
+        m_local[0] = boot_us;
+        for (size_t k = 0; k < steps; k++) {
+            double temperature = temp_ppm * std::sin(2 * M_PI * k / 86400.0 + phase);
+            m_rate[k] = 1.0 + (drift_ppm + wander + temperature) * 1e-6;
+            m_local[k + 1] = m_local[k] + 1e6 * m_rate[k];
+            wander += walk(rng);
+        }
+    }
+
+    /// Node time at true time `t` seconds after the start.
+    double at(double t) const {
+        size_t k = std::min((size_t)t, m_rate.size() - 1);
+        return m_local[k] + (t - k) * 1e6 * m_rate[k];
+    }
+
+    double driftPpm(void) const { return m_drift_ppm; }
+
+private:
+    double m_drift_ppm;
+    std::vector<double> m_local;
+    std::vector<double> m_rate;
+};
+
+/**
+ * @struct NodeResult
+ * @brief Figures of one simulated node.
+ */
+struct NodeResult {
+    double   drift_ppm;
+    double   synced_after_s;    ///< Time until frames carried host time, negative if never.
+    uint32_t exchanges;         ///< Exchanges the node completed.
+    uint32_t missed;            ///< Exchanges lost on the link.
+    double   max_error_us;
+    double   rms_error_us;
+    double   final_error_us;    ///< Error at the end of the run.
+    double   free_error_us;     ///< Error of a clock set once at startup, at the end of the run.
+    int32_t  skew_ppb;          ///< Final skew estimate of the node.
+};
+
+/**
+ * @brief Runs one node for the whole time and records its error per tick.
+ * @param errors Error per tick in µs, NaN while not synchronized.
+ */
+static NodeResult simulate_node(int node, const NodeCrystal& crystal, double seconds, double interval_s,
+                                const LinkModel& link, std::mt19937_64& rng, std::vector<double>& errors) {
+    auto host_us = [](double t) { return HOST_EPOCH_US + t * 1e6; };
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::exponential_distribution<double> jitter(1.0 / link.jitter_s);
+
+    ClockSync clock_sync;
+    SyncRequestParser parser;
+    SyncMaster master((uint64_t)(interval_s * 1e6));
+    uint64_t t4_us = 0;
+    StreamDecoder decoder(nullptr);
+    decoder.setSyncHandler([&](const SyncResponse& response) { master.onResponse(response, t4_us); });
+
+    NodeResult result{crystal.driftPpm(), -1, 0, 0, 0, 0, 0, 0, 0};
+    double free_offset = host_us(0) - crystal.at(0);
+    double sum_squares = 0;
+    size_t synced_ticks = 0;
+    size_t ticks = (size_t)(seconds / TICK_S);
+    errors.assign(ticks, NAN);
+
+    // Nodes start at random phases of the request schedule
+    double start_s = uniform(rng) * TICK_S * 10;
+    for (size_t tick = 0; tick < ticks; tick++) {
+        double t = start_s + tick * TICK_S;
+        uint64_t now_us = (uint64_t)std::llround(host_us(t));
+        if (master.due(now_us)) {
+            uint8_t request[SERIAL_MAIL_HEADER_SIZE + SYNC_REQUEST_SIZE];
+            size_t size = master.makeRequest(now_us, request, sizeof(request));
+            bool received = false;
+            if (uniform(rng) >= link.loss) {
+                for (size_t i = 0; i < size; i++) {
+                    received |= parser.feed(request[i]);
+                }
+            }
+            if (received) {
+                double request_s = size * UART_BITS_PER_BYTE / link.baudrate;
+                double arrival = t + request_s + link.latency_s + jitter(rng);
+                double stamped = arrival + NODE_IRQ_LATENCY_S;
+                if (uniform(rng) < link.frame_busy) {
+                    stamped += uniform(rng) * request_s;
+                }
+                double sent = arrival + uniform(rng) * NODE_POLL_S + NODE_TURNAROUND_S;
+                SyncResponse answer = clock_sync.respond(parser.request(),
+                                                         (uint64_t)std::llround(crystal.at(stamped)),
+                                                         (uint64_t)std::llround(crystal.at(sent)), node);
+
+                uint8_t response[SERIAL_MAIL_HEADER_SIZE + SYNC_RESPONSE_SIZE];
+                size_t response_size = write_sync_response(answer, response, sizeof(response));
+                if (uniform(rng) >= link.loss) {
+                    double queued = uniform(rng) < link.frame_busy ? uniform(rng) * link.frame_s : 0;
+                    double arrived = sent + queued + response_size * UART_BITS_PER_BYTE / link.baudrate +
+                                     link.latency_s + jitter(rng);
+                    t4_us = (uint64_t)std::llround(host_us(arrived));
+                    decoder.feed({response, response_size});
+                }
+            }
+        }
+
+        if (!clock_sync.synced()) {
+            continue;
+        }
+        if (result.synced_after_s < 0) {
+            result.synced_after_s = t;
+        }
+        double error = (double)clock_sync.toHostTime((uint64_t)std::llround(crystal.at(t))) - host_us(t);
+        errors[tick] = error;
+        result.max_error_us = std::max(result.max_error_us, std::fabs(error));
+        sum_squares += error * error;
+        synced_ticks++;
+        result.final_error_us = error;
+        result.free_error_us = crystal.at(t) + free_offset - host_us(t);
+    }
+
+    result.exchanges = master.stats().responses;
+    result.missed = clock_sync.missedExchanges();
+    result.rms_error_us = synced_ticks > 0 ? std::sqrt(sum_squares / synced_ticks) : 0;
+    result.skew_ppb = clock_sync.skewPpb();
+    return result;
+}
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  -n <nodes>          number of nodes (default %d)\n"
+        "  -t <hours>          simulated time (default %d)\n"
+        "  --sync <s>          interval of the sync requests (default %d)\n"
+        "  --drift <ppm>       largest constant rate error of a node (default %d)\n"
+        "  --wander <ppm>      random walk of the rate per square root of an hour (default %.2f)\n"
+        "  --temp <ppm>        amplitude of the daily temperature swing of the rate (default %d)\n"
+        "  --latency <us>      fixed one-way link latency without serialization (default %d)\n"
+        "  --jitter <us>       mean exponential one-way jitter (default %d)\n"
+        "  --loss <p>          probability that a request or response is lost (default %.2f)\n"
+        "  -b <baud>           UART baud rate (default %d)\n"
+        "  --max-error-us <us> largest accepted alignment error between nodes (default %d)\n"
+        "  -s <seed>           random seed (default 1)\n",
+        program, DEFAULT_NODES, DEFAULT_HOURS, DEFAULT_SYNC_INTERVAL_S, DEFAULT_DRIFT_PPM, DEFAULT_WANDER_PPM,
+        DEFAULT_TEMP_PPM, DEFAULT_LATENCY_US, DEFAULT_JITTER_US, DEFAULT_LOSS, DEFAULT_BAUDRATE,
+        DEFAULT_MAX_ERROR_US);
+}
+
+int main(int argc, char** argv) {
+    unsigned int nodes = DEFAULT_NODES;
+    double hours = DEFAULT_HOURS;
+    double interval_s = DEFAULT_SYNC_INTERVAL_S;
+    double drift_ppm = DEFAULT_DRIFT_PPM;
+    double wander_ppm = DEFAULT_WANDER_PPM;
+    double temp_ppm = DEFAULT_TEMP_PPM;
+    double latency_us = DEFAULT_LATENCY_US;
+    double jitter_us = DEFAULT_JITTER_US;
+    double loss = DEFAULT_LOSS;
+    double baudrate = DEFAULT_BAUDRATE;
+    double max_error_us = DEFAULT_MAX_ERROR_US;
+    uint64_t seed = 1;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-n" && i + 1 < argc) {
+            nodes = (unsigned int)std::stoul(argv[++i]);
+        } else if (arg == "-t" && i + 1 < argc) {
+            hours = std::stod(argv[++i]);
+        } else if (arg == "--sync" && i + 1 < argc) {
+            interval_s = std::stod(argv[++i]);
+        } else if (arg == "--drift" && i + 1 < argc) {
+            drift_ppm = std::stod(argv[++i]);
+        } else if (arg == "--wander" && i + 1 < argc) {
+            wander_ppm = std::stod(argv[++i]);
+        } else if (arg == "--temp" && i + 1 < argc) {
+            temp_ppm = std::stod(argv[++i]);
+        } else if (arg == "--latency" && i + 1 < argc) {
+            latency_us = std::stod(argv[++i]);
+        } else if (arg == "--jitter" && i + 1 < argc) {
+            jitter_us = std::stod(argv[++i]);
+        } else if (arg == "--loss" && i + 1 < argc) {
+            loss = std::stod(argv[++i]);
+        } else if (arg == "-b" && i + 1 < argc) {
+            baudrate = std::stod(argv[++i]);
+        } else if (arg == "--max-error-us" && i + 1 < argc) {
+            max_error_us = std::stod(argv[++i]);
+        } else if (arg == "-s" && i + 1 < argc) {
+            seed = std::stoull(argv[++i]);
+        } else {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+    if (nodes < 1 || hours <= 0 || interval_s < TICK_S || jitter_us <= 0 || loss < 0 || loss >= 1 ||
+        baudrate <= 0) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    // Frames of the preset as timed raw frames, the uplink traffic a response may wait behind
+    double rate_sps = ad7124_rate_sps(PhytoConfig::power_mode, PhytoConfig::channels, PhytoConfig::filter_fs);
+    double frame_bytes = SERIAL_MAIL_HEADER_SIZE + raw_frame_timed_payload_size(PhytoConfig::vector_size);
+    double frame_s = frame_bytes * UART_BITS_PER_BYTE / baudrate;
+    double frames_per_s = rate_sps / PhytoConfig::vector_size * PhytoConfig::devices;
+    LinkModel link{baudrate, latency_us * 1e-6, jitter_us * 1e-6, loss, std::min(1.0, frames_per_s * frame_s),
+                   frame_s};
+
+    printf("%u nodes, %.1f h, sync every %.1f s, drift up to %.0f ppm, wander %.2f ppm/sqrt(h), temperature %.1f ppm\n",
+           nodes, hours, interval_s, drift_ppm, wander_ppm, temp_ppm);
+    printf("link: %.0f baud, latency %.0f us, jitter %.0f us, loss %.1f%%, line busy %.0f%% with frames of %.2f ms\n\n",
+           baudrate, latency_us, jitter_us, 100 * loss, 100 * link.frame_busy, 1e3 * frame_s);
+    printf("%5s %10s %10s %10s %8s %12s %12s %12s %14s %12s\n", "node", "drift ppm", "skew ppm", "synced s",
+           "missed", "max |err| us", "rms err us", "end err us", "free-run end us", "exchanges");
+
+    double seconds = hours * 3600;
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> spread(-1.0, 1.0);
+    std::vector<double> min_error;
+    std::vector<double> max_error;
+    std::vector<double> errors;
+    double all_synced_s = 0;
+    bool all_synced = true;
+    for (unsigned int node = 0; node < nodes; node++) {
+        NodeCrystal crystal(seconds + 2, drift_ppm * spread(rng), wander_ppm, temp_ppm * (0.5 + 0.5 * spread(rng)),
+                            1e9 * (1.0 + spread(rng)), rng);
+        NodeResult result = simulate_node((int)node + 1, crystal, seconds, interval_s, link, rng, errors);
+        if (node == 0) {
+            min_error.assign(errors.size(), INFINITY);
+            max_error.assign(errors.size(), -INFINITY);
+        }
+        for (size_t i = 0; i < errors.size(); i++) {
+            if (!std::isnan(errors[i])) {
+                min_error[i] = std::min(min_error[i], errors[i]);
+                max_error[i] = std::max(max_error[i], errors[i]);
+            } else {
+                min_error[i] = NAN;
+            }
+        }
+        all_synced &= result.synced_after_s >= 0;
+        all_synced_s = std::max(all_synced_s, result.synced_after_s);
+        printf("%5u %10.2f %10.3f %10.1f %8u %12.1f %12.1f %12.1f %14.0f %12u\n", node + 1, result.drift_ppm,
+               result.skew_ppb / 1000.0, result.synced_after_s, result.missed, result.max_error_us,
+               result.rms_error_us, result.final_error_us, result.free_error_us, result.exchanges);
+    }
+
+    double alignment = 0;
+    double final_hour_alignment = 0;
+    size_t final_hour = errors.size() > (size_t)(3600 / TICK_S) ? errors.size() - (size_t)(3600 / TICK_S) : 0;
+    for (size_t i = 0; i < errors.size(); i++) {
+        if (std::isnan(min_error[i])) {
+            continue;
+        }
+        double difference = max_error[i] - min_error[i];
+        alignment = std::max(alignment, difference);
+        if (i >= final_hour) {
+            final_hour_alignment = std::max(final_hour_alignment, difference);
+        }
+    }
+
+    bool ok = all_synced && alignment <= max_error_us;
+    printf("\nall nodes synchronized after %.1f s\n", all_synced_s);
+    printf("alignment error between nodes: %.1f us at most, %.1f us in the last hour (limit %.0f us): %s\n",
+           alignment, final_hour_alignment, max_error_us, ok ? "ok" : "FAIL");
+    return ok ? 0 : 1;
+}
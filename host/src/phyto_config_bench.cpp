@@ -0,0 +1,244 @@
+/**
+ * @file phyto_config_bench.cpp
+ * @brief Compares the runtime-parameter pipeline with the one specialized by a `PipelineConfig`.
+ *
+ * @details
+ * For every preset the same synthetic conversion words run through
+ * - the runtime path: `SampleCollector` sized by a runtime argument, the
+ *   `SampleVector` overload of `FrameBuilder::build` and the conversion with
+ *   runtime constants, as before the presets existed;
+ * - the specialized path: `FixedSampleCollector<vector_size>`, the
+ *   `std::array` overload of `FrameBuilder::build` and `convert_samples<Config>`.
+ *
+ * Both paths must produce byte-identical frames; the tool reports the time per
+ * frame of each stage and fails if the frames or voltages differ.
+ */
+
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "adc/FixedSampleCollector.h"
+#include "adc/SampleCollector.h"
+#include "config/PipelineConfig.h"
+#include "serial_mail_sender/FrameBuilder.h"
+#include "transport/FrameBuffer.h"
+#include "utils/ConversionKernel.h"
+
+/// Default number of frames per preset and path.
+#define DEFAULT_FRAMES 200000
+
+/// Largest tolerated difference between both conversions in millivolts.
+#define MAX_CONVERSION_ERROR_MV 1e-3
+
+/**
+ * @struct StageTimes
+ * @brief Nanoseconds spent in each stage.
+ */
+struct StageTimes {
+    double collect;     ///< Demultiplexing the conversion words.
+    double build;       ///< Serializing the frame.
+    double convert;     ///< Converting both channels to millivolts.
+};
+
+/**
+ * @struct PathResult
+ * @brief Outcome of one path, used to compare both.
+ */
+struct PathResult {
+    StageTimes           times;     ///< Total time of each stage loop.
+    std::vector<uint8_t> frame;     ///< Last frame built.
+    std::vector<float>   voltages;  ///< Last converted channel 0.
+    float                checksum;  ///< Sum of all voltages, keeps the conversion alive.
+};
+
+typedef std::chrono::steady_clock Clock;
+
+static double elapsed_ns(Clock::time_point start, Clock::time_point end) {
+    return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+/**
+ * @brief Generates conversion words alternating between channel 0 and 1.
+ */
+static std::vector<std::array<uint8_t, AD7124_CONVERSION_WORD_SIZE>> make_words(size_t count) {
+    std::vector<std::array<uint8_t, AD7124_CONVERSION_WORD_SIZE>> words(count);
+    uint32_t state = 12345;
+    for (size_t i = 0; i < count; i++) {
+        state = state * 1664525u + 1013904223u;
+        words[i] = {(uint8_t)(state >> 24), (uint8_t)(state >> 16), (uint8_t)(state >> 8), (uint8_t)(i % 2)};
+    }
+    return words;
+}
+
+/**
+ * @brief Runs the runtime-parameter path.
+ *
+ * The frame size and the constants are read through `volatile`, so the
+ * compiler cannot specialize this path for the preset. Each stage runs
+ * `frames` times in its own timed loop, which keeps clock reads out of the
+ * measured work.
+ */
+template <typename Config>
+static PathResult run_runtime(const std::vector<std::array<uint8_t, AD7124_CONVERSION_WORD_SIZE>>& words,
+                              size_t frames) {
+    volatile unsigned int vector_size_arg = Config::vector_size;
+    volatile int32_t databits_arg = Config::databits;
+    volatile float vref_arg = Config::vref;
+    volatile float gain_arg = Config::gain;
+    unsigned int vector_size = vector_size_arg;
+    int32_t databits = databits_arg;
+    float vref = vref_arg;
+    float gain = gain_arg;
+
+    SampleCollector collector(vector_size);
+    FrameBuilder builder;
+    static uint8_t out[FRAME_BUFFER_CAPACITY];
+    std::vector<float> ch0(vector_size);
+    std::vector<float> ch1(vector_size);
+    PathResult result{{0, 0, 0}, {}, {}, 0};
+    size_t next = 0;
+    size_t size = 0;
+
+    Clock::time_point start = Clock::now();
+    for (size_t frame = 0; frame < frames; frame++) {
+        collector.clear();
+        while (!collector.push(words[next].data())) {
+            next = (next + 1) % words.size();
+        }
+        next = (next + 1) % words.size();
+    }
+    Clock::time_point collected = Clock::now();
+    for (size_t frame = 0; frame < frames; frame++) {
+        size = builder.build(collector.ch0(), collector.ch1(), Config::node, out, sizeof(out));
+        result.checksum += out[size - 1];
+    }
+    Clock::time_point built = Clock::now();
+    for (size_t frame = 0; frame < frames; frame++) {
+        convert_samples(collector.ch0().data(), vector_size, databits, vref, gain, ch0.data());
+        convert_samples(collector.ch1().data(), vector_size, databits, vref, gain, ch1.data());
+        result.checksum += ch0[frame % vector_size] + ch1[vector_size - 1];
+    }
+    Clock::time_point converted = Clock::now();
+
+    result.times.collect = elapsed_ns(start, collected);
+    result.times.build = elapsed_ns(collected, built);
+    result.times.convert = elapsed_ns(built, converted);
+    result.frame.assign(out, out + size);
+    result.voltages = ch0;
+    return result;
+}
+
+/**
+ * @brief Runs the path specialized for `Config`, with the same stage loops.
+ */
+template <typename Config>
+static PathResult run_specialized(const std::vector<std::array<uint8_t, AD7124_CONVERSION_WORD_SIZE>>& words,
+                                  size_t frames) {
+    constexpr unsigned int N = Config::vector_size;
+    static_assert(FrameBuilder::maxFrameSize<N>() <= FRAME_BUFFER_CAPACITY, "Preset frame exceeds the frame buffer");
+
+    FixedSampleCollector<N> collector;
+    FrameBuilder builder;
+    static uint8_t out[FrameBuilder::maxFrameSize<N>()];
+    std::array<float, N> ch0;
+    std::array<float, N> ch1;
+    PathResult result{{0, 0, 0}, {}, {}, 0};
+    size_t next = 0;
+    size_t size = 0;
+
+    Clock::time_point start = Clock::now();
+    for (size_t frame = 0; frame < frames; frame++) {
+        collector.clear();
+        while (!collector.push(words[next].data())) {
+            next = (next + 1) % words.size();
+        }
+        next = (next + 1) % words.size();
+    }
+    Clock::time_point collected = Clock::now();
+    for (size_t frame = 0; frame < frames; frame++) {
+        size = builder.build(collector.ch0(), collector.ch1(), Config::node, out);
+        result.checksum += out[size - 1];
+    }
+    Clock::time_point built = Clock::now();
+    for (size_t frame = 0; frame < frames; frame++) {
+        convert_samples<Config>(collector.ch0(), ch0);
+        convert_samples<Config>(collector.ch1(), ch1);
+        result.checksum += ch0[frame % N] + ch1[N - 1];
+    }
+    Clock::time_point converted = Clock::now();
+
+    result.times.collect = elapsed_ns(start, collected);
+    result.times.build = elapsed_ns(collected, built);
+    result.times.convert = elapsed_ns(built, converted);
+    result.frame.assign(out, out + size);
+    result.voltages.assign(ch0.begin(), ch0.end());
+    return result;
+}
+
+static void print_times(const char* path, const StageTimes& times, size_t frames) {
+    printf("  %-12s collect %8.1f ns  build %8.1f ns  convert %8.1f ns  total %8.1f ns/frame\n", path,
+           times.collect / frames, times.build / frames, times.convert / frames,
+           (times.collect + times.build + times.convert) / frames);
+}
+
+/**
+ * @brief Benchmarks both paths for one preset.
+ * @return True if both paths produced the same frame and voltages.
+ */
+template <typename Config>
+static bool bench_preset(const char* name, size_t frames) {
+    std::vector<std::array<uint8_t, AD7124_CONVERSION_WORD_SIZE>> words = make_words(4096 + 1);
+
+    // Warm up caches and the builder's buffer
+    run_runtime<Config>(words, frames / 10 + 1);
+    run_specialized<Config>(words, frames / 10 + 1);
+
+    PathResult runtime = run_runtime<Config>(words, frames);
+    PathResult specialized = run_specialized<Config>(words, frames);
+
+    bool same_frame = runtime.frame == specialized.frame;
+    bool same_voltages = runtime.voltages.size() == specialized.voltages.size();
+    for (size_t i = 0; same_voltages && i < runtime.voltages.size(); i++) {
+        same_voltages = std::fabs(runtime.voltages[i] - specialized.voltages[i]) <= MAX_CONVERSION_ERROR_MV;
+    }
+
+    double runtime_total = runtime.times.collect + runtime.times.build + runtime.times.convert;
+    double specialized_total = specialized.times.collect + specialized.times.build + specialized.times.convert;
+
+    printf("%s: %u samples per channel, FS %u, %u SPS per channel, %zu bytes per frame\n", name,
+           Config::vector_size, Config::filter_fs,
+           ad7124_rate_sps(Config::power_mode, Config::channels, Config::filter_fs), specialized.frame.size());
+    print_times("runtime", runtime.times, frames);
+    print_times("specialized", specialized.times, frames);
+    printf("  speedup %.2fx, frames %s, voltages %s (checksum %.1f)\n\n",
+           runtime_total / specialized_total, same_frame ? "identical" : "DIFFER",
+           same_voltages ? "match" : "DIFFER", runtime.checksum + specialized.checksum);
+    return same_frame && same_voltages;
+}
+
+int main(int argc, char** argv) {
+    size_t frames = DEFAULT_FRAMES;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-n" && i + 1 < argc) {
+            frames = std::stoul(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [-n <frames per preset>] (default %d)\n", argv[0], DEFAULT_FRAMES);
+            return 2;
+        }
+    }
+    if (frames == 0) {
+        frames = 1;
+    }
+
+    bool ok = true;
+    ok &= bench_preset<PresetDefault>("DEFAULT", frames);
+    ok &= bench_preset<Preset2ch50Sps>("2CH_50SPS", frames);
+    ok &= bench_preset<Preset2ch1kSps>("2CH_1KSPS", frames);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,96 @@
+/**
+ * @file phyto_convert.cpp
+ * @brief Converts raw serial captures into a columnar analysis file on all cores.
+ *
+ * Reads one or more captures of the `0xAAAA` + size + `SerialMail` stream
+ * (e.g. recorded with `cat /dev/ttyAMA0 > node3.raw`), raw frames included,
+ * and writes one row per sample index with the channels in millivolts into a
+ * columnar file (see `convert/ColumnarFile.h`). The captures are converted in
+ * the order given, each split into chunks that a pool of threads decodes in
+ * parallel (see `BulkConverter`); the output does not depend on the thread
+ * count.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <exception>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "convert/BulkConverter.h"
+#include "convert/ColumnarFile.h"
+#include "utils/MappedFile.h"
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+        "usage: %s [options] -o <output> <capture>...\n"
+        "  -j <threads>  decoding threads (default: all cores, %u)\n"
+        "  -c <KB>       nominal chunk size (default %u)\n"
+        "  --stats       print throughput statistics to stderr\n",
+        program, std::max(std::thread::hardware_concurrency(), 1u), CONVERT_DEFAULT_CHUNK_SIZE >> 10);
+}
+
+int main(int argc, char** argv) {
+    std::string output;
+    std::vector<std::string> inputs;
+    unsigned int threads = std::max(std::thread::hardware_concurrency(), 1u);
+    size_t chunk_size = CONVERT_DEFAULT_CHUNK_SIZE;
+    bool stats = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc) {
+            output = argv[++i];
+        } else if (arg == "-j" && i + 1 < argc) {
+            threads = (unsigned int)std::stoul(argv[++i]);
+        } else if (arg == "-c" && i + 1 < argc) {
+            chunk_size = std::stoul(argv[++i]) << 10;
+        } else if (arg == "--stats") {
+            stats = true;
+        } else if (!arg.empty() && arg[0] != '-') {
+            inputs.push_back(arg);
+        } else {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+    if (output.empty() || inputs.empty() || threads == 0 || chunk_size < CONVERT_MIN_CHUNK_SIZE) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    BulkConverter converter(threads, chunk_size);
+    auto start = std::chrono::steady_clock::now();
+    uint64_t output_bytes = 0;
+    try {
+        ColumnarWriter writer(output);
+        for (const std::string& input : inputs) {
+            MappedFile file(input);
+            converter.convert(file.bytes(), writer);
+        }
+        writer.finalize();
+        output_bytes = writer.bytes();
+    } catch (const std::exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (stats) {
+        const ConvertStats& result = converter.stats();
+        fprintf(stderr, "input:            %llu bytes in %llu chunks, %u threads\n",
+                (unsigned long long)result.bytes, (unsigned long long)result.chunks, threads);
+        fprintf(stderr, "frames:           %llu\n", (unsigned long long)result.frames);
+        fprintf(stderr, "rows:             %llu (%llu samples)\n", (unsigned long long)result.rows,
+                (unsigned long long)result.samples);
+        fprintf(stderr, "skipped bytes:    %llu\n", (unsigned long long)result.skipped_bytes);
+        fprintf(stderr, "rejected frames:  %llu\n", (unsigned long long)result.rejected_frames);
+        fprintf(stderr, "output:           %llu bytes\n", (unsigned long long)output_bytes);
+        fprintf(stderr, "elapsed:          %.3f s\n", seconds);
+        fprintf(stderr, "throughput:       %.1f MB/s, %.1f M samples/s\n",
+                seconds > 0 ? result.bytes / seconds / 1e6 : 0, seconds > 0 ? result.samples / seconds / 1e6 : 0);
+    }
+    return 0;
+}
@@ -0,0 +1,295 @@
+/**
+ * @file phyto_convert_bench.cpp
+ * @brief Measures how the bulk converter scales with the thread count on a large synthetic capture.
+ *
+ * @details
+ * A capture of the requested size is written with the firmware's FlatBuffer
+ * or, with `--raw`, raw frame builder: frames of several nodes in turn, with
+ * a few random bytes (sync bytes among them) now and then, as a link glitch
+ * leaves them. Every sample is a function of its node, frame and index, so
+ * the expected millivolts of every row are known without keeping them.
+ *
+ * The capture is then converted with 1, 2, 4, ... up to `-j` threads, and
+ * for each run the tool prints the time, the input rate, the samples per
+ * second and the speedup and efficiency against one thread. Every output
+ * must be byte for byte the one of the single-threaded run, and that one
+ * must hold exactly the generated frames in order with the values
+ * `get_analog_inputs` gives; otherwise the tool fails.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "adc/SampleVector.h"
+#include "config/PipelineConfig.h"
+#include "convert/BulkConverter.h"
+#include "convert/ColumnarFile.h"
+#include "serial_mail_sender/FrameBuilder.h"
+#include "serial_mail_sender/RawFrameBuilder.h"
+#include "transport/FrameBuffer.h"
+#include "utils/ConversionKernel.h"
+#include "utils/MappedFile.h"
+
+/// Mean number of frames between two runs of garbage bytes.
+#define GARBAGE_INTERVAL 10000
+
+/// Longest run of garbage bytes.
+#define GARBAGE_MAX_SIZE 32
+
+/// Output buffer of the capture file.
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+
+/**
+ * @struct BenchOptions
+ * @brief Command line options.
+ */
+struct BenchOptions {
+    double       size_gb;       ///< Size of the synthetic capture.
+    unsigned int max_threads;   ///< Largest thread count measured.
+    size_t       chunk_size;    ///< Nominal chunk size.
+    int          nodes;         ///< Nodes whose frames are interleaved.
+    bool         raw;           ///< Raw frames instead of FlatBuffers.
+    std::string  directory;     ///< Where the capture and the outputs are written.
+    bool         keep;          ///< Keep the capture and the single-threaded output.
+    uint64_t     seed;          ///< Random seed of the garbage.
+};
+
+/**
+ * @brief Sample `index` of a channel in frame `frame` of a node, spread over the code range.
+ */
+static int32_t synthetic_sample(int32_t node, uint64_t frame, size_t index, int channel) {
+    uint64_t x = ((uint64_t)node << 48) ^ (frame << 9) ^ (index << 1) ^ (uint64_t)channel;
+    x *= 0x9E3779B97F4A7C15ull;
+    return (int32_t)((x >> 40) & 0xFFFFFF) - SAMPLE_ZERO_CODE;
+}
+
+/**
+ * @brief Writes the synthetic capture.
+ * @return Frames written.
+ */
+static uint64_t write_capture(const BenchOptions& options, const std::string& path) {
+    FILE* out = fopen(path.c_str(), "wb");
+    if (out == nullptr) {
+        throw std::runtime_error("cannot create " + path + ": " + strerror(errno));
+    }
+    setvbuf(out, nullptr, _IOFBF, OUTPUT_BUFFER_SIZE);
+
+    std::mt19937_64 random(options.seed);
+    std::uniform_int_distribution<int> garbage_size(1, GARBAGE_MAX_SIZE);
+    FrameBuilder builder;
+    std::vector<RawFrameBuilder> raw_builders(options.nodes);
+    uint8_t raw_frame[FRAME_BUFFER_CAPACITY];
+    uint8_t garbage[GARBAGE_MAX_SIZE];
+    SampleVector ch0;
+    SampleVector ch1;
+
+    const uint64_t target = (uint64_t)(options.size_gb * 1e9);
+    uint64_t written = 0;
+    uint64_t frames = 0;
+    while (written < target) {
+        int32_t node = (int32_t)(frames % options.nodes) + 1;
+        uint64_t node_frame = frames / options.nodes;
+        ch0.clear();
+        ch1.clear();
+        for (size_t i = 0; i < PhytoConfig::vector_size; i++) {
+            ch0.push_back(synthetic_sample(node, node_frame, i, 0));
+            ch1.push_back(synthetic_sample(node, node_frame, i, 1));
+        }
+
+        const uint8_t* data = raw_frame;
+        size_t size;
+        if (options.raw) {
+            size = raw_builders[node - 1].build(ch0, ch1, node, raw_frame, sizeof(raw_frame));
+        } else {
+            size = builder.build(ch0, ch1, node);
+            data = builder.data();
+        }
+        fwrite(data, 1, size, out);
+        written += size;
+        frames++;
+
+        if (random() % GARBAGE_INTERVAL == 0) {
+            size_t count = garbage_size(random);
+            for (size_t i = 0; i < count; i++) {
+                garbage[i] = random() % 4 == 0 ? SERIAL_MAIL_SYNC_BYTE : (uint8_t)random();
+            }
+            fwrite(garbage, 1, count, out);
+            written += count;
+        }
+    }
+    if (fclose(out) != 0) {
+        throw std::runtime_error("cannot write " + path + ": " + strerror(errno));
+    }
+    return frames;
+}
+
+/**
+ * @brief Checks the rows of the single-threaded output against the generated frames.
+ * @return Description of the first mismatch, empty if there is none.
+ */
+static std::string verify_rows(const BenchOptions& options, const ColumnarReader& reader, uint64_t frames) {
+    const size_t vector_size = PhytoConfig::vector_size;
+    if (reader.rows() != frames * vector_size) {
+        return "expected " + std::to_string(frames * vector_size) + " rows, found " + std::to_string(reader.rows());
+    }
+    uint64_t row = 0;
+    for (size_t group = 0; group < reader.groups().size(); group++) {
+        auto frame = reader.column<uint64_t>(group, SAMPLE_COLUMN_FRAME);
+        auto node = reader.column<int32_t>(group, SAMPLE_COLUMN_NODE);
+        auto index = reader.column<uint16_t>(group, SAMPLE_COLUMN_INDEX);
+        auto ch0 = reader.column<float>(group, SAMPLE_COLUMN_CH0);
+        auto ch1 = reader.column<float>(group, SAMPLE_COLUMN_CH1);
+        for (size_t i = 0; i < frame.size(); i++, row++) {
+            uint64_t expected_frame = row / vector_size;
+            int32_t expected_node = (int32_t)(expected_frame % options.nodes) + 1;
+            uint64_t node_frame = expected_frame / options.nodes;
+            size_t expected_index = row % vector_size;
+            float expected_ch0 = sample_to_millivolts(synthetic_sample(expected_node, node_frame, expected_index, 0),
+                                                      PhytoConfig::databits, PhytoConfig::vref, PhytoConfig::gain);
+            float expected_ch1 = sample_to_millivolts(synthetic_sample(expected_node, node_frame, expected_index, 1),
+                                                      PhytoConfig::databits, PhytoConfig::vref, PhytoConfig::gain);
+            if (frame[i] != expected_frame || node[i] != expected_node || index[i] != expected_index ||
+                ch0[i] != expected_ch0 || ch1[i] != expected_ch1) {
+                return "row " + std::to_string(row) + " differs";
+            }
+        }
+    }
+    return "";
+}
+
+static bool same_content(const std::string& a, const std::string& b) {
+    MappedFile first(a);
+    MappedFile second(b);
+    return first.bytes().size() == second.bytes().size() &&
+           memcmp(first.bytes().data(), second.bytes().data(), first.bytes().size()) == 0;
+}
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  -g <GB>       size of the synthetic capture (default 1)\n"
+        "  -j <threads>  largest thread count (default: all cores, %u)\n"
+        "  -c <KB>       nominal chunk size (default %u)\n"
+        "  -n <nodes>    interleaved nodes (default 4)\n"
+        "  --raw         raw frames (RAW_FRAMES) instead of FlatBuffer frames\n"
+        "  -d <dir>      directory for the capture and the outputs (default .)\n"
+        "  --keep        keep the capture and the single-threaded output\n"
+        "  -s <seed>     random seed of the garbage bytes (default 1)\n",
+        program, std::max(std::thread::hardware_concurrency(), 1u), CONVERT_DEFAULT_CHUNK_SIZE >> 10);
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options{1, std::max(std::thread::hardware_concurrency(), 1u), CONVERT_DEFAULT_CHUNK_SIZE, 4, false,
+                         ".", false, 1};
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--raw") {
+            options.raw = true;
+            continue;
+        }
+        if (arg == "--keep") {
+            options.keep = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            print_usage(argv[0]);
+            return 2;
+        }
+        if (arg == "-g") {
+            options.size_gb = std::stod(argv[++i]);
+        } else if (arg == "-j") {
+            options.max_threads = (unsigned int)std::stoul(argv[++i]);
+        } else if (arg == "-c") {
+            options.chunk_size = std::stoul(argv[++i]) << 10;
+        } else if (arg == "-n") {
+            options.nodes = std::stoi(argv[++i]);
+        } else if (arg == "-d") {
+            options.directory = argv[++i];
+        } else if (arg == "-s") {
+            options.seed = std::stoull(argv[++i]);
+        } else {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+    if (options.size_gb <= 0 || options.max_threads == 0 || options.chunk_size < CONVERT_MIN_CHUNK_SIZE ||
+        options.nodes < 1) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    const std::string capture_path = options.directory + "/phyto_convert_bench.raw";
+    const std::string reference_path = options.directory + "/phyto_convert_bench.pha";
+    const std::string output_path = options.directory + "/phyto_convert_bench.tmp.pha";
+    bool passed = true;
+
+    try {
+        auto start = std::chrono::steady_clock::now();
+        uint64_t frames = write_capture(options, capture_path);
+        double generate_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        MappedFile capture(capture_path);
+        printf("capture: %.2f GB, %llu %s frames of %u samples per channel from %d nodes (%.1f s to write)\n",
+               capture.bytes().size() / 1e9, (unsigned long long)frames, options.raw ? "raw" : "FlatBuffer",
+               PhytoConfig::vector_size, options.nodes, generate_s);
+        printf("%8s %10s %10s %14s %8s %10s\n", "threads", "time_s", "MB/s", "M samples/s", "speedup", "efficiency");
+
+        std::vector<unsigned int> thread_counts;
+        for (unsigned int threads = 1; threads < options.max_threads; threads *= 2) {
+            thread_counts.push_back(threads);
+        }
+        thread_counts.push_back(options.max_threads);
+
+        double single_s = 0;
+        for (unsigned int threads : thread_counts) {
+            const std::string& path = threads == 1 ? reference_path : output_path;
+            BulkConverter converter(threads, options.chunk_size);
+            start = std::chrono::steady_clock::now();
+            {
+                ColumnarWriter writer(path);
+                converter.convert(capture.bytes(), writer);
+                writer.finalize();
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (threads == 1) {
+                single_s = seconds;
+            }
+            const ConvertStats& stats = converter.stats();
+            printf("%8u %10.2f %10.0f %14.1f %8.2f %9.0f%%\n", threads, seconds, stats.bytes / seconds / 1e6,
+                   stats.samples / seconds / 1e6, single_s / seconds, 100 * single_s / seconds / threads);
+
+            if (threads == 1) {
+                MappedFile output(path);
+                ColumnarReader reader(output.bytes());
+                std::string mismatch = verify_rows(options, reader, frames);
+                if (!mismatch.empty()) {
+                    printf("FAIL: %s\n", mismatch.c_str());
+                    passed = false;
+                }
+            } else if (!same_content(reference_path, output_path)) {
+                printf("FAIL: the output of %u threads differs from the single-threaded one\n", threads);
+                passed = false;
+            }
+        }
+    } catch (const std::exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        passed = false;
+    }
+
+    remove(output_path.c_str());
+    if (!options.keep) {
+        remove(capture_path.c_str());
+        remove(reference_path.c_str());
+    }
+    printf("%s\n", passed ? "PASS" : "FAIL");
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,482 @@
+/**
+ * @file phyto_decode.cpp
+ * @brief Command line decoder for PhytoNode serial streams and capture files.
+ *
+ * Reads the `0xAAAA` + size + `SerialMail` stream either from a serial device
+ * or from a raw capture file and writes the samples as CSV or packed binary.
+ * Raw frames of `RAW_FRAMES` firmware are recognized by their version byte and
+ * decoded the same way. Band power frames (`BAND_POWER`) carry no samples;
+ * `--bands <path>` writes their powers as CSV. On nodes with several AD7124
+ * `--devices` adds the device of every sample to the CSV. Latency reports
+ * (`LATENCY_STATS`) are summarized as percentiles by `--latency <path>`, and
+ * messages (`TX_SCHEDULER`, `SELF_BENCHMARK`) are collected by `--messages <path>`.
+ * `--store <path>` additionally appends the samples to a compressed sample
+ * store (`storage/SampleStore.h`) for long recordings.
+ *
+ * @details
+ * - Capture files are memory-mapped and decoded in place; `-c <bytes>` splits them
+ *   into smaller pieces to mimic the chunked reads of a serial port.
+ * - `--stats` prints decoded samples per second and corruption counters to
+ *   stderr, which serves as the throughput benchmark on large captures.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <unistd.h>
+
+#include "storage/SampleStore.h"
+#include "stream_decoder/StreamDecoder.h"
+#include "utils/LineBuffer.h"
+#include "utils/MappedFile.h"
+#include "utils/SerialPort.h"
+#include "config/PipelineConfig.h"
+
+
+/// Default UART baud rate of the node.
+#define DEFAULT_BAUDRATE 115200
+
+/// Read size used for serial devices.
+#define SERIAL_READ_SIZE 4096
+
+/// Output buffer size for stdout/file writes.
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+
+/// Set by the signal handler to stop decoding a serial device.
+static volatile sig_atomic_t stop_requested = 0;
+
+static void handle_signal(int) {
+    stop_requested = 1;
+}
+
+/// Time between two samples of a channel at the preset's ADC rate.
+static constexpr uint32_t sample_period_us =
+    1000000 / ad7124_rate_sps(PhytoConfig::power_mode, PhytoConfig::channels, PhytoConfig::filter_fs);
+
+/**
+ * @struct Options
+ * @brief Command line options of the decoder.
+ */
+struct Options {
+    std::string input;          ///< Capture file or serial device.
+    std::string output;         ///< Output path, empty for stdout.
+    std::string bands;          ///< Band power CSV path, empty to ignore band power frames.
+    std::string latency;        ///< Latency CSV path, empty to ignore latency reports.
+    std::string messages;       ///< Message output path, empty to ignore messages.
+    std::string store;          ///< Sample store path, empty to write no store.
+    bool        binary;         ///< Write packed binary records instead of CSV.
+    bool        millivolts;     ///< Convert raw codes to millivolts in CSV output.
+    bool        devices;        ///< Add the device of each sample to the CSV output.
+    bool        stats;          ///< Print throughput statistics to stderr.
+    int         baudrate;       ///< Baud rate for serial devices.
+    size_t      chunk_size;     ///< Chunk size for file input, 0 feeds the whole mapping at once.
+};
+
+/**
+ * @struct BinaryRecord
+ * @brief Fixed-size little-endian record written in binary mode, one per sample index.
+ */
+struct BinaryRecord {
+    uint32_t frame;     ///< Running frame number.
+    int32_t  node;      ///< Node identifier.
+    uint32_t ch0;       ///< Raw code of channel 0, `UINT32_MAX` if absent.
+    uint32_t ch1;       ///< Raw code of channel 1, `UINT32_MAX` if absent.
+};
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+        "usage: %s [options] <capture-file|serial-device>\n"
+        "  -o <path>     write to <path> instead of stdout\n"
+        "  -b <baud>     baud rate for serial devices (default %d)\n"
+        "  -c <bytes>    feed capture files in chunks of <bytes>\n"
+        "  --binary      write packed binary records instead of CSV\n"
+        "  --mv          write millivolts instead of raw codes (CSV only)\n"
+        "  --devices     add the AD7124 each sample comes from (CSV only)\n"
+        "  --bands <path> write the powers of band power frames to <path> as CSV\n"
+        "  --latency <path> write latency percentiles per report and stage to <path> as CSV\n"
+        "  --messages <path> append status texts, dumps and benchmark tables sent as messages to <path>\n"
+        "  --store <path> also write the samples into a compressed sample store at <path>\n"
+        "  --stats       print throughput statistics to stderr\n",
+        program, DEFAULT_BAUDRATE);
+}
+
+static bool parse_options(int argc, char** argv, Options& options) {
+    options = Options{"", "", "", "", "", "", false, false, false, false, DEFAULT_BAUDRATE, 0};
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc) {
+            options.output = argv[++i];
+        } else if (arg == "-b" && i + 1 < argc) {
+            options.baudrate = std::stoi(argv[++i]);
+        } else if (arg == "-c" && i + 1 < argc) {
+            options.chunk_size = std::stoul(argv[++i]);
+        } else if (arg == "--bands" && i + 1 < argc) {
+            options.bands = argv[++i];
+        } else if (arg == "--latency" && i + 1 < argc) {
+            options.latency = argv[++i];
+        } else if (arg == "--messages" && i + 1 < argc) {
+            options.messages = argv[++i];
+        } else if (arg == "--store" && i + 1 < argc) {
+            options.store = argv[++i];
+        } else if (arg == "--binary") {
+            options.binary = true;
+        } else if (arg == "--mv") {
+            options.millivolts = true;
+        } else if (arg == "--devices") {
+            options.devices = true;
+        } else if (arg == "--stats") {
+            options.stats = true;
+        } else if (!arg.empty() && arg[0] != '-' && options.input.empty()) {
+            options.input = arg;
+        } else {
+            return false;
+        }
+    }
+    return !options.input.empty();
+}
+
+/**
+ * @brief Converts a raw code to millivolts using the same math as `get_analog_inputs`.
+ *
+ * The constants come from the preset the host tools are configured with
+ * (`PHYTO_PRESET`), which must match the node's.
+ */
+static float to_millivolts(uint32_t code) {
+    float voltage = (float)code / (float)PhytoConfig::databits - 1;
+    voltage = voltage * PhytoConfig::vref / PhytoConfig::gain;
+    return voltage * 1000;
+}
+
+/**
+ * @class SampleWriter
+ * @brief Formats decoded frames as CSV lines or binary records.
+ */
+class SampleWriter {
+public:
+    SampleWriter(FILE* out, bool binary, bool millivolts, bool devices)
+        : m_out(out), m_binary(binary), m_millivolts(millivolts), m_devices(devices), m_frame(0) {
+        if (!m_binary) {
+            fputs(m_devices ? "frame,node,device,index,ch0,ch1\n" : "frame,node,index,ch0,ch1\n", m_out);
+        }
+    }
+
+    void write(const DecodedFrame& frame) {
+        size_t count = std::max(frame.ch0.size(), frame.ch1.size());
+        for (size_t i = 0; i < count; i++) {
+            bool has_ch0 = i < frame.ch0.size();
+            bool has_ch1 = i < frame.ch1.size();
+            if (m_binary) {
+                BinaryRecord record{m_frame, frame.node,
+                    has_ch0 ? raw_code(frame.ch0[i]) : UINT32_MAX,
+                    has_ch1 ? raw_code(frame.ch1[i]) : UINT32_MAX};
+                fwrite(&record, sizeof(record), 1, m_out);
+            } else {
+                writeLine(frame, i, has_ch0, has_ch1);
+            }
+        }
+        m_frame++;
+    }
+
+private:
+    FILE*    m_out;
+    bool     m_binary;
+    bool     m_millivolts;
+    bool     m_devices;
+    uint32_t m_frame;
+
+    /// Longest CSV line: frame, node, device, index, both channels in millivolts, separators and newline.
+    static constexpr size_t CSV_LINE_SIZE = integer_chars_max<uint32_t>() + integer_chars_max<int32_t>() +
+                                       integer_chars_max<uint8_t>() + integer_chars_max<size_t>() +
+                                       2 * fixed_chars_max<float>(3) + 6;
+
+    /**
+     * @brief Formats one CSV line with `std::to_chars`, which avoids the locale
+     *        handling of printf and is several times faster for integers.
+     */
+    void writeLine(const DecodedFrame& frame, size_t index, bool has_ch0, bool has_ch1) {
+        LineBuffer<CSV_LINE_SIZE> line;
+        line.number(m_frame).put(',').number(frame.node).put(',');
+        if (m_devices) {
+            line.number(frame.device).put(',');
+        }
+        line.number(index).put(',');
+        if (has_ch0) {
+            writeValue(line, raw_code(frame.ch0[index]));
+        }
+        line.put(',');
+        if (has_ch1) {
+            writeValue(line, raw_code(frame.ch1[index]));
+        }
+        line.put('\n');
+        if (!line.overflow()) {
+            fwrite(line.data(), 1, line.size(), m_out);
+        }
+    }
+
+    void writeValue(LineBuffer<CSV_LINE_SIZE>& line, uint32_t code) {
+        if (m_millivolts) {
+            line.number(to_millivolts(code), std::chars_format::fixed, 3);
+        } else {
+            line.number(code);
+        }
+    }
+};
+
+/**
+ * @class StoreIngest
+ * @brief Appends decoded frames to a sample store, with a time for each frame.
+ *
+ * Frames of a synchronized node (`CLOCK_SYNC`) carry the host time of their
+ * last sample. Other frames get their receive time when read from a serial
+ * device; frames read from a file have none and are placed back to back at
+ * the preset's sample period, from 0 per node and device.
+ */
+class StoreIngest {
+public:
+    StoreIngest(const std::string& path, bool live) : m_writer(path), m_live(live) {}
+
+    void write(const DecodedFrame& frame) {
+        uint64_t& next_time_us = m_next_time_us[{frame.node, frame.device}];
+        size_t count = std::max(frame.ch0.size(), frame.ch1.size());
+        uint64_t time_us = frame.time_us;
+        if (time_us == 0 && m_live) {
+            auto now = std::chrono::system_clock::now().time_since_epoch();
+            time_us = std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+        } else if (time_us == 0) {
+            time_us = next_time_us + (count > 0 ? (count - 1) * sample_period_us : 0);
+        }
+        m_writer.appendFrame(frame, time_us, sample_period_us);
+        next_time_us = time_us + sample_period_us;
+    }
+
+    void finalize(void) { m_writer.finalize(); }
+
+    const SampleStoreWriter& writer(void) const { return m_writer; }
+
+private:
+    SampleStoreWriter                           m_writer;
+    bool                                        m_live;         ///< Input is a serial device.
+    std::map<std::pair<int32_t, uint8_t>, uint64_t> m_next_time_us; ///< Time of the next sample per node and device.
+};
+
+/**
+ * @brief Writes band power frames as CSV, one line per channel and band.
+ */
+static void write_bands(FILE* out, const DecodedFrame& frame) {
+    size_t channels = frame.band_count > 0 ? frame.bands.size() / frame.band_count : 0;
+    for (size_t channel = 0; channel < channels; channel++) {
+        for (size_t band = 0; band < frame.band_count; band++) {
+            fprintf(out, "%u,%d,%zu,%zu,%.9g\n", frame.sequence, frame.node, channel, band,
+                    frame.bands[channel * frame.band_count + band]);
+        }
+    }
+}
+
+/**
+ * @brief Writes one CSV line with the percentiles of a latency report.
+ */
+static void write_latency(FILE* out, const LatencyReport& report, const LatencySnapshot& snapshot) {
+    fprintf(out, "%u,%d,%u,%u,%u,%u,%u,%u,%u,%u\n", report.sequence, report.node, report.stage, snapshot.total,
+            latency_percentile(snapshot, 0.5), latency_percentile(snapshot, 0.9),
+            latency_percentile(snapshot, 0.99), latency_percentile(snapshot, 0.999), snapshot.max_us,
+            report.period_ms);
+}
+
+/**
+ * @brief Appends a message behind a line with its fields.
+ */
+static void write_message(FILE* out, const MessageHeader& header, std::span<const uint8_t> data) {
+    fprintf(out, "# node=%d kind=%u id=%u size=%zu\n", header.node, header.kind, header.id, data.size());
+    fwrite(data.data(), 1, data.size(), out);
+    if (data.empty() || data.back() != '\n') {
+        fputc('\n', out);
+    }
+}
+
+/**
+ * @brief Decodes a memory-mapped capture file.
+ */
+static void decode_file(const Options& options, StreamDecoder& decoder) {
+    MappedFile file(options.input);
+    std::span<const uint8_t> bytes = file.bytes();
+
+    if (options.chunk_size == 0) {
+        decoder.feed(bytes);
+        return;
+    }
+    for (size_t offset = 0; offset < bytes.size(); offset += options.chunk_size) {
+        decoder.feed(bytes.subspan(offset, std::min(options.chunk_size, bytes.size() - offset)));
+    }
+}
+
+/**
+ * @brief Decodes a serial device until it is closed, an error occurs or a signal stops it.
+ */
+static void decode_serial(const Options& options, StreamDecoder& decoder, FILE* out) {
+    int fd = open_serial_port(options.input, options.baudrate);
+    uint8_t buffer[SERIAL_READ_SIZE];
+
+    while (!stop_requested) {
+        ssize_t received = read(fd, buffer, sizeof(buffer));
+        if (received <= 0) {
+            if (received < 0 && errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        decoder.feed({buffer, (size_t)received});
+        fflush(out);
+    }
+    close(fd);
+}
+
+static void print_stats(const DecoderStats& stats, double seconds) {
+    double samples_per_second = seconds > 0 ? stats.samples / seconds : 0;
+    double megabytes_per_second = seconds > 0 ? stats.bytes / seconds / 1e6 : 0;
+
+    fprintf(stderr, "bytes:            %llu\n", (unsigned long long)stats.bytes);
+    fprintf(stderr, "frames:           %llu (%llu raw, %llu band power)\n", (unsigned long long)stats.frames,
+            (unsigned long long)stats.raw_frames, (unsigned long long)stats.band_frames);
+    fprintf(stderr, "samples:          %llu\n", (unsigned long long)stats.samples);
+    fprintf(stderr, "skipped bytes:    %llu\n", (unsigned long long)stats.skipped_bytes);
+    fprintf(stderr, "rejected frames:  %llu\n", (unsigned long long)stats.rejected_frames);
+    fprintf(stderr, "missed frames:    %llu (raw sequence gaps)\n", (unsigned long long)stats.missed_frames);
+    fprintf(stderr, "latency frames:   %llu\n", (unsigned long long)stats.latency_frames);
+    fprintf(stderr, "message frames:   %llu (%llu messages lost)\n", (unsigned long long)stats.message_frames,
+            (unsigned long long)stats.lost_messages);
+    fprintf(stderr, "elapsed:          %.3f s\n", seconds);
+    fprintf(stderr, "throughput:       %.0f samples/s (%.1f MB/s)\n", samples_per_second, megabytes_per_second);
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    FILE* out = options.output.empty() ? stdout : fopen(options.output.c_str(), "wb");
+    if (out == nullptr) {
+        fprintf(stderr, "cannot open %s: %s\n", options.output.c_str(), strerror(errno));
+        return 1;
+    }
+    setvbuf(out, nullptr, _IOFBF, OUTPUT_BUFFER_SIZE);
+
+    FILE* bands = nullptr;
+    if (!options.bands.empty()) {
+        bands = fopen(options.bands.c_str(), "w");
+        if (bands == nullptr) {
+            fprintf(stderr, "cannot open %s: %s\n", options.bands.c_str(), strerror(errno));
+            return 1;
+        }
+        fputs("window,node,channel,band,power_mv2\n", bands);
+    }
+
+    FILE* latency = nullptr;
+    if (!options.latency.empty()) {
+        latency = fopen(options.latency.c_str(), "w");
+        if (latency == nullptr) {
+            fprintf(stderr, "cannot open %s: %s\n", options.latency.c_str(), strerror(errno));
+            return 1;
+        }
+        fputs("report,node,stage,count,p50_us,p90_us,p99_us,p999_us,max_us,period_ms\n", latency);
+    }
+
+    FILE* messages = nullptr;
+    if (!options.messages.empty()) {
+        messages = fopen(options.messages.c_str(), "ab");
+        if (messages == nullptr) {
+            fprintf(stderr, "cannot open %s: %s\n", options.messages.c_str(), strerror(errno));
+            return 1;
+        }
+    }
+
+    std::unique_ptr<StoreIngest> store;
+    if (!options.store.empty()) {
+        try {
+            store = std::make_unique<StoreIngest>(options.store, is_character_device(options.input));
+        } catch (const std::exception& e) {
+            fprintf(stderr, "%s\n", e.what());
+            return 1;
+        }
+
+        // Ctrl-C ends a live recording with the store's index written; no SA_RESTART, so read returns EINTR
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_handler = handle_signal;
+        sigaction(SIGINT, &action, nullptr);
+        sigaction(SIGTERM, &action, nullptr);
+    }
+
+    SampleWriter writer(out, options.binary, options.millivolts, options.devices);
+    StreamDecoder decoder([&writer, &store, bands](const DecodedFrame& frame) {
+        if (frame.version == BAND_FRAME_VERSION) {
+            if (bands != nullptr) {
+                write_bands(bands, frame);
+            }
+            return;
+        }
+        writer.write(frame);
+        if (store) {
+            store->write(frame);
+        }
+    });
+    if (latency != nullptr) {
+        decoder.setLatencyHandler([latency](const LatencyReport& report, const LatencySnapshot& snapshot) {
+            write_latency(latency, report, snapshot);
+        });
+    }
+    if (messages != nullptr) {
+        decoder.setMessageHandler([messages](const MessageHeader& header, std::span<const uint8_t> data) {
+            write_message(messages, header, data);
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    try {
+        if (is_character_device(options.input)) {
+            decode_serial(options, decoder, out);
+        } else {
+            decode_file(options, decoder);
+        }
+        if (store) {
+            store->finalize();
+        }
+    } catch (const std::exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    fflush(out);
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (options.stats) {
+        print_stats(decoder.stats(), elapsed);
+        if (store) {
+            fprintf(stderr, "stored:           %llu samples in %llu bytes\n",
+                    (unsigned long long)store->writer().samples(), (unsigned long long)store->writer().bytes());
+        }
+    }
+    if (out != stdout) {
+        fclose(out);
+    }
+    if (bands != nullptr) {
+        fclose(bands);
+    }
+    if (latency != nullptr) {
+        fclose(latency);
+    }
+    if (messages != nullptr) {
+        fclose(messages);
+    }
+    return 0;
+}
@@ -0,0 +1,577 @@
+/**
+ * @file phyto_filter_bench.cpp
+ * @brief Checks the frequency response of the node's mains filter for every preset and estimates its cost.
+ *
+ * @details
+ * For each preset the `MainsFilter` is built from the design the compiler
+ * derives from it (`mains_filter_design<Config>()`) and runs on the portable
+ * fixed-point kernels, which follow the arithmetic of the CMSIS-DSP ones:
+ * - `response`: tones of known amplitude from below the high-pass corner up
+ *   to near Nyquist, at every notch and corner and between the notches. The
+ *   gain is fitted after the filter settled and compared with the response
+ *   of the double-precision design. Every notch must attenuate by
+ *   `MIN_NOTCH_DB`, the gain elsewhere must match the design within
+ *   `MAX_GAIN_ERROR_DB`, and the passband (a decade above the high-pass,
+ *   clear of the notches and below half the low-pass corner) must stay
+ *   within `MAX_RIPPLE_DB` of 0 dB.
+ * - `drift`: a 300 mV electrode offset drifting by 1 mV per minute must leave
+ *   at most `MAX_DRIFT_CODES` at the output. The same high-pass on the Q31
+ *   kernel is shown for comparison.
+ * - `hum`: a slow potential with mains hum and harmonics; the hum must drop
+ *   by `MIN_NOTCH_DB` and the output must stay within `MAX_ARITHMETIC_CODES`
+ *   of a double-precision run of the same quantized coefficients. The
+ *   attenuation of hum 0.1 Hz off the mains frequency is shown as well.
+ * - `decimation`: frames pushed through the filter must come out as the
+ *   filtered stream with every `mains_decimation`-th sample kept, and a tone
+ *   folding onto the low-pass corner must be rejected by `MIN_ALIAS_DB`.
+ *
+ * The cost is measured in nanoseconds and, on x86, TSC cycles per sample,
+ * and estimated for the node from the Cortex-M4 cycles of the CMSIS-DSP
+ * kernels. The tool fails if the estimate exceeds `MAX_CPU_SHARE` of the
+ * cycles available per sample at the preset's rate.
+ */
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "adc/SampleVector.h"
+#include "config/PipelineConfig.h"
+#include "dsp/Biquad.h"
+#include "dsp/MainsFilter.h"
+#include "utils/ConversionKernel.h"
+
+/// Samples filtered for the cost measurement.
+#define DEFAULT_SAMPLES 10000000
+
+/// Smallest attenuation at a notch and of the hum.
+#define MIN_NOTCH_DB 40.0
+
+/// Largest difference between measured and designed gain where the design passes more than -40 dB.
+#define MAX_GAIN_ERROR_DB 0.05
+
+/// Largest deviation from 0 dB in the passband of the design.
+#define MAX_RIPPLE_DB 0.5
+
+/// Smallest rejection of a tone folding onto the low-pass corner after decimation.
+#define MIN_ALIAS_DB 30.0
+
+/// Largest output offset left by a drifting electrode offset, in codes.
+#define MAX_DRIFT_CODES 2.0
+
+/// Largest difference from the double-precision run of the same coefficients, in codes.
+#define MAX_ARITHMETIC_CODES 2.0
+
+/// Tone amplitude of the response test, in codes (about 150 mV at gain 4).
+#define TONE_CODES 2000000.0
+
+/// Tone periods the gain is fitted over.
+#define FIT_PERIODS 8
+
+/// Time constants the filter settles before a gain is fitted.
+#define SETTLE_TIME_CONSTANTS 14
+
+/// CPU clock of the node (STM32WB55).
+#define NODE_CPU_CLOCK_HZ 64000000.0
+
+/// Estimated Cortex-M4 cycles per sample and section of `arm_biquad_cascade_df1_q31`.
+#define NODE_CYCLES_PER_SECTION 14.0
+
+/// Estimated Cortex-M4 cycles per sample and section of `arm_biquad_cas_df1_32x64_q31`.
+#define NODE_CYCLES_PER_WIDE_SECTION 32.0
+
+/// Estimated Cortex-M4 cycles per sample for scaling, rounding, saturation, decimation and the calls.
+#define NODE_CYCLES_PER_SAMPLE 20.0
+
+/// Share of the cycles per sample the filter may take.
+#define MAX_CPU_SHARE 0.05
+
+typedef std::chrono::steady_clock Clock;
+
+static inline uint64_t read_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @struct PresetFilter
+ * @brief A preset's filter design and frame size.
+ */
+struct PresetFilter {
+    const char*       name;         ///< Preset name.
+    MainsFilterDesign design;       ///< Design computed by the compiler.
+    unsigned int      vector_size;  ///< Samples per channel and frame.
+    double            mains_hz;     ///< Mains frequency.
+    unsigned int      harmonics;    ///< Harmonics notched.
+};
+
+/// Designs evaluated at compile time, as the firmware uses them.
+static constexpr MainsFilterDesign default_design = mains_filter_design<PresetDefault>();
+static constexpr MainsFilterDesign design_2ch_50sps = mains_filter_design<Preset2ch50Sps>();
+static constexpr MainsFilterDesign design_2ch_1ksps = mains_filter_design<Preset2ch1kSps>();
+
+/**
+ * @brief Sections of a design in the order they run, in double precision.
+ * @param quantized Use the quantized coefficients instead of the designed ones.
+ */
+static std::vector<BiquadCoefficients> design_sections(const MainsFilterDesign& design, bool quantized) {
+    const double scale = 1.0 / (double)(1ll << (31 - BIQUAD_POST_SHIFT));
+    auto dequantize = [scale](const BiquadQ31& q) {
+        return BiquadCoefficients{q.b0 * scale, q.b1 * scale, q.b2 * scale, -q.a1 * scale, -q.a2 * scale};
+    };
+    std::vector<BiquadCoefficients> sections;
+    if (design.has_highpass) {
+        sections.push_back(quantized ? dequantize(design.highpass)
+                                     : mains_filter_section(design.highpass_plan, design.rate_sps));
+    }
+    for (unsigned int i = 0; i < design.section_count; i++) {
+        sections.push_back(quantized ? dequantize(design.sections[i])
+                                     : mains_filter_section(design.plan[i], design.rate_sps));
+    }
+    return sections;
+}
+
+/**
+ * @brief Gain of the double-precision design at a frequency, in dB.
+ */
+static double design_gain_db(const MainsFilterDesign& design, double f_hz) {
+    std::complex<double> z1 = std::polar(1.0, -2 * M_PI * f_hz / design.rate_sps);
+    std::complex<double> z2 = z1 * z1;
+    std::complex<double> h = 1;
+    for (const BiquadCoefficients& s : design_sections(design, false)) {
+        h *= (s.b0 + s.b1 * z1 + s.b2 * z2) / (1.0 + s.a1 * z1 + s.a2 * z2);
+    }
+    return 20 * std::log10(std::max(std::abs(h), 1e-12));
+}
+
+/**
+ * @brief Samples after which the slowest section has settled.
+ */
+static size_t settle_samples(const MainsFilterDesign& design) {
+    double slowest = 1;
+    for (const BiquadCoefficients& s : design_sections(design, false)) {
+        double radius = std::sqrt(std::max(s.a2, 0.0));
+        slowest = std::max(slowest, 1 / std::max(1 - radius, 1e-9));
+    }
+    return (size_t)(SETTLE_TIME_CONSTANTS * slowest);
+}
+
+/**
+ * @brief Least-squares amplitude of a tone with an offset in a run of samples.
+ * @param y Samples.
+ * @param first Index of the first sample fitted, also the phase reference.
+ * @param f_norm Tone frequency over the sample rate.
+ */
+static double tone_amplitude(const std::vector<double>& y, size_t first, double f_norm) {
+    double m[3][3] = {};
+    double v[3] = {};
+    for (size_t i = first; i < y.size(); i++) {
+        double basis[3] = {std::sin(2 * M_PI * f_norm * i), std::cos(2 * M_PI * f_norm * i), 1.0};
+        for (int r = 0; r < 3; r++) {
+            v[r] += basis[r] * y[i];
+            for (int c = 0; c < 3; c++) {
+                m[r][c] += basis[r] * basis[c];
+            }
+        }
+    }
+    // Cramer's rule on the normal equations
+    auto det = [](double a[3][3]) {
+        return a[0][0] * (a[1][1] * a[2][2] - a[1][2] * a[2][1]) - a[0][1] * (a[1][0] * a[2][2] - a[1][2] * a[2][0]) +
+               a[0][2] * (a[1][0] * a[2][1] - a[1][1] * a[2][0]);
+    };
+    double d = det(m);
+    double x[2];
+    for (int k = 0; k < 2; k++) {
+        double mk[3][3];
+        memcpy(mk, m, sizeof(mk));
+        for (int r = 0; r < 3; r++) {
+            mk[r][k] = v[r];
+        }
+        x[k] = det(mk) / d;
+    }
+    return std::hypot(x[0], x[1]);
+}
+
+/**
+ * @brief Runs samples through a fresh filter without decimation.
+ */
+static std::vector<double> filter_samples(const PresetFilter& preset, const std::vector<int32_t>& input) {
+    MainsFilter filter(preset.design, preset.vector_size);
+    std::vector<int32_t> output(input.size());
+    filter.process(0, input.data(), output.data(), input.size());
+    return std::vector<double>(output.begin(), output.end());
+}
+
+/**
+ * @brief Measured gain of the fixed-point filter at a frequency, in dB.
+ */
+static double measured_gain_db(const PresetFilter& preset, double f_hz) {
+    const double f_norm = f_hz / preset.design.rate_sps;
+    const size_t settle = settle_samples(preset.design);
+    const size_t fit = std::max<size_t>((size_t)(FIT_PERIODS / f_norm), 1024);
+    std::vector<int32_t> input(settle + fit);
+    for (size_t i = 0; i < input.size(); i++) {
+        input[i] = (int32_t)std::lround(TONE_CODES * std::sin(2 * M_PI * f_norm * i));
+    }
+    double amplitude = tone_amplitude(filter_samples(preset, input), settle, f_norm);
+    return 20 * std::log10(std::max(amplitude / TONE_CODES, 1e-12));
+}
+
+static const char* section_name(FilterSectionKind kind) {
+    return kind == FILTER_SECTION_HIGHPASS ? "high-pass" : kind == FILTER_SECTION_NOTCH ? "notch" : "low-pass";
+}
+
+/**
+ * @brief Checks the response at test frequencies spread over the band.
+ */
+static bool check_response(const PresetFilter& preset) {
+    const MainsFilterDesign& design = preset.design;
+    const double nyquist = design.rate_sps / 2;
+    double highpass_hz = design.has_highpass ? design.highpass_plan.frequency_hz : 0;
+    double lowpass_hz = 0;
+    std::vector<double> notches;
+    double notch_q = 1;
+    for (unsigned int i = 0; i < design.section_count; i++) {
+        if (design.plan[i].kind == FILTER_SECTION_NOTCH) {
+            notches.push_back(design.plan[i].frequency_hz);
+            notch_q = design.plan[i].q;
+        } else {
+            lowpass_hz = design.plan[i].frequency_hz;
+        }
+    }
+
+    std::vector<double> frequencies;
+    double low = highpass_hz > 0 ? highpass_hz / 2 : design.rate_sps / 1000;
+    for (int i = 0; i < 12; i++) {
+        frequencies.push_back(low * std::pow(0.45 * design.rate_sps / low, i / 11.0));
+    }
+    if (highpass_hz > 0) {
+        frequencies.push_back(highpass_hz);
+    }
+    if (lowpass_hz > 0) {
+        frequencies.push_back(lowpass_hz);
+    }
+    std::sort(notches.begin(), notches.end());
+    for (size_t i = 0; i < notches.size(); i++) {
+        frequencies.push_back(notches[i]);
+        frequencies.push_back(i + 1 < notches.size() ? (notches[i] + notches[i + 1]) / 2
+                                                     : (notches[i] + nyquist) / 2);
+    }
+    std::sort(frequencies.begin(), frequencies.end());
+
+    bool ok = true;
+    double ripple = 0;
+    printf("  %10s %10s %10s  %s\n", "f_hz", "design_db", "measured", "");
+    for (double f : frequencies) {
+        double expected = design_gain_db(design, f);
+        double measured = measured_gain_db(preset, f);
+        bool is_notch = std::find(notches.begin(), notches.end(), f) != notches.end();
+        bool passed;
+        if (is_notch) {
+            passed = measured <= -MIN_NOTCH_DB;
+        } else if (expected > -40) {
+            passed = std::fabs(measured - expected) <= MAX_GAIN_ERROR_DB;
+        } else {
+            passed = measured <= -30;
+        }
+
+        bool in_passband = f >= 10 * highpass_hz && (lowpass_hz == 0 ? f <= 0.45 * design.rate_sps : f <= lowpass_hz / 2);
+        for (double notch : notches) {
+            // Three notch bandwidths away the notch takes less than 0.15 dB
+            in_passband &= std::fabs(f - notch) > 3 * notch / notch_q;
+        }
+        if (in_passband) {
+            ripple = std::max(ripple, std::fabs(expected));
+        }
+        printf("  %10.3f %10.2f %10.2f  %s%s\n", f, expected, measured, is_notch ? "notch " : "",
+               passed ? "ok" : "FAIL");
+        ok &= passed;
+    }
+    bool ripple_ok = ripple <= MAX_RIPPLE_DB;
+    printf("  passband ripple %.3f dB  %s\n", ripple, ripple_ok ? "ok" : "FAIL");
+    return ok && ripple_ok;
+}
+
+/**
+ * @brief Checks that a drifting electrode offset is removed.
+ */
+static bool check_drift(const PresetFilter& preset) {
+    const MainsFilterDesign& design = preset.design;
+    if (!design.has_highpass) {
+        printf("  drift: no high-pass\n");
+        return true;
+    }
+    const size_t settle = settle_samples(design);
+    const size_t count = settle + (size_t)(60 * design.rate_sps);
+    const double offset = millivolts_to_codes<PhytoConfig>(300.0f);
+    const double slope = millivolts_to_codes<PhytoConfig>(1.0f) / (60 * design.rate_sps);
+    std::vector<int32_t> input(count);
+    for (size_t i = 0; i < count; i++) {
+        input[i] = (int32_t)std::lround(offset + slope * i);
+    }
+
+    std::vector<double> output = filter_samples(preset, input);
+    double worst = 0;
+    for (size_t i = settle; i < count; i++) {
+        worst = std::max(worst, std::fabs(output[i]));
+    }
+
+    // The same high-pass on the Q31 kernel, for comparison
+    int32_t state[BIQUAD_STATE_SIZE] = {};
+    double worst_q31 = 0;
+    for (size_t i = 0; i < count; i++) {
+        int32_t x = (int32_t)((uint32_t)input[i] << MAINS_FILTER_HEADROOM_BITS);
+        if (i == 0) {
+            state[0] = state[1] = x;
+        }
+        int32_t y;
+        biquad_cascade_q31(&design.highpass, 1, state, &x, &y, 1);
+        if (i >= settle) {
+            worst_q31 = std::max(worst_q31, std::fabs(y / (double)(1 << MAINS_FILTER_HEADROOM_BITS)));
+        }
+    }
+
+    bool ok = worst <= MAX_DRIFT_CODES;
+    printf("  drift: 300 mV + 1 mV/min leaves %.1f codes (%.1f on the Q31 kernel)  %s\n", worst, worst_q31,
+           ok ? "ok" : "FAIL");
+    return ok;
+}
+
+/**
+ * @brief Filters a slow potential with hum and its harmonics.
+ * @param hum_hz Frequency of the hum.
+ * @param difference Receives the largest difference from a double-precision run of the quantized coefficients.
+ * @return Attenuation of the hum fundamental, in dB.
+ */
+static double hum_attenuation_db(const PresetFilter& preset, double hum_hz, double& difference) {
+    const MainsFilterDesign& design = preset.design;
+    const double fs = design.rate_sps;
+    const size_t settle = settle_samples(design);
+    const size_t count = settle + (size_t)(10 * fs);
+    std::vector<int32_t> input(count);
+    for (size_t i = 0; i < count; i++) {
+        double t = i / fs;
+        double mv = 250 + 5 * std::sin(2 * M_PI * 0.3 * t) + 20 * std::sin(2 * M_PI * hum_hz * t);
+        for (unsigned int k = 2; k <= preset.harmonics && k * hum_hz < fs / 2; k++) {
+            mv += 8.0 / k * std::sin(2 * M_PI * k * hum_hz * t + k);
+        }
+        input[i] = millivolts_to_codes<PhytoConfig>((float)mv);
+    }
+    std::vector<double> output = filter_samples(preset, input);
+
+    // Double-precision direct form I with the same coefficients and priming
+    std::vector<BiquadCoefficients> sections = design_sections(design, true);
+    std::vector<std::array<double, 4>> state(sections.size());
+    const double settled = design.has_highpass ? 0 : input[0];
+    for (size_t s = 0; s < sections.size(); s++) {
+        state[s] = {settled, settled, settled, settled};
+    }
+    if (design.has_highpass) {
+        state[0] = {(double)input[0], (double)input[0], 0, 0};
+    }
+    difference = 0;
+    for (size_t i = 0; i < count; i++) {
+        double x = input[i];
+        for (size_t s = 0; s < sections.size(); s++) {
+            const BiquadCoefficients& c = sections[s];
+            std::array<double, 4>& st = state[s];
+            double y = c.b0 * x + c.b1 * st[0] + c.b2 * st[1] - c.a1 * st[2] - c.a2 * st[3];
+            st = {x, st[0], y, st[2]};
+            x = y;
+        }
+        difference = std::max(difference, std::fabs(output[i] - x));
+    }
+
+    std::vector<double> input_codes(input.begin(), input.end());
+    double before = tone_amplitude(input_codes, settle, hum_hz / fs);
+    double after = tone_amplitude(output, settle, hum_hz / fs);
+    return 20 * std::log10(before / std::max(after, 1e-9));
+}
+
+/**
+ * @brief Checks hum removal and the fixed-point arithmetic against double precision.
+ */
+static bool check_hum(const PresetFilter& preset) {
+    if (preset.harmonics == 0 || preset.mains_hz >= preset.design.rate_sps / 2) {
+        printf("  hum: no notches\n");
+        return true;
+    }
+    double difference;
+    double attenuation = hum_attenuation_db(preset, preset.mains_hz, difference);
+    bool ok = attenuation >= MIN_NOTCH_DB && difference <= MAX_ARITHMETIC_CODES;
+    printf("  hum: %.1f Hz attenuated by %.1f dB, largest difference from double precision %.2f codes  %s\n",
+           preset.mains_hz, attenuation, difference, ok ? "ok" : "FAIL");
+
+    // Mains frequency off by 0.1 Hz, for information: the notch width is mains_hz / mains_notch_q
+    double drifted = hum_attenuation_db(preset, preset.mains_hz + 0.1, difference);
+    printf("  hum: %.1f Hz attenuated by %.1f dB\n", preset.mains_hz + 0.1, drifted);
+    return ok;
+}
+
+/**
+ * @brief Checks the decimated frames and the rejection of tones folding into the output band.
+ */
+static bool check_decimation(const PresetFilter& preset) {
+    const MainsFilterDesign& design = preset.design;
+    const unsigned int d = design.decimation;
+    const double fs = design.rate_sps;
+    double lowpass_hz = 0;
+    for (unsigned int i = 0; i < design.section_count; i++) {
+        if (design.plan[i].kind == FILTER_SECTION_LOWPASS) {
+            lowpass_hz = design.plan[i].frequency_hz;
+        }
+    }
+    // Folds onto the low-pass corner, or lies just below Nyquist without decimation
+    const double f = d > 1 ? fs / d - lowpass_hz : 0.3 * fs;
+    // Whole output frames: decimation frames in give one out
+    const size_t samples = settle_samples(design) + (size_t)(FIT_PERIODS * 4 * fs / std::max(lowpass_hz, 1.0));
+    const size_t frames = (samples / (preset.vector_size * d) + 1) * d;
+
+    MainsFilter framed(design, preset.vector_size);
+    std::vector<int32_t> input;
+    std::vector<double> kept;
+    SampleVector ch0;
+    SampleVector ch1;
+    for (size_t frame = 0; frame < frames; frame++) {
+        ch0.clear();
+        ch1.clear();
+        for (unsigned int i = 0; i < preset.vector_size; i++) {
+            size_t n = input.size();
+            input.push_back((int32_t)std::lround(TONE_CODES * std::sin(2 * M_PI * f / fs * n)));
+            ch0.push_back(input.back());
+            ch1.push_back(-input.back());
+        }
+        if (framed.push(ch0, ch1)) {
+            for (size_t i = 0; i < framed.ch0().size(); i++) {
+                kept.push_back(framed.ch0()[i]);
+            }
+            framed.clear();
+        }
+    }
+
+    std::vector<double> stream = filter_samples(preset, input);
+    bool same = kept.size() == input.size() / d;
+    for (size_t i = 0; same && i < kept.size(); i++) {
+        same = kept[i] == stream[i * d + d - 1];
+    }
+    if (d == 1) {
+        printf("  decimation: none, %zu frames unchanged  %s\n", frames, same ? "ok" : "FAIL");
+        return same;
+    }
+
+    double folded = std::fabs(f - fs / d);
+    double amplitude = tone_amplitude(kept, settle_samples(design) / d + 1, folded / (fs / d));
+    double rejection = -20 * std::log10(std::max(amplitude / TONE_CODES, 1e-12));
+    bool ok = same && rejection >= MIN_ALIAS_DB;
+    printf("  decimation: 1 of %u, %zu samples as framed %s, %.1f Hz folding to %.1f Hz rejected by %.1f dB  %s\n",
+           d, kept.size(), same ? "ok" : "MISMATCH", f, folded, rejection, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+/**
+ * @brief Measures the cost per sample and compares the node estimate with its budget.
+ */
+static bool check_cost(const PresetFilter& preset, size_t samples) {
+    const MainsFilterDesign& design = preset.design;
+    MainsFilter filter(design, preset.vector_size);
+    std::vector<int32_t> input(4096);
+    std::vector<int32_t> output(input.size());
+    for (size_t i = 0; i < input.size(); i++) {
+        input[i] = (int32_t)std::lround(TONE_CODES * std::sin(0.05 * i) + 1000 * std::sin(1.3 * i));
+    }
+    const size_t block = preset.vector_size;
+    size_t done = 0;
+    Clock::time_point start = Clock::now();
+    uint64_t start_cycles = read_cycles();
+    while (done < samples) {
+        for (size_t i = 0; i + block <= input.size() && done < samples; i += block, done += 2 * block) {
+            filter.process(0, input.data() + i, output.data() + i, block);
+            filter.process(1, input.data() + i, output.data() + i, block);
+        }
+    }
+    uint64_t end_cycles = read_cycles();
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / done;
+    double cycles = (double)(end_cycles - start_cycles) / done;
+
+    const double odr = design.rate_sps * MAINS_FILTER_CHANNELS;
+    const double budget = NODE_CPU_CLOCK_HZ / odr;
+    const double node_cycles = (design.has_highpass ? NODE_CYCLES_PER_WIDE_SECTION : 0) +
+                               design.section_count * NODE_CYCLES_PER_SECTION + NODE_CYCLES_PER_SAMPLE;
+    bool ok = node_cycles <= MAX_CPU_SHARE * budget;
+    printf("  cost: host %.1f ns, %.0f TSC cycles per sample; node estimate %.0f cycles per sample, "
+           "budget %.0f at %.0f samples/s (%.2f%% CPU)  %s\n",
+           ns, cycles, node_cycles, budget, odr, 100.0 * node_cycles / budget, ok ? "ok" : "FAIL");
+    printf("  samples sent: %.0f/s instead of %.0f/s\n", odr / design.decimation, odr);
+    return ok;
+}
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  -n <samples>  samples filtered for the cost measurement (default %d)\n",
+        program, DEFAULT_SAMPLES);
+}
+
+int main(int argc, char** argv) {
+    size_t samples = DEFAULT_SAMPLES;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-n" && i + 1 < argc) {
+            samples = std::stoul(argv[++i]);
+        } else {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+    if (samples == 0) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    const PresetFilter presets[] = {
+        {"DEFAULT", default_design, PresetDefault::vector_size, PresetDefault::mains_hz,
+         PresetDefault::mains_harmonics},
+        {"2CH_50SPS", design_2ch_50sps, Preset2ch50Sps::vector_size, Preset2ch50Sps::mains_hz,
+         Preset2ch50Sps::mains_harmonics},
+        {"2CH_1KSPS", design_2ch_1ksps, Preset2ch1kSps::vector_size, Preset2ch1kSps::mains_hz,
+         Preset2ch1kSps::mains_harmonics},
+    };
+
+    bool ok = true;
+    for (const PresetFilter& preset : presets) {
+        const MainsFilterDesign& design = preset.design;
+        printf("%s: %.0f SPS per channel, %u sections on the Q31 kernel, %s, decimation %u\n", preset.name,
+               design.rate_sps, design.section_count, design.has_highpass ? "high-pass on the wide kernel" : "no high-pass",
+               design.decimation);
+        if (design.has_highpass) {
+            printf("  %-9s %8.3f Hz  Q %.2f\n", section_name(design.highpass_plan.kind),
+                   design.highpass_plan.frequency_hz, design.highpass_plan.q);
+        }
+        for (unsigned int i = 0; i < design.section_count; i++) {
+            printf("  %-9s %8.3f Hz  Q %.2f\n", section_name(design.plan[i].kind), design.plan[i].frequency_hz,
+                   design.plan[i].q);
+        }
+        bool passed = check_response(preset);
+        passed &= check_drift(preset);
+        passed &= check_hum(preset);
+        passed &= check_decimation(preset);
+        passed &= check_cost(preset, samples);
+        printf("  %s\n\n", passed ? "ok" : "FAIL");
+        ok &= passed;
+    }
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,191 @@
+/**
+ * @file phyto_frame_bench.cpp
+ * @brief Compares the FlatBuffer frame with the raw frame in size and CPU cost.
+ *
+ * @details
+ * For several frame sizes the same samples are serialized with the node's
+ * `FrameBuilder` and `RawFrameBuilder` into a caller-provided buffer, as
+ * `SerialMailSender` does, and a stream of those frames is decoded with the
+ * host's `StreamDecoder`. The tool reports
+ * - bytes per frame and per sample, including the `0xAAAA` + size header,
+ * - nanoseconds and, on x86, TSC cycles per frame to build and to decode.
+ *
+ * Both formats must decode to the input samples and node; the tool fails
+ * otherwise.
+ */
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "adc/SampleVector.h"
+#include "config/PipelineConfig.h"
+#include "serial_mail_sender/FrameBuilder.h"
+#include "serial_mail_sender/RawFrameBuilder.h"
+#include "stream_decoder/StreamDecoder.h"
+#include "transport/FrameBuffer.h"
+
+#include "TestSamples.h"
+
+/// Frames built and decoded per format and frame size.
+#define DEFAULT_FRAMES 200000
+
+/// Frames in the stream fed to the decoder at once.
+#define DECODE_STREAM_FRAMES 1024
+
+/**
+ * @struct FormatResult
+ * @brief Figures of one format at one frame size.
+ */
+struct FormatResult {
+    size_t frame_bytes;     ///< Bytes of one frame including the frame header.
+    double build_ns;        ///< Time to build one frame.
+    double build_cycles;    ///< TSC cycles to build one frame, 0 where unavailable.
+    double decode_ns;       ///< Time to decode one frame.
+    double decode_cycles;   ///< TSC cycles to decode one frame, 0 where unavailable.
+    bool   verified;        ///< Decoded samples and node equal the input.
+};
+
+typedef std::chrono::steady_clock Clock;
+
+/**
+ * @brief Reads the time stamp counter where there is one.
+ * @return Counter value, 0 on other architectures.
+ */
+static inline uint64_t read_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static bool same_samples(std::span<const SerialMail::Value> decoded, const SampleVector& expected) {
+    if (decoded.size() != expected.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < decoded.size(); i++) {
+        if (node_sample(decoded[i]) != expected[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Measures one format.
+ * @param build Writes one frame into the given buffer and returns its size.
+ */
+template <typename Build>
+static FormatResult bench_format(Build build, const SampleVector& ch0, const SampleVector& ch1, size_t frames) {
+    FormatResult result{0, 0, 0, 0, 0, false};
+    static uint8_t out[FRAME_BUFFER_CAPACITY];
+    size_t checksum = 0;
+
+    for (size_t i = 0; i < frames / 10 + 1; i++) {
+        checksum += build(out);
+    }
+    Clock::time_point start = Clock::now();
+    uint64_t start_cycles = read_cycles();
+    for (size_t i = 0; i < frames; i++) {
+        checksum += build(out);
+    }
+    uint64_t end_cycles = read_cycles();
+    result.build_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / frames;
+    result.build_cycles = (double)(end_cycles - start_cycles) / frames;
+
+    // A stream of identical frames, decoded repeatedly
+    result.frame_bytes = build(out);
+    std::vector<uint8_t> stream;
+    for (size_t i = 0; i < DECODE_STREAM_FRAMES; i++) {
+        stream.insert(stream.end(), out, out + result.frame_bytes);
+    }
+
+    bool verified = true;
+    size_t decoded_frames = 0;
+    StreamDecoder decoder([&](const DecodedFrame& frame) {
+        decoded_frames++;
+        if (decoded_frames == 1) {
+            verified = frame.node == PhytoConfig::node && same_samples(frame.ch0, ch0) && same_samples(frame.ch1, ch1);
+        }
+        checksum += frame.ch1.size();
+    });
+
+    size_t passes = frames / DECODE_STREAM_FRAMES + 1;
+    start = Clock::now();
+    start_cycles = read_cycles();
+    for (size_t pass = 0; pass < passes; pass++) {
+        decoder.feed(stream);
+    }
+    end_cycles = read_cycles();
+    double decoded = (double)passes * DECODE_STREAM_FRAMES;
+    result.decode_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / decoded;
+    result.decode_cycles = (double)(end_cycles - start_cycles) / decoded;
+    result.verified = verified && decoded_frames == passes * DECODE_STREAM_FRAMES && checksum > 0;
+    return result;
+}
+
+static void print_row(const char* format, size_t samples, const FormatResult& result) {
+    printf("%8zu  %-12s %8zu %10.2f %10.1f %10.0f %10.1f %10.0f  %s\n", samples, format, result.frame_bytes,
+           (double)result.frame_bytes / (2 * samples), result.build_ns, result.build_cycles, result.decode_ns,
+           result.decode_cycles, result.verified ? "ok" : "MISMATCH");
+}
+
+int main(int argc, char** argv) {
+    size_t frames = DEFAULT_FRAMES;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-n" && i + 1 < argc) {
+            frames = std::stoul(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [-n <frames per format and size>] (default %d)\n", argv[0], DEFAULT_FRAMES);
+            return 2;
+        }
+    }
+    if (frames == 0) {
+        frames = 1;
+    }
+
+    printf("%8s  %-12s %8s %10s %10s %10s %10s %10s\n", "samples", "format", "bytes", "B/sample", "build ns",
+           "build cyc", "decode ns", "decode cyc");
+
+    std::vector<size_t> sizes = {1, 5, 50, PhytoConfig::vector_size, PhytoConfig::batch_max_samples};
+    std::sort(sizes.begin(), sizes.end());
+    sizes.erase(std::unique(sizes.begin(), sizes.end()), sizes.end());
+
+    bool ok = true;
+    for (size_t samples : sizes) {
+        SampleVector ch0 = make_channel(samples, 1);
+        SampleVector ch1 = make_channel(samples, 2);
+
+        FrameBuilder flatbuffer_builder;
+        FormatResult flatbuffer = bench_format([&](uint8_t* out) {
+            return flatbuffer_builder.build(ch0, ch1, PhytoConfig::node, out, FRAME_BUFFER_CAPACITY);
+        }, ch0, ch1, frames);
+
+        RawFrameBuilder raw_builder;
+        FormatResult raw = bench_format([&](uint8_t* out) {
+            return raw_builder.build(ch0, ch1, PhytoConfig::node, out, FRAME_BUFFER_CAPACITY);
+        }, ch0, ch1, frames);
+
+        if (flatbuffer.frame_bytes == 0 || raw.frame_bytes == 0) {
+            printf("%8zu  frames exceed %d bytes, skipped\n\n", samples, FRAME_BUFFER_CAPACITY);
+            continue;
+        }
+        print_row("flatbuffer", samples, flatbuffer);
+        print_row("raw", samples, raw);
+        printf("%8s  raw saves %.0f%% bytes, builds %.1fx and decodes %.1fx faster\n\n", "",
+               100.0 * (1.0 - (double)raw.frame_bytes / flatbuffer.frame_bytes),
+               flatbuffer.build_ns / raw.build_ns, flatbuffer.decode_ns / raw.decode_ns);
+        ok &= flatbuffer.verified && raw.verified;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,312 @@
+/**
+ * @file phyto_latency_bench.cpp
+ * @brief Checks the latency histogram of `LATENCY_STATS` and measures its cost.
+ *
+ * @details
+ * The tool runs the node's `LatencyHistogram` and latency frame code natively
+ * and checks
+ * - that every latency up to `LATENCY_HISTOGRAM_RANGE_US` lies inside the
+ *   bounds of its bucket and within 1/32 of the bucket midpoint,
+ * - that the p50/p90/p99/p99.9 estimates of uniform, log-normal and bimodal
+ *   latencies are within 1/32 of the exact quantiles,
+ * - that a report survives `build_latency_frame` and the host's
+ *   `StreamDecoder`, including a report with every bucket filled that needs
+ *   several frames,
+ * - that snapshots taken while other threads record add up to exactly the
+ *   recorded latencies (reset-on-read loses and duplicates nothing).
+ *
+ * It then reports nanoseconds and, on x86, TSC cycles per `record` and per
+ * `snapshot`. The tool fails if any check does.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "pipeline/LatencyHistogram.h"
+#include "serial_mail_sender/LatencyFrameBuilder.h"
+#include "stream_decoder/StreamDecoder.h"
+#include "transport/FrameBuffer.h"
+
+/// Latencies recorded per distribution and for the overhead measurement.
+#define DEFAULT_RECORDS 1000000
+
+/// Threads recording while the reset-on-read check takes snapshots.
+#define DEFAULT_THREADS 4
+
+/// Largest relative error allowed for a bucket midpoint or quantile estimate.
+#define MAX_RELATIVE_ERROR (1.0 / 32)
+
+typedef std::chrono::steady_clock Clock;
+
+/**
+ * @brief Reads the time stamp counter where there is one.
+ * @return Counter value, 0 on other architectures.
+ */
+static inline uint64_t read_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  -n <records>  latencies per distribution and for the overhead (default %d)\n"
+        "  -t <threads>  recording threads of the reset-on-read check (default %d)\n",
+        program, DEFAULT_RECORDS, DEFAULT_THREADS);
+}
+
+static bool within(double estimate, double exact) {
+    return std::fabs(estimate - exact) <= MAX_RELATIVE_ERROR * exact + 0.5;
+}
+
+/**
+ * @brief Checks bucket bounds and midpoints of every latency in range.
+ */
+static bool check_buckets(void) {
+    for (uint32_t us = 0; us < LATENCY_HISTOGRAM_RANGE_US; us++) {
+        size_t bucket = latency_bucket(us);
+        uint32_t lower = latency_bucket_lower(bucket);
+        uint32_t width = latency_bucket_width(bucket);
+        double midpoint = lower + (width - 1) / 2;
+        if (bucket >= LATENCY_HISTOGRAM_OVERFLOW || us < lower || us >= lower + width ||
+            std::fabs(midpoint - us) > MAX_RELATIVE_ERROR * us) {
+            printf("bucket check failed at %u us (bucket %zu, [%u, %u))\n", us, bucket, lower, lower + width);
+            return false;
+        }
+    }
+    if (latency_bucket(LATENCY_HISTOGRAM_RANGE_US) != LATENCY_HISTOGRAM_OVERFLOW ||
+        latency_bucket(UINT32_MAX) != LATENCY_HISTOGRAM_OVERFLOW) {
+        printf("bucket check failed for the overflow bucket\n");
+        return false;
+    }
+    printf("buckets: %zu, all latencies below %u us within %.2f%% of their bucket midpoint\n",
+           LATENCY_HISTOGRAM_BUCKETS, LATENCY_HISTOGRAM_RANGE_US, 100 * MAX_RELATIVE_ERROR);
+    return true;
+}
+
+/**
+ * @brief Compares the quantile estimates of a distribution with the exact quantiles.
+ */
+template <typename Draw>
+static bool check_quantiles(const char* name, Draw draw, size_t records, LatencySnapshot& snapshot) {
+    std::mt19937 random(42);
+    std::vector<uint32_t> values(records);
+    LatencyHistogram histogram;
+    for (uint32_t& value : values) {
+        value = draw(random);
+        histogram.record(value);
+    }
+    histogram.snapshot(snapshot);
+    std::sort(values.begin(), values.end());
+
+    bool ok = snapshot.total == records && snapshot.max_us == values.back();
+    printf("%-10s", name);
+    for (double fraction : {0.5, 0.9, 0.99, 0.999}) {
+        uint32_t exact = values[(size_t)std::ceil(fraction * records) - 1];
+        uint32_t estimate = latency_percentile(snapshot, fraction);
+        bool close = within(estimate, exact);
+        ok &= close;
+        printf(" %9u/%-9u%s", estimate, exact, close ? " " : "!");
+    }
+    printf(" %9u  %s\n", snapshot.max_us, ok ? "ok" : "FAILED");
+    return ok;
+}
+
+/**
+ * @brief Sends a snapshot through latency frames and the stream decoder.
+ * @return True if the decoder delivered the report unchanged.
+ */
+static bool check_round_trip(const char* name, const LatencySnapshot& snapshot) {
+    LatencyReport report{7, LATENCY_STAGE_UART_DRAIN, 123, 10000};
+    std::vector<uint8_t> stream;
+    uint8_t out[FRAME_BUFFER_CAPACITY];
+    size_t bucket = 0;
+    size_t frames = 0;
+    do {
+        size_t next;
+        size_t size = build_latency_frame(snapshot, report, bucket, out, sizeof(out), &next);
+        if (size == 0) {
+            return false;
+        }
+        stream.insert(stream.end(), out, out + size);
+        bucket = next;
+        frames++;
+    } while (bucket < LATENCY_HISTOGRAM_BUCKETS);
+
+    size_t delivered = 0;
+    bool same = false;
+    StreamDecoder decoder([](const DecodedFrame&) {});
+    decoder.setLatencyHandler([&](const LatencyReport& decoded, const LatencySnapshot& counts) {
+        delivered++;
+        same = decoded.node == report.node && decoded.stage == report.stage &&
+               decoded.sequence == report.sequence && decoded.period_ms == report.period_ms &&
+               counts.total == snapshot.total && counts.max_us == snapshot.max_us &&
+               memcmp(counts.counts, snapshot.counts, sizeof(counts.counts)) == 0;
+    });
+    // Byte-wise, so frames also straddle chunks
+    for (uint8_t byte : stream) {
+        decoder.feed({&byte, 1});
+    }
+
+    bool ok = delivered == 1 && same && decoder.stats().rejected_frames == 0;
+    printf("%-10s %zu frame(s), %zu bytes, %s\n", name, frames, stream.size(), ok ? "ok" : "FAILED");
+    return ok;
+}
+
+/**
+ * @brief Takes snapshots while several threads record.
+ * @return True if the snapshots add up to the recorded latencies.
+ */
+static bool check_reset_on_read(size_t threads, size_t records) {
+    std::unique_ptr<LatencyHistogram> histogram = std::make_unique<LatencyHistogram>();
+    std::unique_ptr<LatencySnapshot> snapshot = std::make_unique<LatencySnapshot>();
+    std::atomic<size_t> running{threads};
+    std::vector<std::thread> recorders;
+    for (size_t t = 0; t < threads; t++) {
+        recorders.emplace_back([&, t]() {
+            uint32_t state = (uint32_t)t + 1;
+            for (size_t i = 0; i < records; i++) {
+                state = state * 1664525u + 1013904223u;
+                histogram->record(state >> 12);
+            }
+            running--;
+        });
+    }
+
+    uint64_t seen = 0;
+    size_t snapshots = 0;
+    while (running > 0) {
+        histogram->snapshot(*snapshot);
+        seen += snapshot->total;
+        snapshots++;
+    }
+    for (std::thread& recorder : recorders) {
+        recorder.join();
+    }
+    histogram->snapshot(*snapshot);
+    seen += snapshot->total;
+    snapshots++;
+
+    bool ok = seen == (uint64_t)threads * records;
+    printf("reset-on-read: %zu threads, %zu snapshots, %llu of %llu latencies seen, %s\n", threads, snapshots,
+           (unsigned long long)seen, (unsigned long long)threads * records, ok ? "ok" : "FAILED");
+    return ok;
+}
+
+/**
+ * @brief Measures `record` and `snapshot` on a single thread.
+ */
+static void bench_overhead(size_t records) {
+    std::unique_ptr<LatencyHistogram> histogram = std::make_unique<LatencyHistogram>();
+    std::unique_ptr<LatencySnapshot> snapshot = std::make_unique<LatencySnapshot>();
+
+    // Latencies drawn up front, so the loop only measures the histogram
+    std::vector<uint32_t> values(4096);
+    std::mt19937 random(1);
+    std::lognormal_distribution<double> lognormal(std::log(200.0), 1.0);
+    for (uint32_t& value : values) {
+        value = (uint32_t)lognormal(random);
+    }
+
+    Clock::time_point start = Clock::now();
+    uint64_t start_cycles = read_cycles();
+    for (size_t i = 0; i < records; i++) {
+        histogram->record(values[i & (values.size() - 1)]);
+    }
+    uint64_t end_cycles = read_cycles();
+    double record_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / records;
+    double record_cycles = (double)(end_cycles - start_cycles) / records;
+
+    size_t snapshots = records / 1000 + 1;
+    uint64_t checksum = 0;
+    start = Clock::now();
+    start_cycles = read_cycles();
+    for (size_t i = 0; i < snapshots; i++) {
+        histogram->snapshot(*snapshot);
+        checksum += snapshot->total;
+    }
+    end_cycles = read_cycles();
+    double snapshot_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / snapshots;
+    double snapshot_cycles = (double)(end_cycles - start_cycles) / snapshots;
+
+    printf("record:   %8.1f ns %8.0f cycles\n", record_ns, record_cycles);
+    printf("snapshot: %8.1f ns %8.0f cycles (%zu buckets, checksum %llu)\n", snapshot_ns, snapshot_cycles,
+           LATENCY_HISTOGRAM_BUCKETS, (unsigned long long)checksum);
+}
+
+int main(int argc, char** argv) {
+    size_t records = DEFAULT_RECORDS;
+    size_t threads = DEFAULT_THREADS;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-n" && i + 1 < argc) {
+            records = std::stoul(argv[++i]);
+        } else if (arg == "-t" && i + 1 < argc) {
+            threads = std::stoul(argv[++i]);
+        } else {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+    if (records == 0 || threads == 0) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    bool ok = check_buckets();
+
+    printf("\n%-10s %19s %19s %19s %19s %9s\n", "quantiles", "p50 est/exact", "p90 est/exact", "p99 est/exact",
+           "p99.9 est/exact", "max");
+    std::unique_ptr<LatencySnapshot> uniform = std::make_unique<LatencySnapshot>();
+    std::unique_ptr<LatencySnapshot> lognormal = std::make_unique<LatencySnapshot>();
+    std::unique_ptr<LatencySnapshot> bimodal = std::make_unique<LatencySnapshot>();
+    ok &= check_quantiles("uniform", [](std::mt19937& random) {
+        return std::uniform_int_distribution<uint32_t>(50, 5000)(random);
+    }, records, *uniform);
+    ok &= check_quantiles("lognormal", [](std::mt19937& random) {
+        return (uint32_t)std::lognormal_distribution<double>(std::log(300.0), 1.2)(random);
+    }, records, *lognormal);
+    // Mostly fast hand-offs with an occasional blocked UART
+    ok &= check_quantiles("bimodal", [](std::mt19937& random) {
+        return std::bernoulli_distribution(0.97)(random)
+            ? (uint32_t)std::normal_distribution<double>(40, 5)(random)
+            : std::uniform_int_distribution<uint32_t>(20000, 80000)(random);
+    }, records, *bimodal);
+
+    printf("\nframes\n");
+    std::unique_ptr<LatencySnapshot> empty = std::make_unique<LatencySnapshot>();
+    std::unique_ptr<LatencySnapshot> full = std::make_unique<LatencySnapshot>();
+    memset(empty.get(), 0, sizeof(*empty));
+    full->total = 0;
+    for (size_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+        full->counts[i] = (uint32_t)(i * 2654435761u) | 1;
+        full->total += full->counts[i];
+    }
+    full->max_us = UINT32_MAX;
+    ok &= check_round_trip("empty", *empty);
+    ok &= check_round_trip("lognormal", *lognormal);
+    ok &= check_round_trip("all", *full);
+
+    printf("\n");
+    ok &= check_reset_on_read(threads, records);
+
+    printf("\n");
+    bench_overhead(records);
+    return ok ? 0 : 1;
+}
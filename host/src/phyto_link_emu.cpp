@@ -0,0 +1,509 @@
+/**
+ * @file phyto_link_emu.cpp
+ * @brief Emulates the UART between a node and the Raspberry Pi over pseudo-terminals.
+ *
+ * @details
+ * Without `--scenario` the tool prints the node side and the host side of a
+ * `SerialLinkEmulator` and forwards bytes with the given rate, buffers and
+ * faults until the time is up or Ctrl-C, so any sender and any decoder can be
+ * tried against a noisy link:
+ *
+ * @code
+ * ./phyto_link_emu -b 115200 --ber 1e-5 --latency 20 > ports.txt &
+ * sleep 1; ./phyto_decode $(sed -n 2p ports.txt) --stats &
+ * ./phyto_replay node3.phc -o $(sed -n 1p ports.txt)
+ * @endcode
+ *
+ * With `--scenario` the tool runs scripted scenarios end to end. The host
+ * build of the sender, the node's frame pool, `FrameDispatcher` and a sink
+ * with the UART sink's backpressure policy, writes frames built by the
+ * firmware's `FrameBuilder` or `RawFrameBuilder` into the node side; a
+ * `StreamDecoder` reads the host side. Every frame carries its index in the
+ * first sample of channel 0 and samples derived from it, so the receiver
+ * tells intact frames from damaged ones: the `0xAAAA` + size framing has no
+ * checksum, and a bit error inside the samples is delivered as a valid frame.
+ *
+ * Per scenario the tool reports:
+ * - frames published, and dropped by the sink before reaching the wire;
+ * - frames lost on the link (written to the wire, never decoded) and
+ *   frames decoded with damaged samples;
+ * - goodput: samples per second of intact frames, and their bytes as a
+ *   share of the line rate;
+ * - the emulator's counters of the node to host direction.
+ *
+ * The tool exits with 1 if a scenario without faults lost or damaged a frame.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdint>
+#include <exception>
+#include <fcntl.h>
+#include <poll.h>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <unordered_set>
+#include <vector>
+
+#include "adc/SampleVector.h"
+#include "config/PipelineConfig.h"
+#include "serial_mail_sender/FrameBuilder.h"
+#include "serial_mail_sender/RawFrameBuilder.h"
+#include "stream_decoder/StreamDecoder.h"
+#include "transport/FrameBuffer.h"
+#include "transport/FrameDispatcher.h"
+#include "transport/FrameSink.h"
+#include "transport/SerialLinkEmulator.h"
+#include "utils/SerialPort.h"
+
+/// Baud rate of the node's UART (`UART_BAUDRATE`).
+#define DEFAULT_BAUDRATE 115200
+
+/// TX buffer of the Mbed serial driver (`drivers.uart-serial-txbuf-size`).
+#define DEFAULT_TX_BUFFER 256
+
+/// Receive buffer of the Pi's UART driver.
+#define DEFAULT_RX_BUFFER 4096
+
+/// Time per scenario in seconds.
+#define DEFAULT_DURATION_S 10
+
+/// Time in ms without a received byte after which a scenario's link counts as drained.
+#define SCENARIO_DRAIN_IDLE_MS 500
+
+/// Longest time in ms a scenario waits for its link to drain.
+#define SCENARIO_DRAIN_MAX_MS 10000
+
+/// Interval in ms at which the sender services its sink while no frame is due.
+#define SENDER_SERVICE_MS 1
+
+using Clock = std::chrono::steady_clock;
+
+/// Set by the signal handler to stop forwarding.
+static std::atomic<bool> stop_requested(false);
+
+static void handle_signal(int) {
+    stop_requested.store(true);
+}
+
+/**
+ * @struct Scenario
+ * @brief Scripted faults and traffic.
+ */
+struct Scenario {
+    const char*     name;           ///< Name given to `--scenario`.
+    const char*     description;    ///< One line for `--list`.
+    LinkImpairments faults;         ///< Faults of the node to host direction.
+    bool            saturate;       ///< Send frames as fast as the sink takes them instead of at the preset rate.
+    double          pause;          ///< Share of the scenario, centered, during which the receiver stops reading.
+    bool            lossless;       ///< Losing or damaging a frame fails the run.
+};
+
+/// Scenarios in the order they run; `none` is the link without faults.
+static const LinkImpairments none = {0, 0, 0, 0, 0, 0, 0};
+
+static const Scenario scenarios[] = {
+    {"clean", "no faults, frames at the preset rate", none, false, 0, true},
+    {"saturate", "no faults, frames as fast as the link takes them", none, true, 0, true},
+    {"latency", "50 ms latency with up to 20 ms jitter", {0, 0, 0, 0, 0, 50, 20}, false, 0, true},
+    {"ber-1e-6", "bit error rate 1e-6", {1e-6, 0, 0, 0, 0, 0, 0}, true, 0, false},
+    {"ber-1e-5", "bit error rate 1e-5", {1e-5, 0, 0, 0, 0, 0, 0}, true, 0, false},
+    {"ber-1e-4", "bit error rate 1e-4", {1e-4, 0, 0, 0, 0, 0, 0}, true, 0, false},
+    {"drop-1e-4", "one byte in 10^4 lost", {0, 1e-4, 0, 0, 0, 0, 0}, true, 0, false},
+    {"burst", "a 20 ms burst with bit error rate 1e-2 every 2 s", {0, 0, 0.5, 20, 1e-2, 0, 0}, true, 0, false},
+    {"slow-reader", "receiver stops reading for 80% of the time", none, true, 0.8, false},
+};
+
+/**
+ * @class PtySink
+ * @brief What `UartTransport` does on the node, writing into the node side of the emulator.
+ */
+class PtySink : public FrameSink {
+public:
+    explicit PtySink(int fd) : FrameSink("uart", BACKPRESSURE_DROP_OLDEST), m_fd(fd) {}
+
+protected:
+    size_t writeSome(const uint8_t* data, size_t size) override {
+        ssize_t count = write(m_fd, data, size);
+        return count > 0 ? (size_t)count : 0;
+    }
+
+private:
+    int m_fd;   ///< Node side, non-blocking.
+};
+
+/**
+ * @struct SenderResult
+ * @brief What the sender did.
+ */
+struct SenderResult {
+    uint32_t published;     ///< Frames built and handed to the dispatcher.
+    uint32_t pool_drops;    ///< Frames lost because the pool was empty.
+    uint32_t sink_drops;    ///< Frames dropped by the sink's backpressure policy.
+    uint32_t written;       ///< Frames completely written to the link.
+};
+
+/**
+ * @struct ScenarioResult
+ * @brief What the receiver saw.
+ */
+struct ScenarioResult {
+    SenderResult sender;    ///< Sender side.
+    uint32_t     intact;    ///< Distinct frames decoded with the samples that were sent.
+    uint32_t     damaged;   ///< Frames decoded with other samples.
+    double       elapsed_s; ///< Time from the start until the last frame was decoded.
+    DecoderStats decoder;   ///< Counters of the receiver's decoder.
+    LinkStats    link;      ///< Node to host counters of the emulator.
+};
+
+/**
+ * @brief Sample a frame carries, derived from the frame index.
+ * @details The first sample of channel 0 is the index itself.
+ */
+static int32_t test_sample(uint32_t frame, unsigned int channel, unsigned int index) {
+    if (channel == 0 && index == 0) {
+        return (int32_t)frame;
+    }
+    uint32_t x = frame * 0x9E3779B1u + channel * 0x85EBCA77u + index * 0xC2B2AE3Du;
+    x ^= x >> 15;
+    x *= 0x2C1B3C6Du;
+    x ^= x >> 12;
+    return (int32_t)(x & 0xFFFFFF) - SAMPLE_ZERO_CODE;
+}
+
+/**
+ * @brief Checks a decoded frame against the samples sent with its index.
+ * @param index Receives the frame index if the frame is intact.
+ */
+static bool frame_intact(const DecodedFrame& frame, unsigned int vector_size, uint32_t& index) {
+    if (frame.ch0.size() != vector_size || frame.ch1.size() != vector_size) {
+        return false;
+    }
+    index = (uint32_t)node_sample(frame.ch0[0]);
+    for (unsigned int i = 0; i < vector_size; i++) {
+        if (node_sample(frame.ch0[i]) != test_sample(index, 0, i) ||
+            node_sample(frame.ch1[i]) != test_sample(index, 1, i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Sends frames into the node side until the time is up, like `SerialMailSender::sendMail`.
+ *
+ * @details
+ * At the preset rate a frame is published when due and the sink is serviced
+ * in between, as by the node's main loop. Saturating, a frame is built only
+ * once the dispatcher can take it without a drop, as the adaptive batcher
+ * keeps the node from running into the backpressure policy.
+ */
+static SenderResult send_frames(int fd, bool raw, double rate_sps, bool saturate, double duration_s) {
+    FramePool pool;
+    FrameDispatcher dispatcher;
+    PtySink uart(fd);
+    dispatcher.addSink(uart);
+    FrameBuilder builder;
+    RawFrameBuilder raw_builder;
+    SampleVector ch0;
+    SampleVector ch1;
+    SenderResult result{0, 0, 0, 0};
+
+    const std::chrono::duration<double> frame_period(PhytoConfig::vector_size / rate_sps);
+    const Clock::time_point start = Clock::now();
+    const Clock::time_point end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(duration_s));
+
+    for (uint32_t index = 0;; index++) {
+        Clock::time_point due = saturate ? start
+                                         : start + std::chrono::duration_cast<Clock::duration>(frame_period * index);
+        while (Clock::now() < due || (saturate && !dispatcher.canAccept(TRAFFIC_SAMPLES))) {
+            if (Clock::now() >= end) {
+                break;
+            }
+            dispatcher.service();
+            std::this_thread::sleep_for(std::chrono::milliseconds(SENDER_SERVICE_MS));
+        }
+        if (Clock::now() >= end || due >= end) {
+            break;
+        }
+
+        ch0.clear();
+        ch1.clear();
+        for (unsigned int i = 0; i < PhytoConfig::vector_size; i++) {
+            ch0.push_back(test_sample(index, 0, i));
+            ch1.push_back(test_sample(index, 1, i));
+        }
+        FrameRef frame = pool.allocate();
+        if (!frame) {
+            dispatcher.service();
+            frame = pool.allocate();
+        }
+        if (!frame) {
+            result.pool_drops++;
+            continue;
+        }
+        size_t size;
+        if (raw) {
+            size = raw_builder.build(ch0, ch1, PhytoConfig::node, frame.mutableData(), FRAME_BUFFER_CAPACITY);
+        } else {
+            size = builder.build(ch0, ch1, PhytoConfig::node);
+            if (size <= FRAME_BUFFER_CAPACITY) {
+                std::copy(builder.data(), builder.data() + size, frame.mutableData());
+            } else {
+                size = 0;
+            }
+        }
+        if (size == 0) {
+            throw std::runtime_error("frame exceeds the frame buffer");
+        }
+        frame.setSize(size);
+        dispatcher.publish(frame, TRAFFIC_SAMPLES);
+        result.published++;
+        dispatcher.service();
+    }
+
+    // What is still queued goes out, as long as the link takes it
+    const Clock::time_point drain_end = Clock::now() + std::chrono::milliseconds(SCENARIO_DRAIN_MAX_MS);
+    while (uart.queued() > 0 && Clock::now() < drain_end) {
+        dispatcher.service();
+        std::this_thread::sleep_for(std::chrono::milliseconds(SENDER_SERVICE_MS));
+    }
+    result.sink_drops = uart.stats().dropped;
+    result.written = uart.stats().sent;
+    return result;
+}
+
+/**
+ * @brief Runs one scenario end to end.
+ */
+static ScenarioResult run_scenario(const Scenario& scenario, const LinkOptions& base, bool raw, double rate_sps,
+                                   double duration_s) {
+    LinkOptions options = base;
+    options.node_to_host = scenario.faults;
+    SerialLinkEmulator link(options);
+
+    int node_fd = open_serial_port(link.nodePath(), options.baudrate, true);
+    fcntl(node_fd, F_SETFL, fcntl(node_fd, F_GETFL) | O_NONBLOCK);
+    int host_fd = open_serial_port(link.hostPath(), options.baudrate, false);
+
+    ScenarioResult result{};
+    std::unordered_set<uint32_t> seen;
+    const Clock::time_point start = Clock::now();
+    StreamDecoder decoder([&](const DecodedFrame& frame) {
+        result.elapsed_s = std::chrono::duration<double>(Clock::now() - start).count();
+        uint32_t index;
+        if (frame_intact(frame, PhytoConfig::vector_size, index)) {
+            if (seen.insert(index).second) {
+                result.intact++;
+            }
+        } else {
+            result.damaged++;
+        }
+    });
+
+    std::atomic<bool> link_stop(false);
+    std::atomic<bool> sender_done(false);
+    std::thread forwarder([&] { link.run(0, link_stop); });
+    std::thread sender([&] {
+        result.sender = send_frames(node_fd, raw, rate_sps, scenario.saturate, duration_s);
+        sender_done.store(true);
+    });
+
+    const Clock::time_point pause_start = start + std::chrono::duration_cast<Clock::duration>(
+                                                      std::chrono::duration<double>(duration_s * 0.5 * (1 - scenario.pause)));
+    const Clock::time_point pause_end = pause_start + std::chrono::duration_cast<Clock::duration>(
+                                                          std::chrono::duration<double>(duration_s * scenario.pause));
+    Clock::time_point last_byte = start;
+    uint8_t buffer[LINK_CHUNK_SIZE];
+    while (!stop_requested.load()) {
+        Clock::time_point now = Clock::now();
+        if (sender_done.load() && now - last_byte > std::chrono::milliseconds(SCENARIO_DRAIN_IDLE_MS)) {
+            break;
+        }
+        if (now >= pause_start && now < pause_end) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            last_byte = Clock::now();
+            continue;
+        }
+        struct pollfd pfd{host_fd, POLLIN, 0};
+        if (poll(&pfd, 1, 10) <= 0) {
+            continue;
+        }
+        ssize_t count = read(host_fd, buffer, sizeof(buffer));
+        if (count > 0) {
+            decoder.feed(std::span<const uint8_t>(buffer, (size_t)count));
+            last_byte = Clock::now();
+        }
+    }
+
+    sender.join();
+    link_stop.store(true);
+    forwarder.join();
+    close(node_fd);
+    close(host_fd);
+
+    result.decoder = decoder.stats();
+    result.link = link.nodeToHost();
+    return result;
+}
+
+/**
+ * @brief Prints the counters of one direction.
+ */
+static void print_link_stats(const char* direction, const LinkStats& stats) {
+    fprintf(stderr, "%s: %llu bytes in, %llu out, %llu dropped, %llu corrupted (%llu bits), %llu overruns, %llu bursts\n",
+            direction, (unsigned long long)stats.bytes_in, (unsigned long long)stats.bytes_out,
+            (unsigned long long)stats.dropped, (unsigned long long)stats.corrupted,
+            (unsigned long long)stats.bit_errors, (unsigned long long)stats.overruns,
+            (unsigned long long)stats.bursts);
+}
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  -b <baud>           baud rate (default %d)\n"
+        "  --tx-buffer <bytes> TX buffer of the sending UART (default %d)\n"
+        "  --rx-buffer <bytes> receive buffer before overruns (default %d)\n"
+        "  --ber <rate>        bit error rate\n"
+        "  --drop <rate>       byte drop rate\n"
+        "  --burst <hz> <ms> <ber>  bursts per second, mean length and bit error rate inside\n"
+        "  --latency <ms>      latency of every byte\n"
+        "  --jitter <ms>       extra random latency, at most this much\n"
+        "  --both              apply the faults to the host to node direction as well\n"
+        "  --seed <n>          seed of the faults (default 1)\n"
+        "  -t <s>              forwarding time, 0 until Ctrl-C (default 0); time per scenario (default %d)\n"
+        "  --scenario <name>   run a scenario end to end, `all` for every one\n"
+        "  --list              list the scenarios\n"
+        "  --raw               scenarios send raw frames (RAW_FRAMES) instead of FlatBuffer frames\n"
+        "  -r <sps>            samples per second and channel of the scenarios (default: preset)\n",
+        program, DEFAULT_BAUDRATE, DEFAULT_TX_BUFFER, DEFAULT_RX_BUFFER, DEFAULT_DURATION_S);
+}
+
+int main(int argc, char** argv) {
+    LinkOptions options{DEFAULT_BAUDRATE, DEFAULT_TX_BUFFER, DEFAULT_RX_BUFFER, none, none, 1};
+    bool both = false;
+    double duration_s = -1;
+    std::string scenario_name;
+    bool raw = false;
+    double rate_sps = ad7124_rate_sps(PhytoConfig::power_mode, PhytoConfig::channels, PhytoConfig::filter_fs);
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-b" && i + 1 < argc) {
+            options.baudrate = std::stoi(argv[++i]);
+        } else if (arg == "--tx-buffer" && i + 1 < argc) {
+            options.tx_buffer = std::stoul(argv[++i]);
+        } else if (arg == "--rx-buffer" && i + 1 < argc) {
+            options.rx_buffer = std::stoul(argv[++i]);
+        } else if (arg == "--ber" && i + 1 < argc) {
+            options.node_to_host.bit_error_rate = std::stod(argv[++i]);
+        } else if (arg == "--drop" && i + 1 < argc) {
+            options.node_to_host.drop_rate = std::stod(argv[++i]);
+        } else if (arg == "--burst" && i + 3 < argc) {
+            options.node_to_host.burst_rate_hz = std::stod(argv[++i]);
+            options.node_to_host.burst_ms = std::stod(argv[++i]);
+            options.node_to_host.burst_bit_error_rate = std::stod(argv[++i]);
+        } else if (arg == "--latency" && i + 1 < argc) {
+            options.node_to_host.latency_ms = std::stod(argv[++i]);
+        } else if (arg == "--jitter" && i + 1 < argc) {
+            options.node_to_host.jitter_ms = std::stod(argv[++i]);
+        } else if (arg == "--both") {
+            both = true;
+        } else if (arg == "--seed" && i + 1 < argc) {
+            options.seed = std::stoull(argv[++i]);
+        } else if (arg == "-t" && i + 1 < argc) {
+            duration_s = std::stod(argv[++i]);
+        } else if (arg == "--scenario" && i + 1 < argc) {
+            scenario_name = argv[++i];
+        } else if (arg == "--list") {
+            for (const Scenario& scenario : scenarios) {
+                printf("%-12s %s\n", scenario.name, scenario.description);
+            }
+            return 0;
+        } else if (arg == "--raw") {
+            raw = true;
+        } else if (arg == "-r" && i + 1 < argc) {
+            rate_sps = std::stod(argv[++i]);
+        } else {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+    if (both) {
+        options.host_to_node = options.node_to_host;
+    }
+
+    std::vector<const Scenario*> selected;
+    for (const Scenario& scenario : scenarios) {
+        if (scenario_name == "all" || scenario_name == scenario.name) {
+            selected.push_back(&scenario);
+        }
+    }
+    if (!scenario_name.empty() && selected.empty()) {
+        fprintf(stderr, "unknown scenario %s\n", scenario_name.c_str());
+        return 2;
+    }
+    if (duration_s < 0) {
+        duration_s = scenario_name.empty() ? 0 : DEFAULT_DURATION_S;
+    }
+    if (options.baudrate <= 0 || options.tx_buffer == 0 || options.rx_buffer == 0 || rate_sps <= 0 ||
+        (!scenario_name.empty() && duration_s <= 0)) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    std::signal(SIGINT, handle_signal);
+    std::signal(SIGTERM, handle_signal);
+
+    try {
+        if (scenario_name.empty()) {
+            SerialLinkEmulator link(options);
+            printf("%s\n%s\n", link.nodePath().c_str(), link.hostPath().c_str());
+            fflush(stdout);
+            link.run(duration_s, stop_requested);
+            print_link_stats("node to host", link.nodeToHost());
+            print_link_stats("host to node", link.hostToNode());
+            return 0;
+        }
+
+        const double line_rate = (double)options.baudrate / LINK_BITS_PER_BYTE;
+        const double frame_samples = 2.0 * PhytoConfig::vector_size;
+        printf("%s frames of %u samples per channel, %d baud, %.0f s per scenario\n", raw ? "raw" : "FlatBuffer",
+               PhytoConfig::vector_size, options.baudrate, duration_s);
+        printf("%-12s %9s %9s %9s %9s %9s %13s %9s %9s %9s %9s\n", "scenario", "published", "sink_drop", "lost",
+               "damaged", "loss_%", "goodput_sps", "line_%", "skipped", "rejected", "overruns");
+
+        bool failed = false;
+        for (const Scenario* scenario : selected) {
+            if (stop_requested.load()) {
+                break;
+            }
+            ScenarioResult result = run_scenario(*scenario, options, raw, rate_sps, duration_s);
+            uint32_t arrived = result.intact + result.damaged;
+            uint32_t lost = result.sender.written > arrived ? result.sender.written - arrived : 0;
+            double loss = result.sender.written > 0 ? 100.0 * (lost + result.damaged) / result.sender.written : 0;
+            // Frames queued in the pseudo-terminals still arrive after the sender stopped
+            double goodput_sps = result.intact * frame_samples / std::max(result.elapsed_s, duration_s);
+            printf("%-12s %9u %9u %9u %9u %9.3f %13.0f %9.1f %9llu %9llu %9llu\n", scenario->name,
+                   result.sender.published, result.sender.sink_drops + result.sender.pool_drops, lost, result.damaged,
+                   loss, goodput_sps, 100.0 * goodput_sps * SAMPLE_WIRE_SIZE / line_rate,
+                   (unsigned long long)result.decoder.skipped_bytes,
+                   (unsigned long long)result.decoder.rejected_frames, (unsigned long long)result.link.overruns);
+            fflush(stdout);
+            if (scenario->lossless && (lost > 0 || result.damaged > 0 || result.sender.written == 0)) {
+                failed = true;
+            }
+        }
+        printf("%s\n", failed ? "FAIL: a scenario without faults lost or damaged frames" : "PASS");
+        return failed ? 1 : 0;
+    } catch (const std::exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+}
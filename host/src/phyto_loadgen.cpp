@@ -0,0 +1,98 @@
+/**
+ * @file phyto_loadgen.cpp
+ * @brief Plays many synthetic PhytoNodes on pseudo-terminals.
+ *
+ * Prints the slave device of every node and then sends frames until the time
+ * is up or Ctrl-C, so `phyto_aggregate` (or any other reader) can be tried
+ * against a greenhouse full of nodes without hardware:
+ *
+ * @code
+ * ./phyto_loadgen -n 32 -t 60 > ports.txt &
+ * sleep 1; ./phyto_aggregate $(cat ports.txt) -o all.csv --stats
+ * @endcode
+ */
+
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <exception>
+#include <string>
+
+#include "aggregator/PtyLoadGenerator.h"
+#include "config/PipelineConfig.h"
+
+/// Default number of nodes.
+#define DEFAULT_NODES 8
+
+/// Default sending time in seconds.
+#define DEFAULT_DURATION_S 60
+
+/// Set by the signal handler to stop sending.
+static std::atomic<bool> stop_requested(false);
+
+static void handle_signal(int) {
+    stop_requested.store(true);
+}
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  -n <nodes>    number of nodes (default %d)\n"
+        "  -t <s>        sending time (default %d)\n"
+        "  -r <sps>      samples per second and channel of every node, 0 for as fast as possible (default: preset)\n"
+        "  -v <samples>  samples per channel and frame (default: preset)\n"
+        "  --node <id>   node id of the first node (default 1)\n"
+        "  --raw         send raw frames (RAW_FRAMES) instead of FlatBuffer frames\n",
+        program, DEFAULT_NODES, DEFAULT_DURATION_S);
+}
+
+int main(int argc, char** argv) {
+    unsigned int nodes = DEFAULT_NODES;
+    double duration_s = DEFAULT_DURATION_S;
+    LoadOptions options{
+        (double)ad7124_rate_sps(PhytoConfig::power_mode, PhytoConfig::channels, PhytoConfig::filter_fs),
+        PhytoConfig::vector_size, false, 1, 1};
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-n" && i + 1 < argc) {
+            nodes = (unsigned int)std::stoul(argv[++i]);
+        } else if (arg == "-t" && i + 1 < argc) {
+            duration_s = std::stod(argv[++i]);
+        } else if (arg == "-r" && i + 1 < argc) {
+            options.rate_sps = std::stod(argv[++i]);
+        } else if (arg == "-v" && i + 1 < argc) {
+            options.vector_size = (unsigned int)std::stoul(argv[++i]);
+        } else if (arg == "--node" && i + 1 < argc) {
+            options.first_node = std::stoi(argv[++i]);
+        } else if (arg == "--raw") {
+            options.raw = true;
+        } else {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+    if (nodes < 1 || options.vector_size < 1 || options.rate_sps < 0 || duration_s <= 0) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    std::signal(SIGINT, handle_signal);
+    std::signal(SIGTERM, handle_signal);
+
+    try {
+        PtyLoadGenerator generator(nodes, options);
+        for (const std::string& path : generator.paths()) {
+            printf("%s\n", path.c_str());
+        }
+        fflush(stdout);
+
+        LoadStats stats = generator.run(duration_s, stop_requested);
+        fprintf(stderr, "sent %llu frames (%llu bytes), %llu late\n", (unsigned long long)stats.frames,
+                (unsigned long long)stats.bytes, (unsigned long long)stats.late_frames);
+    } catch (const std::exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
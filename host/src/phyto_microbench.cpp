@@ -0,0 +1,324 @@
+/**
+ * @file phyto_microbench.cpp
+ * @brief Microbenchmarks of the firmware's hot-path code, compiled for the host.
+ *
+ * @details
+ * Every benchmark runs a fixed number of iterations per repetition, so results
+ * of different commits are comparable; the median over the repetitions is
+ * reported in ns/op together with heap allocations and allocated bytes per
+ * operation, counted by replacing the global `operator new`.
+ *
+ * - `conversion`: 24-bit unpacking and sample-to-millivolt conversion with
+ *   runtime constants and with those of the configured preset.
+ * - `acquisition`: demultiplexing conversion words into `int32_t` samples with
+ *   `SampleCollector` and `FixedSampleCollector`.
+ * - `serialization`: `FrameBuilder` into its own vector and into a pooled
+ *   buffer, and `RawFrameBuilder` into a pooled buffer.
+ * - `handoff`: pool allocation, fan-out through the `FrameDispatcher` and
+ *   `FrameRef` reference counting.
+ *
+ * With `--json` the results are written as JSON for tracking over time.
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "adc/FixedSampleCollector.h"
+#include "adc/SampleCollector.h"
+#include "config/PipelineConfig.h"
+#include "serial_mail_sender/FrameBuilder.h"
+#include "serial_mail_sender/RawFrameBuilder.h"
+#include "transport/FrameBuffer.h"
+#include "transport/FrameDispatcher.h"
+#include "transport/LoopbackTransport.h"
+#include "utils/ConversionKernel.h"
+
+/// Repetitions of every benchmark; the median is reported.
+#define DEFAULT_REPETITIONS 5
+
+/// Conversion words prepared as input, a power of two for cheap wrapping.
+#define WORD_COUNT 4096
+
+/// Allocations made through `operator new` since start.
+static std::atomic<uint64_t> allocation_count{0};
+
+/// Bytes requested through `operator new` since start.
+static std::atomic<uint64_t> allocation_bytes{0};
+
+void* operator new(size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    allocation_bytes.fetch_add(size, std::memory_order_relaxed);
+    void* p = malloc(size > 0 ? size : 1);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+/**
+ * @brief Keeps a value alive so the compiler cannot drop the work producing it.
+ */
+template <typename T>
+static inline void keep(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/**
+ * @struct BenchResult
+ * @brief Outcome of one benchmark.
+ */
+struct BenchResult {
+    std::string name;           ///< Benchmark name, `group/case`.
+    uint64_t    iterations;     ///< Operations per repetition.
+    uint32_t    repetitions;    ///< Timed repetitions.
+    double      ns_per_op;      ///< Median time per operation.
+    double      min_ns_per_op;  ///< Fastest repetition.
+    double      allocs_per_op;  ///< Heap allocations per operation.
+    double      bytes_per_op;   ///< Heap bytes per operation.
+};
+
+/**
+ * @struct BenchOptions
+ * @brief Command line options.
+ */
+struct BenchOptions {
+    std::string filter;         ///< Only run benchmarks whose name contains this.
+    std::string json_path;      ///< JSON output file, `-` for stdout, empty for none.
+    uint32_t    repetitions;    ///< Timed repetitions per benchmark.
+    double      scale;          ///< Factor applied to all iteration counts.
+};
+
+/**
+ * @brief Runs `op` `iterations` times per repetition after one untimed warm-up.
+ * @param op Callable taking the iteration index.
+ */
+template <typename Op>
+static BenchResult run_bench(const BenchOptions& options, const char* name, uint64_t iterations, Op op) {
+    iterations = std::max<uint64_t>(1, (uint64_t)(iterations * options.scale));
+    for (uint64_t i = 0; i < iterations / 10 + 1; i++) {
+        op(i);
+    }
+
+    std::vector<double> times;
+    uint64_t allocations = allocation_count.load();
+    uint64_t bytes = allocation_bytes.load();
+    for (uint32_t r = 0; r < options.repetitions; r++) {
+        auto start = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < iterations; i++) {
+            op(i);
+        }
+        auto end = std::chrono::steady_clock::now();
+        times.push_back(std::chrono::duration<double, std::nano>(end - start).count() / iterations);
+    }
+    double ops = (double)iterations * options.repetitions;
+    allocations = allocation_count.load() - allocations;
+    bytes = allocation_bytes.load() - bytes;
+
+    std::sort(times.begin(), times.end());
+    return BenchResult{name, iterations, options.repetitions, times[times.size() / 2], times.front(),
+                       allocations / ops, bytes / ops};
+}
+
+/**
+ * @brief Conversion words alternating between channel 0 and 1 with pseudo-random data.
+ */
+static std::vector<std::array<uint8_t, AD7124_CONVERSION_WORD_SIZE>> make_words(void) {
+    std::vector<std::array<uint8_t, AD7124_CONVERSION_WORD_SIZE>> words(WORD_COUNT);
+    uint32_t state = 12345;
+    for (size_t i = 0; i < words.size(); i++) {
+        state = state * 1664525u + 1013904223u;
+        words[i] = {(uint8_t)(state >> 24), (uint8_t)(state >> 16), (uint8_t)(state >> 8), (uint8_t)(i % 2)};
+    }
+    return words;
+}
+
+/**
+ * @brief Fills a sample vector with one frame worth of samples.
+ */
+static SampleVector make_channel(const std::vector<std::array<uint8_t, AD7124_CONVERSION_WORD_SIZE>>& words,
+                                 size_t offset) {
+    SampleVector channel;
+    for (size_t i = 0; i < PhytoConfig::vector_size; i++) {
+        const std::array<uint8_t, AD7124_CONVERSION_WORD_SIZE>& word = words[(offset + i) % words.size()];
+        channel.push_back(sample_from_bytes(word.data()));
+    }
+    return channel;
+}
+
+static std::vector<BenchResult> run_all(const BenchOptions& options) {
+    constexpr unsigned int N = PhytoConfig::vector_size;
+    std::vector<std::array<uint8_t, AD7124_CONVERSION_WORD_SIZE>> words = make_words();
+    SampleVector ch0 = make_channel(words, 0);
+    SampleVector ch1 = make_channel(words, N);
+    std::array<int32_t, N> fixed_ch0;
+    std::copy(ch0.begin(), ch0.end(), fixed_ch0.begin());
+
+    std::vector<BenchResult> results;
+    auto add = [&](const char* name, uint64_t iterations, auto op) {
+        if (std::string(name).find(options.filter) != std::string::npos) {
+            results.push_back(run_bench(options, name, iterations, op));
+        }
+    };
+
+    // Conversion, one operation is one channel of a frame
+    volatile int32_t databits = PhytoConfig::databits;
+    volatile float vref = PhytoConfig::vref;
+    volatile float gain = PhytoConfig::gain;
+    std::array<float, N> millivolts;
+    add("conversion/unpack_24bit", 2000000, [&](uint64_t) {
+        int32_t sum = 0;
+        for (size_t i = 0; i < N; i++) {
+            sum += sample_from_bytes(words[i].data());
+        }
+        keep(sum);
+    });
+    add("conversion/runtime_constants", 2000000, [&](uint64_t) {
+        convert_samples(ch0.data(), ch0.size(), databits, vref, gain, millivolts.data());
+        keep(millivolts);
+    });
+    add("conversion/preset_constants", 2000000, [&](uint64_t) {
+        convert_samples<PhytoConfig>(fixed_ch0, millivolts);
+        keep(millivolts);
+    });
+
+    // Acquisition, one operation is one conversion word
+    SampleCollector collector(N);
+    add("acquisition/sample_collector_push", 20000000, [&](uint64_t i) {
+        if (collector.push(words[i % WORD_COUNT].data())) {
+            collector.clear();
+        }
+    });
+    FixedSampleCollector<N> fixed_collector;
+    add("acquisition/fixed_collector_push", 20000000, [&](uint64_t i) {
+        if (fixed_collector.push(words[i % WORD_COUNT].data())) {
+            fixed_collector.clear();
+        }
+    });
+
+    // Serialization, one operation is one frame
+    FrameBuilder builder;
+    uint8_t frame[FRAME_BUFFER_CAPACITY];
+    add("serialization/frame_builder_vector", 1000000, [&](uint64_t) {
+        keep(builder.build(ch0, ch1, PhytoConfig::node));
+    });
+    add("serialization/frame_builder_buffer", 1000000, [&](uint64_t) {
+        keep(builder.build(ch0, ch1, PhytoConfig::node, frame, sizeof(frame)));
+    });
+    RawFrameBuilder raw_builder;
+    add("serialization/raw_frame_buffer", 1000000, [&](uint64_t) {
+        keep(raw_builder.build(ch0, ch1, PhytoConfig::node, frame, sizeof(frame)));
+    });
+
+    // Hand-off, one operation is one frame through pool, dispatcher and sink
+    FramePool pool;
+    FrameDispatcher dispatcher;
+    LoopbackTransport sink("bench");
+    dispatcher.addSink(sink);
+    uint8_t drained[LOOPBACK_BUFFER_SIZE];
+    add("handoff/publish_service_read", 2000000, [&](uint64_t) {
+        FrameRef ref = pool.allocate();
+        size_t size = builder.build(ch0, ch1, PhytoConfig::node, ref.mutableData(), FRAME_BUFFER_CAPACITY);
+        ref.setSize(size);
+        dispatcher.publish(ref);
+        ref.reset();
+        dispatcher.service();
+        keep(sink.read(drained, sizeof(drained)));
+    });
+    FrameRef shared = pool.allocate();
+    add("handoff/frame_ref_copy", 20000000, [&](uint64_t) {
+        FrameRef copy = shared;
+        keep(copy.size());
+    });
+
+    return results;
+}
+
+static void print_results(const std::vector<BenchResult>& results) {
+    printf("%-38s %12s %10s %10s %10s %10s\n", "benchmark", "iterations", "ns/op", "min ns/op", "allocs/op", "bytes/op");
+    for (const BenchResult& result : results) {
+        printf("%-38s %12llu %10.2f %10.2f %10.3f %10.1f\n", result.name.c_str(),
+               (unsigned long long)result.iterations, result.ns_per_op, result.min_ns_per_op,
+               result.allocs_per_op, result.bytes_per_op);
+    }
+}
+
+/**
+ * @brief Writes the results in a flat JSON layout that diff and plotting tools can read.
+ */
+static bool write_json(const std::vector<BenchResult>& results, const std::string& path) {
+    FILE* out = (path == "-") ? stdout : fopen(path.c_str(), "w");
+    if (out == nullptr) {
+        perror(path.c_str());
+        return false;
+    }
+
+    fprintf(out, "{\n  \"context\": {\"vector_size\": %u, \"compiler\": \"%s\"},\n  \"benchmarks\": [\n",
+            PhytoConfig::vector_size, __VERSION__);
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& result = results[i];
+        fprintf(out,
+                "    {\"name\": \"%s\", \"iterations\": %llu, \"repetitions\": %u, \"ns_per_op\": %.3f, "
+                "\"min_ns_per_op\": %.3f, \"allocs_per_op\": %.4f, \"bytes_per_op\": %.2f}%s\n",
+                result.name.c_str(), (unsigned long long)result.iterations, result.repetitions, result.ns_per_op,
+                result.min_ns_per_op, result.allocs_per_op, result.bytes_per_op, i + 1 < results.size() ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+
+    if (out != stdout) {
+        fclose(out);
+    }
+    return true;
+}
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --filter <text>   only run benchmarks whose name contains <text>\n"
+        "  --json <path>     write results as JSON to <path> (- for stdout)\n"
+        "  -r <n>            repetitions per benchmark (default %d)\n"
+        "  --scale <f>       multiply all iteration counts by <f> (default 1)\n",
+        program, DEFAULT_REPETITIONS);
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options{"", "", DEFAULT_REPETITIONS, 1.0};
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--filter" && i + 1 < argc) {
+            options.filter = argv[++i];
+        } else if (arg == "--json" && i + 1 < argc) {
+            options.json_path = argv[++i];
+        } else if (arg == "-r" && i + 1 < argc) {
+            options.repetitions = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--scale" && i + 1 < argc) {
+            options.scale = std::stod(argv[++i]);
+        } else {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+
+    std::vector<BenchResult> results = run_all(options);
+    if (options.json_path != "-") {
+        print_results(results);
+    }
+    if (!options.json_path.empty() && !write_json(results, options.json_path)) {
+        return 1;
+    }
+    return 0;
+}
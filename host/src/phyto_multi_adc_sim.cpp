@@ -0,0 +1,301 @@
+/**
+ * @file phyto_multi_adc_sim.cpp
+ * @brief Simulates several AD7124 on one SPI bus serviced by the node's scheduler.
+ *
+ * @details
+ * Every simulated converter completes a conversion per channel period,
+ * alternating its two channels like the sequencer, and keeps only the latest
+ * result, as the AD7124 data register does. Its conversion index is the
+ * sample value, with the device in the top bits, so every lost conversion
+ * shows up downstream. The node's `DeviceScheduler` polls the converters
+ * through the same `try_read_conversion_word` interface as on the node, and
+ * every poll, word transfer and frame hand-off advances a simulated clock by
+ * the bus time it takes. Complete frames are serialized with the device tag
+ * and decoded again by the `StreamDecoder`.
+ *
+ * By default all converters share the clock of device 0 and are started by
+ * one SYNC pulse, so they all become ready at the same instant, the worst
+ * case for the bus. `--no-sync` starts them at random phases and `--ppm`
+ * gives each its own clock error, as without the shared clock.
+ *
+ * For 2, 3 and 4 devices (or the count given with `-d`) the tool reports the
+ * conversions read and lost, repeated channels seen by the scheduler, the
+ * worst and mean time from a conversion to its read, and the bus load, and
+ * checks that the decoded samples of every device are complete and in order.
+ * It fails if a conversion was lost or a sample is missing.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "adc/DeviceScheduler.h"
+#include "config/PipelineConfig.h"
+#include "serial_mail_sender/FrameBuilder.h"
+#include "serial_mail_sender/RawFrameBuilder.h"
+#include "stream_decoder/StreamDecoder.h"
+#include "transport/FrameBuffer.h"
+
+/// Simulated time per device count.
+#define DEFAULT_DURATION_S 60
+
+/// Time to select a device, wait for DOUT/RDY and deselect it again, in µs.
+#define POLL_US 0.5
+
+/// Overhead per byte of a blocking `SPI::write` on the node, in µs.
+#define SPI_BYTE_OVERHEAD_US 1.0
+
+/// Time to hand a frame to the main thread (mail allocation, copy, put), in µs.
+#define HANDOFF_US 20.0
+
+/// Bits of the sample value holding the conversion index; the device is stored above.
+#define INDEX_BITS 20
+
+/**
+ * @class SimulatedConverter
+ * @brief AD7124 in continuous read mode as seen through its chip select.
+ */
+class SimulatedConverter {
+public:
+    /**
+     * @param now Simulated time shared by the bus, in µs.
+     * @param device Index of the device, stored in the sample values.
+     * @param period_us Time between two conversions (of alternating channels).
+     * @param phase_us Completion time of the first conversion.
+     * @param read_us Time of a 4-byte transfer.
+     */
+    SimulatedConverter(double* now, unsigned int device, double period_us, double phase_us, double read_us)
+        : m_now(now), m_device(device), m_period_us(period_us), m_phase_us(phase_us), m_read_us(read_us),
+          m_last_read(-1), m_lost(0), m_reads(0), m_latency_sum_us(0), m_latency_max_us(0) {}
+
+    /**
+     * @brief Same contract as `AD7124::try_read_conversion_word`.
+     *
+     * A conversion completed before the previous one was read has overwritten
+     * it; the overwritten ones are counted as lost.
+     */
+    bool try_read_conversion_word(uint8_t data[4]) {
+        *m_now += POLL_US;
+        int64_t latest = *m_now < m_phase_us ? -1 : (int64_t)std::floor((*m_now - m_phase_us) / m_period_us);
+        if (latest <= m_last_read) {
+            return false;
+        }
+        m_lost += latest - m_last_read - 1;
+        m_last_read = latest;
+
+        double latency_us = *m_now - (m_phase_us + latest * m_period_us);
+        m_latency_sum_us += latency_us;
+        m_latency_max_us = std::max(m_latency_max_us, latency_us);
+        m_reads++;
+
+        uint32_t index = (uint32_t)(latest / 2) & ((1u << INDEX_BITS) - 1);
+        uint32_t code = (m_device << INDEX_BITS) | index;
+        data[0] = (uint8_t)(code >> 16);
+        data[1] = (uint8_t)(code >> 8);
+        data[2] = (uint8_t)code;
+        data[3] = (uint8_t)(latest % 2);
+        *m_now += m_read_us;
+        return true;
+    }
+
+    uint64_t lost(void) const { return m_lost; }
+    uint64_t reads(void) const { return m_reads; }
+    double meanLatencyUs(void) const { return m_reads > 0 ? m_latency_sum_us / m_reads : 0; }
+    double maxLatencyUs(void) const { return m_latency_max_us; }
+
+private:
+    double*      m_now;
+    unsigned int m_device;
+    double       m_period_us;
+    double       m_phase_us;
+    double       m_read_us;
+    int64_t      m_last_read;       ///< Index of the conversion read last.
+    uint64_t     m_lost;
+    uint64_t     m_reads;
+    double       m_latency_sum_us;
+    double       m_latency_max_us;
+};
+
+/**
+ * @struct SimOptions
+ * @brief Settings shared by all runs.
+ */
+struct SimOptions {
+    double       duration_s;    ///< Simulated time per run.
+    double       rate_sps;      ///< Samples per second and channel.
+    double       spi_hz;        ///< SPI clock.
+    double       ppm;           ///< Largest clock error of a device, 0 with the shared clock.
+    bool         sync;          ///< Start all devices together.
+    bool         raw;           ///< Raw frames instead of FlatBuffers.
+    unsigned int seed;          ///< Random seed of phases and clock errors.
+};
+
+/**
+ * @struct DeviceCheck
+ * @brief Samples of one device as decoded on the host.
+ */
+struct DeviceCheck {
+    uint64_t frames;            ///< Frames decoded.
+    uint64_t samples;           ///< Samples over both channels.
+    uint64_t gaps;              ///< Samples whose index did not follow the previous one of the channel.
+    int64_t  next[2];           ///< Expected index per channel.
+};
+
+/**
+ * @brief Runs the node's scheduler against `devices` simulated converters.
+ * @return True if no conversion was lost and every sample arrived in order.
+ */
+static bool run(unsigned int devices, const SimOptions& options) {
+    std::mt19937 random(options.seed + devices);
+    std::uniform_real_distribution<double> unit(0, 1);
+    const double period_us = 1e6 / (options.rate_sps * 2);
+    const double read_us = 4 * (8 * 1e6 / options.spi_hz + SPI_BYTE_OVERHEAD_US);
+
+    double now = 0;
+    std::vector<SimulatedConverter> converters;
+    converters.reserve(devices);
+    for (unsigned int i = 0; i < devices; i++) {
+        double error = options.ppm * (2 * unit(random) - 1) * 1e-6;
+        double phase = options.sync ? period_us : period_us * (1 + unit(random));
+        converters.emplace_back(&now, i, period_us * (1 + error), phase, read_us);
+    }
+    std::vector<SimulatedConverter*> pointers;
+    for (SimulatedConverter& converter : converters) {
+        pointers.push_back(&converter);
+    }
+    DeviceScheduler<SimulatedConverter> scheduler(pointers.data(), devices, PhytoConfig::vector_size);
+
+    std::vector<DeviceCheck> checks(devices, DeviceCheck{0, 0, 0, {0, 0}});
+    uint64_t tag_errors = 0;
+    StreamDecoder decoder([&](const DecodedFrame& frame) {
+        if (frame.device >= devices) {
+            tag_errors++;
+            return;
+        }
+        DeviceCheck& check = checks[frame.device];
+        check.frames++;
+        std::span<const SerialMail::Value> channels[2] = {frame.ch0, frame.ch1};
+        for (unsigned int channel = 0; channel < 2; channel++) {
+            for (const SerialMail::Value& value : channels[channel]) {
+                uint32_t code = raw_code(value);
+                tag_errors += (code >> INDEX_BITS) != frame.device ? 1 : 0;
+                int64_t index = code & ((1u << INDEX_BITS) - 1);
+                check.gaps += index != check.next[channel] ? 1 : 0;
+                check.next[channel] = index + 1;
+                check.samples++;
+            }
+        }
+    });
+
+    FrameBuilder builder;
+    RawFrameBuilder raw_builder;
+    uint8_t frame[FRAME_BUFFER_CAPACITY];
+    double handoff_us = 0;
+    const double end_us = options.duration_s * 1e6;
+    while (now < end_us) {
+        int device = scheduler.poll();
+        if (device == DEVICE_SCHEDULER_NONE) {
+            continue;
+        }
+        const SampleCollector& collector = scheduler.collector(device);
+        size_t size = options.raw
+            ? raw_builder.build(collector.ch0(), collector.ch1(), PhytoConfig::node, frame, sizeof(frame), device)
+            : builder.build(collector.ch0(), collector.ch1(), PhytoConfig::node, frame, sizeof(frame), device);
+        decoder.feed({frame, size});
+        scheduler.clear(device);
+        now += HANDOFF_US;
+        handoff_us += HANDOFF_US;
+    }
+
+    bool ok = tag_errors == 0;
+    uint64_t reads = 0;
+    printf("%u devices:\n", devices);
+    printf("  %-7s %10s %8s %8s %12s %12s %8s %10s %6s\n", "device", "read", "lost", "repeats", "latency avg",
+           "latency max", "frames", "samples", "gaps");
+    for (unsigned int i = 0; i < devices; i++) {
+        const SimulatedConverter& converter = converters[i];
+        const DeviceStats& stats = scheduler.stats(i);
+        const DeviceCheck& check = checks[i];
+        printf("  %-7u %10llu %8llu %8u %9.1f us %9.1f us %8llu %10llu %6llu\n", i,
+               (unsigned long long)converter.reads(), (unsigned long long)converter.lost(), stats.repeats,
+               converter.meanLatencyUs(), converter.maxLatencyUs(), (unsigned long long)check.frames,
+               (unsigned long long)check.samples, (unsigned long long)check.gaps);
+        ok &= converter.lost() == 0 && check.gaps == 0 && check.frames > 0;
+        reads += converter.reads();
+    }
+    double busy_us = reads * read_us + handoff_us;
+    double burst_us = devices * (read_us + POLL_US) + HANDOFF_US;
+    printf("  bus busy %.2f%%, all devices read in %.1f us of a %.1f us conversion period, tag errors %llu: %s\n\n",
+           100.0 * busy_us / now, burst_us, period_us, (unsigned long long)tag_errors, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  -d <devices>  simulate only this number of devices (1-%d, default 2, 3 and 4)\n"
+        "  -t <s>        simulated time per run (default %d)\n"
+        "  -r <sps>      samples per second and channel (default: preset)\n"
+        "  -f <hz>       SPI clock (default: preset)\n"
+        "  --ppm <ppm>   clock error of each device up to +-ppm, as without the shared clock\n"
+        "  --no-sync     start the devices at random phases instead of with one SYNC pulse\n"
+        "  -s <seed>     random seed (default 1)\n"
+        "  --raw         send raw frames (RAW_FRAMES) instead of FlatBuffer frames\n",
+        program, DEVICE_SCHEDULER_MAX_DEVICES, DEFAULT_DURATION_S);
+}
+
+int main(int argc, char** argv) {
+    SimOptions options{DEFAULT_DURATION_S,
+                       (double)ad7124_rate_sps(PhytoConfig::power_mode, PhytoConfig::channels, PhytoConfig::filter_fs),
+                       (double)PhytoConfig::spi_frequency, 0, true, false, 1};
+    unsigned int only_devices = 0;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--raw") {
+            options.raw = true;
+        } else if (arg == "--no-sync") {
+            options.sync = false;
+        } else if (arg == "--ppm" && i + 1 < argc) {
+            options.ppm = std::stod(argv[++i]);
+        } else if (arg == "-d" && i + 1 < argc) {
+            only_devices = (unsigned int)std::stoul(argv[++i]);
+        } else if (arg == "-t" && i + 1 < argc) {
+            options.duration_s = std::stod(argv[++i]);
+        } else if (arg == "-r" && i + 1 < argc) {
+            options.rate_sps = std::stod(argv[++i]);
+        } else if (arg == "-f" && i + 1 < argc) {
+            options.spi_hz = std::stod(argv[++i]);
+        } else if (arg == "-s" && i + 1 < argc) {
+            options.seed = (unsigned int)std::stoul(argv[++i]);
+        } else {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+    if (options.duration_s <= 0 || options.rate_sps <= 0 || options.spi_hz <= 0 || options.ppm < 0 ||
+        only_devices > DEVICE_SCHEDULER_MAX_DEVICES) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    printf("%.0f SPS per channel, SPI %.1f MHz, %u samples per frame, %s, %s frames, %.0f s\n\n",
+           options.rate_sps, options.spi_hz / 1e6, PhytoConfig::vector_size,
+           options.sync ? "SYNC and shared clock" : "random phases", options.raw ? "raw" : "FlatBuffer",
+           options.duration_s);
+
+    bool ok = true;
+    for (unsigned int devices = 2; devices <= DEVICE_SCHEDULER_MAX_DEVICES; devices++) {
+        if (only_devices == 0 || only_devices == devices) {
+            ok &= run(devices, options);
+        }
+    }
+    if (only_devices == 1) {
+        ok &= run(1, options);
+    }
+    return ok ? 0 : 1;
+}
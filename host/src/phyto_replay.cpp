@@ -0,0 +1,243 @@
+/**
+ * @file phyto_replay.cpp
+ * @brief Feeds a capture back through the node's acquisition, framing and serialization code.
+ *
+ * @details
+ * - SPI word captures run through the firmware's `SampleCollector` and
+ *   `FrameBuilder` (`RawFrameBuilder` with `--raw`), producing exactly the
+ *   frames the node would have sent.
+ * - Frame captures are decoded and re-serialized with `FrameBuilder`, or with
+ *   `RawFrameBuilder` for raw frames and `build_band_frame` for band power
+ *   frames; every frame that does not come out
+ *   byte-identical is counted as a mismatch, which makes the replay a
+ *   regression check for both serializers.
+ *
+ * Replay runs at maximum speed by default and reports throughput, or paced by
+ * the recorded timestamps with `--realtime`.
+ */
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <span>
+#include <string>
+#include <thread>
+
+#include "adc/SampleCollector.h"
+#include "capture/CaptureFile.h"
+#include "config/PipelineConfig.h"
+#include "serial_mail_sender/BandFrameBuilder.h"
+#include "serial_mail_sender/FrameBuilder.h"
+#include "serial_mail_sender/RawFrameBuilder.h"
+#include "stream_decoder/StreamDecoder.h"
+#include "transport/FrameBuffer.h"
+#include "utils/MappedFile.h"
+
+/// Default number of samples per channel and frame, that of the configured preset.
+#define DEFAULT_VECTOR_SIZE ((int)PhytoConfig::vector_size)
+
+/// Node id used for SPI captures that do not carry one.
+#define DEFAULT_NODE PhytoConfig::node
+
+/**
+ * @struct ReplayStats
+ * @brief Counters reported at the end of a replay.
+ */
+struct ReplayStats {
+    uint64_t records;       ///< Capture records replayed.
+    uint64_t words;         ///< Conversion words fed into the collector.
+    uint64_t frames;        ///< Frames produced by the serializer.
+    uint64_t bytes;         ///< Bytes of produced frames.
+    uint64_t mismatches;    ///< Re-serialized frames that differ from the capture.
+};
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+        "usage: %s [options] <capture>\n"
+        "  --realtime    pace records by their recorded timestamps\n"
+        "  --from <s>    start at second <s> of the capture (uses the index)\n"
+        "  -o <path>     write the produced frame stream to <path>\n"
+        "  -n <node>     node id for frames built from SPI words\n"
+        "  --raw         build raw frames (RAW_FRAMES) from SPI words\n"
+        "  -v <size>     samples per channel for frames built from SPI words (default %d)\n",
+        program, DEFAULT_VECTOR_SIZE);
+}
+
+/**
+ * @brief Converts decoded sample spans back into the representation used by the node.
+ */
+static void to_samples(std::span<const SerialMail::Value> values, SampleVector& out) {
+    out.clear();
+    for (const SerialMail::Value& value : values) {
+        out.push_back(node_sample(value));
+    }
+}
+
+int main(int argc, char** argv) {
+    std::string input;
+    std::string output;
+    bool realtime = false;
+    bool raw = false;
+    double from_seconds = 0;
+    int node = -1;
+    unsigned int vector_size = DEFAULT_VECTOR_SIZE;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc) {
+            output = argv[++i];
+        } else if (arg == "-n" && i + 1 < argc) {
+            node = std::stoi(argv[++i]);
+        } else if (arg == "-v" && i + 1 < argc) {
+            vector_size = (unsigned int)std::stoul(argv[++i]);
+        } else if (arg == "--from" && i + 1 < argc) {
+            from_seconds = std::stod(argv[++i]);
+        } else if (arg == "--realtime") {
+            realtime = true;
+        } else if (arg == "--raw") {
+            raw = true;
+        } else if (!arg.empty() && arg[0] != '-' && input.empty()) {
+            input = arg;
+        } else {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+    if (input.empty()) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    try {
+        MappedFile file(input);
+        CaptureReader reader(file.bytes());
+        if (node < 0) {
+            node = reader.header().node != 0 ? reader.header().node : DEFAULT_NODE;
+        }
+
+        FILE* out = nullptr;
+        if (!output.empty()) {
+            out = fopen(output.c_str(), "wb");
+            if (out == nullptr) {
+                fprintf(stderr, "cannot open %s: %s\n", output.c_str(), strerror(errno));
+                return 1;
+            }
+        }
+
+        ReplayStats stats{0, 0, 0, 0, 0};
+        SampleCollector collector(vector_size);
+        FrameBuilder builder;
+        RawFrameBuilder raw_builder;
+        uint8_t raw_frame[FRAME_BUFFER_CAPACITY];
+        SampleVector ch0;
+        SampleVector ch1;
+
+        auto emit = [&](const uint8_t* data, size_t size) {
+            stats.frames++;
+            stats.bytes += size;
+            if (out != nullptr) {
+                fwrite(data, 1, size, out);
+            }
+        };
+
+        // Serializes like the node, returns the frame and its size (0 if it does not fit)
+        auto build = [&](const SampleVector& a, const SampleVector& b, int frame_node, unsigned int device,
+                         bool raw_frame_mode) {
+            if (raw_frame_mode) {
+                size_t size = raw_builder.build(a, b, frame_node, raw_frame, sizeof(raw_frame), device);
+                return std::span<const uint8_t>(raw_frame, size);
+            }
+            builder.build(a, b, frame_node, device);
+            return std::span<const uint8_t>(builder.data(), builder.size());
+        };
+
+        StreamDecoder decoder([&](const DecodedFrame& frame) {
+            if (frame.version == BAND_FRAME_VERSION) {
+                // Only frames of both channels and at most BAND_POWER_MAX_BANDS can be rebuilt
+                BandPowers powers{frame.sequence, frame.band_count, {}};
+                if (frame.band_count > BAND_POWER_MAX_BANDS ||
+                    frame.bands.size() != (size_t)BAND_POWER_CHANNELS * frame.band_count) {
+                    stats.mismatches++;
+                    emit(frame.frame.data(), frame.frame.size());
+                    return;
+                }
+                for (size_t channel = 0; channel < BAND_POWER_CHANNELS; channel++) {
+                    for (size_t band = 0; band < frame.band_count; band++) {
+                        powers.power[channel][band] = frame.bands[channel * frame.band_count + band];
+                    }
+                }
+                size_t size = build_band_frame(powers, frame.node, raw_frame, sizeof(raw_frame));
+                if (size != frame.frame.size() || memcmp(raw_frame, frame.frame.data(), size) != 0) {
+                    stats.mismatches++;
+                }
+                emit(raw_frame, size);
+                return;
+            }
+            to_samples(frame.ch0, ch0);
+            to_samples(frame.ch1, ch1);
+            bool raw_frame_mode = frame.version == RAW_FRAME_VERSION;
+            if (raw_frame_mode) {
+                raw_builder.setSequence(frame.sequence);
+            }
+            std::span<const uint8_t> rebuilt = build(ch0, ch1, frame.node, frame.device, raw_frame_mode);
+            if (rebuilt.size() != frame.frame.size() ||
+                memcmp(rebuilt.data(), frame.frame.data(), rebuilt.size()) != 0) {
+                stats.mismatches++;
+            }
+            emit(rebuilt.data(), rebuilt.size());
+        });
+
+        reader.seek((uint64_t)(from_seconds * 1e6));
+
+        CaptureRecord record;
+        uint64_t first_time_us = 0;
+        bool first = true;
+        auto start = std::chrono::steady_clock::now();
+
+        while (reader.next(record)) {
+            if (first) {
+                first_time_us = record.time_us;
+                first = false;
+            }
+            if (realtime) {
+                std::this_thread::sleep_until(start + std::chrono::microseconds(record.time_us - first_time_us));
+            }
+            stats.records++;
+
+            if (record.kind == CAPTURE_KIND_SPI_WORDS) {
+                for (size_t offset = 0; offset + AD7124_CONVERSION_WORD_SIZE <= record.payload.size();
+                     offset += AD7124_CONVERSION_WORD_SIZE) {
+                    stats.words++;
+                    if (collector.push(record.payload.data() + offset)) {
+                        std::span<const uint8_t> frame = build(collector.ch0(), collector.ch1(), node, 0, raw);
+                        collector.clear();
+                        emit(frame.data(), frame.size());
+                    }
+                }
+            } else if (record.kind == CAPTURE_KIND_FRAMES) {
+                decoder.feed(record.payload);
+            }
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (out != nullptr) {
+            fclose(out);
+        }
+
+        fprintf(stderr, "records:          %llu\n", (unsigned long long)stats.records);
+        fprintf(stderr, "corrupt records:  %u\n", reader.corruptRecords());
+        fprintf(stderr, "spi words:        %llu\n", (unsigned long long)stats.words);
+        fprintf(stderr, "frames:           %llu (%llu bytes)\n", (unsigned long long)stats.frames, (unsigned long long)stats.bytes);
+        fprintf(stderr, "mismatches:       %llu\n", (unsigned long long)stats.mismatches);
+        fprintf(stderr, "elapsed:          %.3f s\n", seconds);
+        if (seconds > 0) {
+            fprintf(stderr, "throughput:       %.0f words/s, %.0f frames/s\n", stats.words / seconds, stats.frames / seconds);
+        }
+        return stats.mismatches == 0 ? 0 : 3;
+    } catch (const std::exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+}
@@ -0,0 +1,387 @@
+/**
+ * @file phyto_sample_bench.cpp
+ * @brief Compares the `int32_t` sample representation with the former 3-byte one and checks the round trip.
+ *
+ * @details
+ * Samples used to travel through the firmware as big-endian byte triples
+ * (`std::vector<std::array<uint8_t, 3>>`), which every consumer had to
+ * re-assemble. They are now sign-corrected `int32_t`s, packed into the wire
+ * form once by the frame builders. The former layout and its kernels are
+ * kept here as the reference, and both run on the same samples:
+ * - `conversion`: a channel to millivolts with the constants of the preset,
+ * - `filtering`: an integer moving average over `FILTER_TAPS` samples,
+ * - `serialization`: a channel into its 3-byte wire form, a copy for the
+ *   triples and `pack_samples` for the integers.
+ *
+ * Throughput is given in nanoseconds and, on x86, TSC cycles per sample
+ * (median of the repetitions). Every kernel ends by summing its output into
+ * a checksum that is printed, which keeps the compiler from discarding any
+ * of its stores; the summing costs both representations the same.
+ *
+ * The tool fails unless
+ * - both representations give the same filtering and serialization checksums,
+ * - all 2^24 codes survive `sample_from_bytes` and `sample_to_bytes`,
+ * - the conversion of every code is within `MAX_CONVERSION_ERROR` of a
+ *   double-precision reference,
+ * - both filters give identical results,
+ * - conversion words pushed through the `SampleCollector` come out of the
+ *   raw and FlatBuffer frame builders byte for byte as the former layout
+ *   sent them, and decode to the same samples on the host.
+ */
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "adc/SampleCollector.h"
+#include "adc/SampleVector.h"
+#include "config/PipelineConfig.h"
+#include "serial_mail_sender/FrameBuilder.h"
+#include "serial_mail_sender/RawFrameBuilder.h"
+#include "stream_decoder/StreamDecoder.h"
+#include "transport/FrameBuffer.h"
+#include "utils/ConversionKernel.h"
+
+/// Samples per block processed at once.
+#define DEFAULT_BLOCK_SAMPLES 1024
+
+/// Samples processed per kernel and repetition.
+#define DEFAULT_SAMPLES 20000000
+
+/// Timed repetitions per kernel.
+#define DEFAULT_REPETITIONS 5
+
+/// Length of the moving average.
+#define FILTER_TAPS 8
+
+/// Frames sent through the builders and the decoder by the round-trip check.
+#define ROUND_TRIP_FRAMES 2000
+
+/// Largest accepted conversion error against the double-precision reference, in millivolts.
+#define MAX_CONVERSION_ERROR 1e-3
+
+typedef std::chrono::steady_clock Clock;
+
+/// Sample in the former representation: the three big-endian data bytes.
+typedef std::array<uint8_t, 3> LegacySample;
+
+static inline uint64_t read_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief Folds a kernel's output into a checksum, so none of its stores can be discarded.
+ * @return Sum of the output as 64-bit words, the last partial word zero-padded.
+ */
+static inline uint64_t fold(const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint64_t sum = 0;
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, bytes + i, sizeof(word));
+        sum += word;
+    }
+    uint64_t last = 0;
+    memcpy(&last, bytes + i, size - i);
+    return sum + last;
+}
+
+/// Former `sample_code`.
+static inline int32_t legacy_code(const LegacySample& sample) {
+    return ((int32_t)sample[0] << 16) | ((int32_t)sample[1] << 8) | (int32_t)sample[2];
+}
+
+/// Former `sample_to_millivolts<Config>`.
+static inline float legacy_to_millivolts(const LegacySample& sample) {
+    constexpr float full_scale_mv = PhytoConfig::vref / PhytoConfig::gain * 1000;
+    constexpr float mv_per_code = full_scale_mv / (float)PhytoConfig::databits;
+    return (float)legacy_code(sample) * mv_per_code - full_scale_mv;
+}
+
+static void legacy_convert(const LegacySample* samples, size_t count, float* out) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = legacy_to_millivolts(samples[i]);
+    }
+}
+
+static void convert(const int32_t* samples, size_t count, float* out) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = sample_to_millivolts<PhytoConfig>(samples[i]);
+    }
+}
+
+/**
+ * @brief Moving average of the triples; `out` receives `count - FILTER_TAPS + 1` values.
+ */
+static void legacy_filter(const LegacySample* samples, size_t count, int32_t* out) {
+    for (size_t i = 0; i + FILTER_TAPS <= count; i++) {
+        int32_t sum = 0;
+        for (size_t k = 0; k < FILTER_TAPS; k++) {
+            sum += legacy_code(samples[i + k]) - SAMPLE_ZERO_CODE;
+        }
+        out[i] = sum / FILTER_TAPS;
+    }
+}
+
+static void filter(const int32_t* samples, size_t count, int32_t* out) {
+    for (size_t i = 0; i + FILTER_TAPS <= count; i++) {
+        int32_t sum = 0;
+        for (size_t k = 0; k < FILTER_TAPS; k++) {
+            sum += samples[i + k];
+        }
+        out[i] = sum / FILTER_TAPS;
+    }
+}
+
+/**
+ * @struct KernelResult
+ * @brief Cost of one kernel.
+ */
+struct KernelResult {
+    double   ns;        ///< Median time per sample.
+    double   cycles;    ///< Median TSC cycles per sample, 0 where unavailable.
+    uint64_t checksum;  ///< Sum of the checksums of every block processed.
+};
+
+/**
+ * @brief Runs `op` on one block until `samples` samples are processed, per repetition.
+ * @param op Callable processing one block and returning the `fold` of its output.
+ */
+template <typename Op>
+static KernelResult measure(Op op, size_t block, size_t samples, unsigned int repetitions) {
+    size_t blocks = std::max<size_t>(1, samples / block);
+    uint64_t checksum = 0;
+    for (size_t i = 0; i < blocks / 10 + 1; i++) {
+        checksum += op();
+    }
+    std::vector<double> ns;
+    std::vector<double> cycles;
+    for (unsigned int r = 0; r < repetitions; r++) {
+        Clock::time_point start = Clock::now();
+        uint64_t start_cycles = read_cycles();
+        for (size_t i = 0; i < blocks; i++) {
+            checksum += op();
+        }
+        uint64_t end_cycles = read_cycles();
+        ns.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count() / (blocks * block));
+        cycles.push_back((double)(end_cycles - start_cycles) / (blocks * block));
+    }
+    std::sort(ns.begin(), ns.end());
+    std::sort(cycles.begin(), cycles.end());
+    return KernelResult{ns[ns.size() / 2], cycles[cycles.size() / 2], checksum};
+}
+
+/**
+ * @brief Checks every code against the wire form and the conversion reference.
+ * @param max_error Receives the largest conversion error of the `int32_t` path in mV.
+ * @param legacy_error Receives that of the former path.
+ * @return True if every code round-trips.
+ */
+static bool check_codes(double* max_error, double* legacy_error) {
+    constexpr double mv_per_code = (double)PhytoConfig::vref / PhytoConfig::gain * 1000 / PhytoConfig::databits;
+    bool ok = true;
+    *max_error = 0;
+    *legacy_error = 0;
+    for (uint32_t code = 0; code < (1u << 24); code++) {
+        LegacySample bytes = {(uint8_t)(code >> 16), (uint8_t)(code >> 8), (uint8_t)code};
+        int32_t sample = sample_from_bytes(bytes.data());
+        uint8_t packed[SAMPLE_WIRE_SIZE];
+        sample_to_bytes(sample, packed);
+        ok &= sample == (int32_t)code - SAMPLE_ZERO_CODE && memcmp(packed, bytes.data(), sizeof(packed)) == 0;
+
+        double reference = ((double)code - SAMPLE_ZERO_CODE) * mv_per_code;
+        *max_error = std::max(*max_error, std::fabs(sample_to_millivolts<PhytoConfig>(sample) - reference));
+        *legacy_error = std::max(*legacy_error, std::fabs(legacy_to_millivolts(bytes) - reference));
+    }
+    return ok;
+}
+
+/**
+ * @brief Sends random conversion words through the collector, both frame builders and the decoder.
+ * @return True if every frame carries the words' data bytes unchanged and decodes to the collected samples.
+ */
+static bool check_frames(std::mt19937_64& random) {
+    const unsigned int vector_size = PhytoConfig::vector_size;
+    std::uniform_int_distribution<uint32_t> any_code(0, 0xFFFFFF);
+    const uint32_t extremes[] = {0x000000, 0x000001, 0x7FFFFF, 0x800000, 0x800001, 0xFFFFFF};
+
+    SampleCollector collector(vector_size);
+    RawFrameBuilder raw_builder;
+    RawFrameBuilder timed_builder(true);
+    FrameBuilder builder;
+    std::vector<LegacySample> expected[2];
+    bool ok = true;
+    size_t decoded = 0;
+    StreamDecoder decoder([&](const DecodedFrame& frame) {
+        decoded++;
+        std::span<const SerialMail::Value> channels[2] = {frame.ch0, frame.ch1};
+        for (unsigned int channel = 0; channel < 2; channel++) {
+            ok &= channels[channel].size() == vector_size;
+            for (size_t i = 0; ok && i < vector_size; i++) {
+                ok &= node_sample(channels[channel][i]) == (channel == 0 ? collector.ch0() : collector.ch1())[i];
+                ok &= raw_code(channels[channel][i]) == (uint32_t)legacy_code(expected[channel][i]);
+            }
+        }
+    });
+
+    uint8_t frame[FRAME_BUFFER_CAPACITY];
+    for (unsigned int n = 0; ok && n < ROUND_TRIP_FRAMES; n++) {
+        collector.clear();
+        expected[0].clear();
+        expected[1].clear();
+        for (unsigned int i = 0; i < 2 * vector_size; i++) {
+            // The first frame starts with the codes around the ends and the middle of the range
+            uint32_t code = (n == 0 && i / 2 < sizeof(extremes) / sizeof(extremes[0])) ? extremes[i / 2]
+                                                                                         : any_code(random);
+            uint8_t word[AD7124_CONVERSION_WORD_SIZE] = {(uint8_t)(code >> 16), (uint8_t)(code >> 8), (uint8_t)code,
+                                                         (uint8_t)(i % 2)};
+            collector.push(word);
+            expected[i % 2].push_back({word[0], word[1], word[2]});
+        }
+
+        // The raw payload must be exactly the triples the former builder copied
+        size_t size = raw_builder.build(collector.ch0(), collector.ch1(), PhytoConfig::node, frame, sizeof(frame));
+        const uint8_t* samples = frame + SERIAL_MAIL_HEADER_SIZE + RAW_FRAME_HEADER_SIZE;
+        ok &= size > 0 &&
+              memcmp(samples, expected[0].data(), vector_size * SAMPLE_WIRE_SIZE) == 0 &&
+              memcmp(samples + vector_size * SAMPLE_WIRE_SIZE, expected[1].data(), vector_size * SAMPLE_WIRE_SIZE) == 0;
+        decoder.feed({frame, size});
+
+        size = timed_builder.build(collector.ch0(), collector.ch1(), PhytoConfig::node, frame, sizeof(frame), 0, n);
+        decoder.feed({frame, size});
+        size = builder.build(collector.ch0(), collector.ch1(), PhytoConfig::node, frame, sizeof(frame));
+        decoder.feed({frame, size});
+    }
+    return ok && decoded == 3 * ROUND_TRIP_FRAMES;
+}
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  -b <samples>  samples per block (default %d)\n"
+        "  -n <samples>  samples processed per kernel and repetition (default %d)\n"
+        "  -r <count>    timed repetitions, the median is reported (default %d)\n"
+        "  -s <seed>     random seed (default 1)\n",
+        program, DEFAULT_BLOCK_SAMPLES, DEFAULT_SAMPLES, DEFAULT_REPETITIONS);
+}
+
+int main(int argc, char** argv) {
+    size_t block = DEFAULT_BLOCK_SAMPLES;
+    size_t samples = DEFAULT_SAMPLES;
+    unsigned int repetitions = DEFAULT_REPETITIONS;
+    uint64_t seed = 1;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-b" && i + 1 < argc) {
+            block = std::stoul(argv[++i]);
+        } else if (arg == "-n" && i + 1 < argc) {
+            samples = std::stoul(argv[++i]);
+        } else if (arg == "-r" && i + 1 < argc) {
+            repetitions = (unsigned int)std::stoul(argv[++i]);
+        } else if (arg == "-s" && i + 1 < argc) {
+            seed = std::stoull(argv[++i]);
+        } else {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+    if (block < FILTER_TAPS || samples == 0 || repetitions == 0) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    std::mt19937_64 random(seed);
+    std::uniform_int_distribution<uint32_t> any_code(0, 0xFFFFFF);
+    std::vector<LegacySample> legacy(block);
+    SampleVector current;
+    for (size_t i = 0; i < block; i++) {
+        uint32_t code = any_code(random);
+        legacy[i] = {(uint8_t)(code >> 16), (uint8_t)(code >> 8), (uint8_t)code};
+        current.push_back(sample_from_bytes(legacy[i].data()));
+    }
+
+    std::vector<float> millivolts(block);
+    std::vector<int32_t> filtered(block);
+    std::vector<int32_t> legacy_filtered(block);
+    std::vector<uint8_t> wire(block * SAMPLE_WIRE_SIZE);
+
+    const size_t filtered_size = (block - FILTER_TAPS + 1) * sizeof(int32_t);
+
+    // Every kernel folds its output into a checksum, which costs both paths the same. Filtering
+    // and serialization write identical outputs, the conversions differ in rounding
+    printf("%zu samples per block, %zu samples per kernel, median of %u\n\n", block, samples, repetitions);
+    printf("%-14s %12s %12s %12s %12s %8s  %-16s %s\n", "kernel", "3-byte ns", "int32 ns", "3-byte cyc",
+           "int32 cyc", "speedup", "3-byte checksum", "int32 checksum");
+    bool checksums = true;
+    auto report = [&checksums](const char* name, bool identical, const KernelResult& before,
+                               const KernelResult& after) {
+        bool same = before.checksum == after.checksum;
+        printf("%-14s %12.3f %12.3f %12.2f %12.2f %7.2fx  %016llx %016llx%s\n", name, before.ns, after.ns,
+               before.cycles, after.cycles, before.ns / after.ns, (unsigned long long)before.checksum,
+               (unsigned long long)after.checksum, !identical ? "" : same ? " ok" : " MISMATCH");
+        checksums &= !identical || same;
+    };
+
+    report("conversion", false,
+           measure([&] {
+                       legacy_convert(legacy.data(), block, millivolts.data());
+                       return fold(millivolts.data(), block * sizeof(float));
+                   },
+                   block, samples, repetitions),
+           measure([&] {
+                       convert(current.data(), block, millivolts.data());
+                       return fold(millivolts.data(), block * sizeof(float));
+                   },
+                   block, samples, repetitions));
+    report("filtering", true,
+           measure([&] {
+                       legacy_filter(legacy.data(), block, legacy_filtered.data());
+                       return fold(legacy_filtered.data(), filtered_size);
+                   },
+                   block, samples, repetitions),
+           measure([&] {
+                       filter(current.data(), block, filtered.data());
+                       return fold(filtered.data(), filtered_size);
+                   },
+                   block, samples, repetitions));
+    report("serialization", true,
+           measure([&] {
+                       memcpy(wire.data(), legacy.data(), block * SAMPLE_WIRE_SIZE);
+                       return fold(wire.data(), wire.size());
+                   },
+                   block, samples, repetitions),
+           measure([&] {
+                       pack_samples(current.data(), block, wire.data());
+                       return fold(wire.data(), wire.size());
+                   },
+                   block, samples, repetitions));
+
+    double max_error = 0;
+    double legacy_error = 0;
+    bool codes = check_codes(&max_error, &legacy_error);
+    printf("\nwire form:        all 2^24 codes %s\n", codes ? "ok" : "MISMATCH");
+    bool converted = max_error <= MAX_CONVERSION_ERROR;
+    printf("conversion:       max error %.2e mV (3-byte path %.2e mV) %s\n", max_error, legacy_error,
+           converted ? "ok" : "FAIL");
+    bool filters = std::equal(filtered.begin(), filtered.end() - FILTER_TAPS + 1, legacy_filtered.begin());
+    printf("filtering:        outputs %s\n", filters ? "identical" : "MISMATCH");
+    bool frames = check_frames(random);
+    printf("frames:           %d raw, timed raw and FlatBuffer frames of %u samples %s\n", ROUND_TRIP_FRAMES,
+           PhytoConfig::vector_size, frames ? "ok" : "MISMATCH");
+    return (checksums && codes && converted && filters && frames) ? 0 : 1;
+}
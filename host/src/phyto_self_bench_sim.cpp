@@ -0,0 +1,507 @@
+/**
+ * @file phyto_self_bench_sim.cpp
+ * @brief Runs the sweep of `SELF_BENCHMARK` against a model of the node and compares it with a node report.
+ *
+ * @details
+ * Every point of `benchmark_points` is simulated for `BENCHMARK_POINT_MS`
+ * with the node's `SampleCollector`, frame builders, frame pool,
+ * `FrameDispatcher` and a drop-oldest UART sink, and evaluated with
+ * `evaluate_benchmark`, so the table has the node's format and meaning.
+ *
+ * The model follows the polling pipeline:
+ * - The converter completes a conversion per word period, alternating its
+ *   channels, and keeps only the latest result. The reading thread waits for
+ *   DRDY to go high and then low, so a word already pending when it resumes
+ *   is skipped and the next one read, as on the node.
+ * - A read takes 4 bytes at the SPI clock plus a per-byte overhead, the
+ *   collector and the hand-off a fixed time each. The hand-off waits while
+ *   the previous frame is still in the mailbox.
+ * - The main thread has the same priority, so it only gets the CPU when the
+ *   reading thread's round-robin slice ends, once a frame is waiting or its
+ *   service period expired. While it builds and writes a frame, no word is
+ *   read.
+ * - The UART has the TX buffer of the Mbed driver and drains at
+ *   `LINK_BAUDRATE` in 8N1; the main thread writes into it whenever it runs.
+ *
+ * The CPU times are estimates for the STM32WB55 at 64 MHz; `--compare` puts a
+ * node report next to the simulation, which shows where they need adjusting.
+ * The node report is the text `phyto_decode --messages` prints for a
+ * `MESSAGE_KIND_BENCHMARK` message, or the node's log; of repeated reports
+ * the last row per point is used.
+ *
+ * The tool exits with 1 if a row does not read back as `--compare` reads it,
+ * the model misread a word, or the lightest point of the sweep (slowest ADC
+ * rate, fastest SPI clock, largest frames) was not sustained.
+ */
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "adc/SampleCollector.h"
+#include "config/PipelineConfig.h"
+#include "pipeline/BenchmarkSweep.h"
+#include "serial_mail_sender/FrameBuilder.h"
+#include "serial_mail_sender/RawFrameBuilder.h"
+#include "transport/FrameBuffer.h"
+#include "transport/FrameDispatcher.h"
+#include "transport/FrameSink.h"
+
+/// Bit rate of the node's UART (`UART_BAUDRATE`), 10 bits per byte.
+#define LINK_BAUDRATE 115200
+
+/// TX buffer of the Mbed serial driver (`drivers.uart-serial-txbuf-size`).
+#define DEFAULT_TX_BUFFER 256
+
+/// Overhead per byte of a blocking `SPI::write` on the node, in µs.
+#define SPI_BYTE_OVERHEAD_US 1.0
+
+/// Time to put a word into the `SampleCollector`, in µs.
+#define COLLECT_US 1.0
+
+/// Time to hand a frame to the main thread (mail allocation, copy, put), in µs.
+#define HANDOFF_US 20.0
+
+/// Time to build a FlatBuffer frame, fixed part in µs.
+#define FLATBUFFER_BUILD_US 150.0
+
+/// Time to build a FlatBuffer frame, per sample of both channels in µs.
+#define FLATBUFFER_SAMPLE_US 1.0
+
+/// Time to build a raw frame, fixed part in µs.
+#define RAW_BUILD_US 20.0
+
+/// Time to build a raw frame, per sample of both channels in µs.
+#define RAW_SAMPLE_US 0.3
+
+/// Time to copy a byte into the serial driver, in µs.
+#define UART_WRITE_US 0.2
+
+/// Time of a main loop pass without a frame (mailbox timeout, servicing), in µs.
+#define SERVICE_US 10.0
+
+/// Round-robin time slice of the RTOS, in µs (`OS_ROBIN_TIMEOUT`).
+#define QUANTUM_US 5000.0
+
+/// Mailbox timeout of the main loop, in µs (`SINK_SERVICE_PERIOD`).
+#define SERVICE_PERIOD_US 5000.0
+
+/**
+ * @struct NodeModel
+ * @brief CPU times of the node, in µs.
+ */
+struct NodeModel {
+    double spi_byte_overhead_us;    ///< Per byte of an SPI transfer, on top of the clock.
+    double collect_us;              ///< Per word in the collector.
+    double handoff_us;              ///< Per frame handed to the main thread.
+    double build_us;                ///< Per frame built, fixed part.
+    double sample_us;               ///< Per frame built, per sample of both channels.
+    double uart_write_us;           ///< Per byte written into the serial driver.
+    double service_us;              ///< Per main loop pass.
+    double quantum_us;              ///< Round-robin time slice.
+    size_t tx_buffer;               ///< TX buffer of the serial driver in bytes.
+    bool   raw;                     ///< Raw frames instead of FlatBuffers.
+};
+
+/**
+ * @class SimUart
+ * @brief Sink that writes into a bounded TX buffer drained at the link rate.
+ */
+class SimUart : public FrameSink {
+public:
+    explicit SimUart(size_t tx_buffer)
+        : FrameSink("uart", BACKPRESSURE_DROP_OLDEST), m_capacity(tx_buffer), m_level(0), m_drained_us(0) {}
+
+    /**
+     * @brief Moves the bytes the wire carried up to a point in time out of the TX buffer.
+     * @param now_us Simulated time.
+     */
+    void drainUntil(double now_us) {
+        double bytes = (now_us - m_drained_us) * LINK_BAUDRATE / 10 / 1e6;
+        m_level = std::max(0.0, m_level - bytes);
+        m_drained_us = now_us;
+    }
+
+protected:
+    size_t writeSome(const uint8_t* data, size_t size) override {
+        (void)data;
+        size_t room = m_capacity - (size_t)std::ceil(m_level);
+        size_t written = std::min(size, room);
+        m_level += (double)written;
+        return written;
+    }
+
+private:
+    size_t m_capacity;              ///< Size of the TX buffer.
+    double m_level;                 ///< Bytes waiting for the wire.
+    double m_drained_us;            ///< Time the level was last updated.
+};
+
+/**
+ * @class NodeSim
+ * @brief Reading thread, main thread and UART of one operating point.
+ */
+class NodeSim {
+public:
+    NodeSim(const BenchmarkPoint& point, const NodeModel& model, uint64_t seed)
+        : m_point(point), m_model(model), m_collector(point.vector_size), m_uart(model.tx_buffer), m_now(0),
+          m_slice_start(0), m_main_blocked(0), m_mail_pending(false), m_mail_put(0), m_last_read(-1), m_busy(0),
+          m_frames(0), m_pool_drops(0) {
+        std::mt19937_64 random(seed);
+        m_period_us = 1e6 / (2.0 * ad7124_rate_sps(point.power_mode, 2, point.filter_fs));
+        m_phase_us = std::uniform_real_distribution<double>(0, m_period_us)(random);
+        m_read_us = 4 * (8 * 1e6 / point.spi_frequency + model.spi_byte_overhead_us);
+        m_dispatcher.addSink(m_uart);
+        m_tracker.reset();
+    }
+
+    /**
+     * @brief Simulates one measuring window.
+     * @param window_us Length of the window.
+     * @return Counts as the node collects them.
+     */
+    BenchmarkCounters run(double window_us) {
+        while (m_now < window_us) {
+            double switch_at = mainSwitch();
+            // The word the reading thread reads next and when DRDY announces it
+            int64_t latest = m_now < m_phase_us ? -1 : (int64_t)std::floor((m_now - m_phase_us) / m_period_us);
+            int64_t next = latest > m_last_read ? latest + 1 : m_last_read + 1;
+            double ready_at = m_phase_us + next * m_period_us;
+            if (switch_at <= ready_at) {
+                runMain(std::max(m_now, switch_at));
+                continue;
+            }
+            m_now = ready_at;
+            readWord(next);
+        }
+        m_uart.drainUntil(window_us);
+
+        BenchmarkCounters counters;
+        counters.elapsed_us = (uint32_t)window_us;
+        counters.conversions = m_tracker.conversions;
+        counters.missed = m_tracker.missed;
+        counters.errors = m_tracker.errors;
+        counters.frames = m_frames;
+        counters.frame_drops = m_uart.stats().dropped + m_pool_drops;
+        counters.busy_us = (uint32_t)m_busy;
+        counters.uart_bytes = m_uart.stats().bytes;
+        return counters;
+    }
+
+private:
+    BenchmarkPoint    m_point;
+    NodeModel         m_model;
+    SampleCollector   m_collector;
+    ConversionTracker m_tracker;
+    FramePool         m_pool;
+    FrameDispatcher   m_dispatcher;
+    SimUart           m_uart;
+    FrameBuilder      m_builder;
+    RawFrameBuilder   m_raw_builder;
+    SampleVector      m_mail_ch0;       ///< Frame in the mailbox.
+    SampleVector      m_mail_ch1;
+    double            m_period_us;      ///< Time between two words.
+    double            m_phase_us;       ///< Completion of the first word.
+    double            m_read_us;        ///< SPI transfer of a word.
+    double            m_now;            ///< Simulated time.
+    double            m_slice_start;    ///< Start of the reading thread's current run.
+    double            m_main_blocked;   ///< Time the main thread started waiting for mail.
+    bool              m_mail_pending;   ///< A frame waits in the mailbox.
+    double            m_mail_put;       ///< Time it was put.
+    int64_t           m_last_read;      ///< Index of the word read last.
+    double            m_busy;           ///< CPU time spent, in µs.
+    uint32_t          m_frames;         ///< Frames handed off.
+    uint32_t          m_pool_drops;     ///< Frames lost to a full pool.
+
+    /**
+     * @brief Time the main thread takes the CPU from the reading thread.
+     *
+     * @details
+     * It becomes ready with a mail or when its mailbox wait times out, and runs
+     * at the first end of a slice after that.
+     */
+    double mainSwitch(void) const {
+        double ready = m_mail_pending ? m_mail_put : m_main_blocked + SERVICE_PERIOD_US;
+        double slices = std::max(1.0, std::ceil((ready - m_slice_start) / m_model.quantum_us));
+        return m_slice_start + slices * m_model.quantum_us;
+    }
+
+    /**
+     * @brief Reads a word and passes it on, like the reading thread.
+     * @param index Conversion read.
+     */
+    void readWord(int64_t index) {
+        int32_t value = (int32_t)((index * 2654435761u) & 0xFFFFFF) - SAMPLE_ZERO_CODE;
+        uint8_t word[AD7124_CONVERSION_WORD_SIZE];
+        sample_to_bytes(value, word);
+        word[3] = (uint8_t)(index % 2);
+        m_last_read = index;
+
+        m_now += m_read_us + m_model.collect_us;
+        m_busy += m_read_us + m_model.collect_us;
+        m_tracker.push(word[3]);
+        if (!m_collector.push(word)) {
+            return;
+        }
+
+        // The hand-off spins until the main thread took the previous frame
+        if (m_mail_pending) {
+            double switch_at = mainSwitch();
+            m_busy += std::max(0.0, switch_at - m_now);
+            runMain(std::max(m_now, switch_at));
+        }
+        m_mail_ch0 = m_collector.ch0();
+        m_mail_ch1 = m_collector.ch1();
+        m_collector.clear();
+        m_now += m_model.handoff_us;
+        m_busy += m_model.handoff_us;
+        m_mail_pending = true;
+        m_mail_put = m_now;
+        m_frames++;
+    }
+
+    /**
+     * @brief One pass of the main loop, starting at `start`; the reading thread continues afterwards.
+     */
+    void runMain(double start) {
+        m_uart.drainUntil(start);
+        double cost = m_model.service_us;
+        uint32_t bytes_before = m_uart.stats().bytes;
+        if (m_mail_pending) {
+            m_mail_pending = false;
+            publishFrame();
+            size_t samples = m_mail_ch0.size() + m_mail_ch1.size();
+            cost += m_model.build_us + m_model.sample_us * samples;
+        } else {
+            m_dispatcher.service();
+        }
+        cost += m_model.uart_write_us * (m_uart.stats().bytes - bytes_before);
+
+        m_busy += cost;
+        m_now = start + cost;
+        m_main_blocked = m_now;
+        m_slice_start = m_now;
+    }
+
+    /**
+     * @brief Builds the frame of the mailbox and publishes it, like `SerialMailSender::sendMail`.
+     */
+    void publishFrame(void) {
+        FrameRef frame = m_pool.allocate();
+        if (!frame) {
+            m_dispatcher.service();
+            frame = m_pool.allocate();
+        }
+        if (!frame) {
+            m_pool_drops++;
+            return;
+        }
+        size_t size;
+        if (m_model.raw) {
+            size = m_raw_builder.build(m_mail_ch0, m_mail_ch1, PhytoConfig::node, frame.mutableData(),
+                                       FRAME_BUFFER_CAPACITY);
+        } else {
+            size = std::min(m_builder.build(m_mail_ch0, m_mail_ch1, PhytoConfig::node), (size_t)FRAME_BUFFER_CAPACITY);
+            std::copy(m_builder.data(), m_builder.data() + size, frame.mutableData());
+        }
+        frame.setSize(size);
+        m_dispatcher.publish(frame, TRAFFIC_SAMPLES);
+        m_dispatcher.service();
+    }
+};
+
+/// Point of a row, for matching node and simulation.
+typedef std::tuple<int, unsigned int, unsigned int> PointKey;
+
+static PointKey key_of(const BenchmarkPoint& point) {
+    return {point.spi_frequency, point.filter_fs, point.vector_size};
+}
+
+/**
+ * @brief Reads the rows of a node report.
+ * @return False if the file cannot be opened.
+ */
+static bool read_report(const char* path, std::map<PointKey, BenchmarkResult>& rows) {
+    FILE* file = fopen(path, "r");
+    if (file == nullptr) {
+        return false;
+    }
+    char line[512];
+    while (fgets(line, sizeof(line), file) != nullptr) {
+        // Skip a log prefix such as "[INFO: ...] "
+        const char* start = line;
+        if (line[0] == '[') {
+            const char* end = strchr(line, ']');
+            start = end != nullptr ? end + 1 : line;
+            while (*start == ' ') {
+                start++;
+            }
+        }
+        BenchmarkResult result;
+        if (parse_benchmark_row(start, &result)) {
+            rows[key_of(result.point)] = result;
+        }
+    }
+    fclose(file);
+    return true;
+}
+
+/**
+ * @brief Prints node and simulation side by side.
+ */
+static void print_comparison(const std::vector<BenchmarkResult>& simulated,
+                             const std::map<PointKey, BenchmarkResult>& node) {
+    printf("\n%10s %5s %5s | %10s %7s %6s %6s %4s | %10s %7s %6s %6s %4s\n", "spi_hz", "fs", "size", "node sps",
+           "missed", "cpu%", "uart%", "ok", "sim sps", "missed", "cpu%", "uart%", "ok");
+    size_t agree = 0;
+    size_t compared = 0;
+    std::vector<BenchmarkResult> node_rows;
+    for (const BenchmarkResult& sim : simulated) {
+        auto found = node.find(key_of(sim.point));
+        printf("%10d %5u %5u | ", sim.point.spi_frequency, (unsigned int)sim.point.filter_fs, sim.point.vector_size);
+        if (found == node.end()) {
+            printf("%10s %7s %6s %6s %4s | ", "-", "-", "-", "-", "-");
+        } else {
+            const BenchmarkResult& row = found->second;
+            printf("%10.1f %7lu %6.1f %6.1f %4s | ", (double)row.conversions_sps, (unsigned long)row.missed,
+                   (double)row.cpu_pct, (double)row.uart_pct, row.sustained ? "yes" : "no");
+            node_rows.push_back(row);
+            compared++;
+            agree += row.sustained == sim.sustained ? 1 : 0;
+        }
+        printf("%10.1f %7lu %6.1f %6.1f %4s\n", (double)sim.conversions_sps, (unsigned long)sim.missed,
+               (double)sim.cpu_pct, (double)sim.uart_pct, sim.sustained ? "yes" : "no");
+    }
+
+    char line[BENCHMARK_LINE_SIZE];
+    format_benchmark_summary(node_rows.data(), node_rows.size(), line, sizeof(line));
+    printf("\nnode: %s", line + 2);
+    format_benchmark_summary(simulated.data(), simulated.size(), line, sizeof(line));
+    printf("sim:  %s", line + 2);
+    printf("sustained verdicts agree on %zu of %zu points\n", agree, compared);
+}
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --raw                 raw frames instead of FlatBuffers\n"
+        "  --compare <file>      node report to put next to the simulation\n"
+        "  -t <ms>               measuring time per point (default %d)\n"
+        "  --spi-overhead <us>   per byte of an SPI transfer (default %.1f)\n"
+        "  --build <us> <us>     frame build time, fixed and per sample (default: FlatBuffer %.0f %.1f, raw %.0f %.1f)\n"
+        "  --handoff <us>        per frame handed to the main thread (default %.0f)\n"
+        "  --quantum <us>        round-robin time slice (default %.0f)\n"
+        "  -b <bytes>            TX buffer of the serial driver (default %d)\n"
+        "  -s <seed>             random seed of the conversion phases (default 1)\n",
+        program, BENCHMARK_POINT_MS, SPI_BYTE_OVERHEAD_US, FLATBUFFER_BUILD_US, FLATBUFFER_SAMPLE_US, RAW_BUILD_US,
+        RAW_SAMPLE_US, HANDOFF_US, QUANTUM_US, DEFAULT_TX_BUFFER);
+}
+
+int main(int argc, char** argv) {
+    NodeModel model{SPI_BYTE_OVERHEAD_US, COLLECT_US, HANDOFF_US, -1, -1, UART_WRITE_US, SERVICE_US, QUANTUM_US,
+                    DEFAULT_TX_BUFFER, false};
+    double window_ms = BENCHMARK_POINT_MS;
+    const char* compare = nullptr;
+    uint64_t seed = 1;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--raw") {
+            model.raw = true;
+        } else if (arg == "--compare" && i + 1 < argc) {
+            compare = argv[++i];
+        } else if (arg == "-t" && i + 1 < argc) {
+            window_ms = std::stod(argv[++i]);
+        } else if (arg == "--spi-overhead" && i + 1 < argc) {
+            model.spi_byte_overhead_us = std::stod(argv[++i]);
+        } else if (arg == "--build" && i + 2 < argc) {
+            model.build_us = std::stod(argv[++i]);
+            model.sample_us = std::stod(argv[++i]);
+        } else if (arg == "--handoff" && i + 1 < argc) {
+            model.handoff_us = std::stod(argv[++i]);
+        } else if (arg == "--quantum" && i + 1 < argc) {
+            model.quantum_us = std::stod(argv[++i]);
+        } else if (arg == "-b" && i + 1 < argc) {
+            model.tx_buffer = (size_t)std::stoul(argv[++i]);
+        } else if (arg == "-s" && i + 1 < argc) {
+            seed = std::stoull(argv[++i]);
+        } else {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+    if (model.build_us < 0) {
+        model.build_us = model.raw ? RAW_BUILD_US : FLATBUFFER_BUILD_US;
+        model.sample_us = model.raw ? RAW_SAMPLE_US : FLATBUFFER_SAMPLE_US;
+    }
+    if (window_ms <= 0 || model.quantum_us <= 0 || model.tx_buffer == 0 || model.sample_us < 0) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    std::map<PointKey, BenchmarkResult> node;
+    if (compare != nullptr && !read_report(compare, node)) {
+        fprintf(stderr, "cannot read %s\n", compare);
+        return 1;
+    }
+
+    BenchmarkPoint points[BENCHMARK_MAX_POINTS];
+    size_t count = benchmark_points(points, BENCHMARK_MAX_POINTS, UINT_MAX);
+    std::vector<BenchmarkResult> results;
+    char line[BENCHMARK_HEADER_SIZE];
+    bool passed = true;
+    format_benchmark_header(model.raw ? "sim raw" : "sim FlatBuffer", line, sizeof(line));
+    printf("%s", line);
+    for (size_t i = 0; i < count; i++) {
+        NodeSim sim(points[i], model, seed + i);
+        BenchmarkCounters counters = sim.run(window_ms * 1000);
+        results.push_back(evaluate_benchmark(points[i], counters, LINK_BAUDRATE));
+        format_benchmark_row(results.back(), line, sizeof(line));
+        printf("%s", line);
+
+        // The row must read back as `--compare` reads a node report
+        BenchmarkResult parsed;
+        if (!parse_benchmark_row(line, &parsed) || key_of(parsed.point) != key_of(points[i]) ||
+            parsed.sustained != results.back().sustained || parsed.missed != counters.missed ||
+            parsed.frames != counters.frames) {
+            fprintf(stderr, "row %zu does not read back\n", i);
+            passed = false;
+        }
+        if (counters.errors > 0) {
+            fprintf(stderr, "row %zu: %u misread words, the model never misreads\n", i, counters.errors);
+            passed = false;
+        }
+    }
+    format_benchmark_summary(results.data(), results.size(), line, sizeof(line));
+    printf("%s", line);
+
+    // The slowest ADC rate with the fastest SPI clock is far below any limit of the node
+    size_t slowest = 0;
+    for (size_t i = 1; i < count && points[i].filter_fs == points[0].filter_fs; i++) {
+        if (points[i].spi_frequency > points[slowest].spi_frequency ||
+            (points[i].spi_frequency == points[slowest].spi_frequency && points[i].vector_size > points[slowest].vector_size)) {
+            slowest = i;
+        }
+    }
+    if (count == 0 || !results[slowest].sustained) {
+        fprintf(stderr, "the lightest point of the sweep is not sustained\n");
+        passed = false;
+    }
+
+    if (compare != nullptr) {
+        if (node.empty()) {
+            fprintf(stderr, "no benchmark rows in %s\n", compare);
+            return 1;
+        }
+        print_comparison(results, node);
+    }
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,529 @@
+/**
+ * @file phyto_store_bench.cpp
+ * @brief Compares the sample store with CSV on weeks of synthetic recordings.
+ *
+ * @details
+ * Synthetic nodes produce frames as `phyto_decode --store` stores them: the
+ * samples of a frame are placed one sample period apart before the frame's
+ * receive time, which lags the last conversion by a random delay, and a
+ * node occasionally restarts and leaves a gap. Each channel is a daily
+ * drift plus a random walk, ADC noise and now and then an action
+ * potential, as sign-corrected codes.
+ *
+ * The same frames are written once into a `SampleStoreWriter` and once as
+ * CSV lines `time_us,node,device,ch0,ch1` (raw codes, formatted with
+ * `std::to_chars` like `phyto_decode`), and the tool reports
+ * - ingest: samples per second of both writers, without the generation,
+ * - size: bytes per sample and the compression against CSV and against
+ *   12-byte binary records (time and sample),
+ * - full scan: samples per second reading everything back,
+ * - range scan: time per query of a random series and window; the CSV has
+ *   no index and is scanned completely for every query, so only the first
+ *   few queries are run against it.
+ *
+ * The tool fails unless every series reads back exactly as generated and
+ * the CSV queries find the same samples as the store.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "adc/SampleVector.h"
+#include "config/PipelineConfig.h"
+#include "storage/SampleStore.h"
+#include "utils/LineBuffer.h"
+#include "utils/MappedFile.h"
+
+/// Time of the first synthetic sample, µs since the Unix epoch (2025-10-01).
+#define START_TIME_US 1759276800000000ull
+
+/// Largest delay between the last conversion of a frame and its reception.
+#define RECEIVE_DELAY_US 20000
+
+/// Mean time between two restarts of a node.
+#define RESTART_INTERVAL_S (3 * 86400)
+
+/// Longest gap a restart leaves.
+#define RESTART_GAP_S 600
+
+/// ADC noise, standard deviation in codes.
+#define NOISE_CODES 20.0
+
+/// Random walk per sample, standard deviation in codes.
+#define WALK_CODES 4.0
+
+/// Amplitude of the daily drift in codes, about 15 mV at the default gain.
+#define DRIFT_CODES 200000.0
+
+/// Mean time between two action potentials of a channel.
+#define SPIKE_INTERVAL_S 3600
+
+/// Peak of an action potential in codes.
+#define SPIKE_CODES 1000000.0
+
+/// Decay time of an action potential.
+#define SPIKE_DECAY_S 30.0
+
+/// Output buffer of the CSV file.
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+
+/**
+ * @struct BenchOptions
+ * @brief Command line options.
+ */
+struct BenchOptions {
+    int         nodes;          ///< Synthetic nodes, one AD7124 each.
+    double      weeks;          ///< Recording length.
+    double      rate_sps;       ///< Samples per second and channel.
+    int         queries;        ///< Range queries against the store.
+    int         csv_queries;    ///< Of those, queries also run against the CSV.
+    double      window_min;     ///< Length of a query window.
+    std::string directory;      ///< Where the store and the CSV are written.
+    bool        keep;           ///< Keep both files.
+    uint64_t    seed;           ///< Random seed.
+};
+
+/**
+ * @struct SyntheticFrame
+ * @brief One frame of a synthetic node.
+ */
+struct SyntheticFrame {
+    int32_t               node;
+    std::vector<uint64_t> times;    ///< Time of every sample of both channels.
+    std::vector<int32_t>  ch0;
+    std::vector<int32_t>  ch1;
+};
+
+/**
+ * @class SyntheticNode
+ * @brief Produces the frames of one node; the same seed gives the same frames.
+ */
+class SyntheticNode {
+public:
+    SyntheticNode(int32_t node, double rate_sps, uint64_t end_time_us, uint64_t seed)
+        : m_node(node), m_period_us(1e6 / rate_sps), m_end_time_us(end_time_us), m_random(seed ^ (uint64_t)node),
+          m_time_us(START_TIME_US), m_walk{0, 0}, m_spike{0, 0} {
+        std::uniform_real_distribution<double> phase(0, 2 * M_PI);
+        m_phase[0] = phase(m_random);
+        m_phase[1] = phase(m_random);
+    }
+
+    /**
+     * @brief Produces the next frame.
+     * @return False once the recording ended.
+     */
+    bool next(SyntheticFrame& frame) {
+        std::uniform_real_distribution<double> uniform(0, 1);
+        const size_t size = PhytoConfig::vector_size;
+        double frame_s = size * m_period_us / 1e6;
+        if (uniform(m_random) < frame_s / RESTART_INTERVAL_S) {
+            m_time_us += (uint64_t)(uniform(m_random) * RESTART_GAP_S * 1e6);
+        }
+        uint64_t last_us = m_time_us + (uint64_t)((size - 1) * m_period_us);
+        if (last_us > m_end_time_us) {
+            return false;
+        }
+
+        uint64_t received_us = last_us + (uint64_t)(uniform(m_random) * std::min<double>(RECEIVE_DELAY_US,
+                                                                                            m_period_us / 2));
+        frame.node = m_node;
+        frame.times.resize(size);
+        frame.ch0.resize(size);
+        frame.ch1.resize(size);
+        for (size_t i = 0; i < size; i++) {
+            frame.times[i] = received_us - (uint64_t)((size - 1 - i) * (uint64_t)m_period_us);
+            frame.ch0[i] = sample(0);
+            frame.ch1[i] = sample(1);
+        }
+        m_time_us = last_us + (uint64_t)m_period_us;
+        return true;
+    }
+
+private:
+    int32_t         m_node;
+    double          m_period_us;
+    uint64_t        m_end_time_us;
+    std::mt19937_64 m_random;
+    uint64_t        m_time_us;      ///< Conversion time of the next sample.
+    double          m_walk[2];      ///< Random walk per channel.
+    double          m_spike[2];     ///< Decaying action potential per channel.
+    double          m_phase[2];     ///< Phase of the daily drift per channel.
+
+    int32_t sample(int channel) {
+        std::normal_distribution<double> noise(0, NOISE_CODES);
+        std::normal_distribution<double> walk(0, WALK_CODES);
+        std::uniform_real_distribution<double> uniform(0, 1);
+        double dt_s = m_period_us / 1e6;
+
+        m_walk[channel] += walk(m_random);
+        m_spike[channel] *= std::exp(-dt_s / SPIKE_DECAY_S);
+        if (uniform(m_random) < dt_s / SPIKE_INTERVAL_S) {
+            m_spike[channel] += SPIKE_CODES;
+        }
+        double day = (double)(m_time_us - START_TIME_US) / 86400e6;
+        double value = DRIFT_CODES * std::sin(2 * M_PI * day + m_phase[channel]) + m_walk[channel] +
+                       m_spike[channel] + noise(m_random);
+        return (int32_t)std::clamp(std::lround(value), (long)-SAMPLE_ZERO_CODE, (long)SAMPLE_ZERO_CODE - 1);
+    }
+};
+
+/**
+ * @brief Runs all synthetic nodes frame by frame in turn, as an ingest receives them.
+ * @return Samples over both channels.
+ */
+template <typename Handler>
+static uint64_t generate(const BenchOptions& options, Handler&& handler) {
+    uint64_t end_time_us = START_TIME_US + (uint64_t)(options.weeks * 7 * 86400e6);
+    std::vector<SyntheticNode> nodes;
+    for (int node = 0; node < options.nodes; node++) {
+        nodes.emplace_back(node + 1, options.rate_sps, end_time_us, options.seed);
+    }
+
+    SyntheticFrame frame;
+    uint64_t samples = 0;
+    std::vector<bool> active(nodes.size(), true);
+    size_t remaining = nodes.size();
+    while (remaining > 0) {
+        for (size_t i = 0; i < nodes.size(); i++) {
+            if (!active[i]) {
+                continue;
+            }
+            if (!nodes[i].next(frame)) {
+                active[i] = false;
+                remaining--;
+                continue;
+            }
+            handler(frame);
+            samples += 2 * frame.times.size();
+        }
+    }
+    return samples;
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/// Longest CSV line: time, node, device, both codes, separators and newline.
+static constexpr size_t CSV_LINE_SIZE = integer_chars_max<uint64_t>() + integer_chars_max<int32_t>() + 1 +
+                                        2 * integer_chars_max<int32_t>() + 5;
+
+/**
+ * @brief Writes the sample indexes of a frame as CSV lines.
+ */
+static void write_csv(FILE* out, const SyntheticFrame& frame) {
+    for (size_t i = 0; i < frame.times.size(); i++) {
+        LineBuffer<CSV_LINE_SIZE> line;
+        line.number(frame.times[i]).put(',').number(frame.node).put(',').put('0').put(',');
+        line.number(frame.ch0[i] + SAMPLE_ZERO_CODE).put(',').number(frame.ch1[i] + SAMPLE_ZERO_CODE).put('\n');
+        if (!line.overflow()) {
+            fwrite(line.data(), 1, line.size(), out);
+        }
+    }
+}
+
+/**
+ * @struct CsvRow
+ * @brief One parsed CSV line.
+ */
+struct CsvRow {
+    uint64_t time_us;
+    int32_t  node;
+    int32_t  ch[2];     ///< Sign-corrected samples.
+};
+
+/**
+ * @brief Calls `handler` for every line of the CSV after the column names.
+ */
+template <typename Handler>
+static void scan_csv(std::span<const uint8_t> bytes, Handler&& handler) {
+    const char* p = reinterpret_cast<const char*>(bytes.data());
+    const char* end = p + bytes.size();
+    p = std::find(p, end, '\n') + 1;
+    CsvRow row;
+    int device;
+    while (p < end) {
+        p = std::from_chars(p, end, row.time_us).ptr + 1;
+        p = std::from_chars(p, end, row.node).ptr + 1;
+        p = std::from_chars(p, end, device).ptr + 1;
+        p = std::from_chars(p, end, row.ch[0]).ptr + 1;
+        p = std::from_chars(p, end, row.ch[1]).ptr + 1;
+        row.ch[0] -= SAMPLE_ZERO_CODE;
+        row.ch[1] -= SAMPLE_ZERO_CODE;
+        handler(row);
+    }
+}
+
+/**
+ * @brief Checks that every series of the store reads back exactly as generated.
+ * @return Samples that differ or are missing.
+ */
+static uint64_t verify(const BenchOptions& options, SampleStoreReader& reader) {
+    uint64_t errors = 0;
+    for (int channel = 0; channel < 2; channel++) {
+        for (int node = 1; node <= options.nodes; node++) {
+            std::vector<uint64_t> times;
+            std::vector<int32_t> values;
+            generate(options, [&](const SyntheticFrame& frame) {
+                if (frame.node != node) {
+                    return;
+                }
+                times.insert(times.end(), frame.times.begin(), frame.times.end());
+                const std::vector<int32_t>& samples = channel == 0 ? frame.ch0 : frame.ch1;
+                values.insert(values.end(), samples.begin(), samples.end());
+            });
+
+            size_t position = 0;
+            reader.scan(SampleSeriesKey{node, 0, (uint8_t)channel}, 0, UINT64_MAX,
+                        [&](std::span<const uint64_t> block_times, std::span<const int32_t> block_values) {
+                for (size_t i = 0; i < block_times.size(); i++, position++) {
+                    if (position >= times.size() || block_times[i] != times[position] ||
+                        block_values[i] != values[position]) {
+                        errors++;
+                    }
+                }
+            });
+            errors += times.size() > position ? times.size() - position : 0;
+        }
+    }
+    return errors;
+}
+
+/**
+ * @struct Query
+ * @brief Range query with its result.
+ */
+struct Query {
+    SampleSeriesKey key;
+    uint64_t        from_us;
+    uint64_t        to_us;
+    uint64_t        count;  ///< Samples found.
+    int64_t         sum;    ///< Sum of the samples found.
+};
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  -n <nodes>    synthetic nodes (default 2)\n"
+        "  -w <weeks>    recording length (default 3)\n"
+        "  -r <sps>      samples per second and channel (default %u, the preset's rate)\n"
+        "  -q <count>    range queries against the store (default 200)\n"
+        "  -c <count>    of those, queries also run against the CSV (default 3)\n"
+        "  -l <min>      query window (default 60)\n"
+        "  -d <dir>      directory for the store and the CSV (default .)\n"
+        "  --keep        keep both files\n"
+        "  -s <seed>     random seed (default 1)\n",
+        program, (unsigned int)ad7124_rate_sps(PhytoConfig::power_mode, PhytoConfig::channels, PhytoConfig::filter_fs));
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options{2, 3, (double)ad7124_rate_sps(PhytoConfig::power_mode, PhytoConfig::channels,
+                                                        PhytoConfig::filter_fs),
+                         200, 3, 60, ".", false, 1};
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--keep") {
+            options.keep = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            print_usage(argv[0]);
+            return 2;
+        }
+        if (arg == "-n") {
+            options.nodes = std::stoi(argv[++i]);
+        } else if (arg == "-w") {
+            options.weeks = std::stod(argv[++i]);
+        } else if (arg == "-r") {
+            options.rate_sps = std::stod(argv[++i]);
+        } else if (arg == "-q") {
+            options.queries = std::stoi(argv[++i]);
+        } else if (arg == "-c") {
+            options.csv_queries = std::stoi(argv[++i]);
+        } else if (arg == "-l") {
+            options.window_min = std::stod(argv[++i]);
+        } else if (arg == "-d") {
+            options.directory = argv[++i];
+        } else if (arg == "-s") {
+            options.seed = std::stoull(argv[++i]);
+        } else {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+    if (options.nodes < 1 || options.weeks <= 0 || options.rate_sps <= 0 || options.queries < 0 ||
+        options.csv_queries < 0 || options.window_min <= 0) {
+        print_usage(argv[0]);
+        return 2;
+    }
+    options.csv_queries = std::min(options.csv_queries, options.queries);
+
+    const std::string store_path = options.directory + "/phyto_store_bench.phs";
+    const std::string csv_path = options.directory + "/phyto_store_bench.csv";
+    bool passed = true;
+
+    try {
+        printf("%d nodes, %.1f weeks at %.1f SPS per channel, %u samples per frame\n", options.nodes, options.weeks,
+               options.rate_sps, PhytoConfig::vector_size);
+
+        // Generation alone, subtracted from both ingest times
+        auto start = std::chrono::steady_clock::now();
+        uint64_t samples = generate(options, [](const SyntheticFrame&) {});
+        double generate_s = seconds_since(start);
+
+        start = std::chrono::steady_clock::now();
+        uint64_t clamped = 0;
+        uint64_t store_bytes = 0;
+        {
+            SampleStoreWriter writer(store_path);
+            generate(options, [&writer](const SyntheticFrame& frame) {
+                writer.append(SampleSeriesKey{frame.node, 0, 0}, frame.times, frame.ch0);
+                writer.append(SampleSeriesKey{frame.node, 0, 1}, frame.times, frame.ch1);
+            });
+            writer.finalize();
+            clamped = writer.clampedSamples();
+            store_bytes = writer.bytes();
+        }
+        double store_ingest_s = std::max(seconds_since(start) - generate_s, 1e-9);
+
+        start = std::chrono::steady_clock::now();
+        FILE* csv = fopen(csv_path.c_str(), "wb");
+        if (csv == nullptr) {
+            fprintf(stderr, "cannot create %s: %s\n", csv_path.c_str(), strerror(errno));
+            return 1;
+        }
+        setvbuf(csv, nullptr, _IOFBF, OUTPUT_BUFFER_SIZE);
+        fputs("time_us,node,device,ch0,ch1\n", csv);
+        generate(options, [csv](const SyntheticFrame& frame) { write_csv(csv, frame); });
+        uint64_t csv_bytes = (uint64_t)ftell(csv);
+        fclose(csv);
+        double csv_ingest_s = std::max(seconds_since(start) - generate_s, 1e-9);
+
+        printf("ingest:\n");
+        printf("  samples:          %llu (%.2f s to generate)\n", (unsigned long long)samples, generate_s);
+        printf("  store:            %.1f M samples/s\n", samples / store_ingest_s / 1e6);
+        printf("  csv:              %.1f M samples/s\n", samples / csv_ingest_s / 1e6);
+        printf("size:\n");
+        printf("  store:            %.1f MB, %.2f bytes/sample\n", store_bytes / 1e6, (double)store_bytes / samples);
+        printf("  csv:              %.1f MB, %.2f bytes/sample\n", csv_bytes / 1e6, (double)csv_bytes / samples);
+        printf("  ratio:            %.1fx against csv, %.1fx against 12-byte records\n",
+               (double)csv_bytes / store_bytes, 12.0 * samples / store_bytes);
+
+        MappedFile store_file(store_path);
+        SampleStoreReader reader(store_file.bytes());
+        MappedFile csv_file(csv_path);
+
+        start = std::chrono::steady_clock::now();
+        int64_t store_sum = 0;
+        uint64_t scanned = 0;
+        for (const SampleSeriesKey& key : reader.series()) {
+            scanned += reader.scan(key, 0, UINT64_MAX, [&store_sum](std::span<const uint64_t>,
+                                                                   std::span<const int32_t> values) {
+                for (int32_t value : values) {
+                    store_sum += value;
+                }
+            });
+        }
+        double store_scan_s = seconds_since(start);
+
+        start = std::chrono::steady_clock::now();
+        int64_t csv_sum = 0;
+        scan_csv(csv_file.bytes(), [&csv_sum](const CsvRow& row) { csv_sum += row.ch[0] + row.ch[1]; });
+        double csv_scan_s = seconds_since(start);
+
+        printf("full scan:\n");
+        printf("  store:            %.1f M samples/s, %zu blocks\n", scanned / store_scan_s / 1e6,
+               reader.index().size());
+        printf("  csv:              %.1f M samples/s\n", samples / csv_scan_s / 1e6);
+        if (scanned != samples || store_sum != csv_sum) {
+            printf("FAIL: full scans differ (%llu and %llu samples)\n", (unsigned long long)scanned,
+                   (unsigned long long)samples);
+            passed = false;
+        }
+
+        uint64_t errors = verify(options, reader);
+        if (errors > 0 || clamped > 0) {
+            printf("FAIL: %llu samples read back wrong, %llu clamped\n", (unsigned long long)errors,
+                   (unsigned long long)clamped);
+            passed = false;
+        }
+
+        // Random windows of the recording
+        std::mt19937_64 random(options.seed);
+        uint64_t window_us = (uint64_t)(options.window_min * 60e6);
+        uint64_t span_us = (uint64_t)(options.weeks * 7 * 86400e6);
+        std::vector<Query> queries(options.queries);
+        for (Query& query : queries) {
+            query.key = SampleSeriesKey{(int32_t)(random() % options.nodes) + 1, 0, (uint8_t)(random() % 2)};
+            query.from_us = START_TIME_US + random() % (span_us > window_us ? span_us - window_us : 1);
+            query.to_us = query.from_us + window_us;
+        }
+
+        uint64_t blocks_before = reader.decodedBlocks();
+        start = std::chrono::steady_clock::now();
+        uint64_t found = 0;
+        for (Query& query : queries) {
+            query.sum = 0;
+            query.count = reader.scan(query.key, query.from_us, query.to_us,
+                                      [&query](std::span<const uint64_t>, std::span<const int32_t> values) {
+                for (int32_t value : values) {
+                    query.sum += value;
+                }
+            });
+            found += query.count;
+        }
+        double store_query_s = seconds_since(start);
+
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < options.csv_queries; i++) {
+            const Query& query = queries[i];
+            uint64_t count = 0;
+            int64_t sum = 0;
+            scan_csv(csv_file.bytes(), [&](const CsvRow& row) {
+                if (row.node == query.key.node && row.time_us >= query.from_us && row.time_us <= query.to_us) {
+                    count++;
+                    sum += row.ch[query.key.channel];
+                }
+            });
+            if (count != query.count || sum != query.sum) {
+                printf("FAIL: query %d found %llu samples in the csv, %llu in the store\n", i,
+                       (unsigned long long)count, (unsigned long long)query.count);
+                passed = false;
+            }
+        }
+        double csv_query_s = seconds_since(start);
+
+        if (options.queries > 0) {
+            double store_per_query = store_query_s / options.queries;
+            printf("range scan (%.0f min windows):\n", options.window_min);
+            printf("  store:            %.1f us/query, %.1f samples and %.1f blocks decoded per query\n",
+                   store_per_query * 1e6, (double)found / options.queries,
+                   (double)(reader.decodedBlocks() - blocks_before) / options.queries);
+            if (options.csv_queries > 0) {
+                double csv_per_query = csv_query_s / options.csv_queries;
+                printf("  csv:              %.1f ms/query (%d queries), %.0fx slower\n", csv_per_query * 1e3,
+                       options.csv_queries, csv_per_query / store_per_query);
+            }
+        }
+    } catch (const std::exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        passed = false;
+    }
+
+    if (!options.keep) {
+        remove(store_path.c_str());
+        remove(csv_path.c_str());
+    }
+    printf("%s\n", passed ? "PASS" : "FAIL");
+    return passed ? 0 : 1;
+}
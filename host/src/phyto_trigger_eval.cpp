@@ -0,0 +1,344 @@
+/**
+ * @file phyto_trigger_eval.cpp
+ * @brief Evaluates the node's event trigger on synthetic action potentials or a recorded capture.
+ *
+ * @details
+ * The firmware's `TriggerEngine` runs with the parameters of the configured
+ * preset (`EVENT_TRIGGER`), and every frame it hands out is serialized with
+ * `FrameBuilder`, or `RawFrameBuilder` with `--raw`. The bytes are compared
+ * with the continuous stream of `vector_size` frames the node sends without
+ * the trigger.
+ *
+ * - Synthetic mode (default) generates both channels at the preset rate:
+ *   white noise on a slowly drifting baseline, and action potentials of
+ *   random sign, amplitude and channel (linear rise, exponential decay) at
+ *   random times. As the onsets are known, the tool reports detected and
+ *   missed potentials, false events, the detection latency from the onset to
+ *   the opening of the event window, and whether the onset sample itself was
+ *   sent. It exits with 1 if a potential was missed.
+ * - With `-c`, the samples of an SPI word or frame capture (`phyto_capture`)
+ *   are used instead; without ground truth only events, detectors and the
+ *   data volume are reported.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <exception>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "adc/SampleCollector.h"
+#include "adc/TriggerEngine.h"
+#include "capture/CaptureFile.h"
+#include "config/PipelineConfig.h"
+#include "serial_mail_sender/FrameBuilder.h"
+#include "serial_mail_sender/RawFrameBuilder.h"
+#include "stream_decoder/StreamDecoder.h"
+#include "transport/FrameBuffer.h"
+#include "utils/ConversionKernel.h"
+#include "utils/MappedFile.h"
+
+/// Simulated time in synthetic mode.
+#define DEFAULT_DURATION_S 3600
+
+/// Mean time between two synthetic action potentials.
+#define DEFAULT_SPIKE_INTERVAL_S 120
+
+/// Mean amplitude of a synthetic action potential.
+#define DEFAULT_AMPLITUDE_MV 20.0
+
+/// Standard deviation of the synthetic noise.
+#define DEFAULT_NOISE_MV 0.05
+
+/// Rise time of a synthetic action potential.
+#define SPIKE_RISE_S 1.0
+
+/// Decay time constant of a synthetic action potential.
+#define SPIKE_DECAY_S 8.0
+
+/// Amplitude and period of the synthetic baseline drift.
+#define DRIFT_MV 5.0
+#define DRIFT_PERIOD_S 900.0
+
+/// Level of the synthetic baseline.
+#define BASELINE_MV 30.0
+
+/**
+ * @struct Spike
+ * @brief A synthetic action potential.
+ */
+struct Spike {
+    uint64_t onset;         ///< Pair index of the first deflected sample.
+    uint64_t end;           ///< Pair index after which the potential has decayed below the noise.
+    int      channel;       ///< Channel carrying the potential.
+    double   amplitude_mv;  ///< Signed peak.
+};
+
+/**
+ * @class Evaluation
+ * @brief Feeds sample pairs through the trigger and counts the bytes of both streams.
+ */
+class Evaluation {
+public:
+    Evaluation(bool raw)
+        : m_trigger(trigger_settings<PhytoConfig>(PhytoConfig::vector_size)), m_raw(raw),
+          m_trigger_frames(0), m_trigger_bytes(0), m_continuous_frames(0), m_continuous_bytes(0) {}
+
+    /// Pushes one pair; returns true if it opened an event window.
+    bool push(int32_t ch0, int32_t ch1) {
+        m_continuous_ch0.push_back(ch0);
+        m_continuous_ch1.push_back(ch1);
+        if (m_continuous_ch0.size() >= PhytoConfig::vector_size) {
+            m_continuous_bytes += build(m_continuous_ch0, m_continuous_ch1);
+            m_continuous_frames++;
+            m_continuous_ch0.clear();
+            m_continuous_ch1.clear();
+        }
+
+        if (m_trigger.push(ch0, ch1) != TRIGGER_NONE) {
+            m_trigger_bytes += build(m_trigger.ch0(), m_trigger.ch1());
+            m_trigger_frames++;
+            m_trigger.clear();
+        }
+        return m_trigger.onset();
+    }
+
+    const TriggerEngine& trigger(void) const { return m_trigger; }
+
+    /// Prints the data volume of both streams.
+    void report(double rate_sps) const {
+        const TriggerStats& stats = m_trigger.stats();
+        const TriggerSettings& settings = m_trigger.settings();
+        double seconds = stats.pairs / rate_sps;
+        printf("duration:         %.0f s, %u sample pairs at %.0f SPS\n", seconds, stats.pairs, rate_sps);
+        printf("trigger:          pre %u, post %u, heartbeat every %u samples, frames of %u (%s)\n",
+               settings.pre_samples, settings.post_samples, settings.heartbeat_samples, settings.frame_samples,
+               m_raw ? "raw" : "flatbuffer");
+        printf("events:           %u (level %u, slope %u, baseline %u), %.2f per minute\n", stats.events,
+               stats.threshold_onsets, stats.slope_onsets, stats.baseline_onsets,
+               seconds > 0 ? stats.events * 60.0 / seconds : 0);
+        printf("heartbeats:       %u\n", stats.heartbeats);
+        printf("samples sent:     %u of %u (%.2f%%)\n", stats.event_pairs + stats.heartbeats, stats.pairs,
+               stats.pairs > 0 ? 100.0 * (stats.event_pairs + stats.heartbeats) / stats.pairs : 0);
+        printf("continuous:       %llu frames, %llu bytes, %.1f B/s\n", (unsigned long long)m_continuous_frames,
+               (unsigned long long)m_continuous_bytes, seconds > 0 ? m_continuous_bytes / seconds : 0);
+        printf("triggered:        %llu frames, %llu bytes, %.1f B/s\n", (unsigned long long)m_trigger_frames,
+               (unsigned long long)m_trigger_bytes, seconds > 0 ? m_trigger_bytes / seconds : 0);
+        if (m_trigger_bytes > 0) {
+            printf("reduction:        %.1fx (%.1f%% of the bytes)\n", (double)m_continuous_bytes / m_trigger_bytes,
+                   100.0 * m_trigger_bytes / m_continuous_bytes);
+        }
+    }
+
+private:
+    TriggerEngine   m_trigger;              ///< Engine under evaluation.
+    FrameBuilder    m_builder;              ///< Serializer without `--raw`.
+    RawFrameBuilder m_raw_builder;          ///< Serializer with `--raw`.
+    bool            m_raw;                  ///< Serialize raw frames.
+    SampleVector    m_continuous_ch0;       ///< Frame of the continuous stream, channel 0.
+    SampleVector    m_continuous_ch1;       ///< Frame of the continuous stream, channel 1.
+    uint64_t        m_trigger_frames;       ///< Frames handed out by the trigger.
+    uint64_t        m_trigger_bytes;        ///< Their bytes on the link.
+    uint64_t        m_continuous_frames;    ///< Frames of the continuous stream.
+    uint64_t        m_continuous_bytes;     ///< Their bytes on the link.
+    uint8_t         m_frame[FRAME_BUFFER_CAPACITY]; ///< Serialization buffer.
+
+    size_t build(const SampleVector& ch0, const SampleVector& ch1) {
+        if (m_raw) {
+            return m_raw_builder.build(ch0, ch1, PhytoConfig::node, m_frame, sizeof(m_frame));
+        }
+        return m_builder.build(ch0, ch1, PhytoConfig::node, m_frame, sizeof(m_frame));
+    }
+};
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  -c <capture>  evaluate the samples of a capture instead of synthetic data\n"
+        "  -t <s>        synthetic duration (default %d)\n"
+        "  -e <s>        mean time between action potentials (default %d)\n"
+        "  -a <mV>       mean amplitude (default %.1f)\n"
+        "  -n <mV>       noise standard deviation (default %.2f)\n"
+        "  -s <seed>     random seed (default 1)\n"
+        "  --raw         count raw frames (RAW_FRAMES) instead of FlatBuffer frames\n",
+        program, DEFAULT_DURATION_S, DEFAULT_SPIKE_INTERVAL_S, DEFAULT_AMPLITUDE_MV, DEFAULT_NOISE_MV);
+}
+
+static int32_t to_sample(double millivolts) {
+    int32_t sample = millivolts_to_codes<PhytoConfig>((float)millivolts);
+    return std::clamp(sample, -SAMPLE_ZERO_CODE, SAMPLE_ZERO_CODE - 1);
+}
+
+static double percentile(std::vector<double> values, double fraction) {
+    if (values.empty()) {
+        return 0;
+    }
+    size_t index = std::min(values.size() - 1, (size_t)(fraction * values.size()));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+/**
+ * @brief Runs the synthetic scenario and reports detection figures.
+ * @return True if every action potential was detected.
+ */
+static bool evaluate_synthetic(Evaluation& evaluation, double rate_sps, double duration_s, double interval_s,
+                               double amplitude_mv, double noise_mv, unsigned int seed) {
+    std::mt19937 random(seed);
+    std::normal_distribution<double> noise(0, noise_mv);
+    std::exponential_distribution<double> gap(1.0 / interval_s);
+    std::uniform_real_distribution<double> scale(0.5, 1.5);
+    std::bernoulli_distribution coin(0.5);
+
+    // Potentials start after the baseline has settled and never overlap
+    const uint64_t pairs = (uint64_t)(duration_s * rate_sps);
+    const uint64_t settle = (uint64_t)(1u << PhytoConfig::trigger_baseline_shift) * 4;
+    const uint64_t length = (uint64_t)((SPIKE_RISE_S + 6 * SPIKE_DECAY_S) * rate_sps);
+    std::vector<Spike> spikes;
+    for (double t = settle / rate_sps + gap(random);; t += length / rate_sps + gap(random)) {
+        uint64_t onset = (uint64_t)(t * rate_sps);
+        if (onset + length >= pairs) {
+            break;
+        }
+        spikes.push_back({onset, onset + length, coin(random) ? 1 : 0,
+                          (coin(random) ? 1 : -1) * amplitude_mv * scale(random)});
+    }
+
+    std::vector<double> latencies_ms;
+    size_t detected = 0;
+    size_t onset_sent = 0;
+    uint64_t false_events = 0;
+    size_t next = 0;
+    bool current_detected = false;
+
+    for (uint64_t i = 0; i < pairs; i++) {
+        double t = i / rate_sps;
+        double level = BASELINE_MV + DRIFT_MV * sin(2 * M_PI * t / DRIFT_PERIOD_S);
+        double mv[2] = {level + noise(random), -level + noise(random)};
+
+        while (next < spikes.size() && i >= spikes[next].end) {
+            next++;
+            current_detected = false;
+        }
+        const Spike* spike = (next < spikes.size() && i >= spikes[next].onset) ? &spikes[next] : nullptr;
+        if (spike != nullptr) {
+            double since_s = (i - spike->onset + 1) / rate_sps;
+            double shape = since_s < SPIKE_RISE_S ? since_s / SPIKE_RISE_S
+                                                  : exp(-(since_s - SPIKE_RISE_S) / SPIKE_DECAY_S);
+            mv[spike->channel] += spike->amplitude_mv * shape;
+            if (i == spike->onset && evaluation.trigger().active()) {
+                // Still inside the window of an earlier event, the onset is sent
+                current_detected = true;
+                detected++;
+                onset_sent++;
+                latencies_ms.push_back(0);
+            }
+        }
+
+        bool opened = evaluation.push(to_sample(mv[0]), to_sample(mv[1]));
+        if (!opened) {
+            continue;
+        }
+        if (spike != nullptr && !current_detected) {
+            current_detected = true;
+            detected++;
+            uint64_t delay = i - spike->onset;
+            onset_sent += delay <= evaluation.trigger().settings().pre_samples ? 1 : 0;
+            latencies_ms.push_back(delay * 1000.0 / rate_sps);
+        } else if (spike == nullptr) {
+            false_events++;
+        }
+    }
+
+    evaluation.report(rate_sps);
+    printf("potentials:       %zu, detected %zu, missed %zu, false events %llu\n", spikes.size(), detected,
+           spikes.size() - detected, (unsigned long long)false_events);
+    printf("onset sent:       %zu of %zu detected\n", onset_sent, detected);
+    printf("latency:          p50 %.0f ms, p99 %.0f ms, max %.0f ms\n", percentile(latencies_ms, 0.50),
+           percentile(latencies_ms, 0.99), percentile(latencies_ms, 1.0));
+    return detected == spikes.size();
+}
+
+/**
+ * @brief Runs the samples of a capture through the trigger.
+ */
+static void evaluate_capture(Evaluation& evaluation, const std::string& path, double rate_sps) {
+    MappedFile file(path);
+    CaptureReader reader(file.bytes());
+    SampleCollector collector(1);
+    StreamDecoder decoder([&](const DecodedFrame& frame) {
+        size_t count = std::min(frame.ch0.size(), frame.ch1.size());
+        for (size_t i = 0; i < count; i++) {
+            evaluation.push(node_sample(frame.ch0[i]), node_sample(frame.ch1[i]));
+        }
+    });
+
+    CaptureRecord record;
+    while (reader.next(record)) {
+        if (record.kind == CAPTURE_KIND_SPI_WORDS) {
+            for (size_t offset = 0; offset + AD7124_CONVERSION_WORD_SIZE <= record.payload.size();
+                 offset += AD7124_CONVERSION_WORD_SIZE) {
+                if (collector.push(record.payload.data() + offset)) {
+                    evaluation.push(collector.ch0()[0], collector.ch1()[0]);
+                    collector.clear();
+                }
+            }
+        } else if (record.kind == CAPTURE_KIND_FRAMES) {
+            decoder.feed(record.payload);
+        }
+    }
+    evaluation.report(rate_sps);
+}
+
+int main(int argc, char** argv) {
+    std::string capture;
+    double duration_s = DEFAULT_DURATION_S;
+    double interval_s = DEFAULT_SPIKE_INTERVAL_S;
+    double amplitude_mv = DEFAULT_AMPLITUDE_MV;
+    double noise_mv = DEFAULT_NOISE_MV;
+    unsigned int seed = 1;
+    bool raw = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--raw") {
+            raw = true;
+        } else if (arg == "-c" && i + 1 < argc) {
+            capture = argv[++i];
+        } else if (arg == "-t" && i + 1 < argc) {
+            duration_s = std::stod(argv[++i]);
+        } else if (arg == "-e" && i + 1 < argc) {
+            interval_s = std::stod(argv[++i]);
+        } else if (arg == "-a" && i + 1 < argc) {
+            amplitude_mv = std::stod(argv[++i]);
+        } else if (arg == "-n" && i + 1 < argc) {
+            noise_mv = std::stod(argv[++i]);
+        } else if (arg == "-s" && i + 1 < argc) {
+            seed = (unsigned int)std::stoul(argv[++i]);
+        } else {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+    if (duration_s <= 0 || interval_s <= 0 || noise_mv < 0) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    double rate_sps = ad7124_rate_sps(PhytoConfig::power_mode, PhytoConfig::channels, PhytoConfig::filter_fs);
+    Evaluation evaluation(raw);
+    try {
+        if (!capture.empty()) {
+            evaluate_capture(evaluation, capture, rate_sps);
+            return 0;
+        }
+        return evaluate_synthetic(evaluation, rate_sps, duration_s, interval_s, amplitude_mv, noise_mv, seed) ? 0 : 1;
+    } catch (const std::exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+}
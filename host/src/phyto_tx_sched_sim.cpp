@@ -0,0 +1,440 @@
+/**
+ * @file phyto_tx_sched_sim.cpp
+ * @brief Simulates sample frames sharing the UART with control, status and bulk traffic.
+ *
+ * @details
+ * The node's `FrameSink`, `FrameDispatcher`, `TxScheduler` and message frame
+ * builder run against a UART model: a TX buffer of the size of the Mbed
+ * driver's, drained at the byte rate of `UART_BAUDRATE` in 8N1. The main loop
+ * services the sink after every frame it publishes and otherwise once per
+ * service period. Sample frames arrive at the rate of the configured preset,
+ * a sync response once per sync period, a status message once per status
+ * period, and a bulk dump is restarted as soon as the previous one has been
+ * cut, so the link is always saturated.
+ *
+ * Every byte leaving the wire goes through a `StreamDecoder`. The latency of
+ * a frame is the time from its publication until its last byte left the wire;
+ * that of a message is the time from `sendMessage` until its last chunk did.
+ *
+ * Three modes are compared:
+ * - `fifo`: the sink without a scheduler, bulk dumps cut into frames of the
+ *   full buffer capacity, i.e. the node without `TX_SCHEDULER` sending one
+ *   large transfer after the other.
+ * - `sched`: `TX_CLASS_DEFAULTS` and chunks of `SERIAL_MAIL_MESSAGE_CHUNK_SIZE`.
+ * - `sched+cap`: as `sched`, with bulk capped to the given rate.
+ *
+ * The tool exits with 1 if a sample or control frame was lost with the
+ * scheduler, or if a sample frame took longer than the bound: the TX buffer,
+ * one chunk of a lower class, one sync response and the sample frame itself
+ * on the wire, plus one service period and one step.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "config/PipelineConfig.h"
+#include "serial_mail_sender/FrameFormat.h"
+#include "serial_mail_sender/MessageFrameBuilder.h"
+#include "serial_mail_sender/RawFrameBuilder.h"
+#include "stream_decoder/StreamDecoder.h"
+#include "timing/ClockSync.h"
+#include "transport/FrameBuffer.h"
+#include "transport/FrameDispatcher.h"
+#include "transport/FrameSink.h"
+#include "transport/TxScheduler.h"
+
+/// Simulated time per mode.
+#define DEFAULT_DURATION_S 60
+
+/// Simulation step in µs; the wire drains and the clock advances once per step.
+#define DEFAULT_STEP_US 100
+
+/// Bytes per second of the UART, 115200 baud in 8N1.
+#define DEFAULT_LINK_RATE 11520
+
+/// TX buffer of the Mbed serial driver (`drivers.uart-serial-txbuf-size`).
+#define DEFAULT_TX_BUFFER 256
+
+/// Time between two services of the sink while no frame is published.
+#define DEFAULT_SERVICE_PERIOD_US 5000
+
+/// Time between two sync responses.
+#define DEFAULT_SYNC_PERIOD_MS 1000
+
+/// Time between two status messages, and their size.
+#define DEFAULT_STATUS_PERIOD_MS 1000
+#define DEFAULT_STATUS_SIZE 512
+
+/// Size of one bulk dump.
+#define DEFAULT_BULK_SIZE 65536
+
+/// Message chunk of the node with `TX_SCHEDULER`, `SERIAL_MAIL_MESSAGE_CHUNK_SIZE`.
+#define SCHED_CHUNK_SIZE 128
+
+/// Message chunk filling a whole frame buffer, used by the `fifo` mode.
+#define FIFO_CHUNK_SIZE (FRAME_BUFFER_CAPACITY - SERIAL_MAIL_HEADER_SIZE - MESSAGE_FRAME_HEADER_SIZE)
+
+/// Size of a sync response on the wire.
+#define SYNC_RESPONSE_FRAME_SIZE (SERIAL_MAIL_HEADER_SIZE + SYNC_RESPONSE_SIZE)
+
+/**
+ * @struct SimMode
+ * @brief One transmit configuration compared by the simulation.
+ */
+struct SimMode {
+    std::string name;           ///< Label in the report.
+    bool        scheduled;      ///< A `TxScheduler` is attached to the sink.
+    size_t      chunk_size;     ///< Message bytes per message frame.
+    uint32_t    bulk_cap;       ///< Rate cap of bulk in B/s, 0 for none.
+};
+
+/**
+ * @struct SimOptions
+ * @brief Link and traffic parameters shared by all modes.
+ */
+struct SimOptions {
+    double   rate_sps;          ///< Conversions per second and channel.
+    double   link_rate;         ///< Bytes per second the wire drains.
+    size_t   tx_buffer;         ///< Bytes the driver buffers.
+    double   duration_s;        ///< Simulated time.
+    uint32_t step_us;           ///< Simulation step.
+    uint32_t service_us;        ///< Service period of the main loop.
+    uint32_t sync_ms;           ///< Sync response period.
+    uint32_t status_ms;         ///< Status message period.
+    size_t   status_size;       ///< Status message size.
+    size_t   bulk_size;         ///< Bulk dump size.
+};
+
+/**
+ * @struct SimResult
+ * @brief Outcome of one run.
+ */
+struct SimResult {
+    std::vector<float> sample_ms;       ///< Latency of every delivered sample frame.
+    std::vector<float> control_ms;      ///< Latency of every delivered sync response.
+    std::vector<float> status_ms;       ///< Latency of every delivered status message.
+    uint64_t           samples_sent;    ///< Sample frames published.
+    uint64_t           controls_sent;   ///< Sync responses published.
+    uint64_t           status_sent;     ///< Status messages started.
+    uint64_t           bulk_bytes;      ///< Bytes of bulk dumps delivered completely.
+    uint64_t           lost_messages;   ///< Messages the decoder dropped for a missing chunk.
+    uint64_t           wire_bytes;      ///< Bytes written to the wire.
+    double             elapsed_s;       ///< Simulated time including draining the queues.
+};
+
+/// Simulated microsecond clock of the scheduler.
+static uint32_t sim_now_us = 0;
+
+static uint32_t sim_clock(void) {
+    return sim_now_us;
+}
+
+/**
+ * @class SimUart
+ * @brief Sink that writes into a bounded TX buffer drained at the link rate.
+ */
+class SimUart : public FrameSink {
+public:
+    explicit SimUart(size_t tx_buffer)
+        : FrameSink("uart", BACKPRESSURE_DROP_OLDEST), m_capacity(tx_buffer), m_credit(0) {}
+
+    /**
+     * @brief Moves the bytes the wire carries during one step out of the TX buffer.
+     * @param bytes Bytes the link carries in the step; an idle wire saves no credit.
+     * @param out Receives the bytes that left the wire.
+     */
+    void drain(double bytes, std::vector<uint8_t>& out) {
+        m_credit = m_buffer.empty() ? 0 : m_credit + bytes;
+        size_t count = std::min(m_buffer.size(), (size_t)m_credit);
+        out.assign(m_buffer.begin(), m_buffer.begin() + count);
+        m_buffer.erase(m_buffer.begin(), m_buffer.begin() + count);
+        m_credit -= (double)count;
+    }
+
+protected:
+    size_t writeSome(const uint8_t* data, size_t size) override {
+        size_t written = std::min(size, m_capacity - m_buffer.size());
+        m_buffer.insert(m_buffer.end(), data, data + written);
+        return written;
+    }
+
+private:
+    size_t              m_capacity;     ///< Size of the TX buffer.
+    std::deque<uint8_t> m_buffer;       ///< Bytes waiting for the wire.
+    double              m_credit;       ///< Part of a byte carried to the next step.
+};
+
+/**
+ * @struct SimMessage
+ * @brief Message being cut into message frames, like `SerialMailSender::PendingMessage`.
+ */
+struct SimMessage {
+    std::vector<uint8_t> data;      ///< Message contents.
+    MessageHeader        header;    ///< Header repeated in every chunk.
+    size_t               offset;    ///< First byte not yet cut.
+    bool                 active;    ///< Chunks remain to be cut.
+};
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  -r <sps>      conversions per second and channel (default: preset rate)\n"
+        "  -l <B/s>      link rate (default %d)\n"
+        "  -b <bytes>    TX buffer of the driver (default %d)\n"
+        "  -c <B/s>      bulk cap of the sched+cap mode (default: half the link rate)\n"
+        "  -m <ms>       sample latency bound (default: computed from the link)\n"
+        "  -t <s>        simulated time per mode (default %d)\n"
+        "  -p <us>       simulation step (default %d)\n",
+        program, DEFAULT_LINK_RATE, DEFAULT_TX_BUFFER, DEFAULT_DURATION_S, DEFAULT_STEP_US);
+}
+
+/**
+ * @brief Cuts message frames while the dispatcher accepts them, like `SerialMailSender::publishMessageChunks`.
+ */
+static void publish_chunks(SimMessage* messages, size_t chunk_size, FramePool& pool, FrameDispatcher& dispatcher) {
+    for (size_t i = 0; i < TRAFFIC_CLASS_COUNT; i++) {
+        SimMessage& message = messages[i];
+        while (message.active && dispatcher.canAccept((TrafficClass)i)) {
+            FrameRef frame = pool.allocate();
+            if (!frame) {
+                return;
+            }
+            frame.setSize(build_message_frame(message.header, message.data.data(), message.offset, chunk_size,
+                                              frame.mutableData(), FRAME_BUFFER_CAPACITY, &message.offset));
+            dispatcher.publish(frame, (TrafficClass)i);
+            message.active = message.offset < message.header.size;
+        }
+    }
+}
+
+/**
+ * @brief Runs one mode.
+ */
+static SimResult simulate(const SimMode& mode, const SimOptions& options) {
+    FramePool pool;
+    FrameDispatcher dispatcher;
+    SimUart uart(options.tx_buffer);
+    TxScheduler scheduler;
+    dispatcher.addSink(uart);
+    if (mode.scheduled) {
+        if (mode.bulk_cap > 0) {
+            TxClassConfig bulk = TX_CLASS_DEFAULTS[TRAFFIC_BULK];
+            bulk.rate = mode.bulk_cap;
+            bulk.burst = FRAME_BUFFER_CAPACITY;
+            scheduler.configure(TRAFFIC_BULK, bulk);
+        }
+        uart.attachScheduler(scheduler, &sim_clock);
+    }
+
+    SimResult result{{}, {}, {}, 0, 0, 0, 0, 0, 0, 0};
+    std::unordered_map<uint32_t, uint32_t> sample_us;      // Sequence number to publication time
+    std::unordered_map<uint32_t, uint32_t> control_us;     // Sync response id to publication time
+    std::unordered_map<uint16_t, uint32_t> status_us;      // Message id to start time
+
+    StreamDecoder decoder([&](const DecodedFrame& frame) {
+        auto it = sample_us.find(frame.sequence);
+        if (it != sample_us.end()) {
+            result.sample_ms.push_back((float)(sim_now_us - it->second) / 1000);
+            sample_us.erase(it);
+        }
+    });
+    decoder.setSyncHandler([&](const SyncResponse& response) {
+        auto it = control_us.find(response.id);
+        if (it != control_us.end()) {
+            result.control_ms.push_back((float)(sim_now_us - it->second) / 1000);
+            control_us.erase(it);
+        }
+    });
+    decoder.setMessageHandler([&](const MessageHeader& header, std::span<const uint8_t> data) {
+        if (header.kind == MESSAGE_KIND_DUMP) {
+            result.bulk_bytes += data.size();
+            return;
+        }
+        auto it = status_us.find(header.id);
+        if (it != status_us.end()) {
+            result.status_ms.push_back((float)(sim_now_us - it->second) / 1000);
+            status_us.erase(it);
+        }
+    });
+
+    RawFrameBuilder builder;
+    SampleVector ch0(PhytoConfig::vector_size, 0);
+    SampleVector ch1(PhytoConfig::vector_size, -1);
+    SimMessage messages[TRAFFIC_CLASS_COUNT] = {};
+    uint16_t message_id = 0;
+    auto start_message = [&](TrafficClass traffic_class, uint8_t kind, size_t size) {
+        SimMessage& message = messages[traffic_class];
+        message.data.assign(size, (uint8_t)kind);
+        message.header = {PhytoConfig::node, kind, ++message_id, (uint32_t)size};
+        message.offset = 0;
+        message.active = true;
+        return message.header.id;
+    };
+
+    const uint32_t frame_period_us = (uint32_t)(PhytoConfig::vector_size * 1e6 / options.rate_sps);
+    const uint32_t end_us = (uint32_t)(options.duration_s * 1e6);
+    uint32_t next_sample_us = frame_period_us;
+    uint32_t next_sync_us = options.sync_ms * 1000;
+    uint32_t next_status_us = 0;
+    uint32_t next_service_us = 0;
+    uint32_t sync_id = 0;
+    std::vector<uint8_t> wire;
+
+    // Traffic stops after `duration_s`; the wire then drains what is queued
+    for (sim_now_us = 0; sim_now_us < end_us || uart.queued() > 0 || !wire.empty(); sim_now_us += options.step_us) {
+        bool running = sim_now_us < end_us;
+        bool published = false;
+
+        if (running && sim_now_us >= next_sample_us) {
+            // What SerialMailSender::sendMail does
+            FrameRef frame = pool.allocate();
+            if (frame) {
+                sample_us[builder.sequence()] = sim_now_us;
+                frame.setSize(builder.build(ch0, ch1, PhytoConfig::node, frame.mutableData(),
+                                            FRAME_BUFFER_CAPACITY));
+                dispatcher.publish(frame, TRAFFIC_SAMPLES);
+            }
+            result.samples_sent++;
+            next_sample_us += frame_period_us;
+            published = true;
+        }
+        if (running && sim_now_us >= next_sync_us) {
+            // What service_clock_sync does through SerialMailSender::sendRaw
+            SyncResponse response = {PhytoConfig::node, SYNC_FLAG_SYNCED, ++sync_id, sim_now_us, sim_now_us, 0};
+            FrameRef frame = pool.allocate();
+            if (frame) {
+                control_us[sync_id] = sim_now_us;
+                frame.setSize(write_sync_response(response, frame.mutableData(), FRAME_BUFFER_CAPACITY));
+                dispatcher.publish(frame, TRAFFIC_CONTROL);
+            }
+            result.controls_sent++;
+            next_sync_us += options.sync_ms * 1000;
+            published = true;
+        }
+        if (running && sim_now_us >= next_status_us) {
+            if (!messages[TRAFFIC_STATUS].active) {
+                status_us[start_message(TRAFFIC_STATUS, MESSAGE_KIND_STATUS, options.status_size)] = sim_now_us;
+                result.status_sent++;
+            }
+            next_status_us += options.status_ms * 1000;
+            published = true;
+        }
+        if (running && !messages[TRAFFIC_BULK].active) {
+            start_message(TRAFFIC_BULK, MESSAGE_KIND_DUMP, options.bulk_size);
+        }
+
+        if (published || sim_now_us >= next_service_us) {
+            publish_chunks(messages, mode.chunk_size, pool, dispatcher);
+            dispatcher.service();
+            next_service_us = sim_now_us + options.service_us;
+        }
+
+        uart.drain(options.link_rate * options.step_us / 1e6, wire);
+        decoder.feed(wire);
+    }
+
+    result.lost_messages = decoder.stats().lost_messages;
+    result.wire_bytes = uart.stats().bytes;
+    result.elapsed_s = sim_now_us / 1e6;
+    return result;
+}
+
+static float percentile(std::vector<float>& values, double fraction) {
+    if (values.empty()) {
+        return 0;
+    }
+    size_t index = std::min(values.size() - 1, (size_t)(fraction * values.size()));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+static float maximum(const std::vector<float>& values) {
+    return values.empty() ? 0 : *std::max_element(values.begin(), values.end());
+}
+
+int main(int argc, char** argv) {
+    SimOptions options = {
+        (double)ad7124_rate_sps(PhytoConfig::power_mode, PhytoConfig::channels, PhytoConfig::filter_fs),
+        DEFAULT_LINK_RATE, DEFAULT_TX_BUFFER, DEFAULT_DURATION_S, DEFAULT_STEP_US, DEFAULT_SERVICE_PERIOD_US,
+        DEFAULT_SYNC_PERIOD_MS, DEFAULT_STATUS_PERIOD_MS, DEFAULT_STATUS_SIZE, DEFAULT_BULK_SIZE,
+    };
+    double bulk_cap = 0;
+    double bound_ms = 0;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            print_usage(argv[0]);
+            return 2;
+        }
+        if (arg == "-r") {
+            options.rate_sps = std::stod(argv[++i]);
+        } else if (arg == "-l") {
+            options.link_rate = std::stod(argv[++i]);
+        } else if (arg == "-b") {
+            options.tx_buffer = std::stoul(argv[++i]);
+        } else if (arg == "-c") {
+            bulk_cap = std::stod(argv[++i]);
+        } else if (arg == "-m") {
+            bound_ms = std::stod(argv[++i]);
+        } else if (arg == "-t") {
+            options.duration_s = std::stod(argv[++i]);
+        } else if (arg == "-p") {
+            options.step_us = (uint32_t)std::stoul(argv[++i]);
+        } else {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+    if (options.rate_sps <= 0 || options.link_rate <= 0 || options.tx_buffer == 0 || options.duration_s <= 0 ||
+        options.step_us == 0) {
+        print_usage(argv[0]);
+        return 2;
+    }
+    if (bulk_cap <= 0) {
+        bulk_cap = options.link_rate / 2;
+    }
+
+    const size_t sample_frame = SERIAL_MAIL_HEADER_SIZE + raw_frame_payload_size(PhytoConfig::vector_size);
+    const size_t chunk_frame = SERIAL_MAIL_HEADER_SIZE + MESSAGE_FRAME_HEADER_SIZE + SCHED_CHUNK_SIZE;
+    if (bound_ms <= 0) {
+        size_t ahead = options.tx_buffer + chunk_frame + SYNC_RESPONSE_FRAME_SIZE + sample_frame;
+        bound_ms = 1000.0 * ahead / options.link_rate + (options.service_us + options.step_us) / 1000.0;
+    }
+
+    double sample_rate = sample_frame * options.rate_sps / PhytoConfig::vector_size;
+    printf("%.0f SPS per channel, sample frames of %zu B (%.0f B/s), link %.0f B/s, TX buffer %zu B, %.0f s per mode\n",
+           options.rate_sps, sample_frame, sample_rate, options.link_rate, options.tx_buffer, options.duration_s);
+    printf("sample latency bound with the scheduler: %.1f ms\n\n", bound_ms);
+    printf("%-10s %9s %9s %9s %8s %9s %9s %10s %10s %9s %10s\n", "mode", "p50 ms", "p99 ms", "max ms", "lost",
+           "ctl max", "ctl lost", "status max", "bulk B/s", "lost msgs", "wire B/s");
+
+    std::vector<SimMode> modes = {
+        {"fifo", false, FIFO_CHUNK_SIZE, 0},
+        {"sched", true, SCHED_CHUNK_SIZE, 0},
+        {"sched+cap", true, SCHED_CHUNK_SIZE, (uint32_t)bulk_cap},
+    };
+    bool passed = true;
+    for (const SimMode& mode : modes) {
+        SimResult result = simulate(mode, options);
+        uint64_t sample_lost = result.samples_sent - result.sample_ms.size();
+        uint64_t control_lost = result.controls_sent - result.control_ms.size();
+        float sample_max = maximum(result.sample_ms);
+        printf("%-10s %9.1f %9.1f %9.1f %8llu %9.1f %9llu %10.1f %10.0f %9llu %10.0f\n", mode.name.c_str(),
+               percentile(result.sample_ms, 0.50), percentile(result.sample_ms, 0.99), sample_max,
+               (unsigned long long)sample_lost, maximum(result.control_ms), (unsigned long long)control_lost,
+               maximum(result.status_ms), result.bulk_bytes / result.elapsed_s,
+               (unsigned long long)result.lost_messages, result.wire_bytes / result.elapsed_s);
+
+        if (mode.scheduled && (sample_max > bound_ms || sample_lost > 0 || control_lost > 0)) {
+            fprintf(stderr, "%s: sample frames exceed the latency bound or frames were lost\n", mode.name.c_str());
+            passed = false;
+        }
+    }
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,684 @@
+/**
+ * @file phyto_warm_restart_sim.cpp
+ * @brief Resets a simulated node in the middle of its stream and checks what the warm restart recovers.
+ *
+ * @details
+ * The node's `FrameSink`, `FrameDispatcher`, `RawFrameBuilder` and
+ * `RetainedState` run against the UART model of `phyto_tx_sched_sim`: a TX
+ * buffer of the size of the Mbed driver's, drained at the link rate. The
+ * `RetainedArea` is a static object that outlives the simulated node. At
+ * random times the node is reset: pool, sink, builder and the bytes in the
+ * TX buffer are lost, and a new node boots as `main` does with
+ * `WARM_RESTART`: it recovers the area, sends the resync zeros, resends the
+ * recovered frames and continues the sequence numbers. The first boot finds
+ * random RAM, like after power-up.
+ *
+ * Every sample frame carries samples derived from its sequence number, and
+ * every byte leaving the wire goes through a `StreamDecoder`. The run fails
+ * unless every built frame ends up exactly one of: decoded intact, dropped by
+ * the sink's backpressure policy, or written to the TX buffer but not on the
+ * wire when a reset hit (the documented loss). A frame whose samples do not
+ * match its sequence number is only accepted once per reset, while the
+ * resync zeros arrive: the frame the reset cut off, completed by zeros.
+ *
+ * Three further checks run on the area alone:
+ * - Power loss: random RAM must always give a cold boot.
+ * - Bit flips: after 1 to 3 flipped bits anywhere in an area with pending
+ *   records, `recover` may drop records but must never return a frame that
+ *   was not appended.
+ * - The host time of `recover` over a full ring.
+ *
+ * Finally the time from reset to the first conversion word is compared for
+ * cold and warm boots with a model of the AD7124 in continuous read mode:
+ * a cold boot programs the registers and waits for the first conversion, a
+ * warm boot reads the word converted while the node was booting.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "config/PipelineConfig.h"
+#include "serial_mail_sender/FrameFormat.h"
+#include "serial_mail_sender/RawFrameBuilder.h"
+#include "storage/RetainedState.h"
+#include "stream_decoder/StreamDecoder.h"
+#include "transport/FrameBuffer.h"
+#include "transport/FrameDispatcher.h"
+#include "transport/FrameSink.h"
+
+/// Simulated time per backpressure policy.
+#define DEFAULT_DURATION_S 600
+
+/// Resets per backpressure policy.
+#define DEFAULT_RESETS 200
+
+/// Simulation step in µs; the wire drains and the clock advances once per step.
+#define DEFAULT_STEP_US 100
+
+/// Bytes per second of the UART, 115200 baud in 8N1.
+#define DEFAULT_LINK_RATE 11520
+
+/// TX buffer of the Mbed serial driver (`drivers.uart-serial-txbuf-size`).
+#define DEFAULT_TX_BUFFER 256
+
+/// Time between two services of the sink while no frame is published (`SINK_SERVICE_PERIOD`).
+#define DEFAULT_SERVICE_PERIOD_US 5000
+
+/// Time from reset until `main`, the same for cold and warm boots.
+#define DEFAULT_BOOT_MS 30
+
+/// Trials of the power loss and bit flip checks.
+#define DEFAULT_TRIALS 20000
+
+/// Calls of `recover` timed over a full ring.
+#define RECOVER_RUNS 20000
+
+/// `WARM_RESTART_RESYNC_SIZE` of pipeline/WarmRestart.h.
+#define RESYNC_SIZE 512
+
+/// SPI bytes `AD7124::init` transfers: reset, status and the read-write-read of every register.
+#define AD7124_INIT_SPI_BYTES 96
+
+/// SPI bytes of one conversion word with the appended status byte.
+#define AD7124_WORD_SPI_BYTES 4
+
+typedef std::chrono::steady_clock Clock;
+
+/**
+ * @brief Reads the time stamp counter where there is one.
+ * @return Counter value, 0 on other architectures.
+ */
+static inline uint64_t read_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @struct SimOptions
+ * @brief Link and traffic parameters.
+ */
+struct SimOptions {
+    double   rate_sps;          ///< Conversions per second and channel.
+    double   link_rate;         ///< Bytes per second the wire drains.
+    size_t   tx_buffer;         ///< Bytes the driver buffers.
+    double   duration_s;        ///< Simulated time per policy.
+    unsigned resets;            ///< Resets per policy.
+    uint32_t step_us;           ///< Simulation step.
+    uint32_t boot_us;           ///< Time from reset until `main`.
+    unsigned trials;            ///< Trials of the area checks.
+    uint64_t seed;              ///< Seed of the random resets, RAM contents and bit flips.
+};
+
+/**
+ * @struct RunResult
+ * @brief Fate of the frames of one run.
+ */
+struct RunResult {
+    uint64_t built;         ///< Sample frames built, i.e. sequence numbers used.
+    uint64_t intact;        ///< Sequence numbers decoded with the right samples at least once.
+    uint64_t cut;           ///< Frames in the TX buffer, not completely on the wire, at a reset.
+    uint64_t dropped;       ///< Frames dropped by the backpressure policy.
+    uint64_t pool_drops;    ///< Mails lost because no frame buffer was free; no sequence number used.
+    uint64_t resent;        ///< Frames recovered and resent after a warm boot.
+    uint64_t damaged;       ///< Decoded copies of cut frames with a zero-filled tail.
+    uint64_t corrupt;       ///< Decoded frames with wrong samples that were not cut.
+    uint64_t unknown;       ///< Decoded sequence numbers that were never built.
+    uint64_t not_retained;  ///< Frames the ring had no room for.
+    unsigned warm_boots;    ///< Boots that found the area intact.
+    unsigned cold_boots;    ///< Boots that formatted the area.
+    bool     ring_empty;    ///< No record pending after the final drain.
+    bool     pool_free;     ///< All frame buffers back in the pool after the final drain.
+};
+
+/// Area that survives the simulated resets, like the node's `.noinit` section.
+static RetainedArea retained_area;
+
+/**
+ * @brief Sample of a frame, derived from its sequence number.
+ * @return 24-bit code.
+ */
+static uint32_t sample_code(uint32_t sequence, size_t channel, size_t index) {
+    uint32_t x = sequence * 0x9E3779B1u + (uint32_t)(channel * 0x10001 + index) * 0x85EBCA77u;
+    x ^= x >> 15;
+    x *= 0x2C1B3C6Du;
+    x ^= x >> 12;
+    return x & 0xFFFFFF;
+}
+
+static uint32_t read_le32(const uint8_t* data) {
+    return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+/**
+ * @class SimUart
+ * @brief Sink that writes into a bounded TX buffer drained at the link rate.
+ *
+ * It also splits the bytes written into frames, to know at a reset which
+ * frames had left the sink but not yet the wire.
+ */
+class SimUart : public FrameSink {
+public:
+    SimUart(BackpressurePolicy policy, size_t tx_buffer)
+        : FrameSink("uart", policy), m_capacity(tx_buffer), m_credit(0), m_written(0), m_wired(0) {}
+
+    /**
+     * @brief Moves the bytes the wire carries during one step out of the TX buffer.
+     * @param bytes Bytes the link carries in the step; an idle wire saves no credit.
+     * @param out Receives the bytes that left the wire.
+     */
+    void drain(double bytes, std::vector<uint8_t>& out) {
+        m_credit = m_buffer.empty() ? 0 : m_credit + bytes;
+        size_t count = std::min(m_buffer.size(), (size_t)m_credit);
+        out.assign(m_buffer.begin(), m_buffer.begin() + count);
+        m_buffer.erase(m_buffer.begin(), m_buffer.begin() + count);
+        m_credit -= (double)count;
+        m_wired += count;
+        while (!m_frames.empty() && m_frames.front().end <= m_wired) {
+            m_frames.pop_front();
+        }
+    }
+
+    /// True once the sink queue and the TX buffer are empty.
+    bool idle(void) const { return queued() == 0 && m_buffer.empty(); }
+
+    /**
+     * @brief Sequence numbers of the sample frames a reset now would cut.
+     * @return Frames completely written to the TX buffer but not completely on the wire.
+     */
+    std::vector<uint32_t> inDriver(void) const {
+        std::vector<uint32_t> sequences;
+        for (const WrittenFrame& frame : m_frames) {
+            sequences.push_back(frame.sequence);
+        }
+        return sequences;
+    }
+
+protected:
+    size_t writeSome(const uint8_t* data, size_t size) override {
+        size_t written = std::min(size, m_capacity - m_buffer.size());
+        m_buffer.insert(m_buffer.end(), data, data + written);
+        for (size_t i = 0; i < written; i++) {
+            split(data[i]);
+        }
+        return written;
+    }
+
+private:
+    /**
+     * @struct WrittenFrame
+     * @brief Sample frame in the TX buffer.
+     */
+    struct WrittenFrame {
+        uint64_t end;           ///< Bytes written up to and including the frame.
+        uint32_t sequence;      ///< Sequence number of the frame.
+    };
+
+    size_t                   m_capacity;     ///< Size of the TX buffer.
+    std::deque<uint8_t>      m_buffer;       ///< Bytes waiting for the wire.
+    double                   m_credit;       ///< Part of a byte carried to the next step.
+    uint64_t                 m_written;      ///< Bytes written into the TX buffer.
+    uint64_t                 m_wired;        ///< Bytes that left the wire.
+    std::vector<uint8_t>     m_frame;        ///< Frame being written.
+    std::deque<WrittenFrame> m_frames;       ///< Sample frames written but not yet on the wire.
+
+    void split(uint8_t byte) {
+        m_written++;
+        if (m_frame.empty() && byte == 0) {
+            return;     // Resync zeros
+        }
+        m_frame.push_back(byte);
+        if (m_frame.size() < SERIAL_MAIL_HEADER_SIZE + RAW_FRAME_HEADER_SIZE ||
+            m_frame.size() < SERIAL_MAIL_HEADER_SIZE + read_le32(m_frame.data() + SERIAL_MAIL_SYNC_SIZE)) {
+            return;
+        }
+        const uint8_t* payload = m_frame.data() + SERIAL_MAIL_HEADER_SIZE;
+        if (payload[0] == RAW_FRAME_VERSION) {
+            m_frames.push_back({m_written, read_le32(payload + RAW_FRAME_SEQUENCE_OFFSET)});
+        }
+        m_frame.clear();
+    }
+};
+
+/**
+ * @struct SimNode
+ * @brief Everything a reset of the node loses.
+ */
+struct SimNode {
+    FramePool       pool;           ///< Frame buffers.
+    FrameDispatcher dispatcher;     ///< Hands frames to the UART.
+    SimUart         uart;           ///< UART with its driver buffer.
+    RawFrameBuilder builder;        ///< Serializer with the sequence number.
+    RetainedState   retained;       ///< View of the area that survives.
+
+    SimNode(BackpressurePolicy policy, size_t tx_buffer) : uart(policy, tx_buffer), retained(retained_area) {}
+};
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  -r <sps>      conversions per second and channel (default: preset rate)\n"
+        "  -l <B/s>      link rate (default %d)\n"
+        "  -b <bytes>    TX buffer of the driver (default %d)\n"
+        "  -t <s>        simulated time per policy (default %d)\n"
+        "  -n <resets>   resets per policy (default %d)\n"
+        "  -B <ms>       time from reset until main (default %d)\n"
+        "  -f <trials>   power loss and bit flip trials (default %d)\n"
+        "  -s <seed>     random seed (default 1)\n",
+        program, DEFAULT_LINK_RATE, DEFAULT_TX_BUFFER, DEFAULT_DURATION_S, DEFAULT_RESETS, DEFAULT_BOOT_MS,
+        DEFAULT_TRIALS);
+}
+
+static void fill_random(void* data, size_t size, std::mt19937_64& rng) {
+    uint8_t* bytes = static_cast<uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        bytes[i] = (uint8_t)rng();
+    }
+}
+
+/**
+ * @brief Streams sample frames over the UART model and resets the node at random times.
+ */
+static RunResult simulate(BackpressurePolicy policy, const SimOptions& options, std::mt19937_64& rng) {
+    RunResult result{};
+    std::vector<uint8_t> intact;                // Per sequence number: decoded with the right samples
+    std::unordered_set<uint32_t> cut;
+    size_t resync_left = 0;                     // Resync zeros not yet decoded since the last reset
+    bool damaged = false;                       // The damaged copy after the last reset was decoded
+
+    // Power-up: the RAM holds whatever it powered up with
+    fill_random(&retained_area, sizeof(retained_area), rng);
+
+    std::vector<uint64_t> resets_us;
+    std::uniform_real_distribution<double> reset_time(0, options.duration_s * 1e6);
+    for (unsigned i = 0; i < options.resets; i++) {
+        resets_us.push_back((uint64_t)reset_time(rng));
+    }
+    std::sort(resets_us.begin(), resets_us.end());
+
+    StreamDecoder decoder([&](const DecodedFrame& frame) {
+        if (frame.version != RAW_FRAME_VERSION) {
+            return;
+        }
+        bool match = frame.ch0.size() == PhytoConfig::vector_size && frame.ch1.size() == PhytoConfig::vector_size;
+        for (size_t i = 0; match && i < frame.ch0.size(); i++) {
+            match = raw_code(frame.ch0[i]) == sample_code(frame.sequence, 0, i) &&
+                    raw_code(frame.ch1[i]) == sample_code(frame.sequence, 1, i);
+        }
+        if (match && frame.sequence < result.built) {
+            intact[frame.sequence] = 1;
+        } else if (resync_left > 0 && !damaged) {
+            // The frame cut by the reset, completed by the resync zeros
+            result.damaged++;
+            damaged = true;
+        } else if (frame.sequence >= result.built) {
+            result.unknown++;
+        } else {
+            result.corrupt++;
+        }
+    });
+
+    const uint64_t frame_period_us = (uint64_t)(PhytoConfig::vector_size * 1e6 / options.rate_sps);
+    const double bytes_per_step = options.link_rate * options.step_us / 1e6;
+    uint64_t now_us = 0;
+    uint64_t next_frame_us = 0;
+    uint64_t next_service_us = 0;
+    size_t next_reset = 0;
+    std::vector<uint8_t> wire;
+    std::unique_ptr<SimNode> node;
+
+    auto step = [&]() {
+        node->uart.drain(bytes_per_step, wire);
+        decoder.feed(wire);
+        resync_left -= std::min(resync_left, wire.size());
+        now_us += options.step_us;
+    };
+
+    auto boot = [&]() {
+        node = std::make_unique<SimNode>(policy, options.tx_buffer);
+        bool warm = node->retained.recover();
+        (warm ? result.warm_boots : result.cold_boots)++;
+        node->dispatcher.addSink(node->uart);
+        node->builder.setSequence(node->retained.sequence());
+        if (!warm) {
+            node->uart.attachRetained(node->retained);
+            return;
+        }
+
+        // As `retain_uart_frames` in main.cpp
+        static const uint8_t resync[RESYNC_SIZE] = {0};
+        FrameRef zeros = node->pool.allocate();
+        memcpy(zeros.mutableData(), resync, sizeof(resync));
+        zeros.setSize(sizeof(resync));
+        node->dispatcher.publish(zeros, TRAFFIC_CONTROL);
+        node->dispatcher.service();
+        node->uart.attachRetained(node->retained);
+        for (size_t i = node->retained.recovered(); i > 0; i--) {
+            size_t size = 0;
+            const uint8_t* data = node->retained.front(&size);
+            if (data == nullptr) {
+                break;
+            }
+            while (!node->uart.canAccept(TRAFFIC_SAMPLES)) {
+                node->dispatcher.service();
+                step();
+            }
+            FrameRef frame = node->pool.allocate();
+            memcpy(frame.mutableData(), data, size);
+            frame.setSize(size);
+            node->dispatcher.publish(frame, TRAFFIC_SAMPLES);
+            node->dispatcher.service();
+            node->retained.pop();
+            result.resent++;
+        }
+    };
+
+    auto shut_down = [&]() {
+        for (uint32_t sequence : node->uart.inDriver()) {
+            cut.insert(sequence);
+        }
+        result.dropped += node->uart.stats().dropped;
+        result.not_retained += node->retained.stats().full;
+        resync_left = RESYNC_SIZE;
+        damaged = false;
+    };
+
+    boot();
+    while (now_us < (uint64_t)(options.duration_s * 1e6)) {
+        if (next_reset < resets_us.size() && now_us >= resets_us[next_reset]) {
+            next_reset++;
+            shut_down();
+            now_us += options.boot_us;
+            boot();
+            next_frame_us = std::max(next_frame_us, now_us);
+        }
+
+        if (now_us >= next_frame_us) {
+            // As `SerialMailSender::sendMail`
+            FrameRef frame = node->pool.allocate();
+            if (!frame) {
+                node->dispatcher.service();
+                frame = node->pool.allocate();
+            }
+            if (frame) {
+                uint32_t sequence = node->builder.sequence();
+                SampleVector ch0(PhytoConfig::vector_size);
+                SampleVector ch1(PhytoConfig::vector_size);
+                for (size_t i = 0; i < PhytoConfig::vector_size; i++) {
+                    ch0[i] = (int32_t)sample_code(sequence, 0, i) - SAMPLE_ZERO_CODE;
+                    ch1[i] = (int32_t)sample_code(sequence, 1, i) - SAMPLE_ZERO_CODE;
+                }
+                frame.setSize(node->builder.build(ch0, ch1, PhytoConfig::node, frame.mutableData(),
+                                                  FRAME_BUFFER_CAPACITY));
+                result.built = node->builder.sequence();
+                intact.resize(result.built, 0);
+                node->dispatcher.publish(frame, TRAFFIC_SAMPLES);
+                node->retained.setSequence(node->builder.sequence());
+            } else {
+                result.pool_drops++;
+            }
+            node->dispatcher.service();
+            next_frame_us += frame_period_us;
+        } else if (now_us >= next_service_us) {
+            node->dispatcher.service();
+            next_service_us = now_us + DEFAULT_SERVICE_PERIOD_US;
+        }
+        step();
+    }
+
+    while (!node->uart.idle()) {
+        node->dispatcher.service();
+        step();
+    }
+    shut_down();
+
+    size_t size = 0;
+    result.ring_empty = node->retained.front(&size) == nullptr;
+    result.pool_free = node->pool.available() == FRAME_POOL_SIZE;
+    result.intact = std::count(intact.begin(), intact.end(), 1);
+    result.cut = cut.size();
+    return result;
+}
+
+/**
+ * @brief Fills the area with pending and released records of random size.
+ * @param appended Receives every payload appended.
+ */
+static void fill_records(std::mt19937_64& rng, std::vector<std::vector<uint8_t>>& appended) {
+    RetainedState state(retained_area);
+    state.format();
+    std::vector<uint32_t> pending;
+    std::uniform_int_distribution<size_t> length(16, RETAINED_MAX_RECORD_SIZE);
+    while (true) {
+        std::vector<uint8_t> payload(length(rng));
+        fill_random(payload.data(), payload.size(), rng);
+        uint32_t handle = state.append(payload.data(), payload.size());
+        if (handle == 0) {
+            break;
+        }
+        appended.push_back(payload);
+        pending.push_back(handle);
+        if (pending.size() > 2 && rng() % 2 == 0) {
+            size_t victim = rng() % pending.size();
+            state.release(pending[victim]);
+            pending.erase(pending.begin() + victim);
+        }
+    }
+    state.setSequence(12345);
+}
+
+/**
+ * @brief Recovers areas with random bits flipped.
+ * @return False if a recovered record was never appended.
+ */
+static bool check_bit_flips(const SimOptions& options, std::mt19937_64& rng) {
+    std::vector<std::vector<uint8_t>> appended;
+    fill_records(rng, appended);
+    auto snapshot = std::make_unique<RetainedArea>(retained_area);
+
+    size_t pending = 0;
+    {
+        RetainedState state(retained_area);
+        state.recover();
+        pending = state.recovered();
+    }
+
+    unsigned cold = 0;
+    unsigned shortened = 0;
+    unsigned foreign = 0;
+    for (unsigned trial = 0; trial < options.trials; trial++) {
+        retained_area = *snapshot;
+        unsigned flips = 1 + (unsigned)(rng() % 3);
+        for (unsigned i = 0; i < flips; i++) {
+            size_t bit = rng() % (sizeof(RetainedArea) * 8);
+            reinterpret_cast<uint8_t*>(&retained_area)[bit / 8] ^= (uint8_t)(1u << (bit % 8));
+        }
+
+        RetainedState state(retained_area);
+        if (!state.recover()) {
+            cold++;
+            continue;
+        }
+        if (state.recovered() < pending) {
+            shortened++;
+        }
+        size_t size = 0;
+        while (const uint8_t* data = state.front(&size)) {
+            bool known = std::any_of(appended.begin(), appended.end(), [&](const std::vector<uint8_t>& payload) {
+                return payload.size() == size && memcmp(payload.data(), data, size) == 0;
+            });
+            foreign += known ? 0 : 1;
+            state.pop();
+        }
+    }
+    printf("bit flips:  %u trials on %zu pending records, %u cold boots, %u with records dropped, "
+           "%u foreign records\n",
+           options.trials, pending, cold, shortened, foreign);
+    return foreign == 0;
+}
+
+/**
+ * @brief Recovers areas of random RAM, as after power-up.
+ * @return False if one was taken for a warm restart.
+ */
+static bool check_power_loss(const SimOptions& options, std::mt19937_64& rng) {
+    unsigned warm = 0;
+    for (unsigned trial = 0; trial < options.trials; trial++) {
+        fill_random(&retained_area, sizeof(retained_area), rng);
+        RetainedState state(retained_area);
+        size_t size = 0;
+        if (state.recover() || state.front(&size) != nullptr) {
+            warm++;
+        }
+    }
+    printf("power loss: %u trials of random RAM, %u warm boots\n", options.trials, warm);
+    return warm == 0;
+}
+
+/**
+ * @brief Times `recover` over a ring of pending records of the largest size.
+ */
+static void measure_recover(void) {
+    RetainedState state(retained_area);
+    state.format();
+    std::vector<uint8_t> payload(RETAINED_MAX_RECORD_SIZE, 0x5A);
+    while (state.append(payload.data(), payload.size()) != 0) {
+    }
+
+    size_t records = 0;
+    auto start = Clock::now();
+    uint64_t start_cycles = read_cycles();
+    for (int i = 0; i < RECOVER_RUNS; i++) {
+        state.recover();
+        records += state.recovered();
+    }
+    uint64_t cycles = read_cycles() - start_cycles;
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    printf("recover:    %zu records of %d B: %.0f ns, %.0f cycles per call on this host\n",
+           records / RECOVER_RUNS, RETAINED_MAX_RECORD_SIZE, ns / RECOVER_RUNS, (double)cycles / RECOVER_RUNS);
+}
+
+/**
+ * @brief Models the time from reset until the first conversion word.
+ *
+ * @details
+ * The conversions run on while the node boots; a reset hits at a random
+ * phase of the conversion period. A cold boot transfers the register
+ * writes of `AD7124::init`, after which the first conversion takes a full
+ * period. A warm boot reads the word converted meanwhile, or waits for
+ * the next one if the boot was shorter than the rest of the period.
+ */
+static void model_boot_time(const SimOptions& options, std::mt19937_64& rng) {
+    const double word_us = 1e6 / (options.rate_sps * PhytoConfig::channels);
+    const double byte_us = 8e6 / PhytoConfig::spi_frequency;
+    std::uniform_real_distribution<double> phase(0, word_us);
+    double cold_sum = 0;
+    double warm_sum = 0;
+    double warm_max = 0;
+    for (unsigned trial = 0; trial < options.trials; trial++) {
+        double next_word_us = word_us - phase(rng);
+        double warm = std::max((double)options.boot_us, next_word_us) + AD7124_WORD_SPI_BYTES * byte_us;
+        double cold = options.boot_us + AD7124_INIT_SPI_BYTES * byte_us + word_us + AD7124_WORD_SPI_BYTES * byte_us;
+        cold_sum += cold;
+        warm_sum += warm;
+        warm_max = std::max(warm_max, warm);
+    }
+    double cold = cold_sum / options.trials;
+    printf("first word: cold %.2f ms, warm %.2f ms mean / %.2f ms max (boot %.1f ms, %.2f ms per word, model)\n",
+           cold / 1000, warm_sum / options.trials / 1000, warm_max / 1000, options.boot_us / 1000.0, word_us / 1000);
+}
+
+int main(int argc, char** argv) {
+    SimOptions options = {
+        (double)ad7124_rate_sps(PhytoConfig::power_mode, PhytoConfig::channels, PhytoConfig::filter_fs),
+        DEFAULT_LINK_RATE, DEFAULT_TX_BUFFER, DEFAULT_DURATION_S, DEFAULT_RESETS, DEFAULT_STEP_US,
+        DEFAULT_BOOT_MS * 1000, DEFAULT_TRIALS, 1,
+    };
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            print_usage(argv[0]);
+            return 2;
+        }
+        if (arg == "-r") {
+            options.rate_sps = std::stod(argv[++i]);
+        } else if (arg == "-l") {
+            options.link_rate = std::stod(argv[++i]);
+        } else if (arg == "-b") {
+            options.tx_buffer = std::stoul(argv[++i]);
+        } else if (arg == "-t") {
+            options.duration_s = std::stod(argv[++i]);
+        } else if (arg == "-n") {
+            options.resets = (unsigned)std::stoul(argv[++i]);
+        } else if (arg == "-B") {
+            options.boot_us = (uint32_t)(std::stod(argv[++i]) * 1000);
+        } else if (arg == "-f") {
+            options.trials = (unsigned)std::stoul(argv[++i]);
+        } else if (arg == "-s") {
+            options.seed = std::stoull(argv[++i]);
+        } else {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+    if (options.rate_sps <= 0 || options.link_rate <= 0 || options.tx_buffer == 0 || options.duration_s <= 0 ||
+        options.trials == 0) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    std::mt19937_64 rng(options.seed);
+    const size_t sample_frame = SERIAL_MAIL_HEADER_SIZE + raw_frame_payload_size(PhytoConfig::vector_size);
+    printf("%.0f SPS per channel, sample frames of %zu B (%.0f B/s), link %.0f B/s, TX buffer %zu B, "
+           "%u resets in %.0f s\n\n",
+           options.rate_sps, sample_frame, sample_frame * options.rate_sps / PhytoConfig::vector_size,
+           options.link_rate, options.tx_buffer, options.resets, options.duration_s);
+    printf("%-12s %8s %8s %8s %8s %8s %8s %8s %8s %8s\n", "policy", "built", "intact", "dropped", "cut", "resent",
+           "damaged", "corrupt", "unknown", "missing");
+
+    bool passed = true;
+    const struct {
+        const char* name;
+        BackpressurePolicy policy;
+    } policies[] = {{"drop-oldest", BACKPRESSURE_DROP_OLDEST}, {"drop-newest", BACKPRESSURE_DROP_NEWEST}};
+    for (const auto& entry : policies) {
+        RunResult result = simulate(entry.policy, options, rng);
+        int64_t missing = (int64_t)result.built - (int64_t)(result.intact + result.dropped + result.cut);
+        printf("%-12s %8llu %8llu %8llu %8llu %8llu %8llu %8llu %8llu %8lld\n", entry.name,
+               (unsigned long long)result.built, (unsigned long long)result.intact,
+               (unsigned long long)result.dropped, (unsigned long long)result.cut, (unsigned long long)result.resent,
+               (unsigned long long)result.damaged, (unsigned long long)result.corrupt,
+               (unsigned long long)result.unknown, (long long)missing);
+
+        if (missing != 0 || result.corrupt > 0 || result.unknown > 0 || result.not_retained > 0 ||
+            result.cold_boots != 1 || !result.ring_empty || !result.pool_free) {
+            fprintf(stderr, "%s: frames lost or damaged beyond the TX buffer, %llu not retained, %u cold boots, "
+                    "ring %s, pool %s\n", entry.name, (unsigned long long)result.not_retained, result.cold_boots,
+                    result.ring_empty ? "empty" : "not empty", result.pool_free ? "free" : "leaked");
+            passed = false;
+        }
+    }
+    printf("\n");
+
+    passed &= check_power_loss(options, rng);
+    passed &= check_bit_flips(options, rng);
+    measure_recover();
+    model_boot_time(options, rng);
+    return passed ? 0 : 1;
+}
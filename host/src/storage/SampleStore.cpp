@@ -0,0 +1,421 @@
+/**
+ * @file SampleStore.cpp
+ * @brief Implementation of the SampleStoreWriter and SampleStoreReader classes.
+ */
+
+#include "storage/SampleStore.h"
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+/// Payload widths of the delta-of-delta code, selected by 0 to 4 leading one bits.
+static constexpr unsigned int time_code_widths[5] = {0, 8, 14, 22, 64};
+
+/// Bits holding the width of a value group.
+static constexpr unsigned int group_width_bits = 6;
+
+static constexpr uint64_t zigzag(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static constexpr int64_t unzigzag(uint64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+static constexpr uint64_t low_bits(unsigned int width) {
+    return width >= 64 ? UINT64_MAX : ((uint64_t)1 << width) - 1;
+}
+
+/**
+ * @class BitWriter
+ * @brief Appends bit fields to a byte buffer, least significant bit first.
+ */
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<uint8_t>& out) : m_out(out), m_bits(0), m_count(0) {
+        m_out.clear();
+    }
+
+    /// Appends the low `width` bits of `value`.
+    void put(uint64_t value, unsigned int width) {
+        if (width > 32) {
+            put(value & UINT32_MAX, 32);
+            value >>= 32;
+            width -= 32;
+        }
+        m_bits |= (value & low_bits(width)) << m_count;
+        m_count += width;
+        while (m_count >= 8) {
+            m_out.push_back((uint8_t)m_bits);
+            m_bits >>= 8;
+            m_count -= 8;
+        }
+    }
+
+    /// Writes out the last partial byte.
+    void finish(void) {
+        if (m_count > 0) {
+            m_out.push_back((uint8_t)m_bits);
+        }
+        m_bits = 0;
+        m_count = 0;
+    }
+
+private:
+    std::vector<uint8_t>& m_out;
+    uint64_t              m_bits;   ///< Bits not yet written, fewer than 8 between calls.
+    unsigned int          m_count;
+};
+
+/**
+ * @class BitReader
+ * @brief Reads the bit fields written by `BitWriter` from a column.
+ *
+ * Reads past the end return zero bits; `overrun` tells afterwards.
+ */
+class BitReader {
+public:
+    explicit BitReader(std::span<const uint8_t> data) : m_data(data), m_position(0) {}
+
+    /// Returns the next `width` bits, up to 32, without consuming them.
+    uint64_t peek(unsigned int width) const {
+        size_t byte = m_position >> 3;
+        uint64_t word = 0;
+        if (byte + sizeof(word) <= m_data.size()) {
+            memcpy(&word, m_data.data() + byte, sizeof(word));
+        } else {
+            for (size_t i = 0; byte + i < m_data.size(); i++) {
+                word |= (uint64_t)m_data[byte + i] << (8 * i);
+            }
+        }
+        return (word >> (m_position & 7)) & low_bits(width);
+    }
+
+    void skip(unsigned int width) { m_position += width; }
+
+    /// Consumes and returns the next `width` bits, up to 64.
+    uint64_t get(unsigned int width) {
+        if (width > 32) {
+            uint64_t low = get(32);
+            return low | (get(width - 32) << 32);
+        }
+        uint64_t value = peek(width);
+        m_position += width;
+        return value;
+    }
+
+    bool overrun(void) const { return m_position > m_data.size() * 8; }
+
+private:
+    std::span<const uint8_t> m_data;
+    size_t                   m_position;    ///< Next bit.
+};
+
+/**
+ * @brief Writes the times after the first as delta-of-delta codes.
+ *
+ * @details
+ * A code is 0 to 4 one bits, a terminating zero bit for fewer than 4, and
+ * the zigzag-coded delta-of-delta at the width the ones select. Samples
+ * within a frame are evenly spaced and cost one bit; the receive jitter
+ * between frames mostly fits into 14 or 22 bits.
+ */
+static void encode_times(std::span<const uint64_t> times, std::vector<uint8_t>& out) {
+    BitWriter writer(out);
+    int64_t previous_delta = 0;
+    for (size_t i = 1; i < times.size(); i++) {
+        int64_t delta = (int64_t)(times[i] - times[i - 1]);
+        uint64_t code = zigzag(delta - previous_delta);
+        previous_delta = delta;
+
+        unsigned int selector = 0;
+        while (selector < 4 && code > low_bits(time_code_widths[selector])) {
+            selector++;
+        }
+        writer.put(low_bits(selector), selector < 4 ? selector + 1 : selector);
+        writer.put(code, time_code_widths[selector]);
+    }
+    writer.finish();
+}
+
+static void decode_times(std::span<const uint8_t> column, uint64_t first_time_us, uint64_t* times, size_t count) {
+    BitReader reader(column);
+    int64_t delta = 0;
+    times[0] = first_time_us;
+    for (size_t i = 1; i < count; i++) {
+        unsigned int selector = (unsigned int)std::countr_one(reader.peek(4));
+        reader.skip(selector < 4 ? selector + 1 : selector);
+        delta += unzigzag(reader.get(time_code_widths[selector]));
+        times[i] = times[i - 1] + (uint64_t)delta;
+    }
+    if (reader.overrun()) {
+        throw std::runtime_error("sample store: truncated time column");
+    }
+}
+
+/**
+ * @brief Writes the zigzag-coded deltas of the samples in bit-packed groups.
+ *
+ * @details
+ * Every group of `SAMPLE_STORE_GROUP_SIZE` deltas starts with its width in
+ * `group_width_bits` bits. The first delta is taken from zero. Deltas of
+ * 32-bit samples need up to 33 bits.
+ */
+static void encode_values(std::span<const int32_t> values, std::vector<uint8_t>& out) {
+    BitWriter writer(out);
+    uint64_t codes[SAMPLE_STORE_GROUP_SIZE];
+    int64_t previous = 0;
+    for (size_t start = 0; start < values.size(); start += SAMPLE_STORE_GROUP_SIZE) {
+        size_t count = std::min<size_t>(SAMPLE_STORE_GROUP_SIZE, values.size() - start);
+        uint64_t all = 0;
+        for (size_t i = 0; i < count; i++) {
+            codes[i] = zigzag((int64_t)values[start + i] - previous);
+            previous = values[start + i];
+            all |= codes[i];
+        }
+        unsigned int width = (unsigned int)std::bit_width(all);
+        writer.put(width, group_width_bits);
+        for (size_t i = 0; i < count; i++) {
+            writer.put(codes[i], width);
+        }
+    }
+    writer.finish();
+}
+
+static void decode_values(std::span<const uint8_t> column, int32_t* values, size_t count) {
+    BitReader reader(column);
+    int64_t previous = 0;
+    for (size_t start = 0; start < count; start += SAMPLE_STORE_GROUP_SIZE) {
+        size_t group = std::min<size_t>(SAMPLE_STORE_GROUP_SIZE, count - start);
+        unsigned int width = (unsigned int)reader.get(group_width_bits);
+        for (size_t i = 0; i < group; i++) {
+            previous += unzigzag(reader.get(width));
+            values[start + i] = (int32_t)previous;
+        }
+    }
+    if (reader.overrun()) {
+        throw std::runtime_error("sample store: truncated value column");
+    }
+}
+
+static SampleSeriesKey key_of(const SampleBlockIndexEntry& entry) {
+    return SampleSeriesKey{entry.node, entry.device, entry.channel};
+}
+
+/**
+ * @struct SeriesOrder
+ * @brief Compares index entries with a series for the lookup in the sorted index.
+ */
+struct SeriesOrder {
+    bool operator()(const SampleBlockIndexEntry& entry, const SampleSeriesKey& key) const {
+        return key_of(entry) < key;
+    }
+    bool operator()(const SampleSeriesKey& key, const SampleBlockIndexEntry& entry) const {
+        return key < key_of(entry);
+    }
+};
+
+SampleStoreWriter::SampleStoreWriter(const std::string& path)
+    : m_file(nullptr), m_offset(0), m_samples(0), m_clamped_samples(0) {
+    m_file = fopen(path.c_str(), "wb");
+    if (m_file == nullptr) {
+        throw std::runtime_error("cannot create " + path + ": " + strerror(errno));
+    }
+
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    SampleStoreHeader header;
+    memcpy(header.magic, SAMPLE_STORE_MAGIC, sizeof(header.magic));
+    header.version = SAMPLE_STORE_VERSION;
+    memset(header.reserved, 0, sizeof(header.reserved));
+    header.created_us = std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+    write(&header, sizeof(header));
+}
+
+SampleStoreWriter::~SampleStoreWriter(void) {
+    finalize();
+}
+
+void SampleStoreWriter::write(const void* data, size_t size) {
+    if (fwrite(data, 1, size, m_file) != size) {
+        throw std::runtime_error(std::string("sample store write failed: ") + strerror(errno));
+    }
+    m_offset += size;
+}
+
+void SampleStoreWriter::append(const SampleSeriesKey& key, std::span<const uint64_t> times,
+                               std::span<const int32_t> values) {
+    Series& series = m_series[key];
+    for (size_t i = 0; i < times.size(); i++) {
+        uint64_t time_us = times[i];
+        if (time_us < series.last_time_us) {
+            time_us = series.last_time_us;
+            m_clamped_samples++;
+        }
+        series.times.push_back(time_us);
+        series.values.push_back(values[i]);
+        series.last_time_us = time_us;
+        if (series.times.size() == SAMPLE_STORE_BLOCK_SAMPLES) {
+            flush(key, series);
+        }
+    }
+    m_samples += times.size();
+}
+
+void SampleStoreWriter::appendFrame(const DecodedFrame& frame, uint64_t time_us, uint32_t period_us) {
+    if (frame.version == BAND_FRAME_VERSION) {
+        return;
+    }
+    std::span<const SerialMail::Value> channels[2] = {frame.ch0, frame.ch1};
+    for (uint8_t channel = 0; channel < 2; channel++) {
+        size_t count = channels[channel].size();
+        m_frame_times.resize(count);
+        m_frame_values.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            uint64_t before_last = (uint64_t)(count - 1 - i) * period_us;
+            m_frame_times[i] = time_us > before_last ? time_us - before_last : 0;
+            m_frame_values[i] = node_sample(channels[channel][i]);
+        }
+        append(SampleSeriesKey{frame.node, frame.device, channel}, m_frame_times, m_frame_values);
+    }
+}
+
+void SampleStoreWriter::flush(const SampleSeriesKey& key, Series& series) {
+    if (series.times.empty()) {
+        return;
+    }
+    encode_times(series.times, m_time_column);
+    encode_values(series.values, m_value_column);
+    auto [min_value, max_value] = std::minmax_element(series.values.begin(), series.values.end());
+
+    SampleBlockHeader header = {key.node, key.device, key.channel, 0, (uint32_t)series.times.size(),
+                                (uint32_t)m_time_column.size(), (uint32_t)m_value_column.size(),
+                                series.times.front()};
+    m_index.push_back(SampleBlockIndexEntry{key.node, key.device, key.channel, 0, header.count, m_offset,
+                                            series.times.front(), series.times.back(), *min_value, *max_value});
+    write(&header, sizeof(header));
+    write(m_time_column.data(), m_time_column.size());
+    write(m_value_column.data(), m_value_column.size());
+
+    series.times.clear();
+    series.values.clear();
+}
+
+/**
+ * @details
+ * Blocks are written as series fill up, interleaved; the index is sorted by
+ * series here. A series' blocks keep their order, which is their time order.
+ */
+void SampleStoreWriter::finalize(void) {
+    if (m_file == nullptr) {
+        return;
+    }
+    for (auto& [key, series] : m_series) {
+        flush(key, series);
+    }
+    std::stable_sort(m_index.begin(), m_index.end(), [](const SampleBlockIndexEntry& a,
+                                                        const SampleBlockIndexEntry& b) {
+        return key_of(a) < key_of(b);
+    });
+
+    SampleStoreFooter footer;
+    footer.index_offset = m_offset;
+    footer.index_count = (uint32_t)m_index.size();
+    footer.samples = m_samples;
+    memcpy(footer.magic, SAMPLE_STORE_FOOTER_MAGIC, sizeof(footer.magic));
+    write(m_index.data(), m_index.size() * sizeof(SampleBlockIndexEntry));
+    write(&footer, sizeof(footer));
+
+    FILE* file = m_file;
+    m_file = nullptr;
+    if (fclose(file) != 0) {
+        throw std::runtime_error(std::string("sample store close failed: ") + strerror(errno));
+    }
+}
+
+SampleStoreReader::SampleStoreReader(std::span<const uint8_t> bytes)
+    : m_bytes(bytes), m_samples(0), m_decoded_blocks(0) {
+    SampleStoreHeader header;
+    SampleStoreFooter footer;
+    if (bytes.size() < sizeof(header) + sizeof(footer)) {
+        throw std::runtime_error("sample store: file too short");
+    }
+    memcpy(&header, bytes.data(), sizeof(header));
+    memcpy(&footer, bytes.data() + bytes.size() - sizeof(footer), sizeof(footer));
+    if (memcmp(header.magic, SAMPLE_STORE_MAGIC, sizeof(header.magic)) != 0) {
+        throw std::runtime_error("sample store: bad magic");
+    }
+    if (header.version != SAMPLE_STORE_VERSION) {
+        throw std::runtime_error("sample store: unsupported version " + std::to_string(header.version));
+    }
+    if (memcmp(footer.magic, SAMPLE_STORE_FOOTER_MAGIC, sizeof(footer.magic)) != 0) {
+        throw std::runtime_error("sample store: not finalized");
+    }
+
+    uint64_t index_size = (uint64_t)footer.index_count * sizeof(SampleBlockIndexEntry);
+    if (footer.index_offset < sizeof(header) || footer.index_offset + index_size + sizeof(footer) != bytes.size()) {
+        throw std::runtime_error("sample store: bad index location");
+    }
+    m_index.resize(footer.index_count);
+    memcpy(m_index.data(), bytes.data() + footer.index_offset, index_size);
+    m_bytes = bytes.first(footer.index_offset);
+    m_samples = footer.samples;
+}
+
+std::vector<SampleSeriesKey> SampleStoreReader::series(void) const {
+    std::vector<SampleSeriesKey> keys;
+    for (const SampleBlockIndexEntry& entry : m_index) {
+        if (keys.empty() || keys.back() != key_of(entry)) {
+            keys.push_back(key_of(entry));
+        }
+    }
+    return keys;
+}
+
+void SampleStoreReader::decode(const SampleBlockIndexEntry& entry) {
+    SampleBlockHeader header;
+    if (entry.offset + sizeof(header) > m_bytes.size()) {
+        throw std::runtime_error("sample store: block outside the file");
+    }
+    memcpy(&header, m_bytes.data() + entry.offset, sizeof(header));
+    uint64_t columns = entry.offset + sizeof(header);
+    if (header.count != entry.count || header.count == 0 ||
+        columns + header.time_size + header.value_size > m_bytes.size()) {
+        throw std::runtime_error("sample store: corrupt block at offset " + std::to_string(entry.offset));
+    }
+
+    m_times.resize(header.count);
+    m_values.resize(header.count);
+    decode_times(m_bytes.subspan(columns, header.time_size), header.first_time_us, m_times.data(), header.count);
+    decode_values(m_bytes.subspan(columns + header.time_size, header.value_size), m_values.data(), header.count);
+    m_decoded_blocks++;
+}
+
+/**
+ * @details
+ * The blocks of a series are contiguous in the index and do not overlap in
+ * time, so both ends of the range are found by binary search.
+ */
+uint64_t SampleStoreReader::scan(const SampleSeriesKey& key, uint64_t from_us, uint64_t to_us,
+                                 const BlockHandler& handler) {
+    auto [begin, end] = std::equal_range(m_index.begin(), m_index.end(), key, SeriesOrder());
+    auto first = std::partition_point(begin, end, [from_us](const SampleBlockIndexEntry& entry) {
+        return entry.last_time_us < from_us;
+    });
+
+    uint64_t count = 0;
+    for (auto block = first; block != end && block->first_time_us <= to_us; ++block) {
+        decode(*block);
+        size_t lower = std::lower_bound(m_times.begin(), m_times.end(), from_us) - m_times.begin();
+        size_t upper = std::upper_bound(m_times.begin(), m_times.end(), to_us) - m_times.begin();
+        if (lower < upper) {
+            handler(std::span<const uint64_t>(m_times).subspan(lower, upper - lower),
+                    std::span<const int32_t>(m_values).subspan(lower, upper - lower));
+            count += upper - lower;
+        }
+    }
+    return count;
+}
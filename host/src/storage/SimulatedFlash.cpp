@@ -0,0 +1,79 @@
+/**
+ * @file SimulatedFlash.cpp
+ * @brief Implementation of the SimulatedFlash class.
+ */
+
+#include "storage/SimulatedFlash.h"
+
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+SimulatedFlash::SimulatedFlash(uint32_t size, uint32_t program_size, uint32_t erase_size, const std::string& path)
+    : m_data(size, 0xFF), m_erase_counts(erase_size > 0 ? size / erase_size : 0, 0),
+      m_program_size(program_size), m_erase_size(erase_size), m_path(path), m_busy_time_us(0) {
+
+    if (program_size == 0 || erase_size == 0 || size % erase_size != 0 || erase_size % program_size != 0) {
+        throw std::invalid_argument("inconsistent flash geometry");
+    }
+    if (m_path.empty()) {
+        return;
+    }
+
+    FILE* file = fopen(m_path.c_str(), "rb");
+    if (file != nullptr) {
+        size_t loaded = fread(m_data.data(), 1, m_data.size(), file);
+        fclose(file);
+        if (loaded != m_data.size()) {
+            throw std::runtime_error("backing file " + m_path + " does not match the flash size");
+        }
+    }
+}
+
+SimulatedFlash::~SimulatedFlash(void) {
+    if (m_path.empty()) {
+        return;
+    }
+    FILE* file = fopen(m_path.c_str(), "wb");
+    if (file != nullptr) {
+        fwrite(m_data.data(), 1, m_data.size(), file);
+        fclose(file);
+    }
+}
+
+int SimulatedFlash::read(void* buffer, uint32_t address, uint32_t size) {
+    if ((uint64_t)address + size > m_data.size()) {
+        return -1;
+    }
+    memcpy(buffer, m_data.data() + address, size);
+    return 0;
+}
+
+/**
+ * @brief Programs whole units that must be erased before.
+ */
+int SimulatedFlash::program(const void* buffer, uint32_t address, uint32_t size) {
+    if ((uint64_t)address + size > m_data.size() || address % m_program_size != 0 || size % m_program_size != 0) {
+        return -1;
+    }
+    for (uint32_t i = 0; i < size; i++) {
+        if (m_data[address + i] != 0xFF) {
+            return -1;
+        }
+    }
+    memcpy(m_data.data() + address, buffer, size);
+    m_busy_time_us += (uint64_t)(size / m_program_size) * SIMULATED_FLASH_PROGRAM_TIME_US;
+    return 0;
+}
+
+int SimulatedFlash::erase(uint32_t address, uint32_t size) {
+    if ((uint64_t)address + size > m_data.size() || address % m_erase_size != 0 || size % m_erase_size != 0) {
+        return -1;
+    }
+    memset(m_data.data() + address, 0xFF, size);
+    for (uint32_t sector = address / m_erase_size; sector < (address + size) / m_erase_size; sector++) {
+        m_erase_counts[sector]++;
+        m_busy_time_us += SIMULATED_FLASH_ERASE_TIME_US;
+    }
+    return 0;
+}
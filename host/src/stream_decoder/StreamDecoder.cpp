@@ -0,0 +1,440 @@
+/**
+ * @file StreamDecoder.cpp
+ * @brief Implementation of the StreamDecoder class for the host-side ingest.
+ */
+
+#include "stream_decoder/StreamDecoder.h"
+
+#include <algorithm>
+#include <cstring>
+
+/**
+ * @brief Reads the little-endian length field that follows the sync marker.
+ * @param header Pointer to the first byte of the frame header.
+ * @return Payload size announced by the sender.
+ */
+static uint32_t read_payload_size(const uint8_t* header) {
+    const uint8_t* p = header + SERIAL_MAIL_SYNC_SIZE;
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+ * @brief Returns a span over a vector of `SerialMail::Value` structs.
+ * @param values FlatBuffers vector, may be null if the field was not serialized.
+ * @return Span over the packed 3-byte structs.
+ */
+static std::span<const SerialMail::Value> as_span(const flatbuffers::Vector<const SerialMail::Value*>* values) {
+    if (values == nullptr) {
+        return {};
+    }
+    // Struct vectors are stored inline and Value is byte aligned, so the raw data is the array.
+    return {reinterpret_cast<const SerialMail::Value*>(values->Data()), values->size()};
+}
+
+StreamDecoder::StreamDecoder(FrameHandler handler, uint32_t max_payload_size)
+    : m_handler(std::move(handler)), m_max_payload_size(max_payload_size), m_stats{0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+      m_next_sequence(0), m_sequence_known(false), m_latency{}, m_latency_next(0) {
+    m_pending.reserve(SERIAL_MAIL_HEADER_SIZE + m_max_payload_size);
+}
+
+void StreamDecoder::reset(void) {
+    m_pending.clear();
+    m_stats = DecoderStats{0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    m_sequence_known = false;
+    m_latency_next = 0;
+    m_messages.clear();
+}
+
+void StreamDecoder::discardPending(void) {
+    m_stats.skipped_bytes += m_pending.size();
+    m_pending.clear();
+}
+
+/**
+ * @brief Feeds a chunk of the byte stream.
+ *
+ * @details
+ * While a frame is pending from a previous chunk, only as many bytes as that
+ * frame still needs are appended to the carry-over buffer and scanned there.
+ * As soon as the carry-over buffer is empty the remainder of the chunk is
+ * scanned in place, and only its unfinished tail is copied.
+ */
+void StreamDecoder::feed(std::span<const uint8_t> chunk) {
+    m_stats.bytes += chunk.size();
+
+    while (!m_pending.empty() && !chunk.empty()) {
+        size_t needed = bytesNeededForPending();
+        size_t missing = (needed > m_pending.size()) ? needed - m_pending.size() : 0;
+        size_t take = std::min(missing, chunk.size());
+        m_pending.insert(m_pending.end(), chunk.begin(), chunk.begin() + take);
+        chunk = chunk.subspan(take);
+
+        if (m_pending.size() < needed) {
+            return; // Chunk exhausted, wait for more data
+        }
+
+        size_t consumed = scan(m_pending);
+        m_pending.erase(m_pending.begin(), m_pending.begin() + consumed);
+    }
+
+    if (chunk.empty()) {
+        return;
+    }
+
+    size_t consumed = scan(chunk);
+    m_pending.assign(chunk.begin() + consumed, chunk.end());
+}
+
+/**
+ * @brief Computes how many bytes the carry-over buffer must hold before it can be scanned.
+ * @return Header size while the length is unknown, otherwise header plus payload size.
+ *
+ * @details
+ * A length outside the accepted range only needs the header; `scan` rejects it.
+ */
+size_t StreamDecoder::bytesNeededForPending(void) const {
+    if (m_pending.size() < SERIAL_MAIL_HEADER_SIZE) {
+        return SERIAL_MAIL_HEADER_SIZE;
+    }
+    uint32_t size = read_payload_size(m_pending.data());
+    if (size < SERIAL_MAIL_MIN_PAYLOAD_SIZE || size > m_max_payload_size) {
+        return SERIAL_MAIL_HEADER_SIZE;
+    }
+    return SERIAL_MAIL_HEADER_SIZE + size;
+}
+
+/**
+ * @brief Scans a contiguous buffer for complete frames.
+ * @param data Bytes to scan.
+ * @return Number of leading bytes that were fully processed.
+ *
+ * @details
+ * Scanning stops at the first candidate frame that is not complete yet; the
+ * bytes from that sync marker onwards are left for the caller to keep. A
+ * trailing single `0xAA` is kept as well, since it may be the first half of
+ * a marker split across chunks.
+ */
+size_t StreamDecoder::scan(std::span<const uint8_t> data) {
+    const uint8_t* base = data.data();
+    const size_t size = data.size();
+    size_t pos = 0;
+
+    while (pos < size) {
+        const uint8_t* hit = static_cast<const uint8_t*>(memchr(base + pos, SERIAL_MAIL_SYNC_BYTE, size - pos));
+        if (hit == nullptr) {
+            m_stats.skipped_bytes += size - pos;
+            return size;
+        }
+
+        size_t start = hit - base;
+        if (start + 1 == size) {
+            m_stats.skipped_bytes += start - pos;
+            return start;
+        }
+        if (base[start + 1] != SERIAL_MAIL_SYNC_BYTE) {
+            m_stats.skipped_bytes += start + 1 - pos;
+            pos = start + 1;
+            continue;
+        }
+
+        m_stats.skipped_bytes += start - pos;
+        pos = start;
+
+        if (size - start < SERIAL_MAIL_HEADER_SIZE) {
+            return start;
+        }
+
+        uint32_t payload_size = read_payload_size(base + start);
+        if (payload_size < SERIAL_MAIL_MIN_PAYLOAD_SIZE || payload_size > m_max_payload_size) {
+            m_stats.rejected_frames++;
+            m_stats.skipped_bytes++;
+            pos = start + 1;
+            continue;
+        }
+
+        if (size - start < SERIAL_MAIL_HEADER_SIZE + payload_size) {
+            return start;
+        }
+
+        if (deliver(data.subspan(start, SERIAL_MAIL_HEADER_SIZE + payload_size))) {
+            pos = start + SERIAL_MAIL_HEADER_SIZE + payload_size;
+        } else {
+            m_stats.rejected_frames++;
+            m_stats.skipped_bytes++;
+            pos = start + 1;
+        }
+    }
+
+    return size;
+}
+
+/**
+ * @brief Verifies a candidate frame and hands it to the frame handler.
+ * @param frame Frame header followed by the payload bytes.
+ * @return True if the payload is a valid `SerialMail` buffer or raw frame.
+ */
+bool StreamDecoder::deliver(std::span<const uint8_t> frame) {
+    std::span<const uint8_t> payload = frame.subspan(SERIAL_MAIL_HEADER_SIZE);
+    if (is_raw_frame_payload(payload[0])) {
+        return deliverRaw(frame);
+    }
+
+    flatbuffers::Verifier verifier(payload.data(), payload.size());
+    if (!SerialMail::VerifySerialMailBuffer(verifier)) {
+        return false;
+    }
+
+    const SerialMail::SerialMail* mail = SerialMail::GetSerialMail(payload.data());
+    DecodedFrame decoded{mail->node(), as_span(mail->ch0()), as_span(mail->ch1()), payload, frame, 0, 0, {}, 0,
+                         mail->device(), 0};
+
+    m_stats.frames++;
+    m_stats.samples += decoded.ch0.size() + decoded.ch1.size();
+
+    if (m_handler) {
+        m_handler(decoded);
+    }
+    return true;
+}
+
+/**
+ * @brief Checks a raw frame and hands it to the frame handler.
+ * @param frame Frame header followed by the raw payload.
+ * @return True if the version is known and the size matches mask and count.
+ *
+ * @details
+ * A jump in the sequence number is counted as missed frames; a sequence
+ * number that goes backwards, e.g. after a node reset, just restarts counting.
+ * The channel mask must hold the channels of a single device. Timed raw
+ * frames differ only by the time field in front of the samples.
+ */
+bool StreamDecoder::deliverRaw(std::span<const uint8_t> frame) {
+    std::span<const uint8_t> payload = frame.subspan(SERIAL_MAIL_HEADER_SIZE);
+    if (payload[0] == BAND_FRAME_VERSION) {
+        return deliverBands(frame);
+    }
+    if (payload[0] == SYNC_RESPONSE_VERSION) {
+        return deliverSync(frame);
+    }
+    if (payload[0] == LATENCY_FRAME_VERSION) {
+        return deliverLatency(frame);
+    }
+    if (payload[0] == MESSAGE_FRAME_VERSION) {
+        return deliverMessage(frame);
+    }
+    uint8_t version = payload[0];
+    size_t header_size = (version == RAW_FRAME_TIMED_VERSION) ? RAW_FRAME_TIMED_HEADER_SIZE : RAW_FRAME_HEADER_SIZE;
+    if (payload.size() < header_size || (version != RAW_FRAME_VERSION && version != RAW_FRAME_TIMED_VERSION)) {
+        return false;
+    }
+
+    const uint8_t* header = payload.data();
+    uint8_t mask = header[RAW_FRAME_MASK_OFFSET];
+    unsigned int device = 0;
+    while (mask != 0 && device + 1 < RAW_FRAME_MAX_DEVICES && (mask & raw_frame_device_mask(device)) == 0) {
+        device++;
+    }
+    mask >>= 2 * device;
+    size_t count = (size_t)header[RAW_FRAME_COUNT_OFFSET] | ((size_t)header[RAW_FRAME_COUNT_OFFSET + 1] << 8);
+    size_t channels = ((mask & RAW_FRAME_CHANNEL_0) ? 1 : 0) + ((mask & RAW_FRAME_CHANNEL_1) ? 1 : 0);
+    if ((mask & ~(RAW_FRAME_CHANNEL_0 | RAW_FRAME_CHANNEL_1)) != 0 ||
+        payload.size() != header_size + channels * RAW_FRAME_SAMPLE_SIZE * count) {
+        return false;
+    }
+
+    uint64_t time_us = 0;
+    if (version == RAW_FRAME_TIMED_VERSION) {
+        for (size_t i = 0; i < sizeof(time_us); i++) {
+            time_us |= (uint64_t)header[RAW_FRAME_TIME_OFFSET + i] << (8 * i);
+        }
+    }
+
+    int32_t node = (int32_t)header[RAW_FRAME_NODE_OFFSET] | ((int32_t)header[RAW_FRAME_NODE_OFFSET + 1] << 8);
+    uint32_t sequence = (uint32_t)header[RAW_FRAME_SEQUENCE_OFFSET] |
+                        ((uint32_t)header[RAW_FRAME_SEQUENCE_OFFSET + 1] << 8) |
+                        ((uint32_t)header[RAW_FRAME_SEQUENCE_OFFSET + 2] << 16) |
+                        ((uint32_t)header[RAW_FRAME_SEQUENCE_OFFSET + 3] << 24);
+
+    const SerialMail::Value* samples = reinterpret_cast<const SerialMail::Value*>(header + header_size);
+    std::span<const SerialMail::Value> ch0;
+    std::span<const SerialMail::Value> ch1;
+    if (mask & RAW_FRAME_CHANNEL_0) {
+        ch0 = {samples, count};
+        samples += count;
+    }
+    if (mask & RAW_FRAME_CHANNEL_1) {
+        ch1 = {samples, count};
+    }
+
+    if (m_sequence_known && sequence > m_next_sequence) {
+        m_stats.missed_frames += sequence - m_next_sequence;
+    }
+    m_next_sequence = sequence + 1;
+    m_sequence_known = true;
+
+    DecodedFrame decoded{node, ch0, ch1, payload, frame, version, sequence, {}, 0, (uint8_t)device, time_us};
+
+    m_stats.frames++;
+    m_stats.raw_frames++;
+    m_stats.samples += decoded.ch0.size() + decoded.ch1.size();
+
+    if (m_handler) {
+        m_handler(decoded);
+    }
+    return true;
+}
+
+/**
+ * @brief Checks a band power frame and hands it to the frame handler.
+ * @param frame Frame header followed by the band power payload.
+ * @return True if the size matches mask and band count.
+ *
+ * @details
+ * The little-endian floats are copied into `m_bands`, as they are not
+ * aligned inside the stream. Window indices are not checked for gaps.
+ */
+bool StreamDecoder::deliverBands(std::span<const uint8_t> frame) {
+    std::span<const uint8_t> payload = frame.subspan(SERIAL_MAIL_HEADER_SIZE);
+    if (payload.size() < RAW_FRAME_HEADER_SIZE) {
+        return false;
+    }
+
+    const uint8_t* header = payload.data();
+    uint8_t mask = header[RAW_FRAME_MASK_OFFSET];
+    size_t count = (size_t)header[RAW_FRAME_COUNT_OFFSET] | ((size_t)header[RAW_FRAME_COUNT_OFFSET + 1] << 8);
+    size_t channels = ((mask & RAW_FRAME_CHANNEL_0) ? 1 : 0) + ((mask & RAW_FRAME_CHANNEL_1) ? 1 : 0);
+    if ((mask & ~(RAW_FRAME_CHANNEL_0 | RAW_FRAME_CHANNEL_1)) != 0 ||
+        payload.size() != band_frame_payload_size(count, channels)) {
+        return false;
+    }
+
+    int32_t node = (int32_t)header[RAW_FRAME_NODE_OFFSET] | ((int32_t)header[RAW_FRAME_NODE_OFFSET + 1] << 8);
+    uint32_t window = (uint32_t)header[RAW_FRAME_SEQUENCE_OFFSET] |
+                      ((uint32_t)header[RAW_FRAME_SEQUENCE_OFFSET + 1] << 8) |
+                      ((uint32_t)header[RAW_FRAME_SEQUENCE_OFFSET + 2] << 16) |
+                      ((uint32_t)header[RAW_FRAME_SEQUENCE_OFFSET + 3] << 24);
+
+    const uint8_t* values = header + RAW_FRAME_HEADER_SIZE;
+    m_bands.resize(count * channels);
+    for (float& band : m_bands) {
+        uint32_t bits = (uint32_t)values[0] | ((uint32_t)values[1] << 8) | ((uint32_t)values[2] << 16) |
+                        ((uint32_t)values[3] << 24);
+        memcpy(&band, &bits, sizeof(band));
+        values += BAND_FRAME_VALUE_SIZE;
+    }
+
+    DecodedFrame decoded{node, {}, {}, payload, frame, BAND_FRAME_VERSION, window, m_bands,
+                         (uint16_t)count, 0, 0};
+
+    m_stats.frames++;
+    m_stats.band_frames++;
+
+    if (m_handler) {
+        m_handler(decoded);
+    }
+    return true;
+}
+
+/**
+ * @brief Checks a sync response and hands it to the sync handler.
+ * @param frame Frame header followed by the sync response.
+ * @return True if the size matches.
+ */
+bool StreamDecoder::deliverSync(std::span<const uint8_t> frame) {
+    std::span<const uint8_t> payload = frame.subspan(SERIAL_MAIL_HEADER_SIZE);
+    SyncResponse response;
+    if (!read_sync_response(payload.data(), payload.size(), &response)) {
+        return false;
+    }
+
+    m_stats.sync_responses++;
+    if (m_sync_handler) {
+        m_sync_handler(response);
+    }
+    return true;
+}
+
+/**
+ * @brief Checks a latency frame and hands complete reports to the latency handler.
+ * @param frame Frame header followed by the latency payload.
+ * @return True if the frame is well formed.
+ *
+ * @details
+ * A report split across several frames is only delivered if its frames
+ * arrived back to back; after a lost part the rest of the report is dropped.
+ */
+bool StreamDecoder::deliverLatency(std::span<const uint8_t> frame) {
+    std::span<const uint8_t> payload = frame.subspan(SERIAL_MAIL_HEADER_SIZE);
+    LatencyReport report;
+    size_t first;
+    size_t next;
+    if (!read_latency_frame(payload.data(), payload.size(), &report, &m_latency, &first, &next)) {
+        m_latency_next = 0;
+        return false;
+    }
+
+    m_stats.latency_frames++;
+    if (first != 0 && first != m_latency_next) {
+        m_latency_next = 0;
+        return true;
+    }
+    m_latency_next = next;
+    if (next == LATENCY_HISTOGRAM_BUCKETS) {
+        m_latency_next = 0;
+        if (m_latency_handler) {
+            m_latency_handler(report, m_latency);
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Collects the chunks of a message and hands complete messages to the message handler.
+ * @param frame Frame header followed by the message payload.
+ * @return True if the frame is well formed.
+ *
+ * @details
+ * Messages of different kinds are collected separately, because the node
+ * interleaves the chunks of its traffic classes. Within a kind, chunks must
+ * arrive in order. A chunk that does not continue the open message of its
+ * kind, because a frame was lost or a new message started, drops the open
+ * message and counts it as lost; the remaining chunks of that message are
+ * skipped.
+ */
+bool StreamDecoder::deliverMessage(std::span<const uint8_t> frame) {
+    std::span<const uint8_t> payload = frame.subspan(SERIAL_MAIL_HEADER_SIZE);
+    MessageHeader header;
+    size_t offset;
+    const uint8_t* chunk;
+    size_t chunk_size;
+    if (!read_message_frame(payload.data(), payload.size(), &header, &offset, &chunk, &chunk_size) ||
+        header.size > MESSAGE_MAX_SIZE) {
+        return false;
+    }
+    m_stats.message_frames++;
+
+    OpenMessage& message = m_messages[header.kind];
+    bool continues = message.open && header.id == message.header.id && header.node == message.header.node &&
+                     header.size == message.header.size && offset == message.data.size();
+    if (!continues) {
+        if (message.open) {
+            m_stats.lost_messages++;
+            message.open = false;
+        }
+        if (offset != 0) {
+            return true; // Rest of a message that is already given up
+        }
+        message.header = header;
+        message.data.clear();
+        message.open = true;
+    }
+
+    message.data.insert(message.data.end(), chunk, chunk + chunk_size);
+    if (message.data.size() == message.header.size) {
+        message.open = false;
+        if (m_message_handler) {
+            m_message_handler(message.header, message.data);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,37 @@
+/**
+ * @file BleReassembler.cpp
+ * @brief Implementation of the BleReassembler class.
+ */
+
+#include "transport/BleReassembler.h"
+#include "transport/BlePacker.h"
+
+BleReassembler::BleReassembler(StreamDecoder& decoder)
+    : m_decoder(decoder), m_next_sequence(0), m_synchronized(false), m_lost_notifications(0) {
+}
+
+/**
+ * @brief Checks the sequence byte and forwards the payload.
+ *
+ * @details
+ * On a gap the decoder's carry-over is discarded before the payload is fed.
+ * Otherwise the frame interrupted by the loss would be completed with bytes of
+ * a later frame; raw frames carry no checksum, so such a spliced frame could
+ * pass the verification. The payload itself starts in the middle of a frame,
+ * and the decoder resynchronizes on the next marker.
+ */
+void BleReassembler::feed(std::span<const uint8_t> notification) {
+    if (notification.size() <= BLE_PACKET_HEADER_SIZE) {
+        return;
+    }
+
+    uint8_t sequence = notification[0];
+    if (m_synchronized && sequence != m_next_sequence) {
+        m_lost_notifications += (uint8_t)(sequence - m_next_sequence);
+        m_decoder.discardPending();
+    }
+    m_synchronized = true;
+    m_next_sequence = sequence + 1;
+
+    m_decoder.feed(notification.subspan(BLE_PACKET_HEADER_SIZE));
+}
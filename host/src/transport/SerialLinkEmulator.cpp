@@ -0,0 +1,271 @@
+/**
+ * @file SerialLinkEmulator.cpp
+ * @brief Implementation of the SerialLinkEmulator class.
+ */
+
+#include "transport/SerialLinkEmulator.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdexcept>
+#include <termios.h>
+#include <unistd.h>
+
+/// Longest wait for a pseudo-terminal before the stop flag and the wire are checked again.
+#define LINK_POLL_US 1000
+
+SerialLinkEmulator::SerialLinkEmulator(const LinkOptions& options)
+    : m_options(options), m_byte_time(0), m_random(options.seed), m_node{-1, -1, ""}, m_host{-1, -1, ""},
+      m_downlink{}, m_uplink{} {
+    if (options.baudrate <= 0 || options.tx_buffer == 0 || options.rx_buffer == 0) {
+        throw std::runtime_error("baud rate and buffers of the link must be positive");
+    }
+    m_byte_time = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>((double)LINK_BITS_PER_BYTE / options.baudrate));
+
+    try {
+        openPty(m_node);
+        openPty(m_host);
+    } catch (...) {
+        closePty(m_node);
+        closePty(m_host);
+        throw;
+    }
+
+    m_downlink.from = &m_node;
+    m_downlink.to = &m_host;
+    m_downlink.faults = options.node_to_host;
+    m_uplink.from = &m_host;
+    m_uplink.to = &m_node;
+    m_uplink.faults = options.host_to_node;
+}
+
+SerialLinkEmulator::~SerialLinkEmulator(void) {
+    closePty(m_node);
+    closePty(m_host);
+}
+
+/**
+ * @details
+ * As in `PtyLoadGenerator`, the line discipline is switched to raw mode
+ * before anybody opens the slave. Opening the slave here as well keeps the
+ * master from reporting a hang-up whenever the sender or receiver closes
+ * theirs.
+ */
+void SerialLinkEmulator::openPty(Pty& pty) {
+    pty.master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (pty.master < 0 || grantpt(pty.master) != 0 || unlockpt(pty.master) != 0) {
+        throw std::runtime_error(std::string("cannot create pseudo-terminal: ") + strerror(errno));
+    }
+
+    struct termios tty;
+    if (tcgetattr(pty.master, &tty) == 0) {
+        cfmakeraw(&tty);
+        tcsetattr(pty.master, TCSANOW, &tty);
+    }
+    fcntl(pty.master, F_SETFL, fcntl(pty.master, F_GETFL) | O_NONBLOCK);
+    pty.path = ptsname(pty.master);
+
+    pty.slave = open(pty.path.c_str(), O_RDWR | O_NOCTTY);
+    if (pty.slave < 0) {
+        throw std::runtime_error("cannot open " + pty.path + ": " + strerror(errno));
+    }
+}
+
+void SerialLinkEmulator::closePty(Pty& pty) {
+    if (pty.slave >= 0) {
+        close(pty.slave);
+        pty.slave = -1;
+    }
+    if (pty.master >= 0) {
+        close(pty.master);
+        pty.master = -1;
+    }
+}
+
+/**
+ * @details
+ * Every pass moves the bytes whose time has come: arrived bytes from the
+ * wire into the receive buffer and on to the receiver, then new bytes from
+ * the sender onto the wire. The wait in between ends at the next arrival, so
+ * the latency is kept to the poll resolution and bytes reach the receiver in
+ * the small chunks a UART driver delivers.
+ */
+void SerialLinkEmulator::run(double duration_s, const std::atomic<bool>& stop) {
+    const Clock::time_point start = Clock::now();
+    const Clock::time_point end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(duration_s));
+
+    for (Direction* direction : {&m_downlink, &m_uplink}) {
+        direction->line_free = start;
+        direction->last_arrival = start;
+        direction->burst_start = start + randomDuration(direction->faults.burst_rate_hz > 0
+                                                            ? 1000 / direction->faults.burst_rate_hz : 0);
+        direction->burst_end = direction->burst_start + randomDuration(direction->faults.burst_ms);
+        direction->burst_counted = false;
+    }
+
+    while (!stop.load(std::memory_order_relaxed)) {
+        Clock::time_point now = Clock::now();
+        if (duration_s > 0 && now >= end) {
+            break;
+        }
+
+        Clock::time_point wake = now + std::chrono::microseconds(LINK_POLL_US);
+        for (Direction* direction : {&m_downlink, &m_uplink}) {
+            deliver(*direction, now);
+            take(*direction, now);
+            if (!direction->wire.empty()) {
+                wake = std::min(wake, direction->wire.front().arrival);
+            }
+        }
+
+        // Each master is read for one direction and written for the other
+        struct pollfd fds[2] = {
+            {m_node.master, (short)((txBacklog(m_downlink, now) < m_options.tx_buffer ? POLLIN : 0) |
+                                    (m_uplink.received.empty() ? 0 : POLLOUT)), 0},
+            {m_host.master, (short)((txBacklog(m_uplink, now) < m_options.tx_buffer ? POLLIN : 0) |
+                                    (m_downlink.received.empty() ? 0 : POLLOUT)), 0},
+        };
+        auto wait_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::max(wake - now, Clock::duration(0)));
+        struct timespec timeout = {(time_t)(wait_ns.count() / 1000000000), (long)(wait_ns.count() % 1000000000)};
+        ppoll(fds, 2, &timeout, nullptr);
+    }
+}
+
+/**
+ * @brief Bytes taken from the sender that have not yet started on the wire.
+ */
+size_t SerialLinkEmulator::txBacklog(const Direction& direction, Clock::time_point now) const {
+    if (direction.line_free <= now) {
+        return 0;
+    }
+    return (size_t)((direction.line_free - now + m_byte_time - Clock::duration(1)) / m_byte_time);
+}
+
+/**
+ * @brief Reads from the sender while the sending UART has room and puts the bytes on the wire.
+ */
+void SerialLinkEmulator::take(Direction& direction, Clock::time_point now) {
+    uint8_t chunk[LINK_CHUNK_SIZE];
+    size_t room = m_options.tx_buffer - std::min(txBacklog(direction, now), m_options.tx_buffer);
+    while (room > 0) {
+        ssize_t count = read(direction.from->master, chunk, std::min(room, sizeof(chunk)));
+        if (count <= 0) {
+            return;
+        }
+        for (ssize_t i = 0; i < count; i++) {
+            transmit(direction, chunk[i], now);
+        }
+        room -= (size_t)count;
+    }
+}
+
+/**
+ * @brief Sends one byte over the wire, after the bytes taken before it.
+ */
+void SerialLinkEmulator::transmit(Direction& direction, uint8_t value, Clock::time_point now) {
+    const LinkImpairments& faults = direction.faults;
+    Clock::time_point sent = std::max(now, direction.line_free);
+    direction.line_free = sent + m_byte_time;
+    direction.stats.bytes_in++;
+
+    std::uniform_real_distribution<double> uniform(0, 1);
+    if (faults.drop_rate > 0 && uniform(m_random) < faults.drop_rate) {
+        direction.stats.dropped++;
+        return;
+    }
+    double bit_error_rate = bitErrorRate(direction, sent);
+    if (bit_error_rate > 0) {
+        uint8_t flips = 0;
+        for (int bit = 0; bit < 8; bit++) {
+            if (uniform(m_random) < bit_error_rate) {
+                flips |= (uint8_t)(1 << bit);
+                direction.stats.bit_errors++;
+            }
+        }
+        if (flips != 0) {
+            value ^= flips;
+            direction.stats.corrupted++;
+        }
+    }
+
+    Clock::time_point arrival = direction.line_free;
+    if (faults.latency_ms > 0 || faults.jitter_ms > 0) {
+        double delay_ms = faults.latency_ms + faults.jitter_ms * uniform(m_random);
+        arrival = direction.line_free + std::chrono::duration_cast<Clock::duration>(
+                                            std::chrono::duration<double, std::milli>(delay_ms));
+    }
+    // Jitter delays a byte but never lets it overtake the one before
+    arrival = std::max(arrival, direction.last_arrival);
+    direction.last_arrival = arrival;
+    direction.wire.push_back({arrival, value});
+}
+
+/**
+ * @brief Bit error rate at a point on the wire, moving the burst schedule along.
+ *
+ * @details
+ * Bursts and the gaps between them alternate, with exponentially distributed
+ * lengths. A burst counts once it hits a byte.
+ */
+double SerialLinkEmulator::bitErrorRate(Direction& direction, Clock::time_point at) {
+    const LinkImpairments& faults = direction.faults;
+    if (faults.burst_rate_hz <= 0) {
+        return faults.bit_error_rate;
+    }
+    while (at >= direction.burst_end) {
+        direction.burst_start = direction.burst_end + randomDuration(1000 / faults.burst_rate_hz);
+        direction.burst_end = direction.burst_start + randomDuration(faults.burst_ms);
+        direction.burst_counted = false;
+    }
+    if (at < direction.burst_start) {
+        return faults.bit_error_rate;
+    }
+    if (!direction.burst_counted) {
+        direction.stats.bursts++;
+        direction.burst_counted = true;
+    }
+    return faults.burst_bit_error_rate;
+}
+
+/**
+ * @brief Moves arrived bytes into the receive buffer and from there to the receiver.
+ */
+void SerialLinkEmulator::deliver(Direction& direction, Clock::time_point now) {
+    while (!direction.wire.empty() && direction.wire.front().arrival <= now) {
+        if (direction.received.size() < m_options.rx_buffer) {
+            direction.received.push_back(direction.wire.front().value);
+        } else {
+            direction.stats.overruns++;
+        }
+        direction.wire.pop_front();
+    }
+
+    uint8_t chunk[LINK_CHUNK_SIZE];
+    while (!direction.received.empty()) {
+        size_t size = std::min(direction.received.size(), sizeof(chunk));
+        std::copy(direction.received.begin(), direction.received.begin() + size, chunk);
+        ssize_t count = write(direction.to->master, chunk, size);
+        if (count <= 0) {
+            return;
+        }
+        direction.received.erase(direction.received.begin(), direction.received.begin() + count);
+        direction.stats.bytes_out += (uint64_t)count;
+    }
+}
+
+/**
+ * @brief Draws an exponentially distributed duration.
+ * @param mean_ms Mean duration, 0 for none.
+ */
+SerialLinkEmulator::Clock::duration SerialLinkEmulator::randomDuration(double mean_ms) {
+    if (mean_ms <= 0) {
+        return Clock::duration(0);
+    }
+    std::exponential_distribution<double> exponential(1 / mean_ms);
+    return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(exponential(m_random)));
+}
@@ -0,0 +1,56 @@
+/**
+ * @file MappedFile.cpp
+ * @brief Implementation of the MappedFile class.
+ */
+
+#include "utils/MappedFile.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief Opens and maps the file.
+ *
+ * @details
+ * The mapping is advised as sequential so the kernel reads ahead aggressively
+ * while the decoder walks through the capture.
+ */
+MappedFile::MappedFile(const std::string& path) : m_data(nullptr), m_size(0) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("cannot open " + path + ": " + strerror(errno));
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        int err = errno;
+        close(fd);
+        throw std::runtime_error("cannot stat " + path + ": " + strerror(err));
+    }
+
+    m_size = (size_t)st.st_size;
+    if (m_size > 0) {
+        void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            int err = errno;
+            close(fd);
+            throw std::runtime_error("cannot map " + path + ": " + strerror(err));
+        }
+        madvise(data, m_size, MADV_SEQUENTIAL);
+        m_data = static_cast<const uint8_t*>(data);
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+}
+
+MappedFile::~MappedFile(void) {
+    if (m_data != nullptr) {
+        munmap(const_cast<uint8_t*>(m_data), m_size);
+    }
+}
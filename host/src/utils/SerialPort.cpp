@@ -0,0 +1,77 @@
+/**
+ * @file SerialPort.cpp
+ * @brief Implementation of the serial port helpers.
+ */
+
+#include "utils/SerialPort.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <termios.h>
+#include <unistd.h>
+
+/**
+ * @brief Maps a numeric baud rate onto the matching termios constant.
+ * @param baudrate Baud rate in bits per second.
+ * @return termios speed constant, or `B0` if the rate is not supported.
+ */
+static speed_t to_speed(int baudrate) {
+    switch (baudrate) {
+        case 9600:    return B9600;
+        case 19200:   return B19200;
+        case 38400:   return B38400;
+        case 57600:   return B57600;
+        case 115200:  return B115200;
+        case 230400:  return B230400;
+        case 460800:  return B460800;
+        case 921600:  return B921600;
+        case 1000000: return B1000000;
+        case 2000000: return B2000000;
+        default:      return B0;
+    }
+}
+
+int open_serial_port(const std::string& device, int baudrate, bool writable) {
+    speed_t speed = to_speed(baudrate);
+    if (speed == B0) {
+        throw std::runtime_error("unsupported baud rate " + std::to_string(baudrate));
+    }
+
+    int fd = open(device.c_str(), (writable ? O_RDWR : O_RDONLY) | O_NOCTTY);
+    if (fd < 0) {
+        throw std::runtime_error("cannot open " + device + ": " + strerror(errno));
+    }
+
+    struct termios tty;
+    if (tcgetattr(fd, &tty) != 0) {
+        int err = errno;
+        close(fd);
+        throw std::runtime_error("cannot read attributes of " + device + ": " + strerror(err));
+    }
+
+    // Raw 8N1, no flow control; block until at least one byte arrived
+    cfmakeraw(&tty);
+    tty.c_cflag &= ~(PARENB | CSTOPB | CRTSCTS);
+    tty.c_cflag |= CS8 | CLOCAL | CREAD;
+    tty.c_cc[VMIN] = 1;
+    tty.c_cc[VTIME] = 0;
+    cfsetispeed(&tty, speed);
+    cfsetospeed(&tty, speed);
+
+    if (tcsetattr(fd, TCSANOW, &tty) != 0) {
+        int err = errno;
+        close(fd);
+        throw std::runtime_error("cannot configure " + device + ": " + strerror(err));
+    }
+    tcflush(fd, TCIFLUSH);
+
+    return fd;
+}
+
+bool is_character_device(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && S_ISCHR(st.st_mode);
+}
@@ -0,0 +1,49 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+/**
+ * @file Check.h
+ * @brief Assertions of the host tests registered with CTest.
+ *
+ * Every check prints one line with its outcome; `check_summary` prints PASS
+ * or FAIL and returns the exit code of the test program.
+ */
+
+#include <cstdarg>
+#include <cstdio>
+
+/// Number of failed checks of the test program.
+inline int& check_failures(void) {
+    static int failures = 0;
+    return failures;
+}
+
+/**
+ * @brief Records the outcome of a check.
+ * @param ok Outcome.
+ * @param format printf format describing what was checked.
+ * @return `ok`.
+ */
+__attribute__((format(printf, 2, 3))) inline bool check(bool ok, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    printf("  %-4s ", ok ? "ok" : "FAIL");
+    vprintf(format, args);
+    printf("\n");
+    va_end(args);
+    if (!ok) {
+        check_failures()++;
+    }
+    return ok;
+}
+
+/**
+ * @brief Prints the result of the test program.
+ * @return 0 if every check passed, 1 otherwise.
+ */
+inline int check_summary(void) {
+    printf("%s\n", check_failures() == 0 ? "PASS" : "FAIL");
+    return check_failures() == 0 ? 0 : 1;
+}
+
+#endif // CHECK_H
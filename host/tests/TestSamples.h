@@ -0,0 +1,30 @@
+#ifndef TEST_SAMPLES_H
+#define TEST_SAMPLES_H
+
+/**
+ * @file TestSamples.h
+ * @brief Reproducible samples for the host tests and benchmarks.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+#include "adc/SampleVector.h"
+
+/**
+ * @brief Generates a channel of pseudo-random samples across the whole code range.
+ * @param samples Number of samples.
+ * @param seed Start of the generator; the same seed gives the same channel.
+ * @return Sign-corrected samples as collected by the node.
+ */
+inline SampleVector make_channel(size_t samples, uint32_t seed) {
+    SampleVector channel;
+    uint32_t state = seed;
+    for (size_t i = 0; i < samples; i++) {
+        state = state * 1664525u + 1013904223u;
+        channel.push_back((int32_t)(state >> 8) - SAMPLE_ZERO_CODE);
+    }
+    return channel;
+}
+
+#endif // TEST_SAMPLES_H
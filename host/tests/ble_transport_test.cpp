@@ -0,0 +1,313 @@
+/**
+ * @file ble_transport_test.cpp
+ * @brief Sends frame streams through the `BlePacker` and the `BleReassembler`.
+ *
+ * @details
+ * The notifications the node's packer produces are handed to the host's
+ * reassembler as the central would receive them. The checks cover
+ * - every frame arriving unchanged at the default, intermediate and desired
+ *   ATT MTU, with every notification but the last one completely filled;
+ * - lost notifications: the loss is counted, no frame spliced from the bytes
+ *   around the gap is delivered, and every frame received completely is;
+ * - sequence wrap-around and gaps across it;
+ * - `ble_throughput_estimate` against a simulated connection with a
+ *   saturated send queue, and the estimate as the capacity of the link.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <span>
+#include <vector>
+
+#include "Check.h"
+#include "TestSamples.h"
+#include "adc/SampleVector.h"
+#include "serial_mail_sender/FrameBuilder.h"
+#include "serial_mail_sender/FrameFormat.h"
+#include "serial_mail_sender/RawFrameBuilder.h"
+#include "stream_decoder/StreamDecoder.h"
+#include "transport/BlePacker.h"
+#include "transport/BleReassembler.h"
+
+/// Notifications per connection event, as `BLE_NOTIFICATIONS_PER_EVENT` of the node's `BleTransport`.
+#define NOTIFICATIONS_PER_EVENT 4
+
+/// Connection events simulated per throughput measurement.
+#define THROUGHPUT_EVENTS 4000
+
+/// Largest relative difference between the simulated and the estimated throughput.
+#define THROUGHPUT_TOLERANCE 0.01
+
+typedef std::vector<uint8_t> Bytes;
+
+/// ATT MTUs the streams are sent with; 517 exceeds what the node requests.
+static const uint16_t MTUS[] = {BLE_DEFAULT_ATT_MTU, 27, 64, 185, 247, BLE_DESIRED_ATT_MTU, 517};
+
+/**
+ * @brief FlatBuffer and raw frames of different sizes.
+ * @param count Number of frames.
+ * @param raw Set for every raw frame.
+ */
+static std::vector<Bytes> mixed_frames(size_t count, std::vector<bool>& raw) {
+    FrameBuilder builder;
+    RawFrameBuilder raw_builder;
+    std::vector<Bytes> frames;
+    for (size_t i = 0; i < count; i++) {
+        size_t n = 1 + (i * 13) % 60;
+        SampleVector ch0 = make_channel(n, (uint32_t)i * 2 + 1);
+        SampleVector ch1 = make_channel(n, (uint32_t)i * 2 + 2);
+        Bytes frame(SERIAL_MAIL_HEADER_SIZE + SERIAL_MAIL_MAX_PAYLOAD_SIZE);
+        if (i % 2 == 1) {
+            frame.resize(raw_builder.build(ch0, ch1, (int)(i % 3), frame.data(), frame.size()));
+        } else {
+            frame.resize(builder.build(ch0, ch1, (int)(i % 3), frame.data(), frame.size()));
+        }
+        frames.push_back(frame);
+        raw.push_back(i % 2 == 1);
+    }
+    return frames;
+}
+
+/**
+ * @brief Packs the frames into notifications, pushing whenever the packer has room.
+ * @param frames Frames in stream order.
+ * @param att_mtu Negotiated ATT MTU.
+ * @param notification_size Receives the size of a full notification.
+ * @return Notifications, the last one flushed.
+ */
+static std::vector<Bytes> pack(const std::vector<Bytes>& frames, uint16_t att_mtu, size_t& notification_size) {
+    BlePacker packer;
+    packer.setAttMtu(att_mtu);
+    notification_size = packer.notificationSize();
+
+    std::vector<Bytes> notifications;
+    uint8_t notification[BLE_MAX_NOTIFICATION_SIZE];
+    size_t next = 0;
+    while (next < frames.size() || packer.pending() > 0) {
+        while (next < frames.size() && packer.push(frames[next].data(), frames[next].size())) {
+            next++;
+        }
+        size_t size = packer.pull(notification, next == frames.size());
+        if (size > 0) {
+            notifications.push_back(Bytes(notification, notification + size));
+        }
+    }
+    return notifications;
+}
+
+/**
+ * @brief Receives the notifications not marked as lost.
+ * @param lost Receives the number of notifications the reassembler counted as lost.
+ * @param stats Receives the decoder statistics.
+ * @return Delivered frames.
+ */
+static std::vector<Bytes> receive(const std::vector<Bytes>& notifications, const std::vector<bool>& dropped,
+                                  uint64_t& lost, DecoderStats& stats) {
+    std::vector<Bytes> frames;
+    StreamDecoder decoder([&](const DecodedFrame& decoded) {
+        frames.push_back(Bytes(decoded.frame.begin(), decoded.frame.end()));
+    });
+    BleReassembler reassembler(decoder);
+    for (size_t i = 0; i < notifications.size(); i++) {
+        if (!dropped[i]) {
+            reassembler.feed(notifications[i]);
+        }
+    }
+    lost = reassembler.lostNotifications();
+    stats = decoder.stats();
+    return frames;
+}
+
+static void test_round_trip(void) {
+    printf("round trip\n");
+    std::vector<bool> raw;
+    std::vector<Bytes> frames = mixed_frames(300, raw);
+    size_t stream_size = 0;
+    for (const Bytes& frame : frames) {
+        stream_size += frame.size();
+    }
+
+    for (uint16_t mtu : MTUS) {
+        size_t notification_size;
+        std::vector<Bytes> notifications = pack(frames, mtu, notification_size);
+
+        bool filled = notification_size == std::min<size_t>(mtu - BLE_ATT_HEADER_SIZE, BLE_MAX_NOTIFICATION_SIZE);
+        bool in_order = true;
+        for (size_t i = 0; i < notifications.size(); i++) {
+            filled &= i + 1 == notifications.size() || notifications[i].size() == notification_size;
+            in_order &= notifications[i][0] == (uint8_t)i;
+        }
+
+        uint64_t lost;
+        DecoderStats stats;
+        std::vector<Bytes> decoded = receive(notifications, std::vector<bool>(notifications.size(), false), lost, stats);
+        check(filled && in_order && decoded == frames && lost == 0 && stats.skipped_bytes == 0 &&
+                  stats.bytes == stream_size && stats.missed_frames == 0,
+              "MTU %3u: %zu frames in %zu notifications of %zu bytes", mtu, frames.size(), notifications.size(),
+              notification_size);
+    }
+}
+
+/**
+ * @brief Drops notifications and checks which frames arrive.
+ *
+ * @details
+ * A frame is expected if all its bytes are in received notifications. The
+ * frame interrupted by a loss must not be delivered; without discarding the
+ * carry-over a raw frame would be completed with the bytes after the gap.
+ */
+static void test_loss(void) {
+    printf("lost notifications\n");
+    std::vector<bool> raw;
+    std::vector<Bytes> frames = mixed_frames(300, raw);
+
+    for (uint16_t mtu : MTUS) {
+        size_t notification_size;
+        std::vector<Bytes> notifications = pack(frames, mtu, notification_size);
+        size_t capacity = notification_size - BLE_PACKET_HEADER_SIZE;
+
+        // Single losses at irregular distances and one burst of three
+        std::vector<bool> dropped(notifications.size(), false);
+        uint64_t dropped_count = 0;
+        for (size_t i = 1; i + 1 < notifications.size(); i++) {
+            dropped[i] = i % 29 == 11 || (i >= 60 && i < 63);
+            dropped_count += dropped[i];
+        }
+
+        std::vector<Bytes> expected;
+        uint64_t missed_raw = 0;
+        uint64_t lost_raw = 0;
+        size_t offset = 0;
+        for (size_t f = 0; f < frames.size(); f++) {
+            size_t first = offset / capacity;
+            size_t last = (offset + frames[f].size() - 1) / capacity;
+            bool complete = true;
+            for (size_t i = first; i <= last; i++) {
+                complete &= !dropped[i];
+            }
+            if (complete) {
+                expected.push_back(frames[f]);
+                if (raw[f]) {
+                    missed_raw += lost_raw;
+                    lost_raw = 0;
+                }
+            } else if (raw[f]) {
+                lost_raw++;
+            }
+            offset += frames[f].size();
+        }
+
+        uint64_t lost;
+        DecoderStats stats;
+        std::vector<Bytes> decoded = receive(notifications, dropped, lost, stats);
+        uint64_t delivered_bytes = 0;
+        for (const Bytes& frame : decoded) {
+            delivered_bytes += frame.size();
+        }
+        check(decoded == expected && lost == dropped_count && stats.missed_frames == missed_raw &&
+                  stats.skipped_bytes + delivered_bytes == stats.bytes,
+              "MTU %3u: %llu of %zu notifications lost, %zu of %zu frames delivered, no spliced frame", mtu,
+              (unsigned long long)lost, notifications.size(), decoded.size(), frames.size());
+    }
+}
+
+static void test_sequence_wrap(void) {
+    printf("sequence wrap-around\n");
+    StreamDecoder decoder([](const DecodedFrame&) {});
+    BleReassembler reassembler(decoder);
+    const uint8_t sequences[] = {250, 251, 252, 253, 254, 255, 0, 1, 2};
+    for (uint8_t sequence : sequences) {
+        const uint8_t notification[] = {sequence, 0x00};
+        reassembler.feed(notification);
+    }
+    check(reassembler.lostNotifications() == 0, "250..2 in order: %llu lost",
+          (unsigned long long)reassembler.lostNotifications());
+
+    const uint8_t before[] = {253, 0x00};
+    const uint8_t after[] = {1, 0x00};
+    reassembler.feed(before);
+    reassembler.feed(after);
+    check(reassembler.lostNotifications() == 250 + 3, "253 after 2, then 1 after 253: %llu lost",
+          (unsigned long long)reassembler.lostNotifications());
+
+    const uint8_t header_only[] = {7};
+    reassembler.feed(header_only);
+    check(reassembler.lostNotifications() == 250 + 3 && decoder.stats().bytes == 11,
+          "notification without payload ignored");
+}
+
+/**
+ * @brief Sends frames over a simulated connection.
+ * @param att_mtu Negotiated ATT MTU.
+ * @param interval_us Connection interval.
+ * @param rate Frame bytes produced per second.
+ * @param rejected Receives the number of frames the packer had no room for.
+ * @return Frame bytes per second carried by the notifications.
+ *
+ * @details
+ * Every connection event the producer hands over the frames due so far, and
+ * up to `NOTIFICATIONS_PER_EVENT` full notifications are sent.
+ */
+static double simulate_link(uint16_t att_mtu, uint32_t interval_us, double rate, uint64_t& rejected) {
+    RawFrameBuilder builder;
+    Bytes frame(SERIAL_MAIL_HEADER_SIZE + SERIAL_MAIL_MAX_PAYLOAD_SIZE);
+    frame.resize(builder.build(make_channel(50, 1), make_channel(50, 2), 1, frame.data(), frame.size()));
+
+    BlePacker packer;
+    packer.setAttMtu(att_mtu);
+    uint8_t notification[BLE_MAX_NOTIFICATION_SIZE];
+    double due = 0.0;
+    uint64_t carried = 0;
+    rejected = 0;
+    for (int event = 0; event < THROUGHPUT_EVENTS; event++) {
+        due += rate * interval_us / 1e6;
+        while (due >= frame.size()) {
+            rejected += !packer.push(frame.data(), frame.size());
+            due -= frame.size();
+        }
+        for (int i = 0; i < NOTIFICATIONS_PER_EVENT; i++) {
+            size_t size = packer.pull(notification, false);
+            if (size == 0) {
+                break;
+            }
+            carried += size - BLE_PACKET_HEADER_SIZE;
+        }
+    }
+    return carried * 1e6 / ((double)THROUGHPUT_EVENTS * interval_us);
+}
+
+static void test_throughput(void) {
+    printf("throughput\n");
+    struct Link {
+        uint16_t att_mtu;
+        uint32_t interval_us;
+    };
+    const Link links[] = {{BLE_DEFAULT_ATT_MTU, 7500}, {BLE_DEFAULT_ATT_MTU, 30000}, {185, 15000},
+                          {247, 7500}, {BLE_DESIRED_ATT_MTU, 7500}, {BLE_DESIRED_ATT_MTU, 45000}};
+
+    for (const Link& link : links) {
+        double estimate = ble_throughput_estimate(link.att_mtu, link.interval_us, NOTIFICATIONS_PER_EVENT);
+
+        uint64_t rejected;
+        double saturated = simulate_link(link.att_mtu, link.interval_us, 10.0 * estimate, rejected);
+        check(std::fabs(saturated - estimate) <= THROUGHPUT_TOLERANCE * estimate,
+              "MTU %3u, %5.1f ms: saturated link carries %8.0f B/s, estimate %8.0f B/s", link.att_mtu,
+              link.interval_us / 1000.0, saturated, estimate);
+
+        uint64_t rejected_below;
+        uint64_t rejected_above;
+        simulate_link(link.att_mtu, link.interval_us, 0.9 * estimate, rejected_below);
+        simulate_link(link.att_mtu, link.interval_us, 1.1 * estimate, rejected_above);
+        check(rejected_below == 0 && rejected_above > 0,
+              "MTU %3u, %5.1f ms: 90%% of the estimate fits, 110%% overflows the packer (%llu frames rejected)",
+              link.att_mtu, link.interval_us / 1000.0, (unsigned long long)rejected_above);
+    }
+}
+
+int main(void) {
+    test_round_trip();
+    test_loss();
+    test_sequence_wrap();
+    test_throughput();
+    return check_summary();
+}
@@ -0,0 +1,157 @@
+/**
+ * @file conversion_test.cpp
+ * @brief Checks 24-bit packing, sample demultiplexing and the millivolt conversion.
+ *
+ * @details
+ * The checks cover
+ * - `sample_from_bytes` and `sample_to_bytes` at the ends of the code range,
+ *   at 0 V and for every 4099th code, and `pack_samples` against them;
+ * - `SampleCollector` and `FixedSampleCollector` demultiplexing the same
+ *   words, ignoring invalid status bytes and replacing the oldest sample of
+ *   a full channel;
+ * - the conversion at 0 V and full scale, runtime against preset constants,
+ *   and `millivolts_to_codes` as its inverse.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "Check.h"
+#include "adc/FixedSampleCollector.h"
+#include "adc/SampleCollector.h"
+#include "adc/SampleVector.h"
+#include "config/PipelineConfig.h"
+#include "utils/ConversionKernel.h"
+
+/// Frame size of the collector checks.
+#define COLLECTOR_SIZE 8
+
+/// Largest relative difference between the runtime and the preset conversion.
+#define CONVERSION_TOLERANCE 1e-6
+
+static void test_packing(void) {
+    printf("24-bit packing\n");
+    const uint8_t lowest[] = {0x00, 0x00, 0x00};
+    const uint8_t zero[] = {0x80, 0x00, 0x00};
+    const uint8_t highest[] = {0xFF, 0xFF, 0xFF};
+    check(sample_from_bytes(lowest) == -SAMPLE_ZERO_CODE && sample_from_bytes(zero) == 0 &&
+              sample_from_bytes(highest) == SAMPLE_ZERO_CODE - 1,
+          "codes 0x000000, 0x800000, 0xFFFFFF read as -2^23, 0, 2^23 - 1");
+
+    bool round_trip = true;
+    bool big_endian = true;
+    std::vector<int32_t> samples;
+    for (uint32_t code = 0; code < (1u << 24); code += 4099) {
+        int32_t sample = (int32_t)code - SAMPLE_ZERO_CODE;
+        uint8_t bytes[SAMPLE_WIRE_SIZE];
+        sample_to_bytes(sample, bytes);
+        round_trip &= sample_from_bytes(bytes) == sample;
+        big_endian &= bytes[0] == (uint8_t)(code >> 16) && bytes[1] == (uint8_t)(code >> 8) && bytes[2] == (uint8_t)code;
+        samples.push_back(sample);
+    }
+    check(round_trip && big_endian, "%zu codes written big-endian and read back", samples.size());
+
+    std::vector<uint8_t> packed(samples.size() * SAMPLE_WIRE_SIZE);
+    pack_samples(samples.data(), samples.size(), packed.data());
+    bool same = true;
+    for (size_t i = 0; i < samples.size(); i++) {
+        same &= sample_from_bytes(&packed[i * SAMPLE_WIRE_SIZE]) == samples[i];
+    }
+    check(same, "pack_samples writes %zu samples back to back", samples.size());
+}
+
+static void test_collectors(void) {
+    printf("sample collectors\n");
+    std::vector<std::array<uint8_t, AD7124_CONVERSION_WORD_SIZE>> words;
+    uint32_t state = 7;
+    for (int i = 0; i < 200; i++) {
+        state = state * 1664525u + 1013904223u;
+        // Mostly alternating channels, with runs on one channel and words that are not ready
+        uint8_t status = (i % 17 == 5) ? 0x80 : (i % 13 < 3 ? 0 : (uint8_t)(i % 2));
+        words.push_back({(uint8_t)(state >> 24), (uint8_t)(state >> 16), (uint8_t)(state >> 8), status});
+    }
+
+    SampleCollector collector(COLLECTOR_SIZE);
+    FixedSampleCollector<COLLECTOR_SIZE> fixed;
+    std::vector<int32_t> ch0;
+    std::vector<int32_t> ch1;
+    size_t frames = 0;
+    bool same = true;
+    bool expected = true;
+    for (const auto& word : words) {
+        if (word[3] == 0) {
+            ch0.push_back(sample_from_bytes(word.data()));
+        } else if (word[3] == 1) {
+            ch1.push_back(sample_from_bytes(word.data()));
+        }
+        // A full channel keeps its newest samples
+        if (ch0.size() > COLLECTOR_SIZE) {
+            ch0.erase(ch0.begin());
+        }
+        if (ch1.size() > COLLECTOR_SIZE) {
+            ch1.erase(ch1.begin());
+        }
+
+        bool full = collector.push(word.data());
+        same &= full == fixed.push(word.data());
+        if (!full) {
+            continue;
+        }
+        for (size_t i = 0; i < COLLECTOR_SIZE; i++) {
+            same &= collector.ch0()[i] == fixed.ch0()[i] && collector.ch1()[i] == fixed.ch1()[i];
+            expected &= collector.ch0()[i] == ch0[i] && collector.ch1()[i] == ch1[i];
+        }
+        collector.clear();
+        fixed.clear();
+        ch0.clear();
+        ch1.clear();
+        frames++;
+    }
+    check(frames > 5 && expected, "%zu frames hold the newest samples of each channel, invalid status ignored", frames);
+    check(same, "SampleCollector and FixedSampleCollector agree");
+}
+
+static void test_conversion(void) {
+    printf("conversion\n");
+    const float full_scale_mv = PhytoConfig::vref / PhytoConfig::gain * 1000;
+    float zero = sample_to_millivolts(0, PhytoConfig::databits, PhytoConfig::vref, PhytoConfig::gain);
+    float highest = sample_to_millivolts(PhytoConfig::databits - 1, PhytoConfig::databits, PhytoConfig::vref,
+                                         PhytoConfig::gain);
+    float lowest = sample_to_millivolts(-PhytoConfig::databits, PhytoConfig::databits, PhytoConfig::vref,
+                                        PhytoConfig::gain);
+    check(zero == 0.0f && std::fabs(lowest + full_scale_mv) <= full_scale_mv * CONVERSION_TOLERANCE &&
+              highest <= full_scale_mv && highest >= full_scale_mv * (1 - CONVERSION_TOLERANCE),
+          "0 V, -full scale and +full scale: %.6f, %.3f, %.3f mV", zero, lowest, highest);
+
+    std::array<int32_t, COLLECTOR_SIZE * 4> samples;
+    for (size_t i = 0; i < samples.size(); i++) {
+        samples[i] = (int32_t)((i * 524287u) % (1u << 24)) - SAMPLE_ZERO_CODE;
+    }
+    std::array<float, COLLECTOR_SIZE * 4> runtime;
+    std::array<float, COLLECTOR_SIZE * 4> preset;
+    convert_samples(samples.data(), samples.size(), PhytoConfig::databits, PhytoConfig::vref, PhytoConfig::gain,
+                    runtime.data());
+    convert_samples<PhytoConfig>(samples, preset);
+    double worst = 0;
+    for (size_t i = 0; i < samples.size(); i++) {
+        worst = std::max(worst, std::fabs((double)runtime[i] - preset[i]) / full_scale_mv);
+    }
+    check(worst <= CONVERSION_TOLERANCE, "runtime and preset constants agree within %.1e of full scale", worst);
+
+    bool inverse = true;
+    for (float millivolts : {0.0f, 0.5f, 1.0f, 10.0f, 100.0f}) {
+        int32_t codes = millivolts_to_codes<PhytoConfig>(millivolts);
+        float back = sample_to_millivolts<PhytoConfig>(codes);
+        inverse &= std::fabs(back - millivolts) <= sample_to_millivolts<PhytoConfig>(1);
+    }
+    check(inverse, "millivolts_to_codes is the inverse within one code");
+}
+
+int main(void) {
+    test_packing();
+    test_collectors();
+    test_conversion();
+    return check_summary();
+}
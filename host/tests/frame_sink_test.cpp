@@ -0,0 +1,172 @@
+/**
+ * @file frame_sink_test.cpp
+ * @brief Publishes frames to loopback sinks that are drained at different rates.
+ *
+ * @details
+ * A `FrameDispatcher` fans raw frames out to four `LoopbackTransport` sinks:
+ * one drained completely after every frame, two drained by a few bytes per
+ * frame with either backpressure policy, and one not drained until the end.
+ * The output of every sink runs through a `StreamDecoder`. The checks cover
+ * - the fast sink delivering every frame within the tick it was published,
+ *   however far the other sinks lag;
+ * - every sink delivering only intact frames, in order, and accounting for
+ *   each published frame as sent, dropped or queued;
+ * - which frames each backpressure policy keeps;
+ * - every pool buffer returning once all sinks have written their frames.
+ */
+
+#include <cstdio>
+#include <span>
+#include <vector>
+
+#include "Check.h"
+#include "TestSamples.h"
+#include "adc/SampleVector.h"
+#include "serial_mail_sender/RawFrameBuilder.h"
+#include "stream_decoder/StreamDecoder.h"
+#include "transport/FrameBuffer.h"
+#include "transport/FrameDispatcher.h"
+#include "transport/LoopbackTransport.h"
+
+/// Frames published per run.
+#define PUBLISHED_FRAMES 600
+
+/// Bytes the slow sinks are drained by per published frame, a fraction of the frame size.
+#define SLOW_DRAIN_BYTES 40
+
+typedef std::vector<uint8_t> Bytes;
+
+/**
+ * @struct Reader
+ * @brief Drains a loopback sink and decodes what it wrote.
+ */
+struct Reader {
+    LoopbackTransport&    sink;         ///< Sink read from.
+    size_t                rate;         ///< Bytes read per tick, 0 for none.
+    StreamDecoder         decoder;      ///< Decoder of the bytes read.
+    std::vector<uint32_t> sequences;    ///< Sequence numbers of the delivered frames.
+    bool                  intact;       ///< Every delivered frame equals the published one.
+
+    Reader(LoopbackTransport& loopback, size_t bytes_per_tick, const std::vector<Bytes>& published)
+        : sink(loopback), rate(bytes_per_tick), decoder([this, &published](const DecodedFrame& decoded) {
+              intact &= decoded.sequence < published.size() &&
+                        Bytes(decoded.frame.begin(), decoded.frame.end()) == published[decoded.sequence];
+              sequences.push_back(decoded.sequence);
+          }),
+          intact(true) {}
+
+    /// Reads up to `count` bytes.
+    void read(size_t count) {
+        uint8_t chunk[LOOPBACK_BUFFER_SIZE];
+        while (count > 0) {
+            size_t size = sink.read(chunk, count < sizeof(chunk) ? count : sizeof(chunk));
+            if (size == 0) {
+                return;
+            }
+            decoder.feed(std::span<const uint8_t>(chunk, size));
+            count -= size;
+        }
+    }
+
+    /// True if the delivered sequence numbers increase.
+    bool inOrder(void) const {
+        for (size_t i = 1; i < sequences.size(); i++) {
+            if (sequences[i] <= sequences[i - 1]) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+int main(void) {
+    FramePool pool;
+    FrameDispatcher dispatcher;
+    LoopbackTransport fast("fast", BACKPRESSURE_DROP_OLDEST);
+    LoopbackTransport slow_oldest("slow-oldest", BACKPRESSURE_DROP_OLDEST);
+    LoopbackTransport slow_newest("slow-newest", BACKPRESSURE_DROP_NEWEST);
+    LoopbackTransport stalled("stalled", BACKPRESSURE_DROP_NEWEST);
+    LoopbackTransport extra("extra");
+
+    bool registered = dispatcher.addSink(fast) && dispatcher.addSink(slow_oldest) && dispatcher.addSink(slow_newest) &&
+                      dispatcher.addSink(stalled);
+    check(registered && !dispatcher.addSink(extra), "%u sinks registered, one more rejected",
+          (unsigned int)FRAME_DISPATCHER_MAX_SINKS);
+
+    std::vector<Bytes> published;
+    Reader fast_reader(fast, LOOPBACK_BUFFER_SIZE, published);
+    Reader slow_oldest_reader(slow_oldest, SLOW_DRAIN_BYTES, published);
+    Reader slow_newest_reader(slow_newest, SLOW_DRAIN_BYTES, published);
+    Reader stalled_reader(stalled, 0, published);
+    Reader* readers[] = {&fast_reader, &slow_oldest_reader, &slow_newest_reader, &stalled_reader};
+    published.reserve(PUBLISHED_FRAMES);
+
+    printf("publishing %d frames\n", PUBLISHED_FRAMES);
+    RawFrameBuilder builder;
+    bool allocated = true;
+    bool fitting = true;
+    bool fast_kept_up = true;
+    for (int i = 0; i < PUBLISHED_FRAMES; i++) {
+        FrameRef frame = pool.allocate();
+        if (!frame) {
+            allocated = false;
+            break;
+        }
+        size_t n = 10 + (i * 7) % 26;
+        frame.setSize(builder.build(make_channel(n, i * 2 + 1), make_channel(n, i * 2 + 2), 1, frame.mutableData(),
+                                    FRAME_BUFFER_CAPACITY));
+        fitting &= frame.size() > 0 && frame.size() <= FRAME_SINK_DEFAULT_BUDGET;
+        published.push_back(Bytes(frame.data(), frame.data() + frame.size()));
+
+        dispatcher.publish(frame);
+        frame.reset();
+        dispatcher.service();
+        for (Reader* reader : readers) {
+            reader->read(reader->rate);
+        }
+        fast_kept_up &= fast.stats().sent == (uint32_t)i + 1 && fast_reader.sequences.size() == (size_t)i + 1;
+    }
+    check(allocated && fitting, "a pool buffer was free for every frame, each within one service budget");
+    check(fast_kept_up && fast.stats().dropped == 0, "fast sink wrote every frame in the tick it was published");
+
+    for (Reader* reader : readers) {
+        const FrameSinkStats& stats = reader->sink.stats();
+        bool accounted = stats.sent + stats.dropped + reader->sink.queued() == PUBLISHED_FRAMES;
+        check(accounted && reader->sequences.size() <= stats.sent && reader->intact && reader->inOrder() &&
+                  reader->decoder.stats().skipped_bytes == 0 && reader->decoder.stats().rejected_frames == 0,
+              "%-11s %3u sent, %3u dropped, %zu queued, %zu delivered intact and in order", reader->sink.name(),
+              stats.sent, stats.dropped, reader->sink.queued(), reader->sequences.size());
+    }
+
+    // Let every sink write what it still holds
+    for (int i = 0; i < 100; i++) {
+        dispatcher.service();
+        for (Reader* reader : readers) {
+            reader->read(LOOPBACK_BUFFER_SIZE);
+        }
+    }
+
+    printf("after draining\n");
+    bool drained = true;
+    for (Reader* reader : readers) {
+        drained &= reader->sink.queued() == 0 && reader->sink.available() == 0 &&
+                   reader->sequences.size() == reader->sink.stats().sent && reader->intact;
+    }
+    check(drained, "all sinks empty, every sent frame decoded intact");
+
+    const std::vector<uint32_t>& oldest = slow_oldest_reader.sequences;
+    check(!oldest.empty() && oldest.back() == PUBLISHED_FRAMES - 1,
+          "drop-oldest sink ends with the newest frame (%u)", oldest.empty() ? 0 : oldest.back());
+
+    const std::vector<uint32_t>& newest = stalled_reader.sequences;
+    bool first_frames = !newest.empty();
+    for (size_t i = 0; i < newest.size(); i++) {
+        first_frames &= newest[i] == i;
+    }
+    check(first_frames && newest.size() > FRAME_SINK_QUEUE_DEPTH,
+          "stalled drop-newest sink kept the first %zu frames", newest.size());
+
+    check(pool.available() == FRAME_POOL_SIZE, "all %zu pool buffers free", pool.available());
+
+    return check_summary();
+}
@@ -0,0 +1,234 @@
+/**
+ * @file serialization_test.cpp
+ * @brief Checks the frame builders and the hand-off of frames to the sinks.
+ *
+ * @details
+ * The checks cover
+ * - `FrameBuilder`: header, FlatBuffer verification, node, device and every
+ *   sample, identical output of all `build` overloads, and a too small
+ *   destination;
+ * - `RawFrameBuilder`: every header field, the samples, sequence numbers,
+ *   timed frames, a single channel and an invalid device;
+ * - the hand-off: `FramePool` exhaustion and reuse, `FrameRef` reference
+ *   counting through copies, moves and the sink queues, and frames arriving
+ *   byte for byte at a `LoopbackTransport`.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "Check.h"
+#include "TestSamples.h"
+#include "adc/SampleVector.h"
+#include "serial_mail_sender/FrameBuilder.h"
+#include "serial_mail_sender/FrameFormat.h"
+#include "serial_mail_sender/RawFrameBuilder.h"
+#include "serial_mail_sender/SerialMailGenerated.h"
+#include "transport/FrameBuffer.h"
+#include "transport/FrameDispatcher.h"
+#include "transport/LoopbackTransport.h"
+
+/// Samples per channel of the test frames.
+#define SAMPLES 12
+
+typedef std::vector<uint8_t> Bytes;
+
+static uint32_t read_u32(const uint8_t* bytes) {
+    return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+static uint16_t read_u16(const uint8_t* bytes) {
+    return (uint16_t)(bytes[0] | (bytes[1] << 8));
+}
+
+/// True if the frame starts with the marker and its length field matches the size.
+static bool valid_header(const uint8_t* frame, size_t size) {
+    return size >= SERIAL_MAIL_HEADER_SIZE && frame[0] == SERIAL_MAIL_SYNC_BYTE && frame[1] == SERIAL_MAIL_SYNC_BYTE &&
+           read_u32(frame + SERIAL_MAIL_SYNC_SIZE) == size - SERIAL_MAIL_HEADER_SIZE;
+}
+
+/// True if the packed samples equal the channel.
+static bool same_samples(const uint8_t* packed, const SampleVector& channel) {
+    for (size_t i = 0; i < channel.size(); i++) {
+        if (sample_from_bytes(packed + i * SAMPLE_WIRE_SIZE) != channel[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void test_frame_builder(void) {
+    printf("FrameBuilder\n");
+    SampleVector ch0 = make_channel(SAMPLES, 1);
+    SampleVector ch1 = make_channel(SAMPLES, 2);
+    // Both ends of the code range
+    ch0[0] = -SAMPLE_ZERO_CODE;
+    ch0[1] = SAMPLE_ZERO_CODE - 1;
+    ch1[0] = SAMPLE_ZERO_CODE - 1;
+    ch1[1] = -SAMPLE_ZERO_CODE;
+    FrameBuilder builder;
+
+    Bytes frame(FrameBuilder::maxFrameSize<SAMPLES>());
+    size_t size = builder.build(ch0, ch1, 517, frame.data(), frame.size(), 2);
+    const uint8_t* payload = frame.data() + SERIAL_MAIL_HEADER_SIZE;
+    flatbuffers::Verifier verifier(payload, size - SERIAL_MAIL_HEADER_SIZE);
+    bool verified = size > 0 && valid_header(frame.data(), size) && SerialMail::VerifySerialMailBuffer(verifier);
+    check(verified && (payload[0] & 3) == 0, "%zu-byte frame verifies, payload starts on a 4-byte root offset",
+          size);
+
+    bool fields = false;
+    if (verified) {
+        const SerialMail::SerialMail* mail = SerialMail::GetSerialMail(payload);
+        fields = mail->node() == 517 && mail->device() == 2 && mail->ch0()->size() == SAMPLES &&
+                 mail->ch1()->size() == SAMPLES &&
+                 same_samples(reinterpret_cast<const uint8_t*>(mail->ch0()->Data()), ch0) &&
+                 same_samples(reinterpret_cast<const uint8_t*>(mail->ch1()->Data()), ch1);
+    }
+    check(fields, "node, device and all %d samples per channel read back", SAMPLES);
+
+    size_t vector_size = builder.build(ch0, ch1, 517, 2);
+    bool same_vector = vector_size == size && memcmp(builder.data(), frame.data(), size) == 0;
+    std::array<int32_t, SAMPLES> fixed0;
+    std::array<int32_t, SAMPLES> fixed1;
+    std::copy(ch0.begin(), ch0.end(), fixed0.begin());
+    std::copy(ch1.begin(), ch1.end(), fixed1.begin());
+    Bytes fixed_frame(FrameBuilder::maxFrameSize<SAMPLES>());
+    size_t fixed_size = builder.build(fixed0, fixed1, 517, fixed_frame.data());
+    Bytes device0(frame.size());
+    size_t device0_size = builder.build(ch0, ch1, 517, device0.data(), device0.size(), 0);
+    bool same_fixed = fixed_size == device0_size && memcmp(fixed_frame.data(), device0.data(), fixed_size) == 0;
+    check(same_vector && same_fixed, "vector, buffer and std::array overloads write the same frame");
+
+    Bytes small(size - 1);
+    check(builder.build(ch0, ch1, 517, small.data(), small.size(), 2) == 0, "destination one byte short: 0 bytes");
+
+    SampleVector empty;
+    size_t empty_size = builder.build(empty, empty, 3, frame.data(), frame.size());
+    flatbuffers::Verifier empty_verifier(payload, empty_size - SERIAL_MAIL_HEADER_SIZE);
+    check(empty_size >= SERIAL_MAIL_HEADER_SIZE + SERIAL_MAIL_MIN_PAYLOAD_SIZE &&
+              SerialMail::VerifySerialMailBuffer(empty_verifier),
+          "frame without samples verifies (%zu bytes)", empty_size);
+}
+
+static void test_raw_frame_builder(void) {
+    printf("RawFrameBuilder\n");
+    SampleVector ch0 = make_channel(SAMPLES, 3);
+    SampleVector ch1 = make_channel(SAMPLES, 4);
+    // Both ends of the code range
+    ch0[0] = -SAMPLE_ZERO_CODE;
+    ch0[1] = SAMPLE_ZERO_CODE - 1;
+    ch1[0] = SAMPLE_ZERO_CODE - 1;
+    ch1[1] = -SAMPLE_ZERO_CODE;
+    RawFrameBuilder builder;
+    Bytes frame(RawFrameBuilder::maxFrameSize<SAMPLES>());
+
+    bool layout = true;
+    for (uint32_t sequence = 0; sequence < 3; sequence++) {
+        size_t size = builder.build(ch0, ch1, 0x1234, frame.data(), frame.size(), 1);
+        const uint8_t* header = frame.data() + SERIAL_MAIL_HEADER_SIZE;
+        layout &= size == SERIAL_MAIL_HEADER_SIZE + raw_frame_payload_size(SAMPLES) &&
+                  valid_header(frame.data(), size) && header[0] == RAW_FRAME_VERSION &&
+                  read_u16(header + RAW_FRAME_NODE_OFFSET) == 0x1234 &&
+                  header[RAW_FRAME_MASK_OFFSET] == raw_frame_device_mask(1) &&
+                  read_u16(header + RAW_FRAME_COUNT_OFFSET) == SAMPLES &&
+                  read_u32(header + RAW_FRAME_SEQUENCE_OFFSET) == sequence &&
+                  same_samples(header + RAW_FRAME_HEADER_SIZE, ch0) &&
+                  same_samples(header + RAW_FRAME_HEADER_SIZE + SAMPLES * SAMPLE_WIRE_SIZE, ch1);
+    }
+    check(layout && builder.sequence() == 3, "header fields, samples and sequence 0..2");
+
+    RawFrameBuilder timed(true);
+    size_t size = timed.build(ch0, ch1, 7, frame.data(), frame.size(), 0, 0x0102030405060708ull);
+    const uint8_t* header = frame.data() + SERIAL_MAIL_HEADER_SIZE;
+    uint64_t time_us = (uint64_t)read_u32(header + RAW_FRAME_HEADER_SIZE) |
+                       ((uint64_t)read_u32(header + RAW_FRAME_HEADER_SIZE + 4) << 32);
+    check(size == SERIAL_MAIL_HEADER_SIZE + raw_frame_timed_payload_size(SAMPLES) &&
+              header[0] == RAW_FRAME_TIMED_VERSION && time_us == 0x0102030405060708ull &&
+              same_samples(header + RAW_FRAME_TIMED_HEADER_SIZE, ch0),
+          "timed frame carries the time in front of the samples");
+
+    SampleVector empty;
+    size = builder.build(ch0, empty, 7, frame.data(), frame.size());
+    check(size == SERIAL_MAIL_HEADER_SIZE + raw_frame_payload_size(SAMPLES, 1) &&
+              frame[SERIAL_MAIL_HEADER_SIZE + RAW_FRAME_MASK_OFFSET] == RAW_FRAME_CHANNEL_0,
+          "single channel: mask and size of one channel");
+
+    uint32_t before = builder.sequence();
+    bool rejected = builder.build(ch0, ch1, 7, frame.data(), frame.size(), RAW_FRAME_MAX_DEVICES) == 0 &&
+                    builder.build(ch0, ch1, 7, frame.data(), SERIAL_MAIL_HEADER_SIZE + RAW_FRAME_HEADER_SIZE) == 0;
+    check(rejected && builder.sequence() == before, "invalid device and short destination: 0 bytes, sequence kept");
+}
+
+static void test_hand_off(void) {
+    printf("hand-off\n");
+    FramePool pool;
+    std::vector<FrameRef> held;
+    for (int i = 0; i < FRAME_POOL_SIZE; i++) {
+        held.push_back(pool.allocate());
+    }
+    FrameRef none = pool.allocate();
+    bool all_taken = !none && pool.available() == 0;
+    held.pop_back();
+    FrameRef reused = pool.allocate();
+    check(all_taken && reused && pool.available() == 0,
+          "%d buffers taken, the next allocation fails, a freed one is reused", FRAME_POOL_SIZE);
+    held.clear();
+    reused.reset();
+
+    FrameRef frame = pool.allocate();
+    FrameRef copy = frame;
+    FrameRef moved = std::move(copy);
+    bool shared = !copy && moved.data() == frame.data() && pool.available() == FRAME_POOL_SIZE - 1;
+    frame.reset();
+    bool kept = pool.available() == FRAME_POOL_SIZE - 1;
+    moved.reset();
+    check(shared && kept && pool.available() == FRAME_POOL_SIZE,
+          "copies and moves share one buffer, freed with the last handle");
+
+    FrameDispatcher dispatcher;
+    LoopbackTransport first("first");
+    LoopbackTransport second("second");
+    dispatcher.addSink(first);
+    dispatcher.addSink(second);
+
+    SampleVector ch0 = make_channel(SAMPLES, 5);
+    SampleVector ch1 = make_channel(SAMPLES, 6);
+    FrameBuilder builder;
+    std::vector<Bytes> sent;
+    for (int i = 0; i < 3; i++) {
+        FrameRef built = pool.allocate();
+        built.setSize(builder.build(ch0, ch1, i, built.mutableData(), FRAME_BUFFER_CAPACITY));
+        sent.push_back(Bytes(built.data(), built.data() + built.size()));
+        dispatcher.publish(built);
+    }
+    bool queued = pool.available() == FRAME_POOL_SIZE - 3 && first.queued() == 3 && second.queued() == 3;
+
+    // Three frames take more than one service budget
+    int services = 0;
+    while ((first.queued() > 0 || second.queued() > 0) && services < 10) {
+        dispatcher.service();
+        services++;
+    }
+    Bytes expected;
+    for (const Bytes& bytes : sent) {
+        expected.insert(expected.end(), bytes.begin(), bytes.end());
+    }
+    Bytes received_first(LOOPBACK_BUFFER_SIZE);
+    Bytes received_second(LOOPBACK_BUFFER_SIZE);
+    received_first.resize(first.read(received_first.data(), received_first.size()));
+    received_second.resize(second.read(received_second.data(), received_second.size()));
+    check(queued && received_first == expected && received_second == expected &&
+              pool.available() == FRAME_POOL_SIZE,
+          "3 frames in one buffer each reach both sinks byte for byte in %d services, buffers freed after the last write",
+          services);
+}
+
+int main(void) {
+    test_frame_builder();
+    test_raw_frame_builder();
+    test_hand_off();
+    return check_summary();
+}
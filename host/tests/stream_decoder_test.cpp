@@ -0,0 +1,434 @@
+/**
+ * @file stream_decoder_test.cpp
+ * @brief Feeds the `StreamDecoder` corrupted and arbitrarily split streams.
+ *
+ * @details
+ * The streams consist of FlatBuffer and raw frames built by the node's own
+ * builders. The checks cover
+ * - a clean stream, fed at once, split at every byte into two chunks, into
+ *   every pair of three chunks, and fed byte by byte;
+ * - garbage, including lone and paired `0xAA`, before the first marker;
+ * - length fields above the accepted maximum and below the minimum;
+ * - frames truncated at every byte, followed by intact frames;
+ * - every single bit flip in a FlatBuffer and in a raw frame, in front of a
+ *   tail longer than the largest accepted payload;
+ * - fake `0xAAAA` + length inside sample payloads, found while resyncing;
+ * - a gap in the raw frame sequence.
+ *
+ * Besides the delivered frames, every check compares the `DecoderStats`.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <span>
+#include <vector>
+
+#include "Check.h"
+#include "TestSamples.h"
+#include "adc/SampleVector.h"
+#include "serial_mail_sender/FrameBuilder.h"
+#include "serial_mail_sender/FrameFormat.h"
+#include "serial_mail_sender/RawFrameBuilder.h"
+#include "stream_decoder/StreamDecoder.h"
+
+/// Frames of the tail appended to the bit flip streams, more than the largest accepted payload.
+#define FLIP_TAIL_FRAMES 200
+
+typedef std::vector<uint8_t> Bytes;
+
+/**
+ * @struct Captured
+ * @brief Copy of a delivered frame.
+ */
+struct Captured {
+    Bytes    frame;     ///< Header and payload.
+    size_t   offset;    ///< Position of the frame in a stream fed at once.
+};
+
+static Bytes flatbuffer_frame(const SampleVector& ch0, const SampleVector& ch1, int node, unsigned int device = 0) {
+    FrameBuilder builder;
+    Bytes frame(SERIAL_MAIL_HEADER_SIZE + SERIAL_MAIL_MAX_PAYLOAD_SIZE);
+    frame.resize(builder.build(ch0, ch1, node, frame.data(), frame.size(), device));
+    return frame;
+}
+
+static Bytes raw_frame(RawFrameBuilder& builder, const SampleVector& ch0, const SampleVector& ch1, int node) {
+    Bytes frame(SERIAL_MAIL_HEADER_SIZE + SERIAL_MAIL_MAX_PAYLOAD_SIZE);
+    frame.resize(builder.build(ch0, ch1, node, frame.data(), frame.size()));
+    return frame;
+}
+
+static void append(Bytes& stream, const Bytes& bytes) {
+    stream.insert(stream.end(), bytes.begin(), bytes.end());
+}
+
+/**
+ * @brief Decodes a stream fed in the given chunks.
+ * @param stream Complete stream.
+ * @param cuts Positions the stream is split at, ascending.
+ * @param stats Receives the decoder statistics.
+ * @return Delivered frames.
+ */
+static std::vector<Captured> decode(const Bytes& stream, const std::vector<size_t>& cuts, DecoderStats& stats) {
+    std::vector<Captured> frames;
+    StreamDecoder decoder([&](const DecodedFrame& decoded) {
+        const uint8_t* begin = decoded.frame.data();
+        bool in_stream = begin >= stream.data() && begin < stream.data() + stream.size();
+        frames.push_back({Bytes(decoded.frame.begin(), decoded.frame.end()),
+                          in_stream ? (size_t)(begin - stream.data()) : SIZE_MAX});
+    });
+    size_t start = 0;
+    for (size_t cut : cuts) {
+        decoder.feed(std::span<const uint8_t>(stream.data() + start, cut - start));
+        start = cut;
+    }
+    decoder.feed(std::span<const uint8_t>(stream.data() + start, stream.size() - start));
+    stats = decoder.stats();
+    return frames;
+}
+
+static std::vector<Captured> decode(const Bytes& stream, DecoderStats& stats) {
+    return decode(stream, {}, stats);
+}
+
+static bool same_frames(const std::vector<Captured>& decoded, const std::vector<Bytes>& expected) {
+    if (decoded.size() != expected.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < expected.size(); i++) {
+        if (decoded[i].frame != expected[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool same_stats(const DecoderStats& a, const DecoderStats& b) {
+    return a.bytes == b.bytes && a.frames == b.frames && a.samples == b.samples &&
+           a.skipped_bytes == b.skipped_bytes && a.rejected_frames == b.rejected_frames &&
+           a.raw_frames == b.raw_frames && a.missed_frames == b.missed_frames;
+}
+
+/**
+ * @brief Stream of FlatBuffer and raw frames of different sizes, nodes and devices.
+ * @param frames Receives the frames in stream order.
+ * @param samples Receives the samples over both channels.
+ */
+static Bytes mixed_stream(size_t count, std::vector<Bytes>& frames, uint64_t& samples, uint64_t& raw) {
+    RawFrameBuilder raw_builder;
+    Bytes stream;
+    samples = 0;
+    raw = 0;
+    for (size_t i = 0; i < count; i++) {
+        size_t n = 1 + (i * 7) % 23;
+        SampleVector ch0 = make_channel(n, (uint32_t)i * 2 + 1);
+        SampleVector ch1 = make_channel(i % 5 == 4 ? 0 : n, (uint32_t)i * 2 + 2);
+        if (i % 3 == 2) {
+            frames.push_back(raw_frame(raw_builder, ch0, ch1, (int)(i % 4)));
+            raw++;
+        } else {
+            frames.push_back(flatbuffer_frame(ch0, ch1, (int)(i % 4), (unsigned int)(i % 2)));
+        }
+        samples += ch0.size() + ch1.size();
+        append(stream, frames.back());
+    }
+    return stream;
+}
+
+/**
+ * @brief Decodes a corrupted frame followed by intact ones and checks what came through.
+ * @param stream Corrupted bytes followed by the intact frames.
+ * @param corrupted_size Bytes of the corrupted part.
+ * @param frames Intact frames following it.
+ * @param delivered Set if the corrupted part was delivered as a frame.
+ * @return True if at most one corrupted frame was delivered, every intact frame not covered by it arrived
+ *         unchanged, and the statistics account for every byte.
+ *
+ * @details
+ * Frames carry no checksum: a corrupted sample, a raw frame cut short behind
+ * an intact header, or a FlatBuffer length made larger may still pass
+ * verification and take the start of the next frame with it. A valid frame
+ * must never be lost otherwise.
+ */
+static bool recovered(const Bytes& stream, size_t corrupted_size, const std::vector<Bytes>& frames, bool& delivered) {
+    DecoderStats stats;
+    std::vector<Captured> decoded = decode(stream, stats);
+    size_t foreign = 0;
+    size_t covered_end = 0;
+    uint64_t delivered_bytes = 0;
+    for (const Captured& captured : decoded) {
+        delivered_bytes += captured.frame.size();
+        if (captured.offset < corrupted_size) {
+            foreign++;
+            covered_end = captured.offset + captured.frame.size();
+        }
+    }
+    delivered = foreign > 0;
+    bool ok = foreign <= 1 && stats.bytes == stream.size() && stats.frames == decoded.size() &&
+              stats.skipped_bytes + delivered_bytes == stream.size() && (delivered || stats.skipped_bytes >= corrupted_size);
+
+    size_t offset = corrupted_size;
+    size_t next = 0;
+    for (const Bytes& expected : frames) {
+        while (next < decoded.size() && decoded[next].offset < offset) {
+            next++;
+        }
+        bool found = next < decoded.size() && decoded[next].offset == offset && decoded[next].frame == expected;
+        ok &= found || offset < covered_end;
+        offset += expected.size();
+    }
+    return ok;
+}
+
+static void test_clean_and_split(void) {
+    printf("clean stream, every split\n");
+    std::vector<Bytes> frames;
+    uint64_t samples;
+    uint64_t raw;
+    Bytes stream = mixed_stream(30, frames, samples, raw);
+
+    DecoderStats whole;
+    std::vector<Captured> decoded = decode(stream, whole);
+    check(same_frames(decoded, frames), "%zu frames of %zu bytes delivered unchanged", decoded.size(), stream.size());
+    check(whole.bytes == stream.size() && whole.frames == frames.size() && whole.samples == samples &&
+          whole.raw_frames == raw && whole.skipped_bytes == 0 && whole.rejected_frames == 0 &&
+          whole.missed_frames == 0,
+          "stats: %llu frames, %llu raw, %llu samples, nothing skipped or rejected",
+          (unsigned long long)whole.frames, (unsigned long long)whole.raw_frames, (unsigned long long)whole.samples);
+
+    size_t failed = 0;
+    DecoderStats stats;
+    for (size_t cut = 0; cut <= stream.size(); cut++) {
+        failed += !(same_frames(decode(stream, {cut}, stats), frames) && same_stats(stats, whole));
+    }
+    check(failed == 0, "split into two chunks at each of %zu positions (%zu differ)", stream.size() + 1, failed);
+
+    std::vector<size_t> every_byte;
+    for (size_t i = 1; i < stream.size(); i++) {
+        every_byte.push_back(i);
+    }
+    check(same_frames(decode(stream, every_byte, stats), frames) && same_stats(stats, whole), "fed byte by byte");
+
+    // Three chunks need a short stream: every pair of cuts
+    std::vector<Bytes> short_frames(frames.begin(), frames.begin() + 4);
+    Bytes short_stream;
+    for (const Bytes& frame : short_frames) {
+        append(short_stream, frame);
+    }
+    DecoderStats short_whole;
+    decode(short_stream, short_whole);
+    failed = 0;
+    size_t pairs = 0;
+    for (size_t a = 0; a <= short_stream.size(); a++) {
+        for (size_t b = a; b <= short_stream.size(); b++, pairs++) {
+            failed += !(same_frames(decode(short_stream, {a, b}, stats), short_frames) && same_stats(stats, short_whole));
+        }
+    }
+    check(failed == 0, "split into three chunks at each of %zu pairs of positions (%zu differ)", pairs, failed);
+}
+
+static void test_garbage(void) {
+    printf("garbage before the first marker\n");
+    std::vector<Bytes> frames;
+    uint64_t samples;
+    uint64_t raw;
+    Bytes stream = mixed_stream(6, frames, samples, raw);
+
+    const Bytes patterns[] = {
+        {0x00, 0x13, 0x55, 0xFF},
+        {0xAA},
+        {0xAA, 0x00, 0xAA, 0x01, 0xAA},
+        {0xAA, 0xAA},
+        {0xAA, 0xAA, 0xAA},
+        {0xAA, 0xAA, 0x20, 0x00, 0x00, 0x00, 0x01, 0x02},   // plausible length running into the first frame
+        {0xAA, 0xAA, 0x0C, 0x00, 0x00},                     // header cut short by the real marker
+    };
+    for (const Bytes& pattern : patterns) {
+        for (size_t repeat = 1; repeat <= 8; repeat *= 2) {
+            Bytes garbage;
+            for (size_t i = 0; i < repeat; i++) {
+                append(garbage, pattern);
+            }
+            Bytes corrupted = garbage;
+            append(corrupted, stream);
+
+            bool ok = true;
+            DecoderStats stats;
+            ok &= same_frames(decode(corrupted, stats), frames);
+            ok &= stats.skipped_bytes == garbage.size() && stats.frames == frames.size() && stats.samples == samples;
+            DecoderStats split;
+            for (size_t cut = 0; cut <= garbage.size() + SERIAL_MAIL_HEADER_SIZE; cut++) {
+                ok &= same_frames(decode(corrupted, {cut}, split), frames) && same_stats(split, stats);
+            }
+            check(ok, "%2zu bytes of garbage starting %02X %02X: all frames, %llu skipped, %llu rejected",
+                  garbage.size(), garbage[0], garbage.size() > 1 ? garbage[1] : 0,
+                  (unsigned long long)stats.skipped_bytes, (unsigned long long)stats.rejected_frames);
+        }
+    }
+}
+
+static void test_length_fields(void) {
+    printf("length fields out of range\n");
+    std::vector<Bytes> frames;
+    uint64_t samples;
+    uint64_t raw;
+    Bytes stream = mixed_stream(6, frames, samples, raw);
+
+    const uint32_t lengths[] = {0, 1, SERIAL_MAIL_MIN_PAYLOAD_SIZE - 1, SERIAL_MAIL_MAX_PAYLOAD_SIZE + 1, 0x00FFFFFF,
+                                0xFFFFFFFF};
+    for (uint32_t length : lengths) {
+        const uint8_t header[SERIAL_MAIL_HEADER_SIZE] = {0xAA, 0xAA, (uint8_t)length, (uint8_t)(length >> 8),
+                                                         (uint8_t)(length >> 16), (uint8_t)(length >> 24)};
+        Bytes corrupted = stream;
+        corrupted.insert(corrupted.begin(), header, header + SERIAL_MAIL_HEADER_SIZE);
+        DecoderStats stats;
+        bool ok = same_frames(decode(corrupted, stats), frames);
+        ok = ok && stats.rejected_frames == 1 && stats.skipped_bytes == SERIAL_MAIL_HEADER_SIZE &&
+              stats.frames == frames.size();
+        check(ok, "length %10u: rejected once, header skipped, all frames delivered", length);
+    }
+
+    // A frame above a lowered maximum is rejected instead of waited for
+    Bytes big = flatbuffer_frame(make_channel(30, 1), make_channel(30, 2), 1);
+    Bytes corrupted = big;
+    append(corrupted, stream);
+    std::vector<Bytes> delivered;
+    StreamDecoder decoder([&](const DecodedFrame& frame) { delivered.emplace_back(frame.frame.begin(), frame.frame.end()); },
+                          (uint32_t)(big.size() - SERIAL_MAIL_HEADER_SIZE - 1));
+    decoder.feed(corrupted);
+    check(delivered == frames && decoder.stats().rejected_frames >= 1 && decoder.stats().skipped_bytes == big.size(),
+          "frame of %zu bytes above max_payload_size: skipped, %zu frames behind it delivered", big.size(),
+          delivered.size());
+}
+
+static void test_truncated(void) {
+    printf("truncated frames\n");
+    std::vector<Bytes> frames;
+    uint64_t samples;
+    uint64_t raw;
+    Bytes stream = mixed_stream(8, frames, samples, raw);
+    std::vector<Bytes> tail(frames.begin() + 1, frames.end());
+    Bytes tail_stream(stream.begin() + frames[0].size(), stream.end());
+
+    for (size_t which = 0; which < 3; which++) {
+        const Bytes& frame = frames[which];
+        size_t failed = 0;
+        size_t detected = 0;
+        for (size_t keep = 1; keep < frame.size(); keep++) {
+            Bytes corrupted(frame.begin(), frame.begin() + keep);
+            append(corrupted, tail_stream);
+            bool delivered;
+            failed += !recovered(corrupted, keep, tail, delivered);
+            detected += !delivered;
+        }
+        check(failed == 0, "%s frame of %zu bytes cut at every byte: %zu rejected, no intact frame lost",
+              is_raw_frame_payload(frame[SERIAL_MAIL_HEADER_SIZE]) ? "raw" : "FlatBuffer", frame.size(), detected);
+    }
+
+    // A frame cut off at the end of the stream stays pending
+    Bytes cut(stream.begin(), stream.end() - 1);
+    DecoderStats stats;
+    std::vector<Bytes> all_but_last(frames.begin(), frames.end() - 1);
+    bool delivered = same_frames(decode(cut, stats), all_but_last);
+    check(delivered && stats.rejected_frames == 0 && stats.skipped_bytes == 0,
+          "last frame incomplete at the end of the stream: kept pending, not rejected");
+}
+
+/**
+ * @brief Flips every bit of one frame in front of a tail longer than the largest accepted payload.
+ */
+static void test_bit_flips(const char* name, const Bytes& frame) {
+    std::vector<Bytes> frames;
+    uint64_t samples;
+    uint64_t raw;
+    Bytes tail_stream = mixed_stream(FLIP_TAIL_FRAMES, frames, samples, raw);
+
+    size_t failed = 0;
+    size_t detected = 0;
+    for (size_t bit = 0; bit < frame.size() * 8; bit++) {
+        Bytes corrupted = frame;
+        corrupted[bit / 8] ^= (uint8_t)(1 << (bit % 8));
+        append(corrupted, tail_stream);
+        bool delivered;
+        failed += !recovered(corrupted, frame.size(), frames, delivered);
+        detected += !delivered;
+    }
+    check(failed == 0, "%s frame, %zu bit flips: %zu rejected, no intact frame lost", name, frame.size() * 8,
+          detected);
+}
+
+static void test_fake_markers(void) {
+    printf("fake markers inside payloads\n");
+    // Samples whose big-endian codes read AA AA 0C | 00 00 00 | AA AA 40 | 00 00 00: markers with plausible lengths
+    SampleVector ch0;
+    for (int i = 0; i < 6; i++) {
+        ch0.push_back(0xAAAA0C - SAMPLE_ZERO_CODE);
+        ch0.push_back(0x000000 - SAMPLE_ZERO_CODE);
+        ch0.push_back(0xAAAA40 - SAMPLE_ZERO_CODE);
+        ch0.push_back(0x000000 - SAMPLE_ZERO_CODE);
+    }
+    RawFrameBuilder raw_builder;
+    Bytes fake_flatbuffer = flatbuffer_frame(ch0, ch0, 3);
+    Bytes fake_raw = raw_frame(raw_builder, ch0, ch0, 3);
+    Bytes after = flatbuffer_frame(make_channel(10, 7), make_channel(10, 8), 4);
+
+    for (const Bytes* fake : {&fake_flatbuffer, &fake_raw}) {
+        size_t markers = 0;
+        for (size_t i = SERIAL_MAIL_HEADER_SIZE; i + 1 < fake->size(); i++) {
+            markers += (*fake)[i] == 0xAA && (*fake)[i + 1] == 0xAA;
+        }
+
+        Bytes intact = *fake;
+        append(intact, after);
+        DecoderStats stats;
+        bool delivered = same_frames(decode(intact, stats), {*fake, after});
+        check(delivered && stats.skipped_bytes == 0,
+              "%s frame with %zu fake markers in its payload delivered as a whole",
+              fake == &fake_raw ? "raw" : "FlatBuffer", markers);
+
+        // With its own marker destroyed the decoder has to resync across the fake ones
+        Bytes corrupted = intact;
+        corrupted[0] = 0x55;
+        size_t failed = 0;
+        for (size_t cut = 0; cut <= corrupted.size(); cut++) {
+            DecoderStats split;
+            failed += !(same_frames(decode(corrupted, {cut}, split), {after}) && split.skipped_bytes == fake->size());
+        }
+        check(failed == 0, "marker destroyed: fake markers skipped, next frame delivered at every split (%zu failed)",
+              failed);
+    }
+}
+
+static void test_sequence_gap(void) {
+    printf("raw frame sequence\n");
+    RawFrameBuilder builder;
+    Bytes stream;
+    std::vector<Bytes> sent;
+    for (int i = 0; i < 10; i++) {
+        Bytes frame = raw_frame(builder, make_channel(5, i), make_channel(5, i + 100), 1);
+        if (i != 4 && i != 7) {
+            append(stream, frame);
+            sent.push_back(frame);
+        }
+    }
+    DecoderStats stats;
+    bool delivered = same_frames(decode(stream, stats), sent);
+    check(delivered && stats.raw_frames == 8 && stats.missed_frames == 2,
+          "2 of 10 raw frames dropped: %llu missed", (unsigned long long)stats.missed_frames);
+}
+
+int main(void) {
+    test_clean_and_split();
+    test_garbage();
+    test_length_fields();
+    test_truncated();
+
+    printf("bit flips\n");
+    RawFrameBuilder raw_builder;
+    test_bit_flips("FlatBuffer", flatbuffer_frame(make_channel(8, 11), make_channel(8, 12), 2));
+    test_bit_flips("raw", raw_frame(raw_builder, make_channel(8, 11), make_channel(8, 12), 2));
+
+    test_fake_markers();
+    test_sequence_gap();
+    return check_summary();
+}
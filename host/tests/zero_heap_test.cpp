@@ -0,0 +1,236 @@
+/**
+ * @file zero_heap_test.cpp
+ * @brief Runs the `ZERO_HEAP` pipeline path and fails if it allocates after the first frame.
+ *
+ * @details
+ * The test target compiles its own copy of the pipeline sources with
+ * `ZERO_HEAP`, like the firmware built with that option. The global
+ * allocation functions are replaced by counting ones, which take the place
+ * of `mbed_stats_heap_get` in the node's `HeapGuard`.
+ *
+ * Conversion words go through a `SampleCollector`, are handed over in mail
+ * slots as in `ReadingQueue`, and are serialized alternately by the
+ * `FrameBuilder` and the `RawFrameBuilder` into pooled buffers. The frames
+ * are then published to a fast and a stalled loopback sink. As on the node,
+ * the first frame ends startup; the checks cover
+ * - no allocation and no allocated byte during all following frames;
+ * - every frame read from the fast sink being complete and valid;
+ * - the counting itself, with an explicit allocation.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include "Check.h"
+#include "adc/SampleCollector.h"
+#include "adc/SampleVector.h"
+#include "config/PipelineConfig.h"
+#include "serial_mail_sender/FrameBuilder.h"
+#include "serial_mail_sender/FrameFormat.h"
+#include "serial_mail_sender/RawFrameBuilder.h"
+#include "serial_mail_sender/SerialMailGenerated.h"
+#include "transport/FrameBuffer.h"
+#include "transport/FrameDispatcher.h"
+#include "transport/LoopbackTransport.h"
+
+#if !defined(ZERO_HEAP)
+#error "The zero-heap test must be compiled with ZERO_HEAP"
+#endif
+
+/// Frames sent after startup.
+#define STEADY_STATE_FRAMES 5000
+
+/// Mail slots between acquisition and serialization, as `READING_QUEUE_DEPTH`.
+#define MAIL_SLOTS (2 + 2 * PhytoConfig::devices)
+
+static size_t allocations = 0;      ///< Calls of the allocation functions.
+static size_t allocated_bytes = 0;  ///< Bytes requested from them.
+
+static void* counted_allocate(size_t size) {
+    allocations++;
+    allocated_bytes += size;
+    void* p = malloc(size > 0 ? size : 1);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new(size_t size) { return counted_allocate(size); }
+void* operator new[](size_t size) { return counted_allocate(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    allocations++;
+    allocated_bytes += size;
+    return malloc(size > 0 ? size : 1);
+}
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept { return operator new(size, tag); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+/**
+ * @struct Mail
+ * @brief Samples handed from acquisition to serialization, as `ReadingQueue::mail_t`.
+ */
+struct Mail {
+    SampleVector ch0;       ///< Samples of channel 0.
+    SampleVector ch1;       ///< Samples of channel 1.
+    uint8_t      device;    ///< AD7124 the samples come from.
+};
+
+/**
+ * @brief Checks one frame read from the loopback sink.
+ * @return True if the header is intact and the payload a valid `SerialMail` or raw frame.
+ */
+static bool valid_frame(const uint8_t* frame, size_t size) {
+    uint16_t marker;
+    uint32_t payload_size;
+    memcpy(&marker, frame, sizeof(marker));
+    memcpy(&payload_size, frame + SERIAL_MAIL_SYNC_SIZE, sizeof(payload_size));
+    if (marker != SERIAL_MAIL_SYNC_MARKER || SERIAL_MAIL_HEADER_SIZE + payload_size != size) {
+        return false;
+    }
+    const uint8_t* payload = frame + SERIAL_MAIL_HEADER_SIZE;
+    if (payload[0] == RAW_FRAME_VERSION) {
+        return payload_size == raw_frame_payload_size(PhytoConfig::vector_size);
+    }
+    flatbuffers::Verifier verifier(payload, payload_size);
+    return SerialMail::VerifySerialMailBuffer(verifier) &&
+           SerialMail::GetSerialMail(payload)->ch0()->size() == PhytoConfig::vector_size;
+}
+
+/**
+ * @struct Pipeline
+ * @brief Node objects of the steady-state path, all created at startup.
+ */
+struct Pipeline {
+    SampleCollector   collector{PhytoConfig::vector_size};
+    Mail              mails[MAIL_SLOTS];
+    size_t            next_mail = 0;
+    FrameBuilder      frame_builder;
+    RawFrameBuilder   raw_builder;
+    FramePool         pool;
+    FrameDispatcher   dispatcher;
+    LoopbackTransport fast{"fast", BACKPRESSURE_DROP_OLDEST};
+    LoopbackTransport stalled{"stalled", BACKPRESSURE_DROP_NEWEST};
+    uint32_t          state = 1;
+    uint8_t           wire[LOOPBACK_BUFFER_SIZE];
+    size_t            wire_size = 0;
+    size_t            frames = 0;
+    size_t            invalid = 0;
+
+    Pipeline(void) {
+        dispatcher.addSink(fast);
+        dispatcher.addSink(stalled);
+    }
+
+    /// Reads conversion words until a frame is complete and hands it over in the next mail slot.
+    Mail& acquire(void) {
+        uint8_t word[AD7124_CONVERSION_WORD_SIZE];
+        uint8_t channel = 0;
+        do {
+            state = state * 1664525u + 1013904223u;
+            word[0] = (uint8_t)(state >> 24);
+            word[1] = (uint8_t)(state >> 16);
+            word[2] = (uint8_t)(state >> 8);
+            word[3] = channel;
+            channel ^= 1;
+        } while (!collector.push(word));
+
+        Mail& mail = mails[next_mail];
+        next_mail = (next_mail + 1) % MAIL_SLOTS;
+        mail.ch0 = collector.ch0();
+        mail.ch1 = collector.ch1();
+        mail.device = (uint8_t)(frames % PhytoConfig::devices);
+        collector.clear();
+        return mail;
+    }
+
+    /// Serializes the mail into a pooled buffer and publishes it, like `SerialMailSender::sendMail`.
+    void send(const Mail& mail) {
+        FrameRef frame = pool.allocate();
+        if (!frame) {
+            dispatcher.service();
+            frame = pool.allocate();
+        }
+        if (!frame) {
+            invalid++;
+            return;
+        }
+        size_t size = (frames % 2 == 0)
+            ? frame_builder.build(mail.ch0, mail.ch1, PhytoConfig::node, frame.mutableData(), FRAME_BUFFER_CAPACITY,
+                                  mail.device)
+            : raw_builder.build(mail.ch0, mail.ch1, PhytoConfig::node, frame.mutableData(), FRAME_BUFFER_CAPACITY,
+                                mail.device);
+        frame.setSize(size);
+        dispatcher.publish(frame);
+        frames++;
+    }
+
+    /// Sends the next frame and services the sinks until the fast one has written it.
+    void step(void) {
+        send(acquire());
+        do {
+            dispatcher.service();
+            receive();
+        } while (fast.queued() > 0);
+    }
+
+    /// Takes the bytes of the fast sink and checks every complete frame.
+    void receive(void) {
+        wire_size += fast.read(wire + wire_size, sizeof(wire) - wire_size);
+        while (wire_size >= SERIAL_MAIL_HEADER_SIZE) {
+            uint32_t payload_size;
+            memcpy(&payload_size, wire + SERIAL_MAIL_SYNC_SIZE, sizeof(payload_size));
+            size_t size = SERIAL_MAIL_HEADER_SIZE + payload_size;
+            if (size > sizeof(wire)) {
+                invalid++;
+                wire_size = 0;
+                return;
+            }
+            if (wire_size < size) {
+                return;
+            }
+            invalid += !valid_frame(wire, size);
+            memmove(wire, wire + size, wire_size - size);
+            wire_size -= size;
+        }
+    }
+};
+
+int main(void) {
+    printf("preset: %u samples per channel, %u device(s), sample vector capacity %u\n",
+           PhytoConfig::vector_size, PhytoConfig::devices, (unsigned int)SAMPLE_VECTOR_CAPACITY);
+
+    static Pipeline pipeline;
+
+    // The first frame ends startup, as on the node
+    pipeline.step();
+    size_t armed_allocations = allocations;
+    size_t armed_bytes = allocated_bytes;
+
+    for (int i = 0; i < STEADY_STATE_FRAMES; i++) {
+        pipeline.step();
+    }
+
+    size_t steady_allocations = allocations - armed_allocations;
+    size_t steady_bytes = allocated_bytes - armed_bytes;
+    check(steady_allocations == 0 && steady_bytes == 0, "%d frames after startup: %zu allocations, %zu bytes",
+          STEADY_STATE_FRAMES, steady_allocations, steady_bytes);
+
+    const FrameSinkStats& fast = pipeline.fast.stats();
+    const FrameSinkStats& stalled = pipeline.stalled.stats();
+    check(pipeline.invalid == 0 && fast.sent == STEADY_STATE_FRAMES + 1 && fast.dropped == 0,
+          "fast sink: %u frames sent, %zu invalid", fast.sent, pipeline.invalid);
+    check(stalled.dropped > 0 && stalled.sent + stalled.dropped + pipeline.stalled.queued() == STEADY_STATE_FRAMES + 1,
+          "stalled sink: %u frames dropped without allocating", stalled.dropped);
+
+    void* probe = ::operator new(16);
+    ::operator delete(probe);
+    check(allocations == armed_allocations + 1, "an explicit allocation is counted");
+
+    return check_summary();
+}
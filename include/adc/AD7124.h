@@ -6,6 +6,38 @@
 // Handle Body idiom could be applied to remove mbed.h
 // from header entirely
 #include "mbed.h"   
+#include "adc/SampleVector.h"
+
+#if defined(WARM_RESTART)
+#include "storage/RetainedState.h"
+#endif
+
+/// DOUT/RDY pin of the AD7124, shared between SPI MISO and the data ready signal.
+#define AD7124_DRDY_PIN PA_6
+
+/// SPI MOSI pin of the AD7124 bus.
+#define AD7124_MOSI_PIN PA_7
+
+/// SPI clock pin of the AD7124 bus.
+#define AD7124_SCLK_PIN PA_5
+
+/// Chip select of the first (or only) AD7124.
+#define AD7124_CS_PIN PA_4
+
+/// SYNC input of all AD7124, held high except to restart their conversions together.
+#define AD7124_SYNC_PIN PA_1
+
+/// `CLK_SEL` value: internal 614.4 kHz clock, CLK pin unused.
+#define AD7124_CLOCK_INTERNAL 0
+
+/// `CLK_SEL` value: internal clock, also driven onto the CLK pin for the other devices.
+#define AD7124_CLOCK_INTERNAL_OUTPUT 1
+
+/// `CLK_SEL` value: clock taken from the CLK pin.
+#define AD7124_CLOCK_EXTERNAL 2
+
+class AD7124Bus;
+class SelfBenchmark;
 
 /**
  * @class AD7124
@@ -14,6 +46,15 @@
  * The AD7124 class provides methods for initializing and interacting with the AD7124
  * Analog-to-Digital Converter (ADC) via SPI. It supports configuration of ADC channels,
  * reading voltage data, and resetting or controlling the device.
+ *
+ * `getInstance` drives the single converter of a node, which keeps its chip
+ * select low. Nodes with several converters create them through `AD7124Bus`
+ * instead, where every device shares the SPI object and is selected only for
+ * its own transfers.
+ *
+ * With `WARM_RESTART`, the single converter is not reprogrammed after a
+ * warm reset if it still converts with the registers of the previous run;
+ * devices on an `AD7124Bus` are always initialized.
  */
 class AD7124: private mbed::NonCopyable<AD7124>{
     public:
@@ -35,23 +76,71 @@ class AD7124: private mbed::NonCopyable<AD7124>{
          */
         void read_voltage_from_both_channels(unsigned int downsampling_rate, unsigned int vector_size);
 
+        /**
+         * @brief Reads one conversion word after DRDY went low.
+         * @param data Receives the 3 data bytes followed by the status byte.
+         */
+        void read_conversion_word(uint8_t data[4]);
+
+        /**
+         * @brief Reads a conversion word if this device has one ready.
+         * @param data Receives the 3 data bytes followed by the status byte.
+         * @return True if DOUT/RDY was low and `data` was filled.
+         *
+         * Selects the device, samples DOUT/RDY and deselects it again, so
+         * several devices can be polled on one bus.
+         */
+        bool try_read_conversion_word(uint8_t data[4]);
+
+        /**
+         * @brief Resets the device and programs it for another operating point (`SELF_BENCHMARK`).
+         * @param spi_frequency The SPI clock frequency in Hz.
+         * @param power_mode `POWER_MODE` field value.
+         * @param filter_fs Filter word FS of both channels.
+         *
+         * The device converts in continuous read mode again afterwards; the
+         * first word arrives once the filter settled.
+         */
+        void reconfigure(int spi_frequency, uint8_t power_mode, uint16_t filter_fs);
+
     private:
+        friend class AD7124Bus;
+        friend class SelfBenchmark;
+class SelfBenchmark;
 
-        SPI         m_spi;              ///< SPI object for communication with the AD7124.
+        SPI&        m_spi;              ///< SPI bus, shared by all devices of the node.
         DigitalIn   m_drdy;
         DigitalOut  m_cs;
-        DigitalOut  m_sync;             
-        int         m_spi_frequency;   ///< SPI clock frequency in Hz. 
+        uint8_t     m_clock_select;     ///< `CLK_SEL` field of the control register.
+        uint8_t     m_power_mode;       ///< `POWER_MODE` field of the control register.
+        uint16_t    m_filter_fs;        ///< Filter word FS of both setups.
+        bool        m_shared_bus;       ///< Deselect the device between transfers.
         int         m_flag_0;
         int         m_flag_1;
         char        m_read;
         char        m_write;
+#if defined(WARM_RESTART)
+        bool        m_resumed;          ///< `m_resume_word` is the first sample, not yet taken.
+        uint8_t     m_resume_word[4];   ///< Conversion word read by `resume`.
+#endif
 
         /**
         * @brief Private constructor for the AD7124 class.
-        * @param spi_frequency The SPI clock frequency in Hz.
+        * @param spi SPI bus, already set to mode 3 and the clock frequency.
+        * @param cs Chip select of this device.
+        * @param clock_select `CLK_SEL` field value, e.g. `AD7124_CLOCK_INTERNAL`.
+        * @param shared_bus True if other devices share the bus; the device is
+        *        then deselected and left unconfigured until `init` is called.
         */
-        AD7124(int spi_frequency);
+        AD7124(SPI& spi, PinName cs, uint8_t clock_select, bool shared_bus);
+
+        /**
+         * @brief Sets the SPI mode and clock of the AD7124 on a bus.
+         * @param spi SPI bus.
+         * @param spi_frequency The SPI clock frequency in Hz.
+         * @return `spi`.
+         */
+        static SPI& setup_spi(SPI& spi, int spi_frequency);
 
         /**
          * @brief Initializes the AD7124 ADC with specific channel flags.
@@ -95,14 +184,35 @@ class AD7124: private mbed::NonCopyable<AD7124>{
          */
         void ctrl_reg(char RW);
 
+#if defined(WARM_RESTART)
+        /**
+         * @brief Writes the register values `init` programs, in the order kept by `RetainedState`.
+         * @param words Receives control, channel 0/1, configuration 0/1 and filter 0/1 registers.
+         */
+        void register_words(uint32_t words[RETAINED_ADC_WORDS]) const;
+
+        /**
+         * @brief Continues the conversions of the previous run after a warm reset.
+         * @return False if the device must be initialized.
+         */
+        bool resume(void);
+
+        /**
+         * @brief Hands out the conversion word read by `resume` once.
+         * @param data Receives the word.
+         * @return True if `data` was filled.
+         */
+        bool take_resumed_word(uint8_t data[4]);
+#endif
+
         /**
          * @brief Sends data to the main thread for processing.
-         * @param byte_inputs_channel_0 Byte array inputs for channel 0.
-         * @param byte_inputs_channel_1 Byte array inputs for channel 1.
+         * @param samples_channel_0 Samples of channel 0.
+         * @param samples_channel_1 Samples of channel 1.
          */
         void send_data_to_main_thread(
-            std::vector<std::array<uint8_t, 3>> byte_inputs_channel_0,
-            std::vector<std::array<uint8_t, 3>> byte_inputs_channel_1
+            const SampleVector& samples_channel_0,
+            const SampleVector& samples_channel_1
         );
 };
 #endif
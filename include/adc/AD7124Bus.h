@@ -0,0 +1,85 @@
+#ifndef AD7124_BUS_H
+#define AD7124_BUS_H
+
+/**
+ * @file AD7124Bus.h
+ * @brief Several AD7124 on one SPI bus, read as they become ready.
+ */
+
+#include "mbed.h"
+#include "adc/AD7124.h"
+#include "adc/DeviceScheduler.h"
+#include "adc/SampleVector.h"
+
+/// Chip selects by device index (Arduino D10, D9, D2, D3 of the NUCLEO_WB55RG).
+#define AD7124_BUS_CS_PINS {AD7124_CS_PIN, PA_9, PC_6, PA_10}
+
+/// Length of the SYNC pulse, longer than the four master clock cycles the AD7124 needs.
+#define AD7124_SYNC_PULSE_US 10
+
+/**
+ * @class AD7124Bus
+ * @brief Singleton owning the SPI bus, the SYNC line and every AD7124 of the node.
+ *
+ * All devices share SCLK, MOSI and MISO (DOUT/RDY, with a pull-up) and have
+ * their own chip select. Device 0 runs on its internal clock and drives it
+ * onto its CLK pin, which is wired to the CLK pins of the other devices; all
+ * SYNC inputs are wired to `AD7124_SYNC_PIN`. After every device has been
+ * configured, one SYNC pulse restarts their conversions together, and the
+ * common clock keeps them aligned, so the samples of all devices are taken
+ * at the same instants.
+ *
+ * The devices are serviced by a `DeviceScheduler`, and every complete frame
+ * is handed to the main thread with the index of its device, which the frame
+ * builders write into the frame.
+ */
+class AD7124Bus : private mbed::NonCopyable<AD7124Bus> {
+public:
+    /**
+     * @brief Gets the singleton instance, configuring the devices on the first call.
+     * @param spi_frequency The SPI clock frequency in Hz.
+     * @param devices Number of devices, at most `DEVICE_SCHEDULER_MAX_DEVICES`.
+     * @return Reference to the singleton instance.
+     */
+    static AD7124Bus& getInstance(int spi_frequency, unsigned int devices);
+
+    /**
+     * @brief Reads all devices and sends a frame whenever one is complete; never returns.
+     * @param vector_size Samples per channel and frame.
+     */
+    void read_voltage_from_all_devices(unsigned int vector_size);
+
+    /// Number of devices on the bus.
+    unsigned int devices(void) const { return m_devices; }
+
+    /// Frames dropped because the reading queue was full.
+    uint32_t droppedFrames(void) const { return m_dropped_frames; }
+
+private:
+    DigitalOut    m_sync;               ///< SYNC input of all devices.
+    SPI           m_spi;                ///< Bus shared by all devices.
+    unsigned int  m_devices;            ///< Devices in use.
+    AD7124*       m_device[DEVICE_SCHEDULER_MAX_DEVICES];   ///< Devices by index.
+    alignas(AD7124) unsigned char m_device_storage[DEVICE_SCHEDULER_MAX_DEVICES][sizeof(AD7124)]; ///< Static storage of the devices.
+    uint32_t      m_dropped_frames;     ///< Frames lost at the hand-off.
+
+    /**
+     * @brief Configures all devices and synchronizes their conversions.
+     * @param spi_frequency The SPI clock frequency in Hz.
+     * @param devices Number of devices.
+     */
+    AD7124Bus(int spi_frequency, unsigned int devices);
+
+    /**
+     * @brief Restarts the conversions of all devices at the same instant.
+     */
+    void synchronize(void);
+
+    /**
+     * @brief Hands a frame of one device to the main thread without waiting.
+     * @return False if the frame was dropped.
+     */
+    bool send_data_to_main_thread(const SampleVector& ch0, const SampleVector& ch1, unsigned int device);
+};
+
+#endif // AD7124_BUS_H
@@ -0,0 +1,128 @@
+#ifndef DEVICE_SCHEDULER_H
+#define DEVICE_SCHEDULER_H
+
+/**
+ * @file DeviceScheduler.h
+ * @brief Services several AD7124 on one SPI bus in the order they become ready.
+ *
+ * @note This header must stay free of Mbed OS dependencies.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+#include "adc/SampleCollector.h"
+
+/// Devices a scheduler can service, the devices a raw frame can tag.
+#define DEVICE_SCHEDULER_MAX_DEVICES 4
+
+/// Result of `DeviceScheduler::poll` when no frame was completed.
+#define DEVICE_SCHEDULER_NONE (-1)
+
+/**
+ * @struct DeviceStats
+ * @brief Counters of one device since the scheduler was constructed.
+ */
+struct DeviceStats {
+    uint32_t words;         ///< Conversion words read.
+    uint32_t frames;        ///< Frames completed.
+    uint32_t repeats;       ///< Words of the same channel as the word before, i.e. a conversion was lost.
+    uint32_t invalid;       ///< Words whose status names no enabled channel.
+};
+
+/**
+ * @class DeviceScheduler
+ * @brief Polls the devices round robin and collects a frame per device.
+ *
+ * Every call to `poll` checks the devices once, starting after the device
+ * read last, and reads the first one whose DOUT/RDY is low. A device that is
+ * ready therefore waits for at most one word of each other device, whatever
+ * the phase between their conversions. The words are demultiplexed by one
+ * `SampleCollector` per device, so every frame holds the two channels of a
+ * single device and is tagged with its index when it is sent.
+ *
+ * With both channels enabled the status bytes alternate between 0 and 1; two
+ * words of the same channel in a row mean the conversion in between was
+ * overwritten before it was read and are counted as a repeat.
+ *
+ * @tparam Device Type providing `bool try_read_conversion_word(uint8_t data[4])`,
+ *         which selects the device, reads a word if DOUT/RDY is low and
+ *         deselects it again: `AD7124` on the node, a simulated converter on
+ *         the host.
+ */
+template <typename Device>
+class DeviceScheduler {
+public:
+    /**
+     * @brief Constructs a scheduler for the given devices.
+     * @param devices Devices on the bus, tagged with their index in this array.
+     * @param count Number of devices, at most `DEVICE_SCHEDULER_MAX_DEVICES`.
+     * @param vector_size Samples per channel and frame.
+     */
+    DeviceScheduler(Device* const* devices, unsigned int count, unsigned int vector_size)
+        : m_devices{}, m_count(count < DEVICE_SCHEDULER_MAX_DEVICES ? count : DEVICE_SCHEDULER_MAX_DEVICES),
+          m_next(0), m_last_channel{}, m_stats{},
+          m_collectors{SampleCollector(vector_size), SampleCollector(vector_size), SampleCollector(vector_size),
+                       SampleCollector(vector_size)} {
+        static_assert(DEVICE_SCHEDULER_MAX_DEVICES == 4, "Initialize one collector per device");
+        for (unsigned int i = 0; i < m_count; i++) {
+            m_devices[i] = devices[i];
+            m_last_channel[i] = 0xFF;
+        }
+    }
+
+    /**
+     * @brief Reads one conversion word from the first ready device, if any.
+     * @return Index of the device whose frame this word completed, otherwise
+     *         `DEVICE_SCHEDULER_NONE`. The frame stays in `collector` until
+     *         `clear` is called.
+     */
+    int poll(void) {
+        for (unsigned int i = 0; i < m_count; i++) {
+            unsigned int device = m_next + i < m_count ? m_next + i : m_next + i - m_count;
+            uint8_t data[AD7124_CONVERSION_WORD_SIZE] = {0, 0, 0, 255};
+            if (!m_devices[device]->try_read_conversion_word(data)) {
+                continue;
+            }
+
+            m_next = device + 1 < m_count ? device + 1 : 0;
+            DeviceStats& stats = m_stats[device];
+            stats.words++;
+            if (data[3] > 1) {
+                stats.invalid++;
+            } else if (data[3] == m_last_channel[device]) {
+                stats.repeats++;
+            }
+            m_last_channel[device] = data[3];
+
+            if (m_collectors[device].push(data)) {
+                stats.frames++;
+                return (int)device;
+            }
+            return DEVICE_SCHEDULER_NONE;
+        }
+        return DEVICE_SCHEDULER_NONE;
+    }
+
+    /// Samples collected from a device, a complete frame after `poll` returned its index.
+    const SampleCollector& collector(unsigned int device) const { return m_collectors[device]; }
+
+    /// Empties the frame of a device once it has been handed on.
+    void clear(unsigned int device) { m_collectors[device].clear(); }
+
+    /// Counters of a device.
+    const DeviceStats& stats(unsigned int device) const { return m_stats[device]; }
+
+    /// Number of devices serviced.
+    unsigned int devices(void) const { return m_count; }
+
+private:
+    Device*         m_devices[DEVICE_SCHEDULER_MAX_DEVICES];        ///< Devices by tag.
+    unsigned int    m_count;                                        ///< Devices in use.
+    unsigned int    m_next;                                         ///< Device checked first by the next poll.
+    uint8_t         m_last_channel[DEVICE_SCHEDULER_MAX_DEVICES];   ///< Status byte of the last word per device.
+    DeviceStats     m_stats[DEVICE_SCHEDULER_MAX_DEVICES];          ///< Counters per device.
+    SampleCollector m_collectors[DEVICE_SCHEDULER_MAX_DEVICES];     ///< Frame being collected per device.
+};
+
+#endif // DEVICE_SCHEDULER_H
@@ -0,0 +1,85 @@
+#ifndef FIXED_SAMPLE_COLLECTOR_H
+#define FIXED_SAMPLE_COLLECTOR_H
+
+/**
+ * @file FixedSampleCollector.h
+ * @brief `SampleCollector` with the frame size fixed at compile time.
+ *
+ * @note This header must stay free of Mbed OS dependencies.
+ */
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "adc/SampleCollector.h"
+
+/**
+ * @class FixedSampleCollector
+ * @brief Collects conversion words until both channels hold `VectorSize` samples.
+ *
+ * Behaves exactly like `SampleCollector`, including replacing the oldest
+ * sample of a channel that is already full, but keeps the samples in
+ * `std::array`s. All bounds are constants, so the compiler can unroll the
+ * shift of a full channel and the frame builder knows the frame size.
+ *
+ * @tparam VectorSize Samples per channel and frame.
+ */
+template <unsigned int VectorSize>
+class FixedSampleCollector {
+public:
+    static_assert(VectorSize > 0, "VectorSize must be positive");
+
+    /// Samples of one channel.
+    typedef std::array<int32_t, VectorSize> Channel;
+
+    FixedSampleCollector(void) : m_ch0_size(0), m_ch1_size(0) {}
+
+    /**
+     * @brief Adds a conversion word read from the ADC.
+     * @param word Three big-endian data bytes followed by the status byte.
+     * @return True if both channels now hold `VectorSize` samples.
+     */
+    bool push(const uint8_t word[AD7124_CONVERSION_WORD_SIZE]) {
+        if (word[3] == 0) {
+            append(m_ch0, m_ch0_size, word);
+        } else if (word[3] == 1) {
+            append(m_ch1, m_ch1_size, word);
+        }
+        return full();
+    }
+
+    /// True if a complete frame is available.
+    bool full(void) const { return m_ch0_size == VectorSize && m_ch1_size == VectorSize; }
+
+    /// Empties both channels for the next frame.
+    void clear(void) {
+        m_ch0_size = 0;
+        m_ch1_size = 0;
+    }
+
+    /// Samples of channel 0, complete once `full()` returns true.
+    const Channel& ch0(void) const { return m_ch0; }
+
+    /// Samples of channel 1, complete once `full()` returns true.
+    const Channel& ch1(void) const { return m_ch1; }
+
+private:
+    alignas(SAMPLE_ALIGNMENT) Channel m_ch0;        ///< Samples of channel 0.
+    alignas(SAMPLE_ALIGNMENT) Channel m_ch1;        ///< Samples of channel 1.
+    unsigned int                      m_ch0_size;   ///< Used samples of channel 0.
+    unsigned int                      m_ch1_size;   ///< Used samples of channel 1.
+
+    static void append(Channel& channel, unsigned int& size, const uint8_t word[AD7124_CONVERSION_WORD_SIZE]) {
+        if (size == VectorSize) {
+            // Drop the oldest sample, the shift has a constant length
+            memmove(&channel[0], &channel[1], (VectorSize - 1) * sizeof(channel[0]));
+            size--;
+        }
+        channel[size] = sample_from_bytes(word);
+        size++;
+    }
+};
+
+#endif // FIXED_SAMPLE_COLLECTOR_H
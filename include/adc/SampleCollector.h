@@ -0,0 +1,81 @@
+#ifndef SAMPLE_COLLECTOR_H
+#define SAMPLE_COLLECTOR_H
+
+/**
+ * @file SampleCollector.h
+ * @brief Demultiplexes AD7124 conversion words into per-channel sample vectors.
+ *
+ * @note This header is free of Mbed OS dependencies so the acquisition logic can
+ *       be replayed on the host.
+ */
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "adc/SampleVector.h"
+
+/// Size of one conversion word read from the AD7124 (3 data bytes + status byte).
+#define AD7124_CONVERSION_WORD_SIZE 4
+
+/**
+ * @class SampleCollector
+ * @brief Collects conversion words until both channels hold `vector_size` samples.
+ *
+ * The AD7124 appends its status register to every conversion (DATA_STATUS), so
+ * the last byte of a word identifies the channel. When a channel is already full
+ * while the other one is still filling up, its oldest sample is replaced.
+ */
+class SampleCollector {
+public:
+    /**
+     * @brief Constructs a collector for frames of the given size.
+     * @param vector_size Number of samples per channel in one frame.
+     */
+    explicit SampleCollector(unsigned int vector_size);
+
+    /**
+     * @brief Adds a conversion word read from the ADC.
+     * @param word Three big-endian data bytes followed by the status byte.
+     * @return True if both channels now hold `vector_size` samples.
+     */
+    bool push(const uint8_t word[AD7124_CONVERSION_WORD_SIZE]);
+
+    /**
+     * @brief Checks whether both channels are full.
+     * @return True if a complete frame is available.
+     */
+    bool full(void) const;
+
+    /**
+     * @brief Number of complete sample pairs, for frames sent before they are full.
+     * @return Samples of the channel holding fewer.
+     */
+    unsigned int size(void) const;
+
+    /**
+     * @brief Checks whether both channels hold the same number of samples.
+     * @return True between two conversion pairs, where a partial frame can be cut.
+     */
+    bool paired(void) const { return m_ch0.size() == m_ch1.size(); }
+
+    /**
+     * @brief Empties both channels for the next frame.
+     */
+    void clear(void);
+
+    /// Collected samples of channel 0.
+    const SampleVector& ch0(void) const { return m_ch0; }
+
+    /// Collected samples of channel 1.
+    const SampleVector& ch1(void) const { return m_ch1; }
+
+private:
+    unsigned int  m_vector_size;  ///< Samples per channel and frame.
+    SampleVector  m_ch0;          ///< Samples of channel 0.
+    SampleVector  m_ch1;          ///< Samples of channel 1.
+
+    void append(SampleVector& channel, const uint8_t word[AD7124_CONVERSION_WORD_SIZE]);
+};
+
+#endif // SAMPLE_COLLECTOR_H
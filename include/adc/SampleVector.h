@@ -0,0 +1,93 @@
+#ifndef SAMPLE_VECTOR_H
+#define SAMPLE_VECTOR_H
+
+/**
+ * @file SampleVector.h
+ * @brief Container of the AD7124 samples passed through the pipeline, and their 24-bit wire form.
+ *
+ * Inside the node every sample is a sign-corrected `int32_t`: the bipolar
+ * offset-binary code minus `SAMPLE_ZERO_CODE`, so 0 V is 0 and the range is
+ * [-2^23, 2^23 - 1]. Each channel is one contiguous array, so conversion
+ * and filtering work on plain integers the compiler can vectorize. The
+ * big-endian 3-byte form of the AD7124 and of the frames is produced only
+ * by `sample_from_bytes` when a conversion word is read and by
+ * `pack_samples` when a frame is serialized.
+ *
+ * With `ZERO_HEAP`, samples are kept in a `StaticVector` sized at compile
+ * time, so acquisition, hand-off and serialization never touch the heap.
+ * Otherwise a `std::vector` is used.
+ *
+ * Samples carry no time of their own; they are equally spaced, and the
+ * frame is stamped with the time of its last sample (`CLOCK_SYNC`).
+ *
+ * @note This header must stay free of Mbed OS dependencies.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+/// Offset-binary code of 0 V in bipolar mode, subtracted from every code read.
+#define SAMPLE_ZERO_CODE 0x800000
+
+/// Bytes of a sample on the wire and in a conversion word.
+#define SAMPLE_WIRE_SIZE 3
+
+/// Alignment of inline sample storage, one 128-bit vector register.
+#define SAMPLE_ALIGNMENT 16
+
+#if defined(ZERO_HEAP)
+#include "config/PipelineConfig.h"
+#include "utils/StaticVector.h"
+
+#if defined(ADAPTIVE_BATCHING)
+/// Samples a channel can hold per frame in the zero-heap build, the largest adaptive frame.
+#define SAMPLE_VECTOR_CAPACITY (PhytoConfig::batch_max_samples)
+#else
+/// Samples a channel can hold per frame in the zero-heap build, the frame size of the active preset.
+#define SAMPLE_VECTOR_CAPACITY (PhytoConfig::vector_size)
+#endif
+
+/// Samples of one channel, stored inline.
+typedef StaticVector<int32_t, SAMPLE_VECTOR_CAPACITY, SAMPLE_ALIGNMENT> SampleVector;
+#else
+#include <vector>
+
+/// Samples of one channel.
+typedef std::vector<int32_t> SampleVector;
+#endif
+
+/**
+ * @brief Reads a sample from its big-endian wire form.
+ * @param bytes Three data bytes, e.g. the start of a conversion word.
+ * @return Sign-corrected sample.
+ */
+inline int32_t sample_from_bytes(const uint8_t* bytes) {
+    int32_t code = ((int32_t)bytes[0] << 16) | ((int32_t)bytes[1] << 8) | (int32_t)bytes[2];
+    return code - SAMPLE_ZERO_CODE;
+}
+
+/**
+ * @brief Writes a sample in its big-endian wire form.
+ * @param sample Sign-corrected sample; only the lowest 24 bits of the code are kept.
+ * @param bytes Receives three bytes.
+ */
+inline void sample_to_bytes(int32_t sample, uint8_t* bytes) {
+    uint32_t code = (uint32_t)(sample + SAMPLE_ZERO_CODE);
+    bytes[0] = (uint8_t)(code >> 16);
+    bytes[1] = (uint8_t)(code >> 8);
+    bytes[2] = (uint8_t)code;
+}
+
+/**
+ * @brief Packs a run of samples into the wire form, as frames carry them.
+ * @param samples Samples to pack.
+ * @param count Number of samples.
+ * @param out Receives `count * SAMPLE_WIRE_SIZE` bytes.
+ */
+inline void pack_samples(const int32_t* samples, size_t count, uint8_t* out) {
+    for (size_t i = 0; i < count; i++) {
+        sample_to_bytes(samples[i], out + i * SAMPLE_WIRE_SIZE);
+    }
+}
+
+#endif // SAMPLE_VECTOR_H
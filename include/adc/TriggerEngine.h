@@ -0,0 +1,198 @@
+#ifndef TRIGGER_ENGINE_H
+#define TRIGGER_ENGINE_H
+
+/**
+ * @file TriggerEngine.h
+ * @brief Event-triggered transmission: detectors, pre-trigger ring and heartbeat samples.
+ *
+ * @note This header must stay free of Mbed OS dependencies.
+ */
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "adc/SampleVector.h"
+#include "config/PipelineConfig.h"
+#include "utils/ConversionKernel.h"
+
+/// Sample pairs the pre-trigger ring can hold.
+#define TRIGGER_PRE_CAPACITY 64
+
+/// Detector bit: the level left the threshold band around 0 V.
+#define TRIGGER_DETECTOR_THRESHOLD 0x01
+
+/// Detector bit: the change from the previous sample exceeded the slope limit.
+#define TRIGGER_DETECTOR_SLOPE 0x02
+
+/// Detector bit: the sample deviated from the adaptive baseline.
+#define TRIGGER_DETECTOR_BASELINE 0x04
+
+/**
+ * @enum TriggerOutput
+ * @brief What `TriggerEngine::push` left in the output window.
+ */
+enum TriggerOutput : uint8_t {
+    TRIGGER_NONE      = 0,  ///< Nothing to send.
+    TRIGGER_EVENT     = 1,  ///< A frame of an event window is complete.
+    TRIGGER_HEARTBEAT = 2,  ///< A single heartbeat sample pair.
+};
+
+/**
+ * @struct TriggerSettings
+ * @brief Runtime parameters of a `TriggerEngine`, in samples and ADC codes.
+ */
+struct TriggerSettings {
+    unsigned int frame_samples;         ///< Samples per channel of a full event frame.
+    unsigned int pre_samples;           ///< Samples kept before a detection, less than `frame_samples`.
+    unsigned int post_samples;          ///< Samples sent after the last detection.
+    unsigned int heartbeat_samples;     ///< Idle samples between two heartbeats, 0 for none.
+    int32_t      zero_code;             ///< Sample of 0 V, 0 unless the input has an offset.
+    int32_t      threshold_codes;       ///< Level detector: distance from 0 V, 0 disables it.
+    int32_t      slope_codes;           ///< Slope detector: change per sample, 0 disables it.
+    unsigned int baseline_k;            ///< Baseline detector: mean deviations, 0 disables it.
+    int32_t      baseline_floor_codes;  ///< Smallest deviation the baseline detector fires on.
+    unsigned int baseline_shift;        ///< Baseline time constant, 2^shift samples.
+};
+
+/**
+ * @struct TriggerStats
+ * @brief Counters since construction.
+ */
+struct TriggerStats {
+    uint32_t pairs;             ///< Sample pairs pushed.
+    uint32_t events;            ///< Event windows opened.
+    uint32_t event_pairs;       ///< Sample pairs sent in event windows.
+    uint32_t heartbeats;        ///< Heartbeat pairs sent.
+    uint32_t threshold_onsets;  ///< Events opened by the level detector.
+    uint32_t slope_onsets;      ///< Events opened by the slope detector.
+    uint32_t baseline_onsets;   ///< Events opened by the baseline detector.
+};
+
+/**
+ * @brief Trigger parameters of a `PipelineConfig`.
+ * @tparam Config Configuration type.
+ * @param frame_samples Samples per channel of a full event frame.
+ */
+template <typename Config>
+constexpr TriggerSettings trigger_settings(unsigned int frame_samples) {
+    static_assert(Config::trigger_pre_samples <= TRIGGER_PRE_CAPACITY, "trigger_pre_samples exceeds the ring");
+    return TriggerSettings{
+        frame_samples,
+        Config::trigger_pre_samples,
+        Config::trigger_post_samples,
+        (unsigned int)((uint64_t)Config::trigger_heartbeat_ms *
+                       ad7124_rate_sps(Config::power_mode, Config::channels, Config::filter_fs) / 1000),
+        0,
+        millivolts_to_codes<Config>(Config::trigger_threshold_mv),
+        millivolts_to_codes<Config>(Config::trigger_slope_mv),
+        Config::trigger_baseline_k,
+        millivolts_to_codes<Config>(Config::trigger_baseline_floor_mv),
+        Config::trigger_baseline_shift,
+    };
+}
+
+/**
+ * @class TriggerEngine
+ * @brief Passes on only the sample pairs around detected events, plus sparse heartbeats.
+ *
+ * Plant action potentials are rare, so streaming every sample mostly sends
+ * baseline. The engine sits between the `SampleCollector` and the sender
+ * (`EVENT_TRIGGER`) and takes complete sample pairs. Three detectors run on
+ * both channels; any of them opens an event:
+ *
+ * - level: the sample is at least `threshold_codes` away from 0 V,
+ * - slope: it differs from the previous sample by at least `slope_codes`,
+ * - baseline: it deviates from an exponential moving average by more than
+ *   `baseline_k` times the moving mean absolute deviation, and at least by
+ *   `baseline_floor_codes`. The baseline follows slow drift; during an event
+ *   it learns four times slower, so a long potential does not absorb itself
+ *   while a lasting step still ends the event eventually.
+ *
+ * While idle, the last `pre_samples` pairs are kept in a ring. A detection
+ * copies the ring and the detecting pair into the output window; every
+ * following pair is appended until `post_samples` pairs have passed without
+ * a detection. The window is handed out in frames of `frame_samples`, the
+ * last one partial. Without events one heartbeat pair is handed out every
+ * `heartbeat_samples` pairs, so the host still sees the level and knows the
+ * node is alive.
+ *
+ * Like the collector, the output window stays valid until `clear`, which the
+ * caller invokes after sending it.
+ */
+class TriggerEngine {
+public:
+    /**
+     * @brief Constructs an idle engine.
+     * @param settings Detector and window parameters.
+     */
+    explicit TriggerEngine(const TriggerSettings& settings);
+
+    /**
+     * @brief Runs the detectors on a sample pair and moves it into the ring or the output window.
+     * @param ch0 Sample of channel 0.
+     * @param ch1 Sample of channel 1.
+     * @return What the output window now holds for sending.
+     */
+    TriggerOutput push(int32_t ch0, int32_t ch1);
+
+    /**
+     * @brief Empties the output window after it was sent.
+     */
+    void clear(void);
+
+    /// Output window of channel 0.
+    const SampleVector& ch0(void) const { return m_out_ch0; }
+
+    /// Output window of channel 1.
+    const SampleVector& ch1(void) const { return m_out_ch1; }
+
+    /// True while an event window is open.
+    bool active(void) const { return m_active; }
+
+    /// True if the last pushed pair opened an event window.
+    bool onset(void) const { return m_onset; }
+
+    /// `TRIGGER_DETECTOR_*` bits that fired on the last pushed pair, either channel.
+    uint8_t detectors(void) const { return m_detectors; }
+
+    /// Counters since construction.
+    const TriggerStats& stats(void) const { return m_stats; }
+
+    /// Parameters in use, with `pre_samples` clamped to the ring and the frame.
+    const TriggerSettings& settings(void) const { return m_settings; }
+
+private:
+    /**
+     * @struct Detector
+     * @brief Detector state of one channel.
+     */
+    struct Detector {
+        int32_t  last;          ///< Previous code.
+        int64_t  mean_acc;      ///< Baseline, scaled by 2^shift.
+        int64_t  dev_acc;       ///< Mean absolute deviation, scaled by 2^shift.
+        uint32_t samples;       ///< Samples seen, for the warm-up of the baseline.
+    };
+
+    /// One sample pair.
+    typedef std::array<int32_t, 2> Pair;
+
+    TriggerSettings         m_settings;     ///< Parameters in use.
+    std::array<Detector, 2> m_detector;     ///< Per-channel detector state.
+    std::array<Pair, TRIGGER_PRE_CAPACITY> m_ring;  ///< Pairs before a detection.
+    unsigned int            m_ring_head;    ///< Next slot to write.
+    unsigned int            m_ring_size;    ///< Valid pairs in the ring.
+    bool                    m_active;       ///< An event window is open.
+    unsigned int            m_hold;         ///< Pairs still sent without a further detection.
+    unsigned int            m_idle;         ///< Pairs since the last sent one.
+    bool                    m_onset;        ///< Last pair opened an event.
+    uint8_t                 m_detectors;    ///< Detectors fired on the last pair.
+    SampleVector            m_out_ch0;      ///< Output window of channel 0.
+    SampleVector            m_out_ch1;      ///< Output window of channel 1.
+    TriggerStats            m_stats;        ///< Counters.
+
+    uint8_t detect(Detector& detector, int32_t code) const;
+    void append(int32_t ch0, int32_t ch1);
+};
+
+#endif // TRIGGER_ENGINE_H
@@ -0,0 +1,124 @@
+#ifndef CAPTURE_FORMAT_H
+#define CAPTURE_FORMAT_H
+
+/**
+ * @file CaptureFormat.h
+ * @brief Layout of capture records and capture files used for recording and replay.
+ *
+ * A capture is a sequence of records, each holding either a batch of raw AD7124
+ * conversion words or one serialized serial mail frame. The node streams records
+ * over the serial link; the host stores them verbatim in a capture file:
+ *
+ * ```
+ * CaptureFileHeader
+ * record 0 .. record N-1          (CaptureRecordHeader + payload)
+ * CaptureIndexEntry[index_count]  (one entry every CAPTURE_INDEX_INTERVAL records)
+ * CaptureFileFooter
+ * ```
+ *
+ * All multi-byte fields are little-endian. Record timestamps are stored as the
+ * delta to the previous record in microseconds, the index holds absolute times
+ * so a reader can seek without walking all records.
+ *
+ * @note This header must stay free of Mbed OS dependencies.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+/// Marker in front of every capture record, distinct from the `0xAAAA` frame marker.
+constexpr uint16_t CAPTURE_RECORD_MARKER = 0xCCCC;
+
+/// Magic bytes at the start of a capture file.
+constexpr char CAPTURE_FILE_MAGIC[4] = {'P', 'H', 'Y', 'C'};
+
+/// Magic bytes at the end of a finalized capture file.
+constexpr char CAPTURE_FOOTER_MAGIC[4] = {'P', 'H', 'Y', 'I'};
+
+/// Version of the capture file layout.
+constexpr uint8_t CAPTURE_FILE_VERSION = 1;
+
+/// Number of records between two index entries.
+constexpr uint32_t CAPTURE_INDEX_INTERVAL = 256;
+
+/// Largest payload of a single record.
+constexpr uint16_t CAPTURE_MAX_PAYLOAD_SIZE = 8192;
+
+/**
+ * @enum CaptureKind
+ * @brief Content of the records in a capture.
+ */
+enum CaptureKind : uint8_t {
+    CAPTURE_KIND_SPI_WORDS = 1,     ///< Records hold 4-byte AD7124 conversion words.
+    CAPTURE_KIND_FRAMES    = 2,     ///< Records hold one complete `0xAAAA` + size + FlatBuffer frame.
+};
+
+#pragma pack(push, 1)
+
+/**
+ * @struct CaptureRecordHeader
+ * @brief Header preceding the payload of every record (10 bytes).
+ */
+struct CaptureRecordHeader {
+    uint16_t marker;        ///< Always `CAPTURE_RECORD_MARKER`.
+    uint8_t  kind;          ///< One of `CaptureKind`.
+    uint8_t  checksum;      ///< XOR of all payload bytes.
+    uint16_t length;        ///< Payload size in bytes.
+    uint32_t delta_us;      ///< Time since the previous record in microseconds.
+};
+
+/**
+ * @struct CaptureFileHeader
+ * @brief Header at the start of a capture file (16 bytes).
+ */
+struct CaptureFileHeader {
+    char     magic[4];      ///< `CAPTURE_FILE_MAGIC`.
+    uint8_t  version;       ///< `CAPTURE_FILE_VERSION`.
+    uint8_t  kind;          ///< Kind of all records in the file.
+    uint16_t node;          ///< Node the capture was taken from, 0 if unknown.
+    uint64_t start_time_us; ///< Wall clock time of the first record (µs since the Unix epoch).
+};
+
+/**
+ * @struct CaptureIndexEntry
+ * @brief Seek point into the record area (16 bytes).
+ */
+struct CaptureIndexEntry {
+    uint64_t offset;        ///< File offset of the record.
+    uint64_t time_us;       ///< Time of the record relative to the first record.
+};
+
+/**
+ * @struct CaptureFileFooter
+ * @brief Trailer that locates the index (24 bytes).
+ */
+struct CaptureFileFooter {
+    uint64_t index_offset;  ///< File offset of the first index entry.
+    uint32_t index_count;   ///< Number of index entries.
+    uint32_t record_count;  ///< Number of records in the file.
+    uint32_t reserved;      ///< Reserved, written as 0.
+    char     magic[4];      ///< `CAPTURE_FOOTER_MAGIC`.
+};
+
+#pragma pack(pop)
+
+static_assert(sizeof(CaptureRecordHeader) == 10, "Unexpected capture record header size");
+static_assert(sizeof(CaptureFileHeader) == 16, "Unexpected capture file header size");
+static_assert(sizeof(CaptureIndexEntry) == 16, "Unexpected capture index entry size");
+static_assert(sizeof(CaptureFileFooter) == 24, "Unexpected capture footer size");
+
+/**
+ * @brief Computes the payload checksum stored in a record header.
+ * @param payload Payload bytes.
+ * @param length Number of payload bytes.
+ * @return XOR of all bytes.
+ */
+inline uint8_t capture_checksum(const uint8_t* payload, size_t length) {
+    uint8_t checksum = 0;
+    for (size_t i = 0; i < length; i++) {
+        checksum ^= payload[i];
+    }
+    return checksum;
+}
+
+#endif // CAPTURE_FORMAT_H
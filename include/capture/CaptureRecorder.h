@@ -0,0 +1,81 @@
+#ifndef CAPTURE_RECORDER_H
+#define CAPTURE_RECORDER_H
+
+#include "mbed.h"
+#include "capture/CaptureFormat.h"
+
+/// Number of conversion words batched into one capture record.
+#define CAPTURE_WORDS_PER_RECORD 64
+
+/// Number of finished records that can wait for the serial link.
+#define CAPTURE_QUEUE_DEPTH 4
+
+/**
+ * @class CaptureRecorder
+ * @brief Singleton class that streams raw AD7124 conversion words as capture records.
+ *
+ * The acquisition thread hands every 4-byte conversion word to `recordWord`.
+ * Words are batched into records with a microsecond timestamp and passed to a
+ * low-priority writer thread, which sends them with `SerialMailSender::sendRaw`.
+ * The acquisition thread never blocks on the link: if all record slots are in
+ * use, the words are dropped and counted.
+ *
+ * The host tool `phyto_capture --spi` stores the records in a capture file that
+ * `phyto_replay` can feed back through the acquisition and serialization code.
+ */
+class CaptureRecorder {
+public:
+    /**
+     * @brief Gets the singleton instance of the CaptureRecorder.
+     * @return Reference to the singleton instance of the CaptureRecorder.
+     */
+    static CaptureRecorder& getInstance(void);
+
+    /// Deleted copy constructor to enforce the singleton pattern.
+    CaptureRecorder(const CaptureRecorder&) = delete;
+
+    /// Deleted copy assignment operator to enforce the singleton pattern.
+    CaptureRecorder& operator=(const CaptureRecorder&) = delete;
+
+    /**
+     * @brief Starts the writer thread. Must be called before the first word is recorded.
+     */
+    void start(void);
+
+    /**
+     * @brief Appends a conversion word to the current record.
+     * @param word Three data bytes followed by the AD7124 status byte.
+     */
+    void recordWord(const uint8_t word[4]);
+
+    /**
+     * @brief Returns the number of words dropped because the link was too slow.
+     * @return Dropped word count.
+     */
+    uint32_t droppedWords(void) const { return m_dropped_words; }
+
+private:
+    /**
+     * @struct record_t
+     * @brief Capture record as sent over the serial link.
+     */
+    typedef struct {
+        CaptureRecordHeader header;                             ///< Record header.
+        uint8_t payload[CAPTURE_WORDS_PER_RECORD * 4];          ///< Batched conversion words.
+    } record_t;
+
+    Mail<record_t, CAPTURE_QUEUE_DEPTH> m_mail_box;   ///< Finished records waiting for the writer.
+    Thread          m_writer_thread;                  ///< Sends finished records.
+    Timer           m_timer;                          ///< Microsecond time base for record deltas.
+    record_t*       m_current;                        ///< Record being filled, null if none allocated.
+    size_t          m_words;                          ///< Words in the current record.
+    uint64_t        m_last_record_us;                 ///< Timestamp of the previous record.
+    uint32_t        m_dropped_words;                ///< Words lost due to a full queue.
+
+    CaptureRecorder(void);
+    ~CaptureRecorder(void) = default;
+
+    void writerLoop(void);
+};
+
+#endif // CAPTURE_RECORDER_H
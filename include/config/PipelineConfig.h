@@ -0,0 +1,249 @@
+#ifndef PIPELINE_CONFIG_H
+#define PIPELINE_CONFIG_H
+
+/**
+ * @file PipelineConfig.h
+ * @brief Compile-time configuration of the acquisition pipeline.
+ *
+ * A configuration is a type with `static constexpr` members, so it can be
+ * passed as a template argument (floating-point non-type template parameters
+ * would need C++20, which the firmware toolchain does not use). Templates such
+ * as `FixedSampleCollector`, `FrameBuilder::build` for `std::array` and
+ * `convert_samples` take the sizes and conversion constants from it, which
+ * fixes loop counts and buffer sizes and folds the scale factor.
+ *
+ * The active configuration `PhytoConfig` is chosen with one of the
+ * `PHYTO_PRESET_*` definitions, set from the `PHYTO_PRESET` CMake cache
+ * variable:
+ *
+ * | Preset                 | Rate per channel  | Samples per frame | Frames/s | Adaptive range, deadline |
+ * |------------------------|-------------------|-------------------|----------|--------------------------|
+ * | `DEFAULT`              | 6 SPS (low power) | 10                | 0.6      | 5 - 30, 5 s              |
+ * | `2CH_50SPS`            | 50 SPS            | 10                | 5        | 5 - 40, 1 s              |
+ * | `2CH_1KSPS`            | 1200 SPS          | 50                | 24       | 10 - 64, 100 ms          |
+ * | `8CH_50SPS`            | 50 SPS            | 10                | 20       | 5 - 40, 1 s              |
+ *
+ * `8CH_50SPS` runs four AD7124 with two channels each on one SPI bus (see
+ * `AD7124Bus`); every other preset has a single converter. Frames always hold
+ * the two channels of one device and are tagged with its index, so the frame
+ * rate in the table counts all devices.
+ *
+ * With `ADAPTIVE_BATCHING` the frame size moves between `batch_min_samples`
+ * and `batch_max_samples` with the link backlog, starting at `vector_size`,
+ * and a partial frame is sent once its oldest sample is `batch_deadline_ms`
+ * old (see `AdaptiveBatcher`).
+ *
+ * With `EVENT_TRIGGER` only event windows are sent, each starting
+ * `trigger_pre_samples` before the detection and ending `trigger_post_samples`
+ * after the last one, plus one heartbeat sample pair every
+ * `trigger_heartbeat_ms` while nothing happens (see `TriggerEngine`):
+ *
+ * | Preset      | Pre / post samples | Threshold | Slope per sample | Baseline: k, floor, time constant |
+ * |-------------|--------------------|-----------|------------------|-----------------------------------|
+ * | `DEFAULT`   | 4 / 12             | 100 mV    | 5 mV             | 6, 0.2 mV, 16 samples             |
+ * | `2CH_50SPS` | 8 / 100            | 100 mV    | 2 mV             | 6, 0.2 mV, 64 samples             |
+ * | `2CH_1KSPS` | 40 / 2400          | 100 mV    | 1 mV             | 8, 0.2 mV, 1024 samples           |
+ *
+ * With `BAND_POWER` the power of `band_count` frequency bands per channel is
+ * sent once per window of `band_window` samples (see `BandPowerAnalyzer`):
+ *
+ * | Preset      | Window           | Resolution | Band edges in Hz        |
+ * |-------------|------------------|------------|-------------------------|
+ * | `DEFAULT`   | 64 (10.7 s)      | 0.094 Hz   | 0.1, 0.5, 1, 2, 3       |
+ * | `2CH_50SPS` | 128 (2.56 s)     | 0.39 Hz    | 0.4, 1, 4, 10, 25       |
+ * | `2CH_1KSPS` | 512 (0.43 s)     | 2.34 Hz    | 2.5, 5, 10, 30, 100     |
+ *
+ * With `MAINS_FILTER` every channel runs through a high-pass removing the
+ * electrode drift, notches at the mains frequency and its first
+ * `mains_harmonics` multiples, and, before keeping one of every
+ * `mains_decimation` samples, a fourth-order low-pass (see `MainsFilter`):
+ *
+ * | Preset      | High-pass | Notches, Q            | Low-pass | Decimation, rate sent |
+ * |-------------|-----------|-----------------------|----------|-----------------------|
+ * | `DEFAULT`   | 0.01 Hz   | none                  | none     | 1, 6 SPS              |
+ * | `2CH_50SPS` | 0.05 Hz   | none (50 Hz is at DC) | none     | 1, 50 SPS             |
+ * | `2CH_1KSPS` | 0.05 Hz   | 50 - 400 Hz, 20       | 60 Hz    | 5, 240 SPS            |
+ *
+ * The `SerialMail` schema carries exactly two channels, so every preset has
+ * two per device; rates follow from the filter word FS with the sinc4 settling of the
+ * channel sequencer, `f_CLK / (32 * FS * 4 * channels)`.
+ *
+ * @note This header must stay free of Mbed OS dependencies.
+ */
+
+#include <cstdint>
+
+/// Master clock of the AD7124 in low power mode in Hz.
+constexpr uint32_t AD7124_LOW_POWER_CLOCK = 76800;
+
+/// Master clock of the AD7124 in full power mode in Hz.
+constexpr uint32_t AD7124_FULL_POWER_CLOCK = 614400;
+
+/// `POWER_MODE` field value of the ADC control register for low power.
+constexpr uint8_t AD7124_POWER_MODE_LOW = 0;
+
+/// `POWER_MODE` field value of the ADC control register for full power.
+constexpr uint8_t AD7124_POWER_MODE_FULL = 3;
+
+/**
+ * @brief Master clock belonging to a power mode.
+ * @param power_mode `POWER_MODE` field value.
+ * @return Clock in Hz.
+ */
+constexpr uint32_t ad7124_clock(uint8_t power_mode) {
+    return power_mode == AD7124_POWER_MODE_FULL ? AD7124_FULL_POWER_CLOCK : AD7124_LOW_POWER_CLOCK;
+}
+
+/**
+ * @brief Filter word giving the closest rate per channel at or above the target.
+ * @param power_mode `POWER_MODE` field value.
+ * @param channels Channels enabled in the sequencer.
+ * @param rate_sps Target rate per channel.
+ * @return FS value for the filter registers (1 to 2047).
+ */
+constexpr uint16_t ad7124_filter_fs(uint8_t power_mode, unsigned int channels, uint32_t rate_sps) {
+    uint32_t fs = ad7124_clock(power_mode) / (32u * 4u * channels * rate_sps);
+    return (uint16_t)(fs < 1 ? 1 : (fs > 2047 ? 2047 : fs));
+}
+
+/**
+ * @brief Rate per channel resulting from a filter word.
+ * @return Conversions per second and channel.
+ */
+constexpr uint32_t ad7124_rate_sps(uint8_t power_mode, unsigned int channels, uint16_t filter_fs) {
+    return ad7124_clock(power_mode) / (32u * 4u * channels * filter_fs);
+}
+
+/**
+ * @brief `PGA` field value of the configuration register for a gain.
+ * @param gain Gain 1, 2, 4, ..., 128.
+ * @return log2 of the gain.
+ */
+constexpr uint8_t ad7124_pga_code(float gain) {
+    return gain >= 128 ? 7 : gain >= 64 ? 6 : gain >= 32 ? 5 : gain >= 16 ? 4 :
+           gain >= 8 ? 3 : gain >= 4 ? 2 : gain >= 2 ? 1 : 0;
+}
+
+/**
+ * @struct PresetDefault
+ * @brief Register values and frame layout the node always used.
+ */
+struct PresetDefault {
+    static constexpr unsigned int channels = 2;                 ///< Channels per frame.
+    static constexpr unsigned int devices = 1;                  ///< AD7124 on the SPI bus, each sending its own frames.
+    static constexpr unsigned int vector_size = 10;             ///< Samples per channel and frame.
+    static constexpr int node = 3;                              ///< Node identifier written into each frame.
+    static constexpr int spi_frequency = 10000000;              ///< SPI clock in Hz.
+    static constexpr unsigned int downsampling_rate = 1;        ///< Downsampling rate in ms.
+    static constexpr uint8_t power_mode = AD7124_POWER_MODE_LOW;///< ADC power mode.
+    static constexpr uint16_t filter_fs = 50;                   ///< Filter word FS.
+    static constexpr int32_t databits = 8388608;                ///< Half of the 24-bit code range.
+    static constexpr float vref = 2.5f;                         ///< Reference voltage in V.
+    static constexpr float gain = 4.0f;                         ///< PGA gain.
+    static constexpr unsigned int batch_min_samples = 5;        ///< Smallest adaptive frame.
+    static constexpr unsigned int batch_max_samples = 30;       ///< Largest adaptive frame.
+    static constexpr uint32_t batch_deadline_ms = 5000;         ///< Latency bound of an adaptive frame.
+    static constexpr unsigned int trigger_pre_samples = 4;      ///< Samples sent before a detection.
+    static constexpr unsigned int trigger_post_samples = 12;    ///< Samples sent after the last detection.
+    static constexpr uint32_t trigger_heartbeat_ms = 60000;     ///< Period of the heartbeat sample while idle.
+    static constexpr float trigger_threshold_mv = 100.0f;       ///< Level detector, 0 disables it.
+    static constexpr float trigger_slope_mv = 5.0f;             ///< Change per sample detector, 0 disables it.
+    static constexpr unsigned int trigger_baseline_k = 6;       ///< Deviation from the baseline in mean deviations, 0 disables it.
+    static constexpr float trigger_baseline_floor_mv = 0.2f;    ///< Smallest deviation the baseline detector fires on.
+    static constexpr unsigned int trigger_baseline_shift = 4;   ///< Baseline time constant, 2^shift samples.
+    static constexpr unsigned int band_window = 64;             ///< Samples per channel and band power window.
+    static constexpr unsigned int band_count = 4;               ///< Bands per channel.
+    static constexpr float band_edges_hz[band_count + 1] = {0.1f, 0.5f, 1.0f, 2.0f, 3.0f}; ///< Band edges.
+    static constexpr float mains_hz = 50.0f;             ///< Mains frequency.
+    static constexpr unsigned int mains_harmonics = 0;         ///< Multiples of the mains frequency notched, 0 for none.
+    static constexpr float mains_notch_q = 20.0f;              ///< Notch frequency over notch bandwidth.
+    static constexpr float mains_highpass_hz = 0.01f;          ///< Drift high-pass corner, 0 disables it.
+    static constexpr float mains_lowpass_hz = 0.0f;            ///< Low-pass corner before decimation, 0 disables it.
+    static constexpr unsigned int mains_decimation = 1;        ///< Filtered samples per sample sent.
+};
+
+/**
+ * @struct Preset2ch50Sps
+ * @brief Two channels at 50 SPS in full power mode, five frames per second.
+ */
+struct Preset2ch50Sps : PresetDefault {
+    static constexpr uint8_t power_mode = AD7124_POWER_MODE_FULL;
+    static constexpr uint16_t filter_fs = ad7124_filter_fs(power_mode, channels, 50);
+    static constexpr unsigned int batch_max_samples = 40;
+    static constexpr uint32_t batch_deadline_ms = 1000;
+    static constexpr unsigned int trigger_pre_samples = 8;
+    static constexpr unsigned int trigger_post_samples = 100;
+    static constexpr float trigger_slope_mv = 2.0f;
+    static constexpr unsigned int trigger_baseline_shift = 6;
+    static constexpr unsigned int band_window = 128;
+    static constexpr float band_edges_hz[band_count + 1] = {0.4f, 1.0f, 4.0f, 10.0f, 25.0f};
+    static constexpr float mains_highpass_hz = 0.05f;
+};
+
+/**
+ * @struct Preset2ch1kSps
+ * @brief Two channels at nominally 1 kSPS (FS 2 gives 1200 SPS), 50 samples per frame.
+ */
+struct Preset2ch1kSps : PresetDefault {
+    static constexpr unsigned int vector_size = 50;
+    static constexpr uint8_t power_mode = AD7124_POWER_MODE_FULL;
+    static constexpr uint16_t filter_fs = ad7124_filter_fs(power_mode, channels, 1000);
+    static constexpr unsigned int batch_min_samples = 10;
+    static constexpr unsigned int batch_max_samples = 64;
+    static constexpr uint32_t batch_deadline_ms = 100;
+    static constexpr unsigned int trigger_pre_samples = 40;
+    static constexpr unsigned int trigger_post_samples = 2400;
+    static constexpr float trigger_slope_mv = 1.0f;
+    static constexpr unsigned int trigger_baseline_k = 8;
+    static constexpr unsigned int trigger_baseline_shift = 10;
+    static constexpr unsigned int band_window = 512;
+    static constexpr float band_edges_hz[band_count + 1] = {2.5f, 5.0f, 10.0f, 30.0f, 100.0f};
+    static constexpr unsigned int mains_harmonics = 8;
+    static constexpr float mains_highpass_hz = 0.05f;
+    static constexpr float mains_lowpass_hz = 60.0f;
+    static constexpr unsigned int mains_decimation = 5;
+};
+
+/**
+ * @struct Preset8ch50Sps
+ * @brief Four AD7124 on one bus, two channels each at 50 SPS.
+ */
+struct Preset8ch50Sps : Preset2ch50Sps {
+    static constexpr unsigned int devices = 4;
+};
+
+/**
+ * @struct PipelineConfigCheck
+ * @brief Rejects configurations the firmware cannot run.
+ * @tparam Config Configuration type.
+ */
+template <typename Config>
+struct PipelineConfigCheck {
+    static_assert(Config::channels == 2, "The SerialMail schema carries exactly two channels");
+    static_assert(Config::devices >= 1 && Config::devices <= 4, "A frame can be tagged with one of four devices");
+    static_assert(Config::vector_size > 0, "vector_size must be positive");
+    static_assert(Config::batch_min_samples > 0 && Config::batch_min_samples <= Config::vector_size &&
+                  Config::vector_size <= Config::batch_max_samples,
+                  "vector_size must lie between batch_min_samples and batch_max_samples");
+    static_assert(Config::trigger_pre_samples < Config::vector_size,
+                  "The pre-trigger window and the detecting sample must fit into one frame");
+    static_assert(Config::trigger_baseline_shift <= 16, "trigger_baseline_shift out of range");
+    static_assert(Config::band_window > 1 && Config::band_count > 0, "band_window and band_count must be positive");
+    static_assert(Config::filter_fs >= 1 && Config::filter_fs <= 2047, "filter_fs out of range");
+    static_assert(Config::gain == (float)(1 << ad7124_pga_code(Config::gain)), "gain must be a power of two up to 128");
+    static constexpr bool valid = true;     ///< Instantiating this member runs the checks.
+};
+
+#if defined(PHYTO_PRESET_2CH_50SPS)
+typedef Preset2ch50Sps PhytoConfig;
+#elif defined(PHYTO_PRESET_2CH_1KSPS)
+typedef Preset2ch1kSps PhytoConfig;
+#elif defined(PHYTO_PRESET_8CH_50SPS)
+typedef Preset8ch50Sps PhytoConfig;
+#else
+typedef PresetDefault PhytoConfig;     ///< Configuration the firmware is built with.
+#endif
+
+static_assert(PipelineConfigCheck<PhytoConfig>::valid, "Invalid pipeline configuration");
+
+#endif // PIPELINE_CONFIG_H
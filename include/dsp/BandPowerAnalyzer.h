@@ -0,0 +1,102 @@
+#ifndef BAND_POWER_ANALYZER_H
+#define BAND_POWER_ANALYZER_H
+
+/**
+ * @file BandPowerAnalyzer.h
+ * @brief Band powers of both channels over consecutive windows, computed sample by sample.
+ *
+ * @note This header must stay free of Mbed OS dependencies.
+ */
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/// Channels analyzed, matching the `SerialMail` schema.
+#define BAND_POWER_CHANNELS 2
+
+/// Bands per channel a `BandPowers` message can carry.
+#define BAND_POWER_MAX_BANDS 8
+
+/// Goertzel bins per channel, the sum of the bins of all bands.
+#define BAND_POWER_MAX_BINS 64
+
+/**
+ * @struct BandPowers
+ * @brief Band powers of one analysis window, the content of a band power frame.
+ */
+struct BandPowers {
+    uint32_t     window;                                                ///< Index of the window since start.
+    unsigned int bands;                                                 ///< Bands per channel.
+    float        power[BAND_POWER_CHANNELS][BAND_POWER_MAX_BANDS];      ///< Mean power per band in mV^2.
+};
+
+/**
+ * @class BandPowerAnalyzer
+ * @brief Goertzel filter bank summing DFT bin powers into bands, one window after the other.
+ *
+ * Every window of `window_samples` samples per channel yields the power of
+ * each band: the sum of the one-sided DFT bin powers `2 |X_k|^2 / N^2` of
+ * the bins whose frequency `k * rate / N` lies in `[edge_b, edge_b+1)` (the
+ * last band includes its upper edge). This is the mean power the band
+ * contributes to the signal, in mV^2 for inputs in mV, and equals what an
+ * FFT of the same rectangular window gives.
+ *
+ * Only the bins inside the bands are computed, each by a Goertzel resonator
+ * costing one multiply-add per sample, so the work is spread evenly over the
+ * samples instead of bursting at the end of a window, and no sample history
+ * is kept. The windows do not overlap. The first sample of each window is
+ * subtracted from the rest, which leaves every bin above DC unchanged but
+ * keeps the large electrode offset out of the single-precision state.
+ *
+ * The channels are fed independently, as the AD7124 sequencer alternates
+ * them; a window is complete once both channels have finished it.
+ */
+class BandPowerAnalyzer {
+public:
+    /**
+     * @brief Constructs an analyzer and assigns the DFT bins to the bands.
+     * @param window_samples Samples per channel and window, N.
+     * @param rate_sps Samples per second and channel.
+     * @param edges_hz `bands + 1` ascending band edges in Hz.
+     * @param bands Number of bands, at most `BAND_POWER_MAX_BANDS`.
+     *
+     * Bins beyond `BAND_POWER_MAX_BINS` are left out; `bins` tells how many
+     * are computed.
+     */
+    BandPowerAnalyzer(unsigned int window_samples, float rate_sps, const float* edges_hz, unsigned int bands);
+
+    /**
+     * @brief Adds a sample of one channel.
+     * @param channel 0 or 1; other values are ignored.
+     * @param millivolts Sample value.
+     * @return True if this sample completed the window of both channels; `powers` then holds it.
+     */
+    bool push(unsigned int channel, float millivolts);
+
+    /// Band powers of the last completed window.
+    const BandPowers& powers(void) const { return m_powers; }
+
+    /// Goertzel bins computed per channel.
+    unsigned int bins(void) const { return m_bins; }
+
+    /// Samples per channel and window.
+    unsigned int windowSamples(void) const { return m_window; }
+
+private:
+    unsigned int m_window;                                      ///< Samples per channel and window.
+    unsigned int m_bins;                                        ///< Bins in use.
+    std::array<float, BAND_POWER_MAX_BINS>   m_coeff;           ///< `2 cos(2 pi k / N)` of each bin.
+    std::array<float, BAND_POWER_MAX_BINS>   m_scale;           ///< Factor turning `|X_k|^2` into one-sided power.
+    std::array<uint8_t, BAND_POWER_MAX_BINS> m_band;            ///< Band of each bin.
+    float        m_s1[BAND_POWER_CHANNELS][BAND_POWER_MAX_BINS];///< Resonator state, last output.
+    float        m_s2[BAND_POWER_CHANNELS][BAND_POWER_MAX_BINS];///< Resonator state, output before.
+    float        m_offset[BAND_POWER_CHANNELS];                 ///< First sample of the current window.
+    unsigned int m_count[BAND_POWER_CHANNELS];                  ///< Samples of the current window.
+    uint32_t     m_done[BAND_POWER_CHANNELS];                   ///< Windows completed per channel.
+    BandPowers   m_powers;                                      ///< Result of the last window.
+
+    void finish(unsigned int channel);
+};
+
+#endif // BAND_POWER_ANALYZER_H
@@ -0,0 +1,184 @@
+#ifndef BIQUAD_H
+#define BIQUAD_H
+
+/**
+ * @file Biquad.h
+ * @brief Compile-time design of biquad sections and the fixed-point kernels running them.
+ *
+ * Sections are designed in double precision with `constexpr` functions (the
+ * cookbook formulas of R. Bristow-Johnson), so a preset's filter is computed
+ * by the compiler and only the quantized coefficients end up in flash. A
+ * section is
+ *
+ *     H(z) = (b0 + b1 z^-1 + b2 z^-2) / (1 + a1 z^-1 + a2 z^-2).
+ *
+ * The kernels work on Q31 values in direct form I. Coefficients are stored
+ * in the order and scaling of the CMSIS-DSP biquad functions: `{b0, b1, b2,
+ * -a1, -a2}`, each divided by 2^`BIQUAD_POST_SHIFT` so that |a1| < 2 fits.
+ * `biquad_cascade_q31` has the arithmetic of `arm_biquad_cascade_df1_q31`
+ * (64-bit accumulator, Q31 state, truncation) and `biquad_cascade_wide_q31`
+ * that of `arm_biquad_cas_df1_32x64_q31`, which keeps the output history in
+ * Q63. The wide kernel is needed for poles very close to z = 1, e.g. a
+ * high-pass at a small fraction of the sample rate, where the truncation of
+ * a Q31 output would be amplified into an offset of many codes.
+ *
+ * @note This header must stay free of Mbed OS dependencies.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+/// Coefficients are stored divided by 2^`BIQUAD_POST_SHIFT` and the accumulator is shifted back.
+#define BIQUAD_POST_SHIFT 1
+
+/// Q31 values per section in the state of `biquad_cascade_q31`: x[n-1], x[n-2], y[n-1], y[n-2].
+#define BIQUAD_STATE_SIZE 4
+
+/**
+ * @struct BiquadCoefficients
+ * @brief Section in double precision, normalized to a0 = 1.
+ */
+struct BiquadCoefficients {
+    double b0;
+    double b1;
+    double b2;
+    double a1;
+    double a2;
+};
+
+/**
+ * @struct BiquadQ31
+ * @brief Quantized section in CMSIS-DSP order, {b0, b1, b2, -a1, -a2} / 2^`BIQUAD_POST_SHIFT`.
+ */
+struct BiquadQ31 {
+    int32_t b0;
+    int32_t b1;
+    int32_t b2;
+    int32_t a1;
+    int32_t a2;
+};
+
+static_assert(sizeof(BiquadQ31) == 5 * sizeof(int32_t), "BiquadQ31 must match the CMSIS-DSP coefficient layout");
+
+/// pi, for the designs.
+constexpr double BIQUAD_PI = 3.14159265358979323846;
+
+/**
+ * @brief Sine for constant expressions, accurate to about 1e-15.
+ *
+ * @details
+ * The argument is reduced to [-pi, pi] and the Taylor series summed until
+ * its terms vanish.
+ */
+constexpr double biquad_sin(double x) {
+    double turns = x / (2 * BIQUAD_PI);
+    long long whole = (long long)(turns < 0 ? turns - 0.5 : turns + 0.5);
+    x -= (double)whole * 2 * BIQUAD_PI;
+    double term = x;
+    double sum = x;
+    for (int n = 1; n < 30; n++) {
+        term *= -x * x / ((2 * n) * (2 * n + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+/// Cosine for constant expressions.
+constexpr double biquad_cos(double x) {
+    return biquad_sin(x + BIQUAD_PI / 2);
+}
+
+/**
+ * @brief Notch removing one frequency, with unit gain far from it.
+ * @param f0_hz Notch frequency.
+ * @param rate_sps Sample rate.
+ * @param q Quality factor, f0 over the -3 dB bandwidth.
+ */
+constexpr BiquadCoefficients biquad_notch(double f0_hz, double rate_sps, double q) {
+    double w0 = 2 * BIQUAD_PI * f0_hz / rate_sps;
+    double alpha = biquad_sin(w0) / (2 * q);
+    double a0 = 1 + alpha;
+    double c = -2 * biquad_cos(w0) / a0;
+    return BiquadCoefficients{1 / a0, c, 1 / a0, c, (1 - alpha) / a0};
+}
+
+/**
+ * @brief Second-order high-pass.
+ * @param fc_hz Corner frequency.
+ * @param rate_sps Sample rate.
+ * @param q Quality factor, 1/sqrt(2) for Butterworth.
+ */
+constexpr BiquadCoefficients biquad_highpass(double fc_hz, double rate_sps, double q) {
+    double w0 = 2 * BIQUAD_PI * fc_hz / rate_sps;
+    double alpha = biquad_sin(w0) / (2 * q);
+    double a0 = 1 + alpha;
+    double cw = biquad_cos(w0);
+    return BiquadCoefficients{(1 + cw) / 2 / a0, -(1 + cw) / a0, (1 + cw) / 2 / a0, -2 * cw / a0, (1 - alpha) / a0};
+}
+
+/**
+ * @brief Second-order low-pass.
+ * @param fc_hz Corner frequency.
+ * @param rate_sps Sample rate.
+ * @param q Quality factor of the section.
+ */
+constexpr BiquadCoefficients biquad_lowpass(double fc_hz, double rate_sps, double q) {
+    double w0 = 2 * BIQUAD_PI * fc_hz / rate_sps;
+    double alpha = biquad_sin(w0) / (2 * q);
+    double a0 = 1 + alpha;
+    double cw = biquad_cos(w0);
+    return BiquadCoefficients{(1 - cw) / 2 / a0, (1 - cw) / a0, (1 - cw) / 2 / a0, -2 * cw / a0, (1 - alpha) / a0};
+}
+
+/**
+ * @brief Rounds a coefficient to the stored Q31 value.
+ */
+constexpr int32_t biquad_q31(double value) {
+    double scaled = value * (double)(1ll << (31 - BIQUAD_POST_SHIFT));
+    long long rounded = (long long)(scaled < 0 ? scaled - 0.5 : scaled + 0.5);
+    return (int32_t)(rounded > INT32_MAX ? INT32_MAX : rounded < INT32_MIN ? INT32_MIN : rounded);
+}
+
+/**
+ * @brief Quantizes a section for the kernels.
+ *
+ * @details
+ * If the numerator sums to zero (a high-pass) or is symmetric (a notch),
+ * the quantized one is as well, so the zero at DC or on the unit circle is
+ * exact and the rejection is not limited by rounding.
+ */
+constexpr BiquadQ31 biquad_quantize(const BiquadCoefficients& section) {
+    BiquadQ31 q{biquad_q31(section.b0), biquad_q31(section.b1), biquad_q31(section.b2),
+                biquad_q31(-section.a1), biquad_q31(-section.a2)};
+    double dc_gain = section.b0 + section.b1 + section.b2;
+    if (dc_gain < 1e-12 && dc_gain > -1e-12) {
+        q.b1 = -(q.b0 + q.b2);
+    }
+    return q;
+}
+
+/**
+ * @brief Runs a cascade of sections in place of `arm_biquad_cascade_df1_q31`.
+ * @param sections Quantized sections.
+ * @param count Number of sections.
+ * @param state `BIQUAD_STATE_SIZE` values per section, zero at start.
+ * @param in Q31 input.
+ * @param out Q31 output; may be `in`.
+ * @param samples Number of samples.
+ */
+void biquad_cascade_q31(const BiquadQ31* sections, unsigned int count, int32_t* state,
+                        const int32_t* in, int32_t* out, size_t samples);
+
+/**
+ * @brief Runs a cascade of sections in place of `arm_biquad_cas_df1_32x64_q31`.
+ * @param sections Quantized sections.
+ * @param count Number of sections.
+ * @param state `BIQUAD_STATE_SIZE` values per section (inputs in Q31, outputs in Q63), zero at start.
+ * @param in Q31 input.
+ * @param out Q31 output; may be `in`.
+ * @param samples Number of samples.
+ */
+void biquad_cascade_wide_q31(const BiquadQ31* sections, unsigned int count, int64_t* state,
+                             const int32_t* in, int32_t* out, size_t samples);
+
+#endif // BIQUAD_H
@@ -0,0 +1,251 @@
+#ifndef MAINS_FILTER_H
+#define MAINS_FILTER_H
+
+/**
+ * @file MainsFilter.h
+ * @brief Per-channel biquad cascade removing mains hum and electrode drift, with optional decimation.
+ *
+ * @note This header must stay free of Mbed OS dependencies.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+#include "adc/SampleVector.h"
+#include "config/PipelineConfig.h"
+#include "dsp/Biquad.h"
+
+#if defined(CMSIS_DSP)
+#include "arm_math.h"
+#endif
+
+/// Channels filtered, matching the `SerialMail` schema.
+#define MAINS_FILTER_CHANNELS 2
+
+/// Notches and low-pass sections a filter can have.
+#define MAINS_FILTER_MAX_SECTIONS 12
+
+/// Low-pass sections used before decimation, a fourth-order Butterworth.
+#define MAINS_FILTER_LOWPASS_SECTIONS 2
+
+/// Bits of headroom above the 24-bit samples in the Q31 filter input.
+#define MAINS_FILTER_HEADROOM_BITS 6
+
+/// Samples filtered per kernel call.
+#define MAINS_FILTER_BLOCK 64
+
+/// Harmonics folding closer than this fraction of the sample rate to DC or Nyquist are not notched.
+constexpr double MAINS_FILTER_EDGE_FRACTION = 0.01;
+
+/// Quality factors of the Butterworth sections: 1/sqrt(2) for the high-pass, the fourth-order pair for the low-pass.
+constexpr double MAINS_FILTER_BUTTERWORTH_Q2 = 0.70710678118654752;
+constexpr double MAINS_FILTER_BUTTERWORTH_Q4[MAINS_FILTER_LOWPASS_SECTIONS] = {0.54119610014619698,
+                                                                               1.30656296487637653};
+
+/**
+ * @enum FilterSectionKind
+ * @brief Purpose of a section.
+ */
+enum FilterSectionKind : uint8_t {
+    FILTER_SECTION_HIGHPASS = 0,    ///< Removes the electrode offset and drift.
+    FILTER_SECTION_NOTCH    = 1,    ///< Removes a mains harmonic.
+    FILTER_SECTION_LOWPASS  = 2,    ///< Band limit before decimation.
+};
+
+/**
+ * @struct FilterSectionPlan
+ * @brief What a section was designed for.
+ */
+struct FilterSectionPlan {
+    FilterSectionKind kind;     ///< Section type.
+    double frequency_hz;        ///< Notch or corner frequency, folded into [0, rate / 2].
+    double q;                   ///< Quality factor.
+};
+
+/**
+ * @struct MainsFilterDesign
+ * @brief Sections of a mains filter, computed at compile time from a preset.
+ *
+ * The high-pass, if any, runs first on the wide kernel; notches and low-pass
+ * sections follow on the Q31 kernel.
+ */
+struct MainsFilterDesign {
+    double            rate_sps;                             ///< Input sample rate per channel.
+    unsigned int      decimation;                           ///< One output sample per this many inputs.
+    bool              has_highpass;                         ///< Whether `highpass` is used.
+    FilterSectionPlan highpass_plan;                        ///< Design of the high-pass.
+    BiquadQ31         highpass;                             ///< Quantized high-pass.
+    unsigned int      section_count;                        ///< Sections in `sections`.
+    FilterSectionPlan plan[MAINS_FILTER_MAX_SECTIONS];      ///< Design of each section.
+    BiquadQ31         sections[MAINS_FILTER_MAX_SECTIONS];  ///< Quantized notches, then low-pass sections.
+};
+
+/**
+ * @brief Double-precision section of a plan, e.g. as reference.
+ * @param plan Section design.
+ * @param rate_sps Sample rate.
+ */
+constexpr BiquadCoefficients mains_filter_section(const FilterSectionPlan& plan, double rate_sps) {
+    return plan.kind == FILTER_SECTION_HIGHPASS ? biquad_highpass(plan.frequency_hz, rate_sps, plan.q)
+         : plan.kind == FILTER_SECTION_LOWPASS  ? biquad_lowpass(plan.frequency_hz, rate_sps, plan.q)
+         : biquad_notch(plan.frequency_hz, rate_sps, plan.q);
+}
+
+/**
+ * @brief Designs a mains filter.
+ * @param rate_sps Sample rate per channel.
+ * @param mains_hz Mains frequency.
+ * @param harmonics Multiples of `mains_hz` to notch, 1 for the fundamental only.
+ * @param notch_q Quality factor of the notches.
+ * @param highpass_hz High-pass corner, 0 for none.
+ * @param lowpass_hz Low-pass corner, 0 for none.
+ * @param decimation Output one of this many samples.
+ *
+ * @details
+ * A harmonic above half the sample rate is aliased and is notched where it
+ * folds to, unless that is within `MAINS_FILTER_EDGE_FRACTION` of the rate
+ * from DC (the high-pass deals with it) or Nyquist, or already notched.
+ * Notches beyond `MAINS_FILTER_MAX_SECTIONS` less the low-pass sections are
+ * left out.
+ */
+constexpr MainsFilterDesign mains_filter_design(double rate_sps, double mains_hz, unsigned int harmonics,
+                                                double notch_q, double highpass_hz, double lowpass_hz,
+                                                unsigned int decimation) {
+    MainsFilterDesign design{};
+    design.rate_sps = rate_sps;
+    design.decimation = decimation < 1 ? 1 : decimation;
+    if (highpass_hz > 0) {
+        design.has_highpass = true;
+        design.highpass_plan = FilterSectionPlan{FILTER_SECTION_HIGHPASS, highpass_hz, MAINS_FILTER_BUTTERWORTH_Q2};
+        design.highpass = biquad_quantize(mains_filter_section(design.highpass_plan, rate_sps));
+    }
+
+    const unsigned int lowpass = lowpass_hz > 0 ? MAINS_FILTER_LOWPASS_SECTIONS : 0;
+    const double edge = MAINS_FILTER_EDGE_FRACTION * rate_sps;
+    for (unsigned int k = 1; k <= harmonics && design.section_count + lowpass < MAINS_FILTER_MAX_SECTIONS; k++) {
+        double f = k * mains_hz;
+        f -= rate_sps * (double)(long long)(f / rate_sps);
+        if (f > rate_sps / 2) {
+            f = rate_sps - f;
+        }
+        bool usable = f >= edge && f <= rate_sps / 2 - edge;
+        for (unsigned int i = 0; usable && i < design.section_count; i++) {
+            double distance = f - design.plan[i].frequency_hz;
+            usable = distance >= edge || distance <= -edge;
+        }
+        if (usable) {
+            design.plan[design.section_count++] = FilterSectionPlan{FILTER_SECTION_NOTCH, f, notch_q};
+        }
+    }
+    for (unsigned int i = 0; i < lowpass; i++) {
+        design.plan[design.section_count++] =
+            FilterSectionPlan{FILTER_SECTION_LOWPASS, lowpass_hz, MAINS_FILTER_BUTTERWORTH_Q4[i]};
+    }
+    for (unsigned int i = 0; i < design.section_count; i++) {
+        design.sections[i] = biquad_quantize(mains_filter_section(design.plan[i], rate_sps));
+    }
+    return design;
+}
+
+/**
+ * @brief Mains filter of a `PipelineConfig`.
+ * @tparam Config Configuration type.
+ */
+template <typename Config>
+constexpr MainsFilterDesign mains_filter_design(void) {
+    constexpr double rate_sps = ad7124_rate_sps(Config::power_mode, Config::channels, Config::filter_fs);
+    static_assert(Config::mains_decimation >= 1 && Config::vector_size % Config::mains_decimation == 0,
+                  "mains_decimation must divide vector_size");
+    static_assert(Config::mains_decimation == 1 ||
+                  (Config::mains_lowpass_hz > 0 && Config::mains_lowpass_hz <= rate_sps / (2 * Config::mains_decimation)),
+                  "Decimation needs a low-pass below the decimated Nyquist frequency");
+    static_assert(Config::mains_highpass_hz < rate_sps / 2 && Config::mains_lowpass_hz < rate_sps / 2,
+                  "Filter corners must lie below half the sample rate");
+    static_assert(Config::mains_harmonics == 0 || Config::mains_notch_q > 0, "mains_notch_q must be positive");
+    return mains_filter_design(rate_sps, Config::mains_hz, Config::mains_harmonics, Config::mains_notch_q,
+                               Config::mains_highpass_hz, Config::mains_lowpass_hz, Config::mains_decimation);
+}
+
+/**
+ * @class MainsFilter
+ * @brief Filters the frames of both channels and collects the decimated output into frames.
+ *
+ * Every frame of `vector_size` samples per channel is converted to Q31 with
+ * `MAINS_FILTER_HEADROOM_BITS` bits of headroom, run through the high-pass
+ * on the wide kernel and the notches and low-pass sections on the Q31
+ * kernel, rounded back to 24-bit samples and saturated. Of every
+ * `decimation` samples the last one is kept, so a frame still ends with the
+ * filtered value of its last input sample; `decimation` frames in give one
+ * frame out.
+ *
+ * With `CMSIS_DSP` the kernels are `arm_biquad_cas_df1_32x64_q31` and
+ * `arm_biquad_cascade_df1_q31`; otherwise the portable functions of
+ * `Biquad.h` with the same arithmetic run.
+ *
+ * The state is primed with the first sample of each channel as if it had
+ * been constant before, so the electrode offset does not ring through the
+ * filter at start.
+ */
+class MainsFilter {
+public:
+    /**
+     * @brief Constructs a filter.
+     * @param design Sections and decimation, e.g. `mains_filter_design<PhytoConfig>()`.
+     * @param vector_size Samples per channel of the frames in and out.
+     */
+    MainsFilter(const MainsFilterDesign& design, unsigned int vector_size);
+
+    MainsFilter(const MainsFilter&) = delete;
+    MainsFilter& operator=(const MainsFilter&) = delete;
+
+    /**
+     * @brief Filters a frame of both channels.
+     * @param ch0 Samples of channel 0.
+     * @param ch1 Samples of channel 1.
+     * @return True if the output now holds `vector_size` samples per channel.
+     */
+    bool push(const SampleVector& ch0, const SampleVector& ch1);
+
+    /**
+     * @brief Filters samples of one channel without decimating them.
+     * @param channel 0 or 1; other values are ignored.
+     * @param in Samples.
+     * @param out Receives `count` filtered samples; may be `in`.
+     * @param count Number of samples.
+     */
+    void process(unsigned int channel, const int32_t* in, int32_t* out, size_t count);
+
+    /// Empties the output for the next frame.
+    void clear(void);
+
+    /// Filtered samples of channel 0.
+    const SampleVector& ch0(void) const { return m_ch0; }
+
+    /// Filtered samples of channel 1.
+    const SampleVector& ch1(void) const { return m_ch1; }
+
+private:
+    unsigned int m_vector_size;                                     ///< Samples per channel and frame.
+    unsigned int m_decimation;                                      ///< Inputs per output sample.
+    unsigned int m_section_count;                                   ///< Sections of the Q31 cascade.
+    bool         m_has_highpass;                                    ///< Whether the wide kernel runs.
+    BiquadQ31    m_highpass;                                        ///< High-pass section.
+    BiquadQ31    m_sections[MAINS_FILTER_MAX_SECTIONS];             ///< Notches and low-pass sections.
+    int64_t      m_highpass_state[MAINS_FILTER_CHANNELS][BIQUAD_STATE_SIZE];                        ///< Wide kernel state.
+    int32_t      m_state[MAINS_FILTER_CHANNELS][MAINS_FILTER_MAX_SECTIONS * BIQUAD_STATE_SIZE];     ///< Q31 kernel state.
+    bool         m_primed[MAINS_FILTER_CHANNELS];                   ///< Whether the channel's state was primed.
+    unsigned int m_phase[MAINS_FILTER_CHANNELS];                    ///< Inputs since the last kept sample.
+    int32_t      m_block[MAINS_FILTER_BLOCK];                       ///< Q31 samples of the current block.
+    int32_t      m_filtered[MAINS_FILTER_BLOCK];                    ///< Filtered samples before decimation.
+    SampleVector m_ch0;                                             ///< Output of channel 0.
+    SampleVector m_ch1;                                             ///< Output of channel 1.
+#if defined(CMSIS_DSP)
+    arm_biquad_cas_df1_32x64_ins_q31 m_highpass_instance[MAINS_FILTER_CHANNELS];   ///< CMSIS-DSP high-pass.
+    arm_biquad_casd_df1_inst_q31     m_cascade_instance[MAINS_FILTER_CHANNELS];    ///< CMSIS-DSP cascade.
+#endif
+
+    void prime(unsigned int channel, int32_t x);
+    void decimate(unsigned int channel, const SampleVector& in, SampleVector& out);
+};
+
+#endif // MAINS_FILTER_H
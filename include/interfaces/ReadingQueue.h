@@ -2,6 +2,16 @@
 #define READING_QUEUE_H
 
 #include "mbed.h"
+#include "adc/SampleVector.h"
+#include "config/PipelineConfig.h"
+
+#if defined(ZERO_HEAP)
+/// Mail slots; a single converter waits for an empty mailbox, several complete their frames together.
+#define READING_QUEUE_DEPTH (2 + 2 * PhytoConfig::devices)
+#else
+/// Mail slots holding heap-backed sample vectors.
+#define READING_QUEUE_DEPTH 204
+#endif
 
 /**
  * @class ReadingQueue
@@ -24,11 +34,15 @@ public:
      * @brief Structure used for inter-thread communication.
      *
      * The `mail_t` structure contains vectors of downsampled ADC readings for
-     * multiple channels. Each vector holds 3-byte arrays representing the data.
+     * multiple channels. Each vector holds sign-corrected samples.
      */
     typedef struct {
-        std::vector<std::array<uint8_t, 3>> ch0;  ///< Downsampled ADC values for channel 0.
-        std::vector<std::array<uint8_t, 3>> ch1;  ///< Downsampled ADC values for channel 1.
+        SampleVector ch0;  ///< Downsampled ADC values for channel 0.
+        SampleVector ch1;  ///< Downsampled ADC values for channel 1.
+        uint8_t device;    ///< AD7124 the values come from, 0 on a node with one converter.
+#if defined(CLOCK_SYNC)
+        uint64_t time_us;  ///< Node time the last sample was read (`node_clock_us`).
+#endif
     } mail_t;
 
     /**
@@ -38,7 +52,7 @@ public:
      * The mailbox can hold up to 4 messages by default. It uses the `mail_t` structure
      * to store data passed between threads.
      */
-    Mail<mail_t, 204> mail_box;  ///< Queue for inter-thread communication (size 4).
+    Mail<mail_t, READING_QUEUE_DEPTH> mail_box;  ///< Queue for inter-thread communication.
 
 private:
     /**
@@ -0,0 +1,208 @@
+#ifndef BENCHMARK_SWEEP_H
+#define BENCHMARK_SWEEP_H
+
+/**
+ * @file BenchmarkSweep.h
+ * @brief Operating points, counters and result table of the self-benchmark (`SELF_BENCHMARK`).
+ *
+ * The node and `phyto_self_bench_sim` step through the same points, derive
+ * their results with `evaluate_benchmark` and print them with the same
+ * table functions, so a node report and a simulation can be compared line
+ * by line.
+ *
+ * The table is CSV: a comment line starting with `#`, the column names, one
+ * row per point and a closing comment line naming the fastest sustained
+ * point.
+ *
+ * @note This header must stay free of Mbed OS dependencies.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+/// Measuring time per operating point, in ms.
+#define BENCHMARK_POINT_MS 2000
+
+/// Time after reprogramming the ADC before a point is measured, in ms; covers the Sinc4 settling.
+#define BENCHMARK_SETTLE_MS 200
+
+/// Share of the expected conversions a sustained point must deliver, in percent.
+#define BENCHMARK_MIN_RATE_PCT 99
+
+/**
+ * Share of the conversions a sustained point may lose, in percent. The
+ * polling loop skips a word whenever DRDY falls while the main thread has
+ * the CPU, so a few are lost at any rate.
+ */
+#define BENCHMARK_MAX_MISSED_PCT 1
+
+/// UART utilization a sustained point must stay below, in percent.
+#define BENCHMARK_MAX_UART_PCT 95
+
+/// SPI clocks of the sweep; the STM32WB55 divides its 64 MHz bus clock by powers of two.
+constexpr int BENCHMARK_SPI_FREQUENCIES[] = {1000000, 2000000, 4000000, 8000000, 16000000};
+
+/// Filter words FS of the sweep at full power: 50, 200, 600, 1200 and 2400 SPS per channel.
+constexpr uint16_t BENCHMARK_FILTER_FS[] = {48, 12, 4, 2, 1};
+
+/// Samples per channel and frame of the sweep.
+constexpr unsigned int BENCHMARK_VECTOR_SIZES[] = {10, 25, 50};
+
+/// Number of operating points of a complete sweep.
+constexpr size_t BENCHMARK_MAX_POINTS = (sizeof(BENCHMARK_SPI_FREQUENCIES) / sizeof(BENCHMARK_SPI_FREQUENCIES[0])) *
+                                        (sizeof(BENCHMARK_FILTER_FS) / sizeof(BENCHMARK_FILTER_FS[0])) *
+                                        (sizeof(BENCHMARK_VECTOR_SIZES) / sizeof(BENCHMARK_VECTOR_SIZES[0]));
+
+/// Largest table row, with every field at its widest.
+#define BENCHMARK_LINE_SIZE 160
+
+/// Comment and column name lines of the table.
+#define BENCHMARK_HEADER_SIZE 256
+
+/**
+ * @struct BenchmarkPoint
+ * @brief SPI clock, ADC filter and frame size of one measurement.
+ */
+struct BenchmarkPoint {
+    int          spi_frequency; ///< SPI clock in Hz.
+    uint8_t      power_mode;    ///< `POWER_MODE` field of the AD7124.
+    uint16_t     filter_fs;     ///< Filter word FS of both channels.
+    unsigned int vector_size;   ///< Samples per channel and frame.
+};
+
+/**
+ * @struct BenchmarkCounters
+ * @brief Raw counts of one measuring window.
+ */
+struct BenchmarkCounters {
+    uint32_t elapsed_us;        ///< Length of the window.
+    uint32_t conversions;       ///< Conversion words read with channel 0 or 1.
+    uint32_t missed;            ///< Conversions overwritten before they were read, seen as a repeated channel.
+    uint32_t errors;            ///< Words whose status byte names another channel, e.g. after a misaligned read.
+    uint32_t frames;            ///< Frames handed to the sender.
+    uint32_t frame_drops;       ///< Frames lost to a full pool or a full sink queue.
+    uint32_t busy_us;           ///< CPU time spent on acquisition, hand-off, framing and the UART.
+    uint32_t uart_bytes;        ///< Bytes written to the UART.
+};
+
+/**
+ * @struct BenchmarkResult
+ * @brief One row of the table.
+ */
+struct BenchmarkResult {
+    BenchmarkPoint point;           ///< Operating point.
+    uint32_t       expected_sps;    ///< Conversions per second of both channels the filter word gives.
+    float          conversions_sps; ///< Conversions read per second.
+    uint32_t       missed;          ///< See `BenchmarkCounters`.
+    uint32_t       errors;          ///< See `BenchmarkCounters`.
+    uint32_t       frames;          ///< See `BenchmarkCounters`.
+    uint32_t       frame_drops;     ///< See `BenchmarkCounters`.
+    float          cpu_pct;         ///< Busy time per window.
+    float          uart_pct;        ///< Bits written per bit the UART can carry.
+    bool           sustained;       ///< The pipeline kept up, see `evaluate_benchmark`.
+};
+
+/**
+ * @struct ConversionTracker
+ * @brief Counts conversion words by the channel in their status byte.
+ *
+ * The AD7124 alternates between channel 0 and 1, so a channel read twice in
+ * a row means the conversion in between was overwritten before it was read.
+ * An odd number of lost conversions is detected this way, an even number is
+ * not; at rates where words are lost, that undercounts by about half.
+ */
+struct ConversionTracker {
+    uint32_t conversions;   ///< Words with channel 0 or 1.
+    uint32_t missed;        ///< Repeated channels.
+    uint32_t errors;        ///< Words with another channel.
+    int      last_channel;  ///< Channel of the last word, -1 before the first.
+
+    /// Counts the status byte of a word.
+    void push(uint8_t status) {
+        int channel = status & 0x0F;
+        if (channel > 1) {
+            errors++;
+            return;
+        }
+        conversions++;
+        if (channel == last_channel) {
+            missed++;
+        }
+        last_channel = channel;
+    }
+
+    /// Clears the counts for the next window.
+    void reset(void) {
+        conversions = 0;
+        missed = 0;
+        errors = 0;
+        last_channel = -1;
+    }
+};
+
+/**
+ * @brief Lists the operating points of a sweep, slowest ADC rate first.
+ * @param points Receives up to `capacity` points.
+ * @param capacity Size of `points`, `BENCHMARK_MAX_POINTS` for every point.
+ * @param max_vector_size Frame sizes above this are skipped, e.g. those a zero-heap build cannot hold.
+ * @return Number of points written.
+ */
+size_t benchmark_points(BenchmarkPoint* points, size_t capacity, unsigned int max_vector_size);
+
+/**
+ * @brief Derives a table row from the counts of a window.
+ * @param point Operating point measured.
+ * @param counters Counts of the window.
+ * @param baudrate UART bit rate, 10 bits per byte.
+ * @return Row, `sustained` set if no frame was lost and no word was
+ *         misread, at most `BENCHMARK_MAX_MISSED_PCT` of the words were
+ *         missed, at least `BENCHMARK_MIN_RATE_PCT` of the expected
+ *         conversions were read and the UART stayed below `BENCHMARK_MAX_UART_PCT`.
+ */
+BenchmarkResult evaluate_benchmark(const BenchmarkPoint& point, const BenchmarkCounters& counters, int baudrate);
+
+/**
+ * @brief Sustained row with the highest expected rate; of equal rates the one with the least CPU load.
+ * @param results Rows of a sweep.
+ * @param count Number of rows.
+ * @return Index of the row, `count` if none was sustained.
+ */
+size_t best_sustained(const BenchmarkResult* results, size_t count);
+
+/**
+ * @brief Writes the comment and column name lines.
+ * @param source Who measured, e.g. `node 3` or `sim`.
+ * @param out Destination, always terminated.
+ * @param capacity Size of `out`, `BENCHMARK_HEADER_SIZE` suffices.
+ * @return Characters written without the terminator.
+ */
+size_t format_benchmark_header(const char* source, char* out, size_t capacity);
+
+/**
+ * @brief Writes one row.
+ * @param result Row to write.
+ * @param out Destination, always terminated.
+ * @param capacity Size of `out`, `BENCHMARK_LINE_SIZE` suffices.
+ * @return Characters written without the terminator.
+ */
+size_t format_benchmark_row(const BenchmarkResult& result, char* out, size_t capacity);
+
+/**
+ * @brief Writes the closing line naming the fastest sustained row.
+ * @param results Rows of the sweep.
+ * @param count Number of rows.
+ * @param out Destination, always terminated.
+ * @param capacity Size of `out`.
+ * @return Characters written without the terminator.
+ */
+size_t format_benchmark_summary(const BenchmarkResult* results, size_t count, char* out, size_t capacity);
+
+/**
+ * @brief Reads a row written by `format_benchmark_row`.
+ * @param line Line with or without its line break.
+ * @param result Receives the row.
+ * @return False for comment lines, the column names and anything else that is not a row.
+ */
+bool parse_benchmark_row(const char* line, BenchmarkResult* result);
+
+#endif // BENCHMARK_SWEEP_H
@@ -0,0 +1,134 @@
+#ifndef EVENT_PIPELINE_H
+#define EVENT_PIPELINE_H
+
+#include "mbed.h"
+#include "adc/AD7124.h"
+#include "adc/SampleCollector.h"
+
+#if defined(BAND_POWER)
+#include "dsp/BandPowerAnalyzer.h"
+#endif
+
+#if defined(EVENT_TRIGGER)
+#include "adc/TriggerEngine.h"
+#elif defined(ADAPTIVE_BATCHING)
+#include "serial_mail_sender/AdaptiveBatcher.h"
+#endif
+
+/// Priority of the acquisition thread; DRDY reads preempt framing and transmission.
+#define PIPELINE_ACQUISITION_PRIORITY osPriorityHigh
+
+/// Stack of the acquisition thread, which only runs the short read events.
+#define PIPELINE_ACQUISITION_STACK_SIZE 1024
+
+/// Pending read events the acquisition queue can hold.
+#define PIPELINE_ACQUISITION_EVENTS 4
+
+/// Pending frames the output queue can hold.
+#define PIPELINE_OUTPUT_EVENTS 4
+
+/// Buffer of the acquisition queue in bytes.
+#define PIPELINE_ACQUISITION_QUEUE_SIZE (PIPELINE_ACQUISITION_EVENTS * EVENTS_EVENT_SIZE)
+
+#if defined(BAND_POWER)
+/// Buffer of the output queue: frame events carrying both sample vectors, band power events and the periodic events.
+#define PIPELINE_OUTPUT_QUEUE_SIZE \
+    (PIPELINE_OUTPUT_EVENTS * (EVENTS_EVENT_SIZE + 2 * sizeof(SampleVector)) + \
+     2 * (EVENTS_EVENT_SIZE + sizeof(BandPowers)) + 3 * EVENTS_EVENT_SIZE)
+#else
+/// Buffer of the output queue: frame events carrying both sample vectors, plus the periodic events.
+#define PIPELINE_OUTPUT_QUEUE_SIZE \
+    (PIPELINE_OUTPUT_EVENTS * (EVENTS_EVENT_SIZE + 2 * sizeof(SampleVector)) + 3 * EVENTS_EVENT_SIZE)
+#endif
+
+/**
+ * @class EventPipeline
+ * @brief Singleton running acquisition, framing and transmission as run-to-completion events.
+ *
+ * Replaces the polling `reading_data_thread` and the main mail loop (`EVENT_PIPELINE`):
+ *
+ * - The falling DRDY edge triggers an interrupt that posts a read event to the
+ *   acquisition queue. That queue is dispatched by a small thread at
+ *   `PIPELINE_ACQUISITION_PRIORITY`, so a pending read always preempts the
+ *   output work.
+ * - The read event clocks the conversion word out and feeds the
+ *   `SampleCollector`. A full collector posts a frame event to the output queue;
+ *   with `EVENT_TRIGGER` each sample pair goes through the `TriggerEngine`
+ *   instead, which posts only event windows and heartbeats. With `BAND_POWER`
+ *   every word also feeds the `BandPowerAnalyzer`, which posts one band power
+ *   event per window.
+ * - The output queue is dispatched by the calling thread in `run` at its own
+ *   (normal) priority; it serializes the frame with the `SerialMailSender` and
+ *   services the sinks periodically.
+ *
+ * Threads only wake up for work: once per conversion and once per frame,
+ * instead of a permanently busy polling thread. With `ZERO_HEAP` the queue
+ * buffers and the thread stack are members instead of heap blocks.
+ */
+class EventPipeline {
+public:
+    /**
+     * @brief Gets the singleton instance of the EventPipeline.
+     * @return Reference to the singleton instance of EventPipeline.
+     */
+    static EventPipeline& getInstance(void);
+
+    /// Deleted copy constructor to enforce the singleton pattern.
+    EventPipeline(const EventPipeline&) = delete;
+
+    /// Deleted copy assignment operator to enforce the singleton pattern.
+    EventPipeline& operator=(const EventPipeline&) = delete;
+
+    /**
+     * @brief Starts acquisition and dispatches the output events forever.
+     * @param adc Configured AD7124.
+     * @param vector_size Samples per channel and frame.
+     * @param node Node identifier written into each frame.
+     * @param service_period Period at which the sinks are serviced.
+     */
+    void run(AD7124& adc, unsigned int vector_size, int node, std::chrono::milliseconds service_period);
+
+    /**
+     * @brief Number of frames lost because the output queue was full.
+     * @return Count since start.
+     */
+    uint32_t droppedFrames(void) const { return m_dropped_frames; }
+
+private:
+#if defined(ZERO_HEAP)
+    MBED_ALIGN(8) unsigned char m_acquisition_stack[PIPELINE_ACQUISITION_STACK_SIZE];  ///< Stack of the acquisition thread.
+    unsigned char   m_acquisition_buffer[PIPELINE_ACQUISITION_QUEUE_SIZE];  ///< Storage of the read events.
+    unsigned char   m_output_buffer[PIPELINE_OUTPUT_QUEUE_SIZE];            ///< Storage of the output events.
+#endif
+    AD7124*         m_adc;                  ///< ADC read by the acquisition events.
+    SampleCollector* m_collector;           ///< Groups words into frames.
+#if defined(EVENT_TRIGGER)
+    TriggerEngine*  m_trigger;              ///< Selects the event windows and heartbeats that are sent.
+#elif defined(ADAPTIVE_BATCHING)
+    AdaptiveBatcher* m_batcher;             ///< Decides when a frame is sent.
+    Kernel::Clock::time_point m_batch_start;///< Time of the oldest sample in the collector.
+#endif
+#if defined(BAND_POWER)
+    BandPowerAnalyzer* m_band_power;        ///< Band powers of the acquired words.
+#endif
+    int             m_node;                 ///< Node identifier.
+    InterruptIn     m_drdy;                 ///< DRDY falling edge.
+    EventQueue      m_acquisition_queue;    ///< Read events.
+    EventQueue      m_output_queue;         ///< Frame and service events.
+    Thread          m_acquisition_thread;   ///< Dispatches `m_acquisition_queue`.
+    volatile uint32_t m_drdy_us;            ///< Timestamp of the last DRDY interrupt.
+    uint32_t        m_dropped_frames;       ///< Frames lost to a full output queue.
+
+    EventPipeline(void);
+    ~EventPipeline(void) = default;
+
+    void onDrdy(void);
+    void readConversion(void);
+    void sendFrame(SampleVector ch0, SampleVector ch1);
+#if defined(BAND_POWER)
+    void sendBandPowers(BandPowers powers);
+#endif
+    void serviceSinks(void);
+};
+
+#endif // EVENT_PIPELINE_H
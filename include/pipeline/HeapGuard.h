@@ -0,0 +1,61 @@
+#ifndef HEAP_GUARD_H
+#define HEAP_GUARD_H
+
+#include "mbed.h"
+
+#if !defined(MBED_HEAP_STATS_ENABLED) || !MBED_HEAP_STATS_ENABLED
+#error "HeapGuard needs platform.heap-stats-enabled in mbed_app.json5"
+#endif
+
+/// Interval between two heap checks.
+#define HEAP_GUARD_CHECK_PERIOD 1s
+
+/**
+ * @class HeapGuard
+ * @brief Singleton that halts the node if the heap is used after startup (`ZERO_HEAP`).
+ *
+ * `arm` takes a snapshot of the heap statistics once all threads, queues and
+ * drivers are set up. Every later `check` compares the cumulative allocated
+ * bytes and the failed allocations against that snapshot; any difference is a
+ * steady-state allocation and raises a fatal `MBED_ERROR`, so a regression is
+ * caught on the bench instead of surfacing as fragmentation weeks later.
+ */
+class HeapGuard {
+public:
+    /**
+     * @brief Gets the singleton instance of the HeapGuard.
+     * @return Reference to the singleton instance of HeapGuard.
+     */
+    static HeapGuard& getInstance(void);
+
+    /// Deleted copy constructor to enforce the singleton pattern.
+    HeapGuard(const HeapGuard&) = delete;
+
+    /// Deleted copy assignment operator to enforce the singleton pattern.
+    HeapGuard& operator=(const HeapGuard&) = delete;
+
+    /**
+     * @brief Marks the end of startup and takes the reference snapshot.
+     */
+    void arm(void);
+
+    /// True once `arm` was called.
+    bool armed(void) const { return m_armed; }
+
+    /**
+     * @brief Compares the heap statistics with the snapshot.
+     *
+     * Does nothing before `arm`. Raises `MBED_ERROR` on any allocation since.
+     */
+    void check(void);
+
+private:
+    bool     m_armed;           ///< Set by `arm`.
+    uint32_t m_total_size;      ///< Cumulative allocated bytes at `arm`.
+    uint32_t m_alloc_fail_cnt;  ///< Failed allocations at `arm`.
+
+    HeapGuard(void);
+    ~HeapGuard(void) = default;
+};
+
+#endif // HEAP_GUARD_H
@@ -0,0 +1,142 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+/**
+ * @file LatencyHistogram.h
+ * @brief Fixed-bucket log-linear latency histogram for the pipeline stages (`LATENCY_STATS`).
+ *
+ * Latencies in microseconds are counted in buckets of the HDR histogram kind:
+ * values below `2 * LATENCY_HISTOGRAM_SUB_BUCKETS` get a bucket each, above
+ * that every power of two is split into `LATENCY_HISTOGRAM_SUB_BUCKETS`
+ * buckets of equal width. A bucket is therefore never wider than 1/16 of its
+ * lower bound, and its midpoint is within 1/32 of every value counted in it.
+ * Values from `LATENCY_HISTOGRAM_RANGE_US` on share the overflow bucket.
+ *
+ * @note This header must stay free of Mbed OS dependencies.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/// Bits of a value kept below its leading one, i.e. log2 of the buckets per power of two.
+#define LATENCY_HISTOGRAM_SUB_BITS 4
+
+/// Buckets per power of two.
+#define LATENCY_HISTOGRAM_SUB_BUCKETS (1u << LATENCY_HISTOGRAM_SUB_BITS)
+
+/// Values are counted in their own bucket below 2^20 us (about 1 s).
+#define LATENCY_HISTOGRAM_RANGE_BITS 20
+
+/// First value counted in the overflow bucket, in us.
+#define LATENCY_HISTOGRAM_RANGE_US (1u << LATENCY_HISTOGRAM_RANGE_BITS)
+
+/// Index of the overflow bucket.
+constexpr size_t LATENCY_HISTOGRAM_OVERFLOW =
+    (size_t)(LATENCY_HISTOGRAM_RANGE_BITS - LATENCY_HISTOGRAM_SUB_BITS + 1) << LATENCY_HISTOGRAM_SUB_BITS;
+
+/// Number of buckets including the overflow bucket.
+constexpr size_t LATENCY_HISTOGRAM_BUCKETS = LATENCY_HISTOGRAM_OVERFLOW + 1;
+
+/**
+ * @brief Bucket a latency is counted in.
+ * @param us Latency in microseconds.
+ * @return Bucket index, `LATENCY_HISTOGRAM_OVERFLOW` from `LATENCY_HISTOGRAM_RANGE_US` on.
+ *
+ * The index is the position of the leading one times the buckets per power
+ * of two plus the `LATENCY_HISTOGRAM_SUB_BITS` bits below it; one count
+ * leading zeros instruction and two shifts.
+ */
+inline size_t latency_bucket(uint32_t us) {
+    if (us < LATENCY_HISTOGRAM_SUB_BUCKETS) {
+        return us;
+    }
+    if (us >= LATENCY_HISTOGRAM_RANGE_US) {
+        return LATENCY_HISTOGRAM_OVERFLOW;
+    }
+    unsigned int shift = 31 - __builtin_clz(us) - LATENCY_HISTOGRAM_SUB_BITS;
+    return ((size_t)shift << LATENCY_HISTOGRAM_SUB_BITS) + (us >> shift);
+}
+
+/**
+ * @brief Smallest latency counted in a bucket.
+ * @param bucket Bucket index.
+ * @return Lower bound in us.
+ */
+constexpr uint32_t latency_bucket_lower(size_t bucket) {
+    if (bucket < LATENCY_HISTOGRAM_SUB_BUCKETS) {
+        return (uint32_t)bucket;
+    }
+    if (bucket >= LATENCY_HISTOGRAM_OVERFLOW) {
+        return LATENCY_HISTOGRAM_RANGE_US;
+    }
+    unsigned int shift = (unsigned int)(bucket >> LATENCY_HISTOGRAM_SUB_BITS) - 1;
+    return (uint32_t)((bucket & (LATENCY_HISTOGRAM_SUB_BUCKETS - 1)) | LATENCY_HISTOGRAM_SUB_BUCKETS) << shift;
+}
+
+/**
+ * @brief Width of a bucket.
+ * @param bucket Bucket index below `LATENCY_HISTOGRAM_OVERFLOW`.
+ * @return Number of latencies in us counted in the bucket.
+ */
+constexpr uint32_t latency_bucket_width(size_t bucket) {
+    return bucket < 2 * LATENCY_HISTOGRAM_SUB_BUCKETS ? 1u
+                                                      : 1u << ((bucket >> LATENCY_HISTOGRAM_SUB_BITS) - 1);
+}
+
+/**
+ * @struct LatencySnapshot
+ * @brief Counts of a `LatencyHistogram` taken at one instant.
+ */
+struct LatencySnapshot {
+    uint32_t counts[LATENCY_HISTOGRAM_BUCKETS];     ///< Latencies per bucket.
+    uint32_t total;                                 ///< Sum of all counts.
+    uint32_t max_us;                                ///< Largest latency, 0 if none.
+};
+
+/**
+ * @brief Estimates a quantile from a snapshot.
+ * @param snapshot Counts to evaluate.
+ * @param fraction Quantile in [0, 1], e.g. 0.99.
+ * @return Midpoint of the bucket holding the quantile, at most `max_us`; 0 for an empty snapshot.
+ */
+uint32_t latency_percentile(const LatencySnapshot& snapshot, double fraction);
+
+/**
+ * @class LatencyHistogram
+ * @brief Lock-free latency histogram of one pipeline stage.
+ *
+ * `record` is a relaxed atomic increment of one bucket plus a compare of the
+ * maximum, so it can be called from any thread or interrupt without a lock
+ * and never allocates. `snapshot` exchanges every bucket with zero: each
+ * recorded latency is counted in exactly one snapshot, even while records
+ * continue. Buckets are not read at one instant, so a snapshot spans the
+ * few microseconds the exchange takes.
+ */
+class LatencyHistogram {
+public:
+    LatencyHistogram(void);
+
+    /**
+     * @brief Counts one latency.
+     * @param us Latency in microseconds.
+     */
+    void record(uint32_t us) {
+        m_counts[latency_bucket(us)].fetch_add(1, std::memory_order_relaxed);
+        uint32_t max_us = m_max_us.load(std::memory_order_relaxed);
+        while (us > max_us && !m_max_us.compare_exchange_weak(max_us, us, std::memory_order_relaxed)) {
+        }
+    }
+
+    /**
+     * @brief Copies the counts into `snapshot` and resets them.
+     * @param snapshot Receives the counts recorded since the previous snapshot.
+     */
+    void snapshot(LatencySnapshot& snapshot);
+
+private:
+    std::atomic<uint32_t> m_counts[LATENCY_HISTOGRAM_BUCKETS];  ///< Latencies per bucket.
+    std::atomic<uint32_t> m_max_us;                             ///< Largest latency since the last snapshot.
+};
+
+#endif // LATENCY_HISTOGRAM_H
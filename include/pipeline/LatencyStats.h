@@ -0,0 +1,85 @@
+#ifndef LATENCY_STATS_H
+#define LATENCY_STATS_H
+
+/**
+ * @file LatencyStats.h
+ * @brief Latency histograms of the pipeline stages, sent to the host (`LATENCY_STATS`).
+ */
+
+#include "mbed.h"
+#include "hal/us_ticker_api.h"
+#include "pipeline/LatencyHistogram.h"
+#include "serial_mail_sender/FrameFormat.h"
+
+/// Interval between two latency reports.
+#define LATENCY_STATS_REPORT_PERIOD 10s
+
+/**
+ * @class LatencyStats
+ * @brief Singleton holding one `LatencyHistogram` per pipeline stage.
+ *
+ * The stages are timed where they run, with the free-running microsecond
+ * ticker:
+ * - `LATENCY_STAGE_ADC_WAIT`: the reading thread waiting for DRDY of each
+ *   conversion, from the end of the previous read (single AD7124 only).
+ * - `LATENCY_STAGE_HANDOFF`: `send_data_to_main_thread`, including the wait
+ *   for the main thread to take the previous frame.
+ * - `LATENCY_STAGE_BUILD`: `sendMail`, from the call until the frame is
+ *   published to the sinks.
+ * - `LATENCY_STAGE_UART_DRAIN`: a frame queued in the `UartTransport` until
+ *   its last byte went into the serial driver's buffer.
+ *
+ * `report` takes a snapshot of each histogram, which resets it, and sends it
+ * as latency frames over all sinks. The histograms live in static storage
+ * and recording never allocates, so this also works with `ZERO_HEAP`.
+ */
+class LatencyStats {
+public:
+    /**
+     * @brief Gets the singleton instance of the LatencyStats.
+     * @return Reference to the singleton instance of LatencyStats.
+     */
+    static LatencyStats& getInstance(void);
+
+    /// Deleted copy constructor to enforce the singleton pattern.
+    LatencyStats(const LatencyStats&) = delete;
+
+    /// Deleted copy assignment operator to enforce the singleton pattern.
+    LatencyStats& operator=(const LatencyStats&) = delete;
+
+    /**
+     * @brief Microsecond timestamp usable from interrupts.
+     * @return Free-running microsecond counter; differences are valid across its wrap.
+     */
+    static uint32_t now_us(void) { return us_ticker_read(); }
+
+    /**
+     * @brief Records the latency of a stage that started at `start_us`.
+     * @param stage Stage, `LATENCY_STAGE_*`.
+     * @param start_us Value of `now_us` when the stage started.
+     */
+    void record(uint8_t stage, uint32_t start_us) { m_histograms[stage].record(now_us() - start_us); }
+
+    /**
+     * @brief Histogram of a stage, e.g. to attach it to a sink.
+     * @param stage Stage, `LATENCY_STAGE_*`.
+     */
+    LatencyHistogram& histogram(uint8_t stage) { return m_histograms[stage]; }
+
+    /**
+     * @brief Sends the histograms of the period that just ended and resets them.
+     * @param node Identifier put into the latency frames.
+     */
+    void report(int node);
+
+private:
+    LatencyHistogram m_histograms[LATENCY_STAGE_COUNT];     ///< One histogram per stage.
+    LatencySnapshot  m_snapshot;                            ///< Snapshot being sent, too large for the stack.
+    uint32_t         m_sequence;                            ///< Number of the next report.
+    Kernel::Clock::time_point m_since;                      ///< Start of the current period.
+
+    LatencyStats(void);
+    ~LatencyStats(void) = default;
+};
+
+#endif // LATENCY_STATS_H
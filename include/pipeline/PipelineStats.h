@@ -0,0 +1,80 @@
+#ifndef PIPELINE_STATS_H
+#define PIPELINE_STATS_H
+
+#include "mbed.h"
+#include "hal/us_ticker_api.h"
+
+/// Interval between two reports.
+#define PIPELINE_STATS_REPORT_PERIOD 10s
+
+/// Threads listed in a stack report at most.
+#define PIPELINE_STATS_MAX_THREADS 8
+
+/**
+ * @class PipelineStats
+ * @brief Singleton collecting the figures used to compare the threaded and the event-driven pipeline.
+ *
+ * - Worst-case DRDY-to-read latency: the event pipeline timestamps the DRDY
+ *   interrupt; the threaded loop records the longest gap between two polls of
+ *   DRDY, which bounds the time a falling edge can stay unnoticed.
+ * - Wake-ups: every time a thread is resumed to handle work (a mail in the
+ *   threaded design, a dispatched event in the event design). Each wake-up is
+ *   a context switch into the thread and one back out of it.
+ * - RAM: reserved and used stack of every thread from `mbed_stats_stack_get_each`.
+ *
+ * Enabled with `PIPELINE_STATS`; `report` logs and resets the counters.
+ */
+class PipelineStats {
+public:
+    /**
+     * @brief Gets the singleton instance of the PipelineStats.
+     * @return Reference to the singleton instance of PipelineStats.
+     */
+    static PipelineStats& getInstance(void);
+
+    /// Deleted copy constructor to enforce the singleton pattern.
+    PipelineStats(const PipelineStats&) = delete;
+
+    /// Deleted copy assignment operator to enforce the singleton pattern.
+    PipelineStats& operator=(const PipelineStats&) = delete;
+
+    /**
+     * @brief Microsecond timestamp usable from interrupts.
+     * @return Free-running microsecond counter.
+     */
+    static uint32_t now_us(void) { return us_ticker_read(); }
+
+    /**
+     * @brief Counts a conversion word and its DRDY-to-read latency.
+     * @param latency_us Time between DRDY and the start of the SPI read.
+     */
+    void recordConversion(uint32_t latency_us);
+
+    /**
+     * @brief Counts a thread wake-up.
+     */
+    void recordWakeup(void);
+
+    /**
+     * @brief Counts a frame handed to the sender.
+     */
+    void recordFrame(void);
+
+    /**
+     * @brief Logs the figures since the previous report and resets the counters.
+     */
+    void report(void);
+
+private:
+    uint32_t m_conversions;         ///< Conversion words read.
+    uint32_t m_wakeups;             ///< Thread wake-ups.
+    uint32_t m_frames;              ///< Frames sent.
+    uint32_t m_max_latency_us;      ///< Worst DRDY-to-read latency.
+    uint64_t m_total_latency_us;    ///< Sum of all latencies.
+    Kernel::Clock::time_point m_since;  ///< Start of the current period.
+
+    PipelineStats(void);
+    ~PipelineStats(void) = default;
+};
+
+#endif // PIPELINE_STATS_H
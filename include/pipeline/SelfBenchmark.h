@@ -0,0 +1,91 @@
+#ifndef SELF_BENCHMARK_H
+#define SELF_BENCHMARK_H
+
+#include "mbed.h"
+#include "adc/AD7124.h"
+#include "pipeline/BenchmarkSweep.h"
+#include "serial_mail_sender/SerialMailSender.h"
+#include "transport/UartTransport.h"
+
+/// Interval between two transmissions of the finished table.
+#define SELF_BENCHMARK_REPORT_PERIOD 10s
+
+/// Table buffer: header, one row per point and the summary; rows take about 60 characters.
+#define SELF_BENCHMARK_REPORT_SIZE ((BENCHMARK_MAX_POINTS + 4) * 96)
+
+/// Table bytes per message frame.
+#define SELF_BENCHMARK_CHUNK_SIZE 128
+
+/// Longest time the sinks go without being serviced while measuring, as in the main loop.
+#define SELF_BENCHMARK_SERVICE_PERIOD 5ms
+
+/**
+ * @class SelfBenchmark
+ * @brief Singleton that measures the sustainable sample rate on the node (`SELF_BENCHMARK`).
+ *
+ * Replaces the production loop: for every point of `benchmark_points` the
+ * AD7124 is reprogrammed with the point's SPI clock and filter word, and the
+ * pipeline runs as in production for `BENCHMARK_POINT_MS` — a polling thread
+ * reads the words into a `SampleCollector` and hands the frames to the
+ * calling thread, which builds and sends them through the `SerialMailSender`.
+ * The frames carry real samples, so the host sees the UART load of every point.
+ *
+ * Conversions, lost words and dropped frames are counted as described in
+ * BenchmarkSweep.h. The CPU load is the time spent reading, handing off,
+ * framing and writing to the UART, measured with the cycle counter; the
+ * idle time `MbedStatsWrapper` reports means nothing here, as the reading
+ * thread never idles. The UART utilization is the bytes the UART sink wrote.
+ *
+ * The finished table is logged and sent as a message frame of kind
+ * `MESSAGE_KIND_BENCHMARK` every `SELF_BENCHMARK_REPORT_PERIOD`; the node
+ * acquires nothing else until it is reset.
+ */
+class SelfBenchmark {
+public:
+    /**
+     * @brief Gets the singleton instance of the SelfBenchmark.
+     * @return Reference to the singleton instance of SelfBenchmark.
+     */
+    static SelfBenchmark& getInstance(void);
+
+    /// Deleted copy constructor to enforce the singleton pattern.
+    SelfBenchmark(const SelfBenchmark&) = delete;
+
+    /// Deleted copy assignment operator to enforce the singleton pattern.
+    SelfBenchmark& operator=(const SelfBenchmark&) = delete;
+
+    /**
+     * @brief Runs the sweep, then sends the table forever.
+     * @param adc Single AD7124 of the node.
+     * @param sender Sender with the UART registered.
+     * @param uart UART sink, for its counters.
+     * @param node Node identifier written into each frame.
+     */
+    void run(AD7124& adc, SerialMailSender& sender, UartTransport& uart, int node);
+
+private:
+    MBED_ALIGN(8) unsigned char m_stack[OS_STACK_SIZE];    ///< Stack of the reading thread.
+    Thread          m_thread;               ///< Reads the words of the current point.
+    EventFlags      m_flags;                ///< Start and stop handshake with the reading thread.
+    AD7124*         m_adc;                  ///< ADC being measured.
+    BenchmarkPoint  m_point;                ///< Point the reading thread runs.
+    volatile bool   m_stop;                 ///< Ends the point in the reading thread.
+    ConversionTracker m_tracker;            ///< Words of the current point, written by the reading thread.
+    uint32_t        m_frames;               ///< Frames handed off during the current point.
+    uint32_t        m_read_cycles;          ///< Cycles the reading thread spent on words and hand-off.
+    BenchmarkPoint  m_points[BENCHMARK_MAX_POINTS];    ///< Points of the sweep.
+    BenchmarkResult m_results[BENCHMARK_MAX_POINTS];   ///< Rows of the sweep.
+    size_t          m_count;                ///< Rows measured.
+    char            m_report[SELF_BENCHMARK_REPORT_SIZE];  ///< Table sent to the host.
+
+    SelfBenchmark(void);
+    ~SelfBenchmark(void) = default;
+
+    void acquire(void);
+    BenchmarkCounters measure(const BenchmarkPoint& point, SerialMailSender& sender, UartTransport& uart, int node);
+    uint32_t drain(SerialMailSender& sender, int node);
+    size_t formatReport(int node);
+    void sendReport(SerialMailSender& sender, UartTransport& uart, size_t size, int node, uint16_t id);
+};
+
+#endif // SELF_BENCHMARK_H
@@ -0,0 +1,85 @@
+#ifndef WARM_RESTART_H
+#define WARM_RESTART_H
+
+#include <atomic>
+
+#include "mbed.h"
+#include "storage/RetainedState.h"
+
+/// Time without `kick` after which the watchdog resets the node.
+#define WARM_RESTART_WATCHDOG_TIMEOUT_MS 2000
+
+/// Zero bytes sent after a warm reset, completing any frame the reset cut off on the wire.
+#define WARM_RESTART_RESYNC_SIZE 512
+
+/**
+ * @class WarmRestart
+ * @brief Singleton that keeps the node's state across watchdog and software resets (`WARM_RESTART`).
+ *
+ * The `RetainedArea` lives in the `.noinit` section, which the startup code
+ * neither loads nor zeroes. On the first `getInstance` the area is checked:
+ * after a watchdog reset, `NVIC_SystemReset` or the reset button it is still
+ * intact, after power-up it is not and is formatted.
+ *
+ * The watchdog also turns a fatal error, which halts the node, into a warm
+ * reset once `kick` is no longer called.
+ *
+ * The time from reset until the first conversion word is taken as the
+ * ticker value when the ADC thread reports it, since the microsecond ticker
+ * starts at 0 during boot.
+ */
+class WarmRestart {
+public:
+    /**
+     * @brief Gets the singleton instance, recovering the retained area on the first call.
+     * @return Reference to the singleton instance of WarmRestart.
+     */
+    static WarmRestart& getInstance(void);
+
+    /// Deleted copy constructor to enforce the singleton pattern.
+    WarmRestart(const WarmRestart&) = delete;
+
+    /// Deleted copy assignment operator to enforce the singleton pattern.
+    WarmRestart& operator=(const WarmRestart&) = delete;
+
+    /// True if the retained area survived the last reset.
+    bool warm(void) const { return m_warm; }
+
+    /// Frame ring, sequence number and ADC registers of the retained area.
+    RetainedState& state(void) { return m_state; }
+
+    /**
+     * @brief Starts the watchdog; `kick` must follow within `WARM_RESTART_WATCHDOG_TIMEOUT_MS`.
+     */
+    void startWatchdog(void);
+
+    /**
+     * @brief Restarts the watchdog timeout.
+     */
+    void kick(void);
+
+    /**
+     * @brief Records the time of the first conversion word; later calls are ignored.
+     *
+     * Called from the ADC thread.
+     */
+    void recordFirstSample(void);
+
+    /**
+     * @brief Logs reset reason, recovered frames and the time to the first sample once it is known.
+     * @return True once the report was logged.
+     */
+    bool report(void);
+
+private:
+    RetainedState         m_state;              ///< Retained area.
+    bool                  m_warm;               ///< Result of `RetainedState::recover`.
+    reset_reason_t        m_reset_reason;       ///< Cause of the last reset.
+    std::atomic<uint32_t> m_first_sample_us;    ///< Ticker at the first conversion word, 0 until then.
+    bool                  m_reported;           ///< `report` already logged.
+
+    WarmRestart(void);
+    ~WarmRestart(void) = default;
+};
+
+#endif // WARM_RESTART_H
@@ -0,0 +1,79 @@
+#ifndef ADAPTIVE_BATCHER_H
+#define ADAPTIVE_BATCHER_H
+
+/**
+ * @file AdaptiveBatcher.h
+ * @brief Chooses the number of samples per frame from the link backlog.
+ *
+ * @note This header must stay free of Mbed OS dependencies.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/// Queued frames at which the link counts as backed up and frames grow.
+#define ADAPTIVE_BATCHER_GROW_BACKLOG 2
+
+/**
+ * @class AdaptiveBatcher
+ * @brief Grows frames while the link is backed up and shrinks them while it is idle.
+ *
+ * Every frame costs the same header and FlatBuffer overhead, so a link that
+ * cannot keep up is relieved by sending fewer, larger frames; an idle link is
+ * better used with small frames, which reach the host sooner.
+ *
+ * - The sender reports the link backlog before it queues each frame. With at
+ *   least `ADAPTIVE_BATCHER_GROW_BACKLOG` frames still waiting, the target
+ *   doubles; with none, it shrinks by a quarter. Growing fast and shrinking
+ *   slowly keeps the target from oscillating around the link rate.
+ * - Acquisition asks `due` after every sample pair. A frame is sent when it
+ *   reaches the target, or as soon as its oldest sample is `deadline_ms` old,
+ *   whatever its size.
+ *
+ * The target is atomic: the sending thread writes it, the acquisition thread
+ * reads it.
+ */
+class AdaptiveBatcher {
+public:
+    /**
+     * @brief Constructs a batcher.
+     * @param min_samples Smallest target, used on an idle link.
+     * @param max_samples Largest target, must fit into one frame buffer.
+     * @param initial_samples Target until the first backlog report.
+     * @param deadline_ms Age of the oldest sample at which a partial frame is sent.
+     */
+    AdaptiveBatcher(unsigned int min_samples, unsigned int max_samples, unsigned int initial_samples,
+                    uint32_t deadline_ms);
+
+    /**
+     * @brief Adapts the target to the frames still waiting for the link.
+     * @param backlog Frames queued by the most backed-up link.
+     */
+    void onBacklog(size_t backlog);
+
+    /**
+     * @brief Checks whether the current frame has to be sent.
+     * @param samples Samples per channel collected so far.
+     * @param age_ms Age of the oldest collected sample.
+     * @return True if the target is reached or the deadline has passed.
+     */
+    bool due(unsigned int samples, uint32_t age_ms) const;
+
+    /// Samples per channel the next frame is sent at.
+    unsigned int target(void) const { return m_target.load(std::memory_order_relaxed); }
+
+    /// Largest target, the sample capacity a collector needs.
+    unsigned int maxSamples(void) const { return m_max_samples; }
+
+    /// Age of the oldest sample at which a partial frame is sent.
+    uint32_t deadlineMs(void) const { return m_deadline_ms; }
+
+private:
+    const unsigned int          m_min_samples;  ///< Smallest target.
+    const unsigned int          m_max_samples;  ///< Largest target.
+    const uint32_t              m_deadline_ms;  ///< Latency bound of the oldest sample.
+    std::atomic<unsigned int>   m_target;       ///< Samples per channel of the next frame.
+};
+
+#endif // ADAPTIVE_BATCHER_H
@@ -0,0 +1,31 @@
+#ifndef BAND_FRAME_BUILDER_H
+#define BAND_FRAME_BUILDER_H
+
+/**
+ * @file BandFrameBuilder.h
+ * @brief Writes band power frames (`BAND_POWER`) straight into the transmit buffer.
+ *
+ * @note This header must stay free of Mbed OS dependencies.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+#include "dsp/BandPowerAnalyzer.h"
+#include "serial_mail_sender/FrameFormat.h"
+
+/// Largest band power frame including the frame header.
+constexpr size_t BAND_FRAME_MAX_SIZE =
+    SERIAL_MAIL_HEADER_SIZE + band_frame_payload_size(BAND_POWER_MAX_BANDS, BAND_POWER_CHANNELS);
+
+/**
+ * @brief Writes `0xAAAA` + size + band power frame, see FrameFormat.h.
+ * @param powers Band powers of one window; its index becomes the sequence number.
+ * @param node Identifier for the data source node.
+ * @param out Destination of the frame.
+ * @param capacity Size of `out` in bytes.
+ * @return Number of bytes written to `out`, 0 if the frame does not fit.
+ */
+size_t build_band_frame(const BandPowers& powers, int node, uint8_t* out, size_t capacity);
+
+#endif // BAND_FRAME_BUILDER_H
@@ -0,0 +1,158 @@
+#ifndef FRAME_BUILDER_H
+#define FRAME_BUILDER_H
+
+/**
+ * @file FrameBuilder.h
+ * @brief Serializes ADC readings into a complete, ready-to-send serial mail frame.
+ *
+ * @note This header is free of Mbed OS dependencies so the serialization can be
+ *       replayed and benchmarked on the host.
+ */
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "adc/SampleVector.h"
+
+#include "flatbuffers/flatbuffers.h"
+#include "serial_mail_sender/FrameFormat.h"
+#include "serial_mail_sender/SerialMailGenerated.h"
+
+#if defined(ZERO_HEAP)
+/// Size of the static arena backing the FlatBuffer builder in the zero-heap build.
+#define FRAME_BUILDER_ARENA_SIZE 512
+
+static_assert(FRAME_BUILDER_ARENA_SIZE >= serial_mail_max_payload_size(SAMPLE_VECTOR_CAPACITY),
+              "FRAME_BUILDER_ARENA_SIZE too small for SAMPLE_VECTOR_CAPACITY");
+
+/**
+ * @class FrameArenaAllocator
+ * @brief FlatBuffers allocator handing out a single fixed arena.
+ *
+ * The builder requests its initial size once and reuses the buffer after
+ * `Clear()`, so one arena is enough as long as a frame never outgrows it,
+ * which the `static_assert` above guarantees.
+ */
+class FrameArenaAllocator : public flatbuffers::Allocator {
+public:
+    FrameArenaAllocator(void) : m_in_use(false) {}
+
+    /**
+     * @brief Hands out the arena.
+     * @param size Requested size in bytes.
+     * @return The arena, or `nullptr` if it is taken or too small.
+     */
+    uint8_t* allocate(size_t size) override;
+
+    /**
+     * @brief Returns the arena.
+     */
+    void deallocate(uint8_t* p, size_t size) override;
+
+private:
+    alignas(8) uint8_t m_arena[FRAME_BUILDER_ARENA_SIZE];  ///< Backing storage of the builder.
+    bool               m_in_use;                           ///< True while the builder holds the arena.
+};
+#endif
+
+/**
+ * @class FrameBuilder
+ * @brief Builds `0xAAAA` + size + `SerialMail` frames into a reusable buffer.
+ *
+ * The FlatBuffer builder and the frame buffer are kept between calls, so after
+ * the first frame no further heap allocations are needed for frames of the same
+ * size. With `ZERO_HEAP` the builder works in a `FrameArenaAllocator` and only
+ * the overload writing into caller-provided storage is meant to be used.
+ */
+class FrameBuilder {
+public:
+    /**
+     * @brief Constructs a frame builder.
+     * @param initial_size Initial capacity of the FlatBuffer builder in bytes,
+     *        ignored with `ZERO_HEAP` where the arena size is used.
+     */
+    explicit FrameBuilder(size_t initial_size = 1024);
+
+    /**
+     * @brief Serializes the readings of both channels into a frame.
+     * @param ch0 Downsampled ADC readings for channel 0.
+     * @param ch1 Downsampled ADC readings for channel 1.
+     * @param node Identifier for the data source node.
+     * @param device AD7124 of the node the readings come from.
+     * @return Number of bytes of the frame, available through `data()`.
+     */
+    size_t build(
+        const SampleVector& ch0,
+        const SampleVector& ch1,
+        int node,
+        unsigned int device = 0
+    );
+
+    /**
+     * @brief Serializes the readings of both channels into caller-provided storage.
+     * @param ch0 Downsampled ADC readings for channel 0.
+     * @param ch1 Downsampled ADC readings for channel 1.
+     * @param node Identifier for the data source node.
+     * @param out Destination of the frame.
+     * @param capacity Size of `out` in bytes.
+     * @param device AD7124 of the node the readings come from.
+     * @return Number of bytes written to `out`, 0 if the frame does not fit.
+     */
+    size_t build(
+        const SampleVector& ch0,
+        const SampleVector& ch1,
+        int node,
+        uint8_t* out,
+        size_t capacity,
+        unsigned int device = 0
+    );
+
+    /**
+     * @brief Serializes fixed-size channels, e.g. of a `FixedSampleCollector`.
+     * @tparam N Samples per channel.
+     * @param out Destination of the frame, at least `maxFrameSize<N>()` bytes.
+     * @return Number of bytes written to `out`.
+     */
+    template <size_t N>
+    size_t build(
+        const std::array<int32_t, N>& ch0,
+        const std::array<int32_t, N>& ch1,
+        int node,
+        uint8_t* out
+    ) {
+        size_t size = SERIAL_MAIL_HEADER_SIZE + serialize(ch0.data(), N, ch1.data(), N, node, 0);
+        writeFrame(out);
+        return size;
+    }
+
+    /// Largest frame for `N` samples per channel, for sizing buffers at compile time.
+    template <size_t N>
+    static constexpr size_t maxFrameSize(void) { return SERIAL_MAIL_HEADER_SIZE + serial_mail_max_payload_size(N); }
+
+    /// Pointer to the frame produced by the last call to the first `build` overload.
+    const uint8_t* data(void) const { return m_frame.data(); }
+
+    /// Size of the frame produced by the last call to the first `build` overload.
+    size_t size(void) const { return m_frame.size(); }
+
+private:
+#if defined(ZERO_HEAP)
+    FrameArenaAllocator            m_allocator;  ///< Static storage of the builder, declared first.
+#endif
+    flatbuffers::FlatBufferBuilder m_builder;  ///< Reused FlatBuffer builder.
+    std::vector<uint8_t>           m_frame;    ///< Header followed by the FlatBuffer.
+
+    flatbuffers::Offset<flatbuffers::Vector<const SerialMail::Value*>> createValues(
+        const int32_t* inputs, size_t count);
+
+    size_t serialize(
+        const int32_t* ch0, size_t ch0_count,
+        const int32_t* ch1, size_t ch1_count,
+        int node, unsigned int device);
+
+    void writeFrame(uint8_t* out) const;
+};
+
+#endif // FRAME_BUILDER_H
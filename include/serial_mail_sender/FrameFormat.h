@@ -0,0 +1,295 @@
+#ifndef FRAME_FORMAT_H
+#define FRAME_FORMAT_H
+
+/**
+ * @file FrameFormat.h
+ * @brief Wire layout of a serial mail frame, shared by the node and the host tools.
+ *
+ * Every frame on the serial link consists of
+ * - a 2-byte synchronization marker (`0xAAAA`),
+ * - the 4-byte size of the payload in little-endian byte order,
+ * - the payload: a `SerialMail` FlatBuffer, or a raw frame (`RAW_FRAMES`).
+ *
+ * A raw frame is a fixed little-endian header followed by the packed samples:
+ *
+ * | Offset | Size | Field                                              |
+ * |--------|------|----------------------------------------------------|
+ * | 0      | 1    | Version, `RAW_FRAME_VERSION`                       |
+ * | 1      | 2    | Node identifier                                    |
+ * | 3      | 1    | Channel mask, bit n set if channel n is present    |
+ * | 4      | 2    | Samples per present channel                        |
+ * | 6      | 4    | Sequence number, incremented per frame             |
+ * | 10     | 3 x count per channel | Samples, channel 0 first      |
+ *
+ * On a node with several AD7124 (`PipelineConfig::devices`), channel n of
+ * device d is channel `2 d + n` of the node, so the channel mask of a raw
+ * frame also tells the device its samples come from; a frame always holds
+ * the channels of a single device. FlatBuffer frames carry the device in the
+ * `device` field instead. Both are 0 on a node with one converter, which
+ * leaves its frames unchanged.
+ *
+ * Samples keep the byte order of the AD7124 and of `SerialMail::Value`
+ * (most significant byte first), so decoders can hand out the same 3-byte
+ * views for both payloads. A FlatBuffer starts with the 4-byte aligned offset
+ * of its root table, so its first byte is a multiple of four; raw versions
+ * have one of the two low bits set, which tells both payloads apart.
+ *
+ * A band power frame (`BAND_POWER`) shares the raw header with version
+ * `BAND_FRAME_VERSION`; the count field holds the bands per channel, the
+ * sequence field the index of the analysis window, and the header is
+ * followed by one little-endian IEEE-754 `float` per band and present
+ * channel, the mean power of the band in mV^2, channel 0 first.
+ *
+ * A timed raw frame (`CLOCK_SYNC`) has version `RAW_FRAME_TIMED_VERSION` and
+ * 8 more header bytes at offset 10: the time of its last sample in
+ * microseconds of the host clock, little-endian, 0 while the node is not
+ * synchronized. The samples follow at offset 18.
+ *
+ * Clock synchronization exchanges use the same framing in both directions.
+ * The host sends a sync request, the node answers with a sync response:
+ *
+ * | Offset | Size | Sync request (`SYNC_REQUEST_VERSION`)                        |
+ * |--------|------|--------------------------------------------------------------|
+ * | 0      | 1    | Version                                                      |
+ * | 1      | 1    | Flags, reserved                                              |
+ * | 2      | 4    | Exchange identifier                                          |
+ * | 6      | 8    | T1, host time the request was sent                           |
+ * | 14     | 4    | Identifier of the previous exchange, 0 if none               |
+ * | 18     | 8    | T4 of the previous exchange, host time its response arrived  |
+ *
+ * | Offset | Size | Sync response (`SYNC_RESPONSE_VERSION`)                      |
+ * |--------|------|--------------------------------------------------------------|
+ * | 0      | 1    | Version                                                      |
+ * | 1      | 2    | Node identifier                                              |
+ * | 3      | 1    | Flags, `SYNC_FLAG_SYNCED` once frames carry host time        |
+ * | 4      | 4    | Exchange identifier of the request                           |
+ * | 8      | 8    | T2, node time the request arrived                            |
+ * | 16     | 8    | T3, node time the response was sent                          |
+ * | 24     | 4    | Estimated skew of the node clock in parts per billion        |
+ *
+ * All times are microseconds, little-endian.
+ *
+ * A latency frame (`LATENCY_STATS`) carries the histogram of one pipeline
+ * stage over one report period (see pipeline/LatencyHistogram.h):
+ *
+ * | Offset | Size | Latency frame (`LATENCY_FRAME_VERSION`)                      |
+ * |--------|------|--------------------------------------------------------------|
+ * | 0      | 1    | Version                                                      |
+ * | 1      | 2    | Node identifier                                              |
+ * | 3      | 1    | Stage, `LATENCY_STAGE_*`                                     |
+ * | 4      | 4    | Report number, incremented per period                        |
+ * | 8      | 4    | Length of the period in ms                                   |
+ * | 12     | 4    | Latencies recorded in the period                             |
+ * | 16     | 4    | Largest latency in us                                        |
+ * | 20     | 2    | First bucket covered by this frame                           |
+ * | 22     | 2    | Bucket after the last one covered by this frame              |
+ * | 24     | ...  | Non-empty buckets: skipped empty buckets and count, LEB128   |
+ *
+ * Each non-empty bucket is written as the number of empty buckets in front of
+ * it followed by its count, both as unsigned LEB128 (7 bits per byte, least
+ * significant group first). Buckets that do not fit into one frame continue
+ * in the next frame of the same report.
+ *
+ * A message frame (`TX_SCHEDULER`) carries one chunk of a message that may
+ * be larger than a frame, e.g. a status text or a debug dump. The chunks of a
+ * message are sent in order, possibly with frames of other classes in
+ * between:
+ *
+ * | Offset | Size | Message frame (`MESSAGE_FRAME_VERSION`)                      |
+ * |--------|------|--------------------------------------------------------------|
+ * | 0      | 1    | Version                                                      |
+ * | 1      | 2    | Node identifier                                              |
+ * | 3      | 1    | Kind, `MESSAGE_KIND_*`                                       |
+ * | 4      | 2    | Message number, incremented per message                      |
+ * | 6      | 4    | Size of the complete message                                 |
+ * | 10     | 4    | Offset of this chunk in the message                          |
+ * | 14     | ...  | Chunk bytes                                                  |
+ *
+ * @note This header must stay free of Mbed OS dependencies so that it can be
+ *       compiled for the host as well.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+/// Synchronization marker sent in front of every frame.
+constexpr uint16_t SERIAL_MAIL_SYNC_MARKER = 0xAAAA;
+
+/// Single byte of the synchronization marker (both bytes are identical).
+constexpr uint8_t SERIAL_MAIL_SYNC_BYTE = 0xAA;
+
+/// Size of the synchronization marker in bytes.
+constexpr size_t SERIAL_MAIL_SYNC_SIZE = sizeof(uint16_t);
+
+/// Size of the length field following the synchronization marker in bytes.
+constexpr size_t SERIAL_MAIL_LENGTH_SIZE = sizeof(uint32_t);
+
+/// Size of the complete frame header (marker + length) in bytes.
+constexpr size_t SERIAL_MAIL_HEADER_SIZE = SERIAL_MAIL_SYNC_SIZE + SERIAL_MAIL_LENGTH_SIZE;
+
+/// Smallest FlatBuffer a valid `SerialMail` can be serialized to (root offset + vtable + table).
+constexpr uint32_t SERIAL_MAIL_MIN_PAYLOAD_SIZE = 12;
+
+/// Largest FlatBuffer a decoder accepts before treating the length field as corrupted.
+constexpr uint32_t SERIAL_MAIL_MAX_PAYLOAD_SIZE = 8192;
+
+/**
+ * @brief Upper bound of the FlatBuffer size for a given number of samples.
+ * @param samples_per_channel Samples in each of the two channel vectors.
+ * @return Bytes of the `SerialMail` FlatBuffer without frame header.
+ *
+ * Two vectors of 3-byte structs (length field plus padding to 4 bytes), the
+ * table, its vtable, the root offset and the builder's alignment padding.
+ */
+constexpr size_t serial_mail_max_payload_size(size_t samples_per_channel) {
+    return 6 * samples_per_channel + 64;
+}
+
+/// Version byte of the raw frame layout; its low bits tell it apart from a FlatBuffer.
+constexpr uint8_t RAW_FRAME_VERSION = 0x81;
+
+/// Size of the raw frame header in bytes.
+constexpr size_t RAW_FRAME_HEADER_SIZE = 10;
+
+/// Offset of the node identifier in the raw frame header.
+constexpr size_t RAW_FRAME_NODE_OFFSET = 1;
+
+/// Offset of the channel mask in the raw frame header.
+constexpr size_t RAW_FRAME_MASK_OFFSET = 3;
+
+/// Offset of the samples per channel in the raw frame header.
+constexpr size_t RAW_FRAME_COUNT_OFFSET = 4;
+
+/// Offset of the sequence number in the raw frame header.
+constexpr size_t RAW_FRAME_SEQUENCE_OFFSET = 6;
+
+/// Bytes of one packed sample.
+constexpr size_t RAW_FRAME_SAMPLE_SIZE = 3;
+
+/// Channel mask bit of channel 0.
+constexpr uint8_t RAW_FRAME_CHANNEL_0 = 0x01;
+
+/// Channel mask bit of channel 1.
+constexpr uint8_t RAW_FRAME_CHANNEL_1 = 0x02;
+
+/// Devices the channel mask can tell apart, two channels each.
+constexpr unsigned int RAW_FRAME_MAX_DEVICES = 4;
+
+/**
+ * @brief Channel mask bits of both channels of a device.
+ * @param device Index of the AD7124 on the node, below `RAW_FRAME_MAX_DEVICES`.
+ * @return Mask bits of channel 0 and 1 of the device.
+ */
+constexpr uint8_t raw_frame_device_mask(unsigned int device) {
+    return (uint8_t)((RAW_FRAME_CHANNEL_0 | RAW_FRAME_CHANNEL_1) << (2 * device));
+}
+
+/**
+ * @brief Size of a raw frame payload.
+ * @param samples_per_channel Samples of each present channel.
+ * @param channels Number of present channels.
+ * @return Bytes of the payload without frame header.
+ */
+constexpr size_t raw_frame_payload_size(size_t samples_per_channel, size_t channels = 2) {
+    return RAW_FRAME_HEADER_SIZE + channels * RAW_FRAME_SAMPLE_SIZE * samples_per_channel;
+}
+
+/// Version byte of a band power frame, which uses the raw frame header.
+constexpr uint8_t BAND_FRAME_VERSION = 0x82;
+
+/// Bytes of one band power.
+constexpr size_t BAND_FRAME_VALUE_SIZE = 4;
+
+/**
+ * @brief Size of a band power frame payload.
+ * @param bands Bands of each present channel.
+ * @param channels Number of present channels.
+ * @return Bytes of the payload without frame header.
+ */
+constexpr size_t band_frame_payload_size(size_t bands, size_t channels = 2) {
+    return RAW_FRAME_HEADER_SIZE + channels * BAND_FRAME_VALUE_SIZE * bands;
+}
+
+/// Version byte of a raw frame stamped with the host time of its last sample.
+constexpr uint8_t RAW_FRAME_TIMED_VERSION = 0x83;
+
+/// Offset of the time in the header of a timed raw frame.
+constexpr size_t RAW_FRAME_TIME_OFFSET = 10;
+
+/// Size of the timed raw frame header in bytes.
+constexpr size_t RAW_FRAME_TIMED_HEADER_SIZE = 18;
+
+/**
+ * @brief Size of a timed raw frame payload.
+ * @param samples_per_channel Samples of each present channel.
+ * @param channels Number of present channels.
+ * @return Bytes of the payload without frame header.
+ */
+constexpr size_t raw_frame_timed_payload_size(size_t samples_per_channel, size_t channels = 2) {
+    return RAW_FRAME_TIMED_HEADER_SIZE + channels * RAW_FRAME_SAMPLE_SIZE * samples_per_channel;
+}
+
+/// Version byte of a sync response sent by the node.
+constexpr uint8_t SYNC_RESPONSE_VERSION = 0x85;
+
+/// Size of a sync response payload in bytes.
+constexpr size_t SYNC_RESPONSE_SIZE = 28;
+
+/// Version byte of a sync request sent by the host.
+constexpr uint8_t SYNC_REQUEST_VERSION = 0x86;
+
+/// Size of a sync request payload in bytes.
+constexpr size_t SYNC_REQUEST_SIZE = 26;
+
+/// Sync response flag: the node stamps its frames with host time.
+constexpr uint8_t SYNC_FLAG_SYNCED = 0x01;
+
+/// Version byte of a latency frame.
+constexpr uint8_t LATENCY_FRAME_VERSION = 0x87;
+
+/// Size of the latency frame header in bytes.
+constexpr size_t LATENCY_FRAME_HEADER_SIZE = 24;
+
+/// Stage: waiting for DRDY of the next conversion.
+constexpr uint8_t LATENCY_STAGE_ADC_WAIT = 0;
+
+/// Stage: handing a frame to the main thread (`send_data_to_main_thread`).
+constexpr uint8_t LATENCY_STAGE_HANDOFF = 1;
+
+/// Stage: building and publishing a frame (`sendMail`).
+constexpr uint8_t LATENCY_STAGE_BUILD = 2;
+
+/// Stage: a frame queued in the UART sink until its last byte was written.
+constexpr uint8_t LATENCY_STAGE_UART_DRAIN = 3;
+
+/// Number of pipeline stages with a latency histogram.
+constexpr uint8_t LATENCY_STAGE_COUNT = 4;
+
+/// Version byte of a message frame (0x88 would read as a FlatBuffer).
+constexpr uint8_t MESSAGE_FRAME_VERSION = 0x89;
+
+/// Size of the message frame header in bytes.
+constexpr size_t MESSAGE_FRAME_HEADER_SIZE = 14;
+
+/// Largest message a decoder reassembles.
+constexpr uint32_t MESSAGE_MAX_SIZE = 1u << 20;
+
+/// Message kind: status text of the node, lines separated by `\n`.
+constexpr uint8_t MESSAGE_KIND_STATUS = 1;
+
+/// Message kind: binary dump, interpreted by the application.
+constexpr uint8_t MESSAGE_KIND_DUMP = 2;
+
+/// Message kind: self-benchmark table (`SELF_BENCHMARK`), see pipeline/BenchmarkSweep.h.
+constexpr uint8_t MESSAGE_KIND_BENCHMARK = 3;
+
+/**
+ * @brief Tells a raw payload from a FlatBuffer by its first byte.
+ * @param first_byte First byte of the payload.
+ * @return True for a raw frame of any version.
+ */
+constexpr bool is_raw_frame_payload(uint8_t first_byte) {
+    return (first_byte & 0x03) != 0;
+}
+
+#endif // FRAME_FORMAT_H
@@ -0,0 +1,58 @@
+#ifndef LATENCY_FRAME_BUILDER_H
+#define LATENCY_FRAME_BUILDER_H
+
+/**
+ * @file LatencyFrameBuilder.h
+ * @brief Writes and reads latency frames (`LATENCY_STATS`), see FrameFormat.h.
+ *
+ * @note This header must stay free of Mbed OS dependencies.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+#include "pipeline/LatencyHistogram.h"
+#include "serial_mail_sender/FrameFormat.h"
+
+/// Largest encoded bucket: a 2-byte gap and a 5-byte count.
+constexpr size_t LATENCY_FRAME_MAX_ENTRY_SIZE = 7;
+
+/**
+ * @struct LatencyReport
+ * @brief Header fields of the latency frames of one stage and period.
+ */
+struct LatencyReport {
+    int32_t  node;          ///< Node identifier.
+    uint8_t  stage;         ///< Pipeline stage, `LATENCY_STAGE_*`.
+    uint32_t sequence;      ///< Report number, incremented per period.
+    uint32_t period_ms;     ///< Length of the period.
+};
+
+/**
+ * @brief Writes `0xAAAA` + size + latency frame with the buckets from `first_bucket` on.
+ * @param snapshot Counts of the period.
+ * @param report Header fields.
+ * @param first_bucket First bucket to write, 0 for the first frame of a report.
+ * @param out Destination of the frame.
+ * @param capacity Size of `out` in bytes.
+ * @param next_bucket Receives the first bucket not written; `LATENCY_HISTOGRAM_BUCKETS` once all are.
+ * @return Number of bytes written to `out`, 0 if not even the header fits.
+ */
+size_t build_latency_frame(const LatencySnapshot& snapshot, const LatencyReport& report, size_t first_bucket,
+                           uint8_t* out, size_t capacity, size_t* next_bucket);
+
+/**
+ * @brief Reads a latency frame payload.
+ * @param payload Payload without the frame header.
+ * @param size Size of the payload.
+ * @param report Receives the header fields.
+ * @param snapshot Receives `total` and `max_us`, and the counts of the covered buckets; cleared first
+ *                 if the frame starts at bucket 0.
+ * @param first_bucket Receives the first bucket covered by the frame.
+ * @param next_bucket Receives the bucket after the last one covered.
+ * @return False if the version, size or an entry do not match.
+ */
+bool read_latency_frame(const uint8_t* payload, size_t size, LatencyReport* report, LatencySnapshot* snapshot,
+                        size_t* first_bucket, size_t* next_bucket);
+
+#endif // LATENCY_FRAME_BUILDER_H
@@ -0,0 +1,54 @@
+#ifndef MESSAGE_FRAME_BUILDER_H
+#define MESSAGE_FRAME_BUILDER_H
+
+/**
+ * @file MessageFrameBuilder.h
+ * @brief Cuts messages into message frames and reads them back (`TX_SCHEDULER`), see FrameFormat.h.
+ *
+ * @note This header must stay free of Mbed OS dependencies.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+#include "serial_mail_sender/FrameFormat.h"
+
+/**
+ * @struct MessageHeader
+ * @brief Fields shared by all chunks of one message.
+ */
+struct MessageHeader {
+    int32_t  node;          ///< Node identifier.
+    uint8_t  kind;          ///< Content, `MESSAGE_KIND_*`.
+    uint16_t id;            ///< Message number, incremented per message.
+    uint32_t size;          ///< Size of the complete message.
+};
+
+/**
+ * @brief Writes `0xAAAA` + size + message frame with the chunk starting at `offset`.
+ * @param header Message fields.
+ * @param message Complete message of `header.size` bytes.
+ * @param offset First message byte to write, 0 for the first chunk.
+ * @param chunk_size Largest number of message bytes per frame.
+ * @param out Destination of the frame.
+ * @param capacity Size of `out` in bytes.
+ * @param next_offset Receives the first message byte not written; `header.size` once all are.
+ * @return Number of bytes written to `out`, 0 if not even the header fits.
+ */
+size_t build_message_frame(const MessageHeader& header, const uint8_t* message, size_t offset, size_t chunk_size,
+                           uint8_t* out, size_t capacity, size_t* next_offset);
+
+/**
+ * @brief Reads a message frame payload.
+ * @param payload Payload without the frame header.
+ * @param size Size of the payload.
+ * @param header Receives the message fields.
+ * @param offset Receives the offset of the chunk in the message.
+ * @param chunk Receives a pointer to the chunk bytes inside `payload`.
+ * @param chunk_size Receives the number of chunk bytes.
+ * @return False if the version does not match or the chunk exceeds the message.
+ */
+bool read_message_frame(const uint8_t* payload, size_t size, MessageHeader* header, size_t* offset,
+                        const uint8_t** chunk, size_t* chunk_size);
+
+#endif // MESSAGE_FRAME_BUILDER_H
@@ -0,0 +1,98 @@
+#ifndef RAW_FRAME_BUILDER_H
+#define RAW_FRAME_BUILDER_H
+
+/**
+ * @file RawFrameBuilder.h
+ * @brief Writes fixed-layout raw frames straight into the transmit buffer.
+ *
+ * @note This header must stay free of Mbed OS dependencies.
+ */
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "adc/SampleVector.h"
+#include "serial_mail_sender/FrameFormat.h"
+
+/**
+ * @class RawFrameBuilder
+ * @brief Builds `0xAAAA` + size + raw frames (`RAW_FRAMES`), see FrameFormat.h.
+ *
+ * Unlike `FrameBuilder` there is no intermediate buffer: the header fields are
+ * stored byte by byte and the samples copied once, directly into the pooled
+ * frame buffer. Every frame carries a sequence number, so the host can count
+ * frames lost on the link.
+ *
+ * The `build` overloads match those of `FrameBuilder` that write into
+ * caller-provided storage, so `SerialMailSender` can use either.
+ *
+ * A builder constructed as `timed` (`CLOCK_SYNC`) writes timed raw frames,
+ * whose header also carries the host time of the last sample.
+ */
+class RawFrameBuilder {
+public:
+    /**
+     * @brief Constructs a builder whose first frame has sequence number 0.
+     * @param timed Write `RAW_FRAME_TIMED_VERSION` frames with a time field.
+     */
+    explicit RawFrameBuilder(bool timed = false);
+
+    /**
+     * @brief Writes the readings of both channels into caller-provided storage.
+     * @param ch0 Downsampled ADC readings for channel 0.
+     * @param ch1 Downsampled ADC readings for channel 1.
+     * @param node Identifier for the data source node.
+     * @param out Destination of the frame.
+     * @param capacity Size of `out` in bytes.
+     * @param device AD7124 of the node the readings come from, below `RAW_FRAME_MAX_DEVICES`.
+     * @param time_us Host time of the last sample, written by a timed builder only.
+     * @return Number of bytes written to `out`, 0 if the frame does not fit.
+     */
+    size_t build(
+        const SampleVector& ch0,
+        const SampleVector& ch1,
+        int node,
+        uint8_t* out,
+        size_t capacity,
+        unsigned int device = 0,
+        uint64_t time_us = 0
+    );
+
+    /**
+     * @brief Writes fixed-size channels, e.g. of a `FixedSampleCollector`.
+     * @tparam N Samples per channel.
+     * @param out Destination of the frame, at least `maxFrameSize<N>()` bytes.
+     * @return Number of bytes written to `out`.
+     */
+    template <size_t N>
+    size_t build(
+        const std::array<int32_t, N>& ch0,
+        const std::array<int32_t, N>& ch1,
+        int node,
+        uint8_t* out
+    ) {
+        return write(ch0.data(), N, ch1.data(), N, node, 0, 0, out, maxFrameSize<N>());
+    }
+
+    /// Largest frame for `N` samples per channel, timed or not, for sizing buffers at compile time.
+    template <size_t N>
+    static constexpr size_t maxFrameSize(void) { return SERIAL_MAIL_HEADER_SIZE + raw_frame_timed_payload_size(N); }
+
+    /// Sequence number of the next frame.
+    uint32_t sequence(void) const { return m_sequence; }
+
+    /// Sets the sequence number of the next frame, e.g. to rebuild a received frame.
+    void setSequence(uint32_t sequence) { m_sequence = sequence; }
+
+private:
+    uint32_t m_sequence;    ///< Sequence number of the next frame.
+    bool     m_timed;       ///< Frames carry a time field.
+
+    size_t write(
+        const int32_t* ch0, size_t ch0_count,
+        const int32_t* ch1, size_t ch1_count,
+        int node, unsigned int device, uint64_t time_us, uint8_t* out, size_t capacity);
+};
+
+#endif // RAW_FRAME_BUILDER_H
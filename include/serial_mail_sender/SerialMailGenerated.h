@@ -54,7 +54,8 @@ struct SerialMail FLATBUFFERS_FINAL_CLASS : private ::flatbuffers::Table {
   enum FlatBuffersVTableOffset FLATBUFFERS_VTABLE_UNDERLYING_TYPE {
     VT_CH0 = 4,
     VT_CH1 = 6,
-    VT_NODE = 8
+    VT_NODE = 8,
+    VT_DEVICE = 10
   };
   const ::flatbuffers::Vector<const Value *> *ch0() const {
     return GetPointer<const ::flatbuffers::Vector<const Value *> *>(VT_CH0);
@@ -65,6 +66,9 @@ struct SerialMail FLATBUFFERS_FINAL_CLASS : private ::flatbuffers::Table {
   int32_t node() const {
     return GetField<int32_t>(VT_NODE, 0);
   }
+  uint8_t device() const {
+    return GetField<uint8_t>(VT_DEVICE, 0);
+  }
   bool Verify(::flatbuffers::Verifier &verifier) const {
     return VerifyTableStart(verifier) &&
            VerifyOffset(verifier, VT_CH0) &&
@@ -72,6 +76,7 @@ struct SerialMail FLATBUFFERS_FINAL_CLASS : private ::flatbuffers::Table {
            VerifyOffset(verifier, VT_CH1) &&
            verifier.VerifyVector(ch1()) &&
            VerifyField<int32_t>(verifier, VT_NODE, 4) &&
+           VerifyField<uint8_t>(verifier, VT_DEVICE, 1) &&
            verifier.EndTable();
   }
 };
@@ -89,6 +94,9 @@ struct SerialMailBuilder {
   void add_node(int32_t node) {
     fbb_.AddElement<int32_t>(SerialMail::VT_NODE, node, 0);
   }
+  void add_device(uint8_t device) {
+    fbb_.AddElement<uint8_t>(SerialMail::VT_DEVICE, device, 0);
+  }
   explicit SerialMailBuilder(::flatbuffers::FlatBufferBuilder &_fbb)
         : fbb_(_fbb) {
     start_ = fbb_.StartTable();
@@ -104,11 +112,13 @@ inline ::flatbuffers::Offset<SerialMail> CreateSerialMail(
     ::flatbuffers::FlatBufferBuilder &_fbb,
     ::flatbuffers::Offset<::flatbuffers::Vector<const Value *>> ch0 = 0,
     ::flatbuffers::Offset<::flatbuffers::Vector<const Value *>> ch1 = 0,
-    int32_t node = 0) {
+    int32_t node = 0,
+    uint8_t device = 0) {
   SerialMailBuilder builder_(_fbb);
   builder_.add_node(node);
   builder_.add_ch1(ch1);
   builder_.add_ch0(ch0);
+  builder_.add_device(device);
   return builder_.Finish();
 }
 
@@ -116,14 +126,16 @@ inline ::flatbuffers::Offset<SerialMail> CreateSerialMailDirect(
     ::flatbuffers::FlatBufferBuilder &_fbb,
     const std::vector<Value> *ch0 = nullptr,
     const std::vector<Value> *ch1 = nullptr,
-    int32_t node = 0) {
+    int32_t node = 0,
+    uint8_t device = 0) {
   auto ch0__ = ch0 ? _fbb.CreateVectorOfStructs<Value>(*ch0) : 0;
   auto ch1__ = ch1 ? _fbb.CreateVectorOfStructs<Value>(*ch1) : 0;
   return CreateSerialMail(
       _fbb,
       ch0__,
       ch1__,
-      node);
+      node,
+      device);
 }
 
 inline const SerialMail *GetSerialMail(const void *buf) {
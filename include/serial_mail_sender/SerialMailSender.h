@@ -1,8 +1,42 @@
 #ifndef SERIAL_MAIL_SENDER_H
 #define SERIAL_MAIL_SENDER_H
 
-#include "mbed.h"  // Required for BufferedSerial
-#include "serial_mail_sender/SerialMailGenerated.h"  // Required for SerialMail::Value
+#include "mbed.h"  // Required for Mutex
+#include "serial_mail_sender/FrameBuilder.h"  // Required for FrameBuilder
+#include "serial_mail_sender/RawFrameBuilder.h"  // Required for RawFrameBuilder
+#include "transport/FrameBuffer.h"  // Required for FramePool
+#include "transport/FrameDispatcher.h"  // Required for FrameDispatcher
+
+#if defined(ADAPTIVE_BATCHING)
+#include "serial_mail_sender/AdaptiveBatcher.h"  // Required for AdaptiveBatcher
+#endif
+
+#if defined(BAND_POWER)
+#include "dsp/BandPowerAnalyzer.h"  // Required for BandPowers
+#endif
+
+#if defined(LATENCY_STATS)
+#include "serial_mail_sender/LatencyFrameBuilder.h"  // Required for LatencyReport
+#endif
+
+#if defined(TX_SCHEDULER)
+#include "serial_mail_sender/MessageFrameBuilder.h"  // Required for MessageHeader
+
+/// Message bytes per message frame, about 13 ms on the UART including the headers.
+#define SERIAL_MAIL_MESSAGE_CHUNK_SIZE 128
+#endif
+
+#if defined(WARM_RESTART) && defined(RAW_FRAMES)
+#include "storage/RetainedState.h"  // Required for RetainedState
+#endif
+
+#if defined(RAW_FRAMES)
+/// Serializer of the mails: fixed-layout raw frames instead of FlatBuffers.
+typedef RawFrameBuilder MailFrameBuilder;
+#else
+/// Serializer of the mails.
+typedef FrameBuilder MailFrameBuilder;
+#endif
 
 /**
  * @class SerialMailSender
@@ -11,6 +45,34 @@
  * The `SerialMailSender` class provides functionality to serialize ADC readings
  * and transmit them over a serial connection. It ensures efficient and thread-safe
  * communication using a singleton design pattern.
+ *
+ * Each frame is serialized once into a pooled, reference-counted buffer and
+ * shared by all sinks registered with `addSink` at startup. Sinks queue and
+ * drop frames independently; `service` must be called regularly to move their
+ * queued bytes to the links.
+ *
+ * With `RAW_FRAMES`, mails are written as raw frames by a `RawFrameBuilder`
+ * instead of `SerialMail` FlatBuffers; the host tells both apart by the first
+ * payload byte.
+ *
+ * With `ADAPTIVE_BATCHING`, every mail reports the link backlog to the
+ * `AdaptiveBatcher` returned by `batcher`, from which acquisition takes the
+ * size of the next frame.
+ *
+ * With `BAND_POWER`, `sendBandPowers` publishes band power frames through the
+ * same pool and sinks.
+ *
+ * With `CLOCK_SYNC`, mails are written as timed raw frames stamped with the
+ * time passed to `sendMail`; sync responses go out through `sendRaw`.
+ *
+ * With `LATENCY_STATS`, `sendMail` records its own duration as the build
+ * stage, and `sendLatencyReport` publishes latency frames.
+ *
+ * Every frame is published with its `TrafficClass`, which sinks with a
+ * `TxScheduler` use to order them. With `TX_SCHEDULER`, `sendMessage` sends
+ * messages of any size as message frames of `SERIAL_MAIL_MESSAGE_CHUNK_SIZE`
+ * bytes. Chunks are cut only while the sinks can queue them, on every call
+ * that services the sinks, so a long message never fills the frame pool.
  */
 class SerialMailSender {
 public:
@@ -26,18 +88,106 @@ public:
     /// Deleted copy assignment operator to enforce the singleton pattern.
     SerialMailSender& operator=(const SerialMailSender&) = delete;
 
+    /**
+     * @brief Registers a link that receives all following frames.
+     * @param sink Sink to add, e.g. `UartTransport::getInstance()`.
+     * @return False if no more sinks can be registered.
+     */
+    bool addSink(FrameSink& sink);
+
+#if defined(WARM_RESTART) && defined(RAW_FRAMES)
+    /**
+     * @brief Continues the frame sequence numbers of the previous run and keeps them up to date.
+     * @param retained Retained area whose sequence number is restored and updated after every mail.
+     */
+    void attachRetained(RetainedState& retained);
+#endif
+
     /**
      * @brief Serializes and sends mail data over the serial connection.
      * @param ch0 Downsampled ADC readings for channel 0.
      * @param ch1 Downsampled ADC readings for channel 1.
      * @param node Identifier for the data source node.
+     * @param device AD7124 of the node the readings come from, tagged in the frame.
+     * @param time_us Host time of the last sample, carried by timed raw frames (`CLOCK_SYNC`).
      */
     void sendMail(
-        std::vector<std::array<uint8_t, 3>> ch0,
-        std::vector<std::array<uint8_t, 3>> ch1,
-        int node
+        const SampleVector& ch0,
+        const SampleVector& ch1,
+        int node,
+        unsigned int device = 0,
+        uint64_t time_us = 0
     );
 
+    /**
+     * @brief Sends an already framed byte sequence over the serial connection.
+     *
+     * The write is serialized with `sendMail`, so frames from different threads
+     * never interleave on the link.
+     *
+     * @param data Bytes to send.
+     * @param size Number of bytes to send.
+     * @param traffic_class Class of the frame, e.g. `TRAFFIC_BULK` for capture records.
+     */
+    void sendRaw(const uint8_t* data, size_t size, TrafficClass traffic_class = TRAFFIC_CONTROL);
+
+#if defined(BAND_POWER)
+    /**
+     * @brief Serializes the band powers of one window as a band power frame and sends it.
+     * @param powers Result of a `BandPowerAnalyzer` window.
+     * @param node Identifier for the data source node.
+     */
+    void sendBandPowers(const BandPowers& powers, int node);
+#endif
+
+#if defined(LATENCY_STATS)
+    /**
+     * @brief Sends the histogram of one stage as one or more latency frames.
+     * @param snapshot Counts of the period.
+     * @param report Node, stage, report number and period.
+     */
+    void sendLatencyReport(const LatencySnapshot& snapshot, const LatencyReport& report);
+#endif
+
+#if defined(TX_SCHEDULER)
+    /**
+     * @brief Starts sending a message, cut into message frames as the sinks take them.
+     * @param traffic_class Class of the message frames, one message per class at a time.
+     * @param kind Content, `MESSAGE_KIND_*`.
+     * @param data Message bytes; must stay valid and unchanged until `messagePending` is false.
+     * @param size Number of message bytes.
+     * @param node Identifier for the data source node.
+     * @return False if a message of the class is still being sent.
+     */
+    bool sendMessage(TrafficClass traffic_class, uint8_t kind, const uint8_t* data, size_t size, int node);
+
+    /**
+     * @brief Tells whether a message of a class still has chunks to send.
+     * @param traffic_class Class passed to `sendMessage`.
+     * @return True until the last chunk was published.
+     */
+    bool messagePending(TrafficClass traffic_class);
+#endif
+
+    /**
+     * @brief Lets every sink write queued bytes without blocking.
+     */
+    void service(void);
+
+    /**
+     * @brief Number of frames lost because every pooled buffer was in use.
+     * @return Count since startup.
+     */
+    uint32_t droppedFrames(void) const { return m_dropped_frames; }
+
+#if defined(ADAPTIVE_BATCHING)
+    /**
+     * @brief Frame size policy fed with the backlog of the sinks.
+     * @return Batcher shared with the acquisition thread.
+     */
+    AdaptiveBatcher& batcher(void) { return m_batcher; }
+#endif
+
 private:
     /**
      * @brief Private constructor to enforce the singleton pattern.
@@ -50,19 +200,84 @@ private:
     ~SerialMailSender(void) = default;
 
     /**
-     * @var m_serial_port
-     * @brief Static instance of BufferedSerial for serial communication.
-     *
-     * The serial port is used to transmit serialized mail data.
+     * @var m_frame_pool
+     * @brief Buffers shared between the sinks until the last one has sent them.
+     */
+    FramePool m_frame_pool;
+
+    /**
+     * @var m_dispatcher
+     * @brief Sinks registered at startup.
+     */
+    FrameDispatcher m_dispatcher;
+
+    /**
+     * @var m_dropped_frames
+     * @brief Frames lost because the pool was exhausted.
+     */
+    uint32_t m_dropped_frames;
+
+    /**
+     * @var m_frame_builder
+     * @brief Serializes the readings into a complete frame, reused for every mail.
+     */
+#if defined(CLOCK_SYNC)
+    MailFrameBuilder m_frame_builder{true};
+#else
+    MailFrameBuilder m_frame_builder;
+#endif
+
+#if defined(WARM_RESTART) && defined(RAW_FRAMES)
+    /**
+     * @var m_retained
+     * @brief Receives the sequence number of the next frame, null if not attached.
+     */
+    RetainedState* m_retained;
+#endif
+
+#if defined(ADAPTIVE_BATCHING)
+    /**
+     * @var m_batcher
+     * @brief Chooses the samples per frame from the backlog seen by `sendMail`.
+     */
+    AdaptiveBatcher m_batcher;
+#endif
+
+#if defined(TX_SCHEDULER)
+    /**
+     * @struct PendingMessage
+     * @brief Message being cut into message frames.
+     */
+    struct PendingMessage {
+        const uint8_t* data;    ///< Message bytes, owned by the caller.
+        MessageHeader  header;  ///< Fields of every chunk.
+        size_t         offset;  ///< First byte not yet published.
+        bool           active;  ///< Chunks remain to be published.
+    };
+
+    /**
+     * @var m_messages
+     * @brief Message being sent per traffic class.
+     */
+    PendingMessage m_messages[TRAFFIC_CLASS_COUNT];
+
+    /**
+     * @var m_message_id
+     * @brief Number of the next message.
+     */
+    uint16_t m_message_id;
+
+    /**
+     * @brief Publishes the chunks of pending messages the sinks can queue, with the mutex held.
      */
-    static BufferedSerial m_serial_port;
+    void publishMessageChunks(void);
+#endif
 
     /**
-     * @brief Converts ADC inputs to a SerialMail::Value array.
-     * @param inputs Vector of 3-byte arrays representing ADC inputs.
-     * @return Vector of SerialMail::Value objects suitable for serialization.
+     * @var m_mutex
+     * @brief Serializes access to the builder and the sink queues across threads.
      */
-    std::vector<SerialMail::Value> convertToSerialMailValues(const std::vector<std::array<uint8_t, 3>>& inputs);
+    Mutex m_mutex;
 };
 
 #endif // SERIAL_MAIL_SENDER_H
\ No newline at end of file
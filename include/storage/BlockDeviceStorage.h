@@ -0,0 +1,37 @@
+#ifndef BLOCK_DEVICE_STORAGE_H
+#define BLOCK_DEVICE_STORAGE_H
+
+#include "mbed.h"
+#include "blockdevice/BlockDevice.h"
+#include "storage/FlashStorage.h"
+
+/**
+ * @class BlockDeviceStorage
+ * @brief Exposes an Mbed `BlockDevice` (internal flash, SPI flash) to the ring log.
+ */
+class BlockDeviceStorage : public FlashStorage {
+public:
+    /**
+     * @brief Constructs the adapter; the block device is initialized by `init`.
+     * @param block_device Device used exclusively by the log.
+     */
+    explicit BlockDeviceStorage(mbed::BlockDevice& block_device);
+
+    /**
+     * @brief Initializes the block device.
+     * @return 0 on success, a `BlockDevice` error otherwise.
+     */
+    int init(void);
+
+    int read(void* buffer, uint32_t address, uint32_t size) override;
+    int program(const void* buffer, uint32_t address, uint32_t size) override;
+    int erase(uint32_t address, uint32_t size) override;
+    uint32_t programSize(void) const override;
+    uint32_t eraseSize(void) const override;
+    uint32_t size(void) const override;
+
+private:
+    mbed::BlockDevice& m_block_device;  ///< Underlying device.
+};
+
+#endif // BLOCK_DEVICE_STORAGE_H
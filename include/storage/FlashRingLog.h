@@ -0,0 +1,163 @@
+#ifndef FLASH_RING_LOG_H
+#define FLASH_RING_LOG_H
+
+/**
+ * @file FlashRingLog.h
+ * @brief Append-only ring of records in flash for store-and-forward.
+ *
+ * The flash area is split into erase sectors. Each sector starts with a
+ * `FlashLogSectorHeader` carrying a sequence number, followed by records
+ * (`FlashLogRecordHeader` + payload, padded to the program size) that never
+ * cross a sector boundary:
+ *
+ * ```
+ * sector n:   [magic, sequence] [record] [record] ... [erased]
+ * sector n+1: [magic, sequence + 1] [record] ...
+ * ```
+ *
+ * Sectors are written strictly in ring order, so every sector is erased once
+ * per pass over the area (wear levelling by construction). A sector is erased
+ * as soon as all of its records have been read, which makes the read position
+ * survive a reset at sector granularity: after a reboot at most one sector of
+ * already forwarded records is delivered again. When the ring is full, the
+ * oldest sector is overwritten.
+ *
+ * @note This header must stay free of Mbed OS dependencies.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+#include "storage/FlashStorage.h"
+
+/// Largest record payload, matches `FRAME_BUFFER_CAPACITY`.
+#define FLASH_LOG_MAX_RECORD_SIZE 512
+
+/// Largest supported program size of the flash.
+#define FLASH_LOG_MAX_PROGRAM_SIZE 16
+
+/// Marks a valid sector header.
+#define FLASH_LOG_SECTOR_MAGIC 0x4C594850 // "PHYL"
+
+/// Marks a valid record header.
+#define FLASH_LOG_RECORD_MARKER 0x5AA5
+
+/**
+ * @struct FlashLogSectorHeader
+ * @brief Header at the start of every used sector (8 bytes).
+ */
+struct FlashLogSectorHeader {
+    uint32_t magic;         ///< `FLASH_LOG_SECTOR_MAGIC`.
+    uint32_t sequence;      ///< Increases by one for every newly opened sector.
+};
+
+/**
+ * @struct FlashLogRecordHeader
+ * @brief Header in front of every record payload (8 bytes).
+ */
+struct FlashLogRecordHeader {
+    uint16_t marker;        ///< `FLASH_LOG_RECORD_MARKER`.
+    uint16_t length;        ///< Payload size in bytes.
+    uint32_t crc;           ///< CRC-32 of the payload.
+};
+
+/**
+ * @struct FlashLogStats
+ * @brief Counters of a ring log since `mount`.
+ */
+struct FlashLogStats {
+    uint32_t appended;          ///< Records written.
+    uint32_t read;              ///< Records returned by `front` and consumed by `pop`.
+    uint32_t overwritten;       ///< Sectors overwritten before they were read.
+    uint32_t corrupt;           ///< Records skipped because of a CRC mismatch.
+    uint32_t erases;            ///< Sector erases.
+};
+
+/**
+ * @class FlashRingLog
+ * @brief Store-and-forward log of variable-size records.
+ *
+ * Not thread-safe; the owner serializes all calls.
+ */
+class FlashRingLog {
+public:
+    /**
+     * @brief Constructs a log on a flash area; call `mount` before use.
+     * @param storage Flash area used exclusively by the log.
+     */
+    explicit FlashRingLog(FlashStorage& storage);
+
+    /**
+     * @brief Recovers the log from flash, formatting it if no valid sector exists.
+     * @return 0 on success, negative if the area is unusable or a flash operation failed.
+     */
+    int mount(void);
+
+    /**
+     * @brief Erases the whole area and starts an empty log.
+     * @return 0 on success.
+     */
+    int format(void);
+
+    /**
+     * @brief Appends a record, overwriting the oldest sector if the ring is full.
+     * @param data Payload.
+     * @param size Payload size, at most `FLASH_LOG_MAX_RECORD_SIZE`.
+     * @return True if the record was written.
+     */
+    bool append(const uint8_t* data, size_t size);
+
+    /// True if no unread record is left.
+    bool empty(void) const;
+
+    /**
+     * @brief Reads the oldest unread record.
+     * @param size Receives the payload size.
+     * @return Payload, valid until the next call, or null if the log is empty.
+     */
+    const uint8_t* front(size_t* size);
+
+    /**
+     * @brief Consumes the record returned by `front`.
+     */
+    void pop(void);
+
+    /// Counters since `mount`.
+    const FlashLogStats& stats(void) const { return m_stats; }
+
+private:
+    FlashStorage&   m_storage;          ///< Flash area.
+    uint32_t        m_sector_size;      ///< Bytes per erase sector.
+    uint32_t        m_sector_count;     ///< Sectors in the area.
+    uint32_t        m_program_size;     ///< Program granularity.
+    uint32_t        m_head_sector;      ///< Sector being written.
+    uint32_t        m_head_offset;      ///< Next write offset in the head sector.
+    uint32_t        m_sequence;         ///< Sequence number of the head sector.
+    uint32_t        m_tail_sector;      ///< Sector being read.
+    uint32_t        m_tail_offset;      ///< Next read offset in the tail sector.
+    bool            m_front_valid;      ///< `m_record` holds the record at the tail.
+    size_t          m_front_size;       ///< Payload size of the cached record.
+    FlashLogStats   m_stats;            ///< Counters.
+
+    /// Staging buffer for one record, padded to the program size.
+    uint8_t m_record[sizeof(FlashLogRecordHeader) + FLASH_LOG_MAX_RECORD_SIZE + FLASH_LOG_MAX_PROGRAM_SIZE];
+
+    uint32_t align(uint32_t size) const;
+    uint32_t address(uint32_t sector, uint32_t offset) const;
+    bool readRecordHeader(uint32_t sector, uint32_t offset, FlashLogRecordHeader* header);
+    bool isBlank(uint32_t sector);
+    int eraseSector(uint32_t sector);
+    int openSector(uint32_t sector);
+    uint32_t findWriteOffset(uint32_t sector);
+    void normalizeTail(void);
+};
+
+/**
+ * @brief Computes the CRC-32 (IEEE 802.3) of a buffer.
+ * @param data Bytes to check.
+ * @param size Number of bytes.
+ * @return CRC of the bytes.
+ */
+uint32_t flash_log_crc32(const uint8_t* data, size_t size);
+
+#endif // FLASH_RING_LOG_H
@@ -0,0 +1,64 @@
+#ifndef FLASH_STORAGE_H
+#define FLASH_STORAGE_H
+
+/**
+ * @file FlashStorage.h
+ * @brief Minimal flash interface used by the ring log.
+ *
+ * Mirrors the subset of `mbed::BlockDevice` the log needs, so the log itself
+ * stays free of Mbed OS dependencies and runs on the host against a simulated
+ * flash.
+ *
+ * @note This header must stay free of Mbed OS dependencies.
+ */
+
+#include <cstdint>
+
+/**
+ * @class FlashStorage
+ * @brief Erase/program/read access to a flash area.
+ *
+ * Erased flash reads as `0xFF`. All functions return 0 on success and a
+ * negative value on failure, like `mbed::BlockDevice`.
+ */
+class FlashStorage {
+public:
+    virtual ~FlashStorage(void) = default;
+
+    /**
+     * @brief Reads bytes.
+     * @param buffer Destination.
+     * @param address Offset into the area.
+     * @param size Number of bytes.
+     * @return 0 on success.
+     */
+    virtual int read(void* buffer, uint32_t address, uint32_t size) = 0;
+
+    /**
+     * @brief Programs erased bytes.
+     * @param buffer Source, `size` a multiple of `programSize()`.
+     * @param address Offset aligned to `programSize()`.
+     * @param size Number of bytes.
+     * @return 0 on success.
+     */
+    virtual int program(const void* buffer, uint32_t address, uint32_t size) = 0;
+
+    /**
+     * @brief Erases whole sectors.
+     * @param address Offset aligned to `eraseSize()`.
+     * @param size Multiple of `eraseSize()`.
+     * @return 0 on success.
+     */
+    virtual int erase(uint32_t address, uint32_t size) = 0;
+
+    /// Smallest programmable unit in bytes.
+    virtual uint32_t programSize(void) const = 0;
+
+    /// Size of one erase sector in bytes.
+    virtual uint32_t eraseSize(void) const = 0;
+
+    /// Total size of the area in bytes.
+    virtual uint32_t size(void) const = 0;
+};
+
+#endif // FLASH_STORAGE_H
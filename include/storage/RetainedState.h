@@ -0,0 +1,190 @@
+#ifndef RETAINED_STATE_H
+#define RETAINED_STATE_H
+
+/**
+ * @file RetainedState.h
+ * @brief State kept in RAM that is not initialized at boot, for warm restarts (`WARM_RESTART`).
+ *
+ * A `RetainedArea` sits in a no-init section, so a watchdog or software reset
+ * leaves its contents alone. It holds a ring of the frames a sink accepted
+ * but has not completely written yet, the sequence number of the next frame
+ * and the registers the ADC was programmed with:
+ *
+ * ```
+ * [magic, layout, boots, head, tail, sequence, crc] [adc words, adc crc] [ring]
+ * ring: [record] [record] ... [wrap] [record] ...
+ * ```
+ *
+ * Records (`RetainedRecordHeader` + payload, padded to 4 bytes) are appended
+ * at `head` and released in any order; `tail` skips released records. The
+ * indices are protected by a CRC-32 over the header, every record by the
+ * CRC-32 of its payload, and the ADC words by their own CRC. After power-up
+ * the RAM holds random data, which fails these checks, so `recover` then
+ * starts an empty area.
+ *
+ * @note This header must stay free of Mbed OS dependencies.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+/// Bytes of the frame ring, two full sink queues of the largest frames.
+#define RETAINED_RING_SIZE 5120
+
+/// Largest record payload, matches `FRAME_BUFFER_CAPACITY`.
+#define RETAINED_MAX_RECORD_SIZE 512
+
+/// Words kept for the ADC registers.
+#define RETAINED_ADC_WORDS 8
+
+/// Marks a valid area.
+#define RETAINED_MAGIC 0x52594850 // "PHYR"
+
+/// Marks a record that is still pending.
+#define RETAINED_RECORD_PENDING 0x5AA5
+
+/// Marks a record that was released.
+#define RETAINED_RECORD_RELEASED 0x5A00
+
+/// Marks the end of the used part of the ring; the next record starts at offset 0.
+#define RETAINED_RECORD_WRAP 0xA55A
+
+/**
+ * @struct RetainedRecordHeader
+ * @brief Header in front of every record payload (8 bytes).
+ */
+struct RetainedRecordHeader {
+    uint16_t marker;        ///< `RETAINED_RECORD_PENDING`, `_RELEASED` or `_WRAP`.
+    uint16_t length;        ///< Payload size in bytes.
+    uint32_t crc;           ///< CRC-32 of the payload.
+};
+
+/**
+ * @struct RetainedArea
+ * @brief Layout of the no-init RAM; plain data, so no constructor touches it at boot.
+ */
+struct RetainedArea {
+    uint32_t magic;                         ///< `RETAINED_MAGIC`.
+    uint32_t layout;                        ///< `RETAINED_RING_SIZE` of the firmware that wrote the area.
+    uint32_t boots;                         ///< Warm restarts since the area was formatted.
+    uint32_t head;                          ///< Offset of the next record.
+    uint32_t tail;                          ///< Offset of the oldest record not released.
+    uint32_t sequence;                      ///< Sequence number of the next frame.
+    uint32_t crc;                           ///< CRC-32 of the fields above.
+    uint32_t adc[RETAINED_ADC_WORDS];       ///< Registers the ADC was programmed with.
+    uint32_t adc_crc;                       ///< CRC-32 of `adc`, anything else if not programmed.
+    uint8_t  ring[RETAINED_RING_SIZE];      ///< Records.
+};
+
+/**
+ * @struct RetainedStats
+ * @brief Counters since `recover`, kept in ordinary RAM.
+ */
+struct RetainedStats {
+    uint32_t appended;      ///< Records written.
+    uint32_t released;      ///< Records released.
+    uint32_t full;          ///< Frames not retained because the ring was full.
+    uint32_t recovered;     ///< Pending records found by `recover`.
+    uint32_t corrupt;       ///< Records dropped by `recover` because of a bad header or CRC.
+};
+
+/**
+ * @class RetainedState
+ * @brief Frame ring, sequence number and ADC registers that survive a warm reset.
+ *
+ * The ring is never overwritten: a frame that does not fit is simply not
+ * retained. Appending costs a CRC over the frame and one over the 24-byte
+ * header, releasing one over the header.
+ *
+ * Not thread-safe; the owner serializes all calls, except that the ADC
+ * words may be used from another thread, as they share no field with the
+ * ring.
+ */
+class RetainedState {
+public:
+    /**
+     * @brief Uses an area; call `recover` before anything else.
+     * @param area No-init RAM used only by this object.
+     */
+    explicit RetainedState(RetainedArea& area);
+
+    /**
+     * @brief Checks the area left by the previous run.
+     * @return True on a warm restart: the header was intact and its pending records are kept.
+     *
+     * @details
+     * The records are checked one by one; the ring is cut at the first
+     * one that is damaged. Otherwise the area is formatted.
+     */
+    bool recover(void);
+
+    /**
+     * @brief Starts an empty area, forgetting the frames and ADC registers.
+     */
+    void format(void);
+
+    /**
+     * @brief Keeps a copy of a frame.
+     * @param data Frame.
+     * @param size Frame size, at most `RETAINED_MAX_RECORD_SIZE`.
+     * @return Handle for `release`, 0 if the frame was not retained.
+     */
+    uint32_t append(const uint8_t* data, size_t size);
+
+    /**
+     * @brief Forgets a frame.
+     * @param handle Returned by `append`; 0 is ignored.
+     */
+    void release(uint32_t handle);
+
+    /// Pending records found by `recover`, those `front` returns first.
+    size_t recovered(void) const { return m_stats.recovered; }
+
+    /**
+     * @brief Returns the oldest pending record.
+     * @param size Receives the payload size.
+     * @return Payload, or null if no record is pending.
+     */
+    const uint8_t* front(size_t* size) const;
+
+    /**
+     * @brief Releases the record returned by `front`.
+     */
+    void pop(void);
+
+    /// Sequence number stored with `setSequence`, 0 after `format`.
+    uint32_t sequence(void) const { return m_area.sequence; }
+
+    /// Stores the sequence number of the next frame.
+    void setSequence(uint32_t sequence);
+
+    /**
+     * @brief Reads the stored ADC registers.
+     * @param words Receives `RETAINED_ADC_WORDS` words.
+     * @return False if none were stored since `format`.
+     */
+    bool adcConfig(uint32_t* words) const;
+
+    /**
+     * @brief Stores the registers the ADC was just programmed with.
+     * @param words `RETAINED_ADC_WORDS` words.
+     */
+    void setAdcConfig(const uint32_t* words);
+
+    /// Warm restarts since the area was formatted.
+    uint32_t boots(void) const { return m_area.boots; }
+
+    /// Counters since `recover`.
+    const RetainedStats& stats(void) const { return m_stats; }
+
+private:
+    RetainedArea&   m_area;     ///< No-init RAM.
+    RetainedStats   m_stats;    ///< Counters.
+
+    uint32_t headerCrc(void) const;
+    void seal(void);
+    void advanceTail(void);
+    const RetainedRecordHeader* record(uint32_t offset) const;
+};
+
+#endif // RETAINED_STATE_H
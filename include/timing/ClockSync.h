@@ -0,0 +1,204 @@
+#ifndef CLOCK_SYNC_H
+#define CLOCK_SYNC_H
+
+/**
+ * @file ClockSync.h
+ * @brief NTP-style exchange that maps the node clock onto the host clock (`CLOCK_SYNC`).
+ *
+ * The host periodically sends a sync request stamped with its send time T1.
+ * The node notes the arrival T2 and answers with T2 and its send time T3; the
+ * host notes the arrival T4 and returns it with its next request. From the
+ * four times the node gets one sample of the offset of the host clock and the
+ * round trip delay:
+ *
+ *     offset = ((T1 - T2) + (T4 - T3)) / 2,  delay = (T4 - T1) - (T3 - T2)
+ *
+ * The wire layout of both messages is described in FrameFormat.h.
+ *
+ * @note This header must stay free of Mbed OS dependencies.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+#include "serial_mail_sender/FrameFormat.h"
+
+/// Offset samples kept for the estimate.
+#define CLOCK_SYNC_HISTORY 32
+
+/// Samples whose delay exceeds the smallest one in the history by more than this are ignored, in us.
+#define CLOCK_SYNC_DELAY_MARGIN_US 200
+
+/// Samples with the smallest delays that are always used for the estimate, whatever their delay.
+#define CLOCK_SYNC_MIN_FIT 8
+
+/// Samples needed before frames are stamped with host time.
+#define CLOCK_SYNC_MIN_SAMPLES 2
+
+/// Deviation from the estimate, in us, treated as a step of the host clock that restarts the estimate.
+#define CLOCK_SYNC_STEP_US 1000000
+
+/// Largest skew the estimate accepts, in parts per billion.
+#define CLOCK_SYNC_MAX_SKEW_PPB 1000000
+
+/**
+ * @struct SyncRequest
+ * @brief Contents of a sync request sent by the host.
+ */
+struct SyncRequest {
+    uint32_t id;            ///< Identifier of this exchange, never 0.
+    uint64_t t1_us;         ///< Host time the request was sent.
+    uint32_t done_id;       ///< Identifier of the previous exchange, 0 if none.
+    uint64_t done_t4_us;    ///< Host time the response of the previous exchange arrived.
+};
+
+/**
+ * @struct SyncResponse
+ * @brief Contents of a sync response sent by the node.
+ */
+struct SyncResponse {
+    int32_t  node;          ///< Node identifier.
+    uint8_t  flags;         ///< `SYNC_FLAG_SYNCED` once frames carry host time.
+    uint32_t id;            ///< Identifier of the answered request.
+    uint64_t t2_us;         ///< Node time the request arrived.
+    uint64_t t3_us;         ///< Node time the response was sent.
+    int32_t  skew_ppb;      ///< Estimated rate error of the node clock in parts per billion.
+};
+
+/**
+ * @brief Writes `0xAAAA` + size + sync request.
+ * @return Number of bytes written to `out`, 0 if they do not fit.
+ */
+size_t write_sync_request(const SyncRequest& request, uint8_t* out, size_t capacity);
+
+/**
+ * @brief Reads a sync request payload.
+ * @return False if the version or size do not match.
+ */
+bool read_sync_request(const uint8_t* payload, size_t size, SyncRequest* request);
+
+/**
+ * @brief Writes `0xAAAA` + size + sync response.
+ * @return Number of bytes written to `out`, 0 if they do not fit.
+ */
+size_t write_sync_response(const SyncResponse& response, uint8_t* out, size_t capacity);
+
+/**
+ * @brief Reads a sync response payload.
+ * @return False if the version or size do not match.
+ */
+bool read_sync_response(const uint8_t* payload, size_t size, SyncResponse* response);
+
+/**
+ * @class SyncRequestParser
+ * @brief Finds sync requests in the bytes the node receives, one byte at a time.
+ *
+ * The host sends nothing but sync requests, so the parser only has to skip
+ * noise, e.g. while the link comes up: any frame that is not a sync request
+ * of the expected size restarts the search for the marker.
+ */
+class SyncRequestParser {
+public:
+    SyncRequestParser(void);
+
+    /**
+     * @brief Consumes one received byte.
+     * @return True if the byte completed a valid request, available from `request`.
+     */
+    bool feed(uint8_t byte);
+
+    /// True while a frame has been started but not completed.
+    bool receiving(void) const { return m_length > 0; }
+
+    /// Last request completed by `feed`.
+    const SyncRequest& request(void) const { return m_request; }
+
+private:
+    uint8_t     m_buffer[SERIAL_MAIL_HEADER_SIZE + SYNC_REQUEST_SIZE];  ///< Frame received so far.
+    size_t      m_length;       ///< Bytes in `m_buffer`.
+    SyncRequest m_request;      ///< Last complete request.
+};
+
+/**
+ * @class ClockSync
+ * @brief Estimates offset and skew of the node clock and converts node times to host time.
+ *
+ * Each completed exchange adds an offset sample at the node time halfway
+ * between T2 and T3. Queuing on the link (e.g. a response waiting behind a
+ * frame) and late servicing of the receive buffer only ever lengthen the
+ * measured delay and shift the sample by up to half of that, so only samples
+ * whose delay is within `CLOCK_SYNC_DELAY_MARGIN_US` of the smallest delay in
+ * the history, or among the `CLOCK_SYNC_MIN_FIT` smallest, are used. A least-squares line through them gives the offset
+ * at the newest sample and the skew; times are extrapolated along that line.
+ * A sample more than `CLOCK_SYNC_STEP_US` off the line, e.g. after the host
+ * clock was set, restarts the estimate.
+ *
+ * The fit runs once per exchange in double precision; `toHostTime` is integer
+ * arithmetic only, cheap enough for every frame.
+ */
+class ClockSync {
+public:
+    /**
+     * @param delay_margin_us Accepted excess delay over the smallest one in the history.
+     */
+    explicit ClockSync(uint32_t delay_margin_us = CLOCK_SYNC_DELAY_MARGIN_US);
+
+    /**
+     * @brief Handles a request: completes the previous exchange and answers the new one.
+     * @param request Request found by the `SyncRequestParser`.
+     * @param t2_us Node time the request arrived.
+     * @param t3_us Node time the response is sent.
+     * @param node Node identifier put into the response.
+     * @return Response to send.
+     */
+    SyncResponse respond(const SyncRequest& request, uint64_t t2_us, uint64_t t3_us, int node);
+
+    /**
+     * @brief Converts a node time into host time.
+     * @return Host time in us, 0 as long as fewer than `CLOCK_SYNC_MIN_SAMPLES` exchanges completed.
+     */
+    uint64_t toHostTime(uint64_t local_us) const;
+
+    /// True once `toHostTime` returns host times.
+    bool synced(void) const { return m_samples >= CLOCK_SYNC_MIN_SAMPLES; }
+
+    /// Estimated rate error of the node clock in parts per billion, positive if it runs slow.
+    int32_t skewPpb(void) const { return m_skew_ppb; }
+
+    /// Host minus node time at the reference point of the estimate, in us.
+    int64_t offsetUs(void) const { return m_offset_us; }
+
+    /// Exchanges completed since the estimate started.
+    uint32_t samples(void) const { return m_samples; }
+
+    /// Exchanges whose response never came back, e.g. a lost request or response.
+    uint32_t missedExchanges(void) const { return m_missed; }
+
+private:
+    /**
+     * @struct Sample
+     * @brief One completed exchange.
+     */
+    struct Sample {
+        uint64_t local_us;  ///< Node time halfway between T2 and T3.
+        int64_t  offset_us; ///< Host minus node time.
+        int64_t  delay_us;  ///< Round trip delay without the node's turnaround time.
+    };
+
+    uint32_t m_delay_margin_us;                 ///< Accepted excess delay.
+    Sample   m_history[CLOCK_SYNC_HISTORY];     ///< Ring of the latest samples.
+    size_t   m_next;                            ///< Ring slot of the next sample.
+    uint32_t m_samples;                         ///< Samples taken since the estimate started.
+    uint32_t m_missed;                          ///< Exchanges never completed.
+    SyncRequest m_pending;                      ///< Request answered last, id 0 if none.
+    uint64_t m_pending_t2_us;                   ///< Its arrival on the node.
+    uint64_t m_pending_t3_us;                   ///< Node time its response was sent.
+    uint64_t m_reference_us;                    ///< Node time the estimate refers to.
+    int64_t  m_offset_us;                       ///< Host minus node time at the reference.
+    int32_t  m_skew_ppb;                        ///< Slope of the offset over node time.
+
+    void addSample(const Sample& sample);
+    void estimate(void);
+};
+
+#endif // CLOCK_SYNC_H
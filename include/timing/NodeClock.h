@@ -0,0 +1,23 @@
+#ifndef NODE_CLOCK_H
+#define NODE_CLOCK_H
+
+/**
+ * @file NodeClock.h
+ * @brief Microsecond clock of the node used for clock synchronization (`CLOCK_SYNC`).
+ */
+
+#include "mbed.h"
+
+/**
+ * @brief Reads the free-running microsecond ticker.
+ * @return Node time in us since startup; 64 bits, so it never wraps.
+ *
+ * Frames are stamped with this clock when their last sample is read from
+ * the AD7124, and `ClockSync` maps it onto host time. It can be read from
+ * any thread.
+ */
+inline uint64_t node_clock_us(void) {
+    return ticker_read_us(get_us_ticker_data());
+}
+
+#endif // NODE_CLOCK_H
@@ -0,0 +1,114 @@
+#ifndef BLE_PACKER_H
+#define BLE_PACKER_H
+
+/**
+ * @file BlePacker.h
+ * @brief Packs serial mail frames into MTU-sized BLE notifications.
+ *
+ * The frames already carry the `0xAAAA` + size header, so the BLE link treats
+ * them as one continuous byte stream: consecutive frames are packed back to
+ * back and cut at notification boundaries. Every notification starts with a
+ * single rolling sequence byte, which lets the receiver detect lost
+ * notifications and resynchronize its frame decoder. This keeps the per-
+ * notification overhead at one byte on top of the 3-byte ATT header.
+ *
+ * @note This header must stay free of Mbed OS dependencies.
+ */
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/// Size of the ATT notification header (opcode + attribute handle).
+#define BLE_ATT_HEADER_SIZE 3
+
+/// Size of the sequence byte at the start of every notification.
+#define BLE_PACKET_HEADER_SIZE 1
+
+/// Default ATT MTU before the exchange with the central completes.
+#define BLE_DEFAULT_ATT_MTU 23
+
+/// ATT MTU requested by the node (`desired-att-mtu` in the Cordio configuration).
+#define BLE_DESIRED_ATT_MTU 250
+
+/// Largest notification value the packer produces.
+#define BLE_MAX_NOTIFICATION_SIZE (BLE_DESIRED_ATT_MTU - BLE_ATT_HEADER_SIZE)
+
+/// Capacity of the pending byte stream in bytes.
+#define BLE_PACKER_BUFFER_SIZE 2048
+
+/**
+ * @class BlePacker
+ * @brief Ring buffer of pending frame bytes that emits notification payloads.
+ */
+class BlePacker {
+public:
+    /**
+     * @brief Constructs a packer for the default ATT MTU.
+     */
+    BlePacker(void);
+
+    /**
+     * @brief Updates the negotiated ATT MTU.
+     * @param att_mtu ATT MTU agreed with the central.
+     */
+    void setAttMtu(uint16_t att_mtu);
+
+    /**
+     * @brief Returns the value size of a full notification for the current MTU.
+     * @return Notification size in bytes, including the sequence byte.
+     */
+    size_t notificationSize(void) const { return m_notification_size; }
+
+    /**
+     * @brief Queues a complete frame.
+     * @param frame Frame bytes.
+     * @param size Number of bytes in the frame.
+     * @return False if the frame does not fit; frames are never queued partially.
+     */
+    bool push(const uint8_t* frame, size_t size);
+
+    /**
+     * @brief Produces the next notification value.
+     * @param notification Output buffer of at least `notificationSize()` bytes.
+     * @param flush Emit a partially filled notification instead of waiting for more data.
+     * @return Size of the notification, 0 if nothing is to be sent.
+     */
+    size_t pull(uint8_t* notification, bool flush);
+
+    /**
+     * @brief Returns the number of queued frame bytes.
+     * @return Pending bytes.
+     */
+    size_t pending(void) const { return m_size; }
+
+    /**
+     * @brief Drops all queued bytes, e.g. after a disconnection.
+     */
+    void clear(void);
+
+private:
+    std::array<uint8_t, BLE_PACKER_BUFFER_SIZE> m_buffer;   ///< Pending frame bytes.
+    size_t  m_head;                 ///< Index of the oldest pending byte.
+    size_t  m_size;                 ///< Number of pending bytes.
+    size_t  m_notification_size;    ///< Value size of a full notification.
+    uint8_t m_sequence;             ///< Sequence number of the next notification.
+};
+
+/**
+ * @brief Estimates the application throughput of the notification link.
+ *
+ * Every connection event can carry a limited number of notifications; with a
+ * full MTU this is the upper bound the send queue works towards.
+ *
+ * @param att_mtu Negotiated ATT MTU.
+ * @param connection_interval_us Connection interval in microseconds.
+ * @param notifications_per_event Notifications the controller sends per connection event.
+ * @return Frame bytes per second that can be transported.
+ */
+constexpr float ble_throughput_estimate(uint16_t att_mtu, uint32_t connection_interval_us, unsigned int notifications_per_event) {
+    return (float)((att_mtu - BLE_ATT_HEADER_SIZE - BLE_PACKET_HEADER_SIZE) * notifications_per_event) *
+           1000000.0f / (float)connection_interval_us;
+}
+
+#endif // BLE_PACKER_H
@@ -0,0 +1,105 @@
+#ifndef BLE_TRANSPORT_H
+#define BLE_TRANSPORT_H
+
+#include <atomic>
+
+#include "mbed.h"
+#include "ble/BLE.h"
+#include "ble/Gap.h"
+#include "ble/GattServer.h"
+#include "transport/BlePacker.h"
+#include "transport/FrameSink.h"
+
+/// Upper bound of notifications handed to the controller per connection event.
+#define BLE_NOTIFICATIONS_PER_EVENT 4
+
+/// Name advertised by the node.
+#define BLE_DEVICE_NAME "PhytoNode"
+
+/**
+ * @class BleTransport
+ * @brief Singleton sink that sends frames as GATT notifications.
+ *
+ * The node advertises a custom service with a single notify characteristic.
+ * Frames are packed into notifications by a `BlePacker` so each notification
+ * fills the negotiated MTU. Sending is driven by the connection interval: once
+ * per interval up to `BLE_NOTIFICATIONS_PER_EVENT` notifications are queued in
+ * the controller, with credits returned by `onDataSent`. A partially filled
+ * notification is flushed once it has waited a whole interval.
+ *
+ * All BLE stack calls run on the transport's own EventQueue thread. Frames
+ * only leave the sink queue while a central is subscribed and the packer has
+ * room for the whole frame; otherwise the oldest queued frames are dropped.
+ * The subscription is checked under the packer mutex together with the push
+ * or pull, so a disconnect cannot clear the packer between the two.
+ */
+class BleTransport : public FrameSink,
+                     private ble::Gap::EventHandler,
+                     private ble::GattServer::EventHandler {
+public:
+    /**
+     * @brief Gets the singleton instance of the BleTransport.
+     * @return Reference to the singleton instance of BleTransport.
+     */
+    static BleTransport& getInstance(void);
+
+    /// Deleted copy constructor to enforce the singleton pattern.
+    BleTransport(const BleTransport&) = delete;
+
+    /// Deleted copy assignment operator to enforce the singleton pattern.
+    BleTransport& operator=(const BleTransport&) = delete;
+
+    /**
+     * @brief Initializes the BLE stack and starts advertising.
+     */
+    void start(void);
+
+    /**
+     * @brief Reports whether a central is subscribed to the frame characteristic.
+     * @return True while notifications are enabled.
+     */
+    bool linkUp(void) const override;
+
+protected:
+    size_t writeSome(const uint8_t* data, size_t size) override;
+
+private:
+    BLE&            m_ble;                      ///< BLE stack instance.
+    EventQueue      m_event_queue;              ///< Queue running all BLE work.
+    Thread          m_event_thread;             ///< Dispatches `m_event_queue`.
+    Mutex           m_mutex;                    ///< Protects packer and subscription between sender and BLE thread.
+    BlePacker       m_packer;                   ///< Pending frame bytes.
+    uint8_t         m_notification[BLE_MAX_NOTIFICATION_SIZE];      ///< Notification being sent.
+    uint8_t         m_value[BLE_MAX_NOTIFICATION_SIZE];             ///< Characteristic storage.
+    uint8_t         m_adv_buffer[ble::LEGACY_ADVERTISING_MAX_SIZE]; ///< Advertising payload.
+    UUID            m_service_uuid;             ///< UUID of the PhytoNode service.
+    UUID            m_characteristic_uuid;      ///< UUID of the frame characteristic.
+    GattCharacteristic m_characteristic;        ///< Notify characteristic carrying the frames.
+    std::atomic<bool> m_subscribed;             ///< True while a central listens to notifications.
+    int             m_credits;                  ///< Notifications the controller can still take.
+    int             m_send_event;               ///< Id of the periodic send event, 0 if none.
+    int             m_idle_intervals;           ///< Intervals a partial notification has waited.
+    std::chrono::milliseconds m_interval;       ///< Current connection interval.
+
+    BleTransport(void);
+    ~BleTransport(void) = default;
+
+    void scheduleBleEvents(BLE::OnEventsToProcessCallbackContext* context);
+    void onInitComplete(BLE::InitializationCompleteCallbackContext* params);
+    void startAdvertising(void);
+    void restartSendEvent(ble::conn_interval_t interval);
+    void sendBurst(void);
+
+    // ble::Gap::EventHandler
+    void onConnectionComplete(const ble::ConnectionCompleteEvent& event) override;
+    void onConnectionParametersUpdateComplete(const ble::ConnectionParametersUpdateCompleteEvent& event) override;
+    void onDisconnectionComplete(const ble::DisconnectionCompleteEvent& event) override;
+
+    // ble::GattServer::EventHandler
+    void onAttMtuChange(ble::connection_handle_t connection_handle, uint16_t att_mtu) override;
+    void onDataSent(const GattDataSentCallbackParams& params) override;
+    void onUpdatesEnabled(const GattUpdatesEnabledCallbackParams& params) override;
+    void onUpdatesDisabled(const GattUpdatesDisabledCallbackParams& params) override;
+};
+
+#endif // BLE_TRANSPORT_H
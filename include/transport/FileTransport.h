@@ -0,0 +1,63 @@
+#ifndef FILE_TRANSPORT_H
+#define FILE_TRANSPORT_H
+
+/**
+ * @file FileTransport.h
+ * @brief Sink that appends frames to a file, e.g. on a flash file system.
+ *
+ * @note This header must stay free of Mbed OS dependencies; on the node the file
+ *       lives on a file system mounted by the application.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#include "transport/FrameSink.h"
+
+/// Bytes written to flash per `service` call, keeps the other sinks responsive.
+#define FILE_TRANSPORT_BUDGET 128
+
+/// Bytes written between two `fflush` calls.
+#define FILE_TRANSPORT_FLUSH_SIZE 2048
+
+/**
+ * @class FileTransport
+ * @brief Appends the frame stream to a file.
+ *
+ * Flash writes are slow compared to the UART, so the sink writes only
+ * `FILE_TRANSPORT_BUDGET` bytes per service call and drops the newest frames
+ * when it falls behind, keeping the stored history contiguous.
+ */
+class FileTransport : public FrameSink {
+public:
+    /**
+     * @brief Constructs a sink that is closed until `open` succeeds.
+     * @param name Name used in statistics.
+     */
+    explicit FileTransport(const char* name = "file");
+
+    /// Closes the file.
+    ~FileTransport(void) override;
+
+    /**
+     * @brief Opens the file for appending.
+     * @param path Path of the file, e.g. `/fs/frames.bin`.
+     * @return True if the file could be opened.
+     */
+    bool open(const char* path);
+
+    /**
+     * @brief Flushes and closes the file.
+     */
+    void close(void);
+
+protected:
+    size_t writeSome(const uint8_t* data, size_t size) override;
+
+private:
+    FILE*    m_file;        ///< Open file, null while closed.
+    size_t   m_unflushed;   ///< Bytes written since the last flush.
+};
+
+#endif // FILE_TRANSPORT_H
@@ -0,0 +1,157 @@
+#ifndef FRAME_BUFFER_H
+#define FRAME_BUFFER_H
+
+/**
+ * @file FrameBuffer.h
+ * @brief Reference-counted frame buffers shared by all sinks without copying.
+ *
+ * @note This header must stay free of Mbed OS dependencies.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/// Largest frame a pooled buffer can hold.
+#define FRAME_BUFFER_CAPACITY 512
+
+/**
+ * Number of frame buffers in a pool: one per queue slot of every sink
+ * (`FRAME_DISPATCHER_MAX_SINKS` x `FRAME_SINK_QUEUE_DEPTH`) plus the frame being
+ * built, so a producer always finds a free buffer however far the sinks lag.
+ */
+#define FRAME_POOL_SIZE 17
+
+/**
+ * @struct FrameBuffer
+ * @brief Storage of one serialized frame, owned by a `FramePool`.
+ */
+struct FrameBuffer {
+    std::atomic<uint32_t> refs;                 ///< Number of `FrameRef`s pointing here, 0 if free.
+    size_t                size;                 ///< Used bytes in `data`.
+    uint8_t               data[FRAME_BUFFER_CAPACITY]; ///< Frame bytes.
+};
+
+/**
+ * @class FrameRef
+ * @brief Counted handle to a pooled frame.
+ *
+ * Copying a `FrameRef` only increments the reference count; the buffer returns
+ * to its pool when the last handle is destroyed. The count is atomic, so
+ * handles may be released from any thread.
+ */
+class FrameRef {
+public:
+    /// Constructs an empty handle.
+    FrameRef(void) : m_buffer(nullptr) {}
+
+    /**
+     * @brief Adopts a buffer whose reference count already accounts for this handle.
+     * @param buffer Buffer returned by `FramePool::allocate`.
+     */
+    explicit FrameRef(FrameBuffer* buffer) : m_buffer(buffer) {}
+
+    /// Copy constructor, shares the buffer.
+    FrameRef(const FrameRef& other) : m_buffer(other.m_buffer) { acquire(); }
+
+    /// Move constructor, takes over the reference.
+    FrameRef(FrameRef&& other) : m_buffer(other.m_buffer) { other.m_buffer = nullptr; }
+
+    /// Releases the reference.
+    ~FrameRef(void) { release(); }
+
+    /// Copy assignment, shares the buffer.
+    FrameRef& operator=(const FrameRef& other) {
+        if (this != &other) {
+            release();
+            m_buffer = other.m_buffer;
+            acquire();
+        }
+        return *this;
+    }
+
+    /// Move assignment, takes over the reference.
+    FrameRef& operator=(FrameRef&& other) {
+        if (this != &other) {
+            release();
+            m_buffer = other.m_buffer;
+            other.m_buffer = nullptr;
+        }
+        return *this;
+    }
+
+    /// True if the handle refers to a frame.
+    explicit operator bool(void) const { return m_buffer != nullptr; }
+
+    /// Frame bytes.
+    const uint8_t* data(void) const { return m_buffer->data; }
+
+    /// Number of frame bytes.
+    size_t size(void) const { return m_buffer->size; }
+
+    /**
+     * @brief Gives the producer write access before the frame is shared.
+     * @return Writable storage of `FRAME_BUFFER_CAPACITY` bytes.
+     */
+    uint8_t* mutableData(void) { return m_buffer->data; }
+
+    /**
+     * @brief Sets the number of valid bytes before the frame is shared.
+     * @param size Frame size in bytes.
+     */
+    void setSize(size_t size) { m_buffer->size = size; }
+
+    /// Drops the reference and leaves the handle empty.
+    void reset(void) {
+        release();
+        m_buffer = nullptr;
+    }
+
+private:
+    FrameBuffer* m_buffer;  ///< Referenced buffer, null if empty.
+
+    void acquire(void) {
+        if (m_buffer != nullptr) {
+            m_buffer->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void release(void) {
+        if (m_buffer != nullptr) {
+            m_buffer->refs.fetch_sub(1, std::memory_order_acq_rel);
+        }
+    }
+};
+
+/**
+ * @class FramePool
+ * @brief Fixed set of frame buffers, free when their reference count is 0.
+ *
+ * Allocation claims a free buffer with a compare-and-swap of its count from 0
+ * to 1, so no free list or lock is needed and buffers may be released from any
+ * thread.
+ */
+class FramePool {
+public:
+    /**
+     * @brief Constructs a pool with all buffers free.
+     */
+    FramePool(void);
+
+    /**
+     * @brief Claims a free buffer.
+     * @return Handle to an empty frame, or an empty handle if all buffers are in use.
+     */
+    FrameRef allocate(void);
+
+    /**
+     * @brief Counts the free buffers.
+     * @return Number of buffers not referenced by any handle.
+     */
+    size_t available(void) const;
+
+private:
+    FrameBuffer m_buffers[FRAME_POOL_SIZE];  ///< Pooled buffers.
+};
+
+#endif // FRAME_BUFFER_H
@@ -0,0 +1,77 @@
+#ifndef FRAME_DISPATCHER_H
+#define FRAME_DISPATCHER_H
+
+/**
+ * @file FrameDispatcher.h
+ * @brief Fans frames out to all registered sinks.
+ *
+ * @note This header must stay free of Mbed OS dependencies.
+ */
+
+#include <cstddef>
+
+#include "transport/FrameBuffer.h"
+#include "transport/FrameSink.h"
+
+/// Maximum number of sinks registered at the same time.
+#define FRAME_DISPATCHER_MAX_SINKS 4
+
+static_assert(FRAME_POOL_SIZE > FRAME_DISPATCHER_MAX_SINKS * FRAME_SINK_QUEUE_DEPTH,
+              "Frame pool too small for the sink queues");
+
+/**
+ * @class FrameDispatcher
+ * @brief Holds the sinks registered at startup and hands every frame to each of them.
+ */
+class FrameDispatcher {
+public:
+    /**
+     * @brief Constructs a dispatcher without sinks.
+     */
+    FrameDispatcher(void);
+
+    /**
+     * @brief Registers a sink.
+     * @param sink Sink that receives all following frames.
+     * @return False if `FRAME_DISPATCHER_MAX_SINKS` sinks are already registered.
+     */
+    bool addSink(FrameSink& sink);
+
+    /**
+     * @brief Offers a frame to every sink.
+     * @param frame Shared frame, referenced by each sink that queues it.
+     * @param traffic_class Class of the frame, used by sinks with a scheduler.
+     * @return Number of sinks that queued the frame.
+     */
+    size_t publish(const FrameRef& frame, TrafficClass traffic_class = TRAFFIC_SAMPLES);
+
+    /**
+     * @brief Tells whether a frame of a class can be published without a drop.
+     * @param traffic_class Class of the frame.
+     * @return True if at least one sink's link is up and every such sink can queue the frame.
+     */
+    bool canAccept(TrafficClass traffic_class) const;
+
+    /**
+     * @brief Lets every sink write its queued bytes.
+     */
+    void service(void);
+
+    /**
+     * @brief Frames waiting in the most backed-up sink whose link is up.
+     * @return Largest `queued()` of those sinks; sinks without a peer are ignored.
+     */
+    size_t backlog(void) const;
+
+    /// Number of registered sinks.
+    size_t sinkCount(void) const { return m_sink_count; }
+
+    /// Registered sink at `index`.
+    FrameSink& sink(size_t index) const { return *m_sinks[index]; }
+
+private:
+    FrameSink*  m_sinks[FRAME_DISPATCHER_MAX_SINKS];   ///< Registered sinks.
+    size_t      m_sink_count;                           ///< Number of registered sinks.
+};
+
+#endif // FRAME_DISPATCHER_H
@@ -0,0 +1,206 @@
+#ifndef FRAME_SINK_H
+#define FRAME_SINK_H
+
+/**
+ * @file FrameSink.h
+ * @brief Interface of all links that receive serialized frames.
+ *
+ * @note This header must stay free of Mbed OS dependencies.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+#include "storage/FlashRingLog.h"
+#include "transport/FrameBuffer.h"
+
+class LatencyHistogram;
+class RetainedState;
+class TxScheduler;
+
+/// Frames a sink can hold before its backpressure policy applies.
+#define FRAME_SINK_QUEUE_DEPTH 4
+
+/// Bytes a sink may write per `service` call unless configured otherwise.
+#define FRAME_SINK_DEFAULT_BUDGET 256
+
+/**
+ * @enum BackpressurePolicy
+ * @brief What a sink does with a new frame while its queue is full.
+ */
+enum BackpressurePolicy {
+    BACKPRESSURE_DROP_NEWEST,   ///< Keep the queued frames, discard the new one.
+    BACKPRESSURE_DROP_OLDEST,   ///< Discard the oldest frame not yet started, keep the new one.
+};
+
+/**
+ * @enum TrafficClass
+ * @brief Kind of traffic a frame belongs to, used by sinks with a `TxScheduler`.
+ */
+enum TrafficClass {
+    TRAFFIC_CONTROL,        ///< Short, time-critical replies, e.g. sync responses.
+    TRAFFIC_SAMPLES,        ///< Sample and band power frames.
+    TRAFFIC_STATUS,         ///< Periodic reports, e.g. latency frames and status messages.
+    TRAFFIC_BULK,           ///< Large transfers, e.g. captures and dumps.
+    TRAFFIC_CLASS_COUNT     ///< Number of classes.
+};
+
+/**
+ * @struct FrameSinkStats
+ * @brief Counters kept per sink.
+ */
+struct FrameSinkStats {
+    uint32_t accepted;      ///< Frames taken into the queue.
+    uint32_t dropped;       ///< Frames discarded by the backpressure policy.
+    uint32_t sent;          ///< Frames completely written to the link.
+    uint32_t bytes;         ///< Bytes written to the link.
+    uint32_t stored;        ///< Frames written to the backlog while the link was down.
+    uint32_t forwarded;     ///< Frames sent from the backlog after the link returned.
+};
+
+/**
+ * @class FrameSink
+ * @brief Base class of a link with its own bounded frame queue.
+ *
+ * `offer` only stores a `FrameRef`, so handing the same frame to several sinks
+ * costs a reference count increment each. `service` writes queued bytes through
+ * the non-blocking `writeSome` of the concrete link, at most `budget` bytes per
+ * call, and keeps the position of a partially written frame. A slow link
+ * therefore only fills its own queue and drops frames according to its policy
+ * without holding back the other sinks. While `linkUp` is false nothing is
+ * written; a frame that was partially written when the link went down is
+ * sent again from its start once the link is back.
+ *
+ * With a backlog attached, frames offered while `linkUp` is false are
+ * appended to a `FlashRingLog` instead of being queued. Once the link is back,
+ * `service` forwards stored frames whenever no live frame is waiting, at most
+ * `drain_budget` bytes per call. A stored frame that was started is finished
+ * before the next live frame, so catching up delays live data by at most the
+ * rest of one stored frame.
+ *
+ * With a latency histogram attached, the time from `offer` until the last
+ * byte of a frame was taken by `writeSome` is recorded per frame.
+ *
+ * With a `TxScheduler` attached, offered frames wait in the queue of their
+ * traffic class instead, and `service` takes the next frame from the
+ * scheduler whenever the previous one is completely written. The sink's own
+ * queue then holds at most the frame being written.
+ *
+ * With retained state attached (`WARM_RESTART`), a copy of every frame
+ * taken into the queue is kept in no-init RAM until its last byte was
+ * written or the frame was dropped, so it can be sent again after a warm
+ * reset. Frames in the scheduler's queues are not retained.
+ *
+ * `offer` and `service` of one sink must be called from the same thread or be
+ * serialized by the caller.
+ */
+class FrameSink {
+public:
+    /**
+     * @brief Constructs a sink.
+     * @param name Name used in logs and statistics.
+     * @param policy Policy applied when the queue is full.
+     * @param budget Bytes written per `service` call at most.
+     */
+    FrameSink(const char* name, BackpressurePolicy policy, size_t budget = FRAME_SINK_DEFAULT_BUDGET);
+
+    virtual ~FrameSink(void) = default;
+
+    /**
+     * @brief Queues a frame, applying the backpressure policy if the queue is full.
+     * @param frame Shared frame.
+     * @param traffic_class Class of the frame, only used with a scheduler.
+     * @return True if the frame was queued.
+     */
+    bool offer(const FrameRef& frame, TrafficClass traffic_class = TRAFFIC_SAMPLES);
+
+    /**
+     * @brief Tells whether a frame of a class would be queued without a drop.
+     * @param traffic_class Class of the frame.
+     * @return False while the link is down with a backlog attached, or the queue is full.
+     */
+    bool canAccept(TrafficClass traffic_class) const;
+
+    /**
+     * @brief Writes queued bytes to the link without blocking.
+     */
+    void service(void);
+
+    /**
+     * @brief Stores frames in a flash log while the link is down.
+     * @param log Mounted log used only by this sink.
+     * @param drain_budget Backlog bytes forwarded per `service` call at most.
+     */
+    void attachBacklog(FlashRingLog& log, size_t drain_budget);
+
+    /**
+     * @brief Records how long each frame stays in this sink.
+     * @param histogram Receives the time from `offer` until the last byte was written.
+     * @param clock Microsecond clock, e.g. `LatencyStats::now_us`.
+     */
+    void attachLatencyHistogram(LatencyHistogram& histogram, uint32_t (*clock)(void));
+
+    /**
+     * @brief Lets a scheduler decide the order in which queued frames are sent.
+     * @param scheduler Scheduler used only by this sink.
+     * @param clock Microsecond clock for the rate caps, the same as for a latency histogram.
+     */
+    void attachScheduler(TxScheduler& scheduler, uint32_t (*clock)(void));
+
+    /**
+     * @brief Keeps the queued frames in RAM that survives a warm reset.
+     * @param retained Recovered state; its other users must be serialized with this sink.
+     */
+    void attachRetained(RetainedState& retained);
+
+    /**
+     * @brief Reports whether the receiving side is present.
+     * @return True by default; links that can detect their peer override this.
+     */
+    virtual bool linkUp(void) const { return true; }
+
+    /// Number of queued frames, including one partially written and those in the scheduler.
+    size_t queued(void) const;
+
+    /// Name given at construction.
+    const char* name(void) const { return m_name; }
+
+    /// Counters of this sink.
+    const FrameSinkStats& stats(void) const { return m_stats; }
+
+protected:
+    /**
+     * @brief Writes as many bytes as the link takes right now.
+     * @param data Bytes to write.
+     * @param size Number of bytes available.
+     * @return Number of bytes taken, 0 if the link is busy.
+     */
+    virtual size_t writeSome(const uint8_t* data, size_t size) = 0;
+
+private:
+    const char*         m_name;                             ///< Sink name.
+    BackpressurePolicy  m_policy;                           ///< Policy for a full queue.
+    size_t              m_budget;                           ///< Bytes per `service` call.
+    FrameRef            m_queue[FRAME_SINK_QUEUE_DEPTH];    ///< Ring of queued frames.
+    size_t              m_head;                             ///< Index of the oldest frame.
+    size_t              m_count;                            ///< Number of queued frames.
+    size_t              m_offset;                           ///< Bytes of the oldest frame already written.
+    FrameSinkStats      m_stats;                            ///< Counters.
+    FlashRingLog*       m_backlog;                          ///< Store-and-forward log, null if none.
+    size_t              m_drain_budget;                     ///< Backlog bytes per `service` call.
+    size_t              m_backlog_offset;                   ///< Bytes of the oldest stored frame already written.
+    LatencyHistogram*   m_latency;                          ///< Time frames spend in the sink, null if not recorded.
+    uint32_t            (*m_clock)(void);                   ///< Clock of `m_latency` and `m_scheduler`.
+    uint32_t            m_queued_us[FRAME_SINK_QUEUE_DEPTH]; ///< Time each queued frame was offered.
+    TxScheduler*        m_scheduler;                        ///< Orders the frames by class, null if none.
+    RetainedState*      m_retained;                         ///< Copies of the queued frames, null if none.
+    uint32_t            m_retained_handles[FRAME_SINK_QUEUE_DEPTH]; ///< Retained copy of each queued frame.
+
+    uint32_t now(void) const { return m_clock != nullptr ? m_clock() : 0; }
+    bool pullScheduled(void);
+    void pop(void);
+    void restartPartialFrames(void);
+    size_t forwardStored(size_t budget, bool start_next);
+};
+
+#endif // FRAME_SINK_H
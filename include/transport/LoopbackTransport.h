@@ -0,0 +1,55 @@
+#ifndef LOOPBACK_TRANSPORT_H
+#define LOOPBACK_TRANSPORT_H
+
+/**
+ * @file LoopbackTransport.h
+ * @brief In-memory sink whose bytes are read back by the application or a test.
+ *
+ * @note This header must stay free of Mbed OS dependencies.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+#include "transport/FrameSink.h"
+
+/// Bytes the loopback buffer holds before the sink reports a busy link.
+#define LOOPBACK_BUFFER_SIZE 1024
+
+/**
+ * @class LoopbackTransport
+ * @brief Sink that writes into a byte ring which is drained with `read`.
+ *
+ * The link is only as fast as its reader, so the rate at which `read` is called
+ * simulates links of different speed.
+ */
+class LoopbackTransport : public FrameSink {
+public:
+    /**
+     * @brief Constructs a loopback sink.
+     * @param name Name used in statistics.
+     * @param policy Policy applied when the frame queue is full.
+     */
+    LoopbackTransport(const char* name = "loopback", BackpressurePolicy policy = BACKPRESSURE_DROP_OLDEST);
+
+    /**
+     * @brief Takes bytes out of the ring.
+     * @param out Destination buffer.
+     * @param capacity Maximum number of bytes to read.
+     * @return Number of bytes read.
+     */
+    size_t read(uint8_t* out, size_t capacity);
+
+    /// Number of bytes waiting to be read.
+    size_t available(void) const { return m_size; }
+
+protected:
+    size_t writeSome(const uint8_t* data, size_t size) override;
+
+private:
+    uint8_t m_buffer[LOOPBACK_BUFFER_SIZE]; ///< Ring storage.
+    size_t  m_head;                         ///< Index of the oldest byte.
+    size_t  m_size;                         ///< Number of stored bytes.
+};
+
+#endif // LOOPBACK_TRANSPORT_H
@@ -0,0 +1,149 @@
+#ifndef TX_SCHEDULER_H
+#define TX_SCHEDULER_H
+
+/**
+ * @file TxScheduler.h
+ * @brief Per-class transmit queues with priorities, fair shares and rate caps (`TX_SCHEDULER`).
+ *
+ * @note This header must stay free of Mbed OS dependencies.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+#include "transport/FrameBuffer.h"
+#include "transport/FrameSink.h"
+
+/// Frames queued per traffic class.
+#define TX_SCHEDULER_QUEUE_DEPTH 3
+
+/// Bytes a class of weight 1 may send per round among the classes of its priority.
+#define TX_SCHEDULER_QUANTUM 128
+
+static_assert(FRAME_POOL_SIZE > TRAFFIC_CLASS_COUNT * TX_SCHEDULER_QUEUE_DEPTH + 1,
+              "Frame pool too small for the scheduler queues");
+
+/**
+ * @struct TxClassConfig
+ * @brief How one traffic class is scheduled.
+ */
+struct TxClassConfig {
+    uint8_t            priority;    ///< Classes of a lower value are served first, below `TRAFFIC_CLASS_COUNT`.
+    uint8_t            weight;      ///< Share among the classes of the same priority, at least 1.
+    uint32_t           rate;        ///< Cap in bytes/s, 0 for none.
+    uint32_t           burst;       ///< Bytes a capped class may send at once after being idle.
+    BackpressurePolicy policy;      ///< Applied when the class queue is full.
+};
+
+/**
+ * Default classes: sync responses before samples, status and bulk share the
+ * rest 3:1, status is capped at 2 kB/s. Bulk is not capped, so a capture
+ * (`CAPTURE_SPI_WORDS`) gets every byte the other classes leave.
+ */
+constexpr TxClassConfig TX_CLASS_DEFAULTS[TRAFFIC_CLASS_COUNT] = {
+    {0, 1, 0, 0, BACKPRESSURE_DROP_OLDEST},         // TRAFFIC_CONTROL
+    {1, 1, 0, 0, BACKPRESSURE_DROP_OLDEST},         // TRAFFIC_SAMPLES
+    {2, 3, 2048, 1024, BACKPRESSURE_DROP_NEWEST},   // TRAFFIC_STATUS
+    {2, 1, 0, 0, BACKPRESSURE_DROP_NEWEST},         // TRAFFIC_BULK
+};
+
+/**
+ * @struct TxClassStats
+ * @brief Counters kept per traffic class.
+ */
+struct TxClassStats {
+    uint32_t accepted;      ///< Frames taken into the class queue.
+    uint32_t dropped;       ///< Frames discarded by the class policy.
+    uint32_t sent;          ///< Frames handed to the link.
+    uint32_t bytes;         ///< Bytes of those frames.
+};
+
+/**
+ * @class TxScheduler
+ * @brief Decides which queued frame a link sends next.
+ *
+ * Every traffic class has its own queue. `next` serves the classes in strict
+ * priority order; classes of equal priority share the link by deficit round
+ * robin, i.e. in proportion to their weight in bytes, whatever their frame
+ * sizes. A class with a rate cap is skipped while its token bucket is empty,
+ * which lets lower priorities through.
+ *
+ * Scheduling happens between frames, so a frame of a lower class delays a
+ * more urgent one by at most its own length; messages larger than a frame
+ * are sent as several message frames (see MessageFrameBuilder.h) and can be
+ * preempted after every chunk.
+ */
+class TxScheduler {
+public:
+    /**
+     * @brief Constructs a scheduler with `TX_CLASS_DEFAULTS` and empty queues.
+     */
+    TxScheduler(void);
+
+    /**
+     * @brief Changes how a class is scheduled.
+     * @param traffic_class Class to configure.
+     * @param config Priority, weight, cap and policy.
+     */
+    void configure(TrafficClass traffic_class, const TxClassConfig& config);
+
+    /**
+     * @brief Queues a frame of a class, applying the class policy if its queue is full.
+     * @param frame Shared frame.
+     * @param traffic_class Class of the frame.
+     * @param now_us Microsecond clock, kept with the frame.
+     * @param evicted Set to true if a queued frame was dropped to make room.
+     * @return True if the frame was queued.
+     */
+    bool offer(const FrameRef& frame, TrafficClass traffic_class, uint32_t now_us, bool* evicted);
+
+    /**
+     * @brief Takes the frame to send next.
+     * @param now_us Microsecond clock, refills the token buckets.
+     * @param queued_us Receives the clock value passed to `offer` with the frame.
+     * @return Frame to send, empty if no class may send.
+     */
+    FrameRef next(uint32_t now_us, uint32_t* queued_us);
+
+    /// True if a frame of the class would be queued without a drop.
+    bool canAccept(TrafficClass traffic_class) const {
+        return m_classes[traffic_class].count < TX_SCHEDULER_QUEUE_DEPTH;
+    }
+
+    /// Number of frames queued over all classes.
+    size_t queued(void) const;
+
+    /// Number of frames queued in one class.
+    size_t queued(TrafficClass traffic_class) const { return m_classes[traffic_class].count; }
+
+    /// Counters of one class.
+    const TxClassStats& stats(TrafficClass traffic_class) const { return m_classes[traffic_class].stats; }
+
+private:
+    /**
+     * @struct ClassQueue
+     * @brief Queue and scheduling state of one class.
+     */
+    struct ClassQueue {
+        FrameRef      frames[TX_SCHEDULER_QUEUE_DEPTH];     ///< Ring of queued frames.
+        uint32_t      queued_us[TX_SCHEDULER_QUEUE_DEPTH];  ///< Time each frame was offered.
+        size_t        head;                                 ///< Index of the oldest frame.
+        size_t        count;                                ///< Number of queued frames.
+        TxClassConfig config;                               ///< Priority, weight, cap and policy.
+        TxClassStats  stats;                                ///< Counters.
+        int32_t       tokens;                               ///< Bytes the class may still send, capped classes only.
+        uint32_t      residue;                              ///< Part of a token carried to the next refill, in 1e-6 bytes.
+        int32_t       deficit;                              ///< Bytes the class may send in its current turn.
+    };
+
+    ClassQueue m_classes[TRAFFIC_CLASS_COUNT];  ///< Per-class state, indexed by `TrafficClass`.
+    size_t     m_turn[TRAFFIC_CLASS_COUNT];     ///< Class whose turn it is, per priority.
+    bool       m_granted[TRAFFIC_CLASS_COUNT];  ///< The class in turn already got its quantum, per priority.
+    uint32_t   m_last_us;                       ///< Clock at the previous refill.
+
+    void refill(uint32_t now_us);
+    bool eligible(const ClassQueue& queue) const;
+    FrameRef pop(ClassQueue& queue, uint32_t* queued_us);
+};
+
+#endif // TX_SCHEDULER_H
@@ -0,0 +1,110 @@
+#ifndef UART_TRANSPORT_H
+#define UART_TRANSPORT_H
+
+#include "mbed.h"  // Required for BufferedSerial
+#include "transport/FrameSink.h"
+
+/// Input driven high by the Raspberry Pi while its logger is running (Arduino D6).
+#define UART_HOST_READY_PIN PA_8
+
+/// UART baud rate for serial communication.
+#define UART_BAUDRATE 115200
+
+/// Time one byte takes on the line in 8N1 format, in ns.
+#define UART_BYTE_TIME_NS (10 * 1000000000ULL / UART_BAUDRATE)
+
+/**
+ * @class UartTransport
+ * @brief Singleton sink that writes frames to the UART connected to the Raspberry Pi.
+ *
+ * The port is non-blocking; bytes that do not fit into the TX buffer stay
+ * queued in the sink. When the link falls behind, the oldest frames are dropped
+ * so the Raspberry Pi always receives the most recent readings.
+ *
+ * A UART without flow control cannot tell whether anyone listens, so the link
+ * is reported down only with `STORE_AND_FORWARD`, where the Raspberry Pi
+ * signals its presence on `UART_HOST_READY_PIN`.
+ *
+ * With `CLOCK_SYNC`, the sync requests of the Raspberry Pi are read from the
+ * same port with `readSome`, which also tells when the bytes arrived.
+ */
+class UartTransport : public FrameSink {
+public:
+    /**
+     * @brief Gets the singleton instance of the UartTransport.
+     * @return Reference to the singleton instance of UartTransport.
+     */
+    static UartTransport& getInstance(void);
+
+    /// Deleted copy constructor to enforce the singleton pattern.
+    UartTransport(const UartTransport&) = delete;
+
+    /// Deleted copy assignment operator to enforce the singleton pattern.
+    UartTransport& operator=(const UartTransport&) = delete;
+
+    /**
+     * @brief Reports whether the Raspberry Pi is ready to receive.
+     * @return State of `UART_HOST_READY_PIN` with `STORE_AND_FORWARD`, true otherwise.
+     */
+    bool linkUp(void) const override;
+
+#if defined(CLOCK_SYNC)
+    /**
+     * @brief Reads the bytes received so far without blocking.
+     * @param data Destination of the bytes.
+     * @param size Capacity of `data`.
+     * @param received_us Receives the node time the first of the bytes arrived, or a later time.
+     * @return Number of bytes read, 0 if none are waiting.
+     */
+    size_t readSome(uint8_t* data, size_t size, uint64_t* received_us);
+#endif
+
+protected:
+    size_t writeSome(const uint8_t* data, size_t size) override;
+
+private:
+    /**
+     * @var m_serial_port
+     * @brief BufferedSerial instance used to transmit the frames.
+     */
+    BufferedSerial m_serial_port;
+
+#if defined(CLOCK_SYNC)
+    /**
+     * @var m_event_us
+     * @brief Node time of the latest serial event, written by the interrupt.
+     */
+    volatile uint64_t m_event_us;
+
+    /**
+     * @var m_event_seen
+     * @brief An event occurred since the last `readSome`.
+     */
+    volatile bool m_event_seen;
+
+    /**
+     * @brief Stamps a serial event, called in interrupt context.
+     */
+    void onSerialEvent(void);
+#endif
+
+#if defined(STORE_AND_FORWARD)
+    /**
+     * @var m_host_ready
+     * @brief Presence signal of the Raspberry Pi, pulled down while unconnected.
+     */
+    mutable DigitalIn m_host_ready;
+#endif
+
+    /**
+     * @brief Private constructor to enforce the singleton pattern.
+     */
+    UartTransport(void);
+
+    /**
+     * @brief Destructor to clean up resources.
+     */
+    ~UartTransport(void) = default;
+};
+
+#endif // UART_TRANSPORT_H
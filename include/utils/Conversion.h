@@ -2,6 +2,7 @@
 #define CONVERSION_H
 
 #include "mbed.h"
+#include "adc/SampleVector.h"
 
 /**
  * @brief Converts raw ADC byte inputs into analog voltage values.
@@ -12,7 +13,7 @@
  * @note This function assumes the input data is properly formatted and scaled
  *       according to the ADC's resolution and configuration.
  */
-std::vector<float> get_analog_inputs(std::vector<std::array<uint8_t, 3>> byte_inputs, int databits, float vref, float gain);
+std::vector<float> get_analog_inputs(const SampleVector& samples, int databits, float vref, float gain);
 
 #endif // CONVERSION_H
 
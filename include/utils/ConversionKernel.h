@@ -0,0 +1,77 @@
+#ifndef CONVERSION_KERNEL_H
+#define CONVERSION_KERNEL_H
+
+/**
+ * @file ConversionKernel.h
+ * @brief Conversion of sign-corrected AD7124 samples to millivolts, with runtime or compile-time constants.
+ *
+ * @note This header must stay free of Mbed OS dependencies.
+ */
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Converts a sample with constants known only at runtime.
+ * @param sample Sign-corrected sample (see SampleVector.h).
+ * @param databits Half of the code range, e.g. 8388608 for 24 bits in bipolar mode.
+ * @param vref Reference voltage in volts.
+ * @param gain PGA gain.
+ * @return Input voltage in millivolts.
+ */
+inline float sample_to_millivolts(int32_t sample, int32_t databits, float vref, float gain) {
+    float voltage = (float)sample / (float)databits;
+    return voltage * vref / gain * 1000;
+}
+
+/**
+ * @brief Converts a sample with the constants of a `PipelineConfig`.
+ *
+ * The division and both scale factors fold into a single multiply.
+ *
+ * @tparam Config Configuration type providing `databits`, `vref` and `gain`.
+ */
+template <typename Config>
+inline float sample_to_millivolts(int32_t sample) {
+    constexpr float mv_per_code = Config::vref / Config::gain * 1000 / (float)Config::databits;
+    return (float)sample * mv_per_code;
+}
+
+/**
+ * @brief Converts a voltage difference into ADC codes, e.g. for detector thresholds.
+ * @tparam Config Configuration type providing `databits`, `vref` and `gain`.
+ * @param millivolts Difference in millivolts.
+ * @return Difference in codes, rounded.
+ */
+template <typename Config>
+constexpr int32_t millivolts_to_codes(float millivolts) {
+    return (int32_t)(millivolts * (float)Config::databits / (Config::vref / Config::gain * 1000) + 0.5f);
+}
+
+/**
+ * @brief Converts a run of samples with runtime constants.
+ * @param samples Samples to convert.
+ * @param count Number of samples.
+ * @param out Receives `count` values in millivolts.
+ */
+inline void convert_samples(const int32_t* samples, size_t count,
+                            int32_t databits, float vref, float gain, float* out) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = sample_to_millivolts(samples[i], databits, vref, gain);
+    }
+}
+
+/**
+ * @brief Converts a fixed-size channel with the constants of a `PipelineConfig`.
+ * @tparam Config Configuration type.
+ * @tparam N Samples per channel.
+ */
+template <typename Config, size_t N>
+inline void convert_samples(const std::array<int32_t, N>& samples, std::array<float, N>& out) {
+    for (size_t i = 0; i < N; i++) {
+        out[i] = sample_to_millivolts<Config>(samples[i]);
+    }
+}
+
+#endif // CONVERSION_KERNEL_H
@@ -0,0 +1,89 @@
+#ifndef STATIC_VECTOR_H
+#define STATIC_VECTOR_H
+
+/**
+ * @file StaticVector.h
+ * @brief Fixed-capacity replacement for `std::vector` without heap allocations.
+ *
+ * @note This header must stay free of Mbed OS dependencies.
+ */
+
+#include <cstddef>
+
+/**
+ * @class StaticVector
+ * @brief Vector with inline storage for at most `N` elements.
+ *
+ * Implements the subset of the `std::vector` interface used by the sample
+ * path, so both can be swapped by a type alias. `push_back` on a full vector
+ * is ignored; callers that may overflow check `size()` against `capacity()`.
+ *
+ * @tparam T Element type.
+ * @tparam N Capacity.
+ * @tparam Align Alignment of the storage, at least that of `T`.
+ */
+template <typename T, size_t N, size_t Align = alignof(T)>
+class StaticVector {
+public:
+    typedef T value_type;           ///< Element type.
+    typedef T* iterator;            ///< Mutable iterator.
+    typedef const T* const_iterator;///< Constant iterator.
+
+    /// Constructs an empty vector.
+    StaticVector(void) : m_size(0) {}
+
+    /// Number of elements.
+    size_t size(void) const { return m_size; }
+
+    /// Maximum number of elements.
+    static constexpr size_t capacity(void) { return N; }
+
+    /// True if the vector holds no element.
+    bool empty(void) const { return m_size == 0; }
+
+    /// Storage is inline; kept for interface compatibility.
+    void reserve(size_t) {}
+
+    /// Removes all elements.
+    void clear(void) { m_size = 0; }
+
+    /**
+     * @brief Appends an element if there is room.
+     * @param value Element to append.
+     */
+    void push_back(const T& value) {
+        if (m_size < N) {
+            m_data[m_size++] = value;
+        }
+    }
+
+    /**
+     * @brief Removes one element, moving the following ones forward.
+     * @param position Element to remove.
+     * @return Iterator to the element that followed the removed one.
+     */
+    iterator erase(iterator position) {
+        for (iterator it = position; it + 1 < end(); ++it) {
+            *it = *(it + 1);
+        }
+        m_size--;
+        return position;
+    }
+
+    T& operator[](size_t index) { return m_data[index]; }              ///< Element access.
+    const T& operator[](size_t index) const { return m_data[index]; }  ///< Element access.
+
+    T* data(void) { return m_data; }                ///< Pointer to the first element.
+    const T* data(void) const { return m_data; }    ///< Pointer to the first element.
+
+    iterator begin(void) { return m_data; }                     ///< First element.
+    iterator end(void) { return m_data + m_size; }              ///< Past the last element.
+    const_iterator begin(void) const { return m_data; }         ///< First element.
+    const_iterator end(void) const { return m_data + m_size; }  ///< Past the last element.
+
+private:
+    alignas(Align) T m_data[N];     ///< Inline storage.
+    size_t           m_size;        ///< Number of used elements.
+};
+
+#endif // STATIC_VECTOR_H
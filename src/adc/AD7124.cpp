@@ -1,10 +1,83 @@
 
 #include "adc/AD7124.h"
 #include "adc/AD7124-defs.h"
+#include "adc/SampleCollector.h"
+#include "config/PipelineConfig.h"
 #include "utils/utils.h"
 #include "utils/logger.h"
 #include "interfaces/ReadingQueue.h"
 
+#if defined(CAPTURE_SPI_WORDS)
+#include "capture/CaptureRecorder.h"
+#endif
+
+#if defined(PIPELINE_STATS)
+#include <algorithm>
+#include "pipeline/PipelineStats.h"
+#endif
+
+#if defined(BAND_POWER)
+#include "dsp/BandPowerAnalyzer.h"
+#include "serial_mail_sender/SerialMailSender.h"
+#include "utils/ConversionKernel.h"
+#endif
+
+#if defined(CLOCK_SYNC)
+#include "timing/NodeClock.h"
+#endif
+
+#if defined(LATENCY_STATS)
+#include "pipeline/LatencyStats.h"
+#endif
+
+#if defined(WARM_RESTART)
+#include <cstring>
+#include "pipeline/WarmRestart.h"
+#endif
+
+#if defined(EVENT_TRIGGER)
+#include "adc/TriggerEngine.h"
+#elif defined(ADAPTIVE_BATCHING)
+#include "serial_mail_sender/SerialMailSender.h"
+#elif defined(MAINS_FILTER)
+#include "dsp/MainsFilter.h"
+#endif
+
+/**
+ * @brief Control register: status appended to the data, reference on, continuous read.
+ * @param clock_select `CLK_SEL` field value.
+ * @param power_mode `POWER_MODE` field value.
+ */
+static uint16_t control_setting(uint8_t clock_select, uint8_t power_mode) {
+    return AD7124_ADC_CTRL_REG_DATA_STATUS | AD7124_ADC_CTRL_REG_REF_EN | AD7124_ADC_CTRL_REG_CONT_READ |
+           AD7124_ADC_CTRL_REG_POWER_MODE(power_mode) | AD7124_ADC_CTRL_REG_MODE(0) |
+           AD7124_ADC_CTRL_REG_CLK_SEL(clock_select);
+}
+
+/**
+ * @brief Channel register: channel 0 on AIN0/AIN1 with setup 0, channel 1 on AIN2/AIN3 with setup 1.
+ * @param channel 0 or 1.
+ */
+static uint16_t channel_setting(unsigned int channel) {
+    return AD7124_CH_MAP_REG_CH_ENABLE | AD7124_CH_MAP_REG_SETUP(channel) |
+           AD7124_CH_MAP_REG_AINP(2 * channel) | AD7124_CH_MAP_REG_AINM(2 * channel + 1);
+}
+
+/**
+ * @brief Configuration register of both setups: bipolar, buffered inputs, internal reference, preset gain.
+ */
+static uint16_t config_setting(void) {
+    return AD7124_CFG_REG_BIPOLAR | AD7124_CFG_REG_AIN_BUFP | AD7124_CFG_REG_AINN_BUFM | AD7124_CFG_REG_REF_SEL(2) |
+           AD7124_CFG_REG_PGA(ad7124_pga_code(PhytoConfig::gain));
+}
+
+/**
+ * @brief Filter register of both setups: Sinc4 with the given FS, the preset's unless benchmarking.
+ * @param filter_fs Filter word FS.
+ */
+static uint32_t filter_setting(uint16_t filter_fs) {
+    return AD7124_FILT_REG_FS(filter_fs);
+}
 
 void AD7124::ctrl_reg(char RW){
     /* read/write the control register */
@@ -19,8 +92,7 @@ void AD7124::ctrl_reg(char RW){
         TRACE("\n");
     } else {
         m_spi.write(AD7124_ADC_CTRL_REG);
-        const uint16_t contr_reg_settings = AD7124_ADC_CTRL_REG_DATA_STATUS | AD7124_ADC_CTRL_REG_REF_EN | AD7124_ADC_CTRL_REG_CONT_READ | 
-                                        AD7124_ADC_CTRL_REG_POWER_MODE(0) | AD7124_ADC_CTRL_REG_MODE(0)|AD7124_ADC_CTRL_REG_CLK_SEL(0);
+        const uint16_t contr_reg_settings = control_setting(m_clock_select, m_power_mode);
         char contr_reg_set[]={contr_reg_settings>>8 & 0xFF, contr_reg_settings & 0xFF};
 
         for (int i = 0; i<=1; i++){
@@ -49,8 +121,7 @@ void AD7124::channel_reg(char RW){
         // SET CHANNEL 0
         if(m_flag_0 == true){
             m_spi.write(AD7124_CH0_MAP_REG);
-            const uint16_t channel_settings = AD7124_CH_MAP_REG_CH_ENABLE | AD7124_CH_MAP_REG_SETUP(0) |
-                                                 AD7124_CH_MAP_REG_AINP(0) |AD7124_CH_MAP_REG_AINM(1);
+            const uint16_t channel_settings = channel_setting(0);
             char channel_reg_set_ch0[]={channel_settings>>8 & 0xFF, channel_settings & 0xFF}; //channel 0 and 1 (0x80, 0x01)
                 //0x80 for setup 0
             for (int i = 0; i<=1; i++){
@@ -63,8 +134,7 @@ void AD7124::channel_reg(char RW){
             //register bytes set like this -> 10 00 00 (00 - 01 0)(0 00 11)
             //channel 1 - pins (2) and (3)
             //x80 is 1st byte, x43 is 2nd byte (for setting the AIN)
-            const uint16_t channel_settings1 = AD7124_CH_MAP_REG_CH_ENABLE | AD7124_CH_MAP_REG_SETUP(1) |
-                                        AD7124_CH_MAP_REG_AINP(2) |AD7124_CH_MAP_REG_AINM(3);
+            const uint16_t channel_settings1 = channel_setting(1);
 
             char channel_reg_set_ch1[]={channel_settings1>>8 & 0xFF, channel_settings1 & 0xFF}; //channel 2 and 3 (0x90, 0x43)
                 //0x90 for setup 1
@@ -90,7 +160,9 @@ void AD7124::filter_reg(uint8_t filt, char RW){
         m_spi.write(filt);
         //char contr_reg_set[]={0x00,0x08};
         //char filter_reg_set[]={AD7124_FILT_REG_FILTER(4)>>16,0x00,0x40};
-        char filter_reg_set[]={0x00, 0x00, 0x32}; //0x00,0x12,0xC0 for testing
+        // Sinc4, FS from the active preset (0x32 by default); 0x00,0x12,0xC0 for testing
+        const uint32_t filter_settings = filter_setting(m_filter_fs);
+        char filter_reg_set[]={(char)(filter_settings >> 16), (char)(filter_settings >> 8), (char)filter_settings};
         for (int i = 0; i<=2; i++){
             m_spi.write(filter_reg_set[i]);
         }
@@ -109,8 +181,7 @@ void AD7124::config_reg(uint8_t address ,char RW){
     }
     else{
         m_spi.write(address);
-        char my_config[]={(AD7124_CFG_REG_BIPOLAR ) >>8 ,
-                          AD7124_CFG_REG_AIN_BUFP | AD7124_CFG_REG_AINN_BUFM | AD7124_CFG_REG_REF_SEL(2) |AD7124_CFG_REG_PGA(2)};
+        char my_config[]={(char)(config_setting() >> 8), (char)config_setting()};
         //original 0x08, 0x71
         for (int i = 0; i<=1; i++){
             m_spi.write(my_config[i]);
@@ -137,7 +208,6 @@ char AD7124::status(){
 void AD7124::init(bool f0, bool f1){
     m_flag_0 = f0;
     m_flag_1 = f1;
-    m_sync = 1;
     m_cs=0;
 
     reset();
@@ -175,43 +245,163 @@ void AD7124::init(bool f0, bool f1){
     ctrl_reg(m_write);
     ctrl_reg(m_read);
     //AD7124::calibrate(1,0,0,0);
+
+    if (m_shared_bus) {
+        // Release DOUT/RDY for the other devices
+        m_cs = 1;
+    }
 }
 
 /**
- * @brief Constructs an AD7124 object and initializes SPI communication.
- * @param spi_frequency The SPI clock frequency in Hz.
+ * @brief Constructs an AD7124 object on an SPI bus.
+ * @param spi SPI bus, already set to mode 3 and the clock frequency.
+ * @param cs Chip select of this device.
+ * @param clock_select `CLK_SEL` field value.
+ * @param shared_bus True if other devices share the bus.
  */
-AD7124::AD7124(int spi_frequency):
-    m_spi(PA_7, PA_6, PA_5), m_drdy(PA_6), m_cs(PA_4), m_sync(PA_1),
-    m_spi_frequency(spi_frequency), m_flag_0(false), m_flag_1(false),
-    m_read(1), m_write(0){
+AD7124::AD7124(SPI& spi, PinName cs, uint8_t clock_select, bool shared_bus):
+    m_spi(spi), m_drdy(AD7124_DRDY_PIN), m_cs(cs, shared_bus ? 1 : 0),
+    m_clock_select(clock_select), m_power_mode(PhytoConfig::power_mode), m_filter_fs(PhytoConfig::filter_fs),
+    m_shared_bus(shared_bus), m_flag_0(false), m_flag_1(false),
+    m_read(1), m_write(0)
+#if defined(WARM_RESTART)
+    , m_resumed(false), m_resume_word{0, 0, 0, 255}
+#endif
+{
 
-    m_spi.format(8, 3);           
-    m_spi.frequency(m_spi_frequency);
+    if (!m_shared_bus) {
+#if defined(WARM_RESTART)
+        if (resume()) {
+            return;
+        }
+        init(true,true);
+        uint32_t words[RETAINED_ADC_WORDS];
+        register_words(words);
+        WarmRestart::getInstance().state().setAdcConfig(words);
+#else
+        init(true,true);
+#endif
+    }
+}
 
-    init(true,true);
+#if defined(WARM_RESTART)
+void AD7124::register_words(uint32_t words[RETAINED_ADC_WORDS]) const {
+    words[0] = control_setting(m_clock_select, m_power_mode);
+    words[1] = channel_setting(0);
+    words[2] = channel_setting(1);
+    words[3] = config_setting();
+    words[4] = config_setting();
+    words[5] = filter_setting(m_filter_fs);
+    words[6] = filter_setting(m_filter_fs);
+    words[7] = 0;
 }
 
+/**
+ * @details
+ * A reset of the microcontroller leaves the AD7124 converting in continuous
+ * read mode, so after booting a word is usually already waiting. Its
+ * registers are trusted if the retained words are those this firmware would
+ * write, and if within two conversions a word arrives whose status byte
+ * shows new data, no error, no power-on reset since the last status read
+ * and channel 0 or 1. A word clocked out partially before the reset leaves the serial
+ * interface misaligned, which the status byte shows as well. The word read
+ * here becomes the first sample, so no conversion is lost to the check.
+ */
+bool AD7124::resume(void) {
+    uint32_t retained[RETAINED_ADC_WORDS];
+    uint32_t wanted[RETAINED_ADC_WORDS];
+    register_words(wanted);
+    if (!WarmRestart::getInstance().state().adcConfig(retained) || memcmp(retained, wanted, sizeof(wanted)) != 0) {
+        return false;
+    }
+
+    const float words_per_s =
+        (float)ad7124_rate_sps(PhytoConfig::power_mode, PhytoConfig::channels, PhytoConfig::filter_fs) *
+        PhytoConfig::channels;
+    const auto timeout = std::chrono::microseconds((long long)(2e6f / words_per_s));
+    Timer timer;
+    timer.start();
+    while (m_drdy == 1) {
+        if (timer.elapsed_time() > timeout) {
+            return false;
+        }
+    }
+    read_conversion_word(m_resume_word);
+
+    uint8_t status = m_resume_word[3];
+    // Bit 5 always reads 0
+    const uint8_t must_be_clear = AD7124_STATUS_REG_RDY | AD7124_STATUS_REG_ERROR_FLAG | 0x20 | AD7124_STATUS_REG_POR_FLAG;
+    if ((status & must_be_clear) != 0 ||
+        AD7124_STATUS_REG_CH_ACTIVE(status) > 1) {
+        return false;
+    }
+    m_flag_0 = true;
+    m_flag_1 = true;
+    m_resumed = true;
+    return true;
+}
+
+bool AD7124::take_resumed_word(uint8_t data[4]) {
+    if (!m_resumed) {
+        return false;
+    }
+    memcpy(data, m_resume_word, sizeof(m_resume_word));
+    m_resumed = false;
+    return true;
+}
+#endif
+
 /**
  * @brief Gets the singleton instance of the AD7124 class.
  * @param spi_frequency The SPI clock frequency in Hz.
  * @return Reference to the singleton instance of the AD7124 class.
+ *
+ * @details
+ * A single converter is never resynchronized, so SYNC just stays high.
  */
 AD7124& AD7124::getInstance(int spi_frequency) {
-    static AD7124 instance(spi_frequency);
+    static DigitalOut sync(AD7124_SYNC_PIN, 1);
+    static SPI spi(AD7124_MOSI_PIN, AD7124_DRDY_PIN, AD7124_SCLK_PIN);
+    static AD7124 instance(setup_spi(spi, spi_frequency), AD7124_CS_PIN, AD7124_CLOCK_INTERNAL, false);
     return instance;
 }
 
+SPI& AD7124::setup_spi(SPI& spi, int spi_frequency) {
+    spi.format(8, 3);
+    spi.frequency(spi_frequency);
+    return spi;
+}
+
+/**
+ * @details
+ * The reset sequence at the start of `init` also ends continuous read mode,
+ * so the registers can be written while a conversion word is pending.
+ */
+void AD7124::reconfigure(int spi_frequency, uint8_t power_mode, uint16_t filter_fs) {
+    setup_spi(m_spi, spi_frequency);
+    m_power_mode = power_mode;
+    m_filter_fs = filter_fs;
+    init(true, true);
+}
+
 
 /**
  * @brief Sends ADC data to the main thread for further processing.
- * @param byte_inputs_channel_0 Data from channel 0.
- * @param byte_inputs_channel_1 Data from channel 1.
+ * @param samples_channel_0 Data from channel 0.
+ * @param samples_channel_1 Data from channel 1.
  */
 void AD7124::send_data_to_main_thread(
-    std::vector<std::array<uint8_t,3>> byte_inputs_channel_0,
-    std::vector<std::array<uint8_t,3>> byte_inputs_channel_1)
+    const SampleVector& samples_channel_0,
+    const SampleVector& samples_channel_1)
 {
+#if defined(CLOCK_SYNC)
+    // Stamp before waiting, the last sample was just read
+    uint64_t time_us = node_clock_us();
+#endif
+#if defined(LATENCY_STATS)
+    uint32_t start_us = LatencyStats::now_us();
+#endif
+
     // Access the shared queue
     ReadingQueue& reading_queue = ReadingQueue::getInstance();
 
@@ -225,81 +415,220 @@ void AD7124::send_data_to_main_thread(
     if (reading_queue.mail_box.empty()) {
         ReadingQueue::mail_t* mail = reading_queue.mail_box.try_alloc();
         
-        mail->ch0 = byte_inputs_channel_0;
-        byte_inputs_channel_0.clear();
-        mail->ch1 = byte_inputs_channel_1;
-        byte_inputs_channel_1.clear();
+        mail->ch0 = samples_channel_0;
+        mail->ch1 = samples_channel_1;
+        mail->device = 0;
+#if defined(CLOCK_SYNC)
+        mail->time_us = time_us;
+#endif
         reading_queue.mail_box.put(mail);
 
     }
 
+#if defined(LATENCY_STATS)
+    LatencyStats::getInstance().record(LATENCY_STAGE_HANDOFF, start_us);
+#endif
+
+}
+
+/**
+ * @brief Clocks the conversion word out of the AD7124.
+ * @param data Receives the 3 data bytes followed by the status byte.
+ */
+void AD7124::read_conversion_word(uint8_t data[4]){
+    for(int j = 0; j < 4; j++){
+        // Sends 0x00 and simultaneously receives a byte from the SPI slave device.
+        data[j] = m_spi.write(0x00);
+    }
+}
+
+/**
+ * @details
+ * DOUT/RDY is only driven while the device is selected and needs up to
+ * 80 ns after CS falls; in between a pull-up on MISO keeps it high.
+ */
+bool AD7124::try_read_conversion_word(uint8_t data[4]){
+    m_cs = 0;
+    wait_ns(100);
+    bool ready = (m_drdy == 0);
+    if (ready) {
+        read_conversion_word(data);
+    }
+    m_cs = 1;
+    return ready;
 }
 
 /**
  * @brief Reads voltage data from both ADC channels with downsampling.
  * @param downsampling_rate The rate to downsample ADC readings (in ms).
  * @param vector_size The size of the resulting data vectors.
+ *
+ * @details
+ * The conversion words are demultiplexed by a `SampleCollector`, which the host
+ * replay tool shares. With `CAPTURE_SPI_WORDS` defined, every word is also
+ * handed to the `CaptureRecorder` before it is interpreted.
+ *
+ * With `ADAPTIVE_BATCHING`, `vector_size` is only the initial frame size: the
+ * collector holds up to the batcher's largest frame, and after every complete
+ * sample pair the `AdaptiveBatcher` decides whether the frame is sent, which
+ * also bounds the age of its oldest sample.
+ *
+ * With `EVENT_TRIGGER` the collector only pairs the words, and the
+ * `TriggerEngine` decides which pairs are sent: event windows in frames of
+ * `vector_size`, and single heartbeat pairs. This takes precedence over
+ * `ADAPTIVE_BATCHING`.
+ *
+ * With `BAND_POWER` every word also feeds the `BandPowerAnalyzer`, and the
+ * band powers of each completed window are sent from this thread; with
+ * `BAND_POWER_ONLY` no sample frames are sent at all. The analyzer is static,
+ * as its filter state would take a large part of this thread's stack.
+ *
+ * With `MAINS_FILTER` every full frame of the collector goes through the
+ * `MainsFilter`, and its output is sent once it holds `vector_size` samples
+ * per channel, after `mains_decimation` input frames. Like the analyzer, the
+ * filter is static to keep its state and buffers off this thread's stack.
+ * The band powers are computed from the unfiltered words.
+ *
+ * With `LATENCY_STATS` the time spent waiting for each conversion is recorded
+ * as the ADC wait stage.
  */
 void AD7124::read_voltage_from_both_channels(unsigned int downsampling_rate, unsigned int vector_size){
 
-    while (true){
-        std::vector<std::array<uint8_t,3>> byte_inputs_channel_0;
-        std::vector<std::array<uint8_t,3>> byte_inputs_channel_1;
+#if defined(EVENT_TRIGGER)
+    SampleCollector collector(1);
+    TriggerEngine trigger(trigger_settings<PhytoConfig>(vector_size));
+#elif defined(ADAPTIVE_BATCHING)
+    AdaptiveBatcher& batcher = SerialMailSender::getInstance().batcher();
+    SampleCollector collector(batcher.maxSamples());
+    Kernel::Clock::time_point batch_start = Kernel::Clock::now();
+#elif defined(MAINS_FILTER)
+    static constexpr MainsFilterDesign mains_design = mains_filter_design<PhytoConfig>();
+    SampleCollector collector(vector_size);
+    static MainsFilter mains_filter(mains_design, vector_size);
+#else
+    SampleCollector collector(vector_size);
+#endif
+
+#if defined(BAND_POWER)
+    static BandPowerAnalyzer band_power(
+        PhytoConfig::band_window,
+        (float)ad7124_rate_sps(PhytoConfig::power_mode, PhytoConfig::channels, PhytoConfig::filter_fs),
+        PhytoConfig::band_edges_hz, PhytoConfig::band_count);
+#endif
+
+#if defined(CAPTURE_SPI_WORDS)
+    CaptureRecorder& capture_recorder = CaptureRecorder::getInstance();
+    capture_recorder.start();
+#endif
+
+#if defined(LATENCY_STATS)
+    LatencyStats& latency_stats = LatencyStats::getInstance();
+#endif
+
+#if defined(WARM_RESTART)
+    WarmRestart& warm_restart = WarmRestart::getInstance();
+#endif
 
+    while (true){
         Timer  t;
         t.start();
+        bool frame_ready = false;
         
-        // While the vector's size is less than 4, append 3-byte arrays
-        while ((byte_inputs_channel_0.size() < vector_size) || (byte_inputs_channel_1.size() < vector_size)){
+        while (!frame_ready){
             //printf("new value\n");
+#if defined(LATENCY_STATS)
+            uint32_t wait_start_us = LatencyStats::now_us();
+#endif
+            uint8_t data[4] = {0, 0, 0, 255};
+#if defined(WARM_RESTART)
+            // After a warm reset, the word read while resuming comes first
+            const bool resumed = take_resumed_word(data);
+#else
+            const bool resumed = false;
+#endif
             
-            while(m_drdy == 0){
+            while(!resumed && m_drdy == 0){
                 wait_us(1);
             }
-            while(m_drdy == 1){
+#if defined(PIPELINE_STATS)
+            // The longest gap between two polls bounds the DRDY-to-read latency
+            uint32_t last_poll_us = PipelineStats::now_us();
+            uint32_t max_gap_us = 0;
+#endif
+            while(!resumed && m_drdy == 1){
                 wait_us(1);
+#if defined(PIPELINE_STATS)
+                uint32_t poll_us = PipelineStats::now_us();
+                max_gap_us = std::max(max_gap_us, poll_us - last_poll_us);
+                last_poll_us = poll_us;
+#endif
             }
 
-            uint8_t data[4] = {0, 0, 0, 255};
-            for(int j = 0; j < 4; j++){
-                // Sends 0x00 and simultaneously receives a byte from the SPI slave device.
-                data[j] = m_spi.write(0x00);
+#if defined(LATENCY_STATS)
+            latency_stats.record(LATENCY_STAGE_ADC_WAIT, wait_start_us);
+#endif
+
+            if (!resumed) {
+                read_conversion_word(data);
             }
-                        
-            if(data[3] == 0){
-                // data from channel 0
-                if (byte_inputs_channel_0.size() < vector_size) {
-                    // Add new value
-                    std::array<uint8_t, 3> new_bytes = {data[0], data[1], data[2]};
-                    byte_inputs_channel_0.push_back(new_bytes);
-                } else {
-                    // Replace the oldest value with the new value (circular buffer approach)
-                    std::array<uint8_t, 3> new_bytes = {data[0], data[1], data[2]};
-                    byte_inputs_channel_0.erase(byte_inputs_channel_0.begin()); // Remove the oldest element
-                    byte_inputs_channel_0.push_back(new_bytes); // Add the new value
-                }
+#if defined(WARM_RESTART)
+            warm_restart.recordFirstSample();
+#endif
+#if defined(PIPELINE_STATS)
+            PipelineStats::getInstance().recordConversion(max_gap_us);
+#endif
+
+#if defined(CAPTURE_SPI_WORDS)
+            capture_recorder.recordWord(data);
+#endif
+
+#if defined(BAND_POWER)
+            if (band_power.push(data[3], sample_to_millivolts<PhytoConfig>(sample_from_bytes(data)))) {
+                SerialMailSender::getInstance().sendBandPowers(band_power.powers(), PhytoConfig::node);
             }
+#endif
 
-            if(data[3] == 1){
-                // data from channel 1
-                if(byte_inputs_channel_1.size() < vector_size){
-                    // Add new value
-                    std::array<uint8_t, 3> new_bytes = {data[0], data[1], data[2]};
-                    byte_inputs_channel_1.push_back(new_bytes);
-                } else{
-                    // Replace the oldest value with the new value (circular buffer approach)
-                    std::array<uint8_t, 3> new_bytes = {data[0], data[1], data[2]};
-                    byte_inputs_channel_1.erase(byte_inputs_channel_1.begin()); // Remove the oldest element
-                    byte_inputs_channel_1.push_back(new_bytes);
-                }
+#if defined(EVENT_TRIGGER)
+            if (collector.push(data)) {
+                frame_ready = trigger.push(collector.ch0()[0], collector.ch1()[0]) != TRIGGER_NONE;
+                collector.clear();
             }
-            
+#elif defined(ADAPTIVE_BATCHING)
+            if (collector.ch0().empty() && collector.ch1().empty()) {
+                batch_start = Kernel::Clock::now();
+            }
+            collector.push(data);
+            uint32_t age_ms = (uint32_t)(Kernel::Clock::now() - batch_start).count();
+            frame_ready = collector.paired() && batcher.due(collector.size(), age_ms);
+#elif defined(MAINS_FILTER)
+            if (collector.push(data)) {
+                frame_ready = mains_filter.push(collector.ch0(), collector.ch1());
+                collector.clear();
+            }
+#else
+            frame_ready = collector.push(data);
+#endif
         }
         // Check for correct smapling frequency
         // uint32_t elapsed_ms = t.elapsed_time().count() / 1000;
         // uint32_t elapsed_s  = elapsed_ms / 1000;
         //printf("Elapsed: %lu s\r\n", elapsed_s);
 
-        send_data_to_main_thread(byte_inputs_channel_0, byte_inputs_channel_1);
+#if defined(EVENT_TRIGGER)
+#if !defined(BAND_POWER_ONLY)
+        send_data_to_main_thread(trigger.ch0(), trigger.ch1());
+#endif
+        trigger.clear();
+#elif defined(MAINS_FILTER)
+#if !defined(BAND_POWER_ONLY)
+        send_data_to_main_thread(mains_filter.ch0(), mains_filter.ch1());
+#endif
+        mains_filter.clear();
+#else
+#if !defined(BAND_POWER_ONLY)
+        send_data_to_main_thread(collector.ch0(), collector.ch1());
+#endif
+        collector.clear();
+#endif
     }
 }
\ No newline at end of file
@@ -0,0 +1,106 @@
+/**
+ * @file AD7124Bus.cpp
+ * @brief Implementation of the AD7124Bus class.
+ */
+
+#include "adc/AD7124Bus.h"
+#include "interfaces/ReadingQueue.h"
+
+#if defined(CLOCK_SYNC)
+#include "timing/NodeClock.h"
+#endif
+
+#if defined(LATENCY_STATS)
+#include "pipeline/LatencyStats.h"
+#endif
+
+#include <new>
+
+AD7124Bus& AD7124Bus::getInstance(int spi_frequency, unsigned int devices) {
+    static AD7124Bus instance(spi_frequency, devices);
+    return instance;
+}
+
+/**
+ * @details
+ * Every chip select is driven high before the first device is configured,
+ * so a device never sees the register writes meant for another one. Device
+ * 0 is configured first, as the others switch to its clock.
+ */
+AD7124Bus::AD7124Bus(int spi_frequency, unsigned int devices)
+    : m_sync(AD7124_SYNC_PIN, 1), m_spi(AD7124_MOSI_PIN, AD7124_DRDY_PIN, AD7124_SCLK_PIN),
+      m_devices(devices < DEVICE_SCHEDULER_MAX_DEVICES ? devices : DEVICE_SCHEDULER_MAX_DEVICES),
+      m_device{}, m_dropped_frames(0) {
+    AD7124::setup_spi(m_spi, spi_frequency);
+
+    const PinName cs_pins[DEVICE_SCHEDULER_MAX_DEVICES] = AD7124_BUS_CS_PINS;
+    for (unsigned int i = 0; i < m_devices; i++) {
+        uint8_t clock_select = (i == 0) ? AD7124_CLOCK_INTERNAL_OUTPUT : AD7124_CLOCK_EXTERNAL;
+        m_device[i] = new (m_device_storage[i]) AD7124(m_spi, cs_pins[i], clock_select, true);
+    }
+    for (unsigned int i = 0; i < m_devices; i++) {
+        m_device[i]->init(true, true);
+    }
+
+    synchronize();
+}
+
+/**
+ * @details
+ * While SYNC is low the modulators and digital filters of all devices are
+ * held in reset; they start the first conversion on the rising edge.
+ */
+void AD7124Bus::synchronize(void) {
+    m_sync = 0;
+    wait_us(AD7124_SYNC_PULSE_US);
+    m_sync = 1;
+}
+
+/**
+ * @details
+ * The scheduler is static, as with `ZERO_HEAP` its collectors would take a
+ * large part of this thread's stack.
+ */
+void AD7124Bus::read_voltage_from_all_devices(unsigned int vector_size) {
+    static DeviceScheduler<AD7124> scheduler(m_device, m_devices, vector_size);
+
+    while (true) {
+        int device = scheduler.poll();
+        if (device == DEVICE_SCHEDULER_NONE) {
+            continue;
+        }
+        send_data_to_main_thread(scheduler.collector(device).ch0(), scheduler.collector(device).ch1(), device);
+        scheduler.clear(device);
+    }
+}
+
+/**
+ * @details
+ * Unlike the single-device loop this never waits for the main thread: the
+ * other devices would keep converting meanwhile and their results would be
+ * overwritten before they are read. A frame that finds the mailbox full is
+ * dropped and counted instead.
+ */
+bool AD7124Bus::send_data_to_main_thread(const SampleVector& ch0, const SampleVector& ch1, unsigned int device) {
+#if defined(LATENCY_STATS)
+    uint32_t start_us = LatencyStats::now_us();
+#endif
+    ReadingQueue& reading_queue = ReadingQueue::getInstance();
+    ReadingQueue::mail_t* mail = reading_queue.mail_box.try_alloc();
+    if (mail == nullptr) {
+        m_dropped_frames++;
+        return false;
+    }
+
+    mail->ch0 = ch0;
+    mail->ch1 = ch1;
+    mail->device = (uint8_t)device;
+#if defined(CLOCK_SYNC)
+    mail->time_us = node_clock_us();
+#endif
+    reading_queue.mail_box.put(mail);
+#if defined(LATENCY_STATS)
+    LatencyStats::getInstance().record(LATENCY_STAGE_HANDOFF, start_us);
+#endif
+    return true;
+}
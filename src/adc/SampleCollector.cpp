@@ -0,0 +1,63 @@
+/**
+ * @file SampleCollector.cpp
+ * @brief Implementation of the SampleCollector class.
+ */
+
+#include "adc/SampleCollector.h"
+
+/**
+ * @details
+ * With `ZERO_HEAP` the channels have a fixed capacity, so larger frame sizes
+ * are clamped to `SAMPLE_VECTOR_CAPACITY`.
+ */
+SampleCollector::SampleCollector(unsigned int vector_size) : m_vector_size(vector_size) {
+#if defined(ZERO_HEAP)
+    if (m_vector_size > SAMPLE_VECTOR_CAPACITY) {
+        m_vector_size = SAMPLE_VECTOR_CAPACITY;
+    }
+#endif
+    m_ch0.reserve(m_vector_size);
+    m_ch1.reserve(m_vector_size);
+}
+
+/**
+ * @brief Routes a conversion word to its channel.
+ *
+ * @details
+ * Status values other than 0 and 1 (e.g. a word read while the ADC was not
+ * ready) are ignored, exactly like the original acquisition loop did.
+ */
+bool SampleCollector::push(const uint8_t word[AD7124_CONVERSION_WORD_SIZE]) {
+    if (word[3] == 0) {
+        append(m_ch0, word);
+    } else if (word[3] == 1) {
+        append(m_ch1, word);
+    }
+    return full();
+}
+
+bool SampleCollector::full(void) const {
+    return (m_ch0.size() >= m_vector_size) && (m_ch1.size() >= m_vector_size);
+}
+
+unsigned int SampleCollector::size(void) const {
+    return (unsigned int)(m_ch0.size() < m_ch1.size() ? m_ch0.size() : m_ch1.size());
+}
+
+void SampleCollector::clear(void) {
+    m_ch0.clear();
+    m_ch1.clear();
+}
+
+/**
+ * @brief Appends a sample, replacing the oldest one if the channel is full.
+ * @param channel Sample vector of the addressed channel.
+ * @param word Conversion word holding the sample.
+ */
+void SampleCollector::append(SampleVector& channel, const uint8_t word[AD7124_CONVERSION_WORD_SIZE]) {
+    if (channel.size() >= m_vector_size) {
+        // Replace the oldest value with the new value (circular buffer approach)
+        channel.erase(channel.begin());
+    }
+    channel.push_back(sample_from_bytes(word));
+}
@@ -0,0 +1,153 @@
+/**
+ * @file TriggerEngine.cpp
+ * @brief Implementation of the TriggerEngine class.
+ */
+
+#include "adc/TriggerEngine.h"
+
+#include <cstdlib>
+
+/**
+ * @details
+ * The frame size is clamped to `SAMPLE_VECTOR_CAPACITY` with `ZERO_HEAP`,
+ * and the pre-trigger window to the ring and to one sample less than a
+ * frame, so the window opened by a detection always fits into the first
+ * frame.
+ */
+TriggerEngine::TriggerEngine(const TriggerSettings& settings)
+    : m_settings(settings), m_detector{}, m_ring{}, m_ring_head(0), m_ring_size(0), m_active(false),
+      m_hold(0), m_idle(0), m_onset(false), m_detectors(0), m_stats{0, 0, 0, 0, 0, 0, 0} {
+    if (m_settings.frame_samples == 0) {
+        m_settings.frame_samples = 1;
+    }
+#if defined(ZERO_HEAP)
+    if (m_settings.frame_samples > SAMPLE_VECTOR_CAPACITY) {
+        m_settings.frame_samples = SAMPLE_VECTOR_CAPACITY;
+    }
+#endif
+    if (m_settings.pre_samples > TRIGGER_PRE_CAPACITY) {
+        m_settings.pre_samples = TRIGGER_PRE_CAPACITY;
+    }
+    if (m_settings.pre_samples >= m_settings.frame_samples) {
+        m_settings.pre_samples = m_settings.frame_samples - 1;
+    }
+    if (m_settings.baseline_shift > 16) {
+        m_settings.baseline_shift = 16;
+    }
+    m_out_ch0.reserve(m_settings.frame_samples);
+    m_out_ch1.reserve(m_settings.frame_samples);
+}
+
+/**
+ * @details
+ * A detection while idle opens the event window with the ring contents,
+ * oldest first. Each detection inside the window extends it by
+ * `post_samples`. A heartbeat empties the ring, so no pair is sent twice.
+ */
+TriggerOutput TriggerEngine::push(int32_t ch0, int32_t ch1) {
+    m_stats.pairs++;
+    m_onset = false;
+    m_detectors = detect(m_detector[0], ch0) | detect(m_detector[1], ch1);
+
+    if (!m_active && m_detectors != 0) {
+        unsigned int index = (m_ring_head + TRIGGER_PRE_CAPACITY - m_ring_size) % TRIGGER_PRE_CAPACITY;
+        for (unsigned int i = 0; i < m_ring_size; i++) {
+            append(m_ring[index][0], m_ring[index][1]);
+            index = (index + 1) % TRIGGER_PRE_CAPACITY;
+        }
+        m_ring_size = 0;
+        m_active = true;
+        m_onset = true;
+        m_stats.events++;
+        m_stats.threshold_onsets += (m_detectors & TRIGGER_DETECTOR_THRESHOLD) ? 1 : 0;
+        m_stats.slope_onsets += (m_detectors & TRIGGER_DETECTOR_SLOPE) ? 1 : 0;
+        m_stats.baseline_onsets += (m_detectors & TRIGGER_DETECTOR_BASELINE) ? 1 : 0;
+    }
+
+    if (m_active) {
+        append(ch0, ch1);
+        m_hold = (m_detectors != 0) ? m_settings.post_samples : m_hold - 1;
+        if (m_hold == 0) {
+            m_active = false;
+            m_idle = 0;
+            return TRIGGER_EVENT;
+        }
+        return (m_out_ch0.size() >= m_settings.frame_samples) ? TRIGGER_EVENT : TRIGGER_NONE;
+    }
+
+    if (m_settings.pre_samples > 0) {
+        m_ring[m_ring_head] = Pair{ch0, ch1};
+        m_ring_head = (m_ring_head + 1) % TRIGGER_PRE_CAPACITY;
+        if (m_ring_size < m_settings.pre_samples) {
+            m_ring_size++;
+        }
+    }
+
+    m_idle++;
+    if (m_settings.heartbeat_samples > 0 && m_idle >= m_settings.heartbeat_samples) {
+        m_out_ch0.push_back(ch0);
+        m_out_ch1.push_back(ch1);
+        m_ring_size = 0;
+        m_idle = 0;
+        m_stats.heartbeats++;
+        return TRIGGER_HEARTBEAT;
+    }
+    return TRIGGER_NONE;
+}
+
+void TriggerEngine::clear(void) {
+    m_out_ch0.clear();
+    m_out_ch1.clear();
+}
+
+/**
+ * @brief Runs the three detectors on one code and updates the channel state.
+ * @return `TRIGGER_DETECTOR_*` bits that fired.
+ *
+ * @details
+ * The baseline and its mean absolute deviation are integer exponential
+ * moving averages, kept scaled by 2^shift so no precision is lost. The
+ * baseline detector stays silent until 2^shift samples have been seen, as
+ * the deviation starts at zero. The first sample only seeds the state.
+ */
+uint8_t TriggerEngine::detect(Detector& detector, int32_t code) const {
+    uint8_t fired = 0;
+    const unsigned int shift = m_settings.baseline_shift;
+
+    if (m_settings.threshold_codes > 0 && std::abs(code - m_settings.zero_code) >= m_settings.threshold_codes) {
+        fired |= TRIGGER_DETECTOR_THRESHOLD;
+    }
+
+    if (detector.samples == 0) {
+        detector.mean_acc = (int64_t)code << shift;
+        detector.dev_acc = 0;
+    } else if (m_settings.slope_codes > 0 && std::abs(code - detector.last) >= m_settings.slope_codes) {
+        fired |= TRIGGER_DETECTOR_SLOPE;
+    }
+    detector.last = code;
+
+    if (m_settings.baseline_k > 0) {
+        int32_t mean = (int32_t)(detector.mean_acc >> shift);
+        int32_t dev = (int32_t)(detector.dev_acc >> shift);
+        int32_t deviation = std::abs(code - mean);
+        if (detector.samples >= (1u << shift) && deviation >= m_settings.baseline_floor_codes &&
+            (int64_t)deviation > (int64_t)m_settings.baseline_k * dev) {
+            fired |= TRIGGER_DETECTOR_BASELINE;
+        }
+        // Four times slower inside an event window
+        int shift_extra = m_active ? 2 : 0;
+        detector.mean_acc += (int64_t)(code - mean) >> shift_extra;
+        detector.dev_acc += (int64_t)(deviation - dev) >> shift_extra;
+    }
+
+    if (detector.samples < UINT32_MAX) {
+        detector.samples++;
+    }
+    return fired;
+}
+
+void TriggerEngine::append(int32_t ch0, int32_t ch1) {
+    m_out_ch0.push_back(ch0);
+    m_out_ch1.push_back(ch1);
+    m_stats.event_pairs++;
+}
@@ -0,0 +1,86 @@
+/**
+ * @file CaptureRecorder.cpp
+ * @brief Implementation of the CaptureRecorder class for SPI-level captures.
+ */
+
+#include "capture/CaptureRecorder.h"
+#include "serial_mail_sender/SerialMailSender.h"
+#include "utils/logger.h"
+
+#include <chrono>
+
+/**
+ * @brief Access the singleton instance of CaptureRecorder.
+ *
+ * @return Reference to the single instance of CaptureRecorder.
+ */
+CaptureRecorder& CaptureRecorder::getInstance(void) {
+    static CaptureRecorder instance;
+    return instance;
+}
+
+/**
+ * @brief Constructs a CaptureRecorder instance.
+ *
+ * The writer thread runs below normal priority so the link never preempts the
+ * acquisition or the regular frame transmission.
+ */
+CaptureRecorder::CaptureRecorder(void)
+    : m_writer_thread(osPriorityBelowNormal, OS_STACK_SIZE, nullptr, "capture"),
+      m_current(nullptr), m_words(0), m_last_record_us(0), m_dropped_words(0) {
+}
+
+void CaptureRecorder::start(void) {
+    m_timer.start();
+    m_writer_thread.start(callback(this, &CaptureRecorder::writerLoop));
+    INFO("Capture of SPI conversion words started.");
+}
+
+/**
+ * @brief Adds a word to the current record and hands full records to the writer.
+ *
+ * @details
+ * A record slot is allocated lazily with `try_alloc`. The delta timestamp is
+ * taken when the first word of a record arrives, so it matches the time of the
+ * first conversion in the batch.
+ */
+void CaptureRecorder::recordWord(const uint8_t word[4]) {
+    if (m_current == nullptr) {
+        m_current = m_mail_box.try_alloc();
+        if (m_current == nullptr) {
+            m_dropped_words++;
+            return;
+        }
+        uint64_t now_us = std::chrono::duration_cast<std::chrono::microseconds>(m_timer.elapsed_time()).count();
+        m_current->header.marker = CAPTURE_RECORD_MARKER;
+        m_current->header.kind = CAPTURE_KIND_SPI_WORDS;
+        m_current->header.delta_us = (uint32_t)(now_us - m_last_record_us);
+        m_last_record_us = now_us;
+        m_words = 0;
+    }
+
+    memcpy(&m_current->payload[m_words * 4], word, 4);
+    m_words++;
+
+    if (m_words == CAPTURE_WORDS_PER_RECORD) {
+        m_current->header.length = sizeof(m_current->payload);
+        m_current->header.checksum = capture_checksum(m_current->payload, sizeof(m_current->payload));
+        m_mail_box.put(m_current);
+        m_current = nullptr;
+    }
+}
+
+/**
+ * @brief Sends finished records over the serial link.
+ */
+void CaptureRecorder::writerLoop(void) {
+    while (true) {
+        record_t* record = m_mail_box.try_get_for(rtos::Kernel::Clock::duration_u32::max());
+        if (record) {
+            SerialMailSender::getInstance().sendRaw(
+                reinterpret_cast<const uint8_t*>(record),
+                sizeof(CaptureRecordHeader) + record->header.length, TRAFFIC_BULK);
+            m_mail_box.free(record);
+        }
+    }
+}
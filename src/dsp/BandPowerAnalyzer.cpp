@@ -0,0 +1,102 @@
+/**
+ * @file BandPowerAnalyzer.cpp
+ * @brief Implementation of the BandPowerAnalyzer class.
+ */
+
+#include "dsp/BandPowerAnalyzer.h"
+
+#include <cmath>
+#include <cstring>
+
+/**
+ * @details
+ * Bin 0 (DC) is never used. Bin `N / 2` exists only for even `N` and has no
+ * mirror image, so its power is not doubled.
+ */
+BandPowerAnalyzer::BandPowerAnalyzer(unsigned int window_samples, float rate_sps, const float* edges_hz,
+                                     unsigned int bands)
+    : m_window(window_samples > 1 ? window_samples : 2), m_bins(0), m_coeff{}, m_scale{}, m_band{} {
+    if (bands > BAND_POWER_MAX_BANDS) {
+        bands = BAND_POWER_MAX_BANDS;
+    }
+    const double pi = 3.14159265358979323846;
+    const double resolution_hz = (double)rate_sps / m_window;
+    const double norm = 1.0 / ((double)m_window * m_window);
+
+    for (unsigned int band = 0; band < bands; band++) {
+        bool last = band + 1 == bands;
+        for (unsigned int k = 1; k <= m_window / 2 && m_bins < BAND_POWER_MAX_BINS; k++) {
+            double f = k * resolution_hz;
+            if (f < edges_hz[band] || f > edges_hz[band + 1] || (f == edges_hz[band + 1] && !last)) {
+                continue;
+            }
+            m_coeff[m_bins] = (float)(2.0 * cos(2.0 * pi * k / m_window));
+            m_scale[m_bins] = (float)((2 * k == m_window ? 1.0 : 2.0) * norm);
+            m_band[m_bins] = (uint8_t)band;
+            m_bins++;
+        }
+    }
+
+    memset(m_s1, 0, sizeof(m_s1));
+    memset(m_s2, 0, sizeof(m_s2));
+    memset(m_offset, 0, sizeof(m_offset));
+    memset(m_count, 0, sizeof(m_count));
+    memset(m_done, 0, sizeof(m_done));
+    memset(&m_powers, 0, sizeof(m_powers));
+    m_powers.bands = bands;
+}
+
+/**
+ * @details
+ * One resonator step per bin, `s = x + c s1 - s2`; the loop over the bins
+ * has no dependencies between iterations, so it pipelines well on an FPU.
+ */
+bool BandPowerAnalyzer::push(unsigned int channel, float millivolts) {
+    if (channel >= BAND_POWER_CHANNELS) {
+        return false;
+    }
+    if (m_count[channel] == 0) {
+        m_offset[channel] = millivolts;
+    }
+    const float x = millivolts - m_offset[channel];
+    float* s1 = m_s1[channel];
+    float* s2 = m_s2[channel];
+    for (unsigned int i = 0; i < m_bins; i++) {
+        float s = x + m_coeff[i] * s1[i] - s2[i];
+        s2[i] = s1[i];
+        s1[i] = s;
+    }
+
+    if (++m_count[channel] < m_window) {
+        return false;
+    }
+    finish(channel);
+    if (m_done[0] != m_done[1]) {
+        return false;
+    }
+    m_powers.window = m_done[channel] - 1;
+    return true;
+}
+
+/**
+ * @brief Turns the resonator states of a channel into band powers and restarts it.
+ *
+ * @details
+ * After N samples `|X_k|^2 = s1^2 + s2^2 - c s1 s2`.
+ */
+void BandPowerAnalyzer::finish(unsigned int channel) {
+    float* power = m_powers.power[channel];
+    for (unsigned int band = 0; band < m_powers.bands; band++) {
+        power[band] = 0;
+    }
+    float* s1 = m_s1[channel];
+    float* s2 = m_s2[channel];
+    for (unsigned int i = 0; i < m_bins; i++) {
+        float magnitude = s1[i] * s1[i] + s2[i] * s2[i] - m_coeff[i] * s1[i] * s2[i];
+        power[m_band[i]] += magnitude * m_scale[i];
+        s1[i] = 0;
+        s2[i] = 0;
+    }
+    m_count[channel] = 0;
+    m_done[channel]++;
+}
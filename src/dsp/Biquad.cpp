@@ -0,0 +1,87 @@
+/**
+ * @file Biquad.cpp
+ * @brief Implementation of the portable biquad kernels.
+ */
+
+#include "dsp/Biquad.h"
+
+/**
+ * @details
+ * Each section accumulates its five products in 64 bits and keeps the
+ * accumulator shifted right by `31 - BIQUAD_POST_SHIFT`, truncated, as its
+ * output; the next section reads it as input. Like the CMSIS-DSP kernel, the
+ * output wraps instead of saturating, so the input needs headroom.
+ */
+void biquad_cascade_q31(const BiquadQ31* sections, unsigned int count, int32_t* state,
+                        const int32_t* in, int32_t* out, size_t samples) {
+    const int shift = 31 - BIQUAD_POST_SHIFT;
+    for (unsigned int s = 0; s < count; s++) {
+        const BiquadQ31& c = sections[s];
+        int32_t* st = state + s * BIQUAD_STATE_SIZE;
+        int32_t x1 = st[0];
+        int32_t x2 = st[1];
+        int32_t y1 = st[2];
+        int32_t y2 = st[3];
+        const int32_t* src = s == 0 ? in : out;
+        for (size_t i = 0; i < samples; i++) {
+            int32_t x = src[i];
+            int64_t acc = (int64_t)c.b0 * x + (int64_t)c.b1 * x1 + (int64_t)c.b2 * x2 +
+                          (int64_t)c.a1 * y1 + (int64_t)c.a2 * y2;
+            int32_t y = (int32_t)(acc >> shift);
+            x2 = x1;
+            x1 = x;
+            y2 = y1;
+            y1 = y;
+            out[i] = y;
+        }
+        st[0] = x1;
+        st[1] = x2;
+        st[2] = y1;
+        st[3] = y2;
+    }
+}
+
+/**
+ * @brief Product of a Q63 value and a Q31 coefficient in Q62, as `mult32x64` of CMSIS-DSP.
+ */
+static inline int64_t multiply_wide(int64_t x, int32_t c) {
+    int64_t low = (int64_t)(((int64_t)(x & 0xFFFFFFFF) * c) >> 32);
+    int64_t high = (x >> 32) * c;
+    return low + high;
+}
+
+/**
+ * @details
+ * The accumulator holds the input products in Q62 and the feedback products
+ * of the Q63 output history shifted down to Q62. Shifted left by
+ * `BIQUAD_POST_SHIFT + 1` it becomes the next Q63 output, whose upper half
+ * is the Q31 result.
+ */
+void biquad_cascade_wide_q31(const BiquadQ31* sections, unsigned int count, int64_t* state,
+                             const int32_t* in, int32_t* out, size_t samples) {
+    const int shift = BIQUAD_POST_SHIFT + 1;
+    for (unsigned int s = 0; s < count; s++) {
+        const BiquadQ31& c = sections[s];
+        int64_t* st = state + s * BIQUAD_STATE_SIZE;
+        int32_t x1 = (int32_t)st[0];
+        int32_t x2 = (int32_t)st[1];
+        int64_t y1 = st[2];
+        int64_t y2 = st[3];
+        const int32_t* src = s == 0 ? in : out;
+        for (size_t i = 0; i < samples; i++) {
+            int32_t x = src[i];
+            int64_t acc = (int64_t)x * c.b0 + (int64_t)x1 * c.b1 + (int64_t)x2 * c.b2 +
+                          multiply_wide(y1, c.a1) + multiply_wide(y2, c.a2);
+            int64_t y = (int64_t)((uint64_t)acc << shift);
+            x2 = x1;
+            x1 = x;
+            y2 = y1;
+            y1 = y;
+            out[i] = (int32_t)(y >> 32);
+        }
+        st[0] = x1;
+        st[1] = x2;
+        st[2] = y1;
+        st[3] = y2;
+    }
+}
@@ -0,0 +1,125 @@
+/**
+ * @file MainsFilter.cpp
+ * @brief Implementation of the MainsFilter class.
+ */
+
+#include "dsp/MainsFilter.h"
+
+#include <cstring>
+
+MainsFilter::MainsFilter(const MainsFilterDesign& design, unsigned int vector_size)
+    : m_vector_size(vector_size), m_decimation(design.decimation < 1 ? 1 : design.decimation),
+      m_section_count(design.section_count < MAINS_FILTER_MAX_SECTIONS ? design.section_count
+                                                                       : MAINS_FILTER_MAX_SECTIONS),
+      m_has_highpass(design.has_highpass), m_highpass(design.highpass) {
+    memcpy(m_sections, design.sections, sizeof(m_sections));
+    memset(m_highpass_state, 0, sizeof(m_highpass_state));
+    memset(m_state, 0, sizeof(m_state));
+    memset(m_primed, 0, sizeof(m_primed));
+    memset(m_phase, 0, sizeof(m_phase));
+
+#if defined(CMSIS_DSP)
+    for (unsigned int channel = 0; channel < MAINS_FILTER_CHANNELS; channel++) {
+        arm_biquad_cas_df1_32x64_init_q31(&m_highpass_instance[channel], 1,
+                                          reinterpret_cast<q31_t*>(&m_highpass), m_highpass_state[channel],
+                                          BIQUAD_POST_SHIFT);
+        arm_biquad_cascade_df1_init_q31(&m_cascade_instance[channel], m_section_count,
+                                        reinterpret_cast<q31_t*>(m_sections), m_state[channel],
+                                        BIQUAD_POST_SHIFT);
+    }
+#endif
+}
+
+/**
+ * @details
+ * The high-pass sees a constant input, which it blocks completely: inputs
+ * at `x`, outputs at 0. The notches and low-pass sections pass it with a
+ * gain of 1, so they start at `x` if there is no high-pass and at 0 behind
+ * it.
+ */
+void MainsFilter::prime(unsigned int channel, int32_t x) {
+    int64_t* wide = m_highpass_state[channel];
+    wide[0] = x;
+    wide[1] = x;
+    wide[2] = 0;
+    wide[3] = 0;
+    const int32_t settled = m_has_highpass ? 0 : x;
+    int32_t* state = m_state[channel];
+    for (unsigned int i = 0; i < m_section_count * BIQUAD_STATE_SIZE; i++) {
+        state[i] = settled;
+    }
+    m_primed[channel] = true;
+}
+
+/**
+ * @details
+ * Samples are processed in blocks of `MAINS_FILTER_BLOCK`, the kernels
+ * working in place on `m_block`.
+ */
+void MainsFilter::process(unsigned int channel, const int32_t* in, int32_t* out, size_t count) {
+    if (channel >= MAINS_FILTER_CHANNELS || count == 0) {
+        return;
+    }
+    constexpr int32_t max_sample = SAMPLE_ZERO_CODE - 1;
+    constexpr int32_t min_sample = -SAMPLE_ZERO_CODE;
+    constexpr int32_t rounding = 1 << (MAINS_FILTER_HEADROOM_BITS - 1);
+
+    if (!m_primed[channel]) {
+        prime(channel, (int32_t)((uint32_t)in[0] << MAINS_FILTER_HEADROOM_BITS));
+    }
+
+    for (size_t done = 0; done < count; done += MAINS_FILTER_BLOCK) {
+        size_t block = count - done < MAINS_FILTER_BLOCK ? count - done : MAINS_FILTER_BLOCK;
+        for (size_t i = 0; i < block; i++) {
+            m_block[i] = (int32_t)((uint32_t)in[done + i] << MAINS_FILTER_HEADROOM_BITS);
+        }
+
+#if defined(CMSIS_DSP)
+        if (m_has_highpass) {
+            arm_biquad_cas_df1_32x64_q31(&m_highpass_instance[channel], m_block, m_block, (uint32_t)block);
+        }
+        if (m_section_count > 0) {
+            arm_biquad_cascade_df1_q31(&m_cascade_instance[channel], m_block, m_block, (uint32_t)block);
+        }
+#else
+        if (m_has_highpass) {
+            biquad_cascade_wide_q31(&m_highpass, 1, m_highpass_state[channel], m_block, m_block, block);
+        }
+        biquad_cascade_q31(m_sections, m_section_count, m_state[channel], m_block, m_block, block);
+#endif
+
+        for (size_t i = 0; i < block; i++) {
+            int32_t sample = (int32_t)(((int64_t)m_block[i] + rounding) >> MAINS_FILTER_HEADROOM_BITS);
+            out[done + i] = sample > max_sample ? max_sample : sample < min_sample ? min_sample : sample;
+        }
+    }
+}
+
+/**
+ * @brief Filters the samples of one channel and keeps the last of every `decimation`.
+ */
+void MainsFilter::decimate(unsigned int channel, const SampleVector& in, SampleVector& out) {
+    for (size_t done = 0; done < in.size(); done += MAINS_FILTER_BLOCK) {
+        size_t block = in.size() - done < MAINS_FILTER_BLOCK ? in.size() - done : MAINS_FILTER_BLOCK;
+        process(channel, in.data() + done, m_filtered, block);
+        for (size_t i = 0; i < block; i++) {
+            if (++m_phase[channel] == m_decimation) {
+                m_phase[channel] = 0;
+                if (out.size() < m_vector_size) {
+                    out.push_back(m_filtered[i]);
+                }
+            }
+        }
+    }
+}
+
+bool MainsFilter::push(const SampleVector& ch0, const SampleVector& ch1) {
+    decimate(0, ch0, m_ch0);
+    decimate(1, ch1, m_ch1);
+    return m_ch0.size() >= m_vector_size && m_ch1.size() >= m_vector_size;
+}
+
+void MainsFilter::clear(void) {
+    m_ch0.clear();
+    m_ch1.clear();
+}
@@ -9,7 +9,51 @@
  * - Modify the following variables in `mbed-os/connectivity/FEATURE_BLE/source/cordio/mbed_lib.json`:
  *   - `"desired-att-mtu": 250`
  *   - `"rx-acl-buffer-size": 255`
+ *   These are required by the BLE transport (`TRANSPORT_BLE`) to fill 247-byte notifications.
  * - Avoid using pins `PB_6` and `PB_7`, as they are reserved for `CONSOLE_TX` and `CONSOLE_RX`.
+ * - With `STORE_AND_FORWARD`, the Raspberry Pi must drive `PA_8` (D6) high while its logger runs;
+ *   frames are kept in internal flash whenever it is low.
+ * - With `ZERO_HEAP`, all pipeline buffers are static and any heap allocation after startup
+ *   halts the node; the static RAM of every pipeline stage is logged at startup.
+ * - With `RAW_FRAMES`, frames carry a fixed little-endian header with a sequence number and
+ *   the packed samples instead of a FlatBuffer (see serial_mail_sender/FrameFormat.h).
+ * - With `ADAPTIVE_BATCHING`, frames carry between `batch_min_samples` and
+ *   `batch_max_samples` of the preset, depending on the link backlog; the host
+ *   must not assume a fixed number of samples per frame.
+ * - With `EVENT_TRIGGER`, only event windows (pre-trigger samples, the event and
+ *   `trigger_post_samples` after it) are sent, cut into frames of `vector_size`,
+ *   plus frames of a single heartbeat sample while the plant is quiet.
+ * - With `BAND_POWER`, band power frames (see serial_mail_sender/FrameFormat.h) carry the
+ *   power of the preset's frequency bands once per analysis window; with `BAND_POWER_ONLY`
+ *   they replace the sample frames.
+ * - With `MAINS_FILTER`, both channels are cleared of electrode drift and mains hum (50 Hz and
+ *   its harmonics) by the preset's fixed-point biquad cascade before framing, and only one of
+ *   every `mains_decimation` filtered samples is sent (see dsp/MainsFilter.h). Frames keep
+ *   `vector_size` samples, so they come `mains_decimation` times less often; the host must
+ *   take the sample rate as the preset's divided by it. Add `CMSIS_DSP` and link CMSIS-DSP
+ *   to run the biquads with its Cortex-M kernels.
+ * - With a preset of several devices (`PhytoConfig::devices`, e.g. `8CH_50SPS`), the
+ *   AD7124 share the SPI bus with chip selects `PA_4`, `PA_9`, `PC_6` and `PA_10`, SYNC
+ *   (`PA_1`) and the CLK pin of device 0; MISO needs a pull-up. Every frame carries the
+ *   channels of one device and its index (see serial_mail_sender/FrameFormat.h).
+ * - With `CLOCK_SYNC` (requires `RAW_FRAMES`), the node answers the sync requests of the
+ *   Raspberry Pi on the UART RX line (PC_0) and stamps every frame with the host time of its
+ *   last sample (see timing/ClockSync.h); frames carry 0 until two exchanges completed.
+ * - With `LATENCY_STATS`, the ADC wait, hand-off, build and UART drain stages are timed
+ *   into latency histograms, sent as latency frames every 10 s (see pipeline/LatencyStats.h).
+ * - With `TX_SCHEDULER`, the UART sends frames by traffic class (see transport/TxScheduler.h):
+ *   sync responses before samples before status and bulk data. A status message with the
+ *   counters of every class is sent every 10 s (not with `EVENT_PIPELINE`).
+ * - With `WARM_RESTART`, a watchdog resets the node if the main loop stalls for 2 s. Frames
+ *   not yet written to the UART, the sequence number and the ADC registers survive the reset
+ *   in no-init RAM (see pipeline/WarmRestart.h): the node sends 512 zero bytes, then the kept
+ *   frames, and resumes the running ADC without reprogramming it. Up to the 256 bytes in the
+ *   serial driver may still be lost, and the frame cut off by the reset may arrive once with
+ *   a zero-filled tail ahead of its complete copy.
+ * - With `SELF_BENCHMARK`, the node does not run the preset: it steps through SPI clocks, filter
+ *   words and frame sizes for about 3 minutes, then sends the table of sustained rates as a
+ *   message every 10 s (see pipeline/SelfBenchmark.h); `phyto_self_bench_sim` runs the same sweep
+ *   on the host.
  */
 
 // *** Third-Party Library Headers ***
@@ -17,30 +61,349 @@
 
 // *** Project-Specific Headers ***
 #include "adc/AD7124.h"
+#include "adc/AD7124Bus.h"
+#include "config/PipelineConfig.h"
 #include "interfaces/ReadingQueue.h"
 #include "serial_mail_sender/SerialMailSender.h"
+#include "transport/UartTransport.h"
+#include "utils/logger.h"
+
+#if defined(TRANSPORT_BLE)
+#include "transport/BleTransport.h"
+#endif
+
+#if defined(EVENT_PIPELINE)
+#include "pipeline/EventPipeline.h"
+#endif
+
+#if defined(PIPELINE_STATS)
+#include "pipeline/PipelineStats.h"
+#endif
+
+#if defined(ZERO_HEAP)
+#include "adc/SampleCollector.h"
+#include "pipeline/HeapGuard.h"
+#endif
+
+#if defined(ZERO_HEAP) && defined(MAINS_FILTER)
+#include "dsp/MainsFilter.h"
+#endif
+
+#if defined(LATENCY_STATS)
+#include "pipeline/LatencyStats.h"
+#endif
+
+#if defined(BAND_POWER)
+#include "serial_mail_sender/BandFrameBuilder.h"
+#endif
+
+#if defined(CLOCK_SYNC)
+#include "timing/ClockSync.h"
+#include "timing/NodeClock.h"
+#endif
+
+#if defined(TX_SCHEDULER)
+#include "hal/us_ticker_api.h"
+#include "transport/TxScheduler.h"
+#endif
+
+#if defined(WARM_RESTART)
+#include "pipeline/WarmRestart.h"
+#endif
+
+#if defined(SELF_BENCHMARK)
+#include "pipeline/SelfBenchmark.h"
+#endif
+
+#if defined(STORE_AND_FORWARD)
+#include "FlashIAPBlockDevice.h"
+#include "storage/BlockDeviceStorage.h"
+#include "storage/FlashRingLog.h"
+#endif
 
 // *** DEFINE GLOBAL CONSTANTS ***
 
-/// Downsampling rate for ADC readings in milliseconds.
-#define DOWNSAMPLING_RATE 1 // ms
+// Frame size, node id, SPI clock, ADC registers and conversion constants come
+// from `PhytoConfig` (config/PipelineConfig.h), selected with `PHYTO_PRESET`.
+
+/// Longest time the sinks go without being serviced while no mail arrives.
+#define SINK_SERVICE_PERIOD 5ms
+
+static_assert(MailFrameBuilder::maxFrameSize<PhytoConfig::vector_size>() <= FRAME_BUFFER_CAPACITY,
+              "Frames of the selected preset do not fit into FRAME_BUFFER_CAPACITY");
+
+#if defined(BAND_POWER_ONLY) && !defined(BAND_POWER)
+#error "BAND_POWER_ONLY requires BAND_POWER"
+#endif
+
+#if defined(CLOCK_SYNC) && !defined(RAW_FRAMES)
+#error "CLOCK_SYNC requires RAW_FRAMES"
+#endif
+
+#if defined(CLOCK_SYNC) && defined(EVENT_PIPELINE)
+#error "CLOCK_SYNC is not supported by the EVENT_PIPELINE"
+#endif
+
+#if defined(LATENCY_STATS) && defined(EVENT_PIPELINE)
+#error "LATENCY_STATS is not supported by the EVENT_PIPELINE"
+#endif
+
+#if defined(WARM_RESTART) && defined(EVENT_PIPELINE)
+#error "WARM_RESTART is not supported by the EVENT_PIPELINE"
+#endif
+
+#if defined(WARM_RESTART) && defined(TX_SCHEDULER)
+#error "WARM_RESTART does not retain the frames of the TX_SCHEDULER"
+#endif
+
+#if defined(SELF_BENCHMARK) && (defined(EVENT_PIPELINE) || defined(WARM_RESTART))
+#error "SELF_BENCHMARK measures the polling pipeline without the watchdog"
+#endif
+
+#if defined(MAINS_FILTER) && (defined(EVENT_TRIGGER) || defined(ADAPTIVE_BATCHING))
+#error "MAINS_FILTER sends frames of vector_size and cannot be combined with EVENT_TRIGGER or ADAPTIVE_BATCHING"
+#endif
+
+#if defined(MAINS_FILTER) && (defined(EVENT_PIPELINE) || defined(SELF_BENCHMARK))
+#error "MAINS_FILTER runs in the reading thread of the polling pipeline"
+#endif
+
+#if defined(CMSIS_DSP) && !defined(MAINS_FILTER)
+#error "CMSIS_DSP selects the kernels of MAINS_FILTER"
+#endif
+
+#if defined(BAND_POWER)
+static_assert(PhytoConfig::band_count <= BAND_POWER_MAX_BANDS, "Too many bands for a band power frame");
+static_assert(BAND_FRAME_MAX_SIZE <= FRAME_BUFFER_CAPACITY, "Band power frames do not fit into FRAME_BUFFER_CAPACITY");
+#endif
+
+#if defined(EVENT_PIPELINE) || defined(EVENT_TRIGGER) || defined(ADAPTIVE_BATCHING) || defined(BAND_POWER) || \
+    defined(CAPTURE_SPI_WORDS) || defined(SELF_BENCHMARK) || defined(MAINS_FILTER)
+static_assert(PhytoConfig::devices == 1, "The selected options support a single AD7124 only");
+#endif
+
+#if defined(ADAPTIVE_BATCHING)
+static_assert(MailFrameBuilder::maxFrameSize<PhytoConfig::batch_max_samples>() <= FRAME_BUFFER_CAPACITY,
+              "The largest adaptive frame does not fit into FRAME_BUFFER_CAPACITY");
+#endif
 
-/// Conversion constants for ADC readings.
-#define DATABITS 8388608
-#define VREF 2.5
-#define GAIN 4.0
+#if defined(CLOCK_SYNC)
+/// Bytes read from the UART per service call.
+#define CLOCK_SYNC_READ_SIZE 32
 
-/// SPI frequency for ADC communication in Hz.
-#define SPI_FREQUENCY 10000000 // 10 MHz max 64 MhZ
+/// Finds the sync requests of the Raspberry Pi in the received bytes.
+SyncRequestParser sync_parser;
 
-/// Number of values to collect in each channel vector before sending mail.
-#define VECTOR_SIZE 10
+/// Offset and skew of the node clock against the Raspberry Pi.
+ClockSync clock_sync;
+#endif
 
-/// Node identifier for serial communication.
-#define NODE 3
+#if defined(STORE_AND_FORWARD)
+/// Start of the internal flash area holding the backlog, above the application image.
+#define FLASH_LOG_START 0x08080000
 
+/// Size of the backlog area (64 pages of 4 KB, below the BLE stack of the NUCLEO_WB55RG).
+#define FLASH_LOG_SIZE (256 * 1024)
+
+/// Backlog bytes forwarded per service call, i.e. at most 6.4 kB/s at a 5 ms service period.
+#define FLASH_LOG_DRAIN_BUDGET 32
+
+/// Internal flash area used by the backlog.
+FlashIAPBlockDevice flash_log_device(FLASH_LOG_START, FLASH_LOG_SIZE);
+BlockDeviceStorage flash_log_storage(flash_log_device);
+FlashRingLog flash_log(flash_log_storage);
+#endif
+
+#if defined(TX_SCHEDULER)
+/// Interval between two status messages.
+#define TX_STATUS_PERIOD 10s
+
+/// Largest status message.
+#define TX_STATUS_SIZE 512
+
+/// Orders the frames on the UART by traffic class.
+TxScheduler uart_scheduler;
+
+/// Status message, unchanged until its last chunk was published.
+char tx_status[TX_STATUS_SIZE];
+
+/// Names of the traffic classes in the status message.
+static const char* const traffic_class_names[TRAFFIC_CLASS_COUNT] = {"control", "samples", "status", "bulk"};
+
+/**
+ * @brief Microsecond clock of the scheduler's rate caps.
+ */
+static uint32_t scheduler_clock_us(void) {
+    return us_ticker_read();
+}
+
+/**
+ * @brief Sends the counters of the UART and its traffic classes as a status message.
+ *
+ * @details
+ * The previous message must be completely published, since its text is
+ * overwritten; otherwise this period is skipped.
+ */
+static void send_status(SerialMailSender& serial_mail_sender, const UartTransport& uart_transport) {
+    if (serial_mail_sender.messagePending(TRAFFIC_STATUS)) {
+        return;
+    }
+
+    const FrameSinkStats& sink = uart_transport.stats();
+    int size = snprintf(tx_status, sizeof(tx_status),
+                        "uart accepted=%lu dropped=%lu sent=%lu bytes=%lu pool_drops=%lu\n",
+                        (unsigned long)sink.accepted, (unsigned long)sink.dropped, (unsigned long)sink.sent,
+                        (unsigned long)sink.bytes, (unsigned long)serial_mail_sender.droppedFrames());
+    for (size_t i = 0; i < TRAFFIC_CLASS_COUNT && size < (int)sizeof(tx_status); i++) {
+        const TxClassStats& stats = uart_scheduler.stats((TrafficClass)i);
+        size += snprintf(tx_status + size, sizeof(tx_status) - size,
+                         "%s accepted=%lu dropped=%lu sent=%lu bytes=%lu queued=%u\n", traffic_class_names[i],
+                         (unsigned long)stats.accepted, (unsigned long)stats.dropped, (unsigned long)stats.sent,
+                         (unsigned long)stats.bytes, (unsigned int)uart_scheduler.queued((TrafficClass)i));
+    }
+    if (size > (int)sizeof(tx_status) - 1) {
+        size = sizeof(tx_status) - 1;
+    }
+    serial_mail_sender.sendMessage(TRAFFIC_STATUS, MESSAGE_KIND_STATUS, reinterpret_cast<const uint8_t*>(tx_status),
+                                   (size_t)size, PhytoConfig::node);
+}
+#endif
+
+#if defined(ZERO_HEAP) && !defined(EVENT_PIPELINE)
+/// Stack of the reading thread, static instead of allocated by `Thread::start`.
+MBED_ALIGN(8) unsigned char reading_data_stack[OS_STACK_SIZE];
+
+/// Thread for reading data from ADC.
+Thread reading_data_thread(osPriorityNormal, OS_STACK_SIZE, reading_data_stack, "reading");
+#else
 /// Thread for reading data from ADC.
 Thread reading_data_thread;
+#endif
+
+#if defined(ZERO_HEAP)
+/**
+ * @brief Logs the statically allocated RAM of every pipeline stage.
+ *
+ * @details
+ * Only objects with static storage (or, for the collector, a fixed place on
+ * the reading stack) are listed; with `ZERO_HEAP` they hold every pipeline
+ * buffer, so the sum is the pipeline's complete steady-state footprint apart
+ * from the stack of the main thread.
+ */
+static void print_static_ram_footprint(void) {
+#if defined(EVENT_PIPELINE)
+    // Queue buffers and the acquisition stack are members of the pipeline
+    size_t acquisition = sizeof(SampleCollector) + sizeof(EventPipeline);
+    size_t handoff = 0;
+#else
+    size_t acquisition = sizeof(SampleCollector) + sizeof(reading_data_stack);
+    size_t handoff = sizeof(ReadingQueue);
+    if (PhytoConfig::devices > 1) {
+        acquisition += sizeof(AD7124Bus) + sizeof(DeviceScheduler<AD7124>) - sizeof(SampleCollector);
+    }
+#endif
+#if defined(MAINS_FILTER)
+    acquisition += sizeof(MainsFilter);
+#endif
+    size_t serialization = sizeof(MailFrameBuilder) + sizeof(FramePool);
+    size_t transport = sizeof(FrameDispatcher) + sizeof(UartTransport);
+#if defined(TRANSPORT_BLE)
+    transport += sizeof(BleTransport);
+#endif
+    size_t storage = 0;
+#if defined(STORE_AND_FORWARD)
+    storage += sizeof(flash_log_device) + sizeof(flash_log_storage) + sizeof(flash_log);
+#endif
+#if defined(LATENCY_STATS)
+    // Not a pipeline stage; listed so the total stays the complete footprint
+    transport += sizeof(LatencyStats);
+#endif
+#if defined(TX_SCHEDULER)
+    transport += sizeof(uart_scheduler) + sizeof(tx_status);
+#endif
+#if defined(WARM_RESTART)
+    storage += sizeof(RetainedArea);
+#endif
+
+    INFO("Static RAM per pipeline stage:");
+    INFO("\tAcquisition (collector, thread stack, event queues): %u bytes", (unsigned int)acquisition);
+    INFO("\tHand-off (reading queue): %u bytes", (unsigned int)handoff);
+    INFO("\tSerialization (builder arena, %d frame buffers): %u bytes", FRAME_POOL_SIZE, (unsigned int)serialization);
+    INFO("\tTransport (dispatcher, sinks): %u bytes", (unsigned int)transport);
+    INFO("\tStorage (flash log, retained RAM): %u bytes", (unsigned int)storage);
+    INFO("\tTotal: %u bytes", (unsigned int)(acquisition + handoff + serialization + transport + storage));
+}
+#endif
+
+#if defined(WARM_RESTART)
+/**
+ * @brief Keeps every following UART frame in retained RAM, after sending those kept across a warm reset.
+ *
+ * @details
+ * The zero bytes first complete a frame the reset cut off, so the host finds
+ * the next marker; they are queued before the UART retains frames, so a
+ * later reset does not send them twice. Every kept frame is queued again,
+ * which retains a new copy, before its old record is released; the sink is
+ * drained in between, as its queue is shorter than the ring.
+ */
+static void retain_uart_frames(WarmRestart& warm_restart, SerialMailSender& serial_mail_sender,
+                                   UartTransport& uart_transport) {
+    RetainedState& retained = warm_restart.state();
+    if (!warm_restart.warm()) {
+        uart_transport.attachRetained(retained);
+        return;
+    }
+
+    static const uint8_t resync[WARM_RESTART_RESYNC_SIZE] = {0};
+    serial_mail_sender.sendRaw(resync, sizeof(resync));
+    uart_transport.attachRetained(retained);
+
+    for (size_t i = retained.recovered(); i > 0; i--) {
+        size_t size = 0;
+        const uint8_t* frame = retained.front(&size);
+        if (frame == nullptr) {
+            break;
+        }
+        while (uart_transport.linkUp() && !uart_transport.canAccept(TRAFFIC_SAMPLES)) {
+            serial_mail_sender.service();
+            warm_restart.kick();
+        }
+        serial_mail_sender.sendRaw(frame, size, TRAFFIC_SAMPLES);
+        retained.pop();
+    }
+}
+#endif
+
+#if defined(CLOCK_SYNC)
+/**
+ * @brief Answers the sync requests received since the last call.
+ *
+ * @details
+ * The host sends a request at once, so its first byte arrived at the time
+ * reported by `readSome` plus the bytes in front of it in the same read. T2
+ * is the arrival of its last byte, T3 is taken right before the response is
+ * queued. A late arrival time or a response waiting behind frames lengthens
+ * the measured delay, which `ClockSync` filters out.
+ */
+static void service_clock_sync(UartTransport& uart_transport, SerialMailSender& serial_mail_sender) {
+    static uint64_t request_start_us = 0;
+    uint8_t received[CLOCK_SYNC_READ_SIZE];
+    uint64_t received_us;
+    size_t count = uart_transport.readSome(received, sizeof(received), &received_us);
+    for (size_t i = 0; i < count; i++) {
+        if (!sync_parser.receiving()) {
+            request_start_us = received_us + i * UART_BYTE_TIME_NS / 1000;
+        }
+        if (!sync_parser.feed(received[i])) {
+            continue;
+        }
+        uint64_t t2_us = request_start_us + (SERIAL_MAIL_HEADER_SIZE + SYNC_REQUEST_SIZE - 1) * UART_BYTE_TIME_NS / 1000;
+        uint8_t response[SERIAL_MAIL_HEADER_SIZE + SYNC_RESPONSE_SIZE];
+        SyncResponse answer = clock_sync.respond(sync_parser.request(), t2_us, node_clock_us(), PhytoConfig::node);
+        serial_mail_sender.sendRaw(response, write_sync_response(answer, response, sizeof(response)));
+    }
+}
+#endif
 
 /**
  * @brief Reads data from the ADC and processes it.
@@ -48,10 +411,17 @@ Thread reading_data_thread;
  * This function runs in the `reading_data_thread` and continuously reads
  * voltage data from both ADC channels. The processed data is stored in the
  * ReadingQueue for inter-thread communication.
+ *
+ * With several devices, all of them are read through the `AD7124Bus`.
  */
 void get_input_model_values_from_adc(void) {
-    AD7124& adc = AD7124::getInstance(SPI_FREQUENCY);
-    adc.read_voltage_from_both_channels(DOWNSAMPLING_RATE, VECTOR_SIZE);
+    if (PhytoConfig::devices > 1) {
+        AD7124Bus& bus = AD7124Bus::getInstance(PhytoConfig::spi_frequency, PhytoConfig::devices);
+        bus.read_voltage_from_all_devices(PhytoConfig::vector_size);
+    } else {
+        AD7124& adc = AD7124::getInstance(PhytoConfig::spi_frequency);
+        adc.read_voltage_from_both_channels(PhytoConfig::downsampling_rate, PhytoConfig::vector_size);
+    }
 }
 
 /**
@@ -60,39 +430,172 @@ void get_input_model_values_from_adc(void) {
  * Initializes the ADC reading thread and continuously retrieves
  * processed data from the ReadingQueue. The data is then sent
  * over a serial connection using the SerialMailSender.
+ *
+ * With `EVENT_PIPELINE`, the main thread instead dispatches the output events
+ * of the `EventPipeline` and no reading thread is created; with `SELF_BENCHMARK`
+ * it runs the `SelfBenchmark` sweep.
  * 
  * @return 0 on successful execution.
  */
 int main() {	
+#if defined(WARM_RESTART)
+    // Checks the retained RAM before anything is queued
+    WarmRestart& warm_restart = WarmRestart::getInstance();
+    warm_restart.startWatchdog();
+#endif
+
+    // Register the sinks that receive every frame
+    SerialMailSender& serial_mail_sender = SerialMailSender::getInstance();
+    UartTransport& uart_transport = UartTransport::getInstance();
+
+#if defined(STORE_AND_FORWARD)
+    // Keep frames in flash while the Raspberry Pi is not listening
+    if (flash_log_storage.init() == 0 && flash_log.mount() == 0) {
+        uart_transport.attachBacklog(flash_log, FLASH_LOG_DRAIN_BUDGET);
+    } else {
+        WARN("Flash log unavailable, frames are dropped while the link is down.");
+    }
+#endif
+
+    serial_mail_sender.addSink(uart_transport);
+
+#if defined(WARM_RESTART)
+#if defined(RAW_FRAMES)
+    serial_mail_sender.attachRetained(warm_restart.state());
+#endif
+    // Resend the frames kept across a warm reset, then keep every frame until the UART took it
+    retain_uart_frames(warm_restart, serial_mail_sender, uart_transport);
+#endif
+
+#if defined(TX_SCHEDULER)
+    // Samples overtake status and bulk frames on the UART
+    uart_transport.attachScheduler(uart_scheduler, &scheduler_clock_us);
+    Kernel::Clock::time_point next_status = Kernel::Clock::now() + TX_STATUS_PERIOD;
+#endif
+
+#if defined(LATENCY_STATS)
+    // Time from queueing a frame until its last byte went to the serial driver
+    LatencyStats& latency_stats = LatencyStats::getInstance();
+    uart_transport.attachLatencyHistogram(latency_stats.histogram(LATENCY_STAGE_UART_DRAIN), &LatencyStats::now_us);
+    Kernel::Clock::time_point next_latency_report = Kernel::Clock::now() + LATENCY_STATS_REPORT_PERIOD;
+#endif
+
+#if defined(TRANSPORT_BLE)
+    // Also send frames as BLE notifications
+    BleTransport& ble_transport = BleTransport::getInstance();
+    ble_transport.start();
+    serial_mail_sender.addSink(ble_transport);
+#endif
+
+#if defined(ZERO_HEAP)
+    print_static_ram_footprint();
+#endif
+
+#if defined(EVENT_PIPELINE)
+    // Acquisition, framing and transmission as events; never returns
+    EventPipeline::getInstance().run(AD7124::getInstance(PhytoConfig::spi_frequency),
+                                     PhytoConfig::vector_size, PhytoConfig::node, SINK_SERVICE_PERIOD);
+#endif
+
+#if defined(SELF_BENCHMARK)
+    // Sweep instead of the preset, then report; never returns
+    SelfBenchmark::getInstance().run(AD7124::getInstance(PhytoConfig::spi_frequency), serial_mail_sender,
+                                     uart_transport, PhytoConfig::node);
+#endif
+
     // Start reading data from ADC thread
     reading_data_thread.start(callback(get_input_model_values_from_adc));
 
+#if defined(PIPELINE_STATS)
+    PipelineStats& pipeline_stats = PipelineStats::getInstance();
+    Kernel::Clock::time_point next_report = Kernel::Clock::now() + PIPELINE_STATS_REPORT_PERIOD;
+#endif
+
+#if defined(ZERO_HEAP)
+    HeapGuard& heap_guard = HeapGuard::getInstance();
+    Kernel::Clock::time_point next_heap_check = Kernel::Clock::now() + HEAP_GUARD_CHECK_PERIOD;
+#endif
+
     while (true) {
         // Access the shared ReadingQueue instance
         ReadingQueue& reading_queue = ReadingQueue::getInstance();
 
-        // Wait indefinitely for mail
-        auto mail = reading_queue.mail_box.try_get_for(rtos::Kernel::Clock::duration_u32::max());
+        // Wait for mail, but wake up regularly so slow sinks keep draining
+        auto mail = reading_queue.mail_box.try_get_for(SINK_SERVICE_PERIOD);
+
+#if defined(WARM_RESTART)
+        warm_restart.kick();
+        warm_restart.report();
+#endif
+
+#if defined(PIPELINE_STATS)
+        pipeline_stats.recordWakeup();
+        if (Kernel::Clock::now() >= next_report) {
+            pipeline_stats.report();
+            next_report += PIPELINE_STATS_REPORT_PERIOD;
+        }
+#endif
+#if defined(LATENCY_STATS)
+        if (Kernel::Clock::now() >= next_latency_report) {
+            latency_stats.report(PhytoConfig::node);
+            next_latency_report += LATENCY_STATS_REPORT_PERIOD;
+        }
+#endif
+#if defined(TX_SCHEDULER)
+        if (Kernel::Clock::now() >= next_status) {
+            send_status(serial_mail_sender, uart_transport);
+            next_status += TX_STATUS_PERIOD;
+        }
+#endif
         if (mail) {
             // Retrieve the message from the mail box
             ReadingQueue::mail_t* reading_mail = mail;
 
             auto ch0_values = reading_mail->ch0;
             auto ch1_values = reading_mail->ch1;
+            unsigned int device = reading_mail->device;
+#if defined(CLOCK_SYNC)
+            uint64_t time_us = clock_sync.toHostTime(reading_mail->time_us);
+#else
+            uint64_t time_us = 0;
+#endif
 
             // Free the allocated mail to avoid memory leaks
             reading_queue.mail_box.free(reading_mail); 
-            
-            // Access the serial mail sender
-            SerialMailSender& serial_mail_sender = SerialMailSender::getInstance();
+
+#if defined(PIPELINE_STATS)
+            pipeline_stats.recordFrame();
+#endif
 
             // Send serial mail
             serial_mail_sender.sendMail(
                 ch0_values,
                 ch1_values,
-                NODE
+                PhytoConfig::node,
+                device,
+                time_us
             );
+
+#if defined(ZERO_HEAP)
+            // The first frame ends startup, the ADC is initialized by then
+            if (!heap_guard.armed()) {
+                heap_guard.arm();
+            }
+#endif
+        } else {
+            serial_mail_sender.service();
+        }
+
+#if defined(CLOCK_SYNC)
+        service_clock_sync(uart_transport, serial_mail_sender);
+#endif
+
+#if defined(ZERO_HEAP)
+        if (Kernel::Clock::now() >= next_heap_check) {
+            heap_guard.check();
+            next_heap_check += HEAP_GUARD_CHECK_PERIOD;
         }
+#endif
     }
 
     // main() is expected to loop forever.
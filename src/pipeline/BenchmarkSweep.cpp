@@ -0,0 +1,146 @@
+/**
+ * @file BenchmarkSweep.cpp
+ * @brief Implementation of the self-benchmark sweep and its table.
+ */
+
+#include "pipeline/BenchmarkSweep.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "config/PipelineConfig.h"
+
+/// Column names of the table.
+static const char* const benchmark_columns =
+    "spi_hz,power_mode,filter_fs,vector_size,expected_sps,conversions_sps,missed,errors,frames,frame_drops,"
+    "cpu_pct,uart_pct,sustained\n";
+
+size_t benchmark_points(BenchmarkPoint* points, size_t capacity, unsigned int max_vector_size) {
+    size_t count = 0;
+    for (uint16_t filter_fs : BENCHMARK_FILTER_FS) {
+        for (int spi_frequency : BENCHMARK_SPI_FREQUENCIES) {
+            for (unsigned int vector_size : BENCHMARK_VECTOR_SIZES) {
+                if (vector_size > max_vector_size || count == capacity) {
+                    continue;
+                }
+                points[count++] = {spi_frequency, AD7124_POWER_MODE_FULL, filter_fs, vector_size};
+            }
+        }
+    }
+    return count;
+}
+
+BenchmarkResult evaluate_benchmark(const BenchmarkPoint& point, const BenchmarkCounters& counters, int baudrate) {
+    BenchmarkResult result;
+    result.point = point;
+    // Both channels convert in turn, each at the rate of the filter word
+    result.expected_sps = 2 * ad7124_rate_sps(point.power_mode, 2, point.filter_fs);
+    float elapsed_s = counters.elapsed_us > 0 ? counters.elapsed_us / 1e6f : 1.0f;
+    result.conversions_sps = counters.conversions / elapsed_s;
+    result.missed = counters.missed;
+    result.errors = counters.errors;
+    result.frames = counters.frames;
+    result.frame_drops = counters.frame_drops;
+    result.cpu_pct = counters.elapsed_us > 0 ? 100.0f * counters.busy_us / counters.elapsed_us : 0.0f;
+    result.uart_pct = baudrate > 0 ? 100.0f * counters.uart_bytes * 10 / (baudrate * elapsed_s) : 0.0f;
+    result.sustained = counters.errors == 0 && counters.frame_drops == 0 &&
+                       (uint64_t)counters.missed * 100 <= (uint64_t)counters.conversions * BENCHMARK_MAX_MISSED_PCT &&
+                       result.conversions_sps * 100 >= (float)result.expected_sps * BENCHMARK_MIN_RATE_PCT &&
+                       result.uart_pct < BENCHMARK_MAX_UART_PCT;
+    return result;
+}
+
+size_t best_sustained(const BenchmarkResult* results, size_t count) {
+    size_t best = count;
+    for (size_t i = 0; i < count; i++) {
+        if (!results[i].sustained) {
+            continue;
+        }
+        if (best == count || results[i].expected_sps > results[best].expected_sps ||
+            (results[i].expected_sps == results[best].expected_sps && results[i].cpu_pct < results[best].cpu_pct)) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief Clamps the return value of `snprintf` to what was written.
+ */
+static size_t written(int size, size_t capacity) {
+    if (size < 0 || capacity == 0) {
+        return 0;
+    }
+    return (size_t)size < capacity ? (size_t)size : capacity - 1;
+}
+
+size_t format_benchmark_header(const char* source, char* out, size_t capacity) {
+    return written(snprintf(out, capacity, "# self-benchmark %s, %d ms per point\n%s", source, BENCHMARK_POINT_MS,
+                            benchmark_columns),
+                   capacity);
+}
+
+size_t format_benchmark_row(const BenchmarkResult& result, char* out, size_t capacity) {
+    return written(snprintf(out, capacity, "%d,%u,%u,%u,%lu,%.1f,%lu,%lu,%lu,%lu,%.1f,%.1f,%d\n",
+                            result.point.spi_frequency, (unsigned int)result.point.power_mode,
+                            (unsigned int)result.point.filter_fs, result.point.vector_size,
+                            (unsigned long)result.expected_sps, (double)result.conversions_sps,
+                            (unsigned long)result.missed, (unsigned long)result.errors, (unsigned long)result.frames,
+                            (unsigned long)result.frame_drops, (double)result.cpu_pct, (double)result.uart_pct,
+                            result.sustained ? 1 : 0),
+                   capacity);
+}
+
+size_t format_benchmark_summary(const BenchmarkResult* results, size_t count, char* out, size_t capacity) {
+    size_t best = best_sustained(results, count);
+    if (best == count) {
+        return written(snprintf(out, capacity, "# max sustainable: none\n"), capacity);
+    }
+    const BenchmarkResult& result = results[best];
+    return written(snprintf(out, capacity,
+                            "# max sustainable: %lu sps (%lu per channel) at spi_hz=%d filter_fs=%u vector_size=%u\n",
+                            (unsigned long)result.expected_sps, (unsigned long)(result.expected_sps / 2),
+                            result.point.spi_frequency, (unsigned int)result.point.filter_fs,
+                            result.point.vector_size),
+                   capacity);
+}
+
+bool parse_benchmark_row(const char* line, BenchmarkResult* result) {
+    unsigned long fields[13];
+    float rates[3];
+    char* end = nullptr;
+    const char* cursor = line;
+    for (int i = 0; i < 13; i++) {
+        // Columns 5, 10 and 11 are decimals, the others integers
+        if (i == 5 || i == 10 || i == 11) {
+            rates[i == 5 ? 0 : i - 9] = strtof(cursor, &end);
+        } else {
+            fields[i] = strtoul(cursor, &end, 10);
+        }
+        if (end == cursor) {
+            return false;
+        }
+        cursor = end;
+        if (i < 12) {
+            if (*cursor != ',') {
+                return false;
+            }
+            cursor++;
+        }
+    }
+    if (*cursor != '\0' && *cursor != '\n' && *cursor != '\r') {
+        return false;
+    }
+
+    result->point = {(int)fields[0], (uint8_t)fields[1], (uint16_t)fields[2], (unsigned int)fields[3]};
+    result->expected_sps = (uint32_t)fields[4];
+    result->conversions_sps = rates[0];
+    result->missed = (uint32_t)fields[6];
+    result->errors = (uint32_t)fields[7];
+    result->frames = (uint32_t)fields[8];
+    result->frame_drops = (uint32_t)fields[9];
+    result->cpu_pct = rates[1];
+    result->uart_pct = rates[2];
+    result->sustained = fields[12] != 0;
+    return true;
+}
@@ -0,0 +1,251 @@
+/**
+ * @file EventPipeline.cpp
+ * @brief Implementation of the event-driven acquisition and output pipeline.
+ */
+
+#include "pipeline/EventPipeline.h"
+#include "serial_mail_sender/SerialMailSender.h"
+#include "utils/logger.h"
+
+#if defined(CAPTURE_SPI_WORDS)
+#include "capture/CaptureRecorder.h"
+#endif
+
+#if defined(PIPELINE_STATS)
+#include "pipeline/PipelineStats.h"
+#endif
+
+#if defined(ZERO_HEAP)
+#include "pipeline/HeapGuard.h"
+#endif
+
+#if defined(BAND_POWER)
+#include "config/PipelineConfig.h"
+#include "utils/ConversionKernel.h"
+#endif
+
+/**
+ * @brief Access the singleton instance of EventPipeline.
+ *
+ * @return Reference to the single instance of EventPipeline.
+ */
+EventPipeline& EventPipeline::getInstance(void) {
+    static EventPipeline instance;
+    return instance;
+}
+
+#if defined(ZERO_HEAP)
+EventPipeline::EventPipeline(void)
+    : m_adc(nullptr), m_collector(nullptr),
+#if defined(EVENT_TRIGGER)
+      m_trigger(nullptr),
+#elif defined(ADAPTIVE_BATCHING)
+      m_batcher(nullptr),
+#endif
+#if defined(BAND_POWER)
+      m_band_power(nullptr),
+#endif
+      m_node(0), m_drdy(AD7124_DRDY_PIN),
+      m_acquisition_queue(PIPELINE_ACQUISITION_QUEUE_SIZE, m_acquisition_buffer),
+      m_output_queue(PIPELINE_OUTPUT_QUEUE_SIZE, m_output_buffer),
+      m_acquisition_thread(PIPELINE_ACQUISITION_PRIORITY, PIPELINE_ACQUISITION_STACK_SIZE, m_acquisition_stack, "acquisition"),
+      m_drdy_us(0), m_dropped_frames(0) {
+}
+#else
+EventPipeline::EventPipeline(void)
+    : m_adc(nullptr), m_collector(nullptr),
+#if defined(EVENT_TRIGGER)
+      m_trigger(nullptr),
+#elif defined(ADAPTIVE_BATCHING)
+      m_batcher(nullptr),
+#endif
+#if defined(BAND_POWER)
+      m_band_power(nullptr),
+#endif
+      m_node(0), m_drdy(AD7124_DRDY_PIN),
+      m_acquisition_queue(PIPELINE_ACQUISITION_QUEUE_SIZE),
+      m_output_queue(PIPELINE_OUTPUT_QUEUE_SIZE),
+      m_acquisition_thread(PIPELINE_ACQUISITION_PRIORITY, PIPELINE_ACQUISITION_STACK_SIZE, nullptr, "acquisition"),
+      m_drdy_us(0), m_dropped_frames(0) {
+}
+#endif
+
+/**
+ * @brief Starts the acquisition thread and turns the calling thread into the output dispatcher.
+ *
+ * @details
+ * The collector lives on this stack frame, which never returns. With
+ * `ADAPTIVE_BATCHING` it is sized for the batcher's largest frame and
+ * `vector_size` is only the initial frame size. With `EVENT_TRIGGER` the
+ * collector only pairs the words and the trigger engine, also on this
+ * stack frame, cuts event frames of `vector_size`. The band power analyzer
+ * of `BAND_POWER` is static, like in the polling loop. With
+ * `ZERO_HEAP` the heap guard is armed once everything is started and checked
+ * from the output queue.
+ */
+void EventPipeline::run(AD7124& adc, unsigned int vector_size, int node, std::chrono::milliseconds service_period) {
+#if defined(EVENT_TRIGGER)
+    SampleCollector collector(1);
+    TriggerEngine trigger(trigger_settings<PhytoConfig>(vector_size));
+    m_trigger = &trigger;
+#elif defined(ADAPTIVE_BATCHING)
+    m_batcher = &SerialMailSender::getInstance().batcher();
+    SampleCollector collector(m_batcher->maxSamples());
+#else
+    SampleCollector collector(vector_size);
+#endif
+#if defined(BAND_POWER)
+    static BandPowerAnalyzer band_power(
+        PhytoConfig::band_window,
+        (float)ad7124_rate_sps(PhytoConfig::power_mode, PhytoConfig::channels, PhytoConfig::filter_fs),
+        PhytoConfig::band_edges_hz, PhytoConfig::band_count);
+    m_band_power = &band_power;
+#endif
+    m_adc = &adc;
+    m_collector = &collector;
+    m_node = node;
+
+#if defined(CAPTURE_SPI_WORDS)
+    CaptureRecorder::getInstance().start();
+#endif
+
+    m_acquisition_thread.start(callback(&m_acquisition_queue, &EventQueue::dispatch_forever));
+    m_output_queue.call_every(service_period, callback(this, &EventPipeline::serviceSinks));
+#if defined(PIPELINE_STATS)
+    m_output_queue.call_every(PIPELINE_STATS_REPORT_PERIOD, callback(&PipelineStats::getInstance(), &PipelineStats::report));
+#endif
+
+    m_drdy.fall(callback(this, &EventPipeline::onDrdy));
+    INFO("Event pipeline started.");
+
+#if defined(ZERO_HEAP)
+    HeapGuard::getInstance().arm();
+    m_output_queue.call_every(HEAP_GUARD_CHECK_PERIOD, callback(&HeapGuard::getInstance(), &HeapGuard::check));
+#endif
+
+    m_output_queue.dispatch_forever();
+}
+
+/**
+ * @brief DRDY interrupt: timestamps the edge and defers the SPI read.
+ *
+ * @details
+ * DRDY shares the pin with MISO, so the interrupt stays disabled until the
+ * read event has clocked the word out; otherwise the data bits would trigger
+ * further interrupts.
+ */
+void EventPipeline::onDrdy(void) {
+    m_drdy.disable_irq();
+#if defined(PIPELINE_STATS)
+    m_drdy_us = PipelineStats::now_us();
+#endif
+    m_acquisition_queue.call(this, &EventPipeline::readConversion);
+}
+
+/**
+ * @brief Reads one conversion word and posts a frame once the collector is full.
+ *
+ * @details
+ * With `ADAPTIVE_BATCHING` the frame is instead posted once the batcher
+ * declares it due, checked after every complete sample pair. With
+ * `EVENT_TRIGGER` every complete pair goes to the trigger engine, and its
+ * output window is posted whenever it holds an event frame or a heartbeat.
+ * With `BAND_POWER` each completed analysis window is posted as well, and
+ * with `BAND_POWER_ONLY` nothing else.
+ *
+ * If DRDY is already low again when the interrupt is re-enabled, the next
+ * conversion finished during this event and its edge was missed; the read is
+ * then posted directly.
+ */
+void EventPipeline::readConversion(void) {
+#if defined(PIPELINE_STATS)
+    PipelineStats& stats = PipelineStats::getInstance();
+    stats.recordWakeup();
+    stats.recordConversion(PipelineStats::now_us() - m_drdy_us);
+#endif
+
+    uint8_t data[4] = {0, 0, 0, 255};
+    m_adc->read_conversion_word(data);
+
+#if defined(CAPTURE_SPI_WORDS)
+    CaptureRecorder::getInstance().recordWord(data);
+#endif
+
+#if defined(BAND_POWER)
+    if (m_band_power->push(data[3], sample_to_millivolts<PhytoConfig>(sample_from_bytes(data)))) {
+        if (m_output_queue.call(this, &EventPipeline::sendBandPowers, m_band_power->powers()) == 0) {
+            m_dropped_frames++;
+        }
+    }
+#endif
+
+#if defined(EVENT_TRIGGER)
+    bool frame_ready = false;
+    if (m_collector->push(data)) {
+        frame_ready = m_trigger->push(m_collector->ch0()[0], m_collector->ch1()[0]) != TRIGGER_NONE;
+        m_collector->clear();
+    }
+#elif defined(ADAPTIVE_BATCHING)
+    if (m_collector->ch0().empty() && m_collector->ch1().empty()) {
+        m_batch_start = Kernel::Clock::now();
+    }
+    m_collector->push(data);
+    uint32_t age_ms = (uint32_t)(Kernel::Clock::now() - m_batch_start).count();
+    bool frame_ready = m_collector->paired() && m_batcher->due(m_collector->size(), age_ms);
+#else
+    bool frame_ready = m_collector->push(data);
+#endif
+
+#if defined(EVENT_TRIGGER)
+    if (frame_ready) {
+#if !defined(BAND_POWER_ONLY)
+        if (m_output_queue.call(this, &EventPipeline::sendFrame, m_trigger->ch0(), m_trigger->ch1()) == 0) {
+            m_dropped_frames++;
+        }
+#endif
+        m_trigger->clear();
+    }
+#else
+    if (frame_ready) {
+#if !defined(BAND_POWER_ONLY)
+        if (m_output_queue.call(this, &EventPipeline::sendFrame, m_collector->ch0(), m_collector->ch1()) == 0) {
+            m_dropped_frames++;
+        }
+#endif
+        m_collector->clear();
+    }
+#endif
+
+    m_drdy.enable_irq();
+    if (m_drdy.read() == 0) {
+        m_drdy.disable_irq();
+#if defined(PIPELINE_STATS)
+        m_drdy_us = PipelineStats::now_us();
+#endif
+        m_acquisition_queue.call(this, &EventPipeline::readConversion);
+    }
+}
+
+void EventPipeline::sendFrame(SampleVector ch0, SampleVector ch1) {
+#if defined(PIPELINE_STATS)
+    PipelineStats::getInstance().recordWakeup();
+    PipelineStats::getInstance().recordFrame();
+#endif
+    SerialMailSender::getInstance().sendMail(ch0, ch1, m_node);
+}
+
+#if defined(BAND_POWER)
+void EventPipeline::sendBandPowers(BandPowers powers) {
+#if defined(PIPELINE_STATS)
+    PipelineStats::getInstance().recordWakeup();
+#endif
+    SerialMailSender::getInstance().sendBandPowers(powers, m_node);
+}
+#endif
+
+void EventPipeline::serviceSinks(void) {
+#if defined(PIPELINE_STATS)
+    PipelineStats::getInstance().recordWakeup();
+#endif
+    SerialMailSender::getInstance().service();
+}
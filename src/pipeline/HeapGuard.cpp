@@ -0,0 +1,54 @@
+/**
+ * @file HeapGuard.cpp
+ * @brief Implementation of the HeapGuard class.
+ */
+
+#include "pipeline/HeapGuard.h"
+#include "utils/logger.h"
+
+/**
+ * @brief Access the singleton instance of HeapGuard.
+ *
+ * @return Reference to the single instance of HeapGuard.
+ */
+HeapGuard& HeapGuard::getInstance(void) {
+    static HeapGuard instance;
+    return instance;
+}
+
+HeapGuard::HeapGuard(void) : m_armed(false), m_total_size(0), m_alloc_fail_cnt(0) {
+}
+
+void HeapGuard::arm(void) {
+    mbed_stats_heap_t heap_info;
+    mbed_stats_heap_get(&heap_info);
+    m_total_size = heap_info.total_size;
+    m_alloc_fail_cnt = heap_info.alloc_fail_cnt;
+    m_armed = true;
+    INFO("Heap guard armed: %lu bytes in %lu blocks allocated during startup.",
+         heap_info.current_size, heap_info.alloc_cnt);
+}
+
+/**
+ * @brief Fails hard on any allocation after `arm`.
+ *
+ * @details
+ * `total_size` only grows, so an allocation that was freed again before the
+ * check is caught as well. Failed allocations do not change `total_size` and
+ * are compared separately.
+ */
+void HeapGuard::check(void) {
+    if (!m_armed) {
+        return;
+    }
+
+    mbed_stats_heap_t heap_info;
+    mbed_stats_heap_get(&heap_info);
+    uint32_t allocated = heap_info.total_size - m_total_size;
+    uint32_t failed = heap_info.alloc_fail_cnt - m_alloc_fail_cnt;
+    if (allocated != 0 || failed != 0) {
+        ERROR("Heap used after startup: %lu bytes allocated, %lu allocations failed.", allocated, failed);
+        MBED_ERROR(MBED_MAKE_ERROR(MBED_MODULE_APPLICATION, MBED_ERROR_CODE_OUT_OF_MEMORY),
+                   "Heap allocation in ZERO_HEAP steady state");
+    }
+}
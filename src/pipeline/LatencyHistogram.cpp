@@ -0,0 +1,60 @@
+/**
+ * @file LatencyHistogram.cpp
+ * @brief Implementation of the LatencyHistogram snapshot and quantile estimate.
+ */
+
+#include "pipeline/LatencyHistogram.h"
+
+LatencyHistogram::LatencyHistogram(void) : m_max_us(0) {
+    for (std::atomic<uint32_t>& count : m_counts) {
+        count.store(0, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @details
+ * A latency recorded while the buckets are exchanged may land in this
+ * snapshot while its maximum only reaches the next one; the maximum is
+ * therefore raised to the lower bound of the highest non-empty bucket.
+ */
+void LatencyHistogram::snapshot(LatencySnapshot& snapshot) {
+    snapshot.max_us = m_max_us.exchange(0, std::memory_order_relaxed);
+    snapshot.total = 0;
+    size_t highest = 0;
+    for (size_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+        snapshot.counts[i] = m_counts[i].exchange(0, std::memory_order_relaxed);
+        snapshot.total += snapshot.counts[i];
+        if (snapshot.counts[i] != 0) {
+            highest = i;
+        }
+    }
+    if (snapshot.total != 0 && snapshot.max_us < latency_bucket_lower(highest)) {
+        snapshot.max_us = latency_bucket_lower(highest);
+    }
+}
+
+uint32_t latency_percentile(const LatencySnapshot& snapshot, double fraction) {
+    if (snapshot.total == 0) {
+        return 0;
+    }
+
+    // Rank of the quantile, counted from 1
+    double rank = fraction * snapshot.total;
+    uint32_t target = rank < 1 ? 1 : (uint32_t)rank;
+    if (target < rank) {
+        target++;
+    }
+    if (target > snapshot.total) {
+        target = snapshot.total;
+    }
+
+    uint32_t seen = 0;
+    for (size_t i = 0; i < LATENCY_HISTOGRAM_OVERFLOW; i++) {
+        seen += snapshot.counts[i];
+        if (seen >= target) {
+            uint32_t midpoint = latency_bucket_lower(i) + (latency_bucket_width(i) - 1) / 2;
+            return midpoint < snapshot.max_us ? midpoint : snapshot.max_us;
+        }
+    }
+    return snapshot.max_us;
+}
@@ -0,0 +1,38 @@
+/**
+ * @file LatencyStats.cpp
+ * @brief Implementation of the LatencyStats class.
+ */
+
+#include "pipeline/LatencyStats.h"
+#include "serial_mail_sender/SerialMailSender.h"
+
+/**
+ * @brief Access the singleton instance of LatencyStats.
+ *
+ * @return Reference to the single instance of LatencyStats.
+ */
+LatencyStats& LatencyStats::getInstance(void) {
+    static LatencyStats instance;
+    return instance;
+}
+
+LatencyStats::LatencyStats(void) : m_sequence(0), m_since(Kernel::Clock::now()) {
+}
+
+/**
+ * @details
+ * Called from the main thread only; the snapshot buffer is shared by the
+ * stages, as each is sent before the next one is taken.
+ */
+void LatencyStats::report(int node) {
+    Kernel::Clock::time_point now = Kernel::Clock::now();
+    uint32_t period_ms = (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(now - m_since).count();
+    m_since = now;
+
+    SerialMailSender& serial_mail_sender = SerialMailSender::getInstance();
+    for (uint8_t stage = 0; stage < LATENCY_STAGE_COUNT; stage++) {
+        m_histograms[stage].snapshot(m_snapshot);
+        serial_mail_sender.sendLatencyReport(m_snapshot, LatencyReport{node, stage, m_sequence, period_ms});
+    }
+    m_sequence++;
+}
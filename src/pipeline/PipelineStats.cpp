@@ -0,0 +1,79 @@
+/**
+ * @file PipelineStats.cpp
+ * @brief Implementation of the PipelineStats class.
+ */
+
+#include "pipeline/PipelineStats.h"
+#include "utils/logger.h"
+
+/**
+ * @brief Access the singleton instance of PipelineStats.
+ *
+ * @return Reference to the single instance of PipelineStats.
+ */
+PipelineStats& PipelineStats::getInstance(void) {
+    static PipelineStats instance;
+    return instance;
+}
+
+PipelineStats::PipelineStats(void)
+    : m_conversions(0), m_wakeups(0), m_frames(0), m_max_latency_us(0), m_total_latency_us(0),
+      m_since(Kernel::Clock::now()) {
+}
+
+/**
+ * @brief Records a conversion; only called from the acquisition context.
+ */
+void PipelineStats::recordConversion(uint32_t latency_us) {
+    m_conversions++;
+    m_total_latency_us += latency_us;
+    if (latency_us > m_max_latency_us) {
+        m_max_latency_us = latency_us;
+    }
+}
+
+void PipelineStats::recordWakeup(void) {
+    core_util_atomic_incr_u32(&m_wakeups, 1);
+}
+
+void PipelineStats::recordFrame(void) {
+    core_util_atomic_incr_u32(&m_frames, 1);
+}
+
+void PipelineStats::report(void) {
+    Kernel::Clock::time_point now = Kernel::Clock::now();
+    uint32_t elapsed_ms = (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(now - m_since).count();
+    if (elapsed_ms == 0) {
+        return;
+    }
+
+    uint32_t conversions = core_util_atomic_exchange_u32(&m_conversions, 0);
+    uint32_t wakeups = core_util_atomic_exchange_u32(&m_wakeups, 0);
+    uint32_t frames = core_util_atomic_exchange_u32(&m_frames, 0);
+    uint32_t max_latency_us = core_util_atomic_exchange_u32(&m_max_latency_us, 0);
+    uint64_t total_latency_us = m_total_latency_us;
+    m_total_latency_us = 0;
+    m_since = now;
+
+#if defined(EVENT_PIPELINE)
+    INFO("Pipeline (event-driven) over %lu ms:", elapsed_ms);
+#else
+    INFO("Pipeline (threaded) over %lu ms:", elapsed_ms);
+#endif
+    INFO("\tConversions/s: %lu, frames/s: %lu", conversions * 1000 / elapsed_ms, frames * 1000 / elapsed_ms);
+    INFO("\tWake-ups/s: %lu (context switches/s: %lu)", wakeups * 1000 / elapsed_ms, 2 * wakeups * 1000 / elapsed_ms);
+    INFO("\tDRDY-to-read latency: max %lu us, mean %lu us", max_latency_us,
+         conversions > 0 ? (uint32_t)(total_latency_us / conversions) : 0);
+
+    mbed_stats_stack_t stacks[PIPELINE_STATS_MAX_THREADS];
+    int count = mbed_stats_stack_get_each(stacks, PIPELINE_STATS_MAX_THREADS);
+    uint32_t reserved = 0;
+    uint32_t used = 0;
+    for (int i = 0; i < count; i++) {
+        INFO("\tThread 0x%08lX: stack %lu bytes, used %lu bytes", stacks[i].thread_id,
+             stacks[i].reserved_size, stacks[i].max_size);
+        reserved += stacks[i].reserved_size;
+        used += stacks[i].max_size;
+    }
+    INFO("\tStacks total: %lu bytes reserved, %lu bytes used", reserved, used);
+}
@@ -0,0 +1,233 @@
+/**
+ * @file SelfBenchmark.cpp
+ * @brief Implementation of the SelfBenchmark class.
+ */
+
+#include "pipeline/SelfBenchmark.h"
+
+#include <climits>
+#include <cstdio>
+
+#include "adc/SampleCollector.h"
+#include "interfaces/ReadingQueue.h"
+#include "serial_mail_sender/MessageFrameBuilder.h"
+#include "utils/logger.h"
+
+/// Set by `measure` to start a point in the reading thread.
+#define BENCHMARK_FLAG_START 0x1
+
+/// Set by the reading thread once the ADC settled and words are read.
+#define BENCHMARK_FLAG_RUNNING 0x2
+
+/// Set by the reading thread after it stopped reading.
+#define BENCHMARK_FLAG_DONE 0x4
+
+#if defined(ZERO_HEAP)
+/// Largest frame size measured, what a collector of the zero-heap build holds.
+#define SELF_BENCHMARK_MAX_VECTOR_SIZE (SAMPLE_VECTOR_CAPACITY)
+#else
+/// Largest frame size measured.
+#define SELF_BENCHMARK_MAX_VECTOR_SIZE UINT_MAX
+#endif
+
+static_assert(MailFrameBuilder::maxFrameSize<50>() <= FRAME_BUFFER_CAPACITY,
+              "Frames of the largest benchmark size do not fit into FRAME_BUFFER_CAPACITY");
+
+SelfBenchmark& SelfBenchmark::getInstance(void) {
+    static SelfBenchmark instance;
+    return instance;
+}
+
+SelfBenchmark::SelfBenchmark(void)
+    : m_thread(osPriorityNormal, OS_STACK_SIZE, m_stack, "benchmark"), m_adc(nullptr), m_point{0, 0, 0, 0},
+      m_stop(false), m_frames(0), m_read_cycles(0), m_count(0) {
+    m_tracker.reset();
+}
+
+/**
+ * @details
+ * The sweep runs on the calling thread, which takes the place of the main
+ * loop; the reading thread has the same priority as the production one.
+ */
+void SelfBenchmark::run(AD7124& adc, SerialMailSender& sender, UartTransport& uart, int node) {
+    m_adc = &adc;
+
+    // Cycle counter for the CPU load
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    m_thread.start(callback(this, &SelfBenchmark::acquire));
+
+    m_count = benchmark_points(m_points, BENCHMARK_MAX_POINTS, SELF_BENCHMARK_MAX_VECTOR_SIZE);
+    INFO("Self-benchmark: %u points of %d ms", (unsigned int)m_count, BENCHMARK_POINT_MS);
+    for (size_t i = 0; i < m_count; i++) {
+        BenchmarkCounters counters = measure(m_points[i], sender, uart, node);
+        m_results[i] = evaluate_benchmark(m_points[i], counters, UART_BAUDRATE);
+
+        char row[BENCHMARK_LINE_SIZE];
+        format_benchmark_row(m_results[i], row, sizeof(row));
+        INFO("%s", row);
+    }
+
+    size_t size = formatReport(node);
+    uint16_t id = 0;
+    while (true) {
+        sendReport(sender, uart, size, node, id++);
+        Kernel::Clock::time_point next_report = Kernel::Clock::now() + SELF_BENCHMARK_REPORT_PERIOD;
+        while (Kernel::Clock::now() < next_report) {
+            sender.service();
+            ThisThread::sleep_for(SELF_BENCHMARK_SERVICE_PERIOD);
+        }
+    }
+}
+
+/**
+ * @brief Body of the reading thread: reads the words of one point per start flag.
+ *
+ * @details
+ * DRDY is polled as in `AD7124::read_voltage_from_both_channels`. Only the
+ * read, the collector and the hand-off are counted as busy; the hand-off
+ * includes waiting for the main thread to take the previous frame, which
+ * is time the production loop spins as well.
+ */
+void SelfBenchmark::acquire(void) {
+    while (true) {
+        m_flags.wait_any(BENCHMARK_FLAG_START);
+        m_adc->reconfigure(m_point.spi_frequency, m_point.power_mode, m_point.filter_fs);
+        SampleCollector collector(m_point.vector_size);
+        ThisThread::sleep_for(std::chrono::milliseconds(BENCHMARK_SETTLE_MS));
+        m_flags.set(BENCHMARK_FLAG_RUNNING);
+
+        while (!m_stop) {
+            uint8_t data[4] = {0, 0, 0, 255};
+            while (!m_stop && m_adc->m_drdy == 0) {
+                wait_us(1);
+            }
+            while (!m_stop && m_adc->m_drdy == 1) {
+                wait_us(1);
+            }
+            if (m_stop) {
+                break;
+            }
+
+            uint32_t start = DWT->CYCCNT;
+            m_adc->read_conversion_word(data);
+            m_tracker.push(data[3]);
+            if (collector.push(data)) {
+                m_adc->send_data_to_main_thread(collector.ch0(), collector.ch1());
+                collector.clear();
+                m_frames++;
+            }
+            m_read_cycles += DWT->CYCCNT - start;
+        }
+        m_flags.set(BENCHMARK_FLAG_DONE);
+    }
+}
+
+/**
+ * @brief Runs one point and returns its counts.
+ *
+ * @details
+ * The window opens once the reading thread reports the ADC settled, and
+ * closes after `BENCHMARK_POINT_MS`; frames still in flight are sent
+ * afterwards but not counted. The main loop's own work is timed per pass.
+ */
+BenchmarkCounters SelfBenchmark::measure(const BenchmarkPoint& point, SerialMailSender& sender, UartTransport& uart,
+                                         int node) {
+    m_point = point;
+    m_tracker.reset();
+    m_frames = 0;
+    m_read_cycles = 0;
+    m_stop = false;
+    m_flags.clear(BENCHMARK_FLAG_RUNNING | BENCHMARK_FLAG_DONE);
+    m_flags.set(BENCHMARK_FLAG_START);
+    while (m_flags.wait_any_for(BENCHMARK_FLAG_RUNNING, SELF_BENCHMARK_SERVICE_PERIOD) & osFlagsError) {
+        sender.service();
+    }
+
+    const FrameSinkStats before = uart.stats();
+    const uint32_t pool_drops_before = sender.droppedFrames();
+    uint32_t main_cycles = 0;
+    const Kernel::Clock::time_point start = Kernel::Clock::now();
+    const Kernel::Clock::time_point end = start + std::chrono::milliseconds(BENCHMARK_POINT_MS);
+    while (Kernel::Clock::now() < end) {
+        main_cycles += drain(sender, node);
+    }
+    m_stop = true;
+    const uint32_t elapsed_us = (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+                                    Kernel::Clock::now() - start).count();
+    const FrameSinkStats after = uart.stats();
+    const uint32_t pool_drops = sender.droppedFrames() - pool_drops_before;
+
+    // Let the reading thread finish its frame, then empty the mailbox
+    while ((m_flags.get() & BENCHMARK_FLAG_DONE) == 0 || !ReadingQueue::getInstance().mail_box.empty()) {
+        drain(sender, node);
+    }
+
+    const uint32_t cycles_per_us = SystemCoreClock / 1000000;
+    BenchmarkCounters counters;
+    counters.elapsed_us = elapsed_us;
+    counters.conversions = m_tracker.conversions;
+    counters.missed = m_tracker.missed;
+    counters.errors = m_tracker.errors;
+    counters.frames = m_frames;
+    counters.frame_drops = (after.dropped - before.dropped) + pool_drops;
+    counters.busy_us = main_cycles / cycles_per_us + m_read_cycles / cycles_per_us;
+    counters.uart_bytes = after.bytes - before.bytes;
+    return counters;
+}
+
+/**
+ * @brief One pass of the main loop: sends a frame if one arrives, otherwise services the sinks.
+ * @return Cycles spent, without the wait for the mail.
+ */
+uint32_t SelfBenchmark::drain(SerialMailSender& sender, int node) {
+    ReadingQueue& reading_queue = ReadingQueue::getInstance();
+    auto mail = reading_queue.mail_box.try_get_for(SELF_BENCHMARK_SERVICE_PERIOD);
+
+    uint32_t start = DWT->CYCCNT;
+    if (mail) {
+        ReadingQueue::mail_t* reading_mail = mail;
+        auto ch0_values = reading_mail->ch0;
+        auto ch1_values = reading_mail->ch1;
+        reading_queue.mail_box.free(reading_mail);
+        sender.sendMail(ch0_values, ch1_values, node);
+    } else {
+        sender.service();
+    }
+    return DWT->CYCCNT - start;
+}
+
+size_t SelfBenchmark::formatReport(int node) {
+    char source[24];
+    snprintf(source, sizeof(source), "node %d", node);
+    size_t size = format_benchmark_header(source, m_report, sizeof(m_report));
+    for (size_t i = 0; i < m_count; i++) {
+        size += format_benchmark_row(m_results[i], m_report + size, sizeof(m_report) - size);
+    }
+    size += format_benchmark_summary(m_results, m_count, m_report + size, sizeof(m_report) - size);
+    return size;
+}
+
+/**
+ * @details
+ * The UART sink drops its oldest frame when full, so every chunk waits for
+ * room first; the table is sent in status class, behind any sample frames.
+ */
+void SelfBenchmark::sendReport(SerialMailSender& sender, UartTransport& uart, size_t size, int node, uint16_t id) {
+    const MessageHeader header = {node, MESSAGE_KIND_BENCHMARK, id, (uint32_t)size};
+    uint8_t frame[SERIAL_MAIL_HEADER_SIZE + MESSAGE_FRAME_HEADER_SIZE + SELF_BENCHMARK_CHUNK_SIZE];
+    size_t offset = 0;
+    while (offset < size) {
+        while (!uart.canAccept(TRAFFIC_STATUS)) {
+            sender.service();
+            ThisThread::sleep_for(1ms);
+        }
+        size_t next_offset = size;
+        size_t frame_size = build_message_frame(header, reinterpret_cast<const uint8_t*>(m_report), offset,
+                                                SELF_BENCHMARK_CHUNK_SIZE, frame, sizeof(frame), &next_offset);
+        sender.sendRaw(frame, frame_size, TRAFFIC_STATUS);
+        offset = next_offset;
+    }
+}
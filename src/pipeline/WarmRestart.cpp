@@ -0,0 +1,69 @@
+/**
+ * @file WarmRestart.cpp
+ * @brief Implementation of the WarmRestart class.
+ */
+
+#include "pipeline/WarmRestart.h"
+
+#include "hal/us_ticker_api.h"
+#include "utils/logger.h"
+
+/**
+ * @brief Frames, sequence number and ADC registers kept across resets.
+ *
+ * @details
+ * GCC_ARM marks `.noinit` as NOBITS, so the linker places it after `.bss`,
+ * outside the range the startup code zeroes.
+ */
+static RetainedArea retained_area MBED_SECTION(".noinit");
+
+/**
+ * @brief Access the singleton instance of WarmRestart.
+ *
+ * @return Reference to the single instance of WarmRestart.
+ */
+WarmRestart& WarmRestart::getInstance(void) {
+    static WarmRestart instance;
+    return instance;
+}
+
+WarmRestart::WarmRestart(void)
+    : m_state(retained_area), m_warm(false), m_reset_reason(ResetReason::get()), m_first_sample_us(0),
+      m_reported(false) {
+    m_warm = m_state.recover();
+}
+
+void WarmRestart::startWatchdog(void) {
+    Watchdog::get_instance().start(WARM_RESTART_WATCHDOG_TIMEOUT_MS);
+}
+
+void WarmRestart::kick(void) {
+    Watchdog::get_instance().kick();
+}
+
+void WarmRestart::recordFirstSample(void) {
+    if (m_first_sample_us.load(std::memory_order_relaxed) != 0) {
+        return;
+    }
+    uint32_t expected = 0;
+    // A ticker value of 0 would read as "not yet"
+    uint32_t now_us = us_ticker_read() | 1;
+    m_first_sample_us.compare_exchange_strong(expected, now_us, std::memory_order_relaxed);
+}
+
+bool WarmRestart::report(void) {
+    if (m_reported) {
+        return true;
+    }
+    uint32_t first_sample_us = m_first_sample_us.load(std::memory_order_relaxed);
+    if (first_sample_us == 0) {
+        return false;
+    }
+
+    const RetainedStats& stats = m_state.stats();
+    INFO("%s boot (reset reason %d, warm boot %lu): %lu frames resent, %lu damaged, first sample after %lu us.",
+         m_warm ? "Warm" : "Cold", (int)m_reset_reason, (unsigned long)m_state.boots(),
+         (unsigned long)stats.recovered, (unsigned long)stats.corrupt, (unsigned long)first_sample_us);
+    m_reported = true;
+    return true;
+}
@@ -0,0 +1,45 @@
+/**
+ * @file AdaptiveBatcher.cpp
+ * @brief Implementation of the AdaptiveBatcher class.
+ */
+
+#include "serial_mail_sender/AdaptiveBatcher.h"
+
+/**
+ * @details
+ * The bounds are ordered and the initial target is clamped into them, so a
+ * misconfigured batcher still produces valid frame sizes.
+ */
+AdaptiveBatcher::AdaptiveBatcher(unsigned int min_samples, unsigned int max_samples,
+                                 unsigned int initial_samples, uint32_t deadline_ms)
+    : m_min_samples(min_samples > 0 ? min_samples : 1),
+      m_max_samples(max_samples > m_min_samples ? max_samples : m_min_samples),
+      m_deadline_ms(deadline_ms),
+      m_target(initial_samples < m_min_samples ? m_min_samples :
+               (initial_samples > m_max_samples ? m_max_samples : initial_samples)) {
+}
+
+/**
+ * @brief Doubles the target on a backed-up link, shrinks it by a quarter on an idle one.
+ *
+ * @details
+ * A backlog between idle and `ADAPTIVE_BATCHER_GROW_BACKLOG` keeps the target,
+ * which is the hysteresis band the target settles in once the link keeps up.
+ */
+void AdaptiveBatcher::onBacklog(size_t backlog) {
+    unsigned int target = m_target.load(std::memory_order_relaxed);
+    if (backlog >= ADAPTIVE_BATCHER_GROW_BACKLOG) {
+        target = (target > m_max_samples / 2) ? m_max_samples : target * 2;
+    } else if (backlog == 0) {
+        unsigned int step = (target / 4 > 0) ? target / 4 : 1;
+        target = (target - m_min_samples > step) ? target - step : m_min_samples;
+    }
+    m_target.store(target, std::memory_order_relaxed);
+}
+
+bool AdaptiveBatcher::due(unsigned int samples, uint32_t age_ms) const {
+    if (samples == 0) {
+        return false;
+    }
+    return samples >= target() || age_ms >= m_deadline_ms;
+}
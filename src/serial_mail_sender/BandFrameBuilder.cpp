@@ -0,0 +1,57 @@
+/**
+ * @file BandFrameBuilder.cpp
+ * @brief Implementation of the band power frame writer.
+ */
+
+#include "serial_mail_sender/BandFrameBuilder.h"
+
+#include <cstring>
+
+static_assert(sizeof(float) == BAND_FRAME_VALUE_SIZE, "Band powers are sent as IEEE-754 single precision");
+
+/**
+ * @details
+ * Values are stored byte by byte in little-endian order, independent of the
+ * byte order of the node.
+ */
+size_t build_band_frame(const BandPowers& powers, int node, uint8_t* out, size_t capacity) {
+    size_t bands = powers.bands < BAND_POWER_MAX_BANDS ? powers.bands : BAND_POWER_MAX_BANDS;
+    uint32_t payload_size = (uint32_t)band_frame_payload_size(bands, BAND_POWER_CHANNELS);
+    size_t size = SERIAL_MAIL_HEADER_SIZE + payload_size;
+    if (size > capacity) {
+        return 0;
+    }
+
+    out[0] = SERIAL_MAIL_SYNC_MARKER & 0xFF;
+    out[1] = SERIAL_MAIL_SYNC_MARKER >> 8;
+    out[2] = payload_size & 0xFF;
+    out[3] = (payload_size >> 8) & 0xFF;
+    out[4] = (payload_size >> 16) & 0xFF;
+    out[5] = (payload_size >> 24) & 0xFF;
+
+    uint8_t* header = out + SERIAL_MAIL_HEADER_SIZE;
+    header[0] = BAND_FRAME_VERSION;
+    header[RAW_FRAME_NODE_OFFSET] = (uint16_t)node & 0xFF;
+    header[RAW_FRAME_NODE_OFFSET + 1] = ((uint16_t)node >> 8) & 0xFF;
+    header[RAW_FRAME_MASK_OFFSET] = RAW_FRAME_CHANNEL_0 | RAW_FRAME_CHANNEL_1;
+    header[RAW_FRAME_COUNT_OFFSET] = bands & 0xFF;
+    header[RAW_FRAME_COUNT_OFFSET + 1] = (bands >> 8) & 0xFF;
+    header[RAW_FRAME_SEQUENCE_OFFSET] = powers.window & 0xFF;
+    header[RAW_FRAME_SEQUENCE_OFFSET + 1] = (powers.window >> 8) & 0xFF;
+    header[RAW_FRAME_SEQUENCE_OFFSET + 2] = (powers.window >> 16) & 0xFF;
+    header[RAW_FRAME_SEQUENCE_OFFSET + 3] = (powers.window >> 24) & 0xFF;
+
+    uint8_t* values = header + RAW_FRAME_HEADER_SIZE;
+    for (size_t channel = 0; channel < BAND_POWER_CHANNELS; channel++) {
+        for (size_t band = 0; band < bands; band++) {
+            uint32_t bits;
+            memcpy(&bits, &powers.power[channel][band], sizeof(bits));
+            values[0] = bits & 0xFF;
+            values[1] = (bits >> 8) & 0xFF;
+            values[2] = (bits >> 16) & 0xFF;
+            values[3] = (bits >> 24) & 0xFF;
+            values += BAND_FRAME_VALUE_SIZE;
+        }
+    }
+    return size;
+}
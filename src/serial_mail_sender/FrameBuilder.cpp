@@ -0,0 +1,120 @@
+/**
+ * @file FrameBuilder.cpp
+ * @brief Implementation of the FrameBuilder class.
+ */
+
+#include "serial_mail_sender/FrameBuilder.h"
+#include "serial_mail_sender/FrameFormat.h"
+
+#include <cstring>
+
+#if defined(ZERO_HEAP)
+uint8_t* FrameArenaAllocator::allocate(size_t size) {
+    if (m_in_use || size > sizeof(m_arena)) {
+        return nullptr;
+    }
+    m_in_use = true;
+    return m_arena;
+}
+
+void FrameArenaAllocator::deallocate(uint8_t* p, size_t size) {
+    (void)p;
+    (void)size;
+    m_in_use = false;
+}
+
+FrameBuilder::FrameBuilder(size_t initial_size) : m_builder(FRAME_BUILDER_ARENA_SIZE, &m_allocator) {
+    (void)initial_size;
+}
+#else
+FrameBuilder::FrameBuilder(size_t initial_size) : m_builder(initial_size) {
+    m_frame.reserve(SERIAL_MAIL_HEADER_SIZE + initial_size);
+}
+#endif
+
+/**
+ * @brief Packs the samples directly into a FlatBuffers struct vector.
+ * @param inputs Samples to serialize.
+ * @param count Number of samples.
+ * @return Offset of the created vector.
+ *
+ * @details
+ * `SerialMail::Value` is a byte-aligned 3-byte struct holding the big-endian
+ * code, so the samples are packed straight into the uninitialized vector
+ * instead of going through a temporary `std::vector<SerialMail::Value>`.
+ */
+flatbuffers::Offset<flatbuffers::Vector<const SerialMail::Value*>> FrameBuilder::createValues(
+    const int32_t* inputs, size_t count) {
+
+    static_assert(sizeof(SerialMail::Value) == SAMPLE_WIRE_SIZE, "Values must be packed samples");
+    SerialMail::Value* values = nullptr;
+    auto offset = m_builder.CreateUninitializedVectorOfStructs<SerialMail::Value>(count, &values);
+    pack_samples(inputs, count, reinterpret_cast<uint8_t*>(values));
+    return offset;
+}
+
+/**
+ * @brief Serializes the readings into the FlatBuffer builder.
+ * @return Size of the FlatBuffer without frame header.
+ */
+size_t FrameBuilder::serialize(
+    const int32_t* ch0, size_t ch0_count,
+    const int32_t* ch1, size_t ch1_count,
+    int node, unsigned int device) {
+
+    m_builder.Clear();
+
+    auto ch0_flatbuffers = createValues(ch0, ch0_count);
+    auto ch1_flatbuffers = createValues(ch1, ch1_count);
+    auto orc = SerialMail::CreateSerialMail(m_builder, ch0_flatbuffers, ch1_flatbuffers, node, (uint8_t)device);
+    m_builder.Finish(orc);
+
+    return m_builder.GetSize();
+}
+
+/**
+ * @brief Writes the frame header followed by the serialized FlatBuffer.
+ *
+ * @details
+ * The header holds the synchronization marker and the FlatBuffer size, both in
+ * little-endian byte order exactly as the previous three separate UART writes
+ * produced them on the Cortex-M.
+ */
+void FrameBuilder::writeFrame(uint8_t* out) const {
+    uint32_t size = m_builder.GetSize();
+    out[0] = SERIAL_MAIL_SYNC_MARKER & 0xFF;
+    out[1] = SERIAL_MAIL_SYNC_MARKER >> 8;
+    out[2] = size & 0xFF;
+    out[3] = (size >> 8) & 0xFF;
+    out[4] = (size >> 16) & 0xFF;
+    out[5] = (size >> 24) & 0xFF;
+    memcpy(out + SERIAL_MAIL_HEADER_SIZE, m_builder.GetBufferPointer(), size);
+}
+
+size_t FrameBuilder::build(
+    const SampleVector& ch0,
+    const SampleVector& ch1,
+    int node,
+    unsigned int device) {
+
+    size_t size = serialize(ch0.data(), ch0.size(), ch1.data(), ch1.size(), node, device);
+    m_frame.resize(SERIAL_MAIL_HEADER_SIZE + size);
+    writeFrame(m_frame.data());
+    return m_frame.size();
+}
+
+size_t FrameBuilder::build(
+    const SampleVector& ch0,
+    const SampleVector& ch1,
+    int node,
+    uint8_t* out,
+    size_t capacity,
+    unsigned int device) {
+
+    size_t size = SERIAL_MAIL_HEADER_SIZE + serialize(ch0.data(), ch0.size(), ch1.data(), ch1.size(), node, device);
+    if (size > capacity) {
+        return 0;
+    }
+    writeFrame(out);
+    return size;
+}
@@ -0,0 +1,166 @@
+/**
+ * @file LatencyFrameBuilder.cpp
+ * @brief Implementation of the latency frame writer and reader.
+ */
+
+#include "serial_mail_sender/LatencyFrameBuilder.h"
+
+#include <cstring>
+
+/// Offset of the stage in a latency frame.
+#define LATENCY_FRAME_STAGE_OFFSET 3
+
+/// Offset of the report number in a latency frame.
+#define LATENCY_FRAME_SEQUENCE_OFFSET 4
+
+/// Offset of the period in a latency frame.
+#define LATENCY_FRAME_PERIOD_OFFSET 8
+
+/// Offset of the number of latencies in a latency frame.
+#define LATENCY_FRAME_TOTAL_OFFSET 12
+
+/// Offset of the largest latency in a latency frame.
+#define LATENCY_FRAME_MAX_OFFSET 16
+
+/// Offset of the first covered bucket in a latency frame.
+#define LATENCY_FRAME_FIRST_OFFSET 20
+
+/// Offset of the bucket after the last covered one in a latency frame.
+#define LATENCY_FRAME_NEXT_OFFSET 22
+
+static void put_le(uint8_t* out, uint32_t value, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        out[i] = (value >> (8 * i)) & 0xFF;
+    }
+}
+
+static uint32_t get_le(const uint8_t* in, size_t size) {
+    uint32_t value = 0;
+    for (size_t i = 0; i < size; i++) {
+        value |= (uint32_t)in[i] << (8 * i);
+    }
+    return value;
+}
+
+/**
+ * @brief Writes `value` as unsigned LEB128.
+ * @return Number of bytes written, at most 5.
+ */
+static size_t put_leb128(uint8_t* out, uint32_t value) {
+    size_t size = 0;
+    while (value >= 0x80) {
+        out[size++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[size++] = (uint8_t)value;
+    return size;
+}
+
+/**
+ * @brief Reads an unsigned LEB128 value of at most 5 bytes.
+ * @return Number of bytes read, 0 if the value is truncated or too long.
+ */
+static size_t get_leb128(const uint8_t* in, size_t size, uint32_t* value) {
+    *value = 0;
+    for (size_t i = 0; i < size && i < 5; i++) {
+        *value |= (uint32_t)(in[i] & 0x7F) << (7 * i);
+        if ((in[i] & 0x80) == 0) {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @details
+ * Buckets are written while a worst-case entry still fits, so a frame never
+ * ends in the middle of an entry; the caller sends further frames from
+ * `next_bucket` on. A report without any latency is a single frame without
+ * entries.
+ */
+size_t build_latency_frame(const LatencySnapshot& snapshot, const LatencyReport& report, size_t first_bucket,
+                           uint8_t* out, size_t capacity, size_t* next_bucket) {
+    if (capacity < SERIAL_MAIL_HEADER_SIZE + LATENCY_FRAME_HEADER_SIZE) {
+        *next_bucket = first_bucket;
+        return 0;
+    }
+
+    uint8_t* payload = out + SERIAL_MAIL_HEADER_SIZE;
+    size_t available = capacity - SERIAL_MAIL_HEADER_SIZE;
+    size_t size = LATENCY_FRAME_HEADER_SIZE;
+    size_t expected = first_bucket;
+    size_t bucket = first_bucket;
+    for (; bucket < LATENCY_HISTOGRAM_BUCKETS; bucket++) {
+        if (snapshot.counts[bucket] == 0) {
+            continue;
+        }
+        if (size + LATENCY_FRAME_MAX_ENTRY_SIZE > available) {
+            break;
+        }
+        size += put_leb128(payload + size, (uint32_t)(bucket - expected));
+        size += put_leb128(payload + size, snapshot.counts[bucket]);
+        expected = bucket + 1;
+    }
+    *next_bucket = bucket;
+
+    payload[0] = LATENCY_FRAME_VERSION;
+    put_le(payload + RAW_FRAME_NODE_OFFSET, (uint32_t)report.node, 2);
+    payload[LATENCY_FRAME_STAGE_OFFSET] = report.stage;
+    put_le(payload + LATENCY_FRAME_SEQUENCE_OFFSET, report.sequence, 4);
+    put_le(payload + LATENCY_FRAME_PERIOD_OFFSET, report.period_ms, 4);
+    put_le(payload + LATENCY_FRAME_TOTAL_OFFSET, snapshot.total, 4);
+    put_le(payload + LATENCY_FRAME_MAX_OFFSET, snapshot.max_us, 4);
+    put_le(payload + LATENCY_FRAME_FIRST_OFFSET, (uint32_t)first_bucket, 2);
+    put_le(payload + LATENCY_FRAME_NEXT_OFFSET, (uint32_t)bucket, 2);
+
+    put_le(out, SERIAL_MAIL_SYNC_MARKER, SERIAL_MAIL_SYNC_SIZE);
+    put_le(out + SERIAL_MAIL_SYNC_SIZE, (uint32_t)size, SERIAL_MAIL_LENGTH_SIZE);
+    return SERIAL_MAIL_HEADER_SIZE + size;
+}
+
+bool read_latency_frame(const uint8_t* payload, size_t size, LatencyReport* report, LatencySnapshot* snapshot,
+                        size_t* first_bucket, size_t* next_bucket) {
+    if (size < LATENCY_FRAME_HEADER_SIZE || payload[0] != LATENCY_FRAME_VERSION) {
+        return false;
+    }
+
+    size_t first = get_le(payload + LATENCY_FRAME_FIRST_OFFSET, 2);
+    size_t next = get_le(payload + LATENCY_FRAME_NEXT_OFFSET, 2);
+    if (first > next || next > LATENCY_HISTOGRAM_BUCKETS ||
+        payload[LATENCY_FRAME_STAGE_OFFSET] >= LATENCY_STAGE_COUNT) {
+        return false;
+    }
+
+    report->node = (int32_t)get_le(payload + RAW_FRAME_NODE_OFFSET, 2);
+    report->stage = payload[LATENCY_FRAME_STAGE_OFFSET];
+    report->sequence = get_le(payload + LATENCY_FRAME_SEQUENCE_OFFSET, 4);
+    report->period_ms = get_le(payload + LATENCY_FRAME_PERIOD_OFFSET, 4);
+    if (first == 0) {
+        memset(snapshot->counts, 0, sizeof(snapshot->counts));
+    }
+    snapshot->total = get_le(payload + LATENCY_FRAME_TOTAL_OFFSET, 4);
+    snapshot->max_us = get_le(payload + LATENCY_FRAME_MAX_OFFSET, 4);
+
+    size_t pos = LATENCY_FRAME_HEADER_SIZE;
+    size_t bucket = first;
+    while (pos < size) {
+        uint32_t gap;
+        uint32_t count;
+        size_t read = get_leb128(payload + pos, size - pos, &gap);
+        if (read == 0) {
+            return false;
+        }
+        pos += read;
+        read = get_leb128(payload + pos, size - pos, &count);
+        if (read == 0 || gap >= next - bucket) {
+            return false;
+        }
+        pos += read;
+        bucket += gap;
+        snapshot->counts[bucket++] = count;
+    }
+
+    *first_bucket = first;
+    *next_bucket = next;
+    return true;
+}
@@ -0,0 +1,87 @@
+/**
+ * @file MessageFrameBuilder.cpp
+ * @brief Implementation of the message frame writer and reader.
+ */
+
+#include "serial_mail_sender/MessageFrameBuilder.h"
+
+#include <cstring>
+
+/// Offset of the kind in a message frame.
+#define MESSAGE_FRAME_KIND_OFFSET 3
+
+/// Offset of the message number in a message frame.
+#define MESSAGE_FRAME_ID_OFFSET 4
+
+/// Offset of the message size in a message frame.
+#define MESSAGE_FRAME_SIZE_OFFSET 6
+
+/// Offset of the chunk offset in a message frame.
+#define MESSAGE_FRAME_OFFSET_OFFSET 10
+
+static void put_le(uint8_t* out, uint32_t value, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        out[i] = (value >> (8 * i)) & 0xFF;
+    }
+}
+
+static uint32_t get_le(const uint8_t* in, size_t size) {
+    uint32_t value = 0;
+    for (size_t i = 0; i < size; i++) {
+        value |= (uint32_t)in[i] << (8 * i);
+    }
+    return value;
+}
+
+/**
+ * @details
+ * A message of 0 bytes is a single frame without chunk bytes.
+ */
+size_t build_message_frame(const MessageHeader& header, const uint8_t* message, size_t offset, size_t chunk_size,
+                           uint8_t* out, size_t capacity, size_t* next_offset) {
+    if (capacity < SERIAL_MAIL_HEADER_SIZE + MESSAGE_FRAME_HEADER_SIZE || offset > header.size) {
+        *next_offset = offset;
+        return 0;
+    }
+
+    size_t length = header.size - offset;
+    if (length > chunk_size) {
+        length = chunk_size;
+    }
+    if (length > capacity - SERIAL_MAIL_HEADER_SIZE - MESSAGE_FRAME_HEADER_SIZE) {
+        length = capacity - SERIAL_MAIL_HEADER_SIZE - MESSAGE_FRAME_HEADER_SIZE;
+    }
+
+    uint8_t* payload = out + SERIAL_MAIL_HEADER_SIZE;
+    payload[0] = MESSAGE_FRAME_VERSION;
+    put_le(payload + RAW_FRAME_NODE_OFFSET, (uint32_t)header.node, 2);
+    payload[MESSAGE_FRAME_KIND_OFFSET] = header.kind;
+    put_le(payload + MESSAGE_FRAME_ID_OFFSET, header.id, 2);
+    put_le(payload + MESSAGE_FRAME_SIZE_OFFSET, header.size, 4);
+    put_le(payload + MESSAGE_FRAME_OFFSET_OFFSET, (uint32_t)offset, 4);
+    if (length > 0) {
+        memcpy(payload + MESSAGE_FRAME_HEADER_SIZE, message + offset, length);
+    }
+
+    size_t size = MESSAGE_FRAME_HEADER_SIZE + length;
+    put_le(out, SERIAL_MAIL_SYNC_MARKER, SERIAL_MAIL_SYNC_SIZE);
+    put_le(out + SERIAL_MAIL_SYNC_SIZE, (uint32_t)size, SERIAL_MAIL_LENGTH_SIZE);
+    *next_offset = offset + length;
+    return SERIAL_MAIL_HEADER_SIZE + size;
+}
+
+bool read_message_frame(const uint8_t* payload, size_t size, MessageHeader* header, size_t* offset,
+                        const uint8_t** chunk, size_t* chunk_size) {
+    if (size < MESSAGE_FRAME_HEADER_SIZE || payload[0] != MESSAGE_FRAME_VERSION) {
+        return false;
+    }
+
+    header->node = (int32_t)get_le(payload + RAW_FRAME_NODE_OFFSET, 2);
+    header->kind = payload[MESSAGE_FRAME_KIND_OFFSET];
+    header->id = (uint16_t)get_le(payload + MESSAGE_FRAME_ID_OFFSET, 2);
+    header->size = get_le(payload + MESSAGE_FRAME_SIZE_OFFSET, 4);
+    *offset = get_le(payload + MESSAGE_FRAME_OFFSET_OFFSET, 4);
+    *chunk = payload + MESSAGE_FRAME_HEADER_SIZE;
+    *chunk_size = size - MESSAGE_FRAME_HEADER_SIZE;
+    return *offset <= header->size && *chunk_size <= header->size - *offset;
+}
@@ -0,0 +1,97 @@
+/**
+ * @file RawFrameBuilder.cpp
+ * @brief Implementation of the RawFrameBuilder class.
+ */
+
+#include "serial_mail_sender/RawFrameBuilder.h"
+
+static_assert(SAMPLE_WIRE_SIZE == RAW_FRAME_SAMPLE_SIZE, "Frames carry samples in their wire form");
+
+RawFrameBuilder::RawFrameBuilder(bool timed) : m_sequence(0), m_timed(timed) {
+}
+
+size_t RawFrameBuilder::build(
+    const SampleVector& ch0,
+    const SampleVector& ch1,
+    int node,
+    uint8_t* out,
+    size_t capacity,
+    unsigned int device,
+    uint64_t time_us) {
+
+    return write(ch0.data(), ch0.size(), ch1.data(), ch1.size(), node, device, time_us, out, capacity);
+}
+
+/**
+ * @brief Writes the frame header, the raw header and the samples.
+ * @return Number of bytes written to `out`, 0 if the frame does not fit.
+ *
+ * @details
+ * Empty channels are left out of the channel mask, whose bits are those of
+ * the device's channels (see FrameFormat.h). The layout has a single
+ * sample count, so if both channels are present but differ in length, only
+ * the first samples of the longer one are sent. A timed frame has the time
+ * between the raw header fields and the samples, which are packed into
+ * their 3-byte wire form here.
+ */
+size_t RawFrameBuilder::write(
+    const int32_t* ch0, size_t ch0_count,
+    const int32_t* ch1, size_t ch1_count,
+    int node, unsigned int device, uint64_t time_us, uint8_t* out, size_t capacity) {
+
+    if (device >= RAW_FRAME_MAX_DEVICES) {
+        return 0;
+    }
+    uint8_t mask = (ch0_count > 0 ? RAW_FRAME_CHANNEL_0 : 0) | (ch1_count > 0 ? RAW_FRAME_CHANNEL_1 : 0);
+    mask = (uint8_t)(mask << (2 * device));
+    size_t channels = (ch0_count > 0 ? 1 : 0) + (ch1_count > 0 ? 1 : 0);
+    size_t count = (ch0_count > 0 && ch1_count > 0) ? (ch0_count < ch1_count ? ch0_count : ch1_count)
+                                                    : ch0_count + ch1_count;
+    if (count > UINT16_MAX) {
+        return 0;
+    }
+
+    uint32_t payload_size = (uint32_t)(m_timed ? raw_frame_timed_payload_size(count, channels)
+                                               : raw_frame_payload_size(count, channels));
+    size_t size = SERIAL_MAIL_HEADER_SIZE + payload_size;
+    if (size > capacity) {
+        return 0;
+    }
+
+    out[0] = SERIAL_MAIL_SYNC_MARKER & 0xFF;
+    out[1] = SERIAL_MAIL_SYNC_MARKER >> 8;
+    out[2] = payload_size & 0xFF;
+    out[3] = (payload_size >> 8) & 0xFF;
+    out[4] = (payload_size >> 16) & 0xFF;
+    out[5] = (payload_size >> 24) & 0xFF;
+
+    uint8_t* header = out + SERIAL_MAIL_HEADER_SIZE;
+    header[0] = m_timed ? RAW_FRAME_TIMED_VERSION : RAW_FRAME_VERSION;
+    header[RAW_FRAME_NODE_OFFSET] = (uint16_t)node & 0xFF;
+    header[RAW_FRAME_NODE_OFFSET + 1] = ((uint16_t)node >> 8) & 0xFF;
+    header[RAW_FRAME_MASK_OFFSET] = mask;
+    header[RAW_FRAME_COUNT_OFFSET] = count & 0xFF;
+    header[RAW_FRAME_COUNT_OFFSET + 1] = (count >> 8) & 0xFF;
+    header[RAW_FRAME_SEQUENCE_OFFSET] = m_sequence & 0xFF;
+    header[RAW_FRAME_SEQUENCE_OFFSET + 1] = (m_sequence >> 8) & 0xFF;
+    header[RAW_FRAME_SEQUENCE_OFFSET + 2] = (m_sequence >> 16) & 0xFF;
+    header[RAW_FRAME_SEQUENCE_OFFSET + 3] = (m_sequence >> 24) & 0xFF;
+
+    uint8_t* samples = header + RAW_FRAME_HEADER_SIZE;
+    if (m_timed) {
+        for (size_t i = 0; i < sizeof(time_us); i++) {
+            header[RAW_FRAME_TIME_OFFSET + i] = (time_us >> (8 * i)) & 0xFF;
+        }
+        samples = header + RAW_FRAME_TIMED_HEADER_SIZE;
+    }
+    if (ch0_count > 0) {
+        pack_samples(ch0, count, samples);
+        samples += count * RAW_FRAME_SAMPLE_SIZE;
+    }
+    if (ch1_count > 0) {
+        pack_samples(ch1, count, samples);
+    }
+
+    m_sequence++;
+    return size;
+}
@@ -4,21 +4,21 @@
  */
 
 #include "serial_mail_sender/SerialMailSender.h"
-#include "flatbuffers/flatbuffers.h"
 #include "utils/logger.h"
 
-#define BAUDRATE 115200 ///< UART baud rate for serial communication
+#if defined(ADAPTIVE_BATCHING)
+#include "config/PipelineConfig.h"
+#endif
 
-/**
- * @brief Initialize the static BufferedSerial instance.
- * 
- * TX: PC_1, RX: PC_0 (NUCLEO board)
- * Raspberry Pi connection:
- * - TX -> GPIO 15 (RX)
- * - RX -> GPIO 14 (TX)
- * - GND -> GND
- */
-BufferedSerial SerialMailSender::m_serial_port(/*PC_1*/USBTX,/*PC_0*/USBRX, BAUDRATE);
+#if defined(BAND_POWER)
+#include "serial_mail_sender/BandFrameBuilder.h"
+#endif
+
+#if defined(LATENCY_STATS)
+#include "pipeline/LatencyStats.h"
+#endif
+
+#include <cstring>
 
 /**
  * @brief Access the singleton instance of SerialMailSender.
@@ -33,77 +33,240 @@ SerialMailSender& SerialMailSender::getInstance(void) {
 /**
  * @brief Constructs a SerialMailSender instance.
  * 
- * Sets the serial port format to 8 data bits, no parity, and 1 stop bit (8N1).
+ * No sink is registered; the application adds them at startup.
  */
-SerialMailSender::SerialMailSender(void) {
-    m_serial_port.set_format(8, BufferedSerial::None, 1);  // 8N1 format
+SerialMailSender::SerialMailSender(void)
+    : m_dropped_frames(0)
+#if defined(WARM_RESTART) && defined(RAW_FRAMES)
+      , m_retained(nullptr)
+#endif
+#if defined(ADAPTIVE_BATCHING)
+      , m_batcher(PhytoConfig::batch_min_samples, PhytoConfig::batch_max_samples,
+                  PhytoConfig::vector_size, PhytoConfig::batch_deadline_ms)
+#endif
+#if defined(TX_SCHEDULER)
+      , m_messages{}, m_message_id(0)
+#endif
+{
 }
 
-/**
- * @brief Converts a vector of 3-byte arrays into a vector of SerialMail::Value structs.
- * 
- * @param inputs A vector of 3-byte arrays to be converted.
- * @return A vector of SerialMail::Value objects.
- */
-std::vector<SerialMail::Value> SerialMailSender::convertToSerialMailValues(const std::vector<std::array<uint8_t, 3>>& inputs) {
-    std::vector<SerialMail::Value> raw_input_bytes;
-    raw_input_bytes.reserve(inputs.size()); // Reserve space for efficiency
-
-    for (const auto& input : inputs) {
-        // Create SerialMail::Value from each 3-byte array
-        raw_input_bytes.emplace_back(SerialMail::Value(input[0], input[1], input[2]));
+bool SerialMailSender::addSink(FrameSink& sink) {
+    m_mutex.lock();
+    bool added = m_dispatcher.addSink(sink);
+    m_mutex.unlock();
+    if (!added) {
+        WARN("Sink %s not registered, too many sinks.", sink.name());
     }
+    return added;
+}
 
-    return raw_input_bytes;
+#if defined(WARM_RESTART) && defined(RAW_FRAMES)
+/**
+ * @details
+ * The host sees the frames after a warm reset continue the sequence, with
+ * a gap only for the frames that were neither sent nor retained.
+ */
+void SerialMailSender::attachRetained(RetainedState& retained) {
+    m_mutex.lock();
+    m_retained = &retained;
+    m_frame_builder.setSequence(retained.sequence());
+    m_mutex.unlock();
 }
+#endif
 
 /**
- * @brief Serializes and sends ADC data using FlatBuffers over UART.
+ * @brief Serializes ADC data using FlatBuffers and hands the frame to all sinks.
  * 
  * @details
- * This method prepares the data for transmission using FlatBuffers.
- * It includes a synchronization marker, the size of the FlatBuffer, 
- * and the serialized data.
+ * The `FrameBuilder` (or, with `RAW_FRAMES`, the `RawFrameBuilder`) writes the
+ * synchronization marker, the payload size and the serialized data directly
+ * into a pooled buffer. Every sink
+ * queues a reference to that buffer; it returns to the pool once the slowest
+ * sink has written or dropped it. If all buffers are still referenced, the
+ * sinks are serviced once more before the frame is given up.
+ *
+ * With `ADAPTIVE_BATCHING`, the frames still waiting from earlier mails are
+ * reported to the batcher before the new frame is queued.
+ *
+ * With `TX_SCHEDULER`, the queues of pending messages are topped up as well,
+ * as the main thread calls `service` only while no mail arrives.
  */
 void SerialMailSender::sendMail(
-    std::vector<std::array<uint8_t, 3>> ch0,
-    std::vector<std::array<uint8_t, 3>> ch1,
-    int node) {
+    const SampleVector& ch0,
+    const SampleVector& ch1,
+    int node,
+    unsigned int device,
+    uint64_t time_us) {
 
-    // Prepare the FlatBufferBuilder
-    flatbuffers::FlatBufferBuilder builder(1024);
-
-    // Convert data to FlatBuffers format
-    std::vector<SerialMail::Value> raw_input_bytes_ch0 = convertToSerialMailValues(ch0);
-    std::vector<SerialMail::Value> raw_input_bytes_ch1 = convertToSerialMailValues(ch1);
-    auto ch0_flatbuffers = builder.CreateVectorOfStructs(raw_input_bytes_ch0.data(), raw_input_bytes_ch0.size());
-    auto ch1_flatbuffers = builder.CreateVectorOfStructs(raw_input_bytes_ch1.data(), raw_input_bytes_ch1.size());
+#if defined(LATENCY_STATS)
+    uint32_t start_us = LatencyStats::now_us();
+#endif
+    m_mutex.lock();
+#if defined(ADAPTIVE_BATCHING)
+    m_batcher.onBacklog(m_dispatcher.backlog());
+#endif
+    FrameRef frame = m_frame_pool.allocate();
+    if (!frame) {
+        m_dispatcher.service();
+        frame = m_frame_pool.allocate();
+    }
 
-    // Create the SerialMail object
-    auto orc = SerialMail::CreateSerialMail(builder, ch0_flatbuffers, ch1_flatbuffers, node);
-    builder.Finish(orc);
+    if (frame) {
+#if defined(CLOCK_SYNC)
+        size_t size = m_frame_builder.build(ch0, ch1, node, frame.mutableData(), FRAME_BUFFER_CAPACITY, device,
+                                            time_us);
+#else
+        (void)time_us;
+        size_t size = m_frame_builder.build(ch0, ch1, node, frame.mutableData(), FRAME_BUFFER_CAPACITY, device);
+#endif
+        if (size > 0) {
+            frame.setSize(size);
+            m_dispatcher.publish(frame, TRAFFIC_SAMPLES);
+#if defined(WARM_RESTART) && defined(RAW_FRAMES)
+            if (m_retained) {
+                m_retained->setSequence(m_frame_builder.sequence());
+            }
+#endif
+#if defined(LATENCY_STATS)
+            LatencyStats::getInstance().record(LATENCY_STAGE_BUILD, start_us);
+#endif
+        } else {
+            WARN("Frame exceeds %d bytes, dropped.", FRAME_BUFFER_CAPACITY);
+        }
+    } else {
+        m_dropped_frames++;
+    }
+#if defined(TX_SCHEDULER)
+    publishMessageChunks();
+#endif
+    m_dispatcher.service();
+    m_mutex.unlock();
+}
 
-    // Get the buffer pointer and size
-    uint8_t* buf = builder.GetBufferPointer();
-    uint32_t size = builder.GetSize();
+void SerialMailSender::sendRaw(const uint8_t* data, size_t size, TrafficClass traffic_class) {
+    if (size > FRAME_BUFFER_CAPACITY) {
+        WARN("Raw frame exceeds %d bytes, dropped.", FRAME_BUFFER_CAPACITY);
+        return;
+    }
 
-    // Send a synchronization marker (e.g., 0xAAAA)
-    uint16_t sync_marker = 0xAAAA;
-    m_serial_port.write(reinterpret_cast<const char*>(&sync_marker), sizeof(sync_marker));
+    m_mutex.lock();
+    FrameRef frame = m_frame_pool.allocate();
+    if (frame) {
+        memcpy(frame.mutableData(), data, size);
+        frame.setSize(size);
+        m_dispatcher.publish(frame, traffic_class);
+    } else {
+        m_dropped_frames++;
+    }
+    m_dispatcher.service();
+    m_mutex.unlock();
+}
 
+#if defined(BAND_POWER)
+/**
+ * @details
+ * The frame is written directly into a pooled buffer, like `sendMail`; it is
+ * small and sent once per analysis window, so no pool retry is attempted.
+ */
+void SerialMailSender::sendBandPowers(const BandPowers& powers, int node) {
+    m_mutex.lock();
+    FrameRef frame = m_frame_pool.allocate();
+    if (frame) {
+        frame.setSize(build_band_frame(powers, node, frame.mutableData(), FRAME_BUFFER_CAPACITY));
+        m_dispatcher.publish(frame, TRAFFIC_SAMPLES);
+    } else {
+        m_dropped_frames++;
+    }
+    m_dispatcher.service();
+    m_mutex.unlock();
+}
+#endif
 
-    // Send the size (4 bytes)
-    m_serial_port.write(reinterpret_cast<const char*>(&size), sizeof(size));
+#if defined(LATENCY_STATS)
+/**
+ * @details
+ * Each frame goes into its own pooled buffer; about 70 non-empty buckets
+ * fit into one frame, so a narrow stage needs one frame and a wide one two or
+ * three. A frame that finds the pool empty is lost, the host then sees an
+ * incomplete report and drops it.
+ */
+void SerialMailSender::sendLatencyReport(const LatencySnapshot& snapshot, const LatencyReport& report) {
+    m_mutex.lock();
+    size_t bucket = 0;
+    do {
+        FrameRef frame = m_frame_pool.allocate();
+        if (!frame) {
+            m_dispatcher.service();
+            frame = m_frame_pool.allocate();
+        }
+        if (!frame) {
+            m_dropped_frames++;
+            break;
+        }
+        frame.setSize(build_latency_frame(snapshot, report, bucket, frame.mutableData(), FRAME_BUFFER_CAPACITY,
+                                          &bucket));
+        m_dispatcher.publish(frame, TRAFFIC_STATUS);
+        m_dispatcher.service();
+    } while (bucket < LATENCY_HISTOGRAM_BUCKETS);
+    m_mutex.unlock();
+}
+#endif
 
-    // Send the FlatBuffers buffer
-    m_serial_port.write(reinterpret_cast<const char*>(buf), size);
+#if defined(TX_SCHEDULER)
+bool SerialMailSender::sendMessage(TrafficClass traffic_class, uint8_t kind, const uint8_t* data, size_t size,
+                                   int node) {
+    m_mutex.lock();
+    PendingMessage& message = m_messages[traffic_class];
+    bool started = !message.active;
+    if (started) {
+        message.data = data;
+        message.header = MessageHeader{node, kind, m_message_id++, (uint32_t)size};
+        message.offset = 0;
+        message.active = true;
+        publishMessageChunks();
+        m_dispatcher.service();
+    }
+    m_mutex.unlock();
+    return started;
+}
 
-    //printf("send\n");
+bool SerialMailSender::messagePending(TrafficClass traffic_class) {
+    m_mutex.lock();
+    bool pending = m_messages[traffic_class].active;
+    m_mutex.unlock();
+    return pending;
+}
 
-    // Log message details
-    // auto now = Kernel::Clock::now().time_since_epoch();
-    // auto seconds = std::chrono::duration_cast<std::chrono::seconds>(now).count();
-    // auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(now).count() % 1000;
+/**
+ * @details
+ * A chunk is only cut while every sink whose link is up can queue it, so
+ * no chunk is lost to a full queue and the pool keeps buffers for samples.
+ * Sinks with a scheduler accept as long as the class queue has room; the
+ * scheduler then decides when the chunks go out.
+ */
+void SerialMailSender::publishMessageChunks(void) {
+    for (size_t i = 0; i < TRAFFIC_CLASS_COUNT; i++) {
+        PendingMessage& message = m_messages[i];
+        while (message.active && m_dispatcher.canAccept((TrafficClass)i)) {
+            FrameRef frame = m_frame_pool.allocate();
+            if (!frame) {
+                return;
+            }
+            frame.setSize(build_message_frame(message.header, message.data, message.offset,
+                                              SERIAL_MAIL_MESSAGE_CHUNK_SIZE, frame.mutableData(),
+                                              FRAME_BUFFER_CAPACITY, &message.offset));
+            m_dispatcher.publish(frame, (TrafficClass)i);
+            message.active = message.offset < message.header.size;
+        }
+    }
+}
+#endif
 
-    // printf("Serial Mail(size:%lu) sent at: %lld seconds and %lld milliseconds\n", size, seconds, milliseconds);
+void SerialMailSender::service(void) {
+    m_mutex.lock();
+#if defined(TX_SCHEDULER)
+    publishMessageChunks();
+#endif
+    m_dispatcher.service();
+    m_mutex.unlock();
 }
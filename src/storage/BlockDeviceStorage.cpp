@@ -0,0 +1,45 @@
+/**
+ * @file BlockDeviceStorage.cpp
+ * @brief Implementation of the BlockDeviceStorage adapter.
+ */
+
+#include "storage/BlockDeviceStorage.h"
+
+BlockDeviceStorage::BlockDeviceStorage(mbed::BlockDevice& block_device) : m_block_device(block_device) {
+}
+
+int BlockDeviceStorage::init(void) {
+    return m_block_device.init();
+}
+
+int BlockDeviceStorage::read(void* buffer, uint32_t address, uint32_t size) {
+    return m_block_device.read(buffer, address, size);
+}
+
+int BlockDeviceStorage::program(const void* buffer, uint32_t address, uint32_t size) {
+    return m_block_device.program(buffer, address, size);
+}
+
+int BlockDeviceStorage::erase(uint32_t address, uint32_t size) {
+    return m_block_device.erase(address, size);
+}
+
+uint32_t BlockDeviceStorage::programSize(void) const {
+    return (uint32_t)m_block_device.get_program_size();
+}
+
+/**
+ * @brief Size of the erase unit at the start of the device.
+ *
+ * @details
+ * The log needs uniform sectors; devices with mixed sector sizes report their
+ * largest unit through `get_erase_size()` and are handled correctly as long as
+ * the log area lies in a uniform region.
+ */
+uint32_t BlockDeviceStorage::eraseSize(void) const {
+    return (uint32_t)m_block_device.get_erase_size();
+}
+
+uint32_t BlockDeviceStorage::size(void) const {
+    return (uint32_t)m_block_device.size();
+}
@@ -0,0 +1,313 @@
+/**
+ * @file FlashRingLog.cpp
+ * @brief Implementation of the FlashRingLog class.
+ */
+
+#include "storage/FlashRingLog.h"
+
+#include <cstring>
+
+/// Erased flash content.
+#define FLASH_ERASED_BYTE 0xFF
+
+/// Chunk size used to check a sector for being erased.
+#define BLANK_CHECK_CHUNK 64
+
+uint32_t flash_log_crc32(const uint8_t* data, size_t size) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < size; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+FlashRingLog::FlashRingLog(FlashStorage& storage)
+    : m_storage(storage), m_sector_size(0), m_sector_count(0), m_program_size(1),
+      m_head_sector(0), m_head_offset(0), m_sequence(0), m_tail_sector(0), m_tail_offset(0),
+      m_front_valid(false), m_front_size(0), m_stats{0, 0, 0, 0, 0} {
+}
+
+uint32_t FlashRingLog::align(uint32_t size) const {
+    return (size + m_program_size - 1) / m_program_size * m_program_size;
+}
+
+uint32_t FlashRingLog::address(uint32_t sector, uint32_t offset) const {
+    return sector * m_sector_size + offset;
+}
+
+/**
+ * @brief Finds the newest and the oldest valid sector.
+ *
+ * @details
+ * The newest sector continues to be written after its last intact record. The
+ * oldest one is read from its beginning, because the read position inside a
+ * sector is not persisted.
+ */
+int FlashRingLog::mount(void) {
+    m_sector_size = m_storage.eraseSize();
+    m_program_size = m_storage.programSize();
+    m_sector_count = (m_sector_size > 0) ? m_storage.size() / m_sector_size : 0;
+    m_front_valid = false;
+    m_stats = FlashLogStats{0, 0, 0, 0, 0};
+
+    if (m_program_size == 0 || m_program_size > FLASH_LOG_MAX_PROGRAM_SIZE || m_sector_count < 2 ||
+        m_sector_size < align(sizeof(FlashLogSectorHeader)) +
+                        align(sizeof(FlashLogRecordHeader) + FLASH_LOG_MAX_RECORD_SIZE)) {
+        return -1;
+    }
+
+    bool found = false;
+    uint32_t newest = 0;
+    uint32_t oldest = 0;
+    uint32_t newest_sequence = 0;
+    uint32_t oldest_sequence = 0;
+    for (uint32_t sector = 0; sector < m_sector_count; sector++) {
+        FlashLogSectorHeader header;
+        if (m_storage.read(&header, address(sector, 0), sizeof(header)) != 0 ||
+            header.magic != FLASH_LOG_SECTOR_MAGIC) {
+            continue;
+        }
+        if (!found || (int32_t)(header.sequence - newest_sequence) > 0) {
+            newest = sector;
+            newest_sequence = header.sequence;
+        }
+        if (!found || (int32_t)(header.sequence - oldest_sequence) < 0) {
+            oldest = sector;
+            oldest_sequence = header.sequence;
+        }
+        found = true;
+    }
+
+    if (!found) {
+        return format();
+    }
+
+    m_head_sector = newest;
+    m_sequence = newest_sequence;
+    m_head_offset = findWriteOffset(newest);
+    m_tail_sector = oldest;
+    m_tail_offset = align(sizeof(FlashLogSectorHeader));
+    normalizeTail();
+    return 0;
+}
+
+int FlashRingLog::format(void) {
+    if (m_sector_count == 0) {
+        return -1;
+    }
+    int error = m_storage.erase(0, m_sector_count * m_sector_size);
+    if (error != 0) {
+        return error;
+    }
+    m_stats.erases += m_sector_count;
+    m_sequence = 0;
+    m_front_valid = false;
+
+    error = openSector(0);
+    m_tail_sector = m_head_sector;
+    m_tail_offset = m_head_offset;
+    return error;
+}
+
+/**
+ * @brief Reads and checks a record header.
+ * @return True if a plausible record starts at `offset`.
+ */
+bool FlashRingLog::readRecordHeader(uint32_t sector, uint32_t offset, FlashLogRecordHeader* header) {
+    if (offset + sizeof(FlashLogRecordHeader) > m_sector_size ||
+        m_storage.read(header, address(sector, offset), sizeof(FlashLogRecordHeader)) != 0) {
+        return false;
+    }
+    return header->marker == FLASH_LOG_RECORD_MARKER &&
+           header->length <= FLASH_LOG_MAX_RECORD_SIZE &&
+           offset + align(sizeof(FlashLogRecordHeader) + header->length) <= m_sector_size;
+}
+
+bool FlashRingLog::isBlank(uint32_t sector) {
+    uint8_t chunk[BLANK_CHECK_CHUNK];
+    for (uint32_t offset = 0; offset < m_sector_size; offset += sizeof(chunk)) {
+        uint32_t size = (m_sector_size - offset < sizeof(chunk)) ? m_sector_size - offset : sizeof(chunk);
+        if (m_storage.read(chunk, address(sector, offset), size) != 0) {
+            return false;
+        }
+        for (uint32_t i = 0; i < size; i++) {
+            if (chunk[i] != FLASH_ERASED_BYTE) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int FlashRingLog::eraseSector(uint32_t sector) {
+    m_stats.erases++;
+    return m_storage.erase(address(sector, 0), m_sector_size);
+}
+
+/**
+ * @brief Starts writing a sector with the next sequence number.
+ *
+ * @details
+ * Sectors drained by the reader were erased right away, so the erase is
+ * skipped for sectors that are still blank.
+ */
+int FlashRingLog::openSector(uint32_t sector) {
+    if (!isBlank(sector)) {
+        int error = eraseSector(sector);
+        if (error != 0) {
+            return error;
+        }
+    }
+
+    uint8_t header[FLASH_LOG_MAX_PROGRAM_SIZE > sizeof(FlashLogSectorHeader) ?
+                   FLASH_LOG_MAX_PROGRAM_SIZE : sizeof(FlashLogSectorHeader)];
+    FlashLogSectorHeader sector_header{FLASH_LOG_SECTOR_MAGIC, m_sequence + 1};
+    memset(header, FLASH_ERASED_BYTE, sizeof(header));
+    memcpy(header, &sector_header, sizeof(sector_header));
+
+    uint32_t size = align(sizeof(FlashLogSectorHeader));
+    int error = m_storage.program(header, address(sector, 0), size);
+    if (error != 0) {
+        return error;
+    }
+    m_sequence++;
+    m_head_sector = sector;
+    m_head_offset = size;
+    return 0;
+}
+
+/**
+ * @brief Walks the records of a sector up to the first erased header.
+ *
+ * @details
+ * A header that is neither a record nor erased flash is the remainder of an
+ * interrupted write; the sector is then treated as full so no record is ever
+ * programmed over it.
+ */
+uint32_t FlashRingLog::findWriteOffset(uint32_t sector) {
+    uint32_t offset = align(sizeof(FlashLogSectorHeader));
+    while (true) {
+        FlashLogRecordHeader header;
+        if (readRecordHeader(sector, offset, &header)) {
+            offset += align(sizeof(FlashLogRecordHeader) + header.length);
+            continue;
+        }
+        if (offset + sizeof(header) > m_sector_size) {
+            return m_sector_size;
+        }
+
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&header);
+        for (size_t i = 0; i < sizeof(header); i++) {
+            if (bytes[i] != FLASH_ERASED_BYTE) {
+                return m_sector_size;
+            }
+        }
+        return offset;
+    }
+}
+
+/**
+ * @brief Appends a record, moving to the next sector when the current one is full.
+ *
+ * @details
+ * If the next sector still holds unread records the ring is full and that
+ * sector, the oldest one, is given up.
+ */
+bool FlashRingLog::append(const uint8_t* data, size_t size) {
+    if (m_sector_count == 0 || size > FLASH_LOG_MAX_RECORD_SIZE) {
+        return false;
+    }
+
+    uint32_t record_size = align(sizeof(FlashLogRecordHeader) + size);
+    if (m_head_offset + record_size > m_sector_size) {
+        uint32_t next = (m_head_sector + 1) % m_sector_count;
+        if (next == m_tail_sector) {
+            m_stats.overwritten++;
+            m_tail_sector = (next + 1) % m_sector_count;
+            m_tail_offset = align(sizeof(FlashLogSectorHeader));
+        }
+        if (openSector(next) != 0) {
+            return false;
+        }
+    }
+
+    m_front_valid = false;
+    FlashLogRecordHeader header{FLASH_LOG_RECORD_MARKER, (uint16_t)size, flash_log_crc32(data, size)};
+    memcpy(m_record, &header, sizeof(header));
+    memcpy(m_record + sizeof(header), data, size);
+    memset(m_record + sizeof(header) + size, FLASH_ERASED_BYTE, record_size - sizeof(header) - size);
+
+    if (m_storage.program(m_record, address(m_head_sector, m_head_offset), record_size) != 0) {
+        // Never program over a possibly half-written record
+        m_head_offset = m_sector_size;
+        return false;
+    }
+    m_head_offset += record_size;
+    m_stats.appended++;
+    return true;
+}
+
+bool FlashRingLog::empty(void) const {
+    return m_tail_sector == m_head_sector && m_tail_offset >= m_head_offset;
+}
+
+/**
+ * @brief Moves the read position past fully read sectors and erases them.
+ */
+void FlashRingLog::normalizeTail(void) {
+    while (m_tail_sector != m_head_sector) {
+        FlashLogRecordHeader header;
+        if (readRecordHeader(m_tail_sector, m_tail_offset, &header)) {
+            return;
+        }
+        eraseSector(m_tail_sector);
+        m_tail_sector = (m_tail_sector + 1) % m_sector_count;
+        m_tail_offset = align(sizeof(FlashLogSectorHeader));
+    }
+}
+
+const uint8_t* FlashRingLog::front(size_t* size) {
+    while (!empty()) {
+        if (m_front_valid) {
+            *size = m_front_size;
+            return m_record + sizeof(FlashLogRecordHeader);
+        }
+
+        FlashLogRecordHeader header;
+        if (!readRecordHeader(m_tail_sector, m_tail_offset, &header)) {
+            if (m_tail_sector == m_head_sector) {
+                m_tail_offset = m_head_offset;
+            } else {
+                normalizeTail();
+            }
+            continue;
+        }
+
+        uint8_t* payload = m_record + sizeof(FlashLogRecordHeader);
+        if (m_storage.read(payload, address(m_tail_sector, m_tail_offset + sizeof(header)), header.length) != 0 ||
+            flash_log_crc32(payload, header.length) != header.crc) {
+            m_stats.corrupt++;
+            m_tail_offset += align(sizeof(FlashLogRecordHeader) + header.length);
+            normalizeTail();
+            continue;
+        }
+
+        m_front_valid = true;
+        m_front_size = header.length;
+    }
+    return nullptr;
+}
+
+void FlashRingLog::pop(void) {
+    size_t size;
+    if (front(&size) == nullptr) {
+        return;
+    }
+    m_tail_offset += align(sizeof(FlashLogRecordHeader) + size);
+    m_front_valid = false;
+    m_stats.read++;
+    normalizeTail();
+}
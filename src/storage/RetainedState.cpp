@@ -0,0 +1,227 @@
+/**
+ * @file RetainedState.cpp
+ * @brief Implementation of the RetainedState class.
+ */
+
+#include "storage/RetainedState.h"
+
+#include <cstddef>
+#include <cstring>
+
+#include "storage/FlashRingLog.h"
+
+/// Ring offsets and record sizes are multiples of this.
+#define RETAINED_ALIGN 4
+
+static_assert(RETAINED_RING_SIZE % RETAINED_ALIGN == 0, "Ring size must be a multiple of the alignment");
+static_assert(RETAINED_RING_SIZE >= 2 * (sizeof(RetainedRecordHeader) + RETAINED_MAX_RECORD_SIZE),
+              "Ring too small for two records of the largest size");
+
+static uint32_t record_size(size_t length) {
+    return (uint32_t)((sizeof(RetainedRecordHeader) + length + RETAINED_ALIGN - 1) / RETAINED_ALIGN * RETAINED_ALIGN);
+}
+
+RetainedState::RetainedState(RetainedArea& area)
+    : m_area(area), m_stats{0, 0, 0, 0, 0} {
+}
+
+uint32_t RetainedState::headerCrc(void) const {
+    return flash_log_crc32(reinterpret_cast<const uint8_t*>(&m_area), offsetof(RetainedArea, crc));
+}
+
+void RetainedState::seal(void) {
+    m_area.crc = headerCrc();
+}
+
+const RetainedRecordHeader* RetainedState::record(uint32_t offset) const {
+    return reinterpret_cast<const RetainedRecordHeader*>(m_area.ring + offset);
+}
+
+void RetainedState::format(void) {
+    m_area.magic = RETAINED_MAGIC;
+    m_area.layout = RETAINED_RING_SIZE;
+    m_area.boots = 0;
+    m_area.head = 0;
+    m_area.tail = 0;
+    m_area.sequence = 0;
+    memset(m_area.adc, 0, sizeof(m_area.adc));
+    m_area.adc_crc = ~flash_log_crc32(reinterpret_cast<const uint8_t*>(m_area.adc), sizeof(m_area.adc));
+    seal();
+}
+
+/**
+ * @details
+ * Walking from the tail, every record must have a known marker, fit into
+ * the ring and, unless released, match its CRC. The head is moved back to
+ * the first record that does not, so a frame cut by the reset or damaged
+ * RAM is never sent.
+ */
+bool RetainedState::recover(void) {
+    m_stats = RetainedStats{0, 0, 0, 0, 0};
+    if (m_area.magic != RETAINED_MAGIC || m_area.layout != RETAINED_RING_SIZE || m_area.crc != headerCrc() ||
+        m_area.head >= RETAINED_RING_SIZE || m_area.tail >= RETAINED_RING_SIZE ||
+        m_area.head % RETAINED_ALIGN != 0 || m_area.tail % RETAINED_ALIGN != 0) {
+        format();
+        return false;
+    }
+
+    uint32_t offset = m_area.tail;
+    while (offset != m_area.head) {
+        if (RETAINED_RING_SIZE - offset < sizeof(RetainedRecordHeader)) {
+            offset = 0;
+            continue;
+        }
+        const RetainedRecordHeader* header = record(offset);
+        if (header->marker == RETAINED_RECORD_WRAP && m_area.head < offset) {
+            offset = 0;
+            continue;
+        }
+        uint32_t size = record_size(header->length);
+        bool known = header->marker == RETAINED_RECORD_PENDING || header->marker == RETAINED_RECORD_RELEASED;
+        bool inside = header->length <= RETAINED_MAX_RECORD_SIZE && size <= RETAINED_RING_SIZE - offset &&
+                      (m_area.head < offset || offset + size <= m_area.head);
+        if (!known || !inside ||
+            (header->marker == RETAINED_RECORD_PENDING &&
+             header->crc != flash_log_crc32(m_area.ring + offset + sizeof(RetainedRecordHeader), header->length))) {
+            m_stats.corrupt++;
+            m_area.head = offset;
+            break;
+        }
+        if (header->marker == RETAINED_RECORD_PENDING) {
+            m_stats.recovered++;
+        }
+        offset += size;
+    }
+
+    m_area.boots++;
+    advanceTail();
+    seal();
+    return true;
+}
+
+/**
+ * @details
+ * The ring never fills up completely, so `head == tail` always means empty.
+ * A record that does not fit in front of the end of the ring starts at
+ * offset 0, behind a wrap marker if there is room for one. An empty ring
+ * starts over at offset 0.
+ */
+uint32_t RetainedState::append(const uint8_t* data, size_t size) {
+    if (size > RETAINED_MAX_RECORD_SIZE) {
+        m_stats.full++;
+        return 0;
+    }
+
+    if (m_area.head == m_area.tail) {
+        // Empty, start over so the tail never points at a wrap marker
+        m_area.head = 0;
+        m_area.tail = 0;
+    }
+
+    uint32_t needed = record_size(size);
+    uint32_t head = m_area.head;
+    uint32_t tail = m_area.tail;
+    bool wrap = false;
+    if (head >= tail) {
+        uint32_t room = RETAINED_RING_SIZE - head;
+        if (needed > room || (needed == room && tail == 0)) {
+            if (needed >= tail) {
+                m_stats.full++;
+                return 0;
+            }
+            wrap = true;
+        }
+    } else if (needed >= tail - head) {
+        m_stats.full++;
+        return 0;
+    }
+
+    if (wrap) {
+        if (RETAINED_RING_SIZE - head >= sizeof(RetainedRecordHeader)) {
+            RetainedRecordHeader marker{RETAINED_RECORD_WRAP, 0, 0};
+            memcpy(m_area.ring + head, &marker, sizeof(marker));
+        }
+        head = 0;
+    }
+
+    RetainedRecordHeader header{RETAINED_RECORD_PENDING, (uint16_t)size, flash_log_crc32(data, size)};
+    memcpy(m_area.ring + head, &header, sizeof(header));
+    memcpy(m_area.ring + head + sizeof(header), data, size);
+
+    uint32_t next = head + needed;
+    m_area.head = (next == RETAINED_RING_SIZE) ? 0 : next;
+    seal();
+    m_stats.appended++;
+    return head + 1;
+}
+
+void RetainedState::release(uint32_t handle) {
+    if (handle == 0 || handle > RETAINED_RING_SIZE) {
+        return;
+    }
+    RetainedRecordHeader* header = reinterpret_cast<RetainedRecordHeader*>(m_area.ring + handle - 1);
+    if (header->marker != RETAINED_RECORD_PENDING) {
+        return;
+    }
+    header->marker = RETAINED_RECORD_RELEASED;
+    m_stats.released++;
+    if (handle - 1 == m_area.tail) {
+        advanceTail();
+        seal();
+    }
+}
+
+/**
+ * @brief Moves the tail over released records and wrap markers.
+ */
+void RetainedState::advanceTail(void) {
+    uint32_t tail = m_area.tail;
+    while (tail != m_area.head) {
+        if (RETAINED_RING_SIZE - tail < sizeof(RetainedRecordHeader) ||
+            (record(tail)->marker == RETAINED_RECORD_WRAP && m_area.head < tail)) {
+            tail = 0;
+            continue;
+        }
+        if (record(tail)->marker != RETAINED_RECORD_RELEASED) {
+            break;
+        }
+        tail += record_size(record(tail)->length);
+        if (tail == RETAINED_RING_SIZE) {
+            tail = 0;
+        }
+    }
+    m_area.tail = tail;
+}
+
+const uint8_t* RetainedState::front(size_t* size) const {
+    if (m_area.tail == m_area.head) {
+        return nullptr;
+    }
+    const RetainedRecordHeader* header = record(m_area.tail);
+    *size = header->length;
+    return m_area.ring + m_area.tail + sizeof(RetainedRecordHeader);
+}
+
+void RetainedState::pop(void) {
+    if (m_area.tail != m_area.head) {
+        release(m_area.tail + 1);
+    }
+}
+
+void RetainedState::setSequence(uint32_t sequence) {
+    m_area.sequence = sequence;
+    seal();
+}
+
+bool RetainedState::adcConfig(uint32_t* words) const {
+    if (m_area.adc_crc != flash_log_crc32(reinterpret_cast<const uint8_t*>(m_area.adc), sizeof(m_area.adc))) {
+        return false;
+    }
+    memcpy(words, m_area.adc, sizeof(m_area.adc));
+    return true;
+}
+
+void RetainedState::setAdcConfig(const uint32_t* words) {
+    memcpy(m_area.adc, words, sizeof(m_area.adc));
+    m_area.adc_crc = flash_log_crc32(reinterpret_cast<const uint8_t*>(m_area.adc), sizeof(m_area.adc));
+}
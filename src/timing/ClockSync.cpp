@@ -0,0 +1,267 @@
+/**
+ * @file ClockSync.cpp
+ * @brief Implementation of the sync messages and the ClockSync estimator.
+ */
+
+#include "timing/ClockSync.h"
+
+#include <algorithm>
+
+/// Offset of the exchange identifier in a sync request.
+#define SYNC_REQUEST_ID_OFFSET 2
+
+/// Offset of T1 in a sync request.
+#define SYNC_REQUEST_T1_OFFSET 6
+
+/// Offset of the previous exchange identifier in a sync request.
+#define SYNC_REQUEST_DONE_ID_OFFSET 14
+
+/// Offset of the previous T4 in a sync request.
+#define SYNC_REQUEST_DONE_T4_OFFSET 18
+
+/// Offset of the node identifier in a sync response.
+#define SYNC_RESPONSE_NODE_OFFSET 1
+
+/// Offset of the flags in a sync response.
+#define SYNC_RESPONSE_FLAGS_OFFSET 3
+
+/// Offset of the exchange identifier in a sync response.
+#define SYNC_RESPONSE_ID_OFFSET 4
+
+/// Offset of T2 in a sync response.
+#define SYNC_RESPONSE_T2_OFFSET 8
+
+/// Offset of T3 in a sync response.
+#define SYNC_RESPONSE_T3_OFFSET 16
+
+/// Offset of the skew in a sync response.
+#define SYNC_RESPONSE_SKEW_OFFSET 24
+
+/// Squared spread of the sample times below which the skew is not re-estimated, in us^2 (about 10 s).
+#define CLOCK_SYNC_MIN_SPREAD 1e14
+
+static void put_le(uint8_t* out, uint64_t value, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        out[i] = (value >> (8 * i)) & 0xFF;
+    }
+}
+
+static uint64_t get_le(const uint8_t* in, size_t size) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < size; i++) {
+        value |= (uint64_t)in[i] << (8 * i);
+    }
+    return value;
+}
+
+/**
+ * @brief Writes the frame header for a payload of `size` bytes.
+ * @return Start of the payload.
+ */
+static uint8_t* put_frame_header(uint8_t* out, size_t size) {
+    put_le(out, SERIAL_MAIL_SYNC_MARKER, SERIAL_MAIL_SYNC_SIZE);
+    put_le(out + SERIAL_MAIL_SYNC_SIZE, size, SERIAL_MAIL_LENGTH_SIZE);
+    return out + SERIAL_MAIL_HEADER_SIZE;
+}
+
+size_t write_sync_request(const SyncRequest& request, uint8_t* out, size_t capacity) {
+    if (capacity < SERIAL_MAIL_HEADER_SIZE + SYNC_REQUEST_SIZE) {
+        return 0;
+    }
+    uint8_t* payload = put_frame_header(out, SYNC_REQUEST_SIZE);
+    payload[0] = SYNC_REQUEST_VERSION;
+    payload[1] = 0;
+    put_le(payload + SYNC_REQUEST_ID_OFFSET, request.id, 4);
+    put_le(payload + SYNC_REQUEST_T1_OFFSET, request.t1_us, 8);
+    put_le(payload + SYNC_REQUEST_DONE_ID_OFFSET, request.done_id, 4);
+    put_le(payload + SYNC_REQUEST_DONE_T4_OFFSET, request.done_t4_us, 8);
+    return SERIAL_MAIL_HEADER_SIZE + SYNC_REQUEST_SIZE;
+}
+
+bool read_sync_request(const uint8_t* payload, size_t size, SyncRequest* request) {
+    if (size != SYNC_REQUEST_SIZE || payload[0] != SYNC_REQUEST_VERSION) {
+        return false;
+    }
+    request->id = (uint32_t)get_le(payload + SYNC_REQUEST_ID_OFFSET, 4);
+    request->t1_us = get_le(payload + SYNC_REQUEST_T1_OFFSET, 8);
+    request->done_id = (uint32_t)get_le(payload + SYNC_REQUEST_DONE_ID_OFFSET, 4);
+    request->done_t4_us = get_le(payload + SYNC_REQUEST_DONE_T4_OFFSET, 8);
+    return request->id != 0;
+}
+
+size_t write_sync_response(const SyncResponse& response, uint8_t* out, size_t capacity) {
+    if (capacity < SERIAL_MAIL_HEADER_SIZE + SYNC_RESPONSE_SIZE) {
+        return 0;
+    }
+    uint8_t* payload = put_frame_header(out, SYNC_RESPONSE_SIZE);
+    payload[0] = SYNC_RESPONSE_VERSION;
+    put_le(payload + SYNC_RESPONSE_NODE_OFFSET, (uint16_t)response.node, 2);
+    payload[SYNC_RESPONSE_FLAGS_OFFSET] = response.flags;
+    put_le(payload + SYNC_RESPONSE_ID_OFFSET, response.id, 4);
+    put_le(payload + SYNC_RESPONSE_T2_OFFSET, response.t2_us, 8);
+    put_le(payload + SYNC_RESPONSE_T3_OFFSET, response.t3_us, 8);
+    put_le(payload + SYNC_RESPONSE_SKEW_OFFSET, (uint32_t)response.skew_ppb, 4);
+    return SERIAL_MAIL_HEADER_SIZE + SYNC_RESPONSE_SIZE;
+}
+
+bool read_sync_response(const uint8_t* payload, size_t size, SyncResponse* response) {
+    if (size != SYNC_RESPONSE_SIZE || payload[0] != SYNC_RESPONSE_VERSION) {
+        return false;
+    }
+    response->node = (int32_t)get_le(payload + SYNC_RESPONSE_NODE_OFFSET, 2);
+    response->flags = payload[SYNC_RESPONSE_FLAGS_OFFSET];
+    response->id = (uint32_t)get_le(payload + SYNC_RESPONSE_ID_OFFSET, 4);
+    response->t2_us = get_le(payload + SYNC_RESPONSE_T2_OFFSET, 8);
+    response->t3_us = get_le(payload + SYNC_RESPONSE_T3_OFFSET, 8);
+    response->skew_ppb = (int32_t)(uint32_t)get_le(payload + SYNC_RESPONSE_SKEW_OFFSET, 4);
+    return true;
+}
+
+SyncRequestParser::SyncRequestParser(void) : m_length(0), m_request{0, 0, 0, 0} {
+}
+
+/**
+ * @details
+ * The marker is matched byte by byte, the length field must announce a sync
+ * request; any mismatch drops the bytes collected so far.
+ */
+bool SyncRequestParser::feed(uint8_t byte) {
+    if (m_length < SERIAL_MAIL_SYNC_SIZE && byte != SERIAL_MAIL_SYNC_BYTE) {
+        m_length = 0;
+        return false;
+    }
+
+    m_buffer[m_length++] = byte;
+    if (m_length == SERIAL_MAIL_HEADER_SIZE &&
+        get_le(m_buffer + SERIAL_MAIL_SYNC_SIZE, SERIAL_MAIL_LENGTH_SIZE) != SYNC_REQUEST_SIZE) {
+        m_length = 0;
+        return false;
+    }
+    if (m_length < sizeof(m_buffer)) {
+        return false;
+    }
+
+    m_length = 0;
+    return read_sync_request(m_buffer + SERIAL_MAIL_HEADER_SIZE, SYNC_REQUEST_SIZE, &m_request);
+}
+
+ClockSync::ClockSync(uint32_t delay_margin_us)
+    : m_delay_margin_us(delay_margin_us), m_history{}, m_next(0), m_samples(0), m_missed(0),
+      m_pending{0, 0, 0, 0}, m_pending_t2_us(0), m_pending_t3_us(0), m_reference_us(0), m_offset_us(0),
+      m_skew_ppb(0) {
+}
+
+/**
+ * @details
+ * The previous exchange is complete if the request carries its identifier
+ * and T4; otherwise its request or response was lost and it is only counted.
+ * A T2 derived from a late receive stamp can lie after T3; it is limited to
+ * T3, which only lengthens the measured delay.
+ */
+SyncResponse ClockSync::respond(const SyncRequest& request, uint64_t t2_us, uint64_t t3_us, int node) {
+    if (t2_us > t3_us) {
+        t2_us = t3_us;
+    }
+    if (m_pending.id != 0) {
+        if (request.done_id == m_pending.id && request.done_t4_us != 0) {
+            int64_t t1 = (int64_t)m_pending.t1_us;
+            int64_t t2 = (int64_t)m_pending_t2_us;
+            int64_t t3 = (int64_t)m_pending_t3_us;
+            int64_t t4 = (int64_t)request.done_t4_us;
+            addSample(Sample{m_pending_t2_us + (m_pending_t3_us - m_pending_t2_us) / 2,
+                             ((t1 - t2) + (t4 - t3)) / 2, (t4 - t1) - (t3 - t2)});
+        } else {
+            m_missed++;
+        }
+    }
+
+    m_pending = request;
+    m_pending_t2_us = t2_us;
+    m_pending_t3_us = t3_us;
+    return SyncResponse{node, (uint8_t)(synced() ? SYNC_FLAG_SYNCED : 0), request.id, t2_us, t3_us, m_skew_ppb};
+}
+
+uint64_t ClockSync::toHostTime(uint64_t local_us) const {
+    if (!synced()) {
+        return 0;
+    }
+    int64_t elapsed = (int64_t)(local_us - m_reference_us);
+    return local_us + m_offset_us + elapsed * m_skew_ppb / 1000000000;
+}
+
+void ClockSync::addSample(const Sample& sample) {
+    if (synced()) {
+        int64_t predicted = (int64_t)toHostTime(sample.local_us) - (int64_t)sample.local_us;
+        int64_t deviation = sample.offset_us - predicted;
+        if (deviation > CLOCK_SYNC_STEP_US || deviation < -CLOCK_SYNC_STEP_US) {
+            m_samples = 0;
+            m_next = 0;
+            m_skew_ppb = 0;
+        }
+    }
+
+    m_history[m_next] = sample;
+    m_next = (m_next + 1) % CLOCK_SYNC_HISTORY;
+    m_samples++;
+    estimate();
+}
+
+/**
+ * @brief Fits offset and skew through the samples with the smallest delays.
+ *
+ * @details
+ * At least the `CLOCK_SYNC_MIN_FIT` samples with the smallest delays are
+ * used, so a single lucky exchange cannot pin the estimate. Times are taken
+ * relative to the newest sample, so the doubles only hold differences of a
+ * few minutes. While the accepted samples span too little time for a useful
+ * slope the previous skew is kept and only the offset is updated.
+ */
+void ClockSync::estimate(void) {
+    size_t count = m_samples < CLOCK_SYNC_HISTORY ? m_samples : CLOCK_SYNC_HISTORY;
+    const Sample& newest = m_history[(m_next + CLOCK_SYNC_HISTORY - 1) % CLOCK_SYNC_HISTORY];
+
+    int64_t delays[CLOCK_SYNC_HISTORY] = {};
+    for (size_t i = 0; i < count; i++) {
+        delays[i] = m_history[i].delay_us;
+    }
+    size_t fit = std::min(count, (size_t)CLOCK_SYNC_MIN_FIT);
+    std::nth_element(delays, delays + fit - 1, delays + count);
+    int64_t max_delay = delays[fit - 1];
+    int64_t min_delay = *std::min_element(delays, delays + fit);
+    if (max_delay < min_delay + (int64_t)m_delay_margin_us) {
+        max_delay = min_delay + (int64_t)m_delay_margin_us;
+    }
+
+    double n = 0, sum_x = 0, sum_y = 0, sum_xx = 0, sum_xy = 0;
+    for (size_t i = 0; i < count; i++) {
+        const Sample& sample = m_history[i];
+        if (sample.delay_us > max_delay) {
+            continue;
+        }
+        double x = (double)(int64_t)(sample.local_us - newest.local_us);
+        double y = (double)(sample.offset_us - newest.offset_us);
+        n += 1;
+        sum_x += x;
+        sum_y += y;
+        sum_xx += x * x;
+        sum_xy += x * y;
+    }
+
+    double mean_x = sum_x / n;
+    double mean_y = sum_y / n;
+    double spread = sum_xx - n * mean_x * mean_x;
+    double slope = m_skew_ppb * 1e-9;
+    if (n >= 2 && spread > CLOCK_SYNC_MIN_SPREAD) {
+        slope = (sum_xy - n * mean_x * mean_y) / spread;
+        if (slope > CLOCK_SYNC_MAX_SKEW_PPB * 1e-9) {
+            slope = CLOCK_SYNC_MAX_SKEW_PPB * 1e-9;
+        } else if (slope < -CLOCK_SYNC_MAX_SKEW_PPB * 1e-9) {
+            slope = -CLOCK_SYNC_MAX_SKEW_PPB * 1e-9;
+        }
+    }
+
+    m_skew_ppb = (int32_t)(slope * 1e9 + (slope >= 0 ? 0.5 : -0.5));
+    m_reference_us = newest.local_us;
+    double intercept = mean_y - slope * mean_x;
+    m_offset_us = newest.offset_us + (int64_t)(intercept + (intercept >= 0 ? 0.5 : -0.5));
+}
@@ -0,0 +1,65 @@
+/**
+ * @file BlePacker.cpp
+ * @brief Implementation of the BlePacker class.
+ */
+
+#include "transport/BlePacker.h"
+
+#include <algorithm>
+#include <cstring>
+
+BlePacker::BlePacker(void)
+    : m_head(0), m_size(0), m_notification_size(0), m_sequence(0) {
+    setAttMtu(BLE_DEFAULT_ATT_MTU);
+}
+
+void BlePacker::setAttMtu(uint16_t att_mtu) {
+    size_t value_size = (att_mtu > BLE_ATT_HEADER_SIZE) ? att_mtu - BLE_ATT_HEADER_SIZE : 0;
+    m_notification_size = std::min<size_t>(value_size, BLE_MAX_NOTIFICATION_SIZE);
+}
+
+/**
+ * @brief Copies the frame into the ring buffer, wrapping at the end.
+ */
+bool BlePacker::push(const uint8_t* frame, size_t size) {
+    if (size > m_buffer.size() - m_size) {
+        return false;
+    }
+
+    size_t tail = (m_head + m_size) % m_buffer.size();
+    size_t first = std::min(size, m_buffer.size() - tail);
+    memcpy(&m_buffer[tail], frame, first);
+    memcpy(&m_buffer[0], frame + first, size - first);
+    m_size += size;
+    return true;
+}
+
+/**
+ * @brief Emits a notification made of the sequence byte and the oldest pending bytes.
+ *
+ * @details
+ * Without `flush` only full notifications are emitted, so several small frames
+ * share one notification and the MTU is used completely.
+ */
+size_t BlePacker::pull(uint8_t* notification, bool flush) {
+    size_t capacity = m_notification_size - BLE_PACKET_HEADER_SIZE;
+    if (m_size == 0 || (m_size < capacity && !flush)) {
+        return 0;
+    }
+
+    size_t count = std::min(m_size, capacity);
+    size_t first = std::min(count, m_buffer.size() - m_head);
+
+    notification[0] = m_sequence++;
+    memcpy(notification + BLE_PACKET_HEADER_SIZE, &m_buffer[m_head], first);
+    memcpy(notification + BLE_PACKET_HEADER_SIZE + first, &m_buffer[0], count - first);
+
+    m_head = (m_head + count) % m_buffer.size();
+    m_size -= count;
+    return count + BLE_PACKET_HEADER_SIZE;
+}
+
+void BlePacker::clear(void) {
+    m_head = 0;
+    m_size = 0;
+}
@@ -0,0 +1,220 @@
+/**
+ * @file BleTransport.cpp
+ * @brief Implementation of the BleTransport class for sending frames as GATT notifications.
+ */
+
+#include "transport/BleTransport.h"
+#include "ble/gap/AdvertisingDataBuilder.h"
+#include "utils/logger.h"
+
+/// UUID of the PhytoNode service.
+#define PHYTO_SERVICE_UUID "6e7f0001-9a3b-4c8e-b2d5-3f1a0c7e5d01"
+
+/// UUID of the notify characteristic that carries the frame stream.
+#define PHYTO_FRAME_CHARACTERISTIC_UUID "6e7f0002-9a3b-4c8e-b2d5-3f1a0c7e5d01"
+
+/// Send interval used until the first connection interval is known.
+#define DEFAULT_SEND_INTERVAL_MS 30
+
+/**
+ * @brief Access the singleton instance of BleTransport.
+ *
+ * @return Reference to the single instance of BleTransport.
+ */
+BleTransport& BleTransport::getInstance(void) {
+    static BleTransport instance;
+    return instance;
+}
+
+/**
+ * @brief Constructs a BleTransport instance.
+ */
+BleTransport::BleTransport(void)
+    : FrameSink("ble", BACKPRESSURE_DROP_OLDEST, BLE_PACKER_BUFFER_SIZE),
+      m_ble(BLE::Instance()),
+      m_event_thread(osPriorityNormal, OS_STACK_SIZE, nullptr, "ble"),
+      m_service_uuid(PHYTO_SERVICE_UUID),
+      m_characteristic_uuid(PHYTO_FRAME_CHARACTERISTIC_UUID),
+      m_characteristic(m_characteristic_uuid, m_value, 0, sizeof(m_value),
+                       GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_NOTIFY),
+      m_subscribed(false), m_credits(BLE_NOTIFICATIONS_PER_EVENT), m_send_event(0),
+      m_idle_intervals(0), m_interval(DEFAULT_SEND_INTERVAL_MS) {
+}
+
+/**
+ * @brief Starts the BLE event thread and initializes the stack.
+ */
+void BleTransport::start(void) {
+    m_event_thread.start(callback(&m_event_queue, &EventQueue::dispatch_forever));
+    m_ble.onEventsToProcess(makeFunctionPointer(this, &BleTransport::scheduleBleEvents));
+    m_ble.init(this, &BleTransport::onInitComplete);
+}
+
+/**
+ * @brief Defers processing of BLE stack events to the transport's EventQueue.
+ */
+void BleTransport::scheduleBleEvents(BLE::OnEventsToProcessCallbackContext* context) {
+    m_event_queue.call(callback(&context->ble, &BLE::processEvents));
+}
+
+/**
+ * @brief Registers the GATT service and starts advertising once the stack is up.
+ */
+void BleTransport::onInitComplete(BLE::InitializationCompleteCallbackContext* params) {
+    if (params->error != BLE_ERROR_NONE) {
+        ERROR("BLE initialization failed: %d", params->error);
+        return;
+    }
+
+    m_ble.gap().setEventHandler(this);
+    m_ble.gattServer().setEventHandler(this);
+
+    GattCharacteristic* characteristics[] = {&m_characteristic};
+    GattService service(m_service_uuid, characteristics, 1);
+    m_ble.gattServer().addService(service);
+
+    startAdvertising();
+}
+
+void BleTransport::startAdvertising(void) {
+    ble::AdvertisingParameters adv_params(
+        ble::advertising_type_t::CONNECTABLE_UNDIRECTED,
+        ble::adv_interval_t(ble::millisecond_t(100)));
+
+    ble::AdvertisingDataBuilder adv_data(m_adv_buffer);
+    adv_data.setFlags();
+    adv_data.setName(BLE_DEVICE_NAME);
+
+    m_ble.gap().setAdvertisingParameters(ble::LEGACY_ADVERTISING_HANDLE, adv_params);
+    m_ble.gap().setAdvertisingPayload(ble::LEGACY_ADVERTISING_HANDLE, adv_data.getAdvertisingData());
+    m_ble.gap().startAdvertising(ble::LEGACY_ADVERTISING_HANDLE);
+    INFO("BLE advertising started.");
+}
+
+/**
+ * @brief Aligns the periodic send event with the connection interval.
+ * @param interval Connection interval reported by the stack.
+ */
+void BleTransport::restartSendEvent(ble::conn_interval_t interval) {
+    uint32_t interval_ms = interval.valueInMs();
+    m_interval = std::chrono::milliseconds(interval_ms > 0 ? interval_ms : 1);
+
+    if (m_send_event != 0) {
+        m_event_queue.cancel(m_send_event);
+    }
+    m_send_event = m_event_queue.call_every(m_interval, callback(this, &BleTransport::sendBurst));
+}
+
+bool BleTransport::linkUp(void) const {
+    return m_subscribed;
+}
+
+/**
+ * @brief Moves queued frame bytes into the packer.
+ *
+ * @details
+ * The packer takes all offered bytes or none. The sink budget equals the
+ * packer size, which lets one service call move several frames at once.
+ */
+size_t BleTransport::writeSome(const uint8_t* data, size_t size) {
+    m_mutex.lock();
+    bool queued = m_subscribed && m_packer.push(data, size);
+    m_mutex.unlock();
+    return queued ? size : 0;
+}
+
+/**
+ * @brief Hands up to the available credits of notifications to the controller.
+ *
+ * @details
+ * Runs once per connection interval. Full notifications are always sent; a
+ * partially filled notification is only sent when no more data arrived during
+ * a whole interval, which bounds the added latency to one interval while
+ * keeping notifications full under load.
+ */
+void BleTransport::sendBurst(void) {
+    m_mutex.lock();
+    if (!m_subscribed) {
+        m_mutex.unlock();
+        return;
+    }
+
+    bool flush = m_idle_intervals > 0;
+    while (m_credits > 0) {
+        size_t size = m_packer.pull(m_notification, flush);
+        if (size == 0) {
+            break;
+        }
+        ble_error_t error = m_ble.gattServer().write(m_characteristic.getValueHandle(), m_notification, size);
+        if (error != BLE_ERROR_NONE) {
+            WARN("BLE notification dropped: %d", error);
+            break;
+        }
+        m_credits--;
+    }
+    m_idle_intervals = (m_packer.pending() > 0) ? m_idle_intervals + 1 : 0;
+    m_mutex.unlock();
+}
+
+void BleTransport::onConnectionComplete(const ble::ConnectionCompleteEvent& event) {
+    if (event.getStatus() != BLE_ERROR_NONE) {
+        startAdvertising();
+        return;
+    }
+    INFO("BLE central connected.");
+    restartSendEvent(event.getConnectionInterval());
+}
+
+void BleTransport::onConnectionParametersUpdateComplete(const ble::ConnectionParametersUpdateCompleteEvent& event) {
+    if (event.getStatus() == BLE_ERROR_NONE) {
+        restartSendEvent(event.getConnectionInterval());
+    }
+}
+
+void BleTransport::onDisconnectionComplete(const ble::DisconnectionCompleteEvent& event) {
+    INFO("BLE central disconnected.");
+    m_mutex.lock();
+    m_subscribed = false;
+    m_packer.clear();
+    m_packer.setAttMtu(BLE_DEFAULT_ATT_MTU);
+    m_credits = BLE_NOTIFICATIONS_PER_EVENT;
+    m_mutex.unlock();
+
+    if (m_send_event != 0) {
+        m_event_queue.cancel(m_send_event);
+        m_send_event = 0;
+    }
+    startAdvertising();
+}
+
+void BleTransport::onAttMtuChange(ble::connection_handle_t connection_handle, uint16_t att_mtu) {
+    INFO("BLE ATT MTU changed to %u.", att_mtu);
+    m_mutex.lock();
+    m_packer.setAttMtu(att_mtu);
+    m_mutex.unlock();
+}
+
+/**
+ * @brief Returns credits for notifications the controller has transmitted.
+ */
+void BleTransport::onDataSent(const GattDataSentCallbackParams& params) {
+    m_mutex.lock();
+    m_credits = std::min(m_credits + 1, BLE_NOTIFICATIONS_PER_EVENT);
+    m_mutex.unlock();
+}
+
+void BleTransport::onUpdatesEnabled(const GattUpdatesEnabledCallbackParams& params) {
+    if (params.attHandle == m_characteristic.getValueHandle()) {
+        m_mutex.lock();
+        m_subscribed = true;
+        m_mutex.unlock();
+    }
+}
+
+void BleTransport::onUpdatesDisabled(const GattUpdatesDisabledCallbackParams& params) {
+    if (params.attHandle == m_characteristic.getValueHandle()) {
+        m_mutex.lock();
+        m_subscribed = false;
+        m_mutex.unlock();
+    }
+}
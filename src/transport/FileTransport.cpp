@@ -0,0 +1,48 @@
+/**
+ * @file FileTransport.cpp
+ * @brief Implementation of the FileTransport class.
+ */
+
+#include "transport/FileTransport.h"
+
+FileTransport::FileTransport(const char* name)
+    : FrameSink(name, BACKPRESSURE_DROP_NEWEST, FILE_TRANSPORT_BUDGET), m_file(nullptr), m_unflushed(0) {
+}
+
+FileTransport::~FileTransport(void) {
+    close();
+}
+
+bool FileTransport::open(const char* path) {
+    close();
+    m_file = fopen(path, "ab");
+    return m_file != nullptr;
+}
+
+void FileTransport::close(void) {
+    if (m_file != nullptr) {
+        fclose(m_file);
+        m_file = nullptr;
+    }
+}
+
+/**
+ * @brief Appends bytes to the file.
+ *
+ * @details
+ * While the file is closed nothing is taken, so frames pile up in the queue
+ * and are dropped by the policy instead of being lost silently.
+ */
+size_t FileTransport::writeSome(const uint8_t* data, size_t size) {
+    if (m_file == nullptr) {
+        return 0;
+    }
+
+    size_t written = fwrite(data, 1, size, m_file);
+    m_unflushed += written;
+    if (m_unflushed >= FILE_TRANSPORT_FLUSH_SIZE) {
+        fflush(m_file);
+        m_unflushed = 0;
+    }
+    return written;
+}
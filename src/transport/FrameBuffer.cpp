@@ -0,0 +1,34 @@
+/**
+ * @file FrameBuffer.cpp
+ * @brief Implementation of the FramePool class.
+ */
+
+#include "transport/FrameBuffer.h"
+
+FramePool::FramePool(void) {
+    for (FrameBuffer& buffer : m_buffers) {
+        buffer.refs.store(0, std::memory_order_relaxed);
+        buffer.size = 0;
+    }
+}
+
+FrameRef FramePool::allocate(void) {
+    for (FrameBuffer& buffer : m_buffers) {
+        uint32_t expected = 0;
+        if (buffer.refs.compare_exchange_strong(expected, 1, std::memory_order_acquire)) {
+            buffer.size = 0;
+            return FrameRef(&buffer);
+        }
+    }
+    return FrameRef();
+}
+
+size_t FramePool::available(void) const {
+    size_t count = 0;
+    for (const FrameBuffer& buffer : m_buffers) {
+        if (buffer.refs.load(std::memory_order_relaxed) == 0) {
+            count++;
+        }
+    }
+    return count;
+}
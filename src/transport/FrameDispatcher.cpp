@@ -0,0 +1,63 @@
+/**
+ * @file FrameDispatcher.cpp
+ * @brief Implementation of the FrameDispatcher class.
+ */
+
+#include "transport/FrameDispatcher.h"
+
+FrameDispatcher::FrameDispatcher(void) : m_sinks{}, m_sink_count(0) {
+}
+
+bool FrameDispatcher::addSink(FrameSink& sink) {
+    if (m_sink_count == FRAME_DISPATCHER_MAX_SINKS) {
+        return false;
+    }
+    m_sinks[m_sink_count++] = &sink;
+    return true;
+}
+
+size_t FrameDispatcher::publish(const FrameRef& frame, TrafficClass traffic_class) {
+    size_t queued = 0;
+    for (size_t i = 0; i < m_sink_count; i++) {
+        if (m_sinks[i]->offer(frame, traffic_class)) {
+            queued++;
+        }
+    }
+    return queued;
+}
+
+void FrameDispatcher::service(void) {
+    for (size_t i = 0; i < m_sink_count; i++) {
+        m_sinks[i]->service();
+    }
+}
+
+size_t FrameDispatcher::backlog(void) const {
+    size_t backlog = 0;
+    for (size_t i = 0; i < m_sink_count; i++) {
+        if (m_sinks[i]->linkUp() && m_sinks[i]->queued() > backlog) {
+            backlog = m_sinks[i]->queued();
+        }
+    }
+    return backlog;
+}
+
+/**
+ * @details
+ * Sinks whose link is down are ignored, like in `backlog`. A producer that
+ * only publishes while this returns true keeps its data while no link is up
+ * instead of filling a flash backlog with it.
+ */
+bool FrameDispatcher::canAccept(TrafficClass traffic_class) const {
+    bool up = false;
+    for (size_t i = 0; i < m_sink_count; i++) {
+        if (!m_sinks[i]->linkUp()) {
+            continue;
+        }
+        if (!m_sinks[i]->canAccept(traffic_class)) {
+            return false;
+        }
+        up = true;
+    }
+    return up;
+}
@@ -0,0 +1,245 @@
+/**
+ * @file FrameSink.cpp
+ * @brief Implementation of the FrameSink queue and backpressure handling.
+ */
+
+#include "transport/FrameSink.h"
+
+#include <utility>
+
+#include "pipeline/LatencyHistogram.h"
+#include "storage/RetainedState.h"
+#include "transport/TxScheduler.h"
+
+FrameSink::FrameSink(const char* name, BackpressurePolicy policy, size_t budget)
+    : m_name(name), m_policy(policy), m_budget(budget), m_head(0), m_count(0), m_offset(0),
+      m_stats{0, 0, 0, 0, 0, 0}, m_backlog(nullptr), m_drain_budget(0), m_backlog_offset(0), m_latency(nullptr),
+      m_clock(nullptr), m_queued_us{}, m_scheduler(nullptr), m_retained(nullptr), m_retained_handles{} {
+}
+
+void FrameSink::attachBacklog(FlashRingLog& log, size_t drain_budget) {
+    m_backlog = &log;
+    m_drain_budget = drain_budget;
+    m_backlog_offset = 0;
+}
+
+void FrameSink::attachLatencyHistogram(LatencyHistogram& histogram, uint32_t (*clock)(void)) {
+    m_clock = clock;
+    m_latency = &histogram;
+}
+
+void FrameSink::attachScheduler(TxScheduler& scheduler, uint32_t (*clock)(void)) {
+    m_clock = clock;
+    m_scheduler = &scheduler;
+}
+
+void FrameSink::attachRetained(RetainedState& retained) {
+    m_retained = &retained;
+}
+
+size_t FrameSink::queued(void) const {
+    return m_count + (m_scheduler != nullptr ? m_scheduler->queued() : 0);
+}
+
+bool FrameSink::canAccept(TrafficClass traffic_class) const {
+    if (m_backlog != nullptr && !linkUp()) {
+        return false;
+    }
+    if (m_scheduler != nullptr) {
+        return m_scheduler->canAccept(traffic_class);
+    }
+    return m_count < FRAME_SINK_QUEUE_DEPTH;
+}
+
+/**
+ * @brief Queues a frame or applies the backpressure policy.
+ *
+ * @details
+ * A frame that is already partially written is never dropped, because the
+ * link would receive a truncated frame. With `BACKPRESSURE_DROP_OLDEST` the
+ * oldest frame that has not been started is removed instead, and the queued
+ * frames behind it move up by one slot.
+ */
+bool FrameSink::offer(const FrameRef& frame, TrafficClass traffic_class) {
+    if (m_backlog != nullptr && !linkUp()) {
+        restartPartialFrames();
+        if (m_backlog->append(frame.data(), frame.size())) {
+            m_stats.stored++;
+            return true;
+        }
+        m_stats.dropped++;
+        return false;
+    }
+
+    if (m_scheduler != nullptr) {
+        bool evicted;
+        bool queued = m_scheduler->offer(frame, traffic_class, now(), &evicted);
+        if (queued) {
+            m_stats.accepted++;
+        }
+        if (!queued || evicted) {
+            m_stats.dropped++;
+        }
+        return queued;
+    }
+
+    if (m_count == FRAME_SINK_QUEUE_DEPTH) {
+        size_t victim = (m_offset > 0) ? 1 : 0;
+        if (m_policy == BACKPRESSURE_DROP_NEWEST || victim >= m_count) {
+            m_stats.dropped++;
+            return false;
+        }
+        if (m_retained != nullptr) {
+            m_retained->release(m_retained_handles[(m_head + victim) % FRAME_SINK_QUEUE_DEPTH]);
+        }
+        for (size_t i = victim; i + 1 < m_count; i++) {
+            m_queue[(m_head + i) % FRAME_SINK_QUEUE_DEPTH] =
+                std::move(m_queue[(m_head + i + 1) % FRAME_SINK_QUEUE_DEPTH]);
+            m_queued_us[(m_head + i) % FRAME_SINK_QUEUE_DEPTH] =
+                m_queued_us[(m_head + i + 1) % FRAME_SINK_QUEUE_DEPTH];
+            m_retained_handles[(m_head + i) % FRAME_SINK_QUEUE_DEPTH] =
+                m_retained_handles[(m_head + i + 1) % FRAME_SINK_QUEUE_DEPTH];
+        }
+        m_count--;
+        m_stats.dropped++;
+    }
+
+    m_queue[(m_head + m_count) % FRAME_SINK_QUEUE_DEPTH] = frame;
+    if (m_latency != nullptr) {
+        m_queued_us[(m_head + m_count) % FRAME_SINK_QUEUE_DEPTH] = m_clock();
+    }
+    if (m_retained != nullptr) {
+        m_retained_handles[(m_head + m_count) % FRAME_SINK_QUEUE_DEPTH] =
+            m_retained->append(frame.data(), frame.size());
+    }
+    m_count++;
+    m_stats.accepted++;
+    return true;
+}
+
+void FrameSink::pop(void) {
+    if (m_retained != nullptr) {
+        m_retained->release(m_retained_handles[m_head]);
+        m_retained_handles[m_head] = 0;
+    }
+    m_queue[m_head].reset();
+    m_head = (m_head + 1) % FRAME_SINK_QUEUE_DEPTH;
+    m_count--;
+    m_offset = 0;
+}
+
+/**
+ * @brief Moves the frame the scheduler picks into the sink's own queue.
+ * @return False if the scheduler has no frame that may be sent now.
+ */
+bool FrameSink::pullScheduled(void) {
+    if (m_scheduler == nullptr) {
+        return false;
+    }
+    uint32_t queued_us;
+    FrameRef frame = m_scheduler->next(now(), &queued_us);
+    if (!frame) {
+        return false;
+    }
+    m_queue[m_head] = std::move(frame);
+    m_queued_us[m_head] = queued_us;
+    m_count = 1;
+    return true;
+}
+
+/**
+ * @brief Forgets how much of the current live and stored frame was written.
+ *
+ * @details
+ * The peer dropped whatever part of a frame it had received when the link
+ * went down, so both frames are sent again from their start.
+ */
+void FrameSink::restartPartialFrames(void) {
+    m_offset = 0;
+    m_backlog_offset = 0;
+}
+
+/**
+ * @brief Writes live frames first, then stored ones if the link is idle.
+ *
+ * @details
+ * A stored frame that was started in an earlier call is finished first, out
+ * of the live budget; a live frame in between would end up inside it. Live
+ * frames wait until it is complete.
+ */
+void FrameSink::service(void) {
+    if (!linkUp()) {
+        restartPartialFrames();
+        return;
+    }
+
+    size_t budget = m_budget;
+    if (m_backlog_offset > 0) {
+        budget -= forwardStored(budget, false);
+        if (m_backlog_offset > 0) {
+            return;
+        }
+    }
+
+    while (budget > 0 && (m_count > 0 || pullScheduled())) {
+        const FrameRef& frame = m_queue[m_head];
+        size_t remaining = frame.size() - m_offset;
+        size_t written = writeSome(frame.data() + m_offset, remaining < budget ? remaining : budget);
+        if (written == 0) {
+            break;
+        }
+
+        m_offset += written;
+        budget -= written;
+        m_stats.bytes += written;
+        if (m_offset == frame.size()) {
+            m_stats.sent++;
+            if (m_latency != nullptr) {
+                m_latency->record(m_clock() - m_queued_us[m_head]);
+            }
+            pop();
+        }
+    }
+
+    if (queued() == 0 && m_backlog != nullptr) {
+        forwardStored(m_drain_budget, true);
+    }
+}
+
+/**
+ * @brief Forwards stored frames.
+ * @param budget Bytes written at most.
+ * @param start_next Start further stored frames, else stop once the current one is complete.
+ * @return Number of bytes written.
+ *
+ * @details
+ * The frame is re-read from the log on every call; the log keeps it cached
+ * unless a new frame was appended in between.
+ */
+size_t FrameSink::forwardStored(size_t budget, bool start_next) {
+    size_t total = budget;
+    while (budget > 0 && (start_next || m_backlog_offset > 0)) {
+        size_t size;
+        const uint8_t* frame = m_backlog->front(&size);
+        if (frame == nullptr) {
+            m_backlog_offset = 0;
+            break;
+        }
+
+        size_t remaining = size - m_backlog_offset;
+        size_t written = writeSome(frame + m_backlog_offset, remaining < budget ? remaining : budget);
+        if (written == 0) {
+            break;
+        }
+
+        m_backlog_offset += written;
+        budget -= written;
+        m_stats.bytes += written;
+        if (m_backlog_offset == size) {
+            m_stats.forwarded++;
+            m_backlog->pop();
+            m_backlog_offset = 0;
+        }
+    }
+    return total - budget;
+}
@@ -0,0 +1,32 @@
+/**
+ * @file LoopbackTransport.cpp
+ * @brief Implementation of the LoopbackTransport class.
+ */
+
+#include "transport/LoopbackTransport.h"
+
+LoopbackTransport::LoopbackTransport(const char* name, BackpressurePolicy policy)
+    : FrameSink(name, policy), m_head(0), m_size(0) {
+}
+
+size_t LoopbackTransport::writeSome(const uint8_t* data, size_t size) {
+    size_t count = LOOPBACK_BUFFER_SIZE - m_size;
+    if (size < count) {
+        count = size;
+    }
+    for (size_t i = 0; i < count; i++) {
+        m_buffer[(m_head + m_size + i) % LOOPBACK_BUFFER_SIZE] = data[i];
+    }
+    m_size += count;
+    return count;
+}
+
+size_t LoopbackTransport::read(uint8_t* out, size_t capacity) {
+    size_t count = (capacity < m_size) ? capacity : m_size;
+    for (size_t i = 0; i < count; i++) {
+        out[i] = m_buffer[(m_head + i) % LOOPBACK_BUFFER_SIZE];
+    }
+    m_head = (m_head + count) % LOOPBACK_BUFFER_SIZE;
+    m_size -= count;
+    return count;
+}
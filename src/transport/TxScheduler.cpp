@@ -0,0 +1,168 @@
+/**
+ * @file TxScheduler.cpp
+ * @brief Implementation of the TxScheduler class.
+ */
+
+#include "transport/TxScheduler.h"
+
+#include <utility>
+
+/// Microseconds per second, the unit of the token residue.
+#define US_PER_SECOND 1000000u
+
+TxScheduler::TxScheduler(void) : m_turn{}, m_granted{}, m_last_us(0) {
+    for (size_t i = 0; i < TRAFFIC_CLASS_COUNT; i++) {
+        ClassQueue& queue = m_classes[i];
+        queue.head = 0;
+        queue.count = 0;
+        queue.stats = TxClassStats{0, 0, 0, 0};
+        queue.deficit = 0;
+        configure((TrafficClass)i, TX_CLASS_DEFAULTS[i]);
+    }
+}
+
+void TxScheduler::configure(TrafficClass traffic_class, const TxClassConfig& config) {
+    ClassQueue& queue = m_classes[traffic_class];
+    queue.config = config;
+    if (queue.config.priority >= TRAFFIC_CLASS_COUNT) {
+        queue.config.priority = TRAFFIC_CLASS_COUNT - 1;
+    }
+    if (queue.config.weight == 0) {
+        queue.config.weight = 1;
+    }
+    if (queue.config.burst == 0) {
+        queue.config.burst = 1;
+    }
+    queue.tokens = (int32_t)queue.config.burst;
+    queue.residue = 0;
+}
+
+/**
+ * @details
+ * A queued frame has not been started yet, so `BACKPRESSURE_DROP_OLDEST`
+ * may always evict the head of the class queue.
+ */
+bool TxScheduler::offer(const FrameRef& frame, TrafficClass traffic_class, uint32_t now_us, bool* evicted) {
+    ClassQueue& queue = m_classes[traffic_class];
+    *evicted = false;
+    if (queue.count == TX_SCHEDULER_QUEUE_DEPTH) {
+        queue.stats.dropped++;
+        if (queue.config.policy == BACKPRESSURE_DROP_NEWEST) {
+            return false;
+        }
+        queue.frames[queue.head].reset();
+        queue.head = (queue.head + 1) % TX_SCHEDULER_QUEUE_DEPTH;
+        queue.count--;
+        *evicted = true;
+    }
+
+    size_t slot = (queue.head + queue.count) % TX_SCHEDULER_QUEUE_DEPTH;
+    queue.frames[slot] = frame;
+    queue.queued_us[slot] = now_us;
+    queue.count++;
+    queue.stats.accepted++;
+    return true;
+}
+
+/**
+ * @details
+ * Deficit round robin among the classes of the highest priority that may
+ * send: the class in turn gets `weight * TX_SCHEDULER_QUANTUM` bytes of
+ * credit once per turn and keeps the turn while its credit covers its next
+ * frame. A class that runs empty loses its credit, so idle time is not saved
+ * up. Every full round adds at least one quantum to a waiting class, so a
+ * frame of up to `FRAME_BUFFER_CAPACITY` bytes is picked within a few rounds.
+ */
+FrameRef TxScheduler::next(uint32_t now_us, uint32_t* queued_us) {
+    refill(now_us);
+
+    size_t level = TRAFFIC_CLASS_COUNT;
+    for (const ClassQueue& queue : m_classes) {
+        if (eligible(queue) && queue.config.priority < level) {
+            level = queue.config.priority;
+        }
+    }
+    if (level == TRAFFIC_CLASS_COUNT) {
+        return FrameRef();
+    }
+
+    size_t index = m_turn[level];
+    while (true) {
+        ClassQueue& queue = m_classes[index];
+        if (queue.config.priority == level) {
+            if (eligible(queue)) {
+                if (!m_granted[level]) {
+                    queue.deficit += queue.config.weight * TX_SCHEDULER_QUANTUM;
+                    m_granted[level] = true;
+                }
+                int32_t size = (int32_t)queue.frames[queue.head].size();
+                if (queue.deficit >= size) {
+                    queue.deficit -= size;
+                    m_turn[level] = index;
+                    return pop(queue, queued_us);
+                }
+            } else if (queue.count == 0) {
+                queue.deficit = 0;
+            }
+        }
+        index = (index + 1) % TRAFFIC_CLASS_COUNT;
+        m_granted[level] = false;
+    }
+}
+
+size_t TxScheduler::queued(void) const {
+    size_t count = 0;
+    for (const ClassQueue& queue : m_classes) {
+        count += queue.count;
+    }
+    return count;
+}
+
+/**
+ * @details
+ * Tokens are bytes; the part of a byte earned since the last refill is kept
+ * in `residue`, so slow rates are not rounded away at short intervals.
+ */
+void TxScheduler::refill(uint32_t now_us) {
+    uint32_t elapsed_us = now_us - m_last_us;
+    m_last_us = now_us;
+    for (ClassQueue& queue : m_classes) {
+        if (queue.config.rate == 0) {
+            continue;
+        }
+        uint64_t credit = (uint64_t)elapsed_us * queue.config.rate + queue.residue;
+        int64_t tokens = queue.tokens + (int64_t)(credit / US_PER_SECOND);
+        queue.residue = (uint32_t)(credit % US_PER_SECOND);
+        if (tokens >= (int64_t)queue.config.burst) {
+            tokens = queue.config.burst;
+            queue.residue = 0;
+        }
+        queue.tokens = (int32_t)tokens;
+    }
+}
+
+/**
+ * @details
+ * A capped class may start a frame while it has any token left; the frame
+ * may drive the bucket negative, which the class then pays back before its
+ * next frame. Its average rate is therefore the cap.
+ */
+bool TxScheduler::eligible(const ClassQueue& queue) const {
+    return queue.count > 0 && (queue.config.rate == 0 || queue.tokens > 0);
+}
+
+FrameRef TxScheduler::pop(ClassQueue& queue, uint32_t* queued_us) {
+    FrameRef frame = std::move(queue.frames[queue.head]);
+    *queued_us = queue.queued_us[queue.head];
+    queue.head = (queue.head + 1) % TX_SCHEDULER_QUEUE_DEPTH;
+    queue.count--;
+    if (queue.count == 0) {
+        queue.deficit = 0;
+    }
+    if (queue.config.rate != 0) {
+        queue.tokens -= (int32_t)frame.size();
+    }
+    queue.stats.sent++;
+    queue.stats.bytes += frame.size();
+    return frame;
+}
@@ -0,0 +1,103 @@
+/**
+ * @file UartTransport.cpp
+ * @brief Implementation of the UartTransport class.
+ */
+
+#include "transport/UartTransport.h"
+
+#if defined(CLOCK_SYNC)
+#include "timing/NodeClock.h"
+#endif
+
+/**
+ * @brief Access the singleton instance of UartTransport.
+ * 
+ * @return Reference to the single instance of UartTransport.
+ */
+UartTransport& UartTransport::getInstance(void) {
+    static UartTransport instance;
+    return instance;
+}
+
+/**
+ * @brief Constructs a UartTransport instance.
+ * 
+ * TX: PC_1, RX: PC_0 (NUCLEO board)
+ * Raspberry Pi connection:
+ * - TX -> GPIO 15 (RX)
+ * - RX -> GPIO 14 (TX)
+ * - GND -> GND
+ * - PA_8 (D6) <- any GPIO held high by the logger (`STORE_AND_FORWARD` only)
+ *
+ * Sets the serial port format to 8 data bits, no parity, and 1 stop bit (8N1).
+ */
+UartTransport::UartTransport(void)
+    : FrameSink("uart", BACKPRESSURE_DROP_OLDEST),
+      m_serial_port(/*PC_1*/USBTX, /*PC_0*/USBRX, UART_BAUDRATE)
+#if defined(CLOCK_SYNC)
+      , m_event_us(0), m_event_seen(false)
+#endif
+#if defined(STORE_AND_FORWARD)
+      , m_host_ready(UART_HOST_READY_PIN, PullDown)
+#endif
+{
+    m_serial_port.set_format(8, BufferedSerial::None, 1);  // 8N1 format
+    m_serial_port.set_blocking(false);
+#if defined(CLOCK_SYNC)
+    m_serial_port.sigio(callback(this, &UartTransport::onSerialEvent));
+#endif
+}
+
+/**
+ * @brief Copies as many bytes as fit into the TX buffer.
+ *
+ * @details
+ * In non-blocking mode `write` returns `-EAGAIN` when the buffer is full.
+ */
+size_t UartTransport::writeSome(const uint8_t* data, size_t size) {
+    ssize_t written = m_serial_port.write(data, size);
+    return (written > 0) ? (size_t)written : 0;
+}
+
+#if defined(CLOCK_SYNC)
+/**
+ * @details
+ * `BufferedSerial` signals an event when its RX buffer turns non-empty, and
+ * when its full TX buffer has room again. The buffer is read until it is
+ * empty, so the next received byte is signalled again; the latest event
+ * before the read is therefore the arrival of the first byte or a later TX
+ * event. Without an event since the last read, e.g. because `data` was too
+ * small to empty the buffer, the current time is reported. Either way the
+ * reported time is never earlier than the arrival, which `ClockSync` sees as
+ * a longer delay and filters out.
+ */
+size_t UartTransport::readSome(uint8_t* data, size_t size, uint64_t* received_us) {
+    size_t count = 0;
+    while (count < size) {
+        ssize_t received = m_serial_port.read(data + count, size - count);
+        if (received <= 0) {
+            break;
+        }
+        count += (size_t)received;
+    }
+
+    core_util_critical_section_enter();
+    *received_us = m_event_seen ? m_event_us : node_clock_us();
+    m_event_seen = false;
+    core_util_critical_section_exit();
+    return count;
+}
+
+void UartTransport::onSerialEvent(void) {
+    m_event_us = node_clock_us();
+    m_event_seen = true;
+}
+#endif
+
+bool UartTransport::linkUp(void) const {
+#if defined(STORE_AND_FORWARD)
+    return m_host_ready.read() == 1;
+#else
+    return true;
+#endif
+}